@@ -68,6 +68,10 @@ struct kvm_arch {
 	/* Interrupt controller */
 	struct vgic_dist	vgic;
 	int max_vcpus;
+
+	/* Host SCHED_FIFO range for guest priority hints, 0 if disabled */
+	unsigned int rt_prio_min;
+	unsigned int rt_prio_max;
 };
 
 #define KVM_NR_MEM_OBJS     40
@@ -220,6 +224,7 @@ static inline int kvm_arch_dev_ioctl_check_extension(long ext)
 }
 
 int kvm_perf_init(void);
+int kvm_arm_rt_prio_hint(struct kvm_vcpu *vcpu);
 int kvm_perf_teardown(void);
 
 void kvm_mmu_wp_memory_region(struct kvm *kvm, int slot);
@@ -28,6 +28,7 @@
 #include <linux/sched.h>
 #include <linux/kvm.h>
 #include <trace/events/kvm.h>
+#include <uapi/linux/psci.h>
 
 #define CREATE_TRACE_POINTS
 #include "trace.h"
@@ -188,6 +189,9 @@ int kvm_vm_ioctl_check_extension(struct kvm *kvm, long ext)
 		r = KVM_COALESCED_MMIO_PAGE_OFFSET;
 		break;
 	case KVM_CAP_ARM_SET_DEVICE_ADDR:
+	case KVM_CAP_ENABLE_CAP_VM:
+	case KVM_CAP_HALT_POLL:
+	case KVM_CAP_ARM_RT_PRIO:
 		r = 1;
 		break;
 	case KVM_CAP_NR_VCPUS:
@@ -919,6 +923,78 @@ static int kvm_vm_ioctl_set_device_addr(struct kvm *kvm,
 	}
 }
 
+static int kvm_vm_ioctl_enable_cap(struct kvm *kvm,
+				   struct kvm_enable_cap *cap)
+{
+	int r = 0;
+
+	if (cap->flags)
+		return -EINVAL;
+
+	switch (cap->cap) {
+	case KVM_CAP_HALT_POLL:
+		/* args[0]: maximum poll time in ns, 0 disables polling */
+		if (cap->args[0] > UINT_MAX)
+			return -EINVAL;
+		WRITE_ONCE(kvm->max_halt_poll_ns, cap->args[0]);
+		WRITE_ONCE(kvm->override_halt_poll_ns, true);
+		break;
+	case KVM_CAP_ARM_RT_PRIO:
+		/* args[0], args[1]: SCHED_FIFO range, 0 disables the hint */
+		if (cap->args[1] > MAX_USER_RT_PRIO - 1 ||
+		    cap->args[0] > cap->args[1] ||
+		    (cap->args[1] && !cap->args[0]))
+			return -EINVAL;
+		mutex_lock(&kvm->lock);
+		kvm->arch.rt_prio_min = cap->args[0];
+		kvm->arch.rt_prio_max = cap->args[1];
+		mutex_unlock(&kvm->lock);
+		break;
+	default:
+		r = -EINVAL;
+		break;
+	}
+
+	return r;
+}
+
+/**
+ * kvm_arm_rt_prio_hint - apply a guest priority hint to the vcpu thread
+ * @vcpu:	the vcpu issuing KVM_ARM_HVC_RT_PRIO_HINT
+ *
+ * Runs in the context of the vcpu thread, so the policy change is
+ * subject to the usual permission checks (CAP_SYS_NICE, RLIMIT_RTPRIO)
+ * of the VMM that created it.
+ */
+int kvm_arm_rt_prio_hint(struct kvm_vcpu *vcpu)
+{
+	struct kvm *kvm = vcpu->kvm;
+	unsigned long hint = vcpu_get_reg(vcpu, 1);
+	struct sched_param param = { .sched_priority = 0 };
+	int policy = SCHED_NORMAL;
+	unsigned long ret = PSCI_RET_SUCCESS;
+
+	mutex_lock(&kvm->lock);
+	if (!kvm->arch.rt_prio_max) {
+		ret = PSCI_RET_NOT_SUPPORTED;
+	} else if (hint >= MAX_USER_RT_PRIO) {
+		ret = PSCI_RET_INVALID_PARAMS;
+	} else if (hint) {
+		policy = SCHED_FIFO;
+		param.sched_priority = clamp_t(unsigned long, hint,
+					       kvm->arch.rt_prio_min,
+					       kvm->arch.rt_prio_max);
+	}
+	mutex_unlock(&kvm->lock);
+
+	if (ret == PSCI_RET_SUCCESS &&
+	    sched_setscheduler(current, policy, &param))
+		ret = PSCI_RET_DENIED;
+
+	vcpu_set_reg(vcpu, 0, ret);
+	return 1;
+}
+
 long kvm_arch_vm_ioctl(struct file *filp,
 		       unsigned int ioctl, unsigned long arg)
 {
@@ -949,6 +1025,13 @@ long kvm_arch_vm_ioctl(struct file *filp,
 
 		return 0;
 	}
+	case KVM_ENABLE_CAP: {
+		struct kvm_enable_cap cap;
+
+		if (copy_from_user(&cap, argp, sizeof(cap)))
+			return -EFAULT;
+		return kvm_vm_ioctl_enable_cap(kvm, &cap);
+	}
 	default:
 		return -EINVAL;
 	}
@@ -1377,6 +1377,30 @@ out:
 		kvm_set_pfn_accessed(pfn);
 }
 
+/*
+ * Doorbell writes (virtio-mmio QueueNotify and the like) are usually
+ * backed by an ioeventfd that ignores the written value. Those are also
+ * registered on KVM_FAST_MMIO_BUS, so check it before looking up the
+ * memslot and decoding the access: a hit only needs to signal the
+ * eventfd and skip the instruction. Must be called with kvm->srcu held.
+ */
+static bool kvm_handle_fast_mmio(struct kvm_vcpu *vcpu, phys_addr_t fault_ipa,
+				 bool is_iabt, unsigned long fault_status)
+{
+	if (is_iabt || fault_status != FSC_FAULT ||
+	    !kvm_vcpu_dabt_isvalid(vcpu) || !kvm_vcpu_dabt_iswrite(vcpu) ||
+	    kvm_vcpu_dabt_isextabt(vcpu) || kvm_vcpu_dabt_iss1tw(vcpu))
+		return false;
+
+	fault_ipa |= kvm_vcpu_get_hfar(vcpu) & ((1 << 12) - 1);
+	if (kvm_io_bus_write(vcpu, KVM_FAST_MMIO_BUS, fault_ipa, 0, NULL))
+		return false;
+
+	trace_kvm_fast_mmio(fault_ipa);
+	kvm_skip_instr(vcpu, kvm_vcpu_trap_il_is32bit(vcpu));
+	return true;
+}
+
 /**
  * kvm_handle_guest_abort - handles all 2nd stage aborts
  * @vcpu:	the VCPU pointer
@@ -1418,6 +1442,11 @@ int kvm_handle_guest_abort(struct kvm_vcpu *vcpu, struct kvm_run *run)
 
 	idx = srcu_read_lock(&vcpu->kvm->srcu);
 
+	if (kvm_handle_fast_mmio(vcpu, fault_ipa, is_iabt, fault_status)) {
+		ret = 1;
+		goto out_unlock;
+	}
+
 	gfn = fault_ipa >> PAGE_SHIFT;
 	memslot = gfn_to_memslot(vcpu->kvm, gfn);
 	hva = gfn_to_hva_memslot_prot(memslot, gfn, &writable);
@@ -25,6 +25,8 @@
 
 #include <crypto/internal/hash.h>
 
+#include <asm/crc32c.h>
+
 MODULE_AUTHOR("Yazen Ghannam <yazen.ghannam@linaro.org>");
 MODULE_DESCRIPTION("CRC32 and CRC32C using optional ARMv8 instructions");
 MODULE_LICENSE("GPL v2");
@@ -33,10 +35,6 @@ MODULE_LICENSE("GPL v2");
 #define CRC32W(crc, value) __asm__("crc32w %w[c], %w[c], %w[v]":[c]"+r"(crc):[v]"r"(value))
 #define CRC32H(crc, value) __asm__("crc32h %w[c], %w[c], %w[v]":[c]"+r"(crc):[v]"r"(value))
 #define CRC32B(crc, value) __asm__("crc32b %w[c], %w[c], %w[v]":[c]"+r"(crc):[v]"r"(value))
-#define CRC32CX(crc, value) __asm__("crc32cx %w[c], %w[c], %x[v]":[c]"+r"(crc):[v]"r"(value))
-#define CRC32CW(crc, value) __asm__("crc32cw %w[c], %w[c], %w[v]":[c]"+r"(crc):[v]"r"(value))
-#define CRC32CH(crc, value) __asm__("crc32ch %w[c], %w[c], %w[v]":[c]"+r"(crc):[v]"r"(value))
-#define CRC32CB(crc, value) __asm__("crc32cb %w[c], %w[c], %w[v]":[c]"+r"(crc):[v]"r"(value))
 
 static u32 crc32_arm64_le_hw(u32 crc, const u8 *p, unsigned int len)
 {
@@ -62,28 +60,81 @@ static u32 crc32_arm64_le_hw(u32 crc, const u8 *p, unsigned int len)
 	return crc;
 }
 
-static u32 crc32c_arm64_le_hw(u32 crc, const u8 *p, unsigned int len)
+/*
+ * The CRC instructions have a latency of several cycles but can issue one
+ * per cycle, so a single stream leaves most of the unit idle. Large
+ * buffers are therefore split into three blocks of equal size whose CRCs
+ * are computed in parallel and then merged:
+ *
+ *   crc(A|B|C) = crc(A) * x^(2 * 8n) ^ crc(B) * x^(8n) ^ crc(C)
+ *
+ * where B and C start from 0 and n is the block size in bytes. The
+ * multiplication is a carry-less 32x32 multiply by a precomputed
+ * constant, x^(8n - 33) mod P, that the crc32cx instruction then reduces.
+ */
+#define CRC32C_3WAY_LARGE	1024
+#define CRC32C_3WAY_SMALL	256
+
+struct crc32c_3way_consts {
+	unsigned int	block;
+	u32		k1;	/* x^(8 * block - 33) mod P */
+	u32		k2;	/* x^(16 * block - 33) mod P */
+};
+
+static const struct crc32c_3way_consts crc32c_3way_consts[] = {
+	{ CRC32C_3WAY_LARGE, 0x170076fa, 0xa51b6135 },
+	{ CRC32C_3WAY_SMALL, 0xb9e02b86, 0xdd7e3b0c },
+};
+
+/*
+ * Only two multiplications are needed per merge, which is cheaper done in
+ * general purpose registers than by entering kernel mode NEON for PMULL.
+ */
+static u64 crc32c_clmul(u32 a, u32 b)
 {
-	s64 length = len;
+	u64 r = 0;
+	int i;
 
-	while ((length -= sizeof(u64)) >= 0) {
+	for (i = 0; i < 32; i++)
+		r ^= ((u64)b << i) & -(u64)((a >> i) & 1);
+
+	return r;
+}
+
+static u32 crc32c_3way(u32 crc, const u8 *p, unsigned int block,
+		       u32 k1, u32 k2)
+{
+	const u8 *end = p + block;
+	u32 crc1 = 0, crc2 = 0;
+	u64 merge;
+
+	for (; p < end; p += sizeof(u64)) {
 		CRC32CX(crc, get_unaligned_le64(p));
-		p += sizeof(u64);
+		CRC32CX(crc1, get_unaligned_le64(p + block));
+		CRC32CX(crc2, get_unaligned_le64(p + 2 * block));
 	}
 
-	/* The following is more efficient than the straight loop */
-	if (length & sizeof(u32)) {
-		CRC32CW(crc, get_unaligned_le32(p));
-		p += sizeof(u32);
-	}
-	if (length & sizeof(u16)) {
-		CRC32CH(crc, get_unaligned_le16(p));
-		p += sizeof(u16);
+	merge = crc32c_clmul(crc, k2) ^ crc32c_clmul(crc1, k1);
+	crc = 0;
+	CRC32CX(crc, merge);
+
+	return crc ^ crc2;
+}
+
+static u32 crc32c_arm64_le_hw(u32 crc, const u8 *p, unsigned int len)
+{
+	const struct crc32c_3way_consts *c;
+
+	for (c = crc32c_3way_consts;
+	     c < crc32c_3way_consts + ARRAY_SIZE(crc32c_3way_consts); c++) {
+		while (len >= 3 * c->block) {
+			crc = crc32c_3way(crc, p, c->block, c->k1, c->k2);
+			p += 3 * c->block;
+			len -= 3 * c->block;
+		}
 	}
-	if (length & sizeof(u8))
-		CRC32CB(crc, *p);
 
-	return crc;
+	return __crc32c_arm64_le_hw(crc, p, len);
 }
 
 #define CHKSUM_BLOCK_SIZE	1
@@ -49,11 +49,13 @@
 /*
  * #imm16 values used for BRK instruction generation
  * Allowed values for kgbd are 0x400 - 0x7ff
+ * 0x004: for installing kprobes
  * 0x100: for triggering a fault on purpose (reserved)
  * 0x400: for dynamic BRK instruction
  * 0x401: for compile time BRK instruction
  * 0x800: kernel-mode BUG() and WARN() traps
  */
+#define KPROBES_BRK_IMM			0x004
 #define FAULT_BRK_IMM			0x100
 #define KGDB_DYN_DBG_BRK_IMM		0x400
 #define KGDB_COMPILED_DBG_BRK_IMM	0x401
@@ -65,6 +67,10 @@
  */
 #define AARCH64_BREAK_MON	0xd4200000
 
+/* kprobes BRK opcode, matched on the #imm16 in the ESR */
+#define BRK64_ESR_MASK		0xFFFF
+#define BRK64_OPCODE_KPROBES	(AARCH64_BREAK_MON | (KPROBES_BRK_IMM << 5))
+
 /*
  * BRK instruction for provoking a fault on purpose
  * Unlike kgdb, #imm16 value with unallocated handler is used for faulting.
@@ -66,6 +66,10 @@ struct kvm_arch {
 
 	/* Timer */
 	struct arch_timer_kvm	timer;
+
+	/* Host SCHED_FIFO range for guest priority hints, 0 if disabled */
+	unsigned int rt_prio_min;
+	unsigned int rt_prio_max;
 };
 
 #define KVM_NR_MEM_OBJS     40
@@ -230,6 +234,7 @@ int handle_exit(struct kvm_vcpu *vcpu, struct kvm_run *run,
 		int exception_index);
 
 int kvm_perf_init(void);
+int kvm_arm_rt_prio_hint(struct kvm_vcpu *vcpu);
 int kvm_perf_teardown(void);
 
 struct kvm_vcpu *kvm_mpidr_to_vcpu(struct kvm *kvm, unsigned long mpidr);
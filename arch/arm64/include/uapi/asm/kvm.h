@@ -247,6 +247,14 @@ struct kvm_arch_memory_slot {
 #define KVM_PSCI_RET_INVAL		PSCI_RET_INVALID_PARAMS
 #define KVM_PSCI_RET_DENIED		PSCI_RET_DENIED
 
+/*
+ * Vendor hypervisor call (SMC32 fast call, owner 6) letting the guest
+ * hint the priority of the calling vCPU: x1 = 0 drops back to
+ * SCHED_NORMAL, 1..99 request SCHED_FIFO, clamped to the range set
+ * with KVM_CAP_ARM_RT_PRIO. Returns a KVM_PSCI_RET_* value in x0.
+ */
+#define KVM_ARM_HVC_RT_PRIO_HINT	0x86000001
+
 #endif
 
 #endif /* __ARM_KVM_H__ */
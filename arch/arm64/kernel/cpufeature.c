@@ -621,6 +621,19 @@ static bool has_useable_gicv3_cpuif(const struct arm64_cpu_capabilities *entry)
 	return has_sre;
 }
 
+/*
+ * The in-order Cortex-A53 keeps more of its bandwidth on large copies when
+ * the stores bypass the caches instead of evicting the working set.
+ */
+static bool prefers_nt_copy(const struct arm64_cpu_capabilities *entry)
+{
+	u32 midr = read_cpuid_id();
+
+	return (midr & (MIDR_IMPLEMENTOR_MASK | MIDR_PARTNUM_MASK)) ==
+	       ((ARM_CPU_IMP_ARM << MIDR_IMPLEMENTOR_SHIFT) |
+		(ARM_CPU_PART_CORTEX_A53 << MIDR_PARTNUM_SHIFT));
+}
+
 static const struct arm64_cpu_capabilities arm64_features[] = {
 	{
 		.desc = "GIC system register CPU interface",
@@ -651,6 +664,11 @@ static const struct arm64_cpu_capabilities arm64_features[] = {
 		.min_field_value = 2,
 	},
 #endif /* CONFIG_AS_LSE && CONFIG_ARM64_LSE_ATOMICS */
+	{
+		.desc = "Non-temporal stores for large copies",
+		.capability = ARM64_PREFER_NT_COPY,
+		.matches = prefers_nt_copy,
+	},
 	{},
 };
 
@@ -122,6 +122,19 @@ void perf_callchain_user(struct perf_callchain_entry *entry,
 
 		tail = (struct frame_tail __user *)regs->regs[29];
 
+		/*
+		 * Code built with -fomit-frame-pointer uses x29 as a scratch
+		 * register. If it cannot be a frame record on this stack,
+		 * report the caller from lr and leave deeper unwinding to
+		 * user space (the user regs and stack from perf_regs.c).
+		 */
+		if (!tail || ((unsigned long)tail & 0xf) ||
+		    (unsigned long)tail < regs->sp) {
+			if (regs->regs[30] && regs->regs[30] != regs->pc)
+				perf_callchain_store(entry, regs->regs[30]);
+			return;
+		}
+
 		while (entry->nr < PERF_MAX_STACK_DEPTH &&
 		       tail && !((unsigned long)tail & 0xf))
 			tail = user_backtrace(tail, entry);
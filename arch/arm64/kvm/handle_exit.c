@@ -40,6 +40,9 @@ static int handle_hvc(struct kvm_vcpu *vcpu, struct kvm_run *run)
 	trace_kvm_hvc_arm64(*vcpu_pc(vcpu), vcpu_get_reg(vcpu, 0),
 			    kvm_vcpu_hvc_get_imm(vcpu));
 
+	if (vcpu_get_reg(vcpu, 0) == KVM_ARM_HVC_RT_PRIO_HINT)
+		return kvm_arm_rt_prio_hint(vcpu);
+
 	ret = kvm_psci_call(vcpu);
 	if (ret < 0) {
 		kvm_inject_undefined(vcpu);
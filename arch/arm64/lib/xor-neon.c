@@ -0,0 +1,33 @@
+/*
+ * arch/arm64/lib/xor-neon.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/raid/xor.h>
+#include <linux/module.h>
+
+MODULE_LICENSE("GPL");
+
+/*
+ * Pull in the reference implementations while instructing GCC (through
+ * -ftree-vectorize) to exploit the implicit parallelism and emit NEON
+ * instructions, as on 32-bit ARM. This file is built without
+ * -mgeneral-regs-only and must only be called between kernel_neon_begin()
+ * and kernel_neon_end().
+ */
+#pragma GCC optimize "tree-vectorize"
+
+#pragma GCC diagnostic ignored "-Wunused-variable"
+#include <asm-generic/xor.h>
+
+struct xor_block_template const xor_block_neon_inner = {
+	.name	= "__inner_neon__",
+	.do_2	= xor_8regs_2,
+	.do_3	= xor_8regs_3,
+	.do_4	= xor_8regs_4,
+	.do_5	= xor_8regs_5,
+};
+EXPORT_SYMBOL(xor_block_neon_inner);
@@ -28,6 +28,7 @@
 #include <linux/mempool.h>
 #include <linux/workqueue.h>
 #include <linux/cgroup.h>
+#include <linux/blk-cgroup.h>
 
 #include <trace/events/block.h>
 
@@ -846,15 +847,42 @@ EXPORT_SYMBOL(bio_add_page);
 
 struct submit_bio_ret {
 	struct completion event;
+	struct task_struct *poller;
 	int error;
 };
 
 static void submit_bio_wait_endio(struct bio *bio)
 {
 	struct submit_bio_ret *ret = bio->bi_private;
+	struct task_struct *poller = ret->poller;
 
 	ret->error = bio->bi_error;
+
+	/* @ret is gone once completed, the poller may be too */
+	if (poller)
+		get_task_struct(poller);
 	complete(&ret->event);
+
+	/* ends a hybrid polling sleep or a spinning blk_poll() */
+	if (poller) {
+		wake_up_process(poller);
+		put_task_struct(poller);
+	}
+}
+
+/*
+ * Poll for the completion of a synchronous read on queues with polling
+ * enabled, and fall back to sleeping when blk_poll() gives up.
+ */
+static void submit_bio_poll(struct request_queue *q, blk_qc_t cookie,
+			    struct submit_bio_ret *ret)
+{
+	for (;;) {
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		if (completion_done(&ret->event) || !blk_poll(q, cookie))
+			break;
+	}
+	__set_current_state(TASK_RUNNING);
 }
 
 /**
@@ -863,17 +891,26 @@ static void submit_bio_wait_endio(struct bio *bio)
  * @bio: The &struct bio which describes the I/O
  *
  * Simple wrapper around submit_bio(). Returns 0 on success, or the error from
- * bio_endio() on failure.
+ * bio_endio() on failure. Reads from a queue with io_poll enabled are polled
+ * for instead of waiting for the completion interrupt.
  */
 int submit_bio_wait(int rw, struct bio *bio)
 {
+	struct request_queue *q = bdev_get_queue(bio->bi_bdev);
 	struct submit_bio_ret ret;
+	bool poll;
+	blk_qc_t cookie;
+
+	poll = !(rw & WRITE) && test_bit(QUEUE_FLAG_POLL, &q->queue_flags);
 
 	rw |= REQ_SYNC;
 	init_completion(&ret.event);
+	ret.poller = poll ? current : NULL;
 	bio->bi_private = &ret;
 	bio->bi_end_io = submit_bio_wait_endio;
-	submit_bio(rw, bio);
+	cookie = submit_bio(rw, bio);
+	if (poll)
+		submit_bio_poll(q, cookie, &ret);
 	wait_for_completion(&ret.event);
 
 	return ret.error;
@@ -1746,6 +1783,8 @@ void bio_endio(struct bio *bio)
 		if (unlikely(!bio_remaining_done(bio)))
 			break;
 
+		blk_throtl_bio_endio(bio);
+
 		/*
 		 * Need to have a real endio function for chained bios,
 		 * otherwise various corner cases will break (like stacking
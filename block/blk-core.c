@@ -3332,6 +3332,11 @@ bool blk_poll(struct request_queue *q, blk_qc_t cookie)
 	if (plug)
 		blk_flush_plug_list(plug, false);
 
+	if (blk_mq_poll_hybrid_sleep(q,
+			q->queue_hw_ctx[blk_qc_t_to_queue_num(cookie)],
+			blk_qc_t_to_tag(cookie)))
+		return true;
+
 	state = current->state;
 	while (!need_resched()) {
 		unsigned int queue_num = blk_qc_t_to_queue_num(cookie);
@@ -0,0 +1,408 @@
+/*
+ * Deferred and merged discards
+ *
+ * A discard queue collects the ranges a filesystem wants discarded, merges
+ * adjacent and overlapping ones, and issues them from kblockd while the disk
+ * has no other I/O in flight, at most max_sects sectors every interval.
+ *
+ * The filesystem has to call blk_discard_queue_cancel() before it writes to
+ * a range it may have queued, so that a late discard doesn't hit new data,
+ * and blk_discard_queue_flush() before unmount or when it must know the
+ * discards are done, e.g. for FITRIM.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/genhd.h>
+#include <linux/rbtree.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include "blk.h"
+
+#define BLK_DISCARD_DEF_MAX_SECTS	8192	/* per pass */
+#define BLK_DISCARD_DEF_INTERVAL	100	/* ms between passes */
+
+struct blk_discard_range {
+	struct rb_node		rb_node;	/* pending, in dq->root */
+	struct list_head	list;		/* issued, in dq->inflight */
+	sector_t		sector;
+	sector_t		nr_sects;
+	atomic_t		remaining;	/* bios in flight + 1 */
+	struct blk_discard_queue *dq;
+};
+
+struct blk_discard_queue {
+	struct block_device	*bdev;
+	spinlock_t		lock;		/* protects the lists below */
+	struct rb_root		root;		/* pending ranges by sector */
+	struct list_head	inflight;	/* issued ranges */
+	unsigned int		nr_pending;
+	unsigned int		nr_inflight;
+	wait_queue_head_t	wait;		/* for issued ranges to finish */
+	struct delayed_work	work;
+	unsigned int		max_sects;
+	unsigned long		interval;	/* in jiffies */
+};
+
+static inline sector_t range_end(struct blk_discard_range *r)
+{
+	return r->sector + r->nr_sects;
+}
+
+/*
+ * Pending ranges neither overlap nor touch each other, so they are sorted by
+ * their ends as well: return the first one ending at or after @sector.
+ */
+static struct blk_discard_range *__first_ending_after(
+			struct blk_discard_queue *dq, sector_t sector)
+{
+	struct rb_node *node = dq->root.rb_node;
+	struct blk_discard_range *r, *found = NULL;
+
+	while (node) {
+		r = rb_entry(node, struct blk_discard_range, rb_node);
+		if (range_end(r) >= sector) {
+			found = r;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+	return found;
+}
+
+static struct blk_discard_range *__next_range(struct blk_discard_range *r)
+{
+	struct rb_node *node = rb_next(&r->rb_node);
+
+	return node ? rb_entry(node, struct blk_discard_range, rb_node) : NULL;
+}
+
+static void __insert_range(struct blk_discard_queue *dq,
+			   struct blk_discard_range *new)
+{
+	struct rb_node **p = &dq->root.rb_node, *parent = NULL;
+	struct blk_discard_range *r;
+
+	while (*p) {
+		parent = *p;
+		r = rb_entry(parent, struct blk_discard_range, rb_node);
+		if (new->sector < r->sector)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+	rb_link_node(&new->rb_node, parent, p);
+	rb_insert_color(&new->rb_node, &dq->root);
+	dq->nr_pending++;
+}
+
+static void __erase_range(struct blk_discard_queue *dq,
+			  struct blk_discard_range *r)
+{
+	rb_erase(&r->rb_node, &dq->root);
+	dq->nr_pending--;
+}
+
+static void blk_discard_range_done(struct blk_discard_range *r)
+{
+	struct blk_discard_queue *dq = r->dq;
+	unsigned long flags;
+
+	/* wake under the lock: once a flusher sees the queue idle under
+	 * it, the queue may be freed
+	 */
+	spin_lock_irqsave(&dq->lock, flags);
+	list_del(&r->list);
+	dq->nr_inflight--;
+	wake_up_all(&dq->wait);
+	spin_unlock_irqrestore(&dq->lock, flags);
+
+	kfree(r);
+}
+
+static void blk_discard_end_io(struct bio *bio)
+{
+	struct blk_discard_range *r = bio->bi_private;
+
+	if (atomic_dec_and_test(&r->remaining))
+		blk_discard_range_done(r);
+	bio_put(bio);
+}
+
+static void blk_discard_submit(struct blk_discard_queue *dq,
+			       struct blk_discard_range *r)
+{
+	struct request_queue *q = bdev_get_queue(dq->bdev);
+	sector_t sector = r->sector, nr_sects = r->nr_sects;
+	unsigned int max_sects;
+
+	max_sects = min_t(unsigned int, q->limits.max_discard_sectors,
+			  UINT_MAX >> 9);
+	if (!max_sects)
+		max_sects = UINT_MAX >> 9;
+
+	atomic_set(&r->remaining, 1);
+	while (nr_sects) {
+		unsigned int req_sects = min_t(sector_t, nr_sects, max_sects);
+		struct bio *bio = bio_alloc(GFP_NOIO, 1);
+
+		bio->bi_iter.bi_sector = sector;
+		bio->bi_iter.bi_size = req_sects << 9;
+		bio->bi_bdev = dq->bdev;
+		bio->bi_end_io = blk_discard_end_io;
+		bio->bi_private = r;
+
+		atomic_inc(&r->remaining);
+		submit_bio(REQ_WRITE | REQ_DISCARD, bio);
+
+		sector += req_sects;
+		nr_sects -= req_sects;
+	}
+	if (atomic_dec_and_test(&r->remaining))
+		blk_discard_range_done(r);
+}
+
+/*
+ * Issue pending ranges in sector order, at least one and then until
+ * @max_sects sectors went out. Returns true if ranges are left pending.
+ */
+static bool blk_discard_issue(struct blk_discard_queue *dq, sector_t max_sects)
+{
+	struct blk_discard_range *r;
+	struct rb_node *node;
+	struct blk_plug plug;
+	sector_t issued = 0;
+	bool more;
+
+	blk_start_plug(&plug);
+	spin_lock_irq(&dq->lock);
+	while (issued < max_sects && (node = rb_first(&dq->root))) {
+		r = rb_entry(node, struct blk_discard_range, rb_node);
+		__erase_range(dq, r);
+		list_add_tail(&r->list, &dq->inflight);
+		dq->nr_inflight++;
+		spin_unlock_irq(&dq->lock);
+
+		issued += r->nr_sects;
+		blk_discard_submit(dq, r);
+		cond_resched();
+
+		spin_lock_irq(&dq->lock);
+	}
+	more = !RB_EMPTY_ROOT(&dq->root);
+	spin_unlock_irq(&dq->lock);
+	blk_finish_plug(&plug);
+
+	return more;
+}
+
+static void blk_discard_work(struct work_struct *work)
+{
+	struct blk_discard_queue *dq = container_of(to_delayed_work(work),
+					struct blk_discard_queue, work);
+
+	/* come back later if the disk is busy with other I/O */
+	if (part_in_flight(dq->bdev->bd_part) ||
+	    blk_discard_issue(dq, dq->max_sects))
+		kblockd_schedule_delayed_work(&dq->work, dq->interval);
+}
+
+/**
+ * blk_alloc_discard_queue - allocate a discard queue
+ * @bdev:	blockdev to issue discards for
+ * @gfp_mask:	memory allocation flags
+ *
+ * Description:
+ *    Returns ERR_PTR(-EOPNOTSUPP) if @bdev doesn't support discard.
+ */
+struct blk_discard_queue *blk_alloc_discard_queue(struct block_device *bdev,
+						  gfp_t gfp_mask)
+{
+	struct request_queue *q = bdev_get_queue(bdev);
+	struct blk_discard_queue *dq;
+
+	if (!q || !blk_queue_discard(q))
+		return ERR_PTR(-EOPNOTSUPP);
+
+	dq = kzalloc(sizeof(*dq), gfp_mask);
+	if (!dq)
+		return ERR_PTR(-ENOMEM);
+
+	dq->bdev = bdev;
+	spin_lock_init(&dq->lock);
+	dq->root = RB_ROOT;
+	INIT_LIST_HEAD(&dq->inflight);
+	init_waitqueue_head(&dq->wait);
+	INIT_DELAYED_WORK(&dq->work, blk_discard_work);
+	dq->max_sects = BLK_DISCARD_DEF_MAX_SECTS;
+	dq->interval = msecs_to_jiffies(BLK_DISCARD_DEF_INTERVAL);
+	return dq;
+}
+EXPORT_SYMBOL(blk_alloc_discard_queue);
+
+/**
+ * blk_free_discard_queue - flush and free a discard queue
+ * @dq:		the queue
+ */
+void blk_free_discard_queue(struct blk_discard_queue *dq)
+{
+	if (!dq)
+		return;
+
+	blk_discard_queue_flush(dq);
+	kfree(dq);
+}
+EXPORT_SYMBOL(blk_free_discard_queue);
+
+/**
+ * blk_discard_queue_set_rate - limit the rate of background discards
+ * @dq:		the queue
+ * @max_sects:	sectors to issue per pass, at least one range goes out
+ * @interval:	ms between passes, also the wait for the disk to go idle
+ */
+void blk_discard_queue_set_rate(struct blk_discard_queue *dq,
+				unsigned int max_sects, unsigned int interval)
+{
+	dq->max_sects = max(max_sects, 1U);
+	dq->interval = msecs_to_jiffies(interval);
+}
+EXPORT_SYMBOL(blk_discard_queue_set_rate);
+
+/**
+ * blk_discard_queue_add - queue a range for discard
+ * @dq:		the queue
+ * @sector:	start sector
+ * @nr_sects:	number of sectors to discard
+ * @gfp_mask:	memory allocation flags
+ *
+ * Description:
+ *    The range is merged with the pending ranges it overlaps or touches and
+ *    issued in the background. On failure nothing is queued and the caller
+ *    may issue the discard itself.
+ */
+int blk_discard_queue_add(struct blk_discard_queue *dq, sector_t sector,
+			  sector_t nr_sects, gfp_t gfp_mask)
+{
+	struct blk_discard_range *new, *r, *next;
+	sector_t end = sector + nr_sects;
+
+	if (!nr_sects)
+		return 0;
+
+	new = kmalloc(sizeof(*new), gfp_mask);
+	if (!new)
+		return -ENOMEM;
+
+	spin_lock_irq(&dq->lock);
+	for (r = __first_ending_after(dq, sector);
+	     r && r->sector <= end; r = next) {
+		next = __next_range(r);
+		sector = min(sector, r->sector);
+		end = max(end, range_end(r));
+		__erase_range(dq, r);
+		kfree(r);
+	}
+	new->sector = sector;
+	new->nr_sects = end - sector;
+	new->dq = dq;
+	__insert_range(dq, new);
+	spin_unlock_irq(&dq->lock);
+
+	if (!delayed_work_pending(&dq->work))
+		kblockd_schedule_delayed_work(&dq->work, dq->interval);
+	return 0;
+}
+EXPORT_SYMBOL(blk_discard_queue_add);
+
+static bool blk_discard_inflight(struct blk_discard_queue *dq,
+				 sector_t sector, sector_t end)
+{
+	struct blk_discard_range *r;
+	bool ret = false;
+
+	spin_lock_irq(&dq->lock);
+	list_for_each_entry(r, &dq->inflight, list) {
+		if (r->sector < end && range_end(r) > sector) {
+			ret = true;
+			break;
+		}
+	}
+	spin_unlock_irq(&dq->lock);
+	return ret;
+}
+
+static bool blk_discard_idle(struct blk_discard_queue *dq)
+{
+	bool ret;
+
+	spin_lock_irq(&dq->lock);
+	ret = !dq->nr_inflight;
+	spin_unlock_irq(&dq->lock);
+	return ret;
+}
+
+/**
+ * blk_discard_queue_cancel - make a range safe to write
+ * @dq:		the queue
+ * @sector:	start sector
+ * @nr_sects:	number of sectors
+ *
+ * Description:
+ *    Drops the range from the pending discards and waits for issued
+ *    discards overlapping it to complete. May sleep.
+ */
+void blk_discard_queue_cancel(struct blk_discard_queue *dq, sector_t sector,
+			      sector_t nr_sects)
+{
+	struct blk_discard_range *r, *next, *tail;
+	sector_t end = sector + nr_sects;
+
+	if (!READ_ONCE(dq->nr_pending) && !READ_ONCE(dq->nr_inflight))
+		return;
+
+	spin_lock_irq(&dq->lock);
+	for (r = __first_ending_after(dq, sector + 1);
+	     r && r->sector < end; r = next) {
+		next = __next_range(r);
+
+		if (r->sector < sector && range_end(r) > end) {
+			/* keep both sides, losing the tail is harmless */
+			tail = kmalloc(sizeof(*tail), GFP_ATOMIC);
+			if (tail) {
+				tail->sector = end;
+				tail->nr_sects = range_end(r) - end;
+				tail->dq = dq;
+				__insert_range(dq, tail);
+			}
+			r->nr_sects = sector - r->sector;
+			break;
+		} else if (r->sector < sector) {
+			r->nr_sects = sector - r->sector;
+		} else if (range_end(r) > end) {
+			r->nr_sects = range_end(r) - end;
+			r->sector = end;
+		} else {
+			__erase_range(dq, r);
+			kfree(r);
+		}
+	}
+	spin_unlock_irq(&dq->lock);
+
+	wait_event(dq->wait, !blk_discard_inflight(dq, sector, end));
+}
+EXPORT_SYMBOL(blk_discard_queue_cancel);
+
+/**
+ * blk_discard_queue_flush - issue all pending discards and wait for them
+ * @dq:		the queue
+ */
+void blk_discard_queue_flush(struct blk_discard_queue *dq)
+{
+	cancel_delayed_work_sync(&dq->work);
+	blk_discard_issue(dq, (sector_t)-1);
+	wait_event(dq->wait, blk_discard_idle(dq));
+}
+EXPORT_SYMBOL(blk_discard_queue_flush);
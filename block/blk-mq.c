@@ -19,8 +19,10 @@
 #include <linux/list_sort.h>
 #include <linux/cpu.h>
 #include <linux/cache.h>
+#include <linux/cacheinfo.h>
 #include <linux/sched/sysctl.h>
 #include <linux/delay.h>
+#include <linux/hrtimer.h>
 #include <linux/crash_dump.h>
 
 #include <trace/events/block.h>
@@ -306,9 +308,24 @@ void blk_mq_free_request(struct request *rq)
 }
 EXPORT_SYMBOL_GPL(blk_mq_free_request);
 
+/* Service time of requests on polled queues, as a moving average */
+static void blk_mq_poll_stat_add(struct request *rq)
+{
+	u64 *mean = &rq->q->poll_mean_ns[rq_data_dir(rq)];
+	u64 sample, old;
+
+	if (!rq->issue_time_ns)
+		return;
+
+	sample = ktime_get_ns() - rq->issue_time_ns;
+	old = READ_ONCE(*mean);
+	WRITE_ONCE(*mean, old ? old - (old >> 3) + (sample >> 3) : sample);
+}
+
 inline void __blk_mq_end_request(struct request *rq, int error)
 {
 	blk_account_io_done(rq);
+	blk_mq_poll_stat_add(rq);
 
 	if (rq->end_io) {
 		rq->end_io(rq, error);
@@ -328,6 +345,48 @@ void blk_mq_end_request(struct request *rq, int error)
 }
 EXPORT_SYMBOL(blk_mq_end_request);
 
+/*
+ * Hybrid polling: sleep through the first half of the expected service
+ * time instead of spinning on it, once per request. Returns true if it
+ * slept, so that the caller rechecks whether the request is done.
+ */
+bool blk_mq_poll_hybrid_sleep(struct request_queue *q,
+			      struct blk_mq_hw_ctx *hctx, unsigned int tag)
+{
+	struct hrtimer_sleeper hs;
+	struct request *rq;
+	u64 nsecs;
+
+	if (q->poll_nsec < 0)
+		return false;
+
+	rq = blk_mq_tag_to_rq(hctx->tags, tag);
+	if (!rq || test_and_set_bit(REQ_ATOM_POLL_SLEPT, &rq->atomic_flags))
+		return false;
+
+	if (q->poll_nsec > 0)
+		nsecs = q->poll_nsec;
+	else
+		nsecs = READ_ONCE(q->poll_mean_ns[rq_data_dir(rq)]) / 2;
+	if (!nsecs)
+		return false;
+
+	hrtimer_init_on_stack(&hs.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	hrtimer_set_expires(&hs.timer, ns_to_ktime(nsecs));
+	hrtimer_init_sleeper(&hs, current);
+
+	/* the completion waking us up ends the sleep early */
+	set_current_state(TASK_UNINTERRUPTIBLE);
+	hrtimer_start_expires(&hs.timer, HRTIMER_MODE_REL);
+	if (hs.task)
+		io_schedule();
+	hrtimer_cancel(&hs.timer);
+	__set_current_state(TASK_RUNNING);
+
+	destroy_hrtimer_on_stack(&hs.timer);
+	return true;
+}
+
 #ifdef CONFIG_PREEMPT_RT_FULL
 
 void __blk_mq_complete_request_remote_work(struct work_struct *work)
@@ -348,22 +407,52 @@ static void __blk_mq_complete_request_remote(void *data)
 
 #endif
 
+/*
+ * Whether @cpu and @other share the outermost cache reported by cacheinfo,
+ * e.g. the L2 of an ARM cluster. Falls back to the scheduler's LLC domains
+ * if there is no cache topology, or if it shows no sharing at all in which
+ * case it likely was not described.
+ */
+static bool blk_mq_cpus_share_cache(int cpu, int other)
+{
+	struct cpu_cacheinfo *cci = get_cpu_cacheinfo(cpu);
+	struct cacheinfo *llc;
+
+	if (cpu == other)
+		return true;
+
+	if (!cci || !cci->info_list || !cci->num_leaves)
+		return cpus_share_cache(cpu, other);
+
+	llc = &cci->info_list[cci->num_leaves - 1];
+	if (cpumask_weight(&llc->shared_cpu_map) <= 1)
+		return cpus_share_cache(cpu, other);
+
+	return cpumask_test_cpu(other, &llc->shared_cpu_map);
+}
+
 static void blk_mq_ipi_complete_request(struct request *rq)
 {
 	struct blk_mq_ctx *ctx = rq->mq_ctx;
+	bool batch = test_bit(QUEUE_FLAG_COMP_BATCH, &rq->q->queue_flags);
 	bool shared = false;
 	int cpu;
 
 	if (!test_bit(QUEUE_FLAG_SAME_COMP, &rq->q->queue_flags)) {
-		rq->q->softirq_done_fn(rq);
+		if (batch)
+			blk_mq_batch_complete(rq, raw_smp_processor_id());
+		else
+			rq->q->softirq_done_fn(rq);
 		return;
 	}
 
 	cpu = get_cpu_light();
 	if (!test_bit(QUEUE_FLAG_SAME_FORCE, &rq->q->queue_flags))
-		shared = cpus_share_cache(cpu, ctx->cpu);
+		shared = blk_mq_cpus_share_cache(cpu, ctx->cpu);
 
-	if (cpu != ctx->cpu && !shared && cpu_online(ctx->cpu)) {
+	if (batch) {
+		blk_mq_batch_complete(rq, shared ? cpu : ctx->cpu);
+	} else if (cpu != ctx->cpu && !shared && cpu_online(ctx->cpu)) {
 #ifdef CONFIG_PREEMPT_RT_FULL
 		schedule_work_on(ctx->cpu, &rq->work);
 #else
@@ -443,6 +532,11 @@ void blk_mq_start_request(struct request *rq)
 		set_bit(REQ_ATOM_STARTED, &rq->atomic_flags);
 	if (test_bit(REQ_ATOM_COMPLETE, &rq->atomic_flags))
 		clear_bit(REQ_ATOM_COMPLETE, &rq->atomic_flags);
+	if (test_bit(REQ_ATOM_POLL_SLEPT, &rq->atomic_flags))
+		clear_bit(REQ_ATOM_POLL_SLEPT, &rq->atomic_flags);
+
+	rq->issue_time_ns = test_bit(QUEUE_FLAG_POLL, &q->queue_flags) ?
+			    ktime_get_ns() : 0;
 
 	if (q->dma_drain_size && blk_rq_bytes(rq)) {
 		/*
@@ -881,7 +975,12 @@ void blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx, bool async)
 	    !blk_mq_hw_queue_mapped(hctx)))
 		return;
 
-	if (!async) {
+	/*
+	 * A blocking driver can't be called with preemption disabled, punt
+	 * to kblockd. Sync submitters still reach it directly through
+	 * blk_mq_direct_issue_request().
+	 */
+	if (!async && !(hctx->flags & BLK_MQ_F_BLOCKING)) {
 		int cpu = get_cpu_light();
 		if (cpumask_test_cpu(cpu, hctx->cpumask)) {
 			__blk_mq_run_hw_queue(hctx);
@@ -2061,7 +2160,11 @@ struct request_queue *blk_mq_init_allocated_queue(struct blk_mq_tag_set *set,
 	INIT_LIST_HEAD(&q->requeue_list);
 	spin_lock_init(&q->requeue_lock);
 
-	if (q->nr_hw_queues > 1)
+	/*
+	 * blk_sq_make_request() never issues directly, so blocking drivers
+	 * get the multi queue variant to let sync IO skip the kblockd hop.
+	 */
+	if (q->nr_hw_queues > 1 || (set->flags & BLK_MQ_F_BLOCKING))
 		blk_queue_make_request(q, blk_mq_make_request);
 	else
 		blk_queue_make_request(q, blk_sq_make_request);
@@ -30,6 +30,8 @@ void blk_mq_freeze_queue(struct request_queue *q);
 void blk_mq_free_queue(struct request_queue *q);
 int blk_mq_update_nr_requests(struct request_queue *q, unsigned int nr);
 void blk_mq_wake_waiters(struct request_queue *q);
+bool blk_mq_poll_hybrid_sleep(struct request_queue *q,
+			      struct blk_mq_hw_ctx *hctx, unsigned int tag);
 
 /*
  * CPU hotplug helpers
@@ -14,6 +14,11 @@
 
 static DEFINE_PER_CPU(struct list_head, blk_cpu_done);
 
+/* blk-mq requests batched for completion, see blk_mq_batch_complete() */
+static DEFINE_PER_CPU(struct llist_head, blk_mq_cpu_done);
+static DEFINE_PER_CPU(struct call_single_data, blk_mq_done_csd);
+static DEFINE_PER_CPU(unsigned long, blk_mq_done_ipi);	/* IPI in flight */
+
 /*
  * Softirq action handler - move entries to local list and loop over them
  * while passing them to the queue registered handler.
@@ -34,6 +39,47 @@ static void blk_done_softirq(struct softirq_action *h)
 		list_del_init(&rq->ipi_list);
 		rq->q->softirq_done_fn(rq);
 	}
+
+	if (!llist_empty(this_cpu_ptr(&blk_mq_cpu_done))) {
+		struct llist_node *node;
+		struct request *rq, *next;
+
+		node = llist_del_all(this_cpu_ptr(&blk_mq_cpu_done));
+		node = llist_reverse_order(node);
+		llist_for_each_entry_safe(rq, next, node, csd.llist)
+			rq->q->softirq_done_fn(rq);
+	}
+}
+
+static void blk_mq_done_ipi_fn(void *data)
+{
+	clear_bit(0, this_cpu_ptr(&blk_mq_done_ipi));
+	raise_softirq_irqoff(BLOCK_SOFTIRQ);
+}
+
+/*
+ * Complete @rq from BLOCK_SOFTIRQ on @cpu. Requests completed until the
+ * softirq runs are batched into that one run, and a remote @cpu is sent
+ * at most one IPI per batch. The request's csd is not used for an IPI
+ * here, its llist node links the request into the batch.
+ */
+void blk_mq_batch_complete(struct request *rq, int cpu)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	if (!cpu_online(cpu))
+		cpu = smp_processor_id();
+
+	if (llist_add(&rq->csd.llist, &per_cpu(blk_mq_cpu_done, cpu))) {
+		if (cpu == smp_processor_id())
+			raise_softirq_irqoff(BLOCK_SOFTIRQ);
+		else if (!test_and_set_bit(0, &per_cpu(blk_mq_done_ipi, cpu)))
+			smp_call_function_single_async(cpu,
+					&per_cpu(blk_mq_done_csd, cpu));
+	}
+	local_irq_restore(flags);
+	preempt_check_resched_rt();
 }
 
 #ifdef CONFIG_SMP
@@ -88,10 +134,21 @@ static int blk_cpu_notify(struct notifier_block *self, unsigned long action,
 	 */
 	if (action == CPU_DEAD || action == CPU_DEAD_FROZEN) {
 		int cpu = (unsigned long) hcpu;
+		struct llist_node *node;
 
 		local_irq_disable();
 		list_splice_init(&per_cpu(blk_cpu_done, cpu),
 				 this_cpu_ptr(&blk_cpu_done));
+		node = llist_del_all(&per_cpu(blk_mq_cpu_done, cpu));
+		if (node) {
+			struct llist_node *last = node;
+
+			while (last->next)
+				last = last->next;
+			llist_add_batch(node, last,
+					this_cpu_ptr(&blk_mq_cpu_done));
+		}
+		clear_bit(0, &per_cpu(blk_mq_done_ipi, cpu));
 		raise_softirq_irqoff(BLOCK_SOFTIRQ);
 		local_irq_enable();
 		preempt_check_resched_rt();
@@ -179,8 +236,11 @@ static __init int blk_softirq_init(void)
 {
 	int i;
 
-	for_each_possible_cpu(i)
+	for_each_possible_cpu(i) {
 		INIT_LIST_HEAD(&per_cpu(blk_cpu_done, i));
+		init_llist_head(&per_cpu(blk_mq_cpu_done, i));
+		per_cpu(blk_mq_done_csd, i).func = blk_mq_done_ipi_fn;
+	}
 
 	open_softirq(BLOCK_SOFTIRQ, blk_done_softirq);
 	register_hotcpu_notifier(&blk_cpu_notifier);
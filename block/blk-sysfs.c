@@ -293,17 +293,8 @@ static ssize_t queue_rq_affinity_show(struct request_queue *q, char *page)
 	return queue_var_show(set << force, page);
 }
 
-static ssize_t
-queue_rq_affinity_store(struct request_queue *q, const char *page, size_t count)
+static void queue_set_rq_affinity(struct request_queue *q, unsigned long val)
 {
-	ssize_t ret = -EINVAL;
-#ifdef CONFIG_SMP
-	unsigned long val;
-
-	ret = queue_var_store(&val, page, count);
-	if (ret < 0)
-		return ret;
-
 	spin_lock_irq(q->queue_lock);
 	if (val == 2) {
 		queue_flag_set(QUEUE_FLAG_SAME_COMP, q);
@@ -316,10 +307,92 @@ queue_rq_affinity_store(struct request_queue *q, const char *page, size_t count)
 		queue_flag_clear(QUEUE_FLAG_SAME_FORCE, q);
 	}
 	spin_unlock_irq(q->queue_lock);
+}
+
+static ssize_t
+queue_rq_affinity_store(struct request_queue *q, const char *page, size_t count)
+{
+	ssize_t ret = -EINVAL;
+#ifdef CONFIG_SMP
+	unsigned long val;
+
+	ret = queue_var_store(&val, page, count);
+	if (ret < 0)
+		return ret;
+
+	queue_set_rq_affinity(q, val);
+#endif
+	return ret;
+}
+
+/*
+ * Where requests complete, the same as rq_affinity 0, 1 and 2: on the CPU
+ * taking the interrupt, there if it shares a cache with the submitting CPU,
+ * or always on the submitting CPU.
+ */
+static const char *const queue_comp_policies[] = {
+	"local", "cluster", "remote",
+};
+
+static ssize_t queue_comp_policy_show(struct request_queue *q, char *page)
+{
+	bool set = test_bit(QUEUE_FLAG_SAME_COMP, &q->queue_flags);
+	bool force = test_bit(QUEUE_FLAG_SAME_FORCE, &q->queue_flags);
+
+	return sprintf(page, "%s\n", queue_comp_policies[set + force]);
+}
+
+static ssize_t
+queue_comp_policy_store(struct request_queue *q, const char *page, size_t count)
+{
+	ssize_t ret = -EINVAL;
+#ifdef CONFIG_SMP
+	char val[8];
+	int i;
+
+	if (sscanf(page, "%7s", val) != 1)
+		return -EINVAL;
+
+	for (i = 0; i < ARRAY_SIZE(queue_comp_policies); i++) {
+		if (!strcmp(val, queue_comp_policies[i])) {
+			queue_set_rq_affinity(q, i);
+			ret = count;
+			break;
+		}
+	}
 #endif
 	return ret;
 }
 
+static ssize_t queue_comp_batch_show(struct request_queue *q, char *page)
+{
+	return queue_var_show(test_bit(QUEUE_FLAG_COMP_BATCH, &q->queue_flags),
+			      page);
+}
+
+static ssize_t queue_comp_batch_store(struct request_queue *q,
+				      const char *page, size_t count)
+{
+	unsigned long val;
+	ssize_t ret;
+
+	if (!q->mq_ops)
+		return -EINVAL;
+
+	ret = queue_var_store(&val, page, count);
+	if (ret < 0)
+		return ret;
+
+	spin_lock_irq(q->queue_lock);
+	if (val)
+		queue_flag_set(QUEUE_FLAG_COMP_BATCH, q);
+	else
+		queue_flag_clear(QUEUE_FLAG_COMP_BATCH, q);
+	spin_unlock_irq(q->queue_lock);
+
+	return ret;
+}
+
 static ssize_t queue_poll_show(struct request_queue *q, char *page)
 {
 	return queue_var_show(test_bit(QUEUE_FLAG_POLL, &q->queue_flags), page);
@@ -348,6 +421,36 @@ static ssize_t queue_poll_store(struct request_queue *q, const char *page,
 	return ret;
 }
 
+static ssize_t queue_poll_delay_show(struct request_queue *q, char *page)
+{
+	int val = q->poll_nsec;
+
+	if (val > 0)
+		val /= NSEC_PER_USEC;
+
+	return sprintf(page, "%d\n", val);
+}
+
+static ssize_t queue_poll_delay_store(struct request_queue *q,
+				      const char *page, size_t count)
+{
+	int err, val;
+
+	if (!q->mq_ops || !q->mq_ops->poll)
+		return -EINVAL;
+
+	err = kstrtoint(page, 10, &val);
+	if (err < 0)
+		return err;
+
+	if (val < -1 || val > INT_MAX / NSEC_PER_USEC)
+		return -EINVAL;
+
+	q->poll_nsec = val > 0 ? val * NSEC_PER_USEC : val;
+
+	return count;
+}
+
 static struct queue_sysfs_entry queue_requests_entry = {
 	.attr = {.name = "nr_requests", .mode = S_IRUGO | S_IWUSR },
 	.show = queue_requests_show,
@@ -461,6 +564,18 @@ static struct queue_sysfs_entry queue_rq_affinity_entry = {
 	.store = queue_rq_affinity_store,
 };
 
+static struct queue_sysfs_entry queue_comp_policy_entry = {
+	.attr = {.name = "completion_policy", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_comp_policy_show,
+	.store = queue_comp_policy_store,
+};
+
+static struct queue_sysfs_entry queue_comp_batch_entry = {
+	.attr = {.name = "completion_batch", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_comp_batch_show,
+	.store = queue_comp_batch_store,
+};
+
 static struct queue_sysfs_entry queue_iostats_entry = {
 	.attr = {.name = "iostats", .mode = S_IRUGO | S_IWUSR },
 	.show = queue_show_iostats,
@@ -479,6 +594,12 @@ static struct queue_sysfs_entry queue_poll_entry = {
 	.store = queue_poll_store,
 };
 
+static struct queue_sysfs_entry queue_poll_delay_entry = {
+	.attr = {.name = "io_poll_delay", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_poll_delay_show,
+	.store = queue_poll_delay_store,
+};
+
 static struct attribute *default_attrs[] = {
 	&queue_requests_entry.attr,
 	&queue_ra_entry.attr,
@@ -501,9 +622,12 @@ static struct attribute *default_attrs[] = {
 	&queue_nonrot_entry.attr,
 	&queue_nomerges_entry.attr,
 	&queue_rq_affinity_entry.attr,
+	&queue_comp_policy_entry.attr,
+	&queue_comp_batch_entry.attr,
 	&queue_iostats_entry.attr,
 	&queue_random_entry.attr,
 	&queue_poll_entry.attr,
+	&queue_poll_delay_entry.attr,
 	NULL,
 };
 
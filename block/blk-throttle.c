@@ -21,6 +21,20 @@ static int throtl_quantum = 32;
 /* Throttling is performed over 100ms slice and after that slice is renewed */
 static unsigned long throtl_slice = HZ/10;	/* 100 ms */
 
+/*
+ * Latency targets are checked every throtl_slice. If more than
+ * THROTL_LAT_MISS_PCT% of the bios of protected groups completed later than
+ * their target, the iops of all other groups on the device is cut in half,
+ * down to THROTL_LAT_MIN_IOPS. Each window without misses gives a quarter
+ * back, and THROTL_LAT_RECOVER_WINDOWS of them in a row lift the limit.
+ */
+#define THROTL_LAT_MISS_PCT		10
+#define THROTL_LAT_MIN_IOPS		8
+#define THROTL_LAT_RECOVER_WINDOWS	10
+
+/* completion latency histogram, bucket i counts [2^i, 2^(i+1)) usecs */
+#define THROTL_LAT_BUCKETS		24
+
 static struct blkcg_policy blkcg_policy_throtl;
 
 /* A workqueue to queue throttle related work */
@@ -133,6 +147,10 @@ struct throtl_grp {
 	/* When did we start a new slice */
 	unsigned long slice_start[2];
 	unsigned long slice_end[2];
+
+	/* completion latency target in usecs, -1 if not protected */
+	unsigned int latency_target;
+	atomic_long_t lat_hist[THROTL_LAT_BUCKETS];
 };
 
 struct throtl_data
@@ -152,6 +170,15 @@ struct throtl_data
 
 	/* Work for dispatching throttled bios */
 	struct work_struct dispatch_work;
+
+	/* latency targets, see THROTL_LAT_MISS_PCT */
+	bool lat_enabled;		/* a target was set on this queue */
+	unsigned long lat_window_end;
+	atomic_t lat_nr;		/* protected bios completed */
+	atomic_t lat_missed;		/* of which missed their target */
+	atomic_t lat_unprot_nr;		/* unprotected bios issued */
+	unsigned int lat_iops;		/* limit of the others, 0 if none */
+	unsigned int lat_good_windows;
 };
 
 static void throtl_pending_timer_fn(unsigned long arg);
@@ -344,6 +371,7 @@ static struct blkg_policy_data *throtl_pd_alloc(gfp_t gfp, int node)
 	tg->bps[WRITE] = -1;
 	tg->iops[READ] = -1;
 	tg->iops[WRITE] = -1;
+	tg->latency_target = -1;
 
 	return &tg->pd;
 }
@@ -597,6 +625,26 @@ static inline void throtl_extend_slice(struct throtl_grp *tg, bool rw,
 		   tg->slice_end[rw], jiffies);
 }
 
+/*
+ * The iops limit of @tg for @bio, lowered while a protected group misses its
+ * latency target unless @bio comes from a protected group. Without @bio,
+ * the limit for the own bios of @tg.
+ */
+static unsigned int tg_iops(struct throtl_grp *tg, struct bio *bio, bool rw)
+{
+	unsigned int lat_iops = tg->td->lat_iops;
+	bool protected;
+
+	if (bio)
+		protected = bio->bi_throtl_blkg;
+	else
+		protected = tg->latency_target != -1;
+
+	if (!lat_iops || protected)
+		return tg->iops[rw];
+	return min(tg->iops[rw], lat_iops);
+}
+
 /* Determine if previously allocated or extended slice is complete or not */
 static bool throtl_slice_used(struct throtl_grp *tg, bool rw)
 {
@@ -642,7 +690,7 @@ static inline void throtl_trim_slice(struct throtl_grp *tg, bool rw)
 	do_div(tmp, HZ);
 	bytes_trim = tmp;
 
-	io_trim = (tg->iops[rw] * throtl_slice * nr_slices)/HZ;
+	io_trim = (tg_iops(tg, NULL, rw) * throtl_slice * nr_slices)/HZ;
 
 	if (!bytes_trim && !io_trim)
 		return;
@@ -669,6 +717,7 @@ static bool tg_with_in_iops_limit(struct throtl_grp *tg, struct bio *bio,
 				  unsigned long *wait)
 {
 	bool rw = bio_data_dir(bio);
+	unsigned int iops = tg_iops(tg, bio, rw);
 	unsigned int io_allowed;
 	unsigned long jiffy_elapsed, jiffy_wait, jiffy_elapsed_rnd;
 	u64 tmp;
@@ -688,7 +737,7 @@ static bool tg_with_in_iops_limit(struct throtl_grp *tg, struct bio *bio,
 	 * have been trimmed.
 	 */
 
-	tmp = (u64)tg->iops[rw] * jiffy_elapsed_rnd;
+	tmp = (u64)iops * jiffy_elapsed_rnd;
 	do_div(tmp, HZ);
 
 	if (tmp > UINT_MAX)
@@ -703,7 +752,7 @@ static bool tg_with_in_iops_limit(struct throtl_grp *tg, struct bio *bio,
 	}
 
 	/* Calc approx time to dispatch */
-	jiffy_wait = ((tg->io_disp[rw] + 1) * HZ)/tg->iops[rw] + 1;
+	jiffy_wait = ((tg->io_disp[rw] + 1) * HZ)/iops + 1;
 
 	if (jiffy_wait > jiffy_elapsed)
 		jiffy_wait = jiffy_wait - jiffy_elapsed;
@@ -777,7 +826,7 @@ static bool tg_may_dispatch(struct throtl_grp *tg, struct bio *bio,
 	       bio != throtl_peek_queued(&tg->service_queue.queued[rw]));
 
 	/* If tg->bps = -1, then BW is unlimited */
-	if (tg->bps[rw] == -1 && tg->iops[rw] == -1) {
+	if (tg->bps[rw] == -1 && tg_iops(tg, bio, rw) == -1) {
 		if (wait)
 			*wait = 0;
 		return true;
@@ -1151,9 +1200,12 @@ static void tg_conf_updated(struct throtl_grp *tg)
 	struct blkcg_gq *blkg;
 
 	throtl_log(&tg->service_queue,
-		   "limit change rbps=%llu wbps=%llu riops=%u wiops=%u",
+		   "limit change rbps=%llu wbps=%llu riops=%u wiops=%u lat=%u",
 		   tg->bps[READ], tg->bps[WRITE],
-		   tg->iops[READ], tg->iops[WRITE]);
+		   tg->iops[READ], tg->iops[WRITE], tg->latency_target);
+
+	if (tg->latency_target != -1)
+		tg->td->lat_enabled = true;
 
 	/*
 	 * Update has_rules[] flags for the updated tg's subtree.  A tg is
@@ -1227,6 +1279,47 @@ static ssize_t tg_set_conf_uint(struct kernfs_open_file *of,
 	return tg_set_conf(of, buf, nbytes, off, false);
 }
 
+/*
+ * Print the 50th, 90th and 99th percentile of the completion latency as the
+ * upper bound in usecs of the histogram bucket they fall in.
+ */
+static u64 tg_prfill_latency(struct seq_file *sf, struct blkg_policy_data *pd,
+			     int off)
+{
+	static const unsigned int pcts[] = { 50, 90, 99 };
+	struct throtl_grp *tg = pd_to_tg(pd);
+	const char *dname = blkg_dev_name(pd->blkg);
+	unsigned long hist[THROTL_LAT_BUCKETS];
+	unsigned long total = 0, sum;
+	int i, b;
+
+	if (!dname)
+		return 0;
+
+	for (i = 0; i < THROTL_LAT_BUCKETS; i++) {
+		hist[i] = atomic_long_read(&tg->lat_hist[i]);
+		total += hist[i];
+	}
+	if (!total)
+		return 0;
+
+	seq_printf(sf, "%s", dname);
+	for (i = 0, b = 0, sum = hist[0]; i < ARRAY_SIZE(pcts); i++) {
+		while (sum * 100 < total * pcts[i])
+			sum += hist[++b];
+		seq_printf(sf, " p%u=%lu", pcts[i], 2UL << b);
+	}
+	seq_printf(sf, " nr=%lu\n", total);
+	return 0;
+}
+
+static int tg_print_latency(struct seq_file *sf, void *v)
+{
+	blkcg_print_blkgs(sf, css_to_blkcg(seq_css(sf)), tg_prfill_latency,
+			  &blkcg_policy_throtl, 0, false);
+	return 0;
+}
+
 static struct cftype throtl_legacy_files[] = {
 	{
 		.name = "throttle.read_bps_device",
@@ -1252,6 +1345,16 @@ static struct cftype throtl_legacy_files[] = {
 		.seq_show = tg_print_conf_uint,
 		.write = tg_set_conf_uint,
 	},
+	{
+		.name = "throttle.latency_target_usec",
+		.private = offsetof(struct throtl_grp, latency_target),
+		.seq_show = tg_print_conf_uint,
+		.write = tg_set_conf_uint,
+	},
+	{
+		.name = "throttle.latency",
+		.seq_show = tg_print_latency,
+	},
 	{
 		.name = "throttle.io_service_bytes",
 		.private = (unsigned long)&blkcg_policy_throtl,
@@ -1373,6 +1476,18 @@ static struct cftype throtl_files[] = {
 		.seq_show = tg_print_max,
 		.write = tg_set_max,
 	},
+	{
+		.name = "latency_target",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.private = offsetof(struct throtl_grp, latency_target),
+		.seq_show = tg_print_conf_uint,
+		.write = tg_set_conf_uint,
+	},
+	{
+		.name = "latency",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = tg_print_latency,
+	},
 	{ }	/* terminate */
 };
 
@@ -1393,6 +1508,78 @@ static struct blkcg_policy blkcg_policy_throtl = {
 	.pd_free_fn		= throtl_pd_free,
 };
 
+/* Open a new latency window and adjust the others' limit to the last one */
+static void throtl_update_latency(struct throtl_data *td)
+{
+	unsigned int nr = atomic_xchg(&td->lat_nr, 0);
+	unsigned int missed = atomic_xchg(&td->lat_missed, 0);
+	unsigned int unprot_nr = atomic_xchg(&td->lat_unprot_nr, 0);
+	unsigned long elapsed = jiffies - td->lat_window_end + throtl_slice;
+
+	td->lat_window_end = jiffies + throtl_slice;
+
+	if (nr && missed * 100 > nr * THROTL_LAT_MISS_PCT) {
+		/* first time around, start from what the others issued */
+		if (!td->lat_iops)
+			td->lat_iops = min_t(u64, UINT_MAX - 1,
+					     div_u64((u64)unprot_nr * HZ,
+						     max(elapsed, 1UL)));
+		td->lat_iops = max_t(unsigned int, td->lat_iops / 2,
+				     THROTL_LAT_MIN_IOPS);
+		td->lat_good_windows = 0;
+	} else if (td->lat_iops) {
+		if (++td->lat_good_windows >= THROTL_LAT_RECOVER_WINDOWS)
+			td->lat_iops = 0;
+		else
+			td->lat_iops += td->lat_iops / 4 + 1;
+	}
+
+	throtl_log(&td->service_queue, "latency nr=%u missed=%u iops=%u",
+		   nr, missed, td->lat_iops);
+}
+
+static bool throtl_latency_due(struct throtl_data *td)
+{
+	return td->lat_enabled &&
+	       (td->lat_iops || time_after_eq(jiffies, td->lat_window_end));
+}
+
+/* Remember when @bio of the protected @tg was issued */
+static void throtl_track_latency(struct throtl_grp *tg, struct bio *bio)
+{
+	struct blkcg_gq *blkg = tg_to_blkg(tg);
+
+	if (bio->bi_throtl_blkg)
+		return;
+
+	blkg_get(blkg);
+	bio->bi_throtl_blkg = blkg;
+	bio->bi_throtl_issue_ns = ktime_get_ns();
+}
+
+void blk_throtl_bio_endio(struct bio *bio)
+{
+	struct blkcg_gq *blkg = bio->bi_throtl_blkg;
+	struct throtl_grp *tg;
+	u64 lat;
+
+	if (!blkg)
+		return;
+
+	bio->bi_throtl_blkg = NULL;
+	tg = blkg_to_tg(blkg);
+	if (tg) {
+		lat = div_u64(ktime_get_ns() - bio->bi_throtl_issue_ns,
+			      NSEC_PER_USEC);
+		atomic_long_inc(&tg->lat_hist[lat ?
+			min_t(int, ilog2(lat), THROTL_LAT_BUCKETS - 1) : 0]);
+		atomic_inc(&tg->td->lat_nr);
+		if (lat > tg->latency_target)
+			atomic_inc(&tg->td->lat_missed);
+	}
+	blkg_put(blkg);
+}
+
 bool blk_throtl_bio(struct request_queue *q, struct blkcg_gq *blkg,
 		    struct bio *bio)
 {
@@ -1405,7 +1592,15 @@ bool blk_throtl_bio(struct request_queue *q, struct blkcg_gq *blkg,
 	WARN_ON_ONCE(!rcu_read_lock_held());
 
 	/* see throtl_charge_bio() */
-	if ((bio->bi_rw & REQ_THROTTLED) || !tg->has_rules[rw])
+	if (bio->bi_rw & REQ_THROTTLED)
+		goto out;
+
+	if (tg->latency_target != -1)
+		throtl_track_latency(tg, bio);
+	else if (tg->td->lat_enabled)
+		atomic_inc(&tg->td->lat_unprot_nr);
+
+	if (!tg->has_rules[rw] && !throtl_latency_due(tg->td))
 		goto out;
 
 	spin_lock_irq(q->queue_lock);
@@ -1413,6 +1608,9 @@ bool blk_throtl_bio(struct request_queue *q, struct blkcg_gq *blkg,
 	if (unlikely(blk_queue_bypass(q)))
 		goto out_unlock;
 
+	if (time_after_eq(jiffies, tg->td->lat_window_end))
+		throtl_update_latency(tg->td);
+
 	sq = &tg->service_queue;
 
 	while (true) {
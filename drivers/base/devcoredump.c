@@ -205,6 +205,50 @@ void dev_coredumpv(struct device *dev, const void *data, size_t datalen,
 }
 EXPORT_SYMBOL_GPL(dev_coredumpv);
 
+static void devcd_free_sgtable(const void *data)
+{
+	_devcd_free_sgtable((struct scatterlist *)data);
+}
+
+static ssize_t devcd_read_from_sgtable(char *buffer, loff_t offset,
+				       size_t count, const void *data,
+				       size_t datalen)
+{
+	struct scatterlist *table = (struct scatterlist *)data;
+
+	if (offset > datalen)
+		return -EINVAL;
+
+	if (offset + count > datalen)
+		count = datalen - offset;
+
+	return sg_pcopy_to_buffer(table, sg_nents(table), buffer, count,
+				  offset);
+}
+
+/**
+ * dev_coredumpsg - create device coredump that uses scatterlist as data
+ * parameter
+ * @dev: the struct device for the crashed device
+ * @table: the dump data
+ * @datalen: length of the data
+ * @gfp: allocation flags
+ *
+ * Creates a new device coredump for the given device. If a previous one hasn't
+ * been read yet, the new coredump is discarded. The data lifetime is determined
+ * by the device coredump framework and when it is no longer needed
+ * it will free the data. The data is gathered page by page, so no large
+ * contiguous or vmalloc buffer is needed, and reads copy straight out of the
+ * pages.
+ */
+void dev_coredumpsg(struct device *dev, struct scatterlist *table,
+		    size_t datalen, gfp_t gfp)
+{
+	dev_coredumpm(dev, NULL, table, datalen, gfp, devcd_read_from_sgtable,
+		      devcd_free_sgtable);
+}
+EXPORT_SYMBOL_GPL(dev_coredumpsg);
+
 static int devcd_match_failing(struct device *dev, const void *failing)
 {
 	struct devcd_entry *devcd = dev_to_devcd(dev);
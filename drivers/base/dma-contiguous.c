@@ -27,6 +27,12 @@
 #include <linux/sizes.h>
 #include <linux/dma-contiguous.h>
 #include <linux/cma.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #ifdef CONFIG_CMA_SIZE_MBYTES
 #define CMA_SIZE_MBYTES CONFIG_CMA_SIZE_MBYTES
@@ -36,6 +42,34 @@
 
 struct cma *dma_contiguous_default_area;
 
+/* Allocation latency buckets: < 1us, then [2^(i-1), 2^i) us */
+#define DMA_CONTIGUOUS_LAT_BUCKETS	21
+
+/*
+ * cma_alloc() migrates movable pages out of the area on demand, which can
+ * take a very long time. An area may keep a few chunks allocated ahead of
+ * time, already migrated, to serve allocations that fit in a chunk right
+ * away. The pool is refilled up to its low watermark in the background.
+ */
+struct dma_contiguous_pool {
+	struct cma *cma;
+	char name[32];
+
+	spinlock_t lock;		/* protects chunks and nr_chunks */
+	struct page **chunks;
+	unsigned int nr_chunks;
+	unsigned int low_wm;
+	unsigned int chunk_order;
+	struct work_struct refill_work;
+
+	atomic_long_t hits;
+	atomic_long_t misses;
+	atomic_long_t lat[DMA_CONTIGUOUS_LAT_BUCKETS];
+};
+
+static struct dma_contiguous_pool dma_contiguous_pools[MAX_CMA_AREAS];
+static unsigned int dma_contiguous_pool_count;
+
 /*
  * Default global CMA area size can be defined in kernel's .config.
  * This is useful mainly for distro maintainers to create a kernel
@@ -95,6 +129,111 @@ static inline __maybe_unused phys_addr_t cma_early_percent_memory(void)
 
 #endif
 
+static void dma_contiguous_pool_refill(struct work_struct *work);
+
+static struct dma_contiguous_pool * __init
+dma_contiguous_pool_register(struct cma *cma, const char *name)
+{
+	struct dma_contiguous_pool *pool;
+
+	if (dma_contiguous_pool_count >= ARRAY_SIZE(dma_contiguous_pools))
+		return NULL;
+
+	pool = &dma_contiguous_pools[dma_contiguous_pool_count];
+	pool->cma = cma;
+	if (name)
+		strlcpy(pool->name, name, sizeof(pool->name));
+	else if (cma == dma_contiguous_default_area)
+		strlcpy(pool->name, "default", sizeof(pool->name));
+	else
+		snprintf(pool->name, sizeof(pool->name), "cma%u",
+			 dma_contiguous_pool_count);
+	spin_lock_init(&pool->lock);
+	INIT_WORK(&pool->refill_work, dma_contiguous_pool_refill);
+	dma_contiguous_pool_count++;
+
+	return pool;
+}
+
+static struct dma_contiguous_pool *dma_contiguous_find_pool(struct cma *cma)
+{
+	unsigned int i;
+
+	for (i = 0; i < dma_contiguous_pool_count; i++)
+		if (dma_contiguous_pools[i].cma == cma)
+			return &dma_contiguous_pools[i];
+
+	return NULL;
+}
+
+static unsigned int dma_contiguous_chunk_align(struct dma_contiguous_pool *pool)
+{
+	return min_t(unsigned int, pool->chunk_order, CONFIG_CMA_ALIGNMENT);
+}
+
+static void dma_contiguous_pool_refill(struct work_struct *work)
+{
+	struct dma_contiguous_pool *pool =
+		container_of(work, struct dma_contiguous_pool, refill_work);
+	size_t chunk = 1UL << pool->chunk_order;
+	struct page *page;
+	bool full;
+
+	for (;;) {
+		spin_lock(&pool->lock);
+		full = pool->nr_chunks >= pool->low_wm;
+		spin_unlock(&pool->lock);
+		if (full)
+			break;
+
+		/* a busy area is tried again on the next allocation */
+		page = cma_alloc(pool->cma, chunk,
+				 dma_contiguous_chunk_align(pool));
+		if (!page)
+			break;
+
+		spin_lock(&pool->lock);
+		pool->chunks[pool->nr_chunks++] = page;
+		spin_unlock(&pool->lock);
+	}
+}
+
+static struct page *dma_contiguous_pool_take(struct dma_contiguous_pool *pool,
+					     size_t count, unsigned int align)
+{
+	size_t chunk = 1UL << pool->chunk_order;
+	struct page *page = NULL;
+
+	if (count > chunk || align > dma_contiguous_chunk_align(pool))
+		return NULL;
+
+	spin_lock(&pool->lock);
+	if (pool->chunks) {
+		if (pool->nr_chunks)
+			page = pool->chunks[--pool->nr_chunks];
+		queue_work(system_unbound_wq, &pool->refill_work);
+	}
+	spin_unlock(&pool->lock);
+
+	/* The chunk is aligned to its size, give back what is not needed */
+	if (page && count < chunk)
+		cma_release(pool->cma, nth_page(page, count), chunk - count);
+
+	return page;
+}
+
+static void dma_contiguous_account(struct dma_contiguous_pool *pool,
+				   ktime_t start, bool hit)
+{
+	u64 us = ktime_us_delta(ktime_get(), start);
+	unsigned int bucket;
+
+	bucket = us ? min_t(unsigned int, ilog2(us) + 1,
+			    DMA_CONTIGUOUS_LAT_BUCKETS - 1) : 0;
+	atomic_long_inc(&pool->lat[bucket]);
+	atomic_long_inc(hit ? &pool->hits : &pool->misses);
+}
+
 /**
  * dma_contiguous_reserve() - reserve area(s) for contiguous memory handling
  * @limit: End address of the reserved memory (optional, 0 for any).
@@ -173,6 +312,8 @@ int __init dma_contiguous_reserve_area(phys_addr_t size, phys_addr_t base,
 	dma_contiguous_early_fixup(cma_get_base(*res_cma),
 				cma_get_size(*res_cma));
 
+	dma_contiguous_pool_register(*res_cma, NULL);
+
 	return 0;
 }
 
@@ -190,10 +331,30 @@ int __init dma_contiguous_reserve_area(phys_addr_t size, phys_addr_t base,
 struct page *dma_alloc_from_contiguous(struct device *dev, size_t count,
 				       unsigned int align)
 {
+	struct cma *cma = dev_get_cma_area(dev);
+	struct dma_contiguous_pool *pool;
+	struct page *page = NULL;
+	ktime_t start;
+
 	if (align > CONFIG_CMA_ALIGNMENT)
 		align = CONFIG_CMA_ALIGNMENT;
 
-	return cma_alloc(dev_get_cma_area(dev), count, align);
+	pool = dma_contiguous_find_pool(cma);
+	if (!pool)
+		return cma_alloc(cma, count, align);
+
+	start = ktime_get();
+	if (pool->low_wm)
+		page = dma_contiguous_pool_take(pool, count, align);
+	if (page) {
+		dma_contiguous_account(pool, start, true);
+		return page;
+	}
+
+	page = cma_alloc(cma, count, align);
+	dma_contiguous_account(pool, start, false);
+
+	return page;
 }
 
 /**
@@ -245,6 +406,8 @@ static int __init rmem_cma_setup(struct reserved_mem *rmem)
 	phys_addr_t align = PAGE_SIZE << max(MAX_ORDER - 1, pageblock_order);
 	phys_addr_t mask = align - 1;
 	unsigned long node = rmem->fdt_node;
+	struct dma_contiguous_pool *pool;
+	const __be32 *prop;
 	struct cma *cma;
 	int err;
 
@@ -268,6 +431,19 @@ static int __init rmem_cma_setup(struct reserved_mem *rmem)
 	if (of_get_flat_dt_prop(node, "linux,cma-default", NULL))
 		dma_contiguous_set_default(cma);
 
+	/*
+	 * "linux,prealloc-chunks" chunks of "linux,prealloc-chunk-size" bytes
+	 * are kept migrated for the fast path.
+	 */
+	pool = dma_contiguous_pool_register(cma, rmem->name);
+	prop = of_get_flat_dt_prop(node, "linux,prealloc-chunk-size", NULL);
+	if (pool && prop) {
+		pool->chunk_order = get_order(be32_to_cpup(prop));
+		prop = of_get_flat_dt_prop(node, "linux,prealloc-chunks",
+					   NULL);
+		pool->low_wm = prop ? be32_to_cpup(prop) : 1;
+	}
+
 	rmem->ops = &rmem_cma_ops;
 	rmem->priv = cma;
 
@@ -278,3 +454,85 @@ static int __init rmem_cma_setup(struct reserved_mem *rmem)
 }
 RESERVEDMEM_OF_DECLARE(cma, "shared-dma-pool", rmem_cma_setup);
 #endif
+
+#ifdef CONFIG_DEBUG_FS
+static int dma_contiguous_stats_show(struct seq_file *s, void *unused)
+{
+	struct dma_contiguous_pool *pool = s->private;
+	unsigned int i;
+
+	seq_printf(s, "chunk size: %lu\n", PAGE_SIZE << pool->chunk_order);
+	seq_printf(s, "low watermark: %u\n", pool->low_wm);
+	seq_printf(s, "chunks: %u\n", READ_ONCE(pool->nr_chunks));
+	seq_printf(s, "hits: %ld\n", atomic_long_read(&pool->hits));
+	seq_printf(s, "misses: %ld\n", atomic_long_read(&pool->misses));
+
+	seq_puts(s, "latency (us):\n");
+	for (i = 0; i < DMA_CONTIGUOUS_LAT_BUCKETS - 1; i++)
+		seq_printf(s, "  < %7lu: %ld\n", 1UL << i,
+			   atomic_long_read(&pool->lat[i]));
+	seq_printf(s, "  >= %6lu: %ld\n", 1UL << (i - 1),
+		   atomic_long_read(&pool->lat[i]));
+
+	return 0;
+}
+
+static int dma_contiguous_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dma_contiguous_stats_show, inode->i_private);
+}
+
+static const struct file_operations dma_contiguous_stats_fops = {
+	.open		= dma_contiguous_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init dma_contiguous_debugfs_init(void)
+{
+	struct dentry *root;
+	unsigned int i;
+
+	root = debugfs_create_dir("dma_contiguous", NULL);
+	if (!root)
+		return;
+
+	for (i = 0; i < dma_contiguous_pool_count; i++)
+		debugfs_create_file(dma_contiguous_pools[i].name, 0444, root,
+				    &dma_contiguous_pools[i],
+				    &dma_contiguous_stats_fops);
+}
+#else
+static inline void dma_contiguous_debugfs_init(void) { }
+#endif
+
+/* The areas can only be allocated from once they are activated */
+static int __init dma_contiguous_pools_init(void)
+{
+	struct dma_contiguous_pool *pool;
+	struct page **chunks;
+	unsigned int i;
+
+	for (i = 0; i < dma_contiguous_pool_count; i++) {
+		pool = &dma_contiguous_pools[i];
+		if (!pool->low_wm)
+			continue;
+
+		chunks = kcalloc(pool->low_wm, sizeof(*chunks), GFP_KERNEL);
+		if (!chunks) {
+			pool->low_wm = 0;
+			continue;
+		}
+
+		spin_lock(&pool->lock);
+		pool->chunks = chunks;
+		spin_unlock(&pool->lock);
+		queue_work(system_unbound_wq, &pool->refill_work);
+	}
+
+	dma_contiguous_debugfs_init();
+
+	return 0;
+}
+late_initcall(dma_contiguous_pools_init);
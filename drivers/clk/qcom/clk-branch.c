@@ -28,7 +28,7 @@ static bool clk_branch_in_hwcg_mode(const struct clk_branch *br)
 	if (!br->hwcg_reg)
 		return 0;
 
-	regmap_read(br->clkr.regmap, br->hwcg_reg, &val);
+	clk_regmap_read(&br->clkr, br->hwcg_reg, &val);
 
 	return !!(val & BIT(br->hwcg_bit));
 }
@@ -38,7 +38,7 @@ static bool clk_branch_check_halt(const struct clk_branch *br, bool enabling)
 	bool invert = (br->halt_check == BRANCH_HALT_ENABLE);
 	u32 val;
 
-	regmap_read(br->clkr.regmap, br->halt_reg, &val);
+	clk_regmap_read(&br->clkr, br->halt_reg, &val);
 
 	val &= BIT(br->halt_bit);
 	if (invert)
@@ -60,7 +60,7 @@ static bool clk_branch2_check_halt(const struct clk_branch *br, bool enabling)
 	mask = BRANCH_NOC_FSM_STATUS_MASK << BRANCH_NOC_FSM_STATUS_SHIFT;
 	mask |= BRANCH_CLK_OFF;
 
-	regmap_read(br->clkr.regmap, br->halt_reg, &val);
+	clk_regmap_read(&br->clkr, br->halt_reg, &val);
 
 	if (enabling) {
 		val &= mask;
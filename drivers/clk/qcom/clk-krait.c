@@ -17,6 +17,7 @@
 #include <linux/io.h>
 #include <linux/delay.h>
 #include <linux/err.h>
+#include <linux/clk.h>
 #include <linux/clk-provider.h>
 #include <linux/spinlock.h>
 
@@ -82,6 +83,9 @@ static struct clk_hw *krait_mux_get_safe_parent(struct clk_hw *hw,
 	struct krait_mux_clk *mux = to_krait_mux_clk(hw);
 	int num_parents = clk_hw_get_num_parents(hw);
 
+	if (!mux->has_safe_parent && !mux->reparent)
+		return NULL;
+
 	i = mux->safe_sel;
 	for (i = 0; i < num_parents; i++)
 		if (mux->safe_sel == mux->parent_map[i])
@@ -90,6 +94,25 @@ static struct clk_hw *krait_mux_get_safe_parent(struct clk_hw *hw,
 	return clk_hw_get_parent_by_index(hw, i);
 }
 
+/*
+ * A mux watching its PLL still goes through the safe parent when the rate
+ * change also moves it to another parent: the PLL notifier would otherwise
+ * put it back on the old parent, running at the new PLL rate, before the
+ * clk core gets to reparent it.
+ */
+static int krait_mux_determine_rate(struct clk_hw *hw,
+				    struct clk_rate_request *req)
+{
+	struct krait_mux_clk *mux = to_krait_mux_clk(hw);
+	int ret;
+
+	ret = __clk_mux_determine_rate_closest(hw, req);
+	if (!ret && mux->pll_nb.notifier_call)
+		mux->reparent = req->best_parent_hw != clk_hw_get_parent(hw);
+
+	return ret;
+}
+
 static int krait_mux_enable(struct clk_hw *hw)
 {
 	struct krait_mux_clk *mux = to_krait_mux_clk(hw);
@@ -111,11 +134,64 @@ const struct clk_ops krait_mux_clk_ops = {
 	.disable = krait_mux_disable,
 	.set_parent = krait_mux_set_parent,
 	.get_parent = krait_mux_get_parent,
-	.determine_rate = __clk_mux_determine_rate_closest,
+	.determine_rate = krait_mux_determine_rate,
 	.get_safe_parent = krait_mux_get_safe_parent,
 };
 EXPORT_SYMBOL_GPL(krait_mux_clk_ops);
 
+/*
+ * The mux only has to run from its safe parent while the HFPLL behind it
+ * relocks. Switching between parents that keep running is glitch free,
+ * so instead of bouncing through the safe parent on every rate change,
+ * move to it from the PLL's rate change notifications and only when the
+ * mux currently runs from that PLL. A mux that is also being reparented
+ * is on the safe parent already (see krait_mux_determine_rate()) and is
+ * left there for the clk core to move to its new parent.
+ */
+static int krait_mux_pll_notifier(struct notifier_block *nb,
+				  unsigned long event, void *data)
+{
+	struct krait_mux_clk *mux = container_of(nb, struct krait_mux_clk,
+						 pll_nb);
+
+	if (mux->en_mask == mux->safe_sel || !__clk_is_enabled(mux->hw.clk))
+		return NOTIFY_OK;
+
+	switch (event) {
+	case PRE_RATE_CHANGE:
+		__krait_mux_set_sel(mux, mux->safe_sel);
+		break;
+	case POST_RATE_CHANGE:
+	case ABORT_RATE_CHANGE:
+		__krait_mux_set_sel(mux, mux->en_mask);
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+/**
+ * krait_mux_watch_pll() - switch to the safe parent only around PLL changes
+ * @mux: the primary mux
+ * @pll: the HFPLL feeding @mux, directly or through its divider
+ *
+ * Returns 0 on success. On failure the mux keeps using its safe parent
+ * for every rate change.
+ */
+int krait_mux_watch_pll(struct krait_mux_clk *mux, struct clk *pll)
+{
+	int ret;
+
+	mux->pll_nb.notifier_call = krait_mux_pll_notifier;
+	ret = clk_notifier_register(pll, &mux->pll_nb);
+	if (ret)
+		return ret;
+
+	mux->has_safe_parent = false;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(krait_mux_watch_pll);
+
 /* The divider can divide by 2, 4, 6 and 8. But we only really need div-2. */
 static long krait_div2_round_rate(struct clk_hw *hw, unsigned long rate,
 				  unsigned long *parent_rate)
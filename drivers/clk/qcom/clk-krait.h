@@ -25,14 +25,18 @@ struct krait_mux_clk {
 	u32		shift;
 	u32		en_mask;
 	bool		lpl;
+	bool		reparent;
 
 	struct clk_hw	hw;
+	struct notifier_block	pll_nb;
 };
 
 #define to_krait_mux_clk(_hw) container_of(_hw, struct krait_mux_clk, hw)
 
 extern const struct clk_ops krait_mux_clk_ops;
 
+int krait_mux_watch_pll(struct krait_mux_clk *mux, struct clk *pll);
+
 struct krait_div2_clk {
 	u32		offset;
 	u8		width;
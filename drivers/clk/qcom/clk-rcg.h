@@ -157,6 +157,8 @@ extern const struct clk_ops clk_dyn_rcg_ops;
  * @parent_map: map from software's parent index to hardware's src_sel field
  * @freq_tbl: frequency table
  * @current_freq: last cached frequency when using branches with shared RCGs
+ * @freq_hint: last frequency table entry looked up
+ * @freq_tbl_len: number of entries in @freq_tbl, computed on first lookup
  * @clkr: regmap clock handle
  *
  */
@@ -167,6 +169,8 @@ struct clk_rcg2 {
 	const struct parent_map	*parent_map;
 	const struct freq_tbl	*freq_tbl;
 	unsigned long		current_freq;
+	const struct freq_tbl	*freq_hint;
+	unsigned int		freq_tbl_len;
 	struct clk_regmap	clkr;
 };
 
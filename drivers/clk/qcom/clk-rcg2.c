@@ -47,6 +47,14 @@
 #define N_REG			0xc
 #define D_REG			0x10
 
+/*
+ * The update bit normally clears within a few cycles of the source clock,
+ * so poll it a few times before backing off to short, capped delays.
+ */
+#define UPDATE_SPIN_COUNT	16
+#define UPDATE_MAX_DELAY_US	8
+#define UPDATE_TIMEOUT_US	500
+
 static int clk_rcg2_is_enabled(struct clk_hw *hw)
 {
 	struct clk_rcg2 *rcg = to_clk_rcg2(hw);
@@ -87,6 +95,7 @@ err:
 static int update_config(struct clk_rcg2 *rcg)
 {
 	int count, ret;
+	unsigned int delay = 1, waited = 0;
 	u32 cmd;
 	struct clk_hw *hw = &rcg->clkr.hw;
 	const char *name = clk_hw_get_name(hw);
@@ -97,13 +106,19 @@ static int update_config(struct clk_rcg2 *rcg)
 		return ret;
 
 	/* Wait for update to take effect */
-	for (count = 500; count > 0; count--) {
+	for (count = 0; waited < UPDATE_TIMEOUT_US; count++) {
 		ret = regmap_read(rcg->clkr.regmap, rcg->cmd_rcgr + CMD_REG, &cmd);
 		if (ret)
 			return ret;
 		if (!(cmd & CMD_UPDATE))
 			return 0;
-		udelay(1);
+		if (count < UPDATE_SPIN_COUNT) {
+			cpu_relax();
+			continue;
+		}
+		udelay(delay);
+		waited += delay;
+		delay = min(delay * 2, (unsigned int)UPDATE_MAX_DELAY_US);
 	}
 
 	WARN(1, "%s: rcg didn't update its configuration.", name);
@@ -176,6 +191,46 @@ clk_rcg2_recalc_rate(struct clk_hw *hw, unsigned long parent_rate)
 	return calc_rate(parent_rate, m, n, mode, hid_div);
 }
 
+/*
+ * Same result as qcom_find_freq() on rcg->freq_tbl, which is sorted by
+ * frequency: the first entry at or above @rate, else the fastest one.
+ * Rate changes tend to repeat, so the last match is tried first before
+ * falling back to a binary search.
+ */
+static const struct freq_tbl *
+clk_rcg2_find_freq(struct clk_rcg2 *rcg, unsigned long rate)
+{
+	const struct freq_tbl *f = rcg->freq_tbl, *hint = rcg->freq_hint;
+	unsigned int lo, hi, mid;
+
+	if (!f)
+		return NULL;
+
+	if (hint && rate <= hint->freq &&
+	    (hint == f || rate > (hint - 1)->freq))
+		return hint;
+
+	if (!rcg->freq_tbl_len) {
+		while (f[rcg->freq_tbl_len].freq)
+			rcg->freq_tbl_len++;
+		if (!rcg->freq_tbl_len)
+			return NULL;
+	}
+
+	lo = 0;
+	hi = rcg->freq_tbl_len - 1;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (rate <= f[mid].freq)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	rcg->freq_hint = &f[lo];
+	return rcg->freq_hint;
+}
+
 static int _freq_tbl_determine_rate(struct clk_hw *hw,
 		const struct freq_tbl *f, struct clk_rate_request *req)
 {
@@ -184,7 +239,10 @@ static int _freq_tbl_determine_rate(struct clk_hw *hw,
 	struct clk_rcg2 *rcg = to_clk_rcg2(hw);
 	int index;
 
-	f = qcom_find_freq(f, rate);
+	if (f == rcg->freq_tbl)
+		f = clk_rcg2_find_freq(rcg, rate);
+	else
+		f = qcom_find_freq(f, rate);
 	if (!f)
 		return -EINVAL;
 
@@ -270,7 +328,7 @@ static int __clk_rcg2_set_rate(struct clk_hw *hw, unsigned long rate)
 	struct clk_rcg2 *rcg = to_clk_rcg2(hw);
 	const struct freq_tbl *f;
 
-	f = qcom_find_freq(rcg->freq_tbl, rate);
+	f = clk_rcg2_find_freq(rcg, rate);
 	if (!f)
 		return -EINVAL;
 
@@ -33,7 +33,7 @@ int clk_is_enabled_regmap(struct clk_hw *hw)
 	unsigned int val;
 	int ret;
 
-	ret = regmap_read(rclk->regmap, rclk->enable_reg, &val);
+	ret = clk_regmap_read(rclk, rclk->enable_reg, &val);
 	if (ret != 0)
 		return ret;
 
@@ -44,6 +44,28 @@ int clk_is_enabled_regmap(struct clk_hw *hw)
 }
 EXPORT_SYMBOL_GPL(clk_is_enabled_regmap);
 
+static int clk_regmap_update_enable(struct clk_regmap *rclk, unsigned int val)
+{
+	struct clk_regmap_mmio *mmio = rclk->mmio;
+	void __iomem *reg;
+	unsigned long flags;
+	u32 tmp;
+
+	if (!mmio)
+		return regmap_update_bits(rclk->regmap, rclk->enable_reg,
+					  rclk->enable_mask, val);
+
+	reg = mmio->base + rclk->enable_reg;
+
+	spin_lock_irqsave(&mmio->lock, flags);
+	tmp = readl(reg);
+	if ((tmp & rclk->enable_mask) != val)
+		writel((tmp & ~rclk->enable_mask) | val, reg);
+	spin_unlock_irqrestore(&mmio->lock, flags);
+
+	return 0;
+}
+
 /**
  * clk_enable_regmap - standard enable() for regmap users
  *
@@ -63,8 +85,7 @@ int clk_enable_regmap(struct clk_hw *hw)
 	else
 		val = rclk->enable_mask;
 
-	return regmap_update_bits(rclk->regmap, rclk->enable_reg,
-				  rclk->enable_mask, val);
+	return clk_regmap_update_enable(rclk, val);
 }
 EXPORT_SYMBOL_GPL(clk_enable_regmap);
 
@@ -87,8 +108,7 @@ void clk_disable_regmap(struct clk_hw *hw)
 	else
 		val = 0;
 
-	regmap_update_bits(rclk->regmap, rclk->enable_reg, rclk->enable_mask,
-			   val);
+	clk_regmap_update_enable(rclk, val);
 }
 EXPORT_SYMBOL_GPL(clk_disable_regmap);
 
@@ -15,13 +15,29 @@
 #define __QCOM_CLK_REGMAP_H__
 
 #include <linux/clk-provider.h>
+#include <linux/io.h>
+#include <linux/regmap.h>
+#include <linux/spinlock.h>
 
-struct regmap;
+/**
+ * struct clk_regmap_mmio - MMIO mapping behind a clock controller regmap
+ * @base:	the mapping
+ * @lock:	lock of the regmap, also taken by the direct read-modify-writes,
+ *		as GDSCs and resets update the same registers through the regmap
+ * @flags:	irq flags saved by the regmap lock callback
+ */
+struct clk_regmap_mmio {
+	void __iomem *base;
+	spinlock_t lock;
+	unsigned long flags;
+};
 
 /**
  * struct clk_regmap - regmap supporting clock
  * @hw:		handle between common and hardware-specific interfaces
  * @regmap:	regmap to use for regmap helpers and/or by providers
+ * @mmio:	uncached MMIO mapping behind @regmap, if any; used instead of
+ *		@regmap by the enable/disable helpers
  * @enable_reg: register when using regmap enable/disable ops
  * @enable_mask: mask when using regmap enable/disable ops
  * @enable_is_inverted: flag to indicate set enable_mask bits to disable
@@ -30,12 +46,24 @@ struct regmap;
 struct clk_regmap {
 	struct clk_hw hw;
 	struct regmap *regmap;
+	struct clk_regmap_mmio *mmio;
 	unsigned int enable_reg;
 	unsigned int enable_mask;
 	bool enable_is_inverted;
 };
 #define to_clk_regmap(_hw) container_of(_hw, struct clk_regmap, hw)
 
+static inline int clk_regmap_read(const struct clk_regmap *rclk,
+				  unsigned int reg, unsigned int *val)
+{
+	if (rclk->mmio) {
+		*val = readl(rclk->mmio->base + reg);
+		return 0;
+	}
+
+	return regmap_read(rclk->regmap, reg, val);
+}
+
 int clk_is_enabled_regmap(struct clk_hw *hw);
 int clk_enable_regmap(struct clk_hw *hw);
 void clk_disable_regmap(struct clk_hw *hw);
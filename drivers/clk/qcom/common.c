@@ -58,19 +58,66 @@ int qcom_find_src_index(struct clk_hw *hw, const struct parent_map *map, u8 src)
 }
 EXPORT_SYMBOL_GPL(qcom_find_src_index);
 
+/*
+ * The MMIO mapping behind the regmap, so that the clock enable/disable
+ * helpers can skip the regmap. They still take the regmap's lock, as
+ * GDSCs and resets update the same registers through the regmap.
+ */
+static void qcom_cc_mmio_release(struct device *dev, void *res)
+{
+}
+
+static void qcom_cc_mmio_lock(void *arg)
+{
+	struct clk_regmap_mmio *mmio = arg;
+
+	spin_lock_irqsave(&mmio->lock, mmio->flags);
+}
+
+static void qcom_cc_mmio_unlock(void *arg)
+{
+	struct clk_regmap_mmio *mmio = arg;
+
+	spin_unlock_irqrestore(&mmio->lock, mmio->flags);
+}
+
+static struct clk_regmap_mmio *qcom_cc_find_mmio(struct device *dev,
+					const struct qcom_cc_desc *desc)
+{
+	if (desc->config->cache_type != REGCACHE_NONE)
+		return NULL;
+
+	return devres_find(dev, qcom_cc_mmio_release, NULL, NULL);
+}
+
 struct regmap *
 qcom_cc_map(struct platform_device *pdev, const struct qcom_cc_desc *desc)
 {
 	void __iomem *base;
 	struct resource *res;
 	struct device *dev = &pdev->dev;
+	struct clk_regmap_mmio *mmio;
+	struct regmap_config config;
 
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	base = devm_ioremap_resource(dev, res);
 	if (IS_ERR(base))
 		return ERR_CAST(base);
 
-	return devm_regmap_init_mmio(dev, base, desc->config);
+	mmio = devres_alloc(qcom_cc_mmio_release, sizeof(*mmio), GFP_KERNEL);
+	if (!mmio)
+		return ERR_PTR(-ENOMEM);
+
+	mmio->base = base;
+	spin_lock_init(&mmio->lock);
+	devres_add(dev, mmio);
+
+	config = *desc->config;
+	config.lock = qcom_cc_mmio_lock;
+	config.unlock = qcom_cc_mmio_unlock;
+	config.lock_arg = mmio;
+
+	return devm_regmap_init_mmio(dev, base, &config);
 }
 EXPORT_SYMBOL_GPL(qcom_cc_map);
 
@@ -187,6 +234,7 @@ int qcom_cc_really_probe(struct platform_device *pdev,
 	struct qcom_cc *cc;
 	size_t num_clks = desc->num_clks;
 	struct clk_regmap **rclks = desc->clks;
+	struct clk_regmap_mmio *mmio = qcom_cc_find_mmio(dev, desc);
 
 	cc = devm_kzalloc(dev, sizeof(*cc) + sizeof(*clks) * num_clks,
 			  GFP_KERNEL);
@@ -203,6 +251,7 @@ int qcom_cc_really_probe(struct platform_device *pdev,
 			clks[i] = ERR_PTR(-ENOENT);
 			continue;
 		}
+		rclks[i]->mmio = mmio;
 		clk = devm_clk_register_regmap(dev, rclks[i]);
 		if (IS_ERR(clk))
 			return PTR_ERR(clk);
@@ -98,7 +98,8 @@ krait_add_sec_mux(struct device *dev, int id, const char *s, unsigned offset,
 
 	mux->offset = offset;
 	mux->lpl = id >= 0;
-	mux->has_safe_parent = true;
+	/* Both parents run at fixed rates */
+	mux->has_safe_parent = false;
 	mux->safe_sel = 2;
 	mux->mask = 0x3;
 	mux->shift = 2;
@@ -137,7 +138,7 @@ krait_add_pri_mux(struct device *dev, int id, const char *s, unsigned offset)
 		.ops = &krait_mux_clk_ops,
 		.flags = CLK_SET_RATE_PARENT,
 	};
-	struct clk *clk;
+	struct clk *clk, *pll;
 
 	mux = devm_kzalloc(dev, sizeof(*mux), GFP_KERNEL);
 	if (!mux)
@@ -175,6 +176,12 @@ krait_add_pri_mux(struct device *dev, int id, const char *s, unsigned offset)
 	}
 
 	clk = devm_clk_register(dev, &mux->hw);
+	if (!IS_ERR(clk)) {
+		pll = __clk_lookup(p_names[0]);
+		if (!pll || krait_mux_watch_pll(mux, pll))
+			dev_warn(dev, "%s: switching to safe parent on every rate change\n",
+				 init.name);
+	}
 
 	kfree(p_names[2]);
 err_p2:
@@ -510,8 +510,19 @@ static void cpufreq_ready(struct cpufreq_policy *policy)
 	 * thermal DT code takes care of matching them.
 	 */
 	if (of_find_property(np, "#cooling-cells", NULL)) {
-		priv->cdev = of_cpufreq_cooling_register(np,
-							 policy->related_cpus);
+		struct cpufreq_dt_platform_data *pd = cpufreq_get_driver_data();
+		u32 power_coefficient = pd ? pd->dynamic_power_coefficient : 0;
+
+		/*
+		 * With a power model the cooling device can be used by the
+		 * power allocator governor, without one only by the step
+		 * based governors.
+		 */
+		of_property_read_u32(np, "dynamic-power-coefficient",
+				     &power_coefficient);
+
+		priv->cdev = of_cpufreq_power_cooling_register(np,
+				policy->related_cpus, power_coefficient, NULL);
 		if (IS_ERR(priv->cdev)) {
 			dev_err(priv->cpu_dev,
 				"running cpufreq without cooling device: %ld\n",
@@ -22,6 +22,12 @@
 #include <linux/slab.h>
 #include <linux/cpufreq-dt.h>
 
+/*
+ * Default Krait dynamic power coefficient for the cpu cooling device,
+ * about 750mW for a core running at 1.5GHz and 1V.
+ */
+#define KRAIT_DYNAMIC_POWER_COEFFICIENT	500
+
 static void __init get_krait_bin_format_a(int *speed, int *pvs, int *pvs_ver)
 {
 	void __iomem *base;
@@ -168,7 +174,10 @@ static int __init qcom_cpufreq_populate_opps(void)
 
 static int __init qcom_cpufreq_driver_init(void)
 {
-	struct cpufreq_dt_platform_data pdata = { .independent_clocks = true };
+	struct cpufreq_dt_platform_data pdata = {
+		.independent_clocks = true,
+		.dynamic_power_coefficient = KRAIT_DYNAMIC_POWER_COEFFICIENT,
+	};
 	struct platform_device_info devinfo = {
 		.name = "cpufreq-dt",
 		.data = &pdata,
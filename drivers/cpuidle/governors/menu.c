@@ -20,6 +20,7 @@
 #include <linux/sched.h>
 #include <linux/math64.h>
 #include <linux/module.h>
+#include <linux/cpu.h>
 
 /*
  * Please note when changing the tuning values:
@@ -284,8 +285,10 @@ again:
 static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev)
 {
 	struct menu_device *data = this_cpu_ptr(&menu_devices);
+	struct device *device = get_cpu_device(dev->cpu);
 	int latency_req = pm_qos_request(PM_QOS_CPU_DMA_LATENCY);
 	int i;
+	int resume_latency;
 	unsigned int interactivity_req;
 	unsigned long nr_iowaiters, cpu_load;
 
@@ -296,6 +299,15 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev)
 
 	data->last_state_idx = CPUIDLE_DRIVER_STATE_START - 1;
 
+	/*
+	 * A per-CPU resume latency limit lets latency sensitive tasks pinned
+	 * to this CPU keep it out of deep states without holding back the
+	 * rest of the system. Zero means no constraint here.
+	 */
+	resume_latency = device ? dev_pm_qos_raw_read_value(device) : 0;
+	if (resume_latency > 0 && resume_latency < latency_req)
+		latency_req = resume_latency;
+
 	/* Special case when user has set very strict latency requirement */
 	if (unlikely(latency_req == 0))
 		return 0;
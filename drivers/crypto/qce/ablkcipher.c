@@ -25,39 +25,23 @@ static LIST_HEAD(ablkcipher_algs);
 static void qce_ablkcipher_done(void *data)
 {
 	struct crypto_async_request *async_req = data;
-	struct ablkcipher_request *req = ablkcipher_request_cast(async_req);
-	struct qce_cipher_reqctx *rctx = ablkcipher_request_ctx(req);
 	struct qce_alg_template *tmpl = to_cipher_tmpl(async_req->tfm);
 	struct qce_device *qce = tmpl->qce;
-	enum dma_data_direction dir_src, dir_dst;
 	u32 status;
 	int error;
-	bool diff_dst;
-
-	diff_dst = (req->src != req->dst) ? true : false;
-	dir_src = diff_dst ? DMA_TO_DEVICE : DMA_BIDIRECTIONAL;
-	dir_dst = diff_dst ? DMA_FROM_DEVICE : DMA_BIDIRECTIONAL;
-
-	error = qce_dma_terminate_all(&qce->dma);
-	if (error)
-		dev_dbg(qce->dev, "ablkcipher dma termination error (%d)\n",
-			error);
-
-	if (diff_dst)
-		dma_unmap_sg(qce->dev, rctx->src_sg, rctx->src_nents, dir_src);
-	dma_unmap_sg(qce->dev, rctx->dst_sg, rctx->dst_nents, dir_dst);
-
-	sg_free_table(&rctx->dst_tbl);
 
 	error = qce_check_status(qce, &status);
-	if (error < 0)
+	if (error < 0) {
 		dev_dbg(qce->dev, "ablkcipher operation error (%x)\n", status);
+		qce_dma_terminate_all(&qce->dma);
+	}
 
 	qce->async_req_done(tmpl->qce, error);
 }
 
 static int
-qce_ablkcipher_async_req_handle(struct crypto_async_request *async_req)
+qce_ablkcipher_async_req_prepare(struct crypto_async_request *async_req,
+				 struct qce_result_dump *result_buf)
 {
 	struct ablkcipher_request *req = ablkcipher_request_cast(async_req);
 	struct qce_cipher_reqctx *rctx = ablkcipher_request_ctx(req);
@@ -93,15 +77,16 @@ qce_ablkcipher_async_req_handle(struct crypto_async_request *async_req)
 	if (ret)
 		return ret;
 
-	sg_init_one(&rctx->result_sg, qce->dma.result_buf, QCE_RESULT_BUF_SZ);
+	sg_init_one(&rctx->result_sg, result_buf, QCE_RESULT_BUF_SZ);
 
-	sg = qce_sgtable_add(&rctx->dst_tbl, req->dst);
+	sg = qce_sgtable_add(&rctx->dst_tbl, req->dst, req->nbytes);
 	if (IS_ERR(sg)) {
 		ret = PTR_ERR(sg);
 		goto error_free;
 	}
 
-	sg = qce_sgtable_add(&rctx->dst_tbl, &rctx->result_sg);
+	sg = qce_sgtable_add(&rctx->dst_tbl, &rctx->result_sg,
+			     QCE_RESULT_BUF_SZ);
 	if (IS_ERR(sg)) {
 		ret = PTR_ERR(sg);
 		goto error_free;
@@ -123,30 +108,61 @@ qce_ablkcipher_async_req_handle(struct crypto_async_request *async_req)
 		rctx->src_sg = rctx->dst_sg;
 	}
 
+	return 0;
+
+error_unmap_dst:
+	dma_unmap_sg(qce->dev, rctx->dst_sg, rctx->dst_nents, dir_dst);
+error_free:
+	sg_free_table(&rctx->dst_tbl);
+	return ret;
+}
+
+static int
+qce_ablkcipher_async_req_start(struct crypto_async_request *async_req)
+{
+	struct ablkcipher_request *req = ablkcipher_request_cast(async_req);
+	struct qce_cipher_reqctx *rctx = ablkcipher_request_ctx(req);
+	struct qce_alg_template *tmpl = to_cipher_tmpl(async_req->tfm);
+	struct qce_device *qce = tmpl->qce;
+	int ret;
+
 	ret = qce_dma_prep_sgs(&qce->dma, rctx->src_sg, rctx->src_nents,
 			       rctx->dst_sg, rctx->dst_nents,
 			       qce_ablkcipher_done, async_req);
 	if (ret)
-		goto error_unmap_src;
+		return ret;
 
 	qce_dma_issue_pending(&qce->dma);
 
 	ret = qce_start(async_req, tmpl->crypto_alg_type, req->nbytes, 0);
 	if (ret)
-		goto error_terminate;
+		qce_dma_terminate_all(&qce->dma);
 
-	return 0;
+	return ret;
+}
+
+static int
+qce_ablkcipher_async_req_finish(struct crypto_async_request *async_req,
+				int result)
+{
+	struct ablkcipher_request *req = ablkcipher_request_cast(async_req);
+	struct qce_cipher_reqctx *rctx = ablkcipher_request_ctx(req);
+	struct qce_alg_template *tmpl = to_cipher_tmpl(async_req->tfm);
+	struct qce_device *qce = tmpl->qce;
+	enum dma_data_direction dir_src, dir_dst;
+	bool diff_dst;
+
+	diff_dst = (req->src != req->dst) ? true : false;
+	dir_src = diff_dst ? DMA_TO_DEVICE : DMA_BIDIRECTIONAL;
+	dir_dst = diff_dst ? DMA_FROM_DEVICE : DMA_BIDIRECTIONAL;
 
-error_terminate:
-	qce_dma_terminate_all(&qce->dma);
-error_unmap_src:
 	if (diff_dst)
-		dma_unmap_sg(qce->dev, req->src, rctx->src_nents, dir_src);
-error_unmap_dst:
+		dma_unmap_sg(qce->dev, rctx->src_sg, rctx->src_nents, dir_src);
 	dma_unmap_sg(qce->dev, rctx->dst_sg, rctx->dst_nents, dir_dst);
-error_free:
+
 	sg_free_table(&rctx->dst_tbl);
-	return ret;
+
+	return result;
 }
 
 static int qce_ablkcipher_setkey(struct crypto_ablkcipher *ablk, const u8 *key,
@@ -160,15 +176,7 @@ static int qce_ablkcipher_setkey(struct crypto_ablkcipher *ablk, const u8 *key,
 	if (!key || !keylen)
 		return -EINVAL;
 
-	if (IS_AES(flags)) {
-		switch (keylen) {
-		case AES_KEYSIZE_128:
-		case AES_KEYSIZE_256:
-			break;
-		default:
-			goto fallback;
-		}
-	} else if (IS_DES(flags)) {
+	if (IS_DES(flags)) {
 		u32 tmp[DES_EXPKEY_WORDS];
 
 		ret = des_ekey(tmp, key);
@@ -177,14 +185,14 @@ static int qce_ablkcipher_setkey(struct crypto_ablkcipher *ablk, const u8 *key,
 			goto weakkey;
 	}
 
+	/* the fallback handles AES-192 keys and small requests */
+	ret = crypto_ablkcipher_setkey(ctx->fallback, key, keylen);
+	if (ret)
+		return ret;
+
 	ctx->enc_keylen = keylen;
 	memcpy(ctx->enc_key, key, keylen);
 	return 0;
-fallback:
-	ret = crypto_ablkcipher_setkey(ctx->fallback, key, keylen);
-	if (!ret)
-		ctx->enc_keylen = keylen;
-	return ret;
 weakkey:
 	crypto_ablkcipher_set_flags(ablk, CRYPTO_TFM_RES_WEAK_KEY);
 	return -EINVAL;
@@ -202,8 +210,9 @@ static int qce_ablkcipher_crypt(struct ablkcipher_request *req, int encrypt)
 	rctx->flags = tmpl->alg_flags;
 	rctx->flags |= encrypt ? QCE_ENCRYPT : QCE_DECRYPT;
 
-	if (IS_AES(rctx->flags) && ctx->enc_keylen != AES_KEYSIZE_128 &&
-	    ctx->enc_keylen != AES_KEYSIZE_256) {
+	if ((IS_AES(rctx->flags) && ctx->enc_keylen != AES_KEYSIZE_128 &&
+	     ctx->enc_keylen != AES_KEYSIZE_256) ||
+	    req->nbytes < tmpl->qce->fallback_threshold) {
 		ablkcipher_request_set_tfm(req, ctx->fallback);
 		ret = encrypt ? crypto_ablkcipher_encrypt(req) :
 				crypto_ablkcipher_decrypt(req);
@@ -417,5 +426,7 @@ const struct qce_algo_ops ablkcipher_ops = {
 	.type = CRYPTO_ALG_TYPE_ABLKCIPHER,
 	.register_algs = qce_ablkcipher_register,
 	.unregister_algs = qce_ablkcipher_unregister,
-	.async_req_handle = qce_ablkcipher_async_req_handle,
+	.async_req_prepare = qce_ablkcipher_async_req_prepare,
+	.async_req_start = qce_ablkcipher_async_req_start,
+	.async_req_finish = qce_ablkcipher_async_req_finish,
 };
@@ -0,0 +1,463 @@
+/*
+ * Copyright (c) 2010-2014, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/device.h>
+#include <linux/interrupt.h>
+#include <linux/types.h>
+#include <crypto/aes.h>
+#include <crypto/algapi.h>
+#include <crypto/authenc.h>
+#include <crypto/scatterwalk.h>
+
+#include "aead.h"
+
+static LIST_HEAD(aead_algs);
+
+static const u32 std_iv_sha1[SHA256_DIGEST_SIZE / sizeof(u32)] = {
+	SHA1_H0, SHA1_H1, SHA1_H2, SHA1_H3, SHA1_H4, 0, 0, 0
+};
+
+static const u32 std_iv_sha256[SHA256_DIGEST_SIZE / sizeof(u32)] = {
+	SHA256_H0, SHA256_H1, SHA256_H2, SHA256_H3,
+	SHA256_H4, SHA256_H5, SHA256_H6, SHA256_H7
+};
+
+static void qce_aead_done(void *data)
+{
+	struct crypto_async_request *async_req = data;
+	struct qce_alg_template *tmpl = to_aead_tmpl(async_req->tfm);
+	struct qce_device *qce = tmpl->qce;
+	u32 status;
+	int error;
+
+	error = qce_check_status(qce, &status);
+	if (error < 0) {
+		dev_dbg(qce->dev, "aead operation error (%x)\n", status);
+		qce_dma_terminate_all(&qce->dma);
+	}
+
+	qce->async_req_done(tmpl->qce, error);
+}
+
+static int qce_aead_async_req_prepare(struct crypto_async_request *async_req,
+				      struct qce_result_dump *result_buf)
+{
+	struct aead_request *req = container_of(async_req, struct aead_request,
+						base);
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	struct qce_alg_template *tmpl = to_aead_tmpl(async_req->tfm);
+	struct qce_device *qce = tmpl->qce;
+	enum dma_data_direction dir_src, dir_dst;
+	struct scatterlist *sg;
+	bool diff_dst;
+	gfp_t gfp;
+	int ret;
+
+	diff_dst = (req->src != req->dst) ? true : false;
+	dir_src = diff_dst ? DMA_TO_DEVICE : DMA_BIDIRECTIONAL;
+	dir_dst = diff_dst ? DMA_FROM_DEVICE : DMA_BIDIRECTIONAL;
+
+	rctx->src_nents = sg_nents_for_len(req->src, rctx->totallen);
+	if (diff_dst)
+		rctx->dst_nents = sg_nents_for_len(req->dst, rctx->totallen);
+	else
+		rctx->dst_nents = rctx->src_nents;
+
+	if (rctx->src_nents < 0 || rctx->dst_nents < 0)
+		return -EINVAL;
+
+	rctx->dst_nents += 1;
+
+	gfp = (req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP) ?
+						GFP_KERNEL : GFP_ATOMIC;
+
+	ret = sg_alloc_table(&rctx->dst_tbl, rctx->dst_nents, gfp);
+	if (ret)
+		return ret;
+
+	sg_init_one(&rctx->result_sg, result_buf, QCE_RESULT_BUF_SZ);
+
+	/* the tag is not transferred, it is handled by the cpu */
+	sg = qce_sgtable_add(&rctx->dst_tbl, req->dst, rctx->totallen);
+	if (IS_ERR(sg)) {
+		ret = PTR_ERR(sg);
+		goto error_free_dst;
+	}
+
+	sg = qce_sgtable_add(&rctx->dst_tbl, &rctx->result_sg,
+			     QCE_RESULT_BUF_SZ);
+	if (IS_ERR(sg)) {
+		ret = PTR_ERR(sg);
+		goto error_free_dst;
+	}
+
+	sg_mark_end(sg);
+	rctx->dst_sg = rctx->dst_tbl.sgl;
+
+	ret = dma_map_sg(qce->dev, rctx->dst_sg, rctx->dst_nents, dir_dst);
+	if (ret < 0)
+		goto error_free_dst;
+
+	if (diff_dst) {
+		ret = sg_alloc_table(&rctx->src_tbl, rctx->src_nents, gfp);
+		if (ret)
+			goto error_unmap_dst;
+
+		sg = qce_sgtable_add(&rctx->src_tbl, req->src, rctx->totallen);
+		if (IS_ERR(sg)) {
+			ret = PTR_ERR(sg);
+			goto error_free_src;
+		}
+
+		sg_mark_end(sg);
+		rctx->src_sg = rctx->src_tbl.sgl;
+
+		ret = dma_map_sg(qce->dev, rctx->src_sg, rctx->src_nents,
+				 dir_src);
+		if (ret < 0)
+			goto error_free_src;
+	} else {
+		rctx->src_sg = rctx->dst_sg;
+	}
+
+	return 0;
+
+error_free_src:
+	sg_free_table(&rctx->src_tbl);
+error_unmap_dst:
+	dma_unmap_sg(qce->dev, rctx->dst_sg, rctx->dst_nents, dir_dst);
+error_free_dst:
+	sg_free_table(&rctx->dst_tbl);
+	return ret;
+}
+
+static int qce_aead_async_req_start(struct crypto_async_request *async_req)
+{
+	struct aead_request *req = container_of(async_req, struct aead_request,
+						base);
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	struct qce_alg_template *tmpl = to_aead_tmpl(async_req->tfm);
+	struct qce_device *qce = tmpl->qce;
+	int ret;
+
+	ret = qce_dma_prep_sgs(&qce->dma, rctx->src_sg, rctx->src_nents,
+			       rctx->dst_sg, rctx->dst_nents,
+			       qce_aead_done, async_req);
+	if (ret)
+		return ret;
+
+	qce_dma_issue_pending(&qce->dma);
+
+	ret = qce_start(async_req, tmpl->crypto_alg_type, rctx->totallen,
+			req->assoclen);
+	if (ret)
+		qce_dma_terminate_all(&qce->dma);
+
+	return ret;
+}
+
+static int qce_aead_async_req_finish(struct crypto_async_request *async_req,
+				     int result)
+{
+	struct aead_request *req = container_of(async_req, struct aead_request,
+						base);
+	struct crypto_aead *aead = crypto_aead_reqtfm(req);
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	struct qce_alg_template *tmpl = to_aead_tmpl(async_req->tfm);
+	struct qce_device *qce = tmpl->qce;
+	struct qce_result_dump *result_buf = sg_virt(&rctx->result_sg);
+	unsigned int authsize = crypto_aead_authsize(aead);
+	enum dma_data_direction dir_src, dir_dst;
+	u8 tag[QCE_AEAD_MAX_AUTHSIZE];
+	bool diff_dst;
+
+	diff_dst = (req->src != req->dst) ? true : false;
+	dir_src = diff_dst ? DMA_TO_DEVICE : DMA_BIDIRECTIONAL;
+	dir_dst = diff_dst ? DMA_FROM_DEVICE : DMA_BIDIRECTIONAL;
+
+	if (diff_dst) {
+		dma_unmap_sg(qce->dev, rctx->src_sg, rctx->src_nents, dir_src);
+		sg_free_table(&rctx->src_tbl);
+	}
+	dma_unmap_sg(qce->dev, rctx->dst_sg, rctx->dst_nents, dir_dst);
+
+	sg_free_table(&rctx->dst_tbl);
+
+	if (result)
+		return result;
+
+	if (IS_ENCRYPT(rctx->flags)) {
+		scatterwalk_map_and_copy(result_buf->auth_iv, req->dst,
+					 rctx->totallen, authsize, 1);
+		return 0;
+	}
+
+	scatterwalk_map_and_copy(tag, req->src, rctx->totallen, authsize, 0);
+	if (crypto_memneq(tag, result_buf->auth_iv, authsize))
+		return -EBADMSG;
+
+	return 0;
+}
+
+static int qce_aead_setkey(struct crypto_aead *aead, const u8 *key,
+			   unsigned int keylen)
+{
+	struct qce_aead_ctx *ctx = crypto_aead_ctx(aead);
+	struct crypto_authenc_keys keys;
+	int ret;
+
+	if (crypto_authenc_extractkeys(&keys, key, keylen))
+		goto badkey;
+
+	switch (keys.enckeylen) {
+	case AES_KEYSIZE_128:
+	case AES_KEYSIZE_192:
+	case AES_KEYSIZE_256:
+		break;
+	default:
+		goto badkey;
+	}
+
+	crypto_aead_clear_flags(ctx->fallback, CRYPTO_TFM_REQ_MASK);
+	crypto_aead_set_flags(ctx->fallback, crypto_aead_get_flags(aead) &
+			      CRYPTO_TFM_REQ_MASK);
+
+	ret = crypto_aead_setkey(ctx->fallback, key, keylen);
+	if (ret)
+		return ret;
+
+	ctx->enc_keylen = keys.enckeylen;
+	memcpy(ctx->enc_key, keys.enckey, keys.enckeylen);
+
+	/* keys longer than the block size are left to the fallback */
+	memset(ctx->auth_key, 0, sizeof(ctx->auth_key));
+	ctx->auth_keylen = keys.authkeylen;
+	if (keys.authkeylen <= sizeof(ctx->auth_key))
+		memcpy(ctx->auth_key, keys.authkey, keys.authkeylen);
+
+	return 0;
+badkey:
+	crypto_aead_set_flags(aead, CRYPTO_TFM_RES_BAD_KEY_LEN);
+	return -EINVAL;
+}
+
+static int qce_aead_setauthsize(struct crypto_aead *aead,
+				unsigned int authsize)
+{
+	struct qce_aead_ctx *ctx = crypto_aead_ctx(aead);
+
+	return crypto_aead_setauthsize(ctx->fallback, authsize);
+}
+
+static bool qce_aead_need_fallback(struct aead_request *req,
+				   unsigned int cryptlen)
+{
+	struct qce_aead_ctx *ctx = crypto_tfm_ctx(req->base.tfm);
+
+	if (ctx->enc_keylen == AES_KEYSIZE_192 ||
+	    ctx->auth_keylen > QCE_SHA_HMAC_KEY_SIZE)
+		return true;
+
+	/* the engine handles whole cbc blocks and 16-bit cipher offsets */
+	return !cryptlen || cryptlen % AES_BLOCK_SIZE ||
+	       req->assoclen > 0xffff;
+}
+
+static int qce_aead_crypt(struct aead_request *req, int encrypt)
+{
+	struct crypto_aead *aead = crypto_aead_reqtfm(req);
+	struct qce_aead_ctx *ctx = crypto_aead_ctx(aead);
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	struct qce_alg_template *tmpl = to_aead_tmpl(crypto_aead_tfm(aead));
+	struct aead_request *subreq = &rctx->fallback_req;
+	unsigned int cryptlen = req->cryptlen;
+
+	if (!encrypt) {
+		if (cryptlen < crypto_aead_authsize(aead))
+			return -EINVAL;
+		cryptlen -= crypto_aead_authsize(aead);
+	}
+
+	if (qce_aead_need_fallback(req, cryptlen)) {
+		aead_request_set_tfm(subreq, ctx->fallback);
+		aead_request_set_callback(subreq, req->base.flags,
+					  req->base.complete, req->base.data);
+		aead_request_set_crypt(subreq, req->src, req->dst,
+				       req->cryptlen, req->iv);
+		aead_request_set_ad(subreq, req->assoclen);
+
+		return encrypt ? crypto_aead_encrypt(subreq) :
+				 crypto_aead_decrypt(subreq);
+	}
+
+	rctx->flags = tmpl->alg_flags;
+	rctx->flags |= encrypt ? QCE_ENCRYPT : QCE_DECRYPT;
+	rctx->cryptlen = cryptlen;
+	rctx->totallen = req->assoclen + cryptlen;
+
+	return tmpl->qce->async_req_enqueue(tmpl->qce, &req->base);
+}
+
+static int qce_aead_encrypt(struct aead_request *req)
+{
+	return qce_aead_crypt(req, 1);
+}
+
+static int qce_aead_decrypt(struct aead_request *req)
+{
+	return qce_aead_crypt(req, 0);
+}
+
+static int qce_aead_init(struct crypto_aead *aead)
+{
+	struct qce_aead_ctx *ctx = crypto_aead_ctx(aead);
+
+	memset(ctx, 0, sizeof(*ctx));
+
+	ctx->fallback = crypto_alloc_aead(crypto_tfm_alg_name(&aead->base), 0,
+					  CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->fallback))
+		return PTR_ERR(ctx->fallback);
+
+	crypto_aead_set_reqsize(aead, sizeof(struct qce_aead_reqctx) +
+				crypto_aead_reqsize(ctx->fallback));
+
+	return 0;
+}
+
+static void qce_aead_exit(struct crypto_aead *aead)
+{
+	struct qce_aead_ctx *ctx = crypto_aead_ctx(aead);
+
+	crypto_free_aead(ctx->fallback);
+}
+
+struct qce_aead_def {
+	unsigned long flags;
+	const char *name;
+	const char *drv_name;
+	unsigned int maxauthsize;
+	const u32 *std_iv;
+};
+
+static const struct qce_aead_def aead_def[] = {
+	{
+		.flags		= QCE_ALG_AES | QCE_MODE_CBC |
+				  QCE_HASH_SHA1_HMAC,
+		.name		= "authenc(hmac(sha1),cbc(aes))",
+		.drv_name	= "authenc-hmac-sha1-cbc-aes-qce",
+		.maxauthsize	= SHA1_DIGEST_SIZE,
+		.std_iv		= std_iv_sha1,
+	},
+	{
+		.flags		= QCE_ALG_AES | QCE_MODE_CBC |
+				  QCE_HASH_SHA256_HMAC,
+		.name		= "authenc(hmac(sha256),cbc(aes))",
+		.drv_name	= "authenc-hmac-sha256-cbc-aes-qce",
+		.maxauthsize	= SHA256_DIGEST_SIZE,
+		.std_iv		= std_iv_sha256,
+	},
+};
+
+static int qce_aead_register_one(const struct qce_aead_def *def,
+				 struct qce_device *qce)
+{
+	struct qce_alg_template *tmpl;
+	struct aead_alg *alg;
+	struct crypto_alg *base;
+	int ret;
+
+	tmpl = kzalloc(sizeof(*tmpl), GFP_KERNEL);
+	if (!tmpl)
+		return -ENOMEM;
+
+	tmpl->std_iv = def->std_iv;
+
+	alg = &tmpl->alg.aead;
+	alg->setkey = qce_aead_setkey;
+	alg->setauthsize = qce_aead_setauthsize;
+	alg->encrypt = qce_aead_encrypt;
+	alg->decrypt = qce_aead_decrypt;
+	alg->init = qce_aead_init;
+	alg->exit = qce_aead_exit;
+	alg->ivsize = AES_BLOCK_SIZE;
+	alg->maxauthsize = def->maxauthsize;
+
+	base = &alg->base;
+	base->cra_blocksize = AES_BLOCK_SIZE;
+	/* authenc() instances built from a fast cipher end up in the
+	 * thousands, make sure IPsec binds to the engine instead
+	 */
+	base->cra_priority = 4000;
+	base->cra_flags = CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK;
+	base->cra_ctxsize = sizeof(struct qce_aead_ctx);
+	base->cra_alignmask = 0;
+	base->cra_module = THIS_MODULE;
+	INIT_LIST_HEAD(&base->cra_list);
+
+	snprintf(base->cra_name, CRYPTO_MAX_ALG_NAME, "%s", def->name);
+	snprintf(base->cra_driver_name, CRYPTO_MAX_ALG_NAME, "%s",
+		 def->drv_name);
+
+	INIT_LIST_HEAD(&tmpl->entry);
+	tmpl->crypto_alg_type = CRYPTO_ALG_TYPE_AEAD;
+	tmpl->alg_flags = def->flags;
+	tmpl->qce = qce;
+
+	ret = crypto_register_aead(alg);
+	if (ret) {
+		kfree(tmpl);
+		dev_err(qce->dev, "%s registration failed\n", base->cra_name);
+		return ret;
+	}
+
+	list_add_tail(&tmpl->entry, &aead_algs);
+	dev_dbg(qce->dev, "%s is registered\n", base->cra_name);
+	return 0;
+}
+
+static void qce_aead_unregister(struct qce_device *qce)
+{
+	struct qce_alg_template *tmpl, *n;
+
+	list_for_each_entry_safe(tmpl, n, &aead_algs, entry) {
+		crypto_unregister_aead(&tmpl->alg.aead);
+		list_del(&tmpl->entry);
+		kfree(tmpl);
+	}
+}
+
+static int qce_aead_register(struct qce_device *qce)
+{
+	int ret, i;
+
+	for (i = 0; i < ARRAY_SIZE(aead_def); i++) {
+		ret = qce_aead_register_one(&aead_def[i], qce);
+		if (ret)
+			goto err;
+	}
+
+	return 0;
+err:
+	qce_aead_unregister(qce);
+	return ret;
+}
+
+const struct qce_algo_ops aead_ops = {
+	.type = CRYPTO_ALG_TYPE_AEAD,
+	.register_algs = qce_aead_register,
+	.unregister_algs = qce_aead_unregister,
+	.async_req_prepare = qce_aead_async_req_prepare,
+	.async_req_start = qce_aead_async_req_start,
+	.async_req_finish = qce_aead_async_req_finish,
+};
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2010-2014, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _AEAD_H_
+#define _AEAD_H_
+
+#include <crypto/internal/aead.h>
+#include <crypto/sha.h>
+
+#include "common.h"
+#include "core.h"
+
+#define QCE_AEAD_MAX_AUTHSIZE	SHA256_DIGEST_SIZE
+
+struct qce_aead_ctx {
+	u8 enc_key[QCE_MAX_CIPHER_KEY_SIZE];
+	unsigned int enc_keylen;
+	u8 auth_key[QCE_SHA_HMAC_KEY_SIZE];
+	unsigned int auth_keylen;
+	struct crypto_aead *fallback;
+};
+
+/**
+ * struct qce_aead_reqctx - holds private aead objects per request
+ * @flags: operation flags
+ * @cryptlen: payload length, excluding the authentication tag
+ * @totallen: associated data and payload length
+ * @src_nents: source entries
+ * @dst_nents: destination entries
+ * @result_sg: scatterlist used for result buffer
+ * @dst_tbl: destination sg table
+ * @dst_sg: destination sg pointer table beginning
+ * @src_tbl: source sg table
+ * @src_sg: source sg pointer table beginning
+ * @fallback_req: request to the software fallback, must be last
+ */
+struct qce_aead_reqctx {
+	unsigned long flags;
+	unsigned int cryptlen;
+	unsigned int totallen;
+	int src_nents;
+	int dst_nents;
+	struct scatterlist result_sg;
+	struct sg_table dst_tbl;
+	struct scatterlist *dst_sg;
+	struct sg_table src_tbl;
+	struct scatterlist *src_sg;
+	struct aead_request fallback_req;
+};
+
+static inline struct qce_alg_template *to_aead_tmpl(struct crypto_tfm *tfm)
+{
+	struct aead_alg *alg = crypto_aead_alg(__crypto_aead_cast(tfm));
+
+	return container_of(alg, struct qce_alg_template, alg.aead);
+}
+
+extern const struct qce_algo_ops aead_ops;
+
+#endif /* _AEAD_H_ */
@@ -17,6 +17,7 @@
 #include <crypto/scatterwalk.h>
 #include <crypto/sha.h>
 
+#include "aead.h"
 #include "cipher.h"
 #include "common.h"
 #include "core.h"
@@ -393,10 +394,80 @@ static int qce_setup_regs_ablkcipher(struct crypto_async_request *async_req,
 	return 0;
 }
 
+static int qce_setup_regs_aead(struct crypto_async_request *async_req,
+			       u32 totallen, u32 offset)
+{
+	struct aead_request *req = container_of(async_req, struct aead_request,
+						base);
+	struct qce_aead_reqctx *rctx = aead_request_ctx(req);
+	struct qce_aead_ctx *ctx = crypto_tfm_ctx(async_req->tfm);
+	struct qce_alg_template *tmpl = to_aead_tmpl(async_req->tfm);
+	struct qce_device *qce = tmpl->qce;
+	__be32 enckey[QCE_MAX_CIPHER_KEY_SIZE / sizeof(__be32)] = {0};
+	__be32 enciv[QCE_MAX_IV_SIZE / sizeof(__be32)] = {0};
+	__be32 mackey[QCE_SHA_HMAC_KEY_SIZE / sizeof(__be32)] = {0};
+	unsigned long flags = rctx->flags;
+	u32 encr_cfg, auth_cfg, config;
+	unsigned int iv_words;
+
+	if (!IS_AES(flags) || !IS_CBC(flags) || !IS_SHA_HMAC(flags))
+		return -EINVAL;
+
+	qce_setup_config(qce);
+
+	/* cipher covers the payload following the associated data */
+	qce_cpu_to_be32p_array(enckey, ctx->enc_key, ctx->enc_keylen);
+	qce_write_array(qce, REG_ENCR_KEY0, (u32 *)enckey,
+			ctx->enc_keylen / sizeof(u32));
+
+	qce_cpu_to_be32p_array(enciv, req->iv, QCE_AES_IV_LENGTH);
+	qce_write_array(qce, REG_CNTR0_IV0, (u32 *)enciv, 4);
+
+	encr_cfg = qce_encr_cfg(flags, ctx->enc_keylen);
+	if (IS_ENCRYPT(flags))
+		encr_cfg |= BIT(ENCODE_SHIFT);
+
+	qce_write(qce, REG_ENCR_SEG_CFG, encr_cfg);
+	qce_write(qce, REG_ENCR_SEG_SIZE, totallen - offset);
+	qce_write(qce, REG_ENCR_SEG_START, offset & 0xffff);
+
+	/* hmac covers the associated data and the ciphertext */
+	qce_cpu_to_be32p_array(mackey, ctx->auth_key, QCE_SHA_HMAC_KEY_SIZE);
+	qce_write_array(qce, REG_AUTH_KEY0, (u32 *)mackey,
+			QCE_SHA_HMAC_KEY_SIZE / sizeof(u32));
+
+	iv_words = IS_SHA1_HMAC(flags) ? 5 : 8;
+	qce_write_array(qce, REG_AUTH_IV0, tmpl->std_iv, iv_words);
+	qce_clear_array(qce, REG_AUTH_BYTECNT0, 4);
+
+	auth_cfg = qce_auth_cfg(flags, 0);
+	auth_cfg &= ~AUTH_POS_MASK;
+	if (IS_ENCRYPT(flags))
+		auth_cfg |= AUTH_POS_AFTER << AUTH_POS_SHIFT;
+	else
+		auth_cfg |= AUTH_POS_BEFORE << AUTH_POS_SHIFT;
+
+	qce_write(qce, REG_AUTH_SEG_CFG, auth_cfg);
+	qce_write(qce, REG_AUTH_SEG_SIZE, totallen);
+	qce_write(qce, REG_AUTH_SEG_START, 0);
+
+	qce_write(qce, REG_SEG_SIZE, totallen);
+
+	/* get little endianness */
+	config = qce_config_reg(qce, 1);
+	qce_write(qce, REG_CONFIG, config);
+
+	qce_crypto_go(qce);
+
+	return 0;
+}
+
 int qce_start(struct crypto_async_request *async_req, u32 type, u32 totallen,
 	      u32 offset)
 {
 	switch (type) {
+	case CRYPTO_ALG_TYPE_AEAD:
+		return qce_setup_regs_aead(async_req, totallen, offset);
 	case CRYPTO_ALG_TYPE_ABLKCIPHER:
 		return qce_setup_regs_ablkcipher(async_req, totallen, offset);
 	case CRYPTO_ALG_TYPE_AHASH:
@@ -16,6 +16,7 @@
 
 #include <linux/crypto.h>
 #include <linux/types.h>
+#include <crypto/aead.h>
 #include <crypto/aes.h>
 #include <crypto/hash.h>
 
@@ -89,6 +90,7 @@ struct qce_alg_template {
 	union {
 		struct crypto_alg crypto;
 		struct ahash_alg ahash;
+		struct aead_alg aead;
 	} alg;
 	struct qce_device *qce;
 };
@@ -12,9 +12,14 @@
  */
 
 #include <linux/clk.h>
+#include <linux/completion.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/types.h>
 #include <crypto/algapi.h>
@@ -22,15 +27,27 @@
 #include <crypto/sha.h>
 
 #include "core.h"
+#include "aead.h"
 #include "cipher.h"
 #include "sha.h"
 
 #define QCE_MAJOR_VERSION5	0x05
-#define QCE_QUEUE_LENGTH	1
+#define QCE_QUEUE_LENGTH	64
+
+/* request sizes probed, and rounds per size, to calibrate the fallback */
+#define QCE_CALIB_MIN_LEN	64
+#define QCE_CALIB_MAX_LEN	SZ_8K
+#define QCE_CALIB_ROUNDS	8
+
+static int fallback_threshold = -1;
+module_param(fallback_threshold, int, 0444);
+MODULE_PARM_DESC(fallback_threshold,
+		 "Requests below this size in bytes are processed by the cpu, -1 to calibrate at probe");
 
 static const struct qce_algo_ops *qce_ops[] = {
 	&ablkcipher_ops,
 	&ahash_ops,
+	&aead_ops,
 };
 
 static void qce_unregister_algs(struct qce_device *qce)
@@ -59,27 +76,75 @@ static int qce_register_algs(struct qce_device *qce)
 	return ret;
 }
 
-static int qce_handle_request(struct crypto_async_request *async_req)
+static const struct qce_algo_ops *qce_find_ops(u32 type)
 {
-	int ret = -EINVAL, i;
-	const struct qce_algo_ops *ops;
-	u32 type = crypto_tfm_alg_type(async_req->tfm);
+	int i;
 
 	for (i = 0; i < ARRAY_SIZE(qce_ops); i++) {
-		ops = qce_ops[i];
-		if (type != ops->type)
+		if (qce_ops[i]->type == type)
+			return qce_ops[i];
+	}
+
+	return NULL;
+}
+
+static inline struct qce_req_slot *qce_slot(struct qce_device *qce,
+					    unsigned int idx)
+{
+	return &qce->slots[idx & (QCE_MAX_REQS - 1)];
+}
+
+/*
+ * Requests are started on the engine strictly in the order they were
+ * dequeued and complete in that order, which preserves per-tfm ordering.
+ * Mapping the buffers of the next requests and releasing those of the
+ * finished ones is overlapped with the request the engine is processing.
+ */
+static void qce_start_next(struct qce_device *qce)
+{
+	struct qce_req_slot *slot;
+	unsigned long flags;
+	bool failed = false;
+	int ret;
+
+	spin_lock_irqsave(&qce->lock, flags);
+
+	while (!qce->busy && qce->req_start != qce->req_head) {
+		slot = qce_slot(qce, qce->req_start);
+
+		if (slot->state == QCE_REQ_PREPARING)
+			break;
+
+		qce->req_start++;
+
+		if (slot->state == QCE_REQ_FAILED) {
+			failed = true;
 			continue;
-		ret = ops->async_req_handle(async_req);
-		break;
+		}
+
+		slot->state = QCE_REQ_RUNNING;
+		qce->busy = true;
+		spin_unlock_irqrestore(&qce->lock, flags);
+
+		ret = slot->ops->async_req_start(slot->req);
+		if (ret)
+			qce->async_req_done(qce, ret);
+
+		return;
 	}
 
-	return ret;
+	spin_unlock_irqrestore(&qce->lock, flags);
+
+	if (failed)
+		tasklet_schedule(&qce->done_tasklet);
 }
 
 static int qce_handle_queue(struct qce_device *qce,
 			    struct crypto_async_request *req)
 {
 	struct crypto_async_request *async_req, *backlog;
+	const struct qce_algo_ops *ops;
+	struct qce_req_slot *slot;
 	unsigned long flags;
 	int ret = 0, err;
 
@@ -88,33 +153,41 @@ static int qce_handle_queue(struct qce_device *qce,
 	if (req)
 		ret = crypto_enqueue_request(&qce->queue, req);
 
-	/* busy, do not dequeue request */
-	if (qce->req) {
-		spin_unlock_irqrestore(&qce->lock, flags);
-		return ret;
-	}
-
-	backlog = crypto_get_backlog(&qce->queue);
-	async_req = crypto_dequeue_request(&qce->queue);
-	if (async_req)
-		qce->req = async_req;
+	/* dequeue requests while there are free slots */
+	while (qce->req_head - qce->req_tail < QCE_MAX_REQS) {
+		backlog = crypto_get_backlog(&qce->queue);
+		async_req = crypto_dequeue_request(&qce->queue);
+		if (!async_req)
+			break;
 
-	spin_unlock_irqrestore(&qce->lock, flags);
+		slot = qce_slot(qce, qce->req_head++);
+		slot->req = async_req;
+		slot->state = QCE_REQ_PREPARING;
 
-	if (!async_req)
-		return ret;
+		spin_unlock_irqrestore(&qce->lock, flags);
 
-	if (backlog) {
-		spin_lock_bh(&qce->lock);
-		backlog->complete(backlog, -EINPROGRESS);
-		spin_unlock_bh(&qce->lock);
+		if (backlog) {
+			spin_lock_bh(&qce->lock);
+			backlog->complete(backlog, -EINPROGRESS);
+			spin_unlock_bh(&qce->lock);
+		}
+
+		ops = qce_find_ops(crypto_tfm_alg_type(async_req->tfm));
+		if (ops)
+			err = ops->async_req_prepare(async_req,
+						     slot->result_buf);
+		else
+			err = -EINVAL;
+
+		spin_lock_irqsave(&qce->lock, flags);
+		slot->ops = ops;
+		slot->result = err;
+		slot->state = err ? QCE_REQ_FAILED : QCE_REQ_PREPARED;
 	}
 
-	err = qce_handle_request(async_req);
-	if (err) {
-		qce->result = err;
-		tasklet_schedule(&qce->done_tasklet);
-	}
+	spin_unlock_irqrestore(&qce->lock, flags);
+
+	qce_start_next(qce);
 
 	return ret;
 }
@@ -123,15 +196,35 @@ static void qce_tasklet_req_done(unsigned long data)
 {
 	struct qce_device *qce = (struct qce_device *)data;
 	struct crypto_async_request *req;
+	struct qce_req_slot *slot;
 	unsigned long flags;
+	int result;
 
 	spin_lock_irqsave(&qce->lock, flags);
-	req = qce->req;
-	qce->req = NULL;
-	spin_unlock_irqrestore(&qce->lock, flags);
 
-	if (req)
-		req->complete(req, qce->result);
+	while (qce->req_tail != qce->req_start) {
+		slot = qce_slot(qce, qce->req_tail);
+		if (slot->state == QCE_REQ_RUNNING)
+			break;
+
+		spin_unlock_irqrestore(&qce->lock, flags);
+
+		req = slot->req;
+		result = slot->result;
+		if (slot->state == QCE_REQ_DONE)
+			result = slot->ops->async_req_finish(req, result);
+
+		spin_lock_irqsave(&qce->lock, flags);
+		slot->req = NULL;
+		qce->req_tail++;
+		spin_unlock_irqrestore(&qce->lock, flags);
+
+		req->complete(req, result);
+
+		spin_lock_irqsave(&qce->lock, flags);
+	}
+
+	spin_unlock_irqrestore(&qce->lock, flags);
 
 	qce_handle_queue(qce, NULL);
 }
@@ -144,10 +237,167 @@ static int qce_async_request_enqueue(struct qce_device *qce,
 
 static void qce_async_request_done(struct qce_device *qce, int ret)
 {
-	qce->result = ret;
+	struct qce_req_slot *slot;
+	unsigned long flags;
+
+	spin_lock_irqsave(&qce->lock, flags);
+	slot = qce_slot(qce, qce->req_start - 1);
+	slot->result = ret;
+	slot->state = QCE_REQ_DONE;
+	qce->busy = false;
+	spin_unlock_irqrestore(&qce->lock, flags);
+
+	/* keep the engine busy before reporting the result */
+	qce_start_next(qce);
+
 	tasklet_schedule(&qce->done_tasklet);
 }
 
+struct qce_calib_result {
+	struct completion completion;
+	int error;
+};
+
+static void qce_calib_complete(struct crypto_async_request *req, int error)
+{
+	struct qce_calib_result *result = req->data;
+
+	if (error == -EINPROGRESS)
+		return;
+
+	result->error = error;
+	complete(&result->completion);
+}
+
+/* returns the fastest of a few encryptions of len bytes, in ns */
+static s64 qce_calib_time(struct crypto_ablkcipher *tfm, void *buf,
+			  unsigned int len)
+{
+	struct ablkcipher_request *req;
+	struct qce_calib_result result;
+	u8 iv[AES_BLOCK_SIZE] = {0};
+	struct scatterlist sg;
+	s64 best = S64_MAX, t;
+	ktime_t start;
+	int i, ret;
+
+	req = ablkcipher_request_alloc(tfm, GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+
+	ablkcipher_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					qce_calib_complete, &result);
+	sg_init_one(&sg, buf, len);
+
+	for (i = 0; i < QCE_CALIB_ROUNDS; i++) {
+		init_completion(&result.completion);
+		ablkcipher_request_set_crypt(req, &sg, &sg, len, iv);
+
+		start = ktime_get();
+		ret = crypto_ablkcipher_encrypt(req);
+		if (ret == -EINPROGRESS || ret == -EBUSY) {
+			wait_for_completion(&result.completion);
+			ret = result.error;
+		}
+		t = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		if (ret) {
+			best = ret;
+			break;
+		}
+
+		best = min(best, t);
+	}
+
+	ablkcipher_request_free(req);
+
+	return best;
+}
+
+/**
+ * qce_calibrate_fallback - find the size from which the engine is faster
+ * @qce: crypto engine device
+ *
+ * Compares cbc(aes) on the engine with the cpu implementation the
+ * algorithms fall back to, over doubling request sizes. Returns the first
+ * size at which the engine wins.
+ */
+static unsigned int qce_calibrate_fallback(struct qce_device *qce)
+{
+	static const u8 key[AES_KEYSIZE_128];
+	struct crypto_ablkcipher *hw, *sw;
+	unsigned int len = 0;
+	s64 hw_ns, sw_ns;
+	void *buf;
+
+	hw = crypto_alloc_ablkcipher("cbc-aes-qce", 0, 0);
+	if (IS_ERR(hw))
+		return 0;
+
+	sw = crypto_alloc_ablkcipher("cbc(aes)", 0,
+				     CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(sw))
+		goto out_free_hw;
+
+	buf = kzalloc(QCE_CALIB_MAX_LEN, GFP_KERNEL);
+	if (!buf)
+		goto out_free_sw;
+
+	if (crypto_ablkcipher_setkey(hw, key, sizeof(key)) ||
+	    crypto_ablkcipher_setkey(sw, key, sizeof(key)))
+		goto out_free_buf;
+
+	for (len = QCE_CALIB_MIN_LEN; len < QCE_CALIB_MAX_LEN; len <<= 1) {
+		hw_ns = qce_calib_time(hw, buf, len);
+		sw_ns = qce_calib_time(sw, buf, len);
+		if (hw_ns < 0 || sw_ns < 0) {
+			len = 0;
+			break;
+		}
+
+		dev_dbg(qce->dev, "%u bytes: engine %lld ns, cpu %lld ns\n",
+			len, hw_ns, sw_ns);
+
+		if (hw_ns <= sw_ns)
+			break;
+	}
+
+out_free_buf:
+	kfree(buf);
+out_free_sw:
+	crypto_free_ablkcipher(sw);
+out_free_hw:
+	crypto_free_ablkcipher(hw);
+	return len;
+}
+
+static ssize_t fallback_threshold_show(struct device *dev,
+				       struct device_attribute *attr,
+				       char *buf)
+{
+	struct qce_device *qce = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", qce->fallback_threshold);
+}
+
+static ssize_t fallback_threshold_store(struct device *dev,
+					struct device_attribute *attr,
+					const char *buf, size_t count)
+{
+	struct qce_device *qce = dev_get_drvdata(dev);
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	WRITE_ONCE(qce->fallback_threshold, val);
+
+	return count;
+}
+static DEVICE_ATTR_RW(fallback_threshold);
+
 static int qce_check_version(struct qce_device *qce)
 {
 	u32 major, minor, step;
@@ -175,7 +425,7 @@ static int qce_crypto_probe(struct platform_device *pdev)
 	struct device *dev = &pdev->dev;
 	struct qce_device *qce;
 	struct resource *res;
-	int ret;
+	int ret, i;
 
 	qce = devm_kzalloc(dev, sizeof(*qce), GFP_KERNEL);
 	if (!qce)
@@ -225,6 +475,10 @@ static int qce_crypto_probe(struct platform_device *pdev)
 	if (ret)
 		goto err_clks;
 
+	for (i = 0; i < QCE_MAX_REQS; i++)
+		qce->slots[i].result_buf = (void *)qce->dma.result_buf +
+					   i * QCE_RESULT_BUF_SZ;
+
 	spin_lock_init(&qce->lock);
 	tasklet_init(&qce->done_tasklet, qce_tasklet_req_done,
 		     (unsigned long)qce);
@@ -237,8 +491,23 @@ static int qce_crypto_probe(struct platform_device *pdev)
 	if (ret)
 		goto err_dma;
 
+	if (fallback_threshold < 0) {
+		qce->fallback_threshold = qce_calibrate_fallback(qce);
+		dev_info(dev, "cpu fallback below %u bytes\n",
+			 qce->fallback_threshold);
+	} else {
+		qce->fallback_threshold = fallback_threshold;
+	}
+
+	ret = device_create_file(dev, &dev_attr_fallback_threshold);
+	if (ret)
+		goto err_algs;
+
 	return 0;
 
+err_algs:
+	qce_unregister_algs(qce);
+
 err_dma:
 	qce_dma_release(&qce->dma);
 err_clks:
@@ -254,6 +523,7 @@ static int qce_crypto_remove(struct platform_device *pdev)
 {
 	struct qce_device *qce = platform_get_drvdata(pdev);
 
+	device_remove_file(qce->dev, &dev_attr_fallback_threshold);
 	tasklet_kill(&qce->done_tasklet);
 	qce_unregister_algs(qce);
 	qce_dma_release(&qce->dma);
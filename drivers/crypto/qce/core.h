@@ -16,13 +16,48 @@
 
 #include "dma.h"
 
+/**
+ * enum qce_req_state - pipeline state of a request
+ * @QCE_REQ_PREPARING: buffers of the request are being mapped
+ * @QCE_REQ_PREPARED: the request is ready to be started on the engine
+ * @QCE_REQ_RUNNING: the engine is processing the request
+ * @QCE_REQ_DONE: the engine finished, result not yet reported
+ * @QCE_REQ_FAILED: the request failed setup and owns no resources
+ */
+enum qce_req_state {
+	QCE_REQ_PREPARING,
+	QCE_REQ_PREPARED,
+	QCE_REQ_RUNNING,
+	QCE_REQ_DONE,
+	QCE_REQ_FAILED,
+};
+
+/**
+ * struct qce_req_slot - request in flight
+ * @req: the request
+ * @ops: algorithm operations handling the request
+ * @result_buf: result dump buffer owned by the request
+ * @state: pipeline state of the request
+ * @result: result of the transform
+ */
+struct qce_req_slot {
+	struct crypto_async_request *req;
+	const struct qce_algo_ops *ops;
+	struct qce_result_dump *result_buf;
+	enum qce_req_state state;
+	int result;
+};
+
 /**
  * struct qce_device - crypto engine device structure
  * @queue: crypto request queue
- * @lock: the lock protects queue and req
+ * @lock: the lock protects queue and the request slots
  * @done_tasklet: done tasklet object
- * @req: current active request
- * @result: result of current transform
+ * @slots: requests in flight, in order of dequeueing
+ * @req_head: counter of the next slot to receive a dequeued request
+ * @req_start: counter of the next slot to be started on the engine
+ * @req_tail: counter of the oldest slot not yet completed
+ * @busy: the engine is processing the request before @req_start
  * @base: virtual IO base
  * @dev: pointer to device structure
  * @core: core device clock
@@ -31,21 +66,27 @@
  * @dma: pointer to dma data
  * @burst_size: the crypto burst size
  * @pipe_pair_id: which pipe pair id the device using
+ * @fallback_threshold: requests smaller than this are done by the cpu
  * @async_req_enqueue: invoked by every algorithm to enqueue a request
- * @async_req_done: invoked by every algorithm to finish its request
+ * @async_req_done: invoked by every algorithm when the engine finished its
+ *		    request
  */
 struct qce_device {
 	struct crypto_queue queue;
 	spinlock_t lock;
 	struct tasklet_struct done_tasklet;
-	struct crypto_async_request *req;
-	int result;
+	struct qce_req_slot slots[QCE_MAX_REQS];
+	unsigned int req_head;
+	unsigned int req_start;
+	unsigned int req_tail;
+	bool busy;
 	void __iomem *base;
 	struct device *dev;
 	struct clk *core, *iface, *bus;
 	struct qce_dma_data dma;
 	int burst_size;
 	unsigned int pipe_pair_id;
+	unsigned int fallback_threshold;
 	int (*async_req_enqueue)(struct qce_device *qce,
 				 struct crypto_async_request *req);
 	void (*async_req_done)(struct qce_device *qce, int ret);
@@ -56,13 +97,22 @@ struct qce_device {
  * @type: should be CRYPTO_ALG_TYPE_XXX
  * @register_algs: invoked by core to register the algorithms
  * @unregister_algs: invoked by core to unregister the algorithms
- * @async_req_handle: invoked by core to handle enqueued request
+ * @async_req_prepare: invoked by core to map the buffers of a dequeued
+ *		       request, possibly while the engine is busy
+ * @async_req_start: invoked by core to start a prepared request on the
+ *		     idle engine
+ * @async_req_finish: invoked by core to release the buffers of a started
+ *		      request, returning its final result
  */
 struct qce_algo_ops {
 	u32 type;
 	int (*register_algs)(struct qce_device *qce);
 	void (*unregister_algs)(struct qce_device *qce);
-	int (*async_req_handle)(struct crypto_async_request *async_req);
+	int (*async_req_prepare)(struct crypto_async_request *async_req,
+				 struct qce_result_dump *result_buf);
+	int (*async_req_start)(struct crypto_async_request *async_req);
+	int (*async_req_finish)(struct crypto_async_request *async_req,
+				int result);
 };
 
 #endif /* _CORE_H_ */
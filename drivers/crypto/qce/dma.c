@@ -30,14 +30,15 @@ int qce_dma_request(struct device *dev, struct qce_dma_data *dma)
 		goto error_rx;
 	}
 
-	dma->result_buf = kmalloc(QCE_RESULT_BUF_SZ + QCE_IGNORE_BUF_SZ,
-				  GFP_KERNEL);
+	dma->result_buf = kmalloc(QCE_MAX_REQS * QCE_RESULT_BUF_SZ +
+				  QCE_IGNORE_BUF_SZ, GFP_KERNEL);
 	if (!dma->result_buf) {
 		ret = -ENOMEM;
 		goto error_nomem;
 	}
 
-	dma->ignore_buf = dma->result_buf + QCE_RESULT_BUF_SZ;
+	dma->ignore_buf = (void *)dma->result_buf +
+			  QCE_MAX_REQS * QCE_RESULT_BUF_SZ;
 
 	return 0;
 error_nomem:
@@ -55,9 +56,11 @@ void qce_dma_release(struct qce_dma_data *dma)
 }
 
 struct scatterlist *
-qce_sgtable_add(struct sg_table *sgt, struct scatterlist *new_sgl)
+qce_sgtable_add(struct sg_table *sgt, struct scatterlist *new_sgl,
+		unsigned int max_len)
 {
 	struct scatterlist *sg = sgt->sgl, *sg_last = NULL;
+	unsigned int len;
 
 	while (sg) {
 		if (!sg_page(sg))
@@ -68,9 +71,10 @@ qce_sgtable_add(struct sg_table *sgt, struct scatterlist *new_sgl)
 	if (!sg)
 		return ERR_PTR(-EINVAL);
 
-	while (new_sgl && sg) {
-		sg_set_page(sg, sg_page(new_sgl), new_sgl->length,
-			    new_sgl->offset);
+	while (new_sgl && sg && max_len) {
+		len = min(new_sgl->length, max_len);
+		sg_set_page(sg, sg_page(new_sgl), len, new_sgl->offset);
+		max_len -= len;
 		sg_last = sg;
 		sg = sg_next(sg);
 		new_sgl = sg_next(new_sgl);
@@ -37,43 +37,22 @@ static const u32 std_iv_sha256[SHA256_DIGEST_SIZE / sizeof(u32)] = {
 static void qce_ahash_done(void *data)
 {
 	struct crypto_async_request *async_req = data;
-	struct ahash_request *req = ahash_request_cast(async_req);
-	struct crypto_ahash *ahash = crypto_ahash_reqtfm(req);
-	struct qce_sha_reqctx *rctx = ahash_request_ctx(req);
 	struct qce_alg_template *tmpl = to_ahash_tmpl(async_req->tfm);
 	struct qce_device *qce = tmpl->qce;
-	struct qce_result_dump *result = qce->dma.result_buf;
-	unsigned int digestsize = crypto_ahash_digestsize(ahash);
 	int error;
 	u32 status;
 
-	error = qce_dma_terminate_all(&qce->dma);
-	if (error)
-		dev_dbg(qce->dev, "ahash dma termination error (%d)\n", error);
-
-	dma_unmap_sg(qce->dev, req->src, rctx->src_nents, DMA_TO_DEVICE);
-	dma_unmap_sg(qce->dev, &rctx->result_sg, 1, DMA_FROM_DEVICE);
-
-	memcpy(rctx->digest, result->auth_iv, digestsize);
-	if (req->result)
-		memcpy(req->result, result->auth_iv, digestsize);
-
-	rctx->byte_count[0] = cpu_to_be32(result->auth_byte_count[0]);
-	rctx->byte_count[1] = cpu_to_be32(result->auth_byte_count[1]);
-
 	error = qce_check_status(qce, &status);
-	if (error < 0)
+	if (error < 0) {
 		dev_dbg(qce->dev, "ahash operation error (%x)\n", status);
-
-	req->src = rctx->src_orig;
-	req->nbytes = rctx->nbytes_orig;
-	rctx->last_blk = false;
-	rctx->first_blk = false;
+		qce_dma_terminate_all(&qce->dma);
+	}
 
 	qce->async_req_done(tmpl->qce, error);
 }
 
-static int qce_ahash_async_req_handle(struct crypto_async_request *async_req)
+static int qce_ahash_async_req_prepare(struct crypto_async_request *async_req,
+				       struct qce_result_dump *result_buf)
 {
 	struct ahash_request *req = ahash_request_cast(async_req);
 	struct qce_sha_reqctx *rctx = ahash_request_ctx(req);
@@ -96,32 +75,68 @@ static int qce_ahash_async_req_handle(struct crypto_async_request *async_req)
 	if (ret < 0)
 		return ret;
 
-	sg_init_one(&rctx->result_sg, qce->dma.result_buf, QCE_RESULT_BUF_SZ);
+	sg_init_one(&rctx->result_sg, result_buf, QCE_RESULT_BUF_SZ);
 
 	ret = dma_map_sg(qce->dev, &rctx->result_sg, 1, DMA_FROM_DEVICE);
 	if (ret < 0)
 		goto error_unmap_src;
 
+	return 0;
+
+error_unmap_src:
+	dma_unmap_sg(qce->dev, req->src, rctx->src_nents, DMA_TO_DEVICE);
+	return ret;
+}
+
+static int qce_ahash_async_req_start(struct crypto_async_request *async_req)
+{
+	struct ahash_request *req = ahash_request_cast(async_req);
+	struct qce_sha_reqctx *rctx = ahash_request_ctx(req);
+	struct qce_alg_template *tmpl = to_ahash_tmpl(async_req->tfm);
+	struct qce_device *qce = tmpl->qce;
+	int ret;
+
 	ret = qce_dma_prep_sgs(&qce->dma, req->src, rctx->src_nents,
 			       &rctx->result_sg, 1, qce_ahash_done, async_req);
 	if (ret)
-		goto error_unmap_dst;
+		return ret;
 
 	qce_dma_issue_pending(&qce->dma);
 
 	ret = qce_start(async_req, tmpl->crypto_alg_type, 0, 0);
 	if (ret)
-		goto error_terminate;
+		qce_dma_terminate_all(&qce->dma);
 
-	return 0;
+	return ret;
+}
+
+static int qce_ahash_async_req_finish(struct crypto_async_request *async_req,
+				      int result)
+{
+	struct ahash_request *req = ahash_request_cast(async_req);
+	struct crypto_ahash *ahash = crypto_ahash_reqtfm(req);
+	struct qce_sha_reqctx *rctx = ahash_request_ctx(req);
+	struct qce_alg_template *tmpl = to_ahash_tmpl(async_req->tfm);
+	struct qce_device *qce = tmpl->qce;
+	struct qce_result_dump *result_buf = sg_virt(&rctx->result_sg);
+	unsigned int digestsize = crypto_ahash_digestsize(ahash);
 
-error_terminate:
-	qce_dma_terminate_all(&qce->dma);
-error_unmap_dst:
-	dma_unmap_sg(qce->dev, &rctx->result_sg, 1, DMA_FROM_DEVICE);
-error_unmap_src:
 	dma_unmap_sg(qce->dev, req->src, rctx->src_nents, DMA_TO_DEVICE);
-	return ret;
+	dma_unmap_sg(qce->dev, &rctx->result_sg, 1, DMA_FROM_DEVICE);
+
+	memcpy(rctx->digest, result_buf->auth_iv, digestsize);
+	if (req->result)
+		memcpy(req->result, result_buf->auth_iv, digestsize);
+
+	rctx->byte_count[0] = cpu_to_be32(result_buf->auth_byte_count[0]);
+	rctx->byte_count[1] = cpu_to_be32(result_buf->auth_byte_count[1]);
+
+	req->src = rctx->src_orig;
+	req->nbytes = rctx->nbytes_orig;
+	rctx->last_blk = false;
+	rctx->first_blk = false;
+
+	return result;
 }
 
 static int qce_ahash_init(struct ahash_request *req)
@@ -328,10 +343,26 @@ static int qce_ahash_final(struct ahash_request *req)
 static int qce_ahash_digest(struct ahash_request *req)
 {
 	struct qce_sha_reqctx *rctx = ahash_request_ctx(req);
+	struct qce_sha_ctx *ctx = crypto_tfm_ctx(req->base.tfm);
 	struct qce_alg_template *tmpl = to_ahash_tmpl(req->base.tfm);
 	struct qce_device *qce = tmpl->qce;
+	struct ahash_request *subreq = &rctx->fallback_req;
 	int ret;
 
+	/*
+	 * Small one-shot digests are cheaper on the cpu than the dma setup
+	 * and interrupt round trip. Multi-part hashes keep their state in the
+	 * engine format and always use the engine.
+	 */
+	if (req->nbytes < qce->fallback_threshold) {
+		ahash_request_set_tfm(subreq, ctx->fallback);
+		ahash_request_set_callback(subreq, req->base.flags,
+					   req->base.complete, req->base.data);
+		ahash_request_set_crypt(subreq, req->src, req->result,
+					req->nbytes);
+		return crypto_ahash_digest(subreq);
+	}
+
 	ret = qce_ahash_init(req);
 	if (ret)
 		return ret;
@@ -374,6 +405,10 @@ static int qce_ahash_hmac_setkey(struct crypto_ahash *tfm, const u8 *key,
 	int ret;
 	const char *alg_name;
 
+	ret = crypto_ahash_setkey(ctx->fallback, key, keylen);
+	if (ret)
+		return ret;
+
 	blocksize = crypto_tfm_alg_blocksize(crypto_ahash_tfm(tfm));
 	memset(ctx->authkey, 0, sizeof(ctx->authkey));
 
@@ -438,11 +473,26 @@ static int qce_ahash_cra_init(struct crypto_tfm *tfm)
 	struct crypto_ahash *ahash = __crypto_ahash_cast(tfm);
 	struct qce_sha_ctx *ctx = crypto_tfm_ctx(tfm);
 
-	crypto_ahash_set_reqsize(ahash, sizeof(struct qce_sha_reqctx));
 	memset(ctx, 0, sizeof(*ctx));
+
+	ctx->fallback = crypto_alloc_ahash(crypto_tfm_alg_name(tfm), 0,
+					   CRYPTO_ALG_ASYNC |
+					   CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->fallback))
+		return PTR_ERR(ctx->fallback);
+
+	crypto_ahash_set_reqsize(ahash, sizeof(struct qce_sha_reqctx) +
+				 crypto_ahash_reqsize(ctx->fallback));
 	return 0;
 }
 
+static void qce_ahash_cra_exit(struct crypto_tfm *tfm)
+{
+	struct qce_sha_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_ahash(ctx->fallback);
+}
+
 struct qce_ahash_def {
 	unsigned long flags;
 	const char *name;
@@ -521,11 +571,12 @@ static int qce_ahash_register_one(const struct qce_ahash_def *def,
 	base = &alg->halg.base;
 	base->cra_blocksize = def->blocksize;
 	base->cra_priority = 300;
-	base->cra_flags = CRYPTO_ALG_ASYNC;
+	base->cra_flags = CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK;
 	base->cra_ctxsize = sizeof(struct qce_sha_ctx);
 	base->cra_alignmask = 0;
 	base->cra_module = THIS_MODULE;
 	base->cra_init = qce_ahash_cra_init;
+	base->cra_exit = qce_ahash_cra_exit;
 	INIT_LIST_HEAD(&base->cra_list);
 
 	snprintf(base->cra_name, CRYPTO_MAX_ALG_NAME, "%s", def->name);
@@ -580,5 +631,7 @@ const struct qce_algo_ops ahash_ops = {
 	.type = CRYPTO_ALG_TYPE_AHASH,
 	.register_algs = qce_ahash_register,
 	.unregister_algs = qce_ahash_unregister,
-	.async_req_handle = qce_ahash_async_req_handle,
+	.async_req_prepare = qce_ahash_async_req_prepare,
+	.async_req_start = qce_ahash_async_req_start,
+	.async_req_finish = qce_ahash_async_req_finish,
 };
@@ -25,6 +25,7 @@
 
 struct qce_sha_ctx {
 	u8 authkey[QCE_SHA_MAX_BLOCKSIZE];
+	struct crypto_ahash *fallback;
 };
 
 /**
@@ -45,6 +46,7 @@ struct qce_sha_ctx {
  * @authkey: pointer to auth key in sha ctx
  * @authklen: auth key length
  * @result_sg: scatterlist used for result buffer
+ * @fallback_req: request to the software fallback, must be last
  */
 struct qce_sha_reqctx {
 	u8 buf[QCE_SHA_MAX_BLOCKSIZE];
@@ -63,6 +65,7 @@ struct qce_sha_reqctx {
 	u8 *authkey;
 	unsigned int authklen;
 	struct scatterlist result_sg;
+	struct ahash_request fallback_req;
 };
 
 static inline struct qce_alg_template *to_ahash_tmpl(struct crypto_tfm *tfm)
@@ -0,0 +1,303 @@
+/*
+ *  linux/drivers/devfreq/governor_memlat.c
+ *
+ * Memory latency governor: votes for a device frequency (typically a DDR
+ * bandwidth) according to how memory latency bound the CPUs are.
+ *
+ * Every polling interval the number of instructions retired and cache
+ * misses of each monitored CPU is read from per-CPU perf counters. A CPU
+ * retiring fewer than ratio_ceil instructions per miss is stalling on
+ * memory, and the faster such a CPU runs the more it gains from a faster
+ * memory: the highest CPU frequency among them is mapped to a device
+ * frequency through the core to device table of the devfreq device.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/devfreq.h>
+#include <linux/errno.h>
+#include <linux/list.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/perf_event.h>
+#include <linux/slab.h>
+#include "governor.h"
+
+/* Default instructions per miss below which a CPU is latency bound */
+#define MEMLAT_RATIO_CEIL	(400)
+
+struct memlat_cpu {
+	struct perf_event	*inst;
+	struct perf_event	*miss;
+	u64			prev_inst;
+	u64			prev_miss;
+};
+
+struct memlat_node {
+	struct list_head	list;
+	struct devfreq		*df;
+	struct memlat_cpu	*cpu;	/* indexed by cpu number */
+};
+
+static LIST_HEAD(memlat_list);
+static DEFINE_MUTEX(memlat_lock);
+
+static struct memlat_node *memlat_find(struct devfreq *df)
+{
+	struct memlat_node *node;
+
+	list_for_each_entry(node, &memlat_list, list)
+		if (node->df == df)
+			return node;
+
+	return NULL;
+}
+
+static struct perf_event *memlat_create_event(int cpu, u32 type, u64 config)
+{
+	struct perf_event_attr attr = {
+		.type		= type,
+		.size		= sizeof(attr),
+		.config		= config,
+		.pinned		= 1,
+	};
+
+	return perf_event_create_kernel_counter(&attr, cpu, NULL, NULL, NULL);
+}
+
+static void memlat_release_cpu(struct memlat_cpu *mc)
+{
+	if (mc->inst)
+		perf_event_release_kernel(mc->inst);
+	if (mc->miss)
+		perf_event_release_kernel(mc->miss);
+	mc->inst = NULL;
+	mc->miss = NULL;
+}
+
+static int memlat_create_cpu(struct devfreq_memlat_data *data,
+			     struct memlat_cpu *mc, int cpu)
+{
+	u64 enabled, running;
+
+	mc->inst = memlat_create_event(cpu, PERF_TYPE_HARDWARE,
+				       PERF_COUNT_HW_INSTRUCTIONS);
+	if (IS_ERR(mc->inst))
+		goto err_inst;
+
+	if (data->cachemiss_ev)
+		mc->miss = memlat_create_event(cpu, PERF_TYPE_RAW,
+					       data->cachemiss_ev);
+	else
+		mc->miss = memlat_create_event(cpu, PERF_TYPE_HARDWARE,
+					       PERF_COUNT_HW_CACHE_MISSES);
+	if (IS_ERR(mc->miss))
+		goto err_miss;
+
+	mc->prev_inst = perf_event_read_value(mc->inst, &enabled, &running);
+	mc->prev_miss = perf_event_read_value(mc->miss, &enabled, &running);
+	return 0;
+
+err_miss:
+	mc->miss = NULL;
+	memlat_release_cpu(mc);
+	return -ENODEV;
+err_inst:
+	mc->inst = NULL;
+	return -ENODEV;
+}
+
+/*
+ * Read the counter deltas of @cpu since the last sample. Counters are
+ * created when a CPU comes online and dropped when it goes away, as perf
+ * does not bring back CPU bound events of an unplugged CPU.
+ */
+static int memlat_sample_cpu(struct devfreq_memlat_data *data,
+			     struct memlat_cpu *mc, int cpu,
+			     u64 *inst, u64 *miss)
+{
+	u64 enabled, running, cur_inst, cur_miss;
+
+	if (!cpu_online(cpu)) {
+		memlat_release_cpu(mc);
+		return -ENODEV;
+	}
+
+	/* A new counter has no history yet */
+	if (!mc->inst)
+		return memlat_create_cpu(data, mc, cpu) ? : -EAGAIN;
+
+	cur_inst = perf_event_read_value(mc->inst, &enabled, &running);
+	cur_miss = perf_event_read_value(mc->miss, &enabled, &running);
+
+	*inst = cur_inst - mc->prev_inst;
+	*miss = cur_miss - mc->prev_miss;
+	mc->prev_inst = cur_inst;
+	mc->prev_miss = cur_miss;
+
+	return 0;
+}
+
+static unsigned long memlat_map_freq(struct devfreq_memlat_data *data,
+				     unsigned int core_khz)
+{
+	unsigned int i;
+
+	if (!core_khz || !data->map_len)
+		return 0;
+
+	for (i = 0; i < data->map_len - 1; i++)
+		if (data->map[i].core_khz >= core_khz)
+			break;
+
+	return data->map[i].dev_freq;
+}
+
+static int devfreq_memlat_func(struct devfreq *df, unsigned long *freq)
+{
+	struct devfreq_memlat_data *data = df->data;
+	unsigned int ratio_ceil = MEMLAT_RATIO_CEIL;
+	unsigned int core_khz = 0;
+	struct memlat_node *node;
+	u64 inst, miss;
+	int cpu;
+
+	if (!data)
+		return -EINVAL;
+	if (data->ratio_ceil)
+		ratio_ceil = data->ratio_ceil;
+
+	mutex_lock(&memlat_lock);
+	node = memlat_find(df);
+	if (!node) {
+		mutex_unlock(&memlat_lock);
+		return -ENODEV;
+	}
+
+	for_each_cpu(cpu, &data->cpus) {
+		if (memlat_sample_cpu(data, &node->cpu[cpu], cpu, &inst, &miss))
+			continue;
+
+		/* Not latency bound, or not doing anything at all */
+		if (!miss || div64_u64(inst, miss) >= ratio_ceil)
+			continue;
+
+		core_khz = max(core_khz, cpufreq_quick_get(cpu));
+	}
+	mutex_unlock(&memlat_lock);
+
+	*freq = memlat_map_freq(data, core_khz);
+
+	if (df->min_freq && *freq < df->min_freq)
+		*freq = df->min_freq;
+	if (df->max_freq && *freq > df->max_freq)
+		*freq = df->max_freq;
+
+	return 0;
+}
+
+static int devfreq_memlat_start(struct devfreq *df)
+{
+	struct memlat_node *node;
+
+	if (!df->data)
+		return -EINVAL;
+
+	node = kzalloc(sizeof(*node), GFP_KERNEL);
+	if (!node)
+		return -ENOMEM;
+
+	node->cpu = kcalloc(nr_cpu_ids, sizeof(*node->cpu), GFP_KERNEL);
+	if (!node->cpu) {
+		kfree(node);
+		return -ENOMEM;
+	}
+	node->df = df;
+
+	mutex_lock(&memlat_lock);
+	list_add(&node->list, &memlat_list);
+	mutex_unlock(&memlat_lock);
+
+	devfreq_monitor_start(df);
+	return 0;
+}
+
+static void devfreq_memlat_stop(struct devfreq *df)
+{
+	struct memlat_node *node;
+	int cpu;
+
+	devfreq_monitor_stop(df);
+
+	mutex_lock(&memlat_lock);
+	node = memlat_find(df);
+	if (node)
+		list_del(&node->list);
+	mutex_unlock(&memlat_lock);
+
+	if (!node)
+		return;
+
+	for_each_possible_cpu(cpu)
+		memlat_release_cpu(&node->cpu[cpu]);
+	kfree(node->cpu);
+	kfree(node);
+}
+
+static int devfreq_memlat_handler(struct devfreq *devfreq,
+				unsigned int event, void *data)
+{
+	switch (event) {
+	case DEVFREQ_GOV_START:
+		return devfreq_memlat_start(devfreq);
+
+	case DEVFREQ_GOV_STOP:
+		devfreq_memlat_stop(devfreq);
+		break;
+
+	case DEVFREQ_GOV_INTERVAL:
+		devfreq_interval_update(devfreq, (unsigned int *)data);
+		break;
+
+	case DEVFREQ_GOV_SUSPEND:
+		devfreq_monitor_suspend(devfreq);
+		break;
+
+	case DEVFREQ_GOV_RESUME:
+		devfreq_monitor_resume(devfreq);
+		break;
+
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+static struct devfreq_governor devfreq_memlat = {
+	.name = "mem_latency",
+	.get_target_freq = devfreq_memlat_func,
+	.event_handler = devfreq_memlat_handler,
+};
+
+static int __init devfreq_memlat_init(void)
+{
+	return devfreq_add_governor(&devfreq_memlat);
+}
+subsys_initcall(devfreq_memlat_init);
+
+static void __exit devfreq_memlat_exit(void)
+{
+	int ret;
+
+	ret = devfreq_remove_governor(&devfreq_memlat);
+	if (ret)
+		pr_err("%s: failed remove governor %d\n", __func__, ret);
+}
+module_exit(devfreq_memlat_exit);
+MODULE_LICENSE("GPL");
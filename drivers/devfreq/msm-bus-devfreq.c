@@ -0,0 +1,238 @@
+/*
+ * A devfreq driver voting bus bandwidth through msm_bus
+ *
+ * The devfreq "frequency" of the device is the instantaneous bandwidth in
+ * MBps requested between a bus master and slave, typically the CPUs and
+ * DDR. Which bandwidth is requested is left to the devfreq governor; the
+ * mem_latency governor is configured from the device node as well.
+ *
+ * Device tree properties:
+ *  qcom,src-dst-ports	<master slave> msm_bus ids of the path to vote on
+ *  qcom,bw-tbl		ascending list of bandwidths in MBps
+ *  governor		devfreq governor name (default "mem_latency")
+ *  qcom,polling-ms	governor sampling interval (default 50)
+ * For the mem_latency governor:
+ *  qcom,core-dev-table	<CPU kHz, MBps> pairs, ascending
+ *  qcom,cpulist	phandles of the CPUs to monitor (default all)
+ *  qcom,ratio-ceil	instructions per miss below which a CPU is latency
+ *			bound (default governor value)
+ *  qcom,cachemiss-ev	raw PMU cache miss event (default generic event)
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ */
+
+#include <linux/devfreq.h>
+#include <linux/err.h>
+#include <linux/module.h>
+#include <linux/msm-bus.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+
+#define MSM_BUS_DEVFREQ_POLLING_MS	50
+
+struct msm_bus_devfreq {
+	struct devfreq			*devfreq;
+	struct devfreq_dev_profile	profile;
+	struct msm_bus_client_handle	*cl;
+	unsigned long			cur_mbps;
+#if IS_ENABLED(CONFIG_DEVFREQ_GOV_MEMLAT)
+	struct devfreq_memlat_data	memlat;
+#endif
+};
+
+static int msm_bus_devfreq_target(struct device *dev, unsigned long *freq,
+				  u32 flags)
+{
+	struct msm_bus_devfreq *bd = dev_get_drvdata(dev);
+	unsigned long mbps;
+	unsigned int i;
+	int ret;
+
+	/* Lowest bandwidth at or above the request, or the maximum */
+	for (i = 0; i < bd->profile.max_state - 1; i++)
+		if (bd->profile.freq_table[i] >= *freq)
+			break;
+	mbps = bd->profile.freq_table[i];
+
+	if (mbps != bd->cur_mbps) {
+		ret = msm_bus_scale_update_bw(bd->cl, 0, (u64)mbps * SZ_1M);
+		if (ret) {
+			dev_err(dev, "failed to vote %lu MBps: %d\n", mbps, ret);
+			return ret;
+		}
+		bd->cur_mbps = mbps;
+	}
+
+	*freq = mbps;
+	return 0;
+}
+
+static int msm_bus_devfreq_get_cur_freq(struct device *dev,
+					unsigned long *freq)
+{
+	struct msm_bus_devfreq *bd = dev_get_drvdata(dev);
+
+	*freq = bd->cur_mbps;
+	return 0;
+}
+
+#if IS_ENABLED(CONFIG_DEVFREQ_GOV_MEMLAT)
+static int msm_bus_devfreq_parse_memlat(struct device *dev,
+					struct devfreq_memlat_data *data)
+{
+	struct device_node *np = dev->of_node;
+	struct device_node *cpu_np;
+	unsigned int i;
+	int len, cpu;
+	u32 *tbl;
+
+	len = of_property_count_u32_elems(np, "qcom,core-dev-table");
+	if (len <= 0 || len % 2) {
+		dev_err(dev, "invalid qcom,core-dev-table\n");
+		return -EINVAL;
+	}
+
+	tbl = devm_kcalloc(dev, len, sizeof(*tbl), GFP_KERNEL);
+	data->map = devm_kcalloc(dev, len / 2, sizeof(*data->map),
+				 GFP_KERNEL);
+	if (!tbl || !data->map)
+		return -ENOMEM;
+
+	of_property_read_u32_array(np, "qcom,core-dev-table", tbl, len);
+	for (i = 0; i < len / 2; i++) {
+		data->map[i].core_khz = tbl[2 * i];
+		data->map[i].dev_freq = tbl[2 * i + 1];
+	}
+	data->map_len = len / 2;
+
+	of_property_read_u32(np, "qcom,ratio-ceil", &data->ratio_ceil);
+	of_property_read_u32(np, "qcom,cachemiss-ev", &data->cachemiss_ev);
+
+	cpumask_clear(&data->cpus);
+	for (i = 0; (cpu_np = of_parse_phandle(np, "qcom,cpulist", i)); i++) {
+		for_each_possible_cpu(cpu) {
+			struct device_node *node = of_get_cpu_node(cpu, NULL);
+
+			if (node == cpu_np)
+				cpumask_set_cpu(cpu, &data->cpus);
+			of_node_put(node);
+		}
+		of_node_put(cpu_np);
+	}
+	if (cpumask_empty(&data->cpus))
+		cpumask_copy(&data->cpus, cpu_possible_mask);
+
+	return 0;
+}
+#endif
+
+static int msm_bus_devfreq_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct device_node *np = dev->of_node;
+	const char *governor = "mem_latency";
+	struct msm_bus_devfreq *bd;
+	void *gov_data = NULL;
+	u32 ports[2];
+	int len, ret;
+
+	bd = devm_kzalloc(dev, sizeof(*bd), GFP_KERNEL);
+	if (!bd)
+		return -ENOMEM;
+
+	ret = of_property_read_u32_array(np, "qcom,src-dst-ports", ports, 2);
+	if (ret) {
+		dev_err(dev, "missing qcom,src-dst-ports\n");
+		return ret;
+	}
+
+	len = of_property_count_u32_elems(np, "qcom,bw-tbl");
+	if (len <= 0) {
+		dev_err(dev, "missing qcom,bw-tbl\n");
+		return -EINVAL;
+	}
+	bd->profile.freq_table = devm_kcalloc(dev, len,
+					      sizeof(*bd->profile.freq_table),
+					      GFP_KERNEL);
+	if (!bd->profile.freq_table)
+		return -ENOMEM;
+	of_property_read_u32_array(np, "qcom,bw-tbl", bd->profile.freq_table,
+				   len);
+	bd->profile.max_state = len;
+
+	bd->profile.polling_ms = MSM_BUS_DEVFREQ_POLLING_MS;
+	of_property_read_u32(np, "qcom,polling-ms", &bd->profile.polling_ms);
+	bd->profile.initial_freq = bd->profile.freq_table[0];
+	bd->profile.target = msm_bus_devfreq_target;
+	bd->profile.get_cur_freq = msm_bus_devfreq_get_cur_freq;
+
+	of_property_read_string(np, "governor", &governor);
+
+#if IS_ENABLED(CONFIG_DEVFREQ_GOV_MEMLAT)
+	if (!strcmp(governor, "mem_latency")) {
+		ret = msm_bus_devfreq_parse_memlat(dev, &bd->memlat);
+		if (ret)
+			return ret;
+		gov_data = &bd->memlat;
+	}
+#endif
+
+	bd->cl = msm_bus_scale_register(ports[0], ports[1],
+					(char *)dev_name(dev), false);
+	if (IS_ERR_OR_NULL(bd->cl)) {
+		ret = bd->cl ? PTR_ERR(bd->cl) : -ENXIO;
+		if (ret != -EPROBE_DEFER)
+			dev_err(dev, "bus client register failed: %d\n", ret);
+		return ret;
+	}
+
+	platform_set_drvdata(pdev, bd);
+
+	bd->devfreq = devfreq_add_device(dev, &bd->profile, governor,
+					 gov_data);
+	if (IS_ERR(bd->devfreq)) {
+		ret = PTR_ERR(bd->devfreq);
+		msm_bus_scale_unregister(bd->cl);
+		return ret;
+	}
+
+	return 0;
+}
+
+static int msm_bus_devfreq_remove(struct platform_device *pdev)
+{
+	struct msm_bus_devfreq *bd = platform_get_drvdata(pdev);
+
+	devfreq_remove_device(bd->devfreq);
+	msm_bus_scale_unregister(bd->cl);
+
+	return 0;
+}
+
+static const struct of_device_id msm_bus_devfreq_of_match[] = {
+	{ .compatible = "qcom,msm-bus-devfreq" },
+	{ },
+};
+MODULE_DEVICE_TABLE(of, msm_bus_devfreq_of_match);
+
+static struct platform_driver msm_bus_devfreq_driver = {
+	.probe	= msm_bus_devfreq_probe,
+	.remove	= msm_bus_devfreq_remove,
+	.driver	= {
+		.name		= "msm-bus-devfreq",
+		.of_match_table	= msm_bus_devfreq_of_match,
+	},
+};
+module_platform_driver(msm_bus_devfreq_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("msm_bus bandwidth devfreq driver");
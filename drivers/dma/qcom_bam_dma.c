@@ -30,8 +30,25 @@
  * P_EVNT_REG register to kick off the transaction.  The P_SW_OFSTS register
  * indicates the current FIFO offset that is being processed, so there is some
  * indication of where the hardware is currently working.
+ *
+ * Multiple transactions are queued to the FIFO back to back, as long as there
+ * is room, and are retired in order as the hardware reports their descriptors
+ * as processed. An interrupt is requested on the last descriptor of a
+ * transaction when the FIFO is full, when no further transactions are queued,
+ * or when the client asked for a completion callback. The latter can be
+ * moderated to every Nth transaction through the qcom,irq-coalesce property,
+ * in which case end of transfer interrupts are masked as well.
+ *
+ * Starting the next transactions and invoking the client callbacks is by
+ * default done from tasklets. A BAM may instead be configured to do this from
+ * its threaded interrupt handler (qcom,threaded-completion) or from a dedicated
+ * SCHED_FIFO thread (qcom,completion-thread-priority), isolating it from other
+ * softirq load. The latency from interrupt to callback is reported through the
+ * bam_dma_complete tracepoint and a histogram in debugfs.
  */
 
+#include <linux/circ_buf.h>
+#include <linux/debugfs.h>
 #include <linux/kernel.h>
 #include <linux/io.h>
 #include <linux/init.h>
@@ -48,6 +65,14 @@
 #include <linux/of_dma.h>
 #include <linux/clk.h>
 #include <linux/dmaengine.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/bam_dma.h>
 
 #include "dmaengine.h"
 #include "virt-dma.h"
@@ -74,6 +99,8 @@ struct bam_async_desc {
 
 	struct bam_desc_hw *curr_desc;
 
+	/* list node for the desc in the bam_chan list of descriptors */
+	struct list_head desc_node;
 	enum dma_transfer_direction dir;
 	size_t length;
 	struct bam_desc_hw desc[0];
@@ -342,8 +369,12 @@ static const struct reg_offset_data bam_v1_7_reg_info[] = {
 
 #define BAM_DESC_FIFO_SIZE	SZ_32K
 #define MAX_DESCRIPTORS (BAM_DESC_FIFO_SIZE / sizeof(struct bam_desc_hw) - 1)
+#define BAM_FIFO_ENTRIES	(MAX_DESCRIPTORS + 1)
 #define BAM_MAX_DATA_SIZE	(SZ_32K - 8)
 
+#define IS_BUSY(chan)	(CIRC_SPACE(chan->tail, chan->head, \
+				    BAM_FIFO_ENTRIES) == 0)
+
 struct bam_chan {
 	struct virt_dma_chan vc;
 
@@ -352,7 +383,14 @@ struct bam_chan {
 	/* configuration from device tree */
 	u32 id;
 
-	struct bam_async_desc *curr_txd;	/* current running dma */
+	/* transactions committed to the descriptor fifo, in order */
+	struct list_head desc_list;
+
+	/* transactions queued since the last interrupt was requested */
+	unsigned int irq_pending;
+
+	/* time of the interrupt completing the latest transactions */
+	ktime_t irq_time;
 
 	/* runtime configuration */
 	struct dma_slave_config slave;
@@ -377,6 +415,15 @@ static inline struct bam_chan *to_bam_chan(struct dma_chan *common)
 	return container_of(common, struct bam_chan, vc.chan);
 }
 
+enum bam_completion_mode {
+	BAM_COMPLETION_TASKLET,
+	BAM_COMPLETION_IRQ_THREAD,
+	BAM_COMPLETION_KTHREAD,
+};
+
+/* log2 buckets of irq to callback latency, in microseconds */
+#define BAM_LATENCY_BUCKETS	16
+
 struct bam_device {
 	void __iomem *regs;
 	struct device *dev;
@@ -388,6 +435,9 @@ struct bam_device {
 	/* execution environment ID, from DT */
 	u32 ee;
 
+	/* number of transactions with callbacks per interrupt, from DT */
+	u32 irq_coalesce;
+
 	const struct reg_offset_data *layout;
 
 	struct clk *bamclk;
@@ -395,6 +445,15 @@ struct bam_device {
 
 	/* dma start transaction tasklet */
 	struct tasklet_struct task;
+
+	/* context running completions, and if dedicated, its thread */
+	enum bam_completion_mode completion;
+	struct task_struct *completion_task;
+	struct kthread_worker completion_worker;
+	struct kthread_work completion_work;
+
+	atomic_long_t latency_hist[BAM_LATENCY_BUCKETS];
+	struct dentry *debugfs;
 };
 
 /**
@@ -461,9 +520,15 @@ static void bam_chan_init_hw(struct bam_chan *bchan,
 	writel_relaxed(BAM_DESC_FIFO_SIZE,
 			bam_addr(bdev, bchan->id, BAM_P_FIFO_SIZES));
 
-	/* enable the per pipe interrupts, enable EOT, ERR, and INT irqs */
-	writel_relaxed(P_DEFAULT_IRQS_EN,
-			bam_addr(bdev, bchan->id, BAM_P_IRQ_EN));
+	/*
+	 * enable the per pipe interrupts, enable EOT, ERR, and INT irqs, but
+	 * leave out EOT when interrupts are moderated through the INT flags
+	 */
+	if (bdev->irq_coalesce > 1)
+		val = P_DEFAULT_IRQS_EN & ~P_TRNSFR_END_EN;
+	else
+		val = P_DEFAULT_IRQS_EN;
+	writel_relaxed(val, bam_addr(bdev, bchan->id, BAM_P_IRQ_EN));
 
 	/* unmask the specific pipe and EE combo */
 	val = readl_relaxed(bam_addr(bdev, 0, BAM_IRQ_SRCS_MSK_EE));
@@ -485,6 +550,7 @@ static void bam_chan_init_hw(struct bam_chan *bchan,
 	/* init FIFO pointers */
 	bchan->head = 0;
 	bchan->tail = 0;
+	bchan->irq_pending = 0;
 }
 
 /**
@@ -529,7 +595,7 @@ static void bam_free_chan(struct dma_chan *chan)
 
 	vchan_free_chan_resources(to_virt_chan(chan));
 
-	if (bchan->curr_txd) {
+	if (!list_empty(&bchan->desc_list)) {
 		dev_err(bchan->bdev->dev, "Cannot free busy channel\n");
 		return;
 	}
@@ -618,8 +684,6 @@ static struct dma_async_tx_descriptor *bam_prep_slave_sg(struct dma_chan *chan,
 
 	if (flags & DMA_PREP_INTERRUPT)
 		async_desc->flags |= DESC_FLAG_EOT;
-	else
-		async_desc->flags |= DESC_FLAG_INT;
 
 	async_desc->num_desc = num_alloc;
 	async_desc->curr_desc = async_desc->desc;
@@ -666,14 +730,29 @@ err_out:
 static int bam_dma_terminate_all(struct dma_chan *chan)
 {
 	struct bam_chan *bchan = to_bam_chan(chan);
+	struct bam_async_desc *async_desc, *tmp;
 	unsigned long flag;
 	LIST_HEAD(head);
 
-	/* remove all transactions, including active transaction */
+	/* remove all transactions, including active transactions */
 	spin_lock_irqsave(&bchan->vc.lock, flag);
-	if (bchan->curr_txd) {
-		list_add(&bchan->curr_txd->vd.node, &bchan->vc.desc_issued);
-		bchan->curr_txd = NULL;
+
+	/*
+	 * Transactions committed to the descriptor fifo can only be dropped
+	 * by resetting the pipe, which bam_chan_init_hw() does before bringing
+	 * it back up; leaving the pipe disabled would trigger a fatal error
+	 * in the BAM if it is accessed by the connected peripheral.
+	 */
+	if (!list_empty(&bchan->desc_list)) {
+		async_desc = list_first_entry(&bchan->desc_list,
+					      struct bam_async_desc, desc_node);
+		bam_chan_init_hw(bchan, async_desc->dir);
+	}
+
+	list_for_each_entry_safe(async_desc, tmp, &bchan->desc_list,
+				 desc_node) {
+		list_add(&async_desc->vd.node, &bchan->vc.desc_issued);
+		list_del(&async_desc->desc_node);
 	}
 
 	vchan_get_all_descriptors(&bchan->vc, &head);
@@ -722,6 +801,90 @@ static int bam_resume(struct dma_chan *chan)
 	return 0;
 }
 
+/**
+ * bam_cookie_complete - mark transaction complete
+ * @bchan: bam dma channel
+ * @async_desc: the completed transaction
+ *
+ * Queues the transaction for its callback to be invoked, which is done from
+ * the channel's tasklet only when running completions in tasklets.
+ */
+static void bam_cookie_complete(struct bam_chan *bchan,
+				struct bam_async_desc *async_desc)
+{
+	dma_cookie_complete(&async_desc->vd.tx);
+	list_add_tail(&async_desc->vd.node, &bchan->vc.desc_completed);
+
+	if (bchan->bdev->completion == BAM_COMPLETION_TASKLET)
+		tasklet_schedule(&bchan->vc.task);
+}
+
+/**
+ * bam_latency_record - account irq to callback latency
+ * @bdev: bam controller
+ * @bchan: bam dma channel
+ * @irq_time: time of the interrupt that completed the transactions
+ */
+static void bam_latency_record(struct bam_device *bdev, struct bam_chan *bchan,
+			       ktime_t irq_time)
+{
+	u64 latency = ktime_to_ns(ktime_sub(ktime_get(), irq_time));
+	unsigned long us = div_u64(latency, NSEC_PER_USEC);
+	unsigned int bucket = 0;
+
+	trace_bam_dma_complete(bdev->dev, bchan->id, latency);
+
+	if (us)
+		bucket = min_t(unsigned int, ilog2(us),
+			       BAM_LATENCY_BUCKETS - 1);
+
+	atomic_long_inc(&bdev->latency_hist[bucket]);
+}
+
+/**
+ * bam_complete_descs - invoke callbacks of completed transactions
+ * @bchan: bam dma channel
+ *
+ * Frees the completed transactions of the channel and invokes their
+ * callbacks, equivalent to the virt-dma tasklet.
+ */
+static void bam_complete_descs(struct bam_chan *bchan)
+{
+	struct virt_dma_desc *vd, *tmp;
+	dma_async_tx_callback cb;
+	unsigned long flags;
+	ktime_t irq_time;
+	void *cb_data;
+	LIST_HEAD(head);
+
+	spin_lock_irqsave(&bchan->vc.lock, flags);
+	list_splice_tail_init(&bchan->vc.desc_completed, &head);
+	irq_time = bchan->irq_time;
+	spin_unlock_irqrestore(&bchan->vc.lock, flags);
+
+	if (list_empty(&head))
+		return;
+
+	bam_latency_record(bchan->bdev, bchan, irq_time);
+
+	list_for_each_entry_safe(vd, tmp, &head, node) {
+		cb = vd->tx.callback;
+		cb_data = vd->tx.callback_param;
+
+		list_del(&vd->node);
+
+		bchan->vc.desc_free(vd);
+
+		if (cb)
+			cb(cb_data);
+	}
+}
+
+static void bam_complete_tasklet(unsigned long data)
+{
+	bam_complete_descs((struct bam_chan *)data);
+}
+
 /**
  * process_channel_irqs - processes the channel interrupts
  * @bdev: bam controller
@@ -731,9 +894,9 @@ static int bam_resume(struct dma_chan *chan)
  */
 static u32 process_channel_irqs(struct bam_device *bdev)
 {
-	u32 i, srcs, pipe_stts;
+	u32 i, srcs, pipe_stts, offset, avail;
 	unsigned long flags;
-	struct bam_async_desc *async_desc;
+	struct bam_async_desc *async_desc, *tmp;
 
 	srcs = readl_relaxed(bam_addr(bdev, 0, BAM_IRQ_SRCS_EE));
 
@@ -753,16 +916,30 @@ static u32 process_channel_irqs(struct bam_device *bdev)
 		writel_relaxed(pipe_stts, bam_addr(bdev, i, BAM_P_IRQ_CLR));
 
 		spin_lock_irqsave(&bchan->vc.lock, flags);
-		async_desc = bchan->curr_txd;
 
-		if (async_desc) {
-			async_desc->num_desc -= async_desc->xfer_len;
-			async_desc->curr_desc += async_desc->xfer_len;
-			bchan->curr_txd = NULL;
+		bchan->irq_time = ktime_get();
+
+		offset = readl_relaxed(bam_addr(bdev, i, BAM_P_SW_OFSTS)) &
+				       P_SW_OFSTS_MASK;
+		offset /= sizeof(struct bam_desc_hw);
+
+		/* number of descriptors processed since the last interrupt */
+		avail = CIRC_CNT(offset, bchan->head, BAM_FIFO_ENTRIES);
+
+		list_for_each_entry_safe(async_desc, tmp, &bchan->desc_list,
+					 desc_node) {
+			/* transaction not yet fully processed */
+			if (avail < async_desc->xfer_len)
+				break;
 
 			/* manage FIFO */
 			bchan->head += async_desc->xfer_len;
-			bchan->head %= MAX_DESCRIPTORS;
+			bchan->head %= BAM_FIFO_ENTRIES;
+			avail -= async_desc->xfer_len;
+
+			async_desc->num_desc -= async_desc->xfer_len;
+			async_desc->curr_desc += async_desc->xfer_len;
+			list_del(&async_desc->desc_node);
 
 			/*
 			 * if complete, process cookie.  Otherwise
@@ -770,7 +947,7 @@ static u32 process_channel_irqs(struct bam_device *bdev)
 			 * it gets restarted by the tasklet
 			 */
 			if (!async_desc->num_desc)
-				vchan_cookie_complete(&async_desc->vd);
+				bam_cookie_complete(bchan, async_desc);
 			else
 				list_add(&async_desc->vd.node,
 					&bchan->vc.desc_issued);
@@ -793,12 +970,25 @@ static irqreturn_t bam_dma_irq(int irq, void *data)
 {
 	struct bam_device *bdev = data;
 	u32 clr_mask = 0, srcs = 0;
+	irqreturn_t ret = IRQ_HANDLED;
 
 	srcs |= process_channel_irqs(bdev);
 
-	/* kick off tasklet to start next dma transfer */
-	if (srcs & P_IRQ)
-		tasklet_schedule(&bdev->task);
+	/* kick off the completion path to start next dma transfer */
+	if (srcs & P_IRQ) {
+		switch (bdev->completion) {
+		case BAM_COMPLETION_TASKLET:
+			tasklet_schedule(&bdev->task);
+			break;
+		case BAM_COMPLETION_IRQ_THREAD:
+			ret = IRQ_WAKE_THREAD;
+			break;
+		case BAM_COMPLETION_KTHREAD:
+			queue_kthread_work(&bdev->completion_worker,
+					   &bdev->completion_work);
+			break;
+		}
+	}
 
 	if (srcs & BAM_IRQ)
 		clr_mask = readl_relaxed(bam_addr(bdev, 0, BAM_IRQ_STTS));
@@ -808,7 +998,7 @@ static irqreturn_t bam_dma_irq(int irq, void *data)
 
 	writel_relaxed(clr_mask, bam_addr(bdev, 0, BAM_IRQ_CLR));
 
-	return IRQ_HANDLED;
+	return ret;
 }
 
 /**
@@ -823,6 +1013,7 @@ static enum dma_status bam_tx_status(struct dma_chan *chan, dma_cookie_t cookie,
 		struct dma_tx_state *txstate)
 {
 	struct bam_chan *bchan = to_bam_chan(chan);
+	struct bam_async_desc *async_desc;
 	struct virt_dma_desc *vd;
 	int ret;
 	size_t residue = 0;
@@ -838,11 +1029,17 @@ static enum dma_status bam_tx_status(struct dma_chan *chan, dma_cookie_t cookie,
 
 	spin_lock_irqsave(&bchan->vc.lock, flags);
 	vd = vchan_find_desc(&bchan->vc, cookie);
-	if (vd)
+	if (vd) {
 		residue = container_of(vd, struct bam_async_desc, vd)->length;
-	else if (bchan->curr_txd && bchan->curr_txd->vd.tx.cookie == cookie)
-		for (i = 0; i < bchan->curr_txd->num_desc; i++)
-			residue += bchan->curr_txd->curr_desc[i].size;
+	} else {
+		list_for_each_entry(async_desc, &bchan->desc_list, desc_node) {
+			if (async_desc->vd.tx.cookie != cookie)
+				continue;
+
+			for (i = 0; i < async_desc->num_desc; i++)
+				residue += async_desc->curr_desc[i].size;
+		}
+	}
 
 	spin_unlock_irqrestore(&bchan->vc.lock, flags);
 
@@ -878,6 +1075,9 @@ static void bam_apply_new_config(struct bam_chan *bchan,
 /**
  * bam_start_dma - start next transaction
  * @bchan - bam dma channel
+ *
+ * Commits as many of the issued transactions as fits in the descriptor fifo
+ * and kicks off the hardware.
  */
 static void bam_start_dma(struct bam_chan *bchan)
 {
@@ -887,52 +1087,76 @@ static void bam_start_dma(struct bam_chan *bchan)
 	struct bam_desc_hw *desc;
 	struct bam_desc_hw *fifo = PTR_ALIGN(bchan->fifo_virt,
 					sizeof(struct bam_desc_hw));
+	unsigned int avail;
+	bool want_irq;
 
 	lockdep_assert_held(&bchan->vc.lock);
 
 	if (!vd)
 		return;
 
-	list_del(&vd->node);
+	while (vd && !IS_BUSY(bchan)) {
+		list_del(&vd->node);
 
-	async_desc = container_of(vd, struct bam_async_desc, vd);
-	bchan->curr_txd = async_desc;
+		async_desc = container_of(vd, struct bam_async_desc, vd);
 
-	/* on first use, initialize the channel hardware */
-	if (!bchan->initialized)
-		bam_chan_init_hw(bchan, async_desc->dir);
+		/* on first use, initialize the channel hardware */
+		if (!bchan->initialized)
+			bam_chan_init_hw(bchan, async_desc->dir);
 
-	/* apply new slave config changes, if necessary */
-	if (bchan->reconfigure)
-		bam_apply_new_config(bchan, async_desc->dir);
+		/* apply new slave config changes, if necessary */
+		if (bchan->reconfigure)
+			bam_apply_new_config(bchan, async_desc->dir);
 
-	desc = bchan->curr_txd->curr_desc;
+		desc = async_desc->curr_desc;
+		avail = CIRC_SPACE(bchan->tail, bchan->head, BAM_FIFO_ENTRIES);
 
-	if (async_desc->num_desc > MAX_DESCRIPTORS)
-		async_desc->xfer_len = MAX_DESCRIPTORS;
-	else
-		async_desc->xfer_len = async_desc->num_desc;
+		if (async_desc->num_desc > avail)
+			async_desc->xfer_len = avail;
+		else
+			async_desc->xfer_len = async_desc->num_desc;
 
-	/* set any special flags on the last descriptor */
-	if (async_desc->num_desc == async_desc->xfer_len)
-		desc[async_desc->xfer_len - 1].flags = async_desc->flags;
-	else
-		desc[async_desc->xfer_len - 1].flags |= DESC_FLAG_INT;
+		/* set any special flags on the last descriptor */
+		if (async_desc->num_desc == async_desc->xfer_len)
+			desc[async_desc->xfer_len - 1].flags |=
+							async_desc->flags;
 
-	if (bchan->tail + async_desc->xfer_len > MAX_DESCRIPTORS) {
-		u32 partial = MAX_DESCRIPTORS - bchan->tail;
+		vd = vchan_next_desc(&bchan->vc);
 
-		memcpy(&fifo[bchan->tail], desc,
-				partial * sizeof(struct bam_desc_hw));
-		memcpy(fifo, &desc[partial], (async_desc->xfer_len - partial) *
-				sizeof(struct bam_desc_hw));
-	} else {
-		memcpy(&fifo[bchan->tail], desc,
-			async_desc->xfer_len * sizeof(struct bam_desc_hw));
-	}
+		/*
+		 * Request an interrupt at the end of this transaction if the
+		 * fifo is now full, if nothing is queued behind it or, subject
+		 * to moderation, if the client wants a completion callback.
+		 */
+		want_irq = avail <= async_desc->xfer_len || !vd;
+		if (async_desc->vd.tx.callback &&
+		    ++bchan->irq_pending >= bdev->irq_coalesce)
+			want_irq = true;
 
-	bchan->tail += async_desc->xfer_len;
-	bchan->tail %= MAX_DESCRIPTORS;
+		if (want_irq) {
+			desc[async_desc->xfer_len - 1].flags |= DESC_FLAG_INT;
+			bchan->irq_pending = 0;
+		}
+
+		if (bchan->tail + async_desc->xfer_len > BAM_FIFO_ENTRIES) {
+			u32 partial = BAM_FIFO_ENTRIES - bchan->tail;
+
+			memcpy(&fifo[bchan->tail], desc,
+					partial * sizeof(struct bam_desc_hw));
+			memcpy(fifo, &desc[partial],
+				(async_desc->xfer_len - partial) *
+					sizeof(struct bam_desc_hw));
+		} else {
+			memcpy(&fifo[bchan->tail], desc,
+				async_desc->xfer_len *
+					sizeof(struct bam_desc_hw));
+		}
+
+		bchan->tail += async_desc->xfer_len;
+		bchan->tail %= BAM_FIFO_ENTRIES;
+
+		list_add_tail(&async_desc->desc_node, &bchan->desc_list);
+	}
 
 	/* ensure descriptor writes and dma start not reordered */
 	wmb();
@@ -958,12 +1182,127 @@ static void dma_tasklet(unsigned long data)
 		bchan = &bdev->channels[i];
 		spin_lock_irqsave(&bchan->vc.lock, flags);
 
-		if (!list_empty(&bchan->vc.desc_issued) && !bchan->curr_txd)
+		if (!list_empty(&bchan->vc.desc_issued) && !IS_BUSY(bchan))
 			bam_start_dma(bchan);
 		spin_unlock_irqrestore(&bchan->vc.lock, flags);
 	}
 }
 
+/**
+ * bam_dma_complete_all - start pending transactions and run completions
+ * @bdev: bam controller
+ *
+ * Completion path used when not running from tasklets
+ */
+static void bam_dma_complete_all(struct bam_device *bdev)
+{
+	unsigned int i;
+
+	dma_tasklet((unsigned long)bdev);
+
+	for (i = 0; i < bdev->num_channels; i++)
+		bam_complete_descs(&bdev->channels[i]);
+}
+
+static irqreturn_t bam_dma_irq_thread(int irq, void *data)
+{
+	bam_dma_complete_all(data);
+
+	return IRQ_HANDLED;
+}
+
+static void bam_dma_completion_work(struct kthread_work *work)
+{
+	struct bam_device *bdev = container_of(work, struct bam_device,
+					       completion_work);
+
+	bam_dma_complete_all(bdev);
+}
+
+/**
+ * bam_completion_init - set up the context for running completions
+ * @bdev: bam device
+ *
+ * Selects the completion mode from DT, spawning the dedicated completion
+ * thread if requested.
+ */
+static int bam_completion_init(struct bam_device *bdev)
+{
+	struct device_node *np = bdev->dev->of_node;
+	struct sched_param param;
+	struct task_struct *task;
+	u32 prio;
+	int ret;
+
+	if (of_property_read_bool(np, "qcom,threaded-completion"))
+		bdev->completion = BAM_COMPLETION_IRQ_THREAD;
+
+	if (of_property_read_u32(np, "qcom,completion-thread-priority", &prio))
+		return 0;
+
+	if (!prio || prio >= MAX_RT_PRIO) {
+		dev_err(bdev->dev, "invalid completion thread priority\n");
+		return -EINVAL;
+	}
+
+	init_kthread_worker(&bdev->completion_worker);
+	init_kthread_work(&bdev->completion_work, bam_dma_completion_work);
+
+	task = kthread_create(kthread_worker_fn, &bdev->completion_worker,
+			      "bam_dma/%s", dev_name(bdev->dev));
+	if (IS_ERR(task))
+		return PTR_ERR(task);
+
+	param.sched_priority = prio;
+	ret = sched_setscheduler(task, SCHED_FIFO, &param);
+	if (ret) {
+		kthread_stop(task);
+		return ret;
+	}
+
+	wake_up_process(task);
+
+	bdev->completion_task = task;
+	bdev->completion = BAM_COMPLETION_KTHREAD;
+
+	return 0;
+}
+
+static void bam_completion_exit(struct bam_device *bdev)
+{
+	if (!bdev->completion_task)
+		return;
+
+	flush_kthread_worker(&bdev->completion_worker);
+	kthread_stop(bdev->completion_task);
+}
+
+static int bam_latency_show(struct seq_file *s, void *unused)
+{
+	struct bam_device *bdev = s->private;
+	int i;
+
+	for (i = 0; i < BAM_LATENCY_BUCKETS; i++)
+		seq_printf(s, "%s%6lu us: %ld\n",
+			   i == BAM_LATENCY_BUCKETS - 1 ? ">=" : "< ",
+			   i == BAM_LATENCY_BUCKETS - 1 ? 1UL << i : 2UL << i,
+			   atomic_long_read(&bdev->latency_hist[i]));
+
+	return 0;
+}
+
+static int bam_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, bam_latency_show, inode->i_private);
+}
+
+static const struct file_operations bam_latency_fops = {
+	.open = bam_latency_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 /**
  * bam_issue_pending - starts pending transactions
  * @chan: dma channel
@@ -977,8 +1316,8 @@ static void bam_issue_pending(struct dma_chan *chan)
 
 	spin_lock_irqsave(&bchan->vc.lock, flags);
 
-	/* if work pending and idle, start a transaction */
-	if (vchan_issue_pending(&bchan->vc) && !bchan->curr_txd)
+	/* if work pending and there's room in the fifo, start transactions */
+	if (vchan_issue_pending(&bchan->vc) && !IS_BUSY(bchan))
 		bam_start_dma(bchan);
 
 	spin_unlock_irqrestore(&bchan->vc.lock, flags);
@@ -1075,6 +1414,11 @@ static void bam_channel_init(struct bam_device *bdev, struct bam_chan *bchan,
 
 	vchan_init(&bchan->vc, &bdev->common);
 	bchan->vc.desc_free = bam_dma_free_desc;
+	INIT_LIST_HEAD(&bchan->desc_list);
+
+	/* run callbacks through bam_complete_descs(), for latency accounting */
+	tasklet_init(&bchan->vc.task, bam_complete_tasklet,
+		     (unsigned long)bchan);
 }
 
 static const struct of_device_id bam_of_match[] = {
@@ -1122,6 +1466,12 @@ static int bam_dma_probe(struct platform_device *pdev)
 		return ret;
 	}
 
+	bdev->irq_coalesce = 1;
+	of_property_read_u32(pdev->dev.of_node, "qcom,irq-coalesce",
+			     &bdev->irq_coalesce);
+	if (!bdev->irq_coalesce)
+		bdev->irq_coalesce = 1;
+
 	bdev->bamclk = devm_clk_get(bdev->dev, "bam_clk");
 	if (IS_ERR(bdev->bamclk))
 		return PTR_ERR(bdev->bamclk);
@@ -1138,12 +1488,16 @@ static int bam_dma_probe(struct platform_device *pdev)
 
 	tasklet_init(&bdev->task, dma_tasklet, (unsigned long)bdev);
 
+	ret = bam_completion_init(bdev);
+	if (ret)
+		goto err_tasklet_kill;
+
 	bdev->channels = devm_kcalloc(bdev->dev, bdev->num_channels,
 				sizeof(*bdev->channels), GFP_KERNEL);
 
 	if (!bdev->channels) {
 		ret = -ENOMEM;
-		goto err_tasklet_kill;
+		goto err_completion_exit;
 	}
 
 	/* allocate and initialize channels */
@@ -1152,7 +1506,9 @@ static int bam_dma_probe(struct platform_device *pdev)
 	for (i = 0; i < bdev->num_channels; i++)
 		bam_channel_init(bdev, &bdev->channels[i], i);
 
-	ret = devm_request_irq(bdev->dev, bdev->irq, bam_dma_irq,
+	ret = devm_request_threaded_irq(bdev->dev, bdev->irq, bam_dma_irq,
+			bdev->completion == BAM_COMPLETION_IRQ_THREAD ?
+				bam_dma_irq_thread : NULL,
 			IRQF_TRIGGER_HIGH, "bam_dma", bdev);
 	if (ret)
 		goto err_bam_channel_exit;
@@ -1199,6 +1555,10 @@ static int bam_dma_probe(struct platform_device *pdev)
 	if (ret)
 		goto err_unregister_dma;
 
+	bdev->debugfs = debugfs_create_dir(dev_name(bdev->dev), NULL);
+	debugfs_create_file("latency_hist", 0444, bdev->debugfs, bdev,
+			    &bam_latency_fops);
+
 	return 0;
 
 err_unregister_dma:
@@ -1206,6 +1566,8 @@ err_unregister_dma:
 err_bam_channel_exit:
 	for (i = 0; i < bdev->num_channels; i++)
 		tasklet_kill(&bdev->channels[i].vc.task);
+err_completion_exit:
+	bam_completion_exit(bdev);
 err_tasklet_kill:
 	tasklet_kill(&bdev->task);
 err_disable_clk:
@@ -1219,6 +1581,8 @@ static int bam_dma_remove(struct platform_device *pdev)
 	struct bam_device *bdev = platform_get_drvdata(pdev);
 	u32 i;
 
+	debugfs_remove_recursive(bdev->debugfs);
+
 	of_dma_controller_free(pdev->dev.of_node);
 	dma_async_device_unregister(&bdev->common);
 
@@ -1237,6 +1601,7 @@ static int bam_dma_remove(struct platform_device *pdev)
 	}
 
 	tasklet_kill(&bdev->task);
+	bam_completion_exit(bdev);
 
 	clk_disable_unprepare(bdev->bamclk);
 
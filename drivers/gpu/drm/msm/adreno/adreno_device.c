@@ -165,6 +165,29 @@ static void set_gpu_pdev(struct drm_device *dev,
 	priv->gpu_pdev = pdev;
 }
 
+#ifdef CONFIG_OF
+/* keep the pwrlevels sorted, lowest rate first, for devfreq: */
+static void add_freq(struct adreno_platform_config *config, uint32_t freq)
+{
+	int i;
+
+	if (config->nr_freqs == ARRAY_SIZE(config->freqs))
+		return;
+
+	for (i = config->nr_freqs; i > 0; i--) {
+		if (config->freqs[i - 1] == freq)
+			return;
+		if (config->freqs[i - 1] < freq)
+			break;
+	}
+
+	memmove(&config->freqs[i + 1], &config->freqs[i],
+			(config->nr_freqs - i) * sizeof(config->freqs[0]));
+	config->freqs[i] = freq;
+	config->nr_freqs++;
+}
+#endif
+
 static int adreno_bind(struct device *dev, struct device *master, void *data)
 {
 	static struct adreno_platform_config config = {};
@@ -185,6 +208,7 @@ static int adreno_bind(struct device *dev, struct device *master, void *data)
 	/* find clock rates: */
 	config.fast_rate = 0;
 	config.slow_rate = ~0;
+	config.nr_freqs = 0;
 	for_each_child_of_node(node, child) {
 		if (of_device_is_compatible(child, "qcom,gpu-pwrlevels")) {
 			struct device_node *pwrlvl;
@@ -196,6 +220,7 @@ static int adreno_bind(struct device *dev, struct device *master, void *data)
 				}
 				config.fast_rate = max(config.fast_rate, val);
 				config.slow_rate = min(config.slow_rate, val);
+				add_freq(&config, val);
 			}
 		}
 	}
@@ -150,6 +150,8 @@ int msm_dsi_host_power_on(struct mipi_dsi_host *host);
 int msm_dsi_host_power_off(struct mipi_dsi_host *host);
 int msm_dsi_host_set_display_mode(struct mipi_dsi_host *host,
 					struct drm_display_mode *mode);
+int msm_dsi_host_set_roi(struct mipi_dsi_host *host,
+					const struct drm_rect *roi);
 struct drm_panel *msm_dsi_host_get_panel(struct mipi_dsi_host *host,
 					unsigned long *panel_flags);
 struct drm_bridge *msm_dsi_host_get_bridge(struct mipi_dsi_host *host);
@@ -698,6 +698,22 @@ static void dsi_ctrl_config(struct msm_dsi_host *msm_host, bool enable,
 	dsi_write(msm_host, REG_DSI_CTRL, data);
 }
 
+static void dsi_cmd_stream_setup(struct msm_dsi_host *msm_host,
+		u32 width, u32 height)
+{
+	/* image data and 1 byte write_memory_start cmd */
+	u32 wc = width * dsi_get_bpp(msm_host->format) / 8 + 1;
+
+	dsi_write(msm_host, REG_DSI_CMD_MDP_STREAM_CTRL,
+		DSI_CMD_MDP_STREAM_CTRL_WORD_COUNT(wc) |
+		DSI_CMD_MDP_STREAM_CTRL_VIRTUAL_CHANNEL(msm_host->channel) |
+		DSI_CMD_MDP_STREAM_CTRL_DATA_TYPE(MIPI_DSI_DCS_LONG_WRITE));
+
+	dsi_write(msm_host, REG_DSI_CMD_MDP_STREAM_TOTAL,
+		DSI_CMD_MDP_STREAM_TOTAL_H_TOTAL(width) |
+		DSI_CMD_MDP_STREAM_TOTAL_V_TOTAL(height));
+}
+
 static void dsi_timing_setup(struct msm_dsi_host *msm_host)
 {
 	struct drm_display_mode *mode = msm_host->mode;
@@ -710,7 +726,6 @@ static void dsi_timing_setup(struct msm_dsi_host *msm_host)
 	u32 ha_end = ha_start + mode->hdisplay;
 	u32 va_start = v_total - mode->vsync_start;
 	u32 va_end = va_start + mode->vdisplay;
-	u32 wc;
 
 	DBG("");
 
@@ -733,19 +748,7 @@ static void dsi_timing_setup(struct msm_dsi_host *msm_host)
 			DSI_ACTIVE_VSYNC_VPOS_START(vs_start) |
 			DSI_ACTIVE_VSYNC_VPOS_END(vs_end));
 	} else {		/* command mode */
-		/* image data and 1 byte write_memory_start cmd */
-		wc = mode->hdisplay * dsi_get_bpp(msm_host->format) / 8 + 1;
-
-		dsi_write(msm_host, REG_DSI_CMD_MDP_STREAM_CTRL,
-			DSI_CMD_MDP_STREAM_CTRL_WORD_COUNT(wc) |
-			DSI_CMD_MDP_STREAM_CTRL_VIRTUAL_CHANNEL(
-					msm_host->channel) |
-			DSI_CMD_MDP_STREAM_CTRL_DATA_TYPE(
-					MIPI_DSI_DCS_LONG_WRITE));
-
-		dsi_write(msm_host, REG_DSI_CMD_MDP_STREAM_TOTAL,
-			DSI_CMD_MDP_STREAM_TOTAL_H_TOTAL(mode->hdisplay) |
-			DSI_CMD_MDP_STREAM_TOTAL_V_TOTAL(mode->vdisplay));
+		dsi_cmd_stream_setup(msm_host, mode->hdisplay, mode->vdisplay);
 	}
 }
 
@@ -1978,6 +1981,58 @@ int msm_dsi_host_set_display_mode(struct mipi_dsi_host *host,
 	return 0;
 }
 
+static int dsi_dcs_set_window(struct mipi_dsi_host *host, u8 cmd,
+		u16 start, u16 end)
+{
+	struct msm_dsi_host *msm_host = to_msm_dsi_host(host);
+	u8 payload[5] = { cmd, start >> 8, start & 0xff, end >> 8, end & 0xff };
+	struct mipi_dsi_msg msg = {
+		.channel = msm_host->channel,
+		.type = MIPI_DSI_DCS_LONG_WRITE,
+		.tx_buf = payload,
+		.tx_len = sizeof(payload),
+	};
+	ssize_t ret;
+
+	ret = dsi_host_transfer(host, &msg);
+
+	return (ret < 0) ? ret : 0;
+}
+
+/*
+ * Limit the next command mode frames to @roi, in panel coordinates:
+ * point the panel's column and page address window at it and shrink
+ * the MDP stream to match.  Must be called between two frames, before
+ * the MDP is kicked off again.
+ */
+int msm_dsi_host_set_roi(struct mipi_dsi_host *host,
+		const struct drm_rect *roi)
+{
+	struct msm_dsi_host *msm_host = to_msm_dsi_host(host);
+	int ret;
+
+	if (msm_host->mode_flags & MIPI_DSI_MODE_VIDEO)
+		return -EINVAL;
+
+	ret = dsi_dcs_set_window(host, MIPI_DCS_SET_COLUMN_ADDRESS,
+			roi->x1, roi->x2 - 1);
+	if (!ret)
+		ret = dsi_dcs_set_window(host, MIPI_DCS_SET_PAGE_ADDRESS,
+				roi->y1, roi->y2 - 1);
+	if (ret) {
+		pr_err("%s: failed to set panel window, %d\n", __func__, ret);
+		return ret;
+	}
+
+	mutex_lock(&msm_host->dev_mutex);
+	if (msm_host->power_on)
+		dsi_cmd_stream_setup(msm_host, drm_rect_width(roi),
+				drm_rect_height(roi));
+	mutex_unlock(&msm_host->dev_mutex);
+
+	return 0;
+}
+
 struct drm_panel *msm_dsi_host_get_panel(struct mipi_dsi_host *host,
 				unsigned long *panel_flags)
 {
@@ -791,6 +791,21 @@ bool msm_dsi_manager_cmd_xfer_trigger(int id, u32 iova, u32 len)
 	return true;
 }
 
+/*
+ * Partial update of a command mode panel.  With dual DSI each link
+ * drives half of the panel, which is not supported.
+ */
+int msm_dsi_set_roi(struct drm_encoder *encoder, const struct drm_rect *roi)
+{
+	int id = dsi_mgr_bridge_get_id(encoder->bridge);
+	struct msm_dsi *msm_dsi = dsi_mgr_get_dsi(id);
+
+	if (IS_DUAL_DSI() || !msm_dsi)
+		return -EINVAL;
+
+	return msm_dsi_host_set_roi(msm_dsi->host, roi);
+}
+
 int msm_dsi_manager_register(struct msm_dsi *msm_dsi)
 {
 	struct msm_dsi_manager *msm_dsim = &msm_dsim_glb;
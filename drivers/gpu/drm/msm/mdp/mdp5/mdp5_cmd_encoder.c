@@ -20,6 +20,7 @@ struct mdp5_cmd_encoder {
 	struct drm_encoder base;
 	struct mdp5_interface intf;
 	bool enabled;
+	bool split;
 	uint32_t bsc;
 
 	struct mdp5_ctl *ctl;
@@ -282,9 +283,29 @@ int mdp5_cmd_encoder_set_split_display(struct drm_encoder *encoder,
 	mdp5_write(mdp5_kms, REG_MDP5_MDP_SPLIT_DPL_EN(0), 1);
 	mdp5_disable(mdp5_kms);
 
+	mdp5_cmd_enc->split = true;
+	to_mdp5_cmd_encoder(slave_encoder)->split = true;
+
 	return 0;
 }
 
+/*
+ * Partial update: the panel window can only be moved when a single
+ * interface drives the whole panel.
+ */
+bool mdp5_cmd_encoder_roi_capable(struct drm_encoder *encoder)
+{
+	struct mdp5_cmd_encoder *mdp5_cmd_enc = to_mdp5_cmd_encoder(encoder);
+
+	return mdp5_cmd_enc->enabled && !mdp5_cmd_enc->split;
+}
+
+int mdp5_cmd_encoder_set_roi(struct drm_encoder *encoder,
+		const struct drm_rect *roi)
+{
+	return msm_dsi_set_roi(encoder, roi);
+}
+
 /* initialize command mode encoder */
 struct drm_encoder *mdp5_cmd_encoder_init(struct drm_device *dev,
 			struct mdp5_interface *intf, struct mdp5_ctl *ctl)
@@ -66,6 +66,11 @@ struct mdp5_crtc {
 
 	bool cmd_mode;
 
+	/* region of the frame currently sent to a command mode panel,
+	 * empty when the whole frame is sent:
+	 */
+	struct drm_rect roi;
+
 	struct {
 		/* protect REG_MDP5_LM_CURSOR* registers and cursor scanout_bo*/
 		spinlock_t lock;
@@ -78,6 +83,17 @@ struct mdp5_crtc {
 };
 #define to_mdp5_crtc(x) container_of(x, struct mdp5_crtc, base)
 
+struct mdp5_crtc_state {
+	struct drm_crtc_state base;
+
+	/* damaged region in CRTC coordinates, for partial update of a
+	 * command mode panel.  Empty to send the whole frame:
+	 */
+	struct drm_rect roi;
+};
+#define to_mdp5_crtc_state(x) \
+		container_of(x, struct mdp5_crtc_state, base)
+
 static struct mdp5_kms *get_kms(struct drm_crtc *crtc)
 {
 	struct msm_drm_private *priv = crtc->dev->dev_private;
@@ -372,6 +388,82 @@ static int pstate_cmp(const void *a, const void *b)
 	return pa->state->zpos - pb->state->zpos;
 }
 
+static struct drm_encoder *get_encoder(struct drm_crtc *crtc)
+{
+	struct drm_encoder *encoder;
+
+	drm_for_each_encoder(encoder, crtc->dev)
+		if (encoder->crtc == crtc)
+			return encoder;
+
+	return NULL;
+}
+
+/*
+ * Partial update is only done for an enabled command mode panel on a
+ * single interface, with no cursor, and when every plane is an
+ * unscaled, unreflected RGB layer that intersects the damaged region.
+ * Anything else falls back to sending the whole frame.
+ */
+static void check_roi(struct drm_crtc *crtc, struct drm_crtc_state *state,
+		struct plane_state *pstates, int cnt)
+{
+	struct mdp5_crtc *mdp5_crtc = to_mdp5_crtc(crtc);
+	struct drm_rect *roi = &to_mdp5_crtc_state(state)->roi;
+	struct drm_rect frame = {
+		.x2 = state->adjusted_mode.hdisplay,
+		.y2 = state->adjusted_mode.vdisplay,
+	};
+	struct drm_encoder *encoder;
+	int i;
+
+	if (!drm_rect_visible(roi))
+		return;
+
+	encoder = get_encoder(crtc);
+	if (!mdp5_crtc->cmd_mode || !encoder || !state->active ||
+			drm_atomic_crtc_needs_modeset(state) ||
+			!mdp5_cmd_encoder_roi_capable(encoder) ||
+			mdp5_crtc->cursor.scanout_bo)
+		goto full_frame;
+
+	/* panels commonly want the window on even columns and rows: */
+	roi->x1 = round_down(roi->x1, 2);
+	roi->y1 = round_down(roi->y1, 2);
+	roi->x2 = round_up(roi->x2, 2);
+	roi->y2 = round_up(roi->y2, 2);
+
+	if (!drm_rect_intersect(roi, &frame) || drm_rect_equals(roi, &frame))
+		goto full_frame;
+
+	for (i = 0; i < cnt; i++) {
+		struct drm_plane_state *pstate = &pstates[i].state->base;
+		const struct mdp_format *format;
+		struct drm_rect dst = {
+			.x1 = pstate->crtc_x,
+			.y1 = pstate->crtc_y,
+			.x2 = pstate->crtc_x + pstate->crtc_w,
+			.y2 = pstate->crtc_y + pstate->crtc_h,
+		};
+
+		format = to_mdp_format(msm_framebuffer_format(pstate->fb));
+		if (MDP_FORMAT_IS_YUV(format) ||
+				(pstate->rotation & (BIT(DRM_REFLECT_X) |
+						     BIT(DRM_REFLECT_Y))) ||
+				((pstate->src_w >> 16) != pstate->crtc_w) ||
+				((pstate->src_h >> 16) != pstate->crtc_h) ||
+				!drm_rect_intersect(&dst, roi))
+			goto full_frame;
+	}
+
+	DBG("%s: roi %d,%d %dx%d", mdp5_crtc->name, roi->x1, roi->y1,
+			drm_rect_width(roi), drm_rect_height(roi));
+	return;
+
+full_frame:
+	memset(roi, 0, sizeof(*roi));
+}
+
 static int mdp5_crtc_atomic_check(struct drm_crtc *crtc,
 		struct drm_crtc_state *state)
 {
@@ -419,6 +511,8 @@ static int mdp5_crtc_atomic_check(struct drm_crtc *crtc,
 				pstates[i].state->stage);
 	}
 
+	check_roi(crtc, state, pstates, cnt);
+
 	return 0;
 }
 
@@ -429,6 +523,69 @@ static void mdp5_crtc_atomic_begin(struct drm_crtc *crtc,
 	DBG("%s: begin", mdp5_crtc->name);
 }
 
+/* program the mixer and the pipes for @roi, or the whole frame if NULL: */
+static void set_roi(struct drm_crtc *crtc, const struct drm_rect *roi)
+{
+	struct mdp5_crtc *mdp5_crtc = to_mdp5_crtc(crtc);
+	struct mdp5_kms *mdp5_kms = get_kms(crtc);
+	struct drm_display_mode *mode = &crtc->state->adjusted_mode;
+	struct drm_plane *plane;
+	unsigned long flags;
+	u32 w = roi ? drm_rect_width(roi) : mode->hdisplay;
+	u32 h = roi ? drm_rect_height(roi) : mode->vdisplay;
+
+	drm_atomic_crtc_for_each_plane(plane, crtc)
+		mdp5_plane_set_roi(plane, roi);
+
+	spin_lock_irqsave(&mdp5_crtc->lm_lock, flags);
+	mdp5_write(mdp5_kms, REG_MDP5_LM_OUT_SIZE(mdp5_crtc->lm),
+			MDP5_LM_OUT_SIZE_WIDTH(w) |
+			MDP5_LM_OUT_SIZE_HEIGHT(h));
+	spin_unlock_irqrestore(&mdp5_crtc->lm_lock, flags);
+}
+
+/*
+ * Partial update of a command mode panel: point the panel's window at
+ * the damaged region, shrink the mixer to it, and clip and move every
+ * pipe into it.  The pipes are reprogrammed on every partial frame,
+ * since planes updated by this commit were set up for the whole frame.
+ * If the panel window cannot be moved, the whole frame is sent.
+ */
+static void roi_setup(struct drm_crtc *crtc)
+{
+	struct mdp5_crtc *mdp5_crtc = to_mdp5_crtc(crtc);
+	struct drm_display_mode *mode = &crtc->state->adjusted_mode;
+	struct drm_rect roi = to_mdp5_crtc_state(crtc->state)->roi;
+	struct drm_rect frame = {
+		.x2 = mode->hdisplay,
+		.y2 = mode->vdisplay,
+	};
+	struct drm_encoder *encoder;
+	bool partial = drm_rect_visible(&roi);
+	int ret;
+
+	if (!crtc->state->active ||
+			(!partial && !drm_rect_visible(&mdp5_crtc->roi)))
+		return;
+
+	if (!drm_rect_equals(&roi, &mdp5_crtc->roi)) {
+		encoder = get_encoder(crtc);
+		ret = encoder ? mdp5_cmd_encoder_set_roi(encoder,
+				partial ? &roi : &frame) : -ENODEV;
+		if (ret) {
+			dev_warn(crtc->dev->dev, "%s: failed to set roi: %d\n",
+					mdp5_crtc->name, ret);
+			if (partial && encoder)
+				mdp5_cmd_encoder_set_roi(encoder, &frame);
+			memset(&roi, 0, sizeof(roi));
+			partial = false;
+		}
+		mdp5_crtc->roi = roi;
+	}
+
+	set_roi(crtc, partial ? &roi : NULL);
+}
+
 static void mdp5_crtc_atomic_flush(struct drm_crtc *crtc,
 				   struct drm_crtc_state *old_crtc_state)
 {
@@ -453,6 +610,7 @@ static void mdp5_crtc_atomic_flush(struct drm_crtc *crtc,
 		return;
 
 	blend_setup(crtc);
+	roi_setup(crtc);
 
 	/* PP_DONE irq is only used by command mode for now.
 	 * It is better to request pending before FLUSH and START trigger
@@ -621,14 +779,57 @@ static int mdp5_crtc_cursor_move(struct drm_crtc *crtc, int x, int y)
 	return 0;
 }
 
+static void mdp5_crtc_reset(struct drm_crtc *crtc)
+{
+	struct mdp5_crtc_state *mdp5_cstate;
+
+	if (crtc->state) {
+		__drm_atomic_helper_crtc_destroy_state(crtc, crtc->state);
+		kfree(to_mdp5_crtc_state(crtc->state));
+	}
+
+	mdp5_cstate = kzalloc(sizeof(*mdp5_cstate), GFP_KERNEL);
+	if (mdp5_cstate) {
+		crtc->state = &mdp5_cstate->base;
+		crtc->state->crtc = crtc;
+	} else {
+		crtc->state = NULL;
+	}
+}
+
+static struct drm_crtc_state *
+mdp5_crtc_duplicate_state(struct drm_crtc *crtc)
+{
+	struct mdp5_crtc_state *mdp5_cstate;
+
+	if (WARN_ON(!crtc->state))
+		return NULL;
+
+	mdp5_cstate = kzalloc(sizeof(*mdp5_cstate), GFP_KERNEL);
+	if (!mdp5_cstate)
+		return NULL;
+
+	/* damage only applies to the commit it was added to: */
+	__drm_atomic_helper_crtc_duplicate_state(crtc, &mdp5_cstate->base);
+
+	return &mdp5_cstate->base;
+}
+
+static void mdp5_crtc_destroy_state(struct drm_crtc *crtc,
+		struct drm_crtc_state *state)
+{
+	__drm_atomic_helper_crtc_destroy_state(crtc, state);
+	kfree(to_mdp5_crtc_state(state));
+}
+
 static const struct drm_crtc_funcs mdp5_crtc_funcs = {
 	.set_config = drm_atomic_helper_set_config,
 	.destroy = mdp5_crtc_destroy,
 	.page_flip = drm_atomic_helper_page_flip,
 	.set_property = mdp5_crtc_set_property,
-	.reset = drm_atomic_helper_crtc_reset,
-	.atomic_duplicate_state = drm_atomic_helper_crtc_duplicate_state,
-	.atomic_destroy_state = drm_atomic_helper_crtc_destroy_state,
+	.reset = mdp5_crtc_reset,
+	.atomic_duplicate_state = mdp5_crtc_duplicate_state,
+	.atomic_destroy_state = mdp5_crtc_destroy_state,
 	.cursor_set = mdp5_crtc_cursor_set,
 	.cursor_move = mdp5_crtc_cursor_move,
 };
@@ -771,6 +972,23 @@ void mdp5_crtc_wait_for_commit_done(struct drm_crtc *crtc)
 		mdp5_crtc_wait_for_flush_done(crtc);
 }
 
+/* grow the region to send for a partial update by @damage: */
+void mdp5_crtc_add_damage(struct drm_crtc_state *state,
+		const struct drm_rect *damage)
+{
+	struct drm_rect *roi = &to_mdp5_crtc_state(state)->roi;
+
+	if (!drm_rect_visible(roi)) {
+		*roi = *damage;
+		return;
+	}
+
+	roi->x1 = min(roi->x1, damage->x1);
+	roi->y1 = min(roi->y1, damage->y1);
+	roi->x2 = max(roi->x2, damage->x2);
+	roi->y2 = max(roi->y2, damage->y2);
+}
+
 /* initialize crtc */
 struct drm_crtc *mdp5_crtc_init(struct drm_device *dev,
 		struct drm_plane *plane, int id)
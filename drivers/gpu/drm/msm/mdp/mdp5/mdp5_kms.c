@@ -101,6 +101,12 @@ static void mdp5_wait_for_crtc_commit_done(struct msm_kms *kms,
 	mdp5_crtc_wait_for_commit_done(crtc);
 }
 
+static void mdp5_add_damage(struct msm_kms *kms,
+		struct drm_crtc_state *state, const struct drm_rect *damage)
+{
+	mdp5_crtc_add_damage(state, damage);
+}
+
 static long mdp5_round_pixclk(struct msm_kms *kms, unsigned long rate,
 		struct drm_encoder *encoder)
 {
@@ -163,6 +169,7 @@ static const struct mdp_kms_funcs kms_funcs = {
 		.prepare_commit  = mdp5_prepare_commit,
 		.complete_commit = mdp5_complete_commit,
 		.wait_for_crtc_commit_done = mdp5_wait_for_crtc_commit_done,
+		.add_damage      = mdp5_add_damage,
 		.get_format      = mdp_get_format,
 		.round_pixclk    = mdp5_round_pixclk,
 		.set_split_display = mdp5_set_split_display,
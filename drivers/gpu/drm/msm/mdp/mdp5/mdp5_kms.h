@@ -204,6 +204,7 @@ void mdp5_plane_complete_flip(struct drm_plane *plane);
 void mdp5_plane_complete_commit(struct drm_plane *plane,
 	struct drm_plane_state *state);
 enum mdp5_pipe mdp5_plane_pipe(struct drm_plane *plane);
+void mdp5_plane_set_roi(struct drm_plane *plane, const struct drm_rect *roi);
 struct drm_plane *mdp5_plane_init(struct drm_device *dev,
 		enum mdp5_pipe pipe, bool private_plane,
 		uint32_t reg_offset, uint32_t caps);
@@ -215,6 +216,8 @@ void mdp5_crtc_cancel_pending_flip(struct drm_crtc *crtc, struct drm_file *file)
 void mdp5_crtc_set_pipeline(struct drm_crtc *crtc,
 		struct mdp5_interface *intf, struct mdp5_ctl *ctl);
 void mdp5_crtc_wait_for_commit_done(struct drm_crtc *crtc);
+void mdp5_crtc_add_damage(struct drm_crtc_state *state,
+		const struct drm_rect *damage);
 struct drm_crtc *mdp5_crtc_init(struct drm_device *dev,
 		struct drm_plane *plane, int id);
 
@@ -228,6 +231,9 @@ struct drm_encoder *mdp5_cmd_encoder_init(struct drm_device *dev,
 		struct mdp5_interface *intf, struct mdp5_ctl *ctl);
 int mdp5_cmd_encoder_set_split_display(struct drm_encoder *encoder,
 					struct drm_encoder *slave_encoder);
+bool mdp5_cmd_encoder_roi_capable(struct drm_encoder *encoder);
+int mdp5_cmd_encoder_set_roi(struct drm_encoder *encoder,
+		const struct drm_rect *roi);
 #else
 static inline struct drm_encoder *mdp5_cmd_encoder_init(struct drm_device *dev,
 		struct mdp5_interface *intf, struct mdp5_ctl *ctl)
@@ -239,6 +245,15 @@ static inline int mdp5_cmd_encoder_set_split_display(
 {
 	return -EINVAL;
 }
+static inline bool mdp5_cmd_encoder_roi_capable(struct drm_encoder *encoder)
+{
+	return false;
+}
+static inline int mdp5_cmd_encoder_set_roi(struct drm_encoder *encoder,
+		const struct drm_rect *roi)
+{
+	return -EINVAL;
+}
 #endif
 
 #endif /* __MDP5_KMS_H__ */
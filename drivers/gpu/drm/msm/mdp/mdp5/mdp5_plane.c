@@ -281,9 +281,11 @@ static int mdp5_plane_atomic_check(struct drm_plane *plane,
 		struct drm_plane_state *state)
 {
 	struct mdp5_plane *mdp5_plane = to_mdp5_plane(plane);
+	struct mdp5_kms *mdp5_kms = get_kms(plane);
 	struct drm_plane_state *old_state = plane->state;
 	const struct mdp_format *format;
 	bool vflip, hflip;
+	int ret;
 
 	DBG("%s: check (%d -> %d)", mdp5_plane->name,
 			plane_enabled(old_state), plane_enabled(state));
@@ -318,6 +320,14 @@ static int mdp5_plane_atomic_check(struct drm_plane *plane,
 
 			return -EINVAL;
 		}
+
+		/* make sure mode_set() will find enough SMP blocks: */
+		if (mdp5_kms->smp) {
+			ret = mdp5_smp_check(mdp5_kms->smp, mdp5_plane->pipe,
+					format, state->src_w >> 16, false);
+			if (ret)
+				return ret;
+		}
 	}
 
 	if (plane_enabled(state) && plane_enabled(old_state)) {
@@ -830,6 +840,80 @@ static int mdp5_plane_mode_set(struct drm_plane *plane,
 	return ret;
 }
 
+/*
+ * Partial update: clip the pipe to @roi, a region of the mixer in CRTC
+ * coordinates, and move it to the origin of the (smaller) mixer.  With
+ * a NULL @roi the window of the plane state is restored.  Only called
+ * for unscaled RGB planes that intersect @roi (see the CRTC check).
+ */
+void mdp5_plane_set_roi(struct drm_plane *plane, const struct drm_rect *roi)
+{
+	struct mdp5_plane *mdp5_plane = to_mdp5_plane(plane);
+	struct mdp5_kms *mdp5_kms = get_kms(plane);
+	struct drm_plane_state *state = plane->state;
+	enum mdp5_pipe pipe = mdp5_plane->pipe;
+	const struct mdp_format *format;
+	int pe_left[COMP_MAX], pe_right[COMP_MAX];
+	int pe_top[COMP_MAX], pe_bottom[COMP_MAX];
+	uint32_t src_x = state->src_x >> 16;
+	uint32_t src_y = state->src_y >> 16;
+	uint32_t src_w = state->src_w >> 16;
+	uint32_t src_h = state->src_h >> 16;
+	struct drm_rect dst = {
+		.x1 = state->crtc_x,
+		.y1 = state->crtc_y,
+		.x2 = state->crtc_x + state->crtc_w,
+		.y2 = state->crtc_y + state->crtc_h,
+	};
+	unsigned long flags;
+
+	if (!plane_enabled(state))
+		return;
+
+	if (roi) {
+		if (WARN_ON(!drm_rect_intersect(&dst, roi)))
+			return;
+
+		src_x += dst.x1 - state->crtc_x;
+		src_y += dst.y1 - state->crtc_y;
+		src_w = drm_rect_width(&dst);
+		src_h = drm_rect_height(&dst);
+		drm_rect_translate(&dst, -roi->x1, -roi->y1);
+	}
+
+	format = to_mdp_format(msm_framebuffer_format(state->fb));
+
+	spin_lock_irqsave(&mdp5_plane->pipe_lock, flags);
+
+	mdp5_write(mdp5_kms, REG_MDP5_PIPE_SRC_SIZE(pipe),
+			MDP5_PIPE_SRC_SIZE_WIDTH(src_w) |
+			MDP5_PIPE_SRC_SIZE_HEIGHT(src_h));
+
+	mdp5_write(mdp5_kms, REG_MDP5_PIPE_SRC_XY(pipe),
+			MDP5_PIPE_SRC_XY_X(src_x) |
+			MDP5_PIPE_SRC_XY_Y(src_y));
+
+	mdp5_write(mdp5_kms, REG_MDP5_PIPE_OUT_SIZE(pipe),
+			MDP5_PIPE_OUT_SIZE_WIDTH(drm_rect_width(&dst)) |
+			MDP5_PIPE_OUT_SIZE_HEIGHT(drm_rect_height(&dst)));
+
+	mdp5_write(mdp5_kms, REG_MDP5_PIPE_OUT_XY(pipe),
+			MDP5_PIPE_OUT_XY_X(dst.x1) |
+			MDP5_PIPE_OUT_XY_Y(dst.y1));
+
+	if (mdp5_plane->caps & MDP_PIPE_CAP_SW_PIX_EXT) {
+		calc_pixel_ext(format, src_w, drm_rect_width(&dst), NULL,
+				pe_left, pe_right, true);
+		calc_pixel_ext(format, src_h, drm_rect_height(&dst), NULL,
+				pe_top, pe_bottom, false);
+		mdp5_write_pixel_ext(mdp5_kms, pipe, format,
+				src_w, pe_left, pe_right,
+				src_h, pe_top, pe_bottom);
+	}
+
+	spin_unlock_irqrestore(&mdp5_plane->pipe_lock, flags);
+}
+
 void mdp5_plane_complete_flip(struct drm_plane *plane)
 {
 	struct mdp5_kms *mdp5_kms = get_kms(plane);
@@ -140,7 +140,7 @@ static int smp_request_block(struct mdp5_smp *smp,
 {
 	struct mdp5_kms *mdp5_kms = get_kms(smp);
 	struct mdp5_client_smp_state *ps = &smp->client_state[cid];
-	int i, ret, avail, cur_nblks, cnt = smp->blk_cnt;
+	int i, ret = 0, avail, cur_nblks, cnt = smp->blk_cnt;
 	uint8_t reserved;
 	unsigned long flags;
 
@@ -153,15 +153,16 @@ static int smp_request_block(struct mdp5_smp *smp,
 		DBG("%d MMBs allocated (%d reserved)", nblks, reserved);
 	}
 
+	/* blocks the client already holds count towards its request: */
+	cur_nblks = bitmap_weight(ps->pending, cnt);
 	avail = cnt - bitmap_weight(smp->state, cnt);
-	if (nblks > avail) {
+	if (nblks - cur_nblks > avail) {
 		dev_err(mdp5_kms->dev->dev, "out of blks (req=%d > avail=%d)\n",
-				nblks, avail);
+				nblks - cur_nblks, avail);
 		ret = -ENOSPC;
 		goto fail;
 	}
 
-	cur_nblks = bitmap_weight(ps->pending, cnt);
 	if (nblks > cur_nblks) {
 		/* grow the existing pending reservation: */
 		for (i = cur_nblks; i < nblks; i++) {
@@ -185,7 +186,7 @@ static int smp_request_block(struct mdp5_smp *smp,
 
 fail:
 	spin_unlock_irqrestore(&smp->state_lock, flags);
-	return 0;
+	return ret;
 }
 
 static void set_fifo_thresholds(struct mdp5_smp *smp,
@@ -209,13 +210,13 @@ static void set_fifo_thresholds(struct mdp5_smp *smp,
  * decimated width.  Ie. SMP buffering sits downstream of decimation (which
  * presumably happens during the dma from scanout buffer).
  */
-int mdp5_smp_request(struct mdp5_smp *smp, enum mdp5_pipe pipe,
-		const struct mdp_format *format, u32 width, bool hdecim)
+static int smp_calculate(struct mdp5_smp *smp,
+		const struct mdp_format *format, u32 width, bool hdecim,
+		int blks[])
 {
 	struct mdp5_kms *mdp5_kms = get_kms(smp);
-	struct drm_device *dev = mdp5_kms->dev;
 	int rev = mdp5_cfg_get_hw_rev(mdp5_kms->cfg);
-	int i, hsub, nplanes, nlines, nblks, ret;
+	int i, hsub, nplanes, nlines;
 	u32 fmt = format->base.pixel_format;
 
 	nplanes = drm_format_num_planes(fmt);
@@ -239,7 +240,7 @@ int mdp5_smp_request(struct mdp5_smp *smp, enum mdp5_pipe pipe,
 			hsub = 1;
 	}
 
-	for (i = 0, nblks = 0; i < nplanes; i++) {
+	for (i = 0; i < nplanes; i++) {
 		int n, fetch_stride, cpp;
 
 		cpp = drm_format_plane_cpp(fmt, i);
@@ -251,6 +252,64 @@ int mdp5_smp_request(struct mdp5_smp *smp, enum mdp5_pipe pipe,
 		if (rev == 0)
 			n = roundup_pow_of_two(n);
 
+		blks[i] = n;
+	}
+
+	return nplanes;
+}
+
+/*
+ * Check, without allocating anything, whether the blocks @pipe needs to
+ * scan out @format at @width fit in what the pipe already holds plus the
+ * free part of the pool.  Meant for atomic_check(), so that a layer
+ * configuration that cannot be fetched is rejected up front instead of
+ * failing (or underrunning) at commit time.
+ */
+int mdp5_smp_check(struct mdp5_smp *smp, enum mdp5_pipe pipe,
+		const struct mdp_format *format, u32 width, bool hdecim)
+{
+	int blks[MAX_PLANE];
+	int i, nplanes, need = 0, avail;
+	int cnt = smp->blk_cnt;
+	unsigned long flags;
+
+	nplanes = smp_calculate(smp, format, width, hdecim, blks);
+	if (WARN_ON(nplanes > pipe2nclients(pipe)))
+		return -EINVAL;
+
+	spin_lock_irqsave(&smp->state_lock, flags);
+	for (i = 0; i < nplanes; i++) {
+		u32 cid = pipe2client(pipe, i);
+		int n = max(0, blks[i] - smp->reserved[cid]);
+
+		need += max(0, n - (int)bitmap_weight(
+				smp->client_state[cid].pending, cnt));
+	}
+	avail = cnt - bitmap_weight(smp->state, cnt);
+	spin_unlock_irqrestore(&smp->state_lock, flags);
+
+	if (need > avail) {
+		DBG("%s: needs %d more SMP blocks, %d free", pipe2name(pipe),
+				need, avail);
+		return -ENOSPC;
+	}
+
+	return 0;
+}
+
+int mdp5_smp_request(struct mdp5_smp *smp, enum mdp5_pipe pipe,
+		const struct mdp_format *format, u32 width, bool hdecim)
+{
+	struct mdp5_kms *mdp5_kms = get_kms(smp);
+	struct drm_device *dev = mdp5_kms->dev;
+	int blks[MAX_PLANE];
+	int i, nplanes, nblks, ret;
+
+	nplanes = smp_calculate(smp, format, width, hdecim, blks);
+
+	for (i = 0, nblks = 0; i < nplanes; i++) {
+		int n = blks[i];
+
 		DBG("%s[%d]: request %d SMP blocks", pipe2name(pipe), i, n);
 		ret = smp_request_block(smp, pipe2client(pipe, i), n);
 		if (ret) {
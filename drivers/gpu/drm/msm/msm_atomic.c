@@ -24,10 +24,12 @@ struct msm_commit {
 	struct drm_atomic_state *state;
 	uint32_t fence;
 	struct msm_fence_cb fence_cb;
+	struct work_struct commit_work;
 	uint32_t crtc_mask;
 };
 
 static void fence_cb(struct msm_fence_cb *cb);
+static void commit_worker(struct work_struct *work);
 
 /* block until specified crtcs are no longer pending update, and
  * atomically mark them as pending update
@@ -69,11 +71,12 @@ static struct msm_commit *commit_init(struct drm_atomic_state *state)
 	c->dev = state->dev;
 	c->state = state;
 
-	/* TODO we might need a way to indicate to run the cb on a
-	 * different wq so wait_for_vblanks() doesn't block retiring
-	 * bo's..
+	/* the fence cb runs on priv->wq, it just hands the commit over to
+	 * priv->atomic_wq, where waiting for the flip to latch doesn't
+	 * block retiring bo's, nor the commits of other crtcs:
 	 */
 	INIT_FENCE_CB(&c->fence_cb, fence_cb);
+	INIT_WORK(&c->commit_work, commit_worker);
 
 	return c;
 }
@@ -153,11 +156,20 @@ static void complete_commit(struct msm_commit *c)
 	commit_destroy(c);
 }
 
+static void commit_worker(struct work_struct *work)
+{
+	struct msm_commit *c =
+			container_of(work, struct msm_commit, commit_work);
+	complete_commit(c);
+}
+
 static void fence_cb(struct msm_fence_cb *cb)
 {
 	struct msm_commit *c =
 			container_of(cb, struct msm_commit, fence_cb);
-	complete_commit(c);
+	struct msm_drm_private *priv = c->dev->dev_private;
+
+	queue_work(priv->atomic_wq, &c->commit_work);
 }
 
 static void add_fb(struct msm_commit *c, struct drm_framebuffer *fb)
@@ -166,6 +178,28 @@ static void add_fb(struct msm_commit *c, struct drm_framebuffer *fb)
 	c->fence = max(c->fence, msm_gem_fence(to_msm_bo(obj), MSM_PREP_READ));
 }
 
+/* A legacy cursor update only touches the cursor plane, and the crtc
+ * it is on.  Unless the plane check flagged a modeset (ie. a pixel
+ * format change) there is nothing for the modeset check to do.
+ */
+static bool cursor_fast_path(struct drm_atomic_state *state)
+{
+	int ncrtcs = state->dev->mode_config.num_crtc;
+	int i;
+
+	if (!state->legacy_cursor_update)
+		return false;
+
+	for (i = 0; i < ncrtcs; i++) {
+		struct drm_crtc_state *crtc_state = state->crtc_states[i];
+
+		if (crtc_state && drm_atomic_crtc_needs_modeset(crtc_state))
+			return false;
+	}
+
+	return true;
+}
+
 int msm_atomic_check(struct drm_device *dev,
 		     struct drm_atomic_state *state)
 {
@@ -179,6 +213,9 @@ int msm_atomic_check(struct drm_device *dev,
 	if (ret)
 		return ret;
 
+	if (cursor_fast_path(state))
+		return 0;
+
 	ret = drm_atomic_helper_check_modeset(dev, state);
 	if (ret)
 		return ret;
@@ -229,9 +266,11 @@ int msm_atomic_commit(struct drm_device *dev,
 	}
 
 	/*
-	 * Figure out what fence to wait for:
+	 * Figure out what fence to wait for.  Legacy cursor updates are
+	 * unsynced (see msm_atomic_wait_for_commit_done()), that goes for
+	 * the rendering of the cursor image too:
 	 */
-	for (i = 0; i < nplanes; i++) {
+	for (i = 0; i < nplanes && !state->legacy_cursor_update; i++) {
 		struct drm_plane *plane = state->planes[i];
 		struct drm_plane_state *new_state = state->plane_states[i];
 
@@ -199,6 +199,8 @@ static int msm_unload(struct drm_device *dev)
 	drm_mode_config_cleanup(dev);
 	drm_vblank_cleanup(dev);
 
+	msm_gem_shrinker_cleanup(dev);
+
 	pm_runtime_get_sync(dev->dev);
 	drm_irq_uninstall(dev);
 	pm_runtime_put_sync(dev->dev);
@@ -206,6 +208,12 @@ static int msm_unload(struct drm_device *dev)
 	flush_workqueue(priv->wq);
 	destroy_workqueue(priv->wq);
 
+	/* after priv->wq, as fence cbs queue commits here: */
+	flush_workqueue(priv->atomic_wq);
+	destroy_workqueue(priv->atomic_wq);
+
+	msm_sync_fini(dev);
+
 	if (kms) {
 		pm_runtime_disable(dev->dev);
 		kms->funcs->destroy(kms);
@@ -344,17 +352,26 @@ static int msm_load(struct drm_device *dev, unsigned long flags)
 	}
 
 	dev->dev_private = priv;
+	priv->dev = dev;
 
 	priv->wq = alloc_ordered_workqueue("msm", 0);
+	priv->atomic_wq = alloc_workqueue("msm_atomic", WQ_HIGHPRI, 0);
 	init_waitqueue_head(&priv->fence_event);
 	init_waitqueue_head(&priv->pending_crtcs_event);
 
 	INIT_LIST_HEAD(&priv->inactive_list);
 	INIT_LIST_HEAD(&priv->fence_cbs);
+	spin_lock_init(&priv->fence_lock);
 	INIT_LIST_HEAD(&priv->vblank_ctrl.event_list);
 	INIT_WORK(&priv->vblank_ctrl.work, vblank_ctrl_worker);
 	spin_lock_init(&priv->vblank_ctrl.lock);
 
+	/* not fatal, submits just can't ask for a sync fence fd then: */
+	if (msm_sync_init(dev))
+		dev_warn(dev->dev, "failed to create sync timeline\n");
+
+	msm_gem_shrinker_init(dev);
+
 	drm_mode_config_init(dev);
 
 	platform_set_drvdata(pdev, dev);
@@ -482,6 +499,7 @@ static void msm_preclose(struct drm_device *dev, struct drm_file *file)
 	mutex_lock(&dev->struct_mutex);
 	if (ctx == priv->lastctx)
 		priv->lastctx = NULL;
+	msm_gem_forget_ctx(dev, ctx);
 	mutex_unlock(&dev->struct_mutex);
 
 	kfree(ctx);
@@ -634,6 +652,7 @@ static struct drm_info_list msm_debugfs_list[] = {
 		{"gem", show_locked, 0, msm_gem_show},
 		{ "mm", show_locked, 0, msm_mm_show },
 		{ "fb", show_locked, 0, msm_fb_show },
+		{ "purge", show_locked, 0, msm_gem_purge_show },
 };
 
 static int late_init_minor(struct drm_minor *minor)
@@ -758,9 +777,10 @@ int msm_queue_fence_cb(struct drm_device *dev,
 		struct msm_fence_cb *cb, uint32_t fence)
 {
 	struct msm_drm_private *priv = dev->dev_private;
+	unsigned long flags;
 	int ret = 0;
 
-	mutex_lock(&dev->struct_mutex);
+	spin_lock_irqsave(&priv->fence_lock, flags);
 	if (!list_empty(&cb->work.entry)) {
 		ret = -EINVAL;
 	} else if (fence > priv->completed_fence) {
@@ -769,17 +789,18 @@ int msm_queue_fence_cb(struct drm_device *dev,
 	} else {
 		queue_work(priv->wq, &cb->work);
 	}
-	mutex_unlock(&dev->struct_mutex);
+	spin_unlock_irqrestore(&priv->fence_lock, flags);
 
 	return ret;
 }
 
-/* called from workqueue */
+/* called from workqueue, doesn't need struct_mutex */
 void msm_update_fence(struct drm_device *dev, uint32_t fence)
 {
 	struct msm_drm_private *priv = dev->dev_private;
+	unsigned long flags;
 
-	mutex_lock(&dev->struct_mutex);
+	spin_lock_irqsave(&priv->fence_lock, flags);
 	priv->completed_fence = max(fence, priv->completed_fence);
 
 	while (!list_empty(&priv->fence_cbs)) {
@@ -795,9 +816,10 @@ void msm_update_fence(struct drm_device *dev, uint32_t fence)
 		queue_work(priv->wq, &cb->work);
 	}
 
-	mutex_unlock(&dev->struct_mutex);
+	spin_unlock_irqrestore(&priv->fence_lock, flags);
 
 	wake_up_all(&priv->fence_event);
+	msm_sync_signal(dev);
 }
 
 void __msm_fence_worker(struct work_struct *work)
@@ -867,7 +889,8 @@ static int msm_ioctl_gem_cpu_prep(struct drm_device *dev, void *data,
 	if (!obj)
 		return -ENOENT;
 
-	ret = msm_gem_cpu_prep(obj, args->op, &timeout);
+	ret = msm_gem_cpu_prep(obj, args->op, &timeout,
+			args->offset, args->size);
 
 	drm_gem_object_unreference_unlocked(obj);
 
@@ -881,11 +904,16 @@ static int msm_ioctl_gem_cpu_fini(struct drm_device *dev, void *data,
 	struct drm_gem_object *obj;
 	int ret;
 
+	if (args->op & ~MSM_PREP_FLAGS) {
+		DRM_ERROR("invalid op: %08x\n", args->op);
+		return -EINVAL;
+	}
+
 	obj = drm_gem_object_lookup(dev, file, args->handle);
 	if (!obj)
 		return -ENOENT;
 
-	ret = msm_gem_cpu_fini(obj);
+	ret = msm_gem_cpu_fini(obj, args->op, args->offset, args->size);
 
 	drm_gem_object_unreference_unlocked(obj);
 
@@ -927,6 +955,45 @@ static int msm_ioctl_wait_fence(struct drm_device *dev, void *data,
 	return msm_wait_fence(dev, args->fence, &timeout, true);
 }
 
+static int msm_ioctl_gem_madvise(struct drm_device *dev, void *data,
+		struct drm_file *file)
+{
+	struct drm_msm_gem_madvise *args = data;
+	struct drm_gem_object *obj;
+	int ret;
+
+	switch (args->madv) {
+	case MSM_MADV_DONTNEED:
+	case MSM_MADV_WILLNEED:
+		break;
+	default:
+		DRM_ERROR("invalid madv: %u\n", args->madv);
+		return -EINVAL;
+	}
+
+	ret = mutex_lock_interruptible(&dev->struct_mutex);
+	if (ret)
+		return ret;
+
+	obj = drm_gem_object_lookup(dev, file, args->handle);
+	if (!obj) {
+		ret = -ENOENT;
+		goto unlock;
+	}
+
+	ret = msm_gem_madvise(obj, args->madv, file->driver_priv);
+	if (ret >= 0) {
+		args->retained = ret;
+		ret = 0;
+	}
+
+	drm_gem_object_unreference(obj);
+
+unlock:
+	mutex_unlock(&dev->struct_mutex);
+	return ret;
+}
+
 static const struct drm_ioctl_desc msm_ioctls[] = {
 	DRM_IOCTL_DEF_DRV(MSM_GET_PARAM,    msm_ioctl_get_param,    DRM_AUTH|DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(MSM_GEM_NEW,      msm_ioctl_gem_new,      DRM_AUTH|DRM_RENDER_ALLOW),
@@ -935,6 +1002,7 @@ static const struct drm_ioctl_desc msm_ioctls[] = {
 	DRM_IOCTL_DEF_DRV(MSM_GEM_CPU_FINI, msm_ioctl_gem_cpu_fini, DRM_AUTH|DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(MSM_GEM_SUBMIT,   msm_ioctl_gem_submit,   DRM_AUTH|DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(MSM_WAIT_FENCE,   msm_ioctl_wait_fence,   DRM_AUTH|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(MSM_GEM_MADVISE,  msm_ioctl_gem_madvise,  DRM_AUTH|DRM_RENDER_ALLOW),
 };
 
 static const struct vm_operations_struct vm_ops = {
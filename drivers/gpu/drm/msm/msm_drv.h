@@ -54,6 +54,7 @@ struct msm_mmu;
 struct msm_rd_state;
 struct msm_perf_state;
 struct msm_gem_submit;
+struct msm_timeline;
 
 #define NUM_DOMAINS 2    /* one for KMS, then one per gpu core (?) */
 
@@ -62,7 +63,12 @@ struct msm_file_private {
 	 * per-context address spaces are supported we'd keep track of
 	 * the context's page-tables here.
 	 */
-	int dummy;
+
+	/* bo's this file marked DONTNEED that the shrinker purged, under
+	 * struct_mutex:
+	 */
+	unsigned long purged_objs;
+	size_t purged_bytes;
 };
 
 enum msm_mdp_plane_property {
@@ -80,6 +86,8 @@ struct msm_vblank_ctrl {
 
 struct msm_drm_private {
 
+	struct drm_device *dev;
+
 	struct msm_kms *kms;
 
 	/* subordinate devices, if present: */
@@ -108,14 +116,30 @@ struct msm_drm_private {
 	uint32_t next_fence, completed_fence;
 	wait_queue_head_t fence_event;
 
+	/* protects completed_fence and fence_cbs, so that fences can be
+	 * retired without struct_mutex:
+	 */
+	spinlock_t fence_lock;
+
+	/* sync fences handed out for submits, if CONFIG_SYNC: */
+	struct msm_timeline *timeline;
+
 	struct msm_rd_state *rd;
 	struct msm_perf_state *perf;
 
-	/* list of GEM objects: */
+	/* list of GEM objects, least recently used first: */
 	struct list_head inactive_list;
 
+	/* purges of DONTNEED bo's under memory pressure: */
+	struct shrinker shrinker;
+	unsigned long purged_objs;
+	size_t purged_bytes;
+
 	struct workqueue_struct *wq;
 
+	/* async atomic commits, once their fences have signalled: */
+	struct workqueue_struct *atomic_wq;
+
 	/* callbacks deferred until bo is inactive: */
 	struct list_head fence_cbs;
 
@@ -189,6 +213,27 @@ int msm_queue_fence_cb(struct drm_device *dev,
 		struct msm_fence_cb *cb, uint32_t fence);
 void msm_update_fence(struct drm_device *dev, uint32_t fence);
 
+#ifdef CONFIG_SYNC
+int msm_sync_init(struct drm_device *dev);
+void msm_sync_fini(struct drm_device *dev);
+void msm_sync_signal(struct drm_device *dev);
+int msm_sync_fence_fd(struct drm_device *dev, uint32_t fence);
+#else
+static inline int msm_sync_init(struct drm_device *dev)
+{
+	return 0;
+}
+static inline void msm_sync_fini(struct drm_device *dev) {}
+static inline void msm_sync_signal(struct drm_device *dev) {}
+static inline int msm_sync_fence_fd(struct drm_device *dev, uint32_t fence)
+{
+	return -ENODEV;
+}
+#endif
+
+void msm_gem_shrinker_init(struct drm_device *dev);
+void msm_gem_shrinker_cleanup(struct drm_device *dev);
+
 int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 		struct drm_file *file);
 
@@ -223,9 +268,14 @@ int msm_gem_queue_inactive_cb(struct drm_gem_object *obj,
 void msm_gem_move_to_active(struct drm_gem_object *obj,
 		struct msm_gpu *gpu, bool write, uint32_t fence);
 void msm_gem_move_to_inactive(struct drm_gem_object *obj);
+int msm_gem_madvise(struct drm_gem_object *obj, unsigned madv,
+		struct msm_file_private *ctx);
+void msm_gem_purge(struct drm_gem_object *obj);
+void msm_gem_forget_ctx(struct drm_device *dev, struct msm_file_private *ctx);
 int msm_gem_cpu_prep(struct drm_gem_object *obj, uint32_t op,
-		ktime_t *timeout);
-int msm_gem_cpu_fini(struct drm_gem_object *obj);
+		ktime_t *timeout, uint64_t offset, uint64_t size);
+int msm_gem_cpu_fini(struct drm_gem_object *obj, uint32_t op,
+		uint64_t offset, uint64_t size);
 void msm_gem_free_object(struct drm_gem_object *obj);
 int msm_gem_new_handle(struct drm_device *dev, struct drm_file *file,
 		uint32_t size, uint32_t flags, uint32_t *handle);
@@ -269,6 +319,7 @@ void __init msm_dsi_register(void);
 void __exit msm_dsi_unregister(void);
 int msm_dsi_modeset_init(struct msm_dsi *msm_dsi, struct drm_device *dev,
 		struct drm_encoder *encoders[MSM_DSI_ENCODER_NUM]);
+int msm_dsi_set_roi(struct drm_encoder *encoder, const struct drm_rect *roi);
 #else
 static inline void __init msm_dsi_register(void)
 {
@@ -282,11 +333,17 @@ static inline int msm_dsi_modeset_init(struct msm_dsi *msm_dsi,
 {
 	return -EINVAL;
 }
+static inline int msm_dsi_set_roi(struct drm_encoder *encoder,
+		const struct drm_rect *roi)
+{
+	return -EINVAL;
+}
 #endif
 
 #ifdef CONFIG_DEBUG_FS
 void msm_gem_describe(struct drm_gem_object *obj, struct seq_file *m);
 void msm_gem_describe_objects(struct list_head *list, struct seq_file *m);
+int msm_gem_purge_show(struct drm_device *dev, struct seq_file *m);
 void msm_framebuffer_describe(struct drm_framebuffer *fb, struct seq_file *m);
 int msm_debugfs_late_init(struct drm_device *dev);
 int msm_rd_debugfs_init(struct drm_minor *minor);
@@ -20,6 +20,7 @@
 
 #include "drm_crtc.h"
 #include "drm_crtc_helper.h"
+#include <drm/drm_atomic.h>
 
 struct msm_framebuffer {
 	struct drm_framebuffer base;
@@ -56,11 +57,167 @@ static void msm_framebuffer_destroy(struct drm_framebuffer *fb)
 	kfree(msm_fb);
 }
 
+/* merge the clip list into one rectangle, in framebuffer coordinates: */
+static void msm_framebuffer_damage(struct drm_framebuffer *fb,
+		struct drm_clip_rect *clips, unsigned num_clips,
+		struct drm_rect *damage)
+{
+	struct drm_rect bounds = {
+		.x2 = fb->width,
+		.y2 = fb->height,
+	};
+	unsigned i;
+
+	if (!num_clips) {
+		*damage = bounds;
+		return;
+	}
+
+	damage->x1 = damage->y1 = INT_MAX;
+	damage->x2 = damage->y2 = INT_MIN;
+
+	for (i = 0; i < num_clips; i++) {
+		damage->x1 = min_t(int, damage->x1, clips[i].x1);
+		damage->y1 = min_t(int, damage->y1, clips[i].y1);
+		damage->x2 = max_t(int, damage->x2, clips[i].x2);
+		damage->y2 = max_t(int, damage->y2, clips[i].y2);
+	}
+
+	drm_rect_intersect(damage, &bounds);
+}
+
+/*
+ * Translate @damage from the framebuffer to the CRTC scanning out
+ * @state.  Returns false if the plane does not show any of it.  For
+ * scaled or reflected planes the whole plane is reported damaged.
+ */
+static bool msm_framebuffer_plane_damage(struct drm_plane_state *state,
+		const struct drm_rect *damage, struct drm_rect *r)
+{
+	struct drm_rect src = {
+		.x1 = state->src_x >> 16,
+		.y1 = state->src_y >> 16,
+		.x2 = (state->src_x + state->src_w) >> 16,
+		.y2 = (state->src_y + state->src_h) >> 16,
+	};
+
+	*r = *damage;
+	if (!drm_rect_intersect(r, &src))
+		return false;
+
+	if (drm_rect_width(&src) != state->crtc_w ||
+			drm_rect_height(&src) != state->crtc_h ||
+			(state->rotation & (BIT(DRM_REFLECT_X) |
+					    BIT(DRM_REFLECT_Y)))) {
+		r->x1 = state->crtc_x;
+		r->y1 = state->crtc_y;
+		r->x2 = state->crtc_x + state->crtc_w;
+		r->y2 = state->crtc_y + state->crtc_h;
+		return true;
+	}
+
+	drm_rect_translate(r, state->crtc_x - src.x1, state->crtc_y - src.y1);
+
+	return true;
+}
+
+/*
+ * Front buffer rendering: command mode panels only refresh from their
+ * own memory, so nothing written to a scanned out fb becomes visible
+ * until the next flush.  Re-commit every plane showing the damaged
+ * part of @fb, which flushes its CTL and, for command mode, pushes a
+ * new frame.
+ *
+ * The clips are merged into a single damage rectangle per CRTC and
+ * passed on to the kms, which may limit the transfer to that region.
+ */
 static int msm_framebuffer_dirty(struct drm_framebuffer *fb,
 		struct drm_file *file_priv, unsigned flags, unsigned color,
 		struct drm_clip_rect *clips, unsigned num_clips)
 {
-	return 0;
+	struct drm_device *dev = fb->dev;
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_kms *kms = priv->kms;
+	struct drm_modeset_acquire_ctx ctx;
+	struct drm_atomic_state *state;
+	struct drm_plane *plane;
+	struct drm_rect damage;
+	bool found;
+	int ret;
+
+	msm_framebuffer_damage(fb, clips, num_clips, &damage);
+	if (!drm_rect_visible(&damage))
+		return 0;
+
+	drm_modeset_acquire_init(&ctx, 0);
+
+	state = drm_atomic_state_alloc(dev);
+	if (!state) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	state->acquire_ctx = &ctx;
+
+retry:
+	found = false;
+	drm_for_each_plane(plane, dev) {
+		struct drm_plane_state *plane_state;
+		struct drm_crtc_state *crtc_state;
+		struct drm_rect r;
+
+		ret = drm_modeset_lock(&plane->mutex, &ctx);
+		if (ret)
+			goto fail;
+
+		if (plane->state->fb != fb || !plane->state->crtc ||
+				!msm_framebuffer_plane_damage(plane->state,
+						&damage, &r)) {
+			drm_modeset_unlock(&plane->mutex);
+			continue;
+		}
+
+		plane_state = drm_atomic_get_plane_state(state, plane);
+		if (IS_ERR(plane_state)) {
+			ret = PTR_ERR(plane_state);
+			goto fail;
+		}
+
+		/* the crtc must be part of the commit to get flushed: */
+		crtc_state = drm_atomic_get_crtc_state(state,
+				plane_state->crtc);
+		if (IS_ERR(crtc_state)) {
+			ret = PTR_ERR(crtc_state);
+			goto fail;
+		}
+
+		if (kms->funcs->add_damage)
+			kms->funcs->add_damage(kms, crtc_state, &r);
+
+		found = true;
+	}
+
+	if (!found) {
+		ret = 0;
+		goto fail;
+	}
+
+	ret = drm_atomic_commit(state);
+	if (!ret)
+		goto out;
+
+fail:
+	if (ret == -EDEADLK) {
+		drm_atomic_state_clear(state);
+		drm_modeset_backoff(&ctx);
+		goto retry;
+	}
+
+	drm_atomic_state_free(state);
+out:
+	drm_modeset_drop_locks(&ctx);
+	drm_modeset_acquire_fini(&ctx);
+
+	return ret;
 }
 
 static const struct drm_framebuffer_funcs msm_framebuffer_funcs = {
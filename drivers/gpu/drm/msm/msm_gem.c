@@ -78,6 +78,10 @@ static struct page **get_pages(struct drm_gem_object *obj)
 		struct page **p;
 		int npages = obj->size >> PAGE_SHIFT;
 
+		/* the contents are gone, don't quietly hand out new pages: */
+		if (msm_obj->madv == __MSM_MADV_PURGED)
+			return ERR_PTR(-EBUSY);
+
 		if (use_pages(obj))
 			p = drm_gem_get_pages(obj);
 		else
@@ -97,10 +101,11 @@ static struct page **get_pages(struct drm_gem_object *obj)
 
 		msm_obj->pages = p;
 
-		/* For non-cached buffers, ensure the new pages are clean
-		 * because display controller, GPU, etc. are not coherent:
+		/* Unless coherent, ensure the new pages are clean because
+		 * display controller, GPU, etc. are not coherent.  For cached
+		 * buffers the mapping is also what cpu_prep/cpu_fini sync:
 		 */
-		if (msm_obj->flags & (MSM_BO_WC|MSM_BO_UNCACHED))
+		if (msm_obj->flags & (MSM_BO_WC|MSM_BO_UNCACHED|MSM_BO_CACHED))
 			dma_map_sg(dev->dev, msm_obj->sgt->sgl,
 					msm_obj->sgt->nents, DMA_BIDIRECTIONAL);
 	}
@@ -113,10 +118,10 @@ static void put_pages(struct drm_gem_object *obj)
 	struct msm_gem_object *msm_obj = to_msm_bo(obj);
 
 	if (msm_obj->pages) {
-		/* For non-cached buffers, ensure the new pages are clean
+		/* For non-coherent buffers, ensure the new pages are clean
 		 * because display controller, GPU, etc. are not coherent:
 		 */
-		if (msm_obj->flags & (MSM_BO_WC|MSM_BO_UNCACHED))
+		if (msm_obj->flags & (MSM_BO_WC|MSM_BO_UNCACHED|MSM_BO_CACHED))
 			dma_unmap_sg(obj->dev->dev, msm_obj->sgt->sgl,
 					msm_obj->sgt->nents, DMA_BIDIRECTIONAL);
 		sg_free_table(msm_obj->sgt);
@@ -194,6 +199,7 @@ int msm_gem_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 {
 	struct drm_gem_object *obj = vma->vm_private_data;
 	struct drm_device *dev = obj->dev;
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
 	struct page **pages;
 	unsigned long pfn;
 	pgoff_t pgoff;
@@ -206,6 +212,11 @@ int msm_gem_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	if (ret)
 		goto out;
 
+	if (msm_obj->madv != MSM_MADV_WILLNEED) {
+		mutex_unlock(&dev->struct_mutex);
+		return VM_FAULT_SIGBUS;
+	}
+
 	/* make sure we have pages attached now */
 	pages = get_pages(obj);
 	if (IS_ERR(pages)) {
@@ -295,14 +306,19 @@ int msm_gem_get_iova_locked(struct drm_gem_object *obj, int id,
 
 		if (iommu_present(&platform_bus_type)) {
 			struct msm_mmu *mmu = priv->mmus[id];
+			int prot = IOMMU_READ | IOMMU_WRITE;
 			uint32_t offset;
 
 			if (WARN_ON(!mmu))
 				return -EINVAL;
 
+			/* snoop the cpu caches: */
+			if (msm_obj->flags & MSM_BO_CACHED_COHERENT)
+				prot |= IOMMU_CACHE;
+
 			offset = (uint32_t)mmap_offset(obj);
 			ret = mmu->funcs->map(mmu, offset, msm_obj->sgt,
-					obj->size, IOMMU_READ | IOMMU_WRITE);
+					obj->size, prot);
 			msm_obj->domain[id].iova = offset;
 		} else {
 			msm_obj->domain[id].iova = physaddr(obj);
@@ -448,7 +464,154 @@ void msm_gem_move_to_inactive(struct drm_gem_object *obj)
 	list_add_tail(&msm_obj->mm_list, &priv->inactive_list);
 }
 
-int msm_gem_cpu_prep(struct drm_gem_object *obj, uint32_t op, ktime_t *timeout)
+/* returns whether the backing pages are still there */
+int msm_gem_madvise(struct drm_gem_object *obj, unsigned madv,
+		struct msm_file_private *ctx)
+{
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+
+	WARN_ON(!mutex_is_locked(&obj->dev->struct_mutex));
+
+	if (msm_obj->madv != __MSM_MADV_PURGED) {
+		msm_obj->madv = madv;
+		msm_obj->madv_ctx = (madv == MSM_MADV_DONTNEED) ? ctx : NULL;
+	}
+
+	return (msm_obj->madv != __MSM_MADV_PURGED);
+}
+
+/* drop the backing pages of an idle DONTNEED bo, unmapping it from the
+ * gpu and from userspace first:
+ */
+void msm_gem_purge(struct drm_gem_object *obj)
+{
+	struct drm_device *dev = obj->dev;
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+	int id;
+
+	WARN_ON(!mutex_is_locked(&dev->struct_mutex));
+	WARN_ON(!is_purgeable(msm_obj));
+	WARN_ON(is_active(msm_obj));
+
+	for (id = 0; id < ARRAY_SIZE(msm_obj->domain); id++) {
+		struct msm_mmu *mmu = priv->mmus[id];
+		if (mmu && msm_obj->domain[id].iova) {
+			uint32_t offset = msm_obj->domain[id].iova;
+			mmu->funcs->unmap(mmu, offset, msm_obj->sgt, obj->size);
+		}
+		msm_obj->domain[id].iova = 0;
+	}
+
+	if (msm_obj->vaddr) {
+		vunmap(msm_obj->vaddr);
+		msm_obj->vaddr = NULL;
+	}
+
+	put_pages(obj);
+
+	msm_obj->madv = __MSM_MADV_PURGED;
+
+	if (msm_obj->madv_ctx) {
+		msm_obj->madv_ctx->purged_objs++;
+		msm_obj->madv_ctx->purged_bytes += obj->size;
+		msm_obj->madv_ctx = NULL;
+	}
+	priv->purged_objs++;
+	priv->purged_bytes += obj->size;
+
+	/* the iova is the mmap offset, so both go away together: */
+	drm_vma_node_unmap(&obj->vma_node, dev->anon_inode->i_mapping);
+	drm_gem_free_mmap_offset(obj);
+
+	/* we are called under memory pressure, so have shmem drop the
+	 * backing pages (and any swap) now rather than on final free:
+	 */
+	shmem_truncate_range(file_inode(obj->filp), 0, (loff_t)-1);
+
+	invalidate_mapping_pages(file_inode(obj->filp)->i_mapping,
+			0, (loff_t)-1);
+}
+
+/* called when @ctx goes away, so purges are no longer accounted to it */
+void msm_gem_forget_ctx(struct drm_device *dev, struct msm_file_private *ctx)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_gem_object *msm_obj;
+
+	WARN_ON(!mutex_is_locked(&dev->struct_mutex));
+
+	list_for_each_entry(msm_obj, &priv->inactive_list, mm_list)
+		if (msm_obj->madv_ctx == ctx)
+			msm_obj->madv_ctx = NULL;
+	if (priv->gpu)
+		list_for_each_entry(msm_obj, &priv->gpu->active_list, mm_list)
+			if (msm_obj->madv_ctx == ctx)
+				msm_obj->madv_ctx = NULL;
+}
+
+static enum dma_data_direction prep_dir(uint32_t op)
+{
+	switch (op & (MSM_PREP_READ | MSM_PREP_WRITE)) {
+	case MSM_PREP_READ:
+		return DMA_FROM_DEVICE;
+	case MSM_PREP_WRITE:
+		return DMA_TO_DEVICE;
+	default:
+		return DMA_BIDIRECTIONAL;
+	}
+}
+
+/* Cache maintenance for the cpu mapping of a cached bo, over just the
+ * part of the sg table covering [offset, offset + size).  Called with
+ * struct_mutex held, so that the pages can't get purged under us.
+ */
+static int sync_range(struct drm_gem_object *obj, uint64_t offset,
+		uint64_t size, enum dma_data_direction dir, bool for_cpu)
+{
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+	struct device *dev = obj->dev->dev;
+	struct scatterlist *sg;
+	uint64_t end, pos = 0;
+	int i;
+
+	if (offset > obj->size || size > obj->size - offset)
+		return -EINVAL;
+
+	/* imported bo's are the exporter's business, and until there are
+	 * pages there is nothing cached to maintain:
+	 */
+	if (!(msm_obj->flags & MSM_BO_CACHED) || obj->import_attach ||
+			!msm_obj->sgt)
+		return 0;
+
+	end = size ? offset + size : obj->size;
+
+	for_each_sg(msm_obj->sgt->sgl, sg, msm_obj->sgt->nents, i) {
+		uint64_t start = max(offset, pos);
+		uint64_t stop = min(end, pos + sg_dma_len(sg));
+
+		if (start < stop) {
+			dma_addr_t addr = sg_dma_address(sg) + (start - pos);
+
+			if (for_cpu)
+				dma_sync_single_for_cpu(dev, addr,
+						stop - start, dir);
+			else
+				dma_sync_single_for_device(dev, addr,
+						stop - start, dir);
+		}
+
+		pos += sg_dma_len(sg);
+		if (pos >= end)
+			break;
+	}
+
+	return 0;
+}
+
+int msm_gem_cpu_prep(struct drm_gem_object *obj, uint32_t op,
+		ktime_t *timeout, uint64_t offset, uint64_t size)
 {
 	struct drm_device *dev = obj->dev;
 	struct msm_gem_object *msm_obj = to_msm_bo(obj);
@@ -461,17 +624,32 @@ int msm_gem_cpu_prep(struct drm_gem_object *obj, uint32_t op, ktime_t *timeout)
 			timeout = NULL;
 
 		ret = msm_wait_fence(dev, fence, timeout, true);
+		if (ret)
+			return ret;
 	}
 
-	/* TODO cache maintenance */
+	mutex_lock(&dev->struct_mutex);
+	ret = sync_range(obj, offset, size, prep_dir(op), true);
+	mutex_unlock(&dev->struct_mutex);
 
 	return ret;
 }
 
-int msm_gem_cpu_fini(struct drm_gem_object *obj)
+int msm_gem_cpu_fini(struct drm_gem_object *obj, uint32_t op,
+		uint64_t offset, uint64_t size)
 {
-	/* TODO cache maintenance */
-	return 0;
+	struct drm_device *dev = obj->dev;
+	int ret;
+
+	/* only what the cpu wrote needs to be written back: */
+	if (op && !(op & MSM_PREP_WRITE))
+		return 0;
+
+	mutex_lock(&dev->struct_mutex);
+	ret = sync_range(obj, offset, size, DMA_TO_DEVICE, false);
+	mutex_unlock(&dev->struct_mutex);
+
+	return ret;
 }
 
 #ifdef CONFIG_DEBUG_FS
@@ -593,6 +771,12 @@ static int msm_gem_new_impl(struct drm_device *dev,
 	case MSM_BO_CACHED:
 	case MSM_BO_WC:
 		break;
+	case MSM_BO_CACHED_COHERENT:
+		if (!is_device_dma_coherent(dev->dev)) {
+			dev_err(dev->dev, "no io-coherency for cached-coherent bo\n");
+			return -EINVAL;
+		}
+		break;
 	default:
 		dev_err(dev->dev, "invalid cache flag: %x\n",
 				(flags & MSM_BO_CACHE_MASK));
@@ -623,7 +807,6 @@ static int msm_gem_new_impl(struct drm_device *dev,
 	msm_obj->resv = &msm_obj->_resv;
 	reservation_object_init(msm_obj->resv);
 
-	INIT_LIST_HEAD(&msm_obj->submit_entry);
 	list_add_tail(&msm_obj->mm_list, &priv->inactive_list);
 
 	*obj = &msm_obj->base;
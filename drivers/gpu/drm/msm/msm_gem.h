@@ -41,12 +41,11 @@ struct msm_gem_object {
 	struct msm_gpu *gpu;     /* non-null if active */
 	uint32_t read_fence, write_fence;
 
-	/* Transiently in the process of submit ioctl, objects associated
-	 * with the submit are on submit->bo_list.. this only lasts for
-	 * the duration of the ioctl, so one bo can never be on multiple
-	 * submit lists.
+	/* MSM_MADV_x, and the file that last marked the bo DONTNEED, which
+	 * gets the purge accounted:
 	 */
-	struct list_head submit_entry;
+	uint8_t madv;
+	struct msm_file_private *madv_ctx;
 
 	struct page **pages;
 	struct sg_table *sgt;
@@ -73,6 +72,13 @@ static inline bool is_active(struct msm_gem_object *msm_obj)
 	return msm_obj->gpu != NULL;
 }
 
+static inline bool is_purgeable(struct msm_gem_object *msm_obj)
+{
+	return (msm_obj->madv == MSM_MADV_DONTNEED) && msm_obj->sgt &&
+			msm_obj->base.filp && !msm_obj->base.dma_buf &&
+			!msm_obj->base.import_attach;
+}
+
 static inline uint32_t msm_gem_fence(struct msm_gem_object *msm_obj,
 		uint32_t op)
 {
@@ -97,7 +103,6 @@ struct msm_gem_submit {
 	struct drm_device *dev;
 	struct msm_gpu *gpu;
 	struct list_head node;   /* node in gpu submit_list */
-	struct list_head bo_list;
 	struct ww_acquire_ctx ticket;
 	uint32_t fence;
 	bool valid;
@@ -111,6 +116,7 @@ struct msm_gem_submit {
 	} cmd[MAX_CMDS];
 	struct {
 		uint32_t flags;
+		uint32_t handle;
 		struct msm_gem_object *obj;
 		uint32_t iova;
 	} bos[0];
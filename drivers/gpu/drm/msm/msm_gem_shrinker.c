@@ -0,0 +1,136 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "msm_drv.h"
+#include "msm_gem.h"
+
+/* We get called from reclaim, possibly by an allocation made somewhere
+ * under struct_mutex, so only ever trylock.  If it is busy the shrinker
+ * just reports nothing to free this time around.
+ */
+
+static unsigned long
+msm_gem_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	struct msm_drm_private *priv =
+		container_of(shrinker, struct msm_drm_private, shrinker);
+	struct drm_device *dev = priv->dev;
+	struct msm_gem_object *msm_obj;
+	unsigned long count = 0;
+
+	if (!mutex_trylock(&dev->struct_mutex))
+		return 0;
+
+	list_for_each_entry(msm_obj, &priv->inactive_list, mm_list) {
+		if (is_purgeable(msm_obj))
+			count += msm_obj->base.size >> PAGE_SHIFT;
+	}
+
+	mutex_unlock(&dev->struct_mutex);
+
+	return count;
+}
+
+static unsigned long
+msm_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	struct msm_drm_private *priv =
+		container_of(shrinker, struct msm_drm_private, shrinker);
+	struct drm_device *dev = priv->dev;
+	struct msm_gem_object *msm_obj;
+	unsigned long freed = 0;
+
+	if (!mutex_trylock(&dev->struct_mutex))
+		return SHRINK_STOP;
+
+	/* the inactive list is in retire order, so the bo's idle for the
+	 * longest go first:
+	 */
+	list_for_each_entry(msm_obj, &priv->inactive_list, mm_list) {
+		if (freed >= sc->nr_to_scan)
+			break;
+		if (is_purgeable(msm_obj)) {
+			msm_gem_purge(&msm_obj->base);
+			freed += msm_obj->base.size >> PAGE_SHIFT;
+		}
+	}
+
+	mutex_unlock(&dev->struct_mutex);
+
+	if (freed > 0)
+		DBG("purged %lu pages", freed);
+
+	return freed;
+}
+
+void msm_gem_shrinker_init(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+
+	priv->shrinker.count_objects = msm_gem_shrinker_count;
+	priv->shrinker.scan_objects = msm_gem_shrinker_scan;
+	priv->shrinker.seeks = DEFAULT_SEEKS;
+	WARN_ON(register_shrinker(&priv->shrinker));
+}
+
+void msm_gem_shrinker_cleanup(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+
+	/* not registered if msm_load() bailed out early: */
+	if (priv->shrinker.nr_deferred)
+		unregister_shrinker(&priv->shrinker);
+}
+
+#ifdef CONFIG_DEBUG_FS
+int msm_gem_purge_show(struct drm_device *dev, struct seq_file *m)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_gem_object *msm_obj;
+	struct drm_file *file;
+	unsigned long dontneed = 0;
+
+	WARN_ON(!mutex_is_locked(&dev->struct_mutex));
+
+	list_for_each_entry(msm_obj, &priv->inactive_list, mm_list) {
+		if (is_purgeable(msm_obj))
+			dontneed += msm_obj->base.size;
+	}
+
+	seq_printf(m, "purgeable: %lu KiB\n", dontneed >> 10);
+	seq_printf(m, "purged:    %lu objects, %zu KiB\n",
+			priv->purged_objs, priv->purged_bytes >> 10);
+
+	seq_printf(m, "%20s %5s %10s %10s\n",
+			"command", "pid", "objects", "KiB");
+
+	list_for_each_entry_reverse(file, &dev->filelist, lhead) {
+		struct msm_file_private *ctx = file->driver_priv;
+		struct task_struct *task;
+
+		if (!ctx)
+			continue;
+
+		rcu_read_lock(); /* locks pid_task()->comm */
+		task = pid_task(file->pid, PIDTYPE_PID);
+		seq_printf(m, "%20s %5d %10lu %10zu\n",
+				task ? task->comm : "<unknown>",
+				pid_vnr(file->pid),
+				ctx->purged_objs, ctx->purged_bytes >> 10);
+		rcu_read_unlock();
+	}
+
+	return 0;
+}
+#endif
@@ -28,11 +28,80 @@
 #define BO_LOCKED   0x4000
 #define BO_PINNED   0x2000
 
+/* a3xx/a4xx can't preempt, and there is a single ring, so the only lever
+ * we have is how much work sits in the ring in front of a new submit.
+ * Submits from background tasks (SCHED_IDLE/SCHED_BATCH, or a positive
+ * nice value) are held back in the ioctl while the ring is busy, so they
+ * can't pile up in front of foreground rendering.  That is throttling,
+ * not scheduling: once in the ring, a background submit still runs to
+ * completion ahead of anything queued after it.
+ */
+static uint lowprio_depth = 2;
+MODULE_PARM_DESC(lowprio_depth, "Max submits in flight when a background submit is queued (0=no limit)");
+module_param(lowprio_depth, uint, 0600);
+
+/* ..and so that a steady stream of foreground work can't starve them,
+ * they go in regardless after waiting this long:
+ */
+static uint lowprio_timeout_ms = 100;
+MODULE_PARM_DESC(lowprio_timeout_ms, "Max time a background submit is held back, in ms");
+module_param(lowprio_timeout_ms, uint, 0600);
+
 static inline void __user *to_user_ptr(u64 address)
 {
 	return (void __user *)(uintptr_t)address;
 }
 
+static bool submit_is_lowprio(void)
+{
+	return current->policy == SCHED_IDLE ||
+		current->policy == SCHED_BATCH ||
+		task_nice(current) > 0;
+}
+
+static bool ring_has_room(struct msm_gpu *gpu)
+{
+	struct msm_drm_private *priv = gpu->dev->dev_private;
+	uint32_t depth = READ_ONCE(lowprio_depth);
+
+	if (!depth)
+		return true;
+
+	return (gpu->submitted_fence - priv->completed_fence) < depth;
+}
+
+/* Take struct_mutex for the submit, once it may go into the ring.  The
+ * room is re-checked under the lock, as other background submitters may
+ * have been woken up by the same retire.
+ */
+static int submit_lock_ring(struct drm_device *dev, struct msm_gpu *gpu)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	unsigned long timeout;
+	long ret;
+
+	if (!submit_is_lowprio()) {
+		mutex_lock(&dev->struct_mutex);
+		return 0;
+	}
+
+	timeout = msecs_to_jiffies(READ_ONCE(lowprio_timeout_ms));
+
+	for (;;) {
+		ret = wait_event_interruptible_timeout(priv->fence_event,
+				ring_has_room(gpu), timeout);
+		if (ret < 0)
+			return ret;
+
+		mutex_lock(&dev->struct_mutex);
+		if (!ret || ring_has_room(gpu))
+			return 0;
+		mutex_unlock(&dev->struct_mutex);
+
+		timeout = ret;
+	}
+}
+
 static struct msm_gem_submit *submit_create(struct drm_device *dev,
 		struct msm_gpu *gpu, int nr)
 {
@@ -48,68 +117,62 @@ static struct msm_gem_submit *submit_create(struct drm_device *dev,
 		submit->nr_bos = 0;
 		submit->nr_cmds = 0;
 
-		INIT_LIST_HEAD(&submit->bo_list);
 		ww_acquire_init(&submit->ticket, &reservation_ww_class);
 	}
 
 	return submit;
 }
 
+/* Called without struct_mutex, the bo's are only referenced here.  The
+ * same bo listed twice is caught when reserving it in validate_objects().
+ */
 static int submit_lookup_objects(struct msm_gem_submit *submit,
 		struct drm_msm_gem_submit *args, struct drm_file *file)
 {
 	unsigned i;
 	int ret = 0;
 
-	spin_lock(&file->table_lock);
-
+	/* copy the whole table first, can't fault under table_lock: */
 	for (i = 0; i < args->nr_bos; i++) {
 		struct drm_msm_gem_submit_bo submit_bo;
-		struct drm_gem_object *obj;
-		struct msm_gem_object *msm_obj;
 		void __user *userptr =
 			to_user_ptr(args->bos + (i * sizeof(submit_bo)));
 
 		ret = copy_from_user(&submit_bo, userptr, sizeof(submit_bo));
-		if (ret) {
-			ret = -EFAULT;
-			goto out_unlock;
-		}
+		if (ret)
+			return -EFAULT;
 
 		if (submit_bo.flags & ~MSM_SUBMIT_BO_FLAGS) {
 			DRM_ERROR("invalid flags: %x\n", submit_bo.flags);
-			ret = -EINVAL;
-			goto out_unlock;
+			return -EINVAL;
 		}
 
 		submit->bos[i].flags = submit_bo.flags;
 		/* in validate_objects() we figure out if this is true: */
 		submit->bos[i].iova  = submit_bo.presumed;
+		/* stash the handle until the lookup below: */
+		submit->bos[i].handle = submit_bo.handle;
+	}
+
+	spin_lock(&file->table_lock);
+
+	for (i = 0; i < args->nr_bos; i++) {
+		struct drm_gem_object *obj;
 
 		/* normally use drm_gem_object_lookup(), but for bulk lookup
 		 * all under single table_lock just hit object_idr directly:
 		 */
-		obj = idr_find(&file->object_idr, submit_bo.handle);
+		obj = idr_find(&file->object_idr, submit->bos[i].handle);
 		if (!obj) {
-			DRM_ERROR("invalid handle %u at index %u\n", submit_bo.handle, i);
-			ret = -EINVAL;
-			goto out_unlock;
-		}
-
-		msm_obj = to_msm_bo(obj);
-
-		if (!list_empty(&msm_obj->submit_entry)) {
-			DRM_ERROR("handle %u at index %u already on submit list\n",
-					submit_bo.handle, i);
+			DRM_ERROR("invalid handle %u at index %u\n",
+					submit->bos[i].handle, i);
 			ret = -EINVAL;
 			goto out_unlock;
 		}
 
 		drm_gem_object_reference(obj);
 
-		submit->bos[i].obj = msm_obj;
-
-		list_add_tail(&msm_obj->submit_entry, &submit->bo_list);
+		submit->bos[i].obj = to_msm_bo(obj);
 	}
 
 out_unlock:
@@ -155,11 +218,21 @@ retry:
 		if (!(submit->bos[i].flags & BO_LOCKED)) {
 			ret = ww_mutex_lock_interruptible(&msm_obj->resv->lock,
 					&submit->ticket);
+			if (ret == -EALREADY) {
+				DRM_ERROR("bo at index %u listed twice\n", i);
+				ret = -EINVAL;
+			}
 			if (ret)
 				goto fail;
 			submit->bos[i].flags |= BO_LOCKED;
 		}
 
+		/* userspace has to take the bo back with WILLNEED first: */
+		if (msm_obj->madv != MSM_MADV_WILLNEED) {
+			DRM_ERROR("bo at index %u is not WILLNEED\n", i);
+			ret = -EINVAL;
+			goto fail;
+		}
 
 		/* if locking succeeded, pin bo: */
 		ret = msm_gem_get_iova_locked(&msm_obj->base,
@@ -302,6 +375,34 @@ static int submit_reloc(struct msm_gem_submit *submit, struct msm_gem_object *ob
 	return 0;
 }
 
+/* Let userspace presume right next time.  This runs under struct_mutex,
+ * so it must not fault (the table could be in a bo of ours); a missed
+ * update only costs the relocs of the next submit.
+ */
+static void submit_update_presumed(struct msm_gem_submit *submit,
+		struct drm_msm_gem_submit *args)
+{
+	unsigned i;
+
+	pagefault_disable();
+	for (i = 0; i < submit->nr_bos; i++) {
+		uint64_t presumed = submit->bos[i].iova;
+		void __user *userptr;
+
+		if (submit->bos[i].flags & BO_VALID)
+			continue;
+
+		userptr = to_user_ptr(args->bos +
+				(i * sizeof(struct drm_msm_gem_submit_bo)) +
+				offsetof(struct drm_msm_gem_submit_bo, presumed));
+
+		if (__copy_to_user_inatomic(userptr, &presumed,
+				sizeof(presumed)))
+			break;
+	}
+	pagefault_enable();
+}
+
 static void submit_cleanup(struct msm_gem_submit *submit, bool fail)
 {
 	unsigned i;
@@ -309,7 +410,6 @@ static void submit_cleanup(struct msm_gem_submit *submit, bool fail)
 	for (i = 0; i < submit->nr_bos; i++) {
 		struct msm_gem_object *msm_obj = submit->bos[i].obj;
 		submit_unlock_unpin_bo(submit, i);
-		list_del_init(&msm_obj->submit_entry);
 		drm_gem_object_unreference(&msm_obj->base);
 	}
 
@@ -322,6 +422,7 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 	struct msm_drm_private *priv = dev->dev_private;
 	struct drm_msm_gem_submit *args = data;
 	struct msm_file_private *ctx = file->driver_priv;
+	struct drm_msm_gem_submit_cmd submit_cmds[MAX_CMDS];
 	struct msm_gem_submit *submit;
 	struct msm_gpu *gpu;
 	unsigned i;
@@ -330,7 +431,10 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 	/* for now, we just have 3d pipe.. eventually this would need to
 	 * be more clever to dispatch to appropriate gpu module:
 	 */
-	if (args->pipe != MSM_PIPE_3D0)
+	if ((args->pipe & MSM_PIPE_ID_MASK) != MSM_PIPE_3D0)
+		return -EINVAL;
+
+	if (args->pipe & ~(MSM_PIPE_ID_MASK | MSM_SUBMIT_FLAGS))
 		return -EINVAL;
 
 	gpu = priv->gpu;
@@ -338,76 +442,81 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 	if (args->nr_cmds > MAX_CMDS)
 		return -EINVAL;
 
-	mutex_lock(&dev->struct_mutex);
+	/* Everything coming from userspace is fetched and the bo's are
+	 * looked up before taking struct_mutex, so that other clients
+	 * and the retire path don't wait on our page faults:
+	 */
+	for (i = 0; i < args->nr_cmds; i++) {
+		void __user *userptr =
+			to_user_ptr(args->cmds + (i * sizeof(submit_cmds[0])));
+
+		if (copy_from_user(&submit_cmds[i], userptr,
+				sizeof(submit_cmds[i])))
+			return -EFAULT;
+	}
 
 	submit = submit_create(dev, gpu, args->nr_bos);
-	if (!submit) {
-		ret = -ENOMEM;
-		goto out;
-	}
+	if (!submit)
+		return -ENOMEM;
 
 	ret = submit_lookup_objects(submit, args, file);
 	if (ret)
-		goto out;
+		goto out_unlocked;
+
+	ret = submit_lock_ring(dev, gpu);
+	if (ret)
+		goto out_unlocked;
 
 	ret = submit_validate_objects(submit);
 	if (ret)
 		goto out;
 
 	for (i = 0; i < args->nr_cmds; i++) {
-		struct drm_msm_gem_submit_cmd submit_cmd;
-		void __user *userptr =
-			to_user_ptr(args->cmds + (i * sizeof(submit_cmd)));
+		struct drm_msm_gem_submit_cmd *submit_cmd = &submit_cmds[i];
 		struct msm_gem_object *msm_obj;
 		uint32_t iova;
 
-		ret = copy_from_user(&submit_cmd, userptr, sizeof(submit_cmd));
-		if (ret) {
-			ret = -EFAULT;
-			goto out;
-		}
-
 		/* validate input from userspace: */
-		switch (submit_cmd.type) {
+		switch (submit_cmd->type) {
 		case MSM_SUBMIT_CMD_BUF:
 		case MSM_SUBMIT_CMD_IB_TARGET_BUF:
 		case MSM_SUBMIT_CMD_CTX_RESTORE_BUF:
 			break;
 		default:
-			DRM_ERROR("invalid type: %08x\n", submit_cmd.type);
+			DRM_ERROR("invalid type: %08x\n", submit_cmd->type);
 			ret = -EINVAL;
 			goto out;
 		}
 
-		ret = submit_bo(submit, submit_cmd.submit_idx,
+		ret = submit_bo(submit, submit_cmd->submit_idx,
 				&msm_obj, &iova, NULL);
 		if (ret)
 			goto out;
 
-		if (submit_cmd.size % 4) {
+		if (submit_cmd->size % 4) {
 			DRM_ERROR("non-aligned cmdstream buffer size: %u\n",
-					submit_cmd.size);
+					submit_cmd->size);
 			ret = -EINVAL;
 			goto out;
 		}
 
-		if ((submit_cmd.size + submit_cmd.submit_offset) >=
+		if ((submit_cmd->size + submit_cmd->submit_offset) >=
 				msm_obj->base.size) {
-			DRM_ERROR("invalid cmdstream size: %u\n", submit_cmd.size);
+			DRM_ERROR("invalid cmdstream size: %u\n", submit_cmd->size);
 			ret = -EINVAL;
 			goto out;
 		}
 
-		submit->cmd[i].type = submit_cmd.type;
-		submit->cmd[i].size = submit_cmd.size / 4;
-		submit->cmd[i].iova = iova + submit_cmd.submit_offset;
-		submit->cmd[i].idx  = submit_cmd.submit_idx;
+		submit->cmd[i].type = submit_cmd->type;
+		submit->cmd[i].size = submit_cmd->size / 4;
+		submit->cmd[i].iova = iova + submit_cmd->submit_offset;
+		submit->cmd[i].idx  = submit_cmd->submit_idx;
 
 		if (submit->valid)
 			continue;
 
-		ret = submit_reloc(submit, msm_obj, submit_cmd.submit_offset,
-				submit_cmd.nr_relocs, submit_cmd.relocs);
+		ret = submit_reloc(submit, msm_obj, submit_cmd->submit_offset,
+				submit_cmd->nr_relocs, submit_cmd->relocs);
 		if (ret)
 			goto out;
 	}
@@ -418,9 +527,35 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 
 	args->fence = submit->fence;
 
+	gpu->nr_submits++;
+	if (submit->valid)
+		gpu->nr_reloc_free++;
+
+	if (!ret && !submit->valid && (args->pipe & MSM_SUBMIT_PRESUMED))
+		submit_update_presumed(submit, args);
+
 out:
-	if (submit)
-		submit_cleanup(submit, !!ret);
+	submit_cleanup(submit, !!ret);
 	mutex_unlock(&dev->struct_mutex);
+
+	/* the submit now belongs to the gpu, until it is retired */
+	if (!ret && (args->pipe & MSM_SUBMIT_FENCE_FD_OUT)) {
+		ret = msm_sync_fence_fd(dev, args->fence);
+		if (ret >= 0) {
+			args->fence_fd = ret;
+			ret = 0;
+		}
+	}
+
+	return ret;
+
+out_unlocked:
+	/* not on the gpu's submit list yet, so ours to free.  Nothing is
+	 * locked or pinned yet, only the lookup references are to drop:
+	 */
+	for (i = 0; i < submit->nr_bos; i++)
+		drm_gem_object_unreference_unlocked(&submit->bos[i].obj->base);
+	ww_acquire_fini(&submit->ticket);
+	kfree(submit);
 	return ret;
 }
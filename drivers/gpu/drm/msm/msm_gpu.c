@@ -19,6 +19,8 @@
 #include "msm_gem.h"
 #include "msm_mmu.h"
 
+#include <linux/pm_opp.h>
+
 
 /*
  * Power Management:
@@ -88,18 +90,28 @@ static int disable_pwrrail(struct msm_gpu *gpu)
 	return 0;
 }
 
+/* the clock that enable_clk()/disable_clk() set the rate of: */
+static struct clk *get_rate_clk(struct msm_gpu *gpu)
+{
+	int i;
+
+	/* NOTE: kgsl_pwrctrl_clk() ignores grp_clks[0].. */
+	for (i = 1; i < ARRAY_SIZE(gpu->grp_clks); i++)
+		if (gpu->grp_clks[i])
+			return gpu->grp_clks[i];
+
+	return NULL;
+}
+
 static int enable_clk(struct msm_gpu *gpu)
 {
-	struct clk *rate_clk = NULL;
+	struct clk *rate_clk = get_rate_clk(gpu);
 	int i;
 
 	/* NOTE: kgsl_pwrctrl_clk() ignores grp_clks[0].. */
-	for (i = ARRAY_SIZE(gpu->grp_clks) - 1; i > 0; i--) {
-		if (gpu->grp_clks[i]) {
+	for (i = ARRAY_SIZE(gpu->grp_clks) - 1; i > 0; i--)
+		if (gpu->grp_clks[i])
 			clk_prepare(gpu->grp_clks[i]);
-			rate_clk = gpu->grp_clks[i];
-		}
-	}
 
 	if (rate_clk && gpu->fast_rate)
 		clk_set_rate(rate_clk, gpu->fast_rate);
@@ -113,16 +125,13 @@ static int enable_clk(struct msm_gpu *gpu)
 
 static int disable_clk(struct msm_gpu *gpu)
 {
-	struct clk *rate_clk = NULL;
+	struct clk *rate_clk = get_rate_clk(gpu);
 	int i;
 
 	/* NOTE: kgsl_pwrctrl_clk() ignores grp_clks[0].. */
-	for (i = ARRAY_SIZE(gpu->grp_clks) - 1; i > 0; i--) {
-		if (gpu->grp_clks[i]) {
+	for (i = ARRAY_SIZE(gpu->grp_clks) - 1; i > 0; i--)
+		if (gpu->grp_clks[i])
 			clk_disable(gpu->grp_clks[i]);
-			rate_clk = gpu->grp_clks[i];
-		}
-	}
 
 	if (rate_clk && gpu->slow_rate)
 		clk_set_rate(rate_clk, gpu->slow_rate);
@@ -357,27 +366,37 @@ static int update_hw_cntrs(struct msm_gpu *gpu, uint32_t ncntrs, uint32_t *cntrs
 	return n;
 }
 
-static void update_sw_cntrs(struct msm_gpu *gpu)
+/* called under perf_lock */
+static void __update_sw_cntrs(struct msm_gpu *gpu)
 {
 	ktime_t time;
 	uint32_t elapsed;
-	unsigned long flags;
-
-	spin_lock_irqsave(&gpu->perf_lock, flags);
-	if (!gpu->perfcntr_active)
-		goto out;
 
 	time = ktime_get();
 	elapsed = ktime_to_us(ktime_sub(time, gpu->last_sample.time));
 
-	gpu->totaltime += elapsed;
+	if (gpu->perfcntr_active) {
+		gpu->totaltime += elapsed;
+		if (gpu->last_sample.active)
+			gpu->activetime += elapsed;
+	}
+
+#ifdef CONFIG_PM_DEVFREQ
+	gpu->devfreq.totaltime += elapsed;
 	if (gpu->last_sample.active)
-		gpu->activetime += elapsed;
+		gpu->devfreq.busytime += elapsed;
+#endif
 
 	gpu->last_sample.active = msm_gpu_active(gpu);
 	gpu->last_sample.time = time;
+}
 
-out:
+static void update_sw_cntrs(struct msm_gpu *gpu)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&gpu->perf_lock, flags);
+	__update_sw_cntrs(gpu);
 	spin_unlock_irqrestore(&gpu->perf_lock, flags);
 }
 
@@ -387,8 +406,7 @@ void msm_gpu_perfcntr_start(struct msm_gpu *gpu)
 
 	spin_lock_irqsave(&gpu->perf_lock, flags);
 	/* we could dynamically enable/disable perfcntr registers too.. */
-	gpu->last_sample.active = msm_gpu_active(gpu);
-	gpu->last_sample.time = ktime_get();
+	__update_sw_cntrs(gpu);
 	gpu->activetime = gpu->totaltime = 0;
 	gpu->perfcntr_active = true;
 	update_hw_cntrs(gpu, 0, NULL);
@@ -427,6 +445,198 @@ out:
 	return ret;
 }
 
+/*
+ * Devfreq:
+ *
+ * The load fed to the governor is the busy time of the sw counters, ie.
+ * the time there were submits in flight, so it is there whether or not
+ * anyone has the perf counters open.
+ *
+ * The rates are registered as OPPs of the gpu device as well, so that a
+ * devfreq cooling device can cap them, and with a "dynamic-power-coefficient"
+ * in the gpu node the gpu takes part in the thermal power budget of the
+ * power allocator governor along with the cpus.
+ */
+
+#ifdef CONFIG_PM_DEVFREQ
+static int msm_devfreq_target(struct device *dev, unsigned long *freq,
+		u32 flags)
+{
+	struct msm_gpu *gpu = platform_get_drvdata(to_platform_device(dev));
+	struct clk *rate_clk = get_rate_clk(gpu);
+	struct dev_pm_opp *opp;
+	uint32_t rate;
+	int i;
+
+	/* skip the rates disabled by the cooling device: */
+	rcu_read_lock();
+	opp = devfreq_recommended_opp(dev, freq, flags);
+	if (!IS_ERR(opp))
+		*freq = dev_pm_opp_get_freq(opp);
+	rcu_read_unlock();
+
+	/* lowest rate >= *freq, or the highest rate <= *freq: */
+	for (i = 0; i < gpu->nr_freqs - 1; i++)
+		if (gpu->freqs[i] >= *freq)
+			break;
+	if ((flags & DEVFREQ_FLAG_LEAST_UPPER_BOUND) && i > 0 &&
+			gpu->freqs[i] > *freq)
+		i--;
+
+	rate = gpu->freqs[i];
+	*freq = rate;
+
+	/* enable_clk() and disable_clk() set the rate too, under
+	 * struct_mutex.  The new rate takes effect now if the gpu is
+	 * awake, otherwise on the next wakeup:
+	 */
+	mutex_lock(&gpu->dev->struct_mutex);
+	if (rate != gpu->fast_rate) {
+		DBG("%s: %u -> %u", gpu->name, gpu->fast_rate, rate);
+		gpu->fast_rate = rate;
+		if (rate_clk && gpu->active_cnt > 0 && !gpu->inactive)
+			clk_set_rate(rate_clk, rate);
+	}
+	mutex_unlock(&gpu->dev->struct_mutex);
+
+	return 0;
+}
+
+static int msm_devfreq_get_dev_status(struct device *dev,
+		struct devfreq_dev_status *status)
+{
+	struct msm_gpu *gpu = platform_get_drvdata(to_platform_device(dev));
+	unsigned long flags;
+
+	spin_lock_irqsave(&gpu->perf_lock, flags);
+	__update_sw_cntrs(gpu);
+	status->busy_time = gpu->devfreq.busytime;
+	status->total_time = gpu->devfreq.totaltime;
+	gpu->devfreq.busytime = gpu->devfreq.totaltime = 0;
+	spin_unlock_irqrestore(&gpu->perf_lock, flags);
+
+	status->current_frequency = READ_ONCE(gpu->fast_rate);
+
+	return 0;
+}
+
+static int msm_devfreq_get_cur_freq(struct device *dev, unsigned long *freq)
+{
+	struct msm_gpu *gpu = platform_get_drvdata(to_platform_device(dev));
+
+	*freq = READ_ONCE(gpu->fast_rate);
+
+	return 0;
+}
+
+/*
+ * The gpu rail is not scaled along with the rate, so all OPPs get the
+ * current voltage and the power model only scales with the rate:
+ */
+static void devfreq_init_opps(struct msm_gpu *gpu)
+{
+	struct device *dev = &gpu->pdev->dev;
+	unsigned long volt = 0;
+	unsigned int i;
+
+	if (gpu->gpu_reg) {
+		int uv = regulator_get_voltage(gpu->gpu_reg);
+
+		if (uv > 0)
+			volt = uv;
+	}
+	if (!volt)
+		volt = 1000000;
+
+	for (i = 0; i < gpu->nr_freqs; i++)
+		if (dev_pm_opp_add(dev, gpu->freqs[i], volt))
+			dev_warn(dev, "failed to add OPP %u\n", gpu->freqs[i]);
+}
+
+static void devfreq_fini_opps(struct msm_gpu *gpu)
+{
+	unsigned int i;
+
+	for (i = 0; i < gpu->nr_freqs; i++)
+		dev_pm_opp_remove(&gpu->pdev->dev, gpu->freqs[i]);
+}
+
+static void devfreq_init_cooling(struct msm_gpu *gpu)
+{
+	struct device_node *np = gpu->pdev->dev.of_node;
+	struct devfreq_cooling_power *power = &gpu->devfreq.power;
+	struct thermal_cooling_device *cooling;
+	u32 coeff = 0;
+
+	/* thermal DT code matches the cooling device to the zones: */
+	if (!np || !of_find_property(np, "#cooling-cells", NULL))
+		return;
+
+	if (!of_property_read_u32(np, "dynamic-power-coefficient", &coeff))
+		power->dyn_power_coeff = coeff;
+
+	cooling = of_devfreq_cooling_register_power(np,
+			gpu->devfreq.devfreq, coeff ? power : NULL);
+	if (IS_ERR(cooling)) {
+		dev_warn(gpu->dev->dev, "%s: no cooling device: %ld\n",
+				gpu->name, PTR_ERR(cooling));
+		return;
+	}
+
+	gpu->devfreq.cooling = cooling;
+}
+
+static void devfreq_init(struct msm_gpu *gpu)
+{
+	struct devfreq_dev_profile *profile = &gpu->devfreq.profile;
+	struct devfreq *devfreq;
+
+	/* nothing to scale between: */
+	if (gpu->nr_freqs < 2 || !get_rate_clk(gpu))
+		return;
+
+	profile->initial_freq = gpu->fast_rate;
+	profile->polling_ms = DRM_MSM_DEVFREQ_PERIOD;
+	profile->target = msm_devfreq_target;
+	profile->get_dev_status = msm_devfreq_get_dev_status;
+	profile->get_cur_freq = msm_devfreq_get_cur_freq;
+	/* which gives per-rate residency in devfreq's trans_stat: */
+	profile->freq_table = gpu->freqs;
+	profile->max_state = gpu->nr_freqs;
+
+	devfreq_init_opps(gpu);
+
+	devfreq = devfreq_add_device(&gpu->pdev->dev, profile,
+			"simple_ondemand", NULL);
+	if (IS_ERR(devfreq)) {
+		dev_warn(gpu->dev->dev, "%s: no devfreq: %ld\n",
+				gpu->name, PTR_ERR(devfreq));
+		devfreq_fini_opps(gpu);
+		return;
+	}
+
+	gpu->devfreq.devfreq = devfreq;
+
+	devfreq_init_cooling(gpu);
+}
+
+static void devfreq_fini(struct msm_gpu *gpu)
+{
+	if (gpu->devfreq.cooling) {
+		devfreq_cooling_unregister(gpu->devfreq.cooling);
+		gpu->devfreq.cooling = NULL;
+	}
+	if (gpu->devfreq.devfreq) {
+		devfreq_remove_device(gpu->devfreq.devfreq);
+		gpu->devfreq.devfreq = NULL;
+		devfreq_fini_opps(gpu);
+	}
+}
+#else
+static void devfreq_init(struct msm_gpu *gpu) {}
+static void devfreq_fini(struct msm_gpu *gpu) {}
+#endif
+
 /*
  * Cmdstream submission/retirement:
  */
@@ -577,9 +787,11 @@ int msm_gpu_init(struct drm_device *drm, struct platform_device *pdev,
 		gpu->num_perfcntrs = ARRAY_SIZE(gpu->last_cntrs);
 
 	gpu->dev = drm;
+	gpu->pdev = pdev;
 	gpu->funcs = funcs;
 	gpu->name = name;
 	gpu->inactive = true;
+	gpu->last_sample.time = ktime_get();
 
 	INIT_LIST_HEAD(&gpu->active_list);
 	INIT_WORK(&gpu->retire_work, retire_worker);
@@ -686,6 +898,9 @@ int msm_gpu_init(struct drm_device *drm, struct platform_device *pdev,
 
 	bs_init(gpu);
 
+	platform_set_drvdata(pdev, gpu);
+	devfreq_init(gpu);
+
 	return 0;
 
 fail:
@@ -698,6 +913,7 @@ void msm_gpu_cleanup(struct msm_gpu *gpu)
 
 	WARN_ON(!list_empty(&gpu->active_list));
 
+	devfreq_fini(gpu);
 	bs_fini(gpu);
 
 	if (gpu->rb) {
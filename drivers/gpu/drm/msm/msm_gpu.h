@@ -19,6 +19,8 @@
 #define __MSM_GPU_H__
 
 #include <linux/clk.h>
+#include <linux/devfreq.h>
+#include <linux/devfreq_cooling.h>
 #include <linux/regulator/consumer.h>
 
 #include "msm_drv.h"
@@ -85,6 +87,9 @@ struct msm_gpu {
 
 	uint32_t submitted_fence;
 
+	/* submits, and the ones that needed no reloc, under struct_mutex: */
+	uint32_t nr_submits, nr_reloc_free;
+
 	/* is gpu powered/active? */
 	int active_cnt;
 	bool inactive;
@@ -92,6 +97,7 @@ struct msm_gpu {
 	/* worker for handling active-list retiring: */
 	struct work_struct retire_work;
 
+	struct platform_device *pdev;
 	void __iomem *mmio;
 	int irq;
 
@@ -103,6 +109,22 @@ struct msm_gpu {
 	struct clk *ebi1_clk, *grp_clks[6];
 	uint32_t fast_rate, slow_rate, bus_freq;
 
+	/* core clk rates the gpu can run at, lowest first: */
+#define MSM_GPU_MAX_FREQS 8
+	uint32_t freqs[MSM_GPU_MAX_FREQS];
+	unsigned int nr_freqs;
+
+#ifdef CONFIG_PM_DEVFREQ
+#define DRM_MSM_DEVFREQ_PERIOD    50 /* in ms (roughly three frames) */
+	struct {
+		struct devfreq *devfreq;
+		struct devfreq_dev_profile profile;
+		uint32_t busytime, totaltime;      /* in us, since last poll */
+		struct devfreq_cooling_power power;
+		struct thermal_cooling_device *cooling;
+	} devfreq;
+#endif
+
 #ifdef DOWNSTREAM_CONFIG_MSM_BUS_SCALING
 	struct msm_bus_scale_pdata *bus_scale_table;
 	uint32_t bsc;
@@ -46,6 +46,9 @@ struct msm_kms_funcs {
 	/* functions to wait for atomic commit completed on each CRTC */
 	void (*wait_for_crtc_commit_done)(struct msm_kms *kms,
 					struct drm_crtc *crtc);
+	/* damaged region of a CRTC, for partial updates (optional): */
+	void (*add_damage)(struct msm_kms *kms, struct drm_crtc_state *state,
+			const struct drm_rect *damage);
 	/* misc: */
 	const struct msm_format *(*get_format)(struct msm_kms *kms, uint32_t format);
 	long (*round_pixclk)(struct msm_kms *kms, unsigned long rate,
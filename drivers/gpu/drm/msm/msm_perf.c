@@ -42,6 +42,9 @@ struct msm_perf_state {
 
 	unsigned long next_jiffies;
 
+	/* submit counts at the last sample: */
+	uint32_t last_submits, last_reloc_free;
+
 	struct dentry *ent;
 	struct drm_info_node *node;
 };
@@ -86,10 +89,15 @@ static int refill_buf(struct msm_perf_state *perf)
 			ptr += n;
 			rem -= n;
 		}
+
+		n = snprintf(ptr, rem, "\tSUBMITS\t%%NORELOC");
+		ptr += n;
+		rem -= n;
 	} else {
 		/* Sample line: */
 		uint32_t activetime = 0, totaltime = 0;
 		uint32_t cntrs[5];
+		uint32_t submits, reloc_free;
 		uint32_t val;
 		int ret;
 
@@ -116,6 +124,23 @@ static int refill_buf(struct msm_perf_state *perf)
 			ptr += n;
 			rem -= n;
 		}
+
+		/* racy vs submit, but good enough for a sample: */
+		submits = READ_ONCE(gpu->nr_submits);
+		reloc_free = READ_ONCE(gpu->nr_reloc_free);
+		val = submits - perf->last_submits;
+		reloc_free -= perf->last_reloc_free;
+		perf->last_submits += val;
+		perf->last_reloc_free += reloc_free;
+
+		n = snprintf(ptr, rem, "\t%7u", val);
+		ptr += n;
+		rem -= n;
+
+		val = val ? 1000 * reloc_free / val : 0;
+		n = snprintf(ptr, rem, "\t%3d.%d%%", val / 10, val % 10);
+		ptr += n;
+		rem -= n;
 	}
 
 	n = snprintf(ptr, rem, "\n");
@@ -177,6 +202,8 @@ static int perf_open(struct inode *inode, struct file *file)
 	perf->cnt = 0;
 	perf->buftot = 0;
 	perf->bufpos = 0;
+	perf->last_submits = gpu->nr_submits;
+	perf->last_reloc_free = gpu->nr_reloc_free;
 	msm_gpu_perfcntr_start(gpu);
 	perf->next_jiffies = jiffies + SAMPLE_TIME;
 
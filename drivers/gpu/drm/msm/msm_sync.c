@@ -0,0 +1,165 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <linux/file.h>
+
+#include "sync.h"
+
+#include "msm_drv.h"
+
+/*
+ * Sync fences for submits:
+ *
+ * The gpu fences are a single timeline, a sync_pt only needs to remember
+ * the fence it waits for and compare it against the completed fence.
+ */
+
+struct msm_timeline {
+	struct sync_timeline obj;
+	struct drm_device *dev;
+};
+
+struct msm_sync_pt {
+	struct sync_pt pt;
+	uint32_t fence;
+};
+
+#define to_msm_timeline(x) container_of(x, struct msm_timeline, obj)
+#define to_msm_sync_pt(x) container_of(x, struct msm_sync_pt, pt)
+
+static struct sync_pt *msm_sync_pt_create(struct msm_timeline *timeline,
+		uint32_t fence)
+{
+	struct sync_pt *pt;
+
+	pt = sync_pt_create(&timeline->obj, sizeof(struct msm_sync_pt));
+	if (pt)
+		to_msm_sync_pt(pt)->fence = fence;
+
+	return pt;
+}
+
+static struct sync_pt *msm_sync_pt_dup(struct sync_pt *pt)
+{
+	struct msm_timeline *timeline = to_msm_timeline(sync_pt_parent(pt));
+
+	return msm_sync_pt_create(timeline, to_msm_sync_pt(pt)->fence);
+}
+
+static int msm_sync_pt_has_signaled(struct sync_pt *pt)
+{
+	struct msm_timeline *timeline = to_msm_timeline(sync_pt_parent(pt));
+
+	return fence_completed(timeline->dev, to_msm_sync_pt(pt)->fence);
+}
+
+static int msm_sync_pt_compare(struct sync_pt *a, struct sync_pt *b)
+{
+	uint32_t fa = to_msm_sync_pt(a)->fence;
+	uint32_t fb = to_msm_sync_pt(b)->fence;
+
+	if (fa == fb)
+		return 0;
+
+	return (fa < fb) ? -1 : 1;
+}
+
+static void msm_sync_timeline_value_str(struct sync_timeline *obj,
+		char *str, int size)
+{
+	struct msm_drm_private *priv = to_msm_timeline(obj)->dev->dev_private;
+
+	snprintf(str, size, "%u", priv->completed_fence);
+}
+
+static void msm_sync_pt_value_str(struct sync_pt *pt, char *str, int size)
+{
+	snprintf(str, size, "%u", to_msm_sync_pt(pt)->fence);
+}
+
+static const struct sync_timeline_ops msm_sync_timeline_ops = {
+	.driver_name = "msm",
+	.dup = msm_sync_pt_dup,
+	.has_signaled = msm_sync_pt_has_signaled,
+	.compare = msm_sync_pt_compare,
+	.timeline_value_str = msm_sync_timeline_value_str,
+	.pt_value_str = msm_sync_pt_value_str,
+};
+
+int msm_sync_init(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct sync_timeline *obj;
+
+	obj = sync_timeline_create(&msm_sync_timeline_ops,
+			sizeof(struct msm_timeline), "msm-gpu");
+	if (!obj)
+		return -ENOMEM;
+
+	to_msm_timeline(obj)->dev = dev;
+	priv->timeline = to_msm_timeline(obj);
+
+	return 0;
+}
+
+void msm_sync_fini(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+
+	if (priv->timeline)
+		sync_timeline_destroy(&priv->timeline->obj);
+	priv->timeline = NULL;
+}
+
+/* called when the completed fence advances, from the retire path: */
+void msm_sync_signal(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+
+	if (priv->timeline)
+		sync_timeline_signal(&priv->timeline->obj);
+}
+
+/* returns a new fd for a sync fence signaled once @fence completes: */
+int msm_sync_fence_fd(struct drm_device *dev, uint32_t fence)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct sync_fence *sync_fence;
+	struct sync_pt *pt;
+	int fd;
+
+	if (!priv->timeline)
+		return -ENODEV;
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0)
+		return fd;
+
+	pt = msm_sync_pt_create(priv->timeline, fence);
+	if (!pt) {
+		put_unused_fd(fd);
+		return -ENOMEM;
+	}
+
+	sync_fence = sync_fence_create("msm-gpu", pt);
+	if (!sync_fence) {
+		sync_pt_free(pt);
+		put_unused_fd(fd);
+		return -ENOMEM;
+	}
+
+	sync_fence_install(sync_fence, fd);
+
+	return fd;
+}
@@ -12,9 +12,12 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/debugfs.h>
+#include <linux/delay.h>
 #include <linux/hwspinlock.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/mfd/syscon.h>
 #include <linux/module.h>
 #include <linux/of.h>
@@ -22,32 +25,105 @@
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
 #include <linux/regmap.h>
+#include <linux/seq_file.h>
 
 #include "hwspinlock_internal.h"
 
 #define QCOM_MUTEX_APPS_PROC_ID	1
 #define QCOM_MUTEX_NUM_LOCKS	32
 
+/*
+ * Delay between two attempts on a contended lock, doubled on every attempt
+ * up to the maximum, to leave the interconnect to the remote owner.
+ */
+#define QCOM_MUTEX_BACKOFF_MIN_NS	50
+#define QCOM_MUTEX_BACKOFF_MAX_NS	1600
+
+/* Failed attempts further apart than this belong to different waits */
+#define QCOM_MUTEX_WAIT_GAP_NS		(10 * QCOM_MUTEX_BACKOFF_MAX_NS)
+
+/* Wait and hold time buckets: < 1us, then [2^(i-1), 2^i) us */
+#define QCOM_MUTEX_HIST_BUCKETS		16
+
+/**
+ * struct qcom_hwspinlock - state of one hardware mutex
+ * @field:	the mutex register
+ * @backoff_ns:	current delay between attempts
+ * @wait_start:	time of the first failed attempt of the current wait
+ * @wait_last:	time of the last failed attempt
+ * @hold_start:	time the lock was taken
+ * @wait:	histogram of the time waited for the lock
+ * @hold:	histogram of the time the lock was held
+ *
+ * Except for @backoff_ns, these are only updated with the local spinlock of
+ * the hwspinlock held.
+ */
+struct qcom_hwspinlock {
+	struct regmap_field *field;
+	unsigned int backoff_ns;
+	u64 wait_start;
+	u64 wait_last;
+	u64 hold_start;
+	unsigned long wait[QCOM_MUTEX_HIST_BUCKETS];
+	unsigned long hold[QCOM_MUTEX_HIST_BUCKETS];
+};
+
+struct qcom_mutex {
+	struct hwspinlock_device *bank;
+	struct dentry *debugfs;
+	struct qcom_hwspinlock locks[QCOM_MUTEX_NUM_LOCKS];
+};
+
+static struct dentry *qcom_hwspinlock_debugfs;
+
+static void qcom_hwspinlock_account(unsigned long *hist, u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	int bucket = us ? fls64(us) : 0;
+
+	hist[min(bucket, QCOM_MUTEX_HIST_BUCKETS - 1)]++;
+}
+
 static int qcom_hwspinlock_trylock(struct hwspinlock *lock)
 {
-	struct regmap_field *field = lock->priv;
+	struct qcom_hwspinlock *ql = lock->priv;
 	u32 lock_owner;
+	u64 now;
 	int ret;
 
-	ret = regmap_field_write(field, QCOM_MUTEX_APPS_PROC_ID);
+	ret = regmap_field_write(ql->field, QCOM_MUTEX_APPS_PROC_ID);
 	if (ret)
 		return ret;
 
-	ret = regmap_field_read(field, &lock_owner);
+	ret = regmap_field_read(ql->field, &lock_owner);
 	if (ret)
 		return ret;
 
-	return lock_owner == QCOM_MUTEX_APPS_PROC_ID;
+	now = ktime_get_ns();
+	if (lock_owner != QCOM_MUTEX_APPS_PROC_ID) {
+		if (!ql->wait_start ||
+		    now - ql->wait_last > QCOM_MUTEX_WAIT_GAP_NS)
+			ql->wait_start = now;
+		ql->wait_last = now;
+		return 0;
+	}
+
+	if (ql->wait_start && now - ql->wait_last <= QCOM_MUTEX_WAIT_GAP_NS)
+		qcom_hwspinlock_account(ql->wait, now - ql->wait_start);
+	else
+		qcom_hwspinlock_account(ql->wait, 0);
+
+	ql->wait_start = 0;
+	ql->hold_start = now;
+	WRITE_ONCE(ql->backoff_ns, 0);
+
+	return 1;
 }
 
 static void qcom_hwspinlock_unlock(struct hwspinlock *lock)
 {
-	struct regmap_field *field = lock->priv;
+	struct qcom_hwspinlock *ql = lock->priv;
+	struct regmap_field *field = ql->field;
 	u32 lock_owner;
 	int ret;
 
@@ -65,11 +141,66 @@ static void qcom_hwspinlock_unlock(struct hwspinlock *lock)
 	ret = regmap_field_write(field, 0);
 	if (ret)
 		pr_err("%s: failed to unlock spinlock\n", __func__);
+
+	qcom_hwspinlock_account(ql->hold, ktime_get_ns() - ql->hold_start);
+}
+
+static void qcom_hwspinlock_relax(struct hwspinlock *lock)
+{
+	struct qcom_hwspinlock *ql = lock->priv;
+	unsigned int backoff = READ_ONCE(ql->backoff_ns);
+
+	backoff = clamp_t(unsigned int, backoff * 2,
+			  QCOM_MUTEX_BACKOFF_MIN_NS, QCOM_MUTEX_BACKOFF_MAX_NS);
+	WRITE_ONCE(ql->backoff_ns, backoff);
+
+	ndelay(backoff);
 }
 
 static const struct hwspinlock_ops qcom_hwspinlock_ops = {
 	.trylock	= qcom_hwspinlock_trylock,
 	.unlock		= qcom_hwspinlock_unlock,
+	.relax		= qcom_hwspinlock_relax,
+};
+
+static int qcom_hwspinlock_stats_show(struct seq_file *s, void *unused)
+{
+	struct qcom_mutex *mutex = s->private;
+	struct qcom_hwspinlock *ql;
+	unsigned long total;
+	int i, j;
+
+	for (i = 0; i < QCOM_MUTEX_NUM_LOCKS; i++) {
+		ql = &mutex->locks[i];
+
+		for (total = 0, j = 0; j < QCOM_MUTEX_HIST_BUCKETS; j++)
+			total += ql->wait[j];
+		if (!total)
+			continue;
+
+		seq_printf(s, "lock %d:\n",
+			   hwlock_to_id(&mutex->bank->lock[i]));
+		seq_puts(s, "  time (us)        wait       hold\n");
+		for (j = 0; j < QCOM_MUTEX_HIST_BUCKETS - 1; j++)
+			seq_printf(s, "  < %7lu: %10lu %10lu\n", 1UL << j,
+				   ql->wait[j], ql->hold[j]);
+		seq_printf(s, "  >= %6lu: %10lu %10lu\n", 1UL << (j - 1),
+			   ql->wait[j], ql->hold[j]);
+	}
+
+	return 0;
+}
+
+static int qcom_hwspinlock_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, qcom_hwspinlock_stats_show, inode->i_private);
+}
+
+static const struct file_operations qcom_hwspinlock_stats_fops = {
+	.open		= qcom_hwspinlock_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
 };
 
 static const struct of_device_id qcom_hwspinlock_of_match[] = {
@@ -83,6 +214,7 @@ static int qcom_hwspinlock_probe(struct platform_device *pdev)
 {
 	struct hwspinlock_device *bank;
 	struct device_node *syscon;
+	struct qcom_mutex *mutex;
 	struct reg_field field;
 	struct regmap *regmap;
 	size_t array_size;
@@ -115,41 +247,52 @@ static int qcom_hwspinlock_probe(struct platform_device *pdev)
 
 	array_size = QCOM_MUTEX_NUM_LOCKS * sizeof(struct hwspinlock);
 	bank = devm_kzalloc(&pdev->dev, sizeof(*bank) + array_size, GFP_KERNEL);
-	if (!bank)
+	mutex = devm_kzalloc(&pdev->dev, sizeof(*mutex), GFP_KERNEL);
+	if (!bank || !mutex)
 		return -ENOMEM;
 
-	platform_set_drvdata(pdev, bank);
+	mutex->bank = bank;
+	platform_set_drvdata(pdev, mutex);
 
 	for (i = 0; i < QCOM_MUTEX_NUM_LOCKS; i++) {
 		field.reg = base + i * stride;
 		field.lsb = 0;
 		field.msb = 31;
 
-		bank->lock[i].priv = devm_regmap_field_alloc(&pdev->dev,
-							     regmap, field);
+		mutex->locks[i].field = devm_regmap_field_alloc(&pdev->dev,
+								regmap, field);
+		bank->lock[i].priv = &mutex->locks[i];
 	}
 
 	pm_runtime_enable(&pdev->dev);
 
 	ret = hwspin_lock_register(bank, &pdev->dev, &qcom_hwspinlock_ops,
 				   0, QCOM_MUTEX_NUM_LOCKS);
-	if (ret)
+	if (ret) {
 		pm_runtime_disable(&pdev->dev);
+		return ret;
+	}
+
+	if (qcom_hwspinlock_debugfs)
+		mutex->debugfs = debugfs_create_file(dev_name(&pdev->dev),
+				0444, qcom_hwspinlock_debugfs, mutex,
+				&qcom_hwspinlock_stats_fops);
 
-	return ret;
+	return 0;
 }
 
 static int qcom_hwspinlock_remove(struct platform_device *pdev)
 {
-	struct hwspinlock_device *bank = platform_get_drvdata(pdev);
+	struct qcom_mutex *mutex = platform_get_drvdata(pdev);
 	int ret;
 
-	ret = hwspin_lock_unregister(bank);
+	ret = hwspin_lock_unregister(mutex->bank);
 	if (ret) {
 		dev_err(&pdev->dev, "%s failed: %d\n", __func__, ret);
 		return ret;
 	}
 
+	debugfs_remove(mutex->debugfs);
 	pm_runtime_disable(&pdev->dev);
 
 	return 0;
@@ -166,6 +309,10 @@ static struct platform_driver qcom_hwspinlock_driver = {
 
 static int __init qcom_hwspinlock_init(void)
 {
+	qcom_hwspinlock_debugfs = debugfs_create_dir("qcom_hwspinlock", NULL);
+	if (IS_ERR(qcom_hwspinlock_debugfs))
+		qcom_hwspinlock_debugfs = NULL;
+
 	return platform_driver_register(&qcom_hwspinlock_driver);
 }
 /* board init code might need to reserve hwspinlocks for predefined purposes */
@@ -174,6 +321,7 @@ postcore_initcall(qcom_hwspinlock_init);
 static void __exit qcom_hwspinlock_exit(void)
 {
 	platform_driver_unregister(&qcom_hwspinlock_driver);
+	debugfs_remove_recursive(qcom_hwspinlock_debugfs);
 }
 module_exit(qcom_hwspinlock_exit);
 
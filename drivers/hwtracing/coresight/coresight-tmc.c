@@ -213,8 +213,10 @@ static void tmc_etr_enable_hw(struct tmc_drvdata *drvdata)
 		  TMC_AXICTL_PROT_CTL_B1;
 	writel_relaxed(axictl, drvdata->base + TMC_AXICTL);
 
-	writel_relaxed(drvdata->paddr, drvdata->base + TMC_DBALO);
-	writel_relaxed(0x0, drvdata->base + TMC_DBAHI);
+	writel_relaxed(lower_32_bits(drvdata->paddr),
+		       drvdata->base + TMC_DBALO);
+	writel_relaxed(upper_32_bits(drvdata->paddr),
+		       drvdata->base + TMC_DBAHI);
 	writel_relaxed(TMC_FFCR_EN_FMT | TMC_FFCR_EN_TI |
 		       TMC_FFCR_FON_FLIN | TMC_FFCR_FON_TRIG_EVT |
 		       TMC_FFCR_TRIGON_TRIGIN,
@@ -641,9 +643,69 @@ static struct attribute *coresight_etb_attrs[] = {
 };
 ATTRIBUTE_GROUPS(coresight_etb);
 
+static ssize_t buffer_size_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct tmc_drvdata *drvdata = dev_get_drvdata(dev->parent);
+
+	return sprintf(buf, "%#x\n", drvdata->size);
+}
+
+/*
+ * Resize the ETR system memory buffer.  Only allowed while the sink is
+ * neither collecting nor being read, so that a long continuous capture
+ * can use more than the size given in DT.
+ */
+static ssize_t buffer_size_store(struct device *dev,
+				 struct device_attribute *attr,
+				 const char *buf, size_t size)
+{
+	struct tmc_drvdata *drvdata = dev_get_drvdata(dev->parent);
+	void __iomem *vaddr, *old_vaddr;
+	dma_addr_t paddr, old_paddr;
+	unsigned long val, flags;
+	u32 old_size;
+	int ret;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	val = PAGE_ALIGN(val);
+	if (!val || val > U32_MAX)
+		return -EINVAL;
+
+	vaddr = dma_alloc_coherent(drvdata->dev, val, &paddr, GFP_KERNEL);
+	if (!vaddr)
+		return -ENOMEM;
+
+	spin_lock_irqsave(&drvdata->spinlock, flags);
+	if (drvdata->enable || drvdata->reading) {
+		spin_unlock_irqrestore(&drvdata->spinlock, flags);
+		dma_free_coherent(drvdata->dev, val, vaddr, paddr);
+		return -EBUSY;
+	}
+
+	old_vaddr = drvdata->vaddr;
+	old_paddr = drvdata->paddr;
+	old_size = drvdata->size;
+
+	drvdata->vaddr = vaddr;
+	drvdata->paddr = paddr;
+	drvdata->size = val;
+	drvdata->buf = drvdata->vaddr;
+	spin_unlock_irqrestore(&drvdata->spinlock, flags);
+
+	dma_free_coherent(drvdata->dev, old_size, old_vaddr, old_paddr);
+
+	return size;
+}
+static DEVICE_ATTR_RW(buffer_size);
+
 static struct attribute *coresight_etr_attrs[] = {
 	&dev_attr_trigger_cntr.attr,
 	&dev_attr_status.attr,
+	&dev_attr_buffer_size.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(coresight_etr);
@@ -766,7 +828,7 @@ err_misc_register:
 err_devm_kzalloc:
 	if (drvdata->config_type == TMC_CONFIG_TYPE_ETR)
 		dma_free_coherent(dev, drvdata->size,
-				&drvdata->paddr, GFP_KERNEL);
+				  drvdata->vaddr, drvdata->paddr);
 	return ret;
 }
 
@@ -778,7 +840,7 @@ static int tmc_remove(struct amba_device *adev)
 	coresight_unregister(drvdata->csdev);
 	if (drvdata->config_type == TMC_CONFIG_TYPE_ETR)
 		dma_free_coherent(drvdata->dev, drvdata->size,
-				  &drvdata->paddr, GFP_KERNEL);
+				  drvdata->vaddr, drvdata->paddr);
 
 	return 0;
 }
@@ -1138,6 +1138,33 @@ out:
 	return ret;
 }
 
+/*
+ * Setting up the BAM costs more than it saves on short transfers, so the
+ * decision is made on the size of the whole transfer rather than on each
+ * message: a short register address write followed by a long read still
+ * goes through DMA, all messages in a single descriptor chain.
+ */
+static bool qup_i2c_use_dma(struct qup_i2c_dev *qup, struct i2c_msg msgs[],
+			    int num)
+{
+	int idx, total = 0, nents = 0;
+
+	for (idx = 0; idx < num; idx++) {
+		if (is_vmalloc_addr(msgs[idx].buf))
+			return false;
+
+		total += msgs[idx].len;
+
+		/* The descriptor tables are sized for MX_BLOCKS blocks */
+		nents += ((msgs[idx].len + QUP_READ_LIMIT) /
+			  QUP_READ_LIMIT) * 2 + 1;
+		if (nents > (MX_BLOCKS << 1) + 1)
+			return false;
+	}
+
+	return total > qup->out_fifo_sz || total > qup->in_fifo_sz;
+}
+
 static int qup_i2c_xfer_v2(struct i2c_adapter *adap,
 			   struct i2c_msg msgs[],
 			   int num)
@@ -1162,23 +1189,15 @@ static int qup_i2c_xfer_v2(struct i2c_adapter *adap,
 	writel(QUP_V2_TAGS_EN, qup->base + QUP_I2C_MASTER_GEN);
 
 	if ((qup->is_dma)) {
-		/* All i2c_msgs should be transferred using either dma or cpu */
 		for (idx = 0; idx < num; idx++) {
 			if (msgs[idx].len == 0) {
 				ret = -EINVAL;
 				goto out;
 			}
-
-			len = (msgs[idx].len > qup->out_fifo_sz) ||
-			      (msgs[idx].len > qup->in_fifo_sz);
-
-			if ((!is_vmalloc_addr(msgs[idx].buf)) && len) {
-				use_dma = 1;
-			 } else {
-				use_dma = 0;
-				break;
-			}
 		}
+
+		/* All i2c_msgs should be transferred using either dma or cpu */
+		use_dma = qup_i2c_use_dma(qup, msgs, num);
 	}
 
 	for (idx = 0; idx < num; idx++) {
@@ -1451,6 +1470,7 @@ nodma:
 	pm_runtime_use_autosuspend(qup->dev);
 	pm_runtime_set_active(qup->dev);
 	pm_runtime_enable(qup->dev);
+	device_enable_async_suspend(qup->dev);
 
 	ret = i2c_add_adapter(&qup->adap);
 	if (ret)
@@ -15,7 +15,10 @@
 #include <linux/completion.h>
 #include <linux/delay.h>
 #include <linux/err.h>
+#include <linux/iio/buffer.h>
 #include <linux/iio/iio.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/math64.h>
@@ -65,6 +68,8 @@
 
 #define VADC_FAST_AVG_CTL			0x5a
 #define VADC_FAST_AVG_EN			0x5b
+
+#define VADC_CFG_NUM		(VADC_FAST_AVG_EN - VADC_MODE_CTL + 1)
 #define VADC_FAST_AVG_EN_SET			BIT(7)
 
 #define VADC_ACCESS				0xd0
@@ -171,6 +176,9 @@ struct vadc_channel_prop {
  * @complete: VADC result notification after interrupt is received.
  * @graph: store parameters for calibration.
  * @lock: ADC lock for access to the peripheral.
+ * @cfg_cache: last values written to the configuration registers.
+ * @cfg_valid: bitmap of valid entries in @cfg_cache.
+ * @scan_buf: samples of one buffered scan, followed by the timestamp.
  */
 struct vadc_priv {
 	struct regmap		 *regmap;
@@ -184,6 +192,9 @@ struct vadc_priv {
 	struct completion	 complete;
 	struct vadc_linear_graph graph[2];
 	struct mutex		 lock;
+	u8			 cfg_cache[VADC_CFG_NUM];
+	unsigned long		 cfg_valid;
+	s32			 *scan_buf;
 };
 
 static const struct vadc_prescale_ratio vadc_prescale_ratios[] = {
@@ -207,6 +218,30 @@ static int vadc_write(struct vadc_priv *vadc, u16 offset, u8 data)
 	return regmap_write(vadc->regmap, vadc->base + offset, data);
 }
 
+/*
+ * The configuration registers keep their value between conversions, so
+ * only the ones that differ from the previous conversion are written.
+ */
+static int vadc_write_cfg(struct vadc_priv *vadc, u16 offset, u8 data)
+{
+	unsigned int idx = offset - VADC_MODE_CTL;
+	int ret;
+
+	if (test_bit(idx, &vadc->cfg_valid) && vadc->cfg_cache[idx] == data)
+		return 0;
+
+	ret = vadc_write(vadc, offset, data);
+	if (ret) {
+		clear_bit(idx, &vadc->cfg_valid);
+		return ret;
+	}
+
+	vadc->cfg_cache[idx] = data;
+	set_bit(idx, &vadc->cfg_valid);
+
+	return 0;
+}
+
 static int vadc_reset(struct vadc_priv *vadc)
 {
 	u8 data;
@@ -226,6 +261,8 @@ static int vadc_reset(struct vadc_priv *vadc)
 
 	data |= VADC_FOLLOW_WARM_RB;
 
+	vadc->cfg_valid = 0;
+
 	return vadc_write(vadc, VADC_PERH_RESET_CTL3, data);
 }
 
@@ -277,34 +314,35 @@ static int vadc_configure(struct vadc_priv *vadc,
 	/* Mode selection */
 	mode_ctrl = (VADC_OP_MODE_NORMAL << VADC_OP_MODE_SHIFT) |
 		     VADC_ADC_TRIM_EN | VADC_AMUX_TRIM_EN;
-	ret = vadc_write(vadc, VADC_MODE_CTL, mode_ctrl);
+	ret = vadc_write_cfg(vadc, VADC_MODE_CTL, mode_ctrl);
 	if (ret)
 		return ret;
 
 	/* Channel selection */
-	ret = vadc_write(vadc, VADC_ADC_CH_SEL_CTL, prop->channel);
+	ret = vadc_write_cfg(vadc, VADC_ADC_CH_SEL_CTL, prop->channel);
 	if (ret)
 		return ret;
 
 	/* Digital parameter setup */
 	decimation = prop->decimation << VADC_ADC_DIG_DEC_RATIO_SEL_SHIFT;
-	ret = vadc_write(vadc, VADC_ADC_DIG_PARAM, decimation);
+	ret = vadc_write_cfg(vadc, VADC_ADC_DIG_PARAM, decimation);
 	if (ret)
 		return ret;
 
 	/* HW settle time delay */
-	ret = vadc_write(vadc, VADC_HW_SETTLE_DELAY, prop->hw_settle_time);
+	ret = vadc_write_cfg(vadc, VADC_HW_SETTLE_DELAY, prop->hw_settle_time);
 	if (ret)
 		return ret;
 
-	ret = vadc_write(vadc, VADC_FAST_AVG_CTL, prop->avg_samples);
+	ret = vadc_write_cfg(vadc, VADC_FAST_AVG_CTL, prop->avg_samples);
 	if (ret)
 		return ret;
 
 	if (prop->avg_samples)
-		ret = vadc_write(vadc, VADC_FAST_AVG_EN, VADC_FAST_AVG_EN_SET);
+		ret = vadc_write_cfg(vadc, VADC_FAST_AVG_EN,
+				     VADC_FAST_AVG_EN_SET);
 	else
-		ret = vadc_write(vadc, VADC_FAST_AVG_EN, 0);
+		ret = vadc_write_cfg(vadc, VADC_FAST_AVG_EN, 0);
 
 	return ret;
 }
@@ -361,28 +399,23 @@ static struct vadc_channel_prop *vadc_get_channel(struct vadc_priv *vadc,
 	return NULL;
 }
 
-static int vadc_do_conversion(struct vadc_priv *vadc,
-			      struct vadc_channel_prop *prop, u16 *data)
+/* Convert one channel, the ADC must be enabled and vadc->lock held */
+static int vadc_convert(struct vadc_priv *vadc,
+			struct vadc_channel_prop *prop, u16 *data)
 {
 	unsigned int timeout;
 	int ret;
 
-	mutex_lock(&vadc->lock);
-
 	ret = vadc_configure(vadc, prop);
 	if (ret)
-		goto unlock;
+		return ret;
 
 	if (!vadc->poll_eoc)
 		reinit_completion(&vadc->complete);
 
-	ret = vadc_set_state(vadc, true);
-	if (ret)
-		goto unlock;
-
 	ret = vadc_write(vadc, VADC_CONV_REQ, VADC_CONV_REQ_SET);
 	if (ret)
-		goto err_disable;
+		return ret;
 
 	timeout = BIT(prop->avg_samples) * VADC_CONV_TIME_MIN_US * 2;
 
@@ -390,20 +423,31 @@ static int vadc_do_conversion(struct vadc_priv *vadc,
 		ret = vadc_poll_wait_eoc(vadc, timeout);
 	} else {
 		ret = wait_for_completion_timeout(&vadc->complete, timeout);
-		if (!ret) {
-			ret = -ETIMEDOUT;
-			goto err_disable;
-		}
+		if (!ret)
+			return -ETIMEDOUT;
 
 		/* Double check conversion status */
 		ret = vadc_poll_wait_eoc(vadc, VADC_CONV_TIME_MIN_US);
-		if (ret)
-			goto err_disable;
 	}
+	if (ret)
+		return ret;
+
+	return vadc_read_result(vadc, data);
+}
+
+static int vadc_do_conversion(struct vadc_priv *vadc,
+			      struct vadc_channel_prop *prop, u16 *data)
+{
+	int ret;
 
-	ret = vadc_read_result(vadc, data);
+	mutex_lock(&vadc->lock);
+
+	ret = vadc_set_state(vadc, true);
+	if (ret)
+		goto unlock;
+
+	ret = vadc_convert(vadc, prop, data);
 
-err_disable:
 	vadc_set_state(vadc, false);
 	if (ret)
 		dev_err(vadc->dev, "conversion failed\n");
@@ -536,6 +580,55 @@ static int vadc_avg_samples_from_dt(u32 value)
 	return __ffs64(value);
 }
 
+/*
+ * A buffered scan converts all enabled channels back to back with the ADC
+ * left enabled, and pushes the same values read_raw() would return.
+ */
+static irqreturn_t vadc_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct vadc_priv *vadc = iio_priv(indio_dev);
+	struct vadc_channel_prop *prop;
+	unsigned int i, j = 0;
+	u16 adc_code;
+	s32 val;
+	int ret;
+
+	mutex_lock(&vadc->lock);
+
+	ret = vadc_set_state(vadc, true);
+	if (ret)
+		goto unlock;
+
+	/* The timestamp is the last bit of the scan mask */
+	for_each_set_bit(i, indio_dev->active_scan_mask, vadc->nchannels) {
+		prop = &vadc->chan_props[i];
+		ret = vadc_convert(vadc, prop, &adc_code);
+		if (ret)
+			break;
+
+		val = vadc_calibrate(vadc, prop, adc_code);
+		if (indio_dev->channels[i].type == IIO_TEMP)
+			val = val / 2 - KELVINMIL_CELSIUSMIL;
+
+		vadc->scan_buf[j++] = val;
+	}
+
+	vadc_set_state(vadc, false);
+
+	if (ret)
+		dev_err(vadc->dev, "conversion failed\n");
+	else
+		iio_push_to_buffers_with_timestamp(indio_dev, vadc->scan_buf,
+						   iio_get_time_ns());
+unlock:
+	mutex_unlock(&vadc->lock);
+	iio_trigger_notify_done(indio_dev->trig);
+
+	return IRQ_HANDLED;
+}
+
 static int vadc_read_raw(struct iio_dev *indio_dev,
 			 struct iio_chan_spec const *chan, int *val, int *val2,
 			 long mask)
@@ -825,7 +918,8 @@ static int vadc_get_dt_data(struct vadc_priv *vadc, struct device_node *node)
 	if (!vadc->nchannels)
 		return -EINVAL;
 
-	vadc->iio_chans = devm_kcalloc(vadc->dev, vadc->nchannels,
+	/* One more for the timestamp of buffered scans */
+	vadc->iio_chans = devm_kcalloc(vadc->dev, vadc->nchannels + 1,
 				       sizeof(*vadc->iio_chans), GFP_KERNEL);
 	if (!vadc->iio_chans)
 		return -ENOMEM;
@@ -853,11 +947,29 @@ static int vadc_get_dt_data(struct vadc_priv *vadc, struct device_node *node)
 		iio_chan->info_mask_separate = vadc_chan->info_mask;
 		iio_chan->type = vadc_chan->type;
 		iio_chan->indexed = 1;
+		iio_chan->scan_index = index;
+		iio_chan->scan_type.sign = 's';
+		iio_chan->scan_type.realbits = 32;
+		iio_chan->scan_type.storagebits = 32;
+		iio_chan->scan_type.endianness = IIO_CPU;
 		iio_chan->address = index++;
 
 		iio_chan++;
 	}
 
+	iio_chan->type = IIO_TIMESTAMP;
+	iio_chan->channel = -1;
+	iio_chan->scan_index = index;
+	iio_chan->scan_type.sign = 's';
+	iio_chan->scan_type.realbits = 64;
+	iio_chan->scan_type.storagebits = 64;
+
+	/* Samples, padding to align the timestamp and the timestamp */
+	vadc->scan_buf = devm_kcalloc(vadc->dev, vadc->nchannels + 3,
+				      sizeof(*vadc->scan_buf), GFP_KERNEL);
+	if (!vadc->scan_buf)
+		return -ENOMEM;
+
 	/* These channels are mandatory, they are used as reference points */
 	if (!vadc_get_channel(vadc, VADC_REF_1250MV)) {
 		dev_err(vadc->dev, "Please define 1.25V channel\n");
@@ -992,9 +1104,30 @@ static int vadc_probe(struct platform_device *pdev)
 	indio_dev->modes = INDIO_DIRECT_MODE;
 	indio_dev->info = &vadc_info;
 	indio_dev->channels = vadc->iio_chans;
-	indio_dev->num_channels = vadc->nchannels;
+	indio_dev->num_channels = vadc->nchannels + 1;
+
+	platform_set_drvdata(pdev, indio_dev);
+
+	ret = iio_triggered_buffer_setup(indio_dev, NULL,
+					 vadc_trigger_handler, NULL);
+	if (ret)
+		return ret;
+
+	ret = iio_device_register(indio_dev);
+	if (ret)
+		iio_triggered_buffer_cleanup(indio_dev);
 
-	return devm_iio_device_register(dev, indio_dev);
+	return ret;
+}
+
+static int vadc_remove(struct platform_device *pdev)
+{
+	struct iio_dev *indio_dev = platform_get_drvdata(pdev);
+
+	iio_device_unregister(indio_dev);
+	iio_triggered_buffer_cleanup(indio_dev);
+
+	return 0;
 }
 
 static const struct of_device_id vadc_match_table[] = {
@@ -1009,6 +1142,7 @@ static struct platform_driver vadc_driver = {
 		   .of_match_table = vadc_match_table,
 	},
 	.probe = vadc_probe,
+	.remove = vadc_remove,
 };
 module_platform_driver(vadc_driver);
 
@@ -165,6 +165,39 @@ fail:
 	return ret;
 }
 
+/* Invalidate the TLB entries of a single mapping */
+static int __flush_iotlb_va(struct iommu_domain *domain, unsigned long va)
+{
+	struct msm_priv *priv = to_msm_priv(domain);
+	struct msm_iommu_dev *iommu = NULL;
+	struct msm_iommu_ctx_dev *master;
+	int ret = 0;
+
+	list_for_each_entry(iommu, &priv->list_attached, dom_node) {
+		ret = __enable_clocks(iommu);
+		if (ret)
+			goto fail;
+
+		list_for_each_entry(master, &iommu->ctx_list, list)
+			SET_TLBIVA(iommu->base, master->num,
+				   (va & SL_BASE_MASK_SMALL) |
+				   GET_CONTEXTIDR_ASID(iommu->base,
+						       master->num));
+
+		__disable_clocks(iommu);
+	}
+fail:
+	return ret;
+}
+
+/* Make page table updates visible to the table walker */
+static inline void __clean_pte(unsigned long *start, unsigned long *end)
+{
+#ifndef CONFIG_IOMMU_PGTABLES_L2
+	dmac_flush_range(start, end);
+#endif
+}
+
 static int msm_iommu_alloc_ctx(unsigned long *map, int start, int end)
 {
 	int idx;
@@ -423,11 +456,9 @@ fail:
 	spin_unlock_irqrestore(&msm_iommu_lock, flags);
 }
 
-static int msm_iommu_map(struct iommu_domain *domain, unsigned long va,
-			 phys_addr_t pa, size_t len, int prot)
+static int __msm_iommu_map(struct msm_priv *priv, unsigned long va,
+			   phys_addr_t pa, size_t len, int prot)
 {
-	struct msm_priv *priv;
-	unsigned long flags;
 	unsigned long *fl_table;
 	unsigned long *fl_pte;
 	unsigned long fl_offset;
@@ -437,8 +468,6 @@ static int msm_iommu_map(struct iommu_domain *domain, unsigned long va,
 	unsigned int pgprot;
 	int ret = 0, tex = 0, sh;
 
-	spin_lock_irqsave(&msm_iommu_lock, flags);
-
 	sh = (prot & MSM_IOMMU_ATTR_SH) ? 1 : 0;
 
 	if (prot & IOMMU_CACHE)
@@ -449,8 +478,6 @@ static int msm_iommu_map(struct iommu_domain *domain, unsigned long va,
 		goto fail;
 	}
 
-	priv = to_msm_priv(domain);
-
 	fl_table = priv->pgtable;
 
 	if (len != SZ_16M && len != SZ_1M &&
@@ -487,11 +514,14 @@ static int msm_iommu_map(struct iommu_domain *domain, unsigned long va,
 			*(fl_pte+i) = (pa & 0xFF000000) | FL_SUPERSECTION |
 				  FL_AP1 | FL_AP0 | FL_TYPE_SECT |
 				  FL_SHARED | FL_NG | pgprot;
+		__clean_pte(fl_pte, fl_pte + 16);
 	}
 
-	if (len == SZ_1M)
+	if (len == SZ_1M) {
 		*fl_pte = (pa & 0xFFF00000) | FL_AP1 | FL_AP0 | FL_NG |
 					    FL_TYPE_SECT | FL_SHARED | pgprot;
+		__clean_pte(fl_pte, fl_pte + 1);
+	}
 
 	/* Need a 2nd level table */
 	if ((len == SZ_4K || len == SZ_64K) && (*fl_pte) == 0) {
@@ -506,7 +536,9 @@ static int msm_iommu_map(struct iommu_domain *domain, unsigned long va,
 		}
 
 		memset(sl, 0, SZ_4K);
+		__clean_pte(sl, sl + NUM_SL_PTE);
 		*fl_pte = ((((int)__pa(sl)) & FL_BASE_MASK) | FL_TYPE_TABLE);
+		__clean_pte(fl_pte, fl_pte + 1);
 	}
 
 	sl_table = (unsigned long *) __va(((*fl_pte) & FL_BASE_MASK));
@@ -514,9 +546,11 @@ static int msm_iommu_map(struct iommu_domain *domain, unsigned long va,
 	sl_pte = sl_table + sl_offset;
 
 
-	if (len == SZ_4K)
+	if (len == SZ_4K) {
 		*sl_pte = (pa & SL_BASE_MASK_SMALL) | SL_AP0 | SL_AP1 | SL_NG |
 					  SL_SHARED | SL_TYPE_SMALL | pgprot;
+		__clean_pte(sl_pte, sl_pte + 1);
+	}
 
 	if (len == SZ_64K) {
 		int i;
@@ -524,14 +558,98 @@ static int msm_iommu_map(struct iommu_domain *domain, unsigned long va,
 		for (i = 0; i < 16; i++)
 			*(sl_pte+i) = (pa & SL_BASE_MASK_LARGE) | SL_AP0 |
 			    SL_NG | SL_AP1 | SL_SHARED | SL_TYPE_LARGE | pgprot;
+		__clean_pte(sl_pte, sl_pte + 16);
 	}
 
-	ret = __flush_iotlb(domain);
+	/*
+	 * The entries were invalid before, the TLB can't hold anything for
+	 * them, so there is nothing to invalidate.
+	 */
 fail:
+	return ret;
+}
+
+static int msm_iommu_map(struct iommu_domain *domain, unsigned long va,
+			 phys_addr_t pa, size_t len, int prot)
+{
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&msm_iommu_lock, flags);
+	ret = __msm_iommu_map(to_msm_priv(domain), va, pa, len, prot);
 	spin_unlock_irqrestore(&msm_iommu_lock, flags);
+
 	return ret;
 }
 
+/* Largest page size that @va and @pa are aligned to and @len can hold */
+static size_t msm_iommu_pgsize(unsigned long va, phys_addr_t pa, size_t len)
+{
+	static const size_t pgsizes[] = { SZ_16M, SZ_1M, SZ_64K };
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(pgsizes); i++)
+		if (len >= pgsizes[i] && IS_ALIGNED(va | pa, pgsizes[i]))
+			return pgsizes[i];
+
+	return SZ_4K;
+}
+
+/*
+ * Map a whole scatterlist under a single lock, using the largest pages
+ * each chunk allows, instead of going through iommu_map() for every
+ * segment.
+ */
+static size_t msm_iommu_map_sg(struct iommu_domain *domain, unsigned long iova,
+			       struct scatterlist *sg, unsigned int nents,
+			       int prot)
+{
+	struct msm_priv *priv = to_msm_priv(domain);
+	struct scatterlist *s;
+	unsigned long flags;
+	size_t mapped = 0;
+	unsigned int i;
+	int ret = 0;
+
+	spin_lock_irqsave(&msm_iommu_lock, flags);
+
+	for_each_sg(sg, s, nents, i) {
+		phys_addr_t pa = page_to_phys(sg_page(s)) + s->offset;
+		size_t len = s->length;
+		size_t pgsize;
+
+		if (!IS_ALIGNED((iova + mapped) | pa | len, SZ_4K)) {
+			ret = -EINVAL;
+			break;
+		}
+
+		while (len) {
+			pgsize = msm_iommu_pgsize(iova + mapped, pa, len);
+			ret = __msm_iommu_map(priv, iova + mapped, pa, pgsize,
+					      prot);
+			if (ret)
+				break;
+
+			mapped += pgsize;
+			pa += pgsize;
+			len -= pgsize;
+		}
+
+		if (ret)
+			break;
+	}
+
+	spin_unlock_irqrestore(&msm_iommu_lock, flags);
+
+	if (ret) {
+		/* undo mappings already done */
+		iommu_unmap(domain, iova, mapped);
+		return 0;
+	}
+
+	return mapped;
+}
+
 static size_t msm_iommu_unmap(struct iommu_domain *domain, unsigned long va,
 			    size_t len)
 {
@@ -543,6 +661,7 @@ static size_t msm_iommu_unmap(struct iommu_domain *domain, unsigned long va,
 	unsigned long *sl_table;
 	unsigned long *sl_pte;
 	unsigned long sl_offset;
+	unsigned long *free_sl = NULL;
 	int i, ret = 0;
 
 	spin_lock_irqsave(&msm_iommu_lock, flags);
@@ -571,12 +690,16 @@ static size_t msm_iommu_unmap(struct iommu_domain *domain, unsigned long va,
 	}
 
 	/* Unmap supersection */
-	if (len == SZ_16M)
+	if (len == SZ_16M) {
 		for (i = 0; i < 16; i++)
 			*(fl_pte+i) = 0;
+		__clean_pte(fl_pte, fl_pte + 16);
+	}
 
-	if (len == SZ_1M)
+	if (len == SZ_1M) {
 		*fl_pte = 0;
+		__clean_pte(fl_pte, fl_pte + 1);
+	}
 
 	sl_table = (unsigned long *) __va(((*fl_pte) & FL_BASE_MASK));
 	sl_offset = SL_OFFSET(va);
@@ -585,10 +708,13 @@ static size_t msm_iommu_unmap(struct iommu_domain *domain, unsigned long va,
 	if (len == SZ_64K) {
 		for (i = 0; i < 16; i++)
 			*(sl_pte+i) = 0;
+		__clean_pte(sl_pte, sl_pte + 16);
 	}
 
-	if (len == SZ_4K)
+	if (len == SZ_4K) {
 		*sl_pte = 0;
+		__clean_pte(sl_pte, sl_pte + 1);
+	}
 
 	if (len == SZ_4K || len == SZ_64K) {
 		int used = 0;
@@ -597,12 +723,18 @@ static size_t msm_iommu_unmap(struct iommu_domain *domain, unsigned long va,
 			if (sl_table[i])
 				used = 1;
 		if (!used) {
-			free_page((unsigned long)sl_table);
+			free_sl = sl_table;
 			*fl_pte = 0;
+			__clean_pte(fl_pte, fl_pte + 1);
 		}
 	}
 
-	ret = __flush_iotlb(domain);
+	/* A single entry covers the whole mapping, whatever its size */
+	ret = __flush_iotlb_va(domain, va);
+
+	/* Only free the table once the walker can't reach it anymore */
+	if (free_sl)
+		free_page((unsigned long)free_sl);
 
 fail:
 	spin_unlock_irqrestore(&msm_iommu_lock, flags);
@@ -772,7 +904,7 @@ static struct iommu_ops msm_iommu_ops = {
 	.detach_dev = msm_iommu_detach_dev,
 	.map = msm_iommu_map,
 	.unmap = msm_iommu_unmap,
-	.map_sg = default_iommu_map_sg,
+	.map_sg = msm_iommu_map_sg,
 	.iova_to_phys = msm_iommu_iova_to_phys,
 	.pgsize_bitmap = MSM_IOMMU_PGSIZES,
 	.of_xlate = qcom_iommu_of_xlate,
@@ -367,6 +367,14 @@ struct cached_dev {
 	unsigned		writeback_rate_update_seconds;
 	unsigned		writeback_rate_d_term;
 	unsigned		writeback_rate_p_term_inverse;
+
+	/*
+	 * jiffies of the last foreground request; once the backing device
+	 * has been idle for a while writeback runs at full rate, and
+	 * writeback_rate_idle is set until the next request comes in.
+	 */
+	unsigned long		last_request;
+	atomic_t		writeback_rate_idle;
 };
 
 enum alloc_reserve {
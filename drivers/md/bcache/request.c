@@ -965,9 +965,17 @@ static blk_qc_t cached_dev_make_request(struct request_queue *q,
 	struct bcache_device *d = bio->bi_bdev->bd_disk->private_data;
 	struct cached_dev *dc = container_of(d, struct cached_dev, disk);
 	int rw = bio_data_dir(bio);
+	unsigned long now = jiffies;
 
 	generic_start_io_acct(rw, bio_sectors(bio), &d->disk->part0);
 
+	/* Avoid dirtying the cacheline on every bio */
+	if (dc->last_request != now)
+		dc->last_request = now;
+	if (unlikely(atomic_read(&dc->writeback_rate_idle)) &&
+	    atomic_xchg(&dc->writeback_rate_idle, 0))
+		dc->writeback_rate.rate = 1;
+
 	bio->bi_bdev = dc->bdev;
 	bio->bi_iter.bi_sector += dc->sb.data_offset;
 
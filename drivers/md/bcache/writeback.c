@@ -9,6 +9,7 @@
 #include "bcache.h"
 #include "btree.h"
 #include "debug.h"
+#include "request.h"
 #include "writeback.h"
 
 #include <linux/delay.h>
@@ -18,6 +19,16 @@
 
 /* Rate limiting */
 
+#define WRITEBACK_IDLE_PERIODS	6
+
+static bool writeback_backing_idle(struct cached_dev *dc)
+{
+	unsigned long idle = WRITEBACK_IDLE_PERIODS *
+		dc->writeback_rate_update_seconds * HZ;
+
+	return time_after(jiffies, READ_ONCE(dc->last_request) + idle);
+}
+
 static void __update_writeback_rate(struct cached_dev *dc)
 {
 	struct cache_set *c = dc->disk.c;
@@ -59,6 +70,10 @@ static void __update_writeback_rate(struct cached_dev *dc)
 			 dc->writeback_rate.next + NSEC_PER_MSEC))
 		change = 0;
 
+	/* ...or while foreground IO is already seeing cache congestion */
+	if (change > 0 && bch_get_congested(c))
+		change = 0;
+
 	dc->writeback_rate.rate =
 		clamp_t(int64_t, (int64_t) dc->writeback_rate.rate + change,
 			1, NSEC_PER_MSEC);
@@ -78,8 +93,19 @@ static void update_writeback_rate(struct work_struct *work)
 	down_read(&dc->writeback_lock);
 
 	if (atomic_read(&dc->has_dirty) &&
-	    dc->writeback_percent)
-		__update_writeback_rate(dc);
+	    dc->writeback_percent) {
+		/*
+		 * Nobody is using the backing device: flush dirty data as
+		 * fast as it will take it. The request path drops the rate
+		 * back to the minimum as soon as foreground IO resumes.
+		 */
+		if (writeback_backing_idle(dc)) {
+			atomic_set(&dc->writeback_rate_idle, 1);
+			dc->writeback_rate.rate = NSEC_PER_MSEC;
+		} else {
+			__update_writeback_rate(dc);
+		}
+	}
 
 	up_read(&dc->writeback_lock);
 
@@ -512,6 +538,7 @@ void bch_cached_dev_writeback_init(struct cached_dev *dc)
 	dc->writeback_percent		= 10;
 	dc->writeback_delay		= 30;
 	dc->writeback_rate.rate		= 1024;
+	dc->last_request		= jiffies;
 
 	dc->writeback_rate_update_seconds = 5;
 	dc->writeback_rate_d_term	= 30;
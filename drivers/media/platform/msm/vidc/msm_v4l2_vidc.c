@@ -194,6 +194,7 @@ static int vidc_open(struct file *file)
 
 	INIT_LIST_HEAD(&inst->bufqueue);
 	mutex_init(&inst->bufqueue_lock);
+	spin_lock_init(&inst->debug.latency_lock);
 
 	if (vdev == &core->vdev_dec)
 		inst->session_type = VIDC_DECODER;
@@ -1072,6 +1072,8 @@ static int vdec_set_session_buf(struct vb2_buffer *vb)
 		__fill_flags(&fdata, vbuf->flags);
 
 		ret = call_hfi_op(hdev, session_etb, inst->session, &fdata);
+		if (!ret)
+			vidc_debugfs_latency_etb(inst, time_usec);
 	} else if (q->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
 		fdata.buffer_type = vidc_comm_get_hal_output_buffer(inst);
 		fdata.filled_len = 0;
@@ -1378,6 +1380,7 @@ static int vdec_fill_buf_done(struct vidc_inst *inst, u32 addr,
 	struct device *dev = &inst->core->res.pdev->dev;
 	struct vb2_v4l2_buffer *vbuf;
 	struct vb2_buffer *vb;
+	s64 time_usec;
 
 	vbuf = vdec_get_vb2buffer(inst, addr);
 	if (!vbuf)
@@ -1389,6 +1392,12 @@ static int vdec_fill_buf_done(struct vidc_inst *inst, u32 addr,
 	vbuf->flags = flags;
 	vbuf->timestamp = *timestamp;
 
+	if (bytesused) {
+		time_usec = timeval_to_ns(timestamp);
+		do_div(time_usec, NSEC_PER_USEC);
+		vidc_debugfs_latency_fbd(inst, time_usec);
+	}
+
 	if (vb->planes[0].data_offset > vb->planes[0].length)
 		dev_warn(dev, "overflow data_offset:%d, length:%d\n",
 			 vb->planes[0].data_offset, vb->planes[0].length);
@@ -1513,6 +1522,9 @@ int vdec_open(struct vidc_inst *inst)
 	if (IS_ERR(inst->vb2_ctx_cap))
 		return PTR_ERR(inst->vb2_ctx_cap);
 
+	/* firmware keeps the address registered at buf_init time */
+	vb2_dma_contig_keep_dmabuf_mapped(inst->vb2_ctx_cap);
+
 	inst->vb2_ctx_out = vb2_dma_contig_init_ctx(iommu_dev);
 	if (IS_ERR(inst->vb2_ctx_out)) {
 		ret = PTR_ERR(inst->vb2_ctx_out);
@@ -1473,6 +1473,9 @@ int venc_open(struct vidc_inst *inst)
 		goto err_cleanup_cap;
 	}
 
+	/* firmware keeps the address registered at buf_init time */
+	vb2_dma_contig_keep_dmabuf_mapped(inst->vb2_ctx_out);
+
 	q = &inst->bufq_cap;
 	q->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
 	q->io_modes = VB2_MMAP;
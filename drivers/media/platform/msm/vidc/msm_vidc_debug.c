@@ -297,6 +297,80 @@ static const struct file_operations inst_info_fops = {
 	.read = inst_info_read,
 };
 
+static ssize_t inst_latency_read(struct file *file, char __user *buf,
+		size_t count, loff_t *ppos)
+{
+	struct vidc_inst *inst = file->private_data;
+	u32 hist[VIDC_LATENCY_BUCKETS];
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&inst->debug.latency_lock, flags);
+	memcpy(hist, inst->debug.latency_hist, sizeof(hist));
+	spin_unlock_irqrestore(&inst->debug.latency_lock, flags);
+
+	INIT_DBG_BUF(dbg_buf);
+	write_str(&dbg_buf, "ETB to FBD latency (ms): frames\n");
+	for (i = 0; i < VIDC_LATENCY_BUCKETS - 1; i++)
+		write_str(&dbg_buf, "< %4u: %u\n", 1 << i, hist[i]);
+	write_str(&dbg_buf, ">= %3u: %u\n", 1 << (i - 1), hist[i]);
+
+	return simple_read_from_buffer(buf, count, ppos,
+		dbg_buf.ptr, dbg_buf.filled_size);
+}
+
+static const struct file_operations inst_latency_fops = {
+	.open = inst_info_open,
+	.read = inst_latency_read,
+};
+
+/*
+ * Remember when the input buffer carrying @timestamp was handed to the
+ * firmware. The oldest entry is recycled if frames are never output.
+ */
+void vidc_debugfs_latency_etb(struct vidc_inst *inst, s64 timestamp)
+{
+	struct vidc_debug *d = &inst->debug;
+	struct latency_slot *slot;
+	unsigned long flags;
+
+	spin_lock_irqsave(&d->latency_lock, flags);
+	slot = &d->latency_slots[d->latency_next++ % VIDC_LATENCY_SLOTS];
+	slot->timestamp = timestamp;
+	slot->etb_time = ktime_get();
+	slot->used = true;
+	spin_unlock_irqrestore(&d->latency_lock, flags);
+}
+
+/*
+ * The decoder copies the input timestamp to the output buffer, so the
+ * time since the matching ETB is the per-frame decode latency.
+ */
+void vidc_debugfs_latency_fbd(struct vidc_inst *inst, s64 timestamp)
+{
+	struct vidc_debug *d = &inst->debug;
+	unsigned long flags;
+	s64 delta_ms;
+	int i, bucket;
+
+	spin_lock_irqsave(&d->latency_lock, flags);
+	for (i = 0; i < VIDC_LATENCY_SLOTS; i++) {
+		struct latency_slot *slot = &d->latency_slots[i];
+
+		if (!slot->used || slot->timestamp != timestamp)
+			continue;
+
+		slot->used = false;
+		delta_ms = ktime_ms_delta(ktime_get(), slot->etb_time);
+		bucket = delta_ms > 0 ? fls64(delta_ms) : 0;
+		if (bucket >= VIDC_LATENCY_BUCKETS)
+			bucket = VIDC_LATENCY_BUCKETS - 1;
+		d->latency_hist[bucket]++;
+		break;
+	}
+	spin_unlock_irqrestore(&d->latency_lock, flags);
+}
+
 struct dentry *vidc_debugfs_init_inst(struct vidc_inst *inst,
 				      struct dentry *parent)
 {
@@ -316,6 +390,11 @@ struct dentry *vidc_debugfs_init_inst(struct vidc_inst *inst,
 		dprintk(VIDC_ERR, "debugfs_create_file: fail\n");
 		goto failed_create_dir;
 	}
+	if (!debugfs_create_file("latency", S_IRUGO, dir, inst,
+			&inst_latency_fops)) {
+		dprintk(VIDC_ERR, "debugfs_create_file: fail\n");
+		goto failed_create_dir;
+	}
 	inst->debug.pdata[FRAME_PROCESSING].sampling = true;
 failed_create_dir:
 	return dir;
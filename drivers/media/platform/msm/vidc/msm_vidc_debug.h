@@ -121,6 +121,8 @@ struct dentry *vidc_debugfs_init_core(struct vidc_core *core,
 struct dentry *vidc_debugfs_init_inst(struct vidc_inst *inst,
 				      struct dentry *parent);
 void vidc_debugfs_update(struct vidc_inst *inst, enum msm_vidc_debugfs_event e);
+void vidc_debugfs_latency_etb(struct vidc_inst *inst, s64 timestamp);
+void vidc_debugfs_latency_fbd(struct vidc_inst *inst, s64 timestamp);
 
 static inline void tic(struct vidc_inst *i, enum profiling_points p, char *b)
 {
@@ -19,6 +19,8 @@
 #include <linux/time.h>
 #include <linux/types.h>
 #include <linux/completion.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
 #include <linux/wait.h>
 #include <linux/workqueue.h>
 
@@ -157,10 +159,26 @@ struct profile_data {
 	int average;
 };
 
+/* input buffers tracked for latency, matched on FBD by timestamp */
+#define VIDC_LATENCY_SLOTS	32
+/* power of two millisecond buckets: <1, <2, <4, ... , >= 512 */
+#define VIDC_LATENCY_BUCKETS	11
+
+struct latency_slot {
+	s64 timestamp;
+	ktime_t etb_time;
+	bool used;
+};
+
 struct vidc_debug {
 	struct profile_data pdata[MAX_PROFILING_POINTS];
 	int profile;
 	int samples;
+
+	spinlock_t latency_lock;
+	struct latency_slot latency_slots[VIDC_LATENCY_SLOTS];
+	unsigned int latency_next;
+	u32 latency_hist[VIDC_LATENCY_BUCKETS];
 };
 
 enum vidc_modes {
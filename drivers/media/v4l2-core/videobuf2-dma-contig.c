@@ -23,6 +23,7 @@
 
 struct vb2_dc_conf {
 	struct device		*dev;
+	bool			keep_dmabuf_mapped;
 };
 
 struct vb2_dc_buf {
@@ -41,6 +42,9 @@ struct vb2_dc_buf {
 
 	/* DMABUF related */
 	struct dma_buf_attachment	*db_attach;
+	bool				db_keep_mapped;
+	/* unmapped as far as vb2 knows, but still mapped for the device */
+	bool				db_parked;
 };
 
 /*********************************************/
@@ -602,6 +606,14 @@ static int vb2_dc_map_dmabuf(void *mem_priv)
 		return -EINVAL;
 	}
 
+	if (buf->db_parked) {
+		sgt = buf->dma_sgt;
+		dma_sync_sg_for_device(buf->dev, sgt->sgl, sgt->orig_nents,
+				       buf->dma_dir);
+		buf->db_parked = false;
+		return 0;
+	}
+
 	if (WARN_ON(buf->dma_sgt)) {
 		pr_err("dmabuf buffer is already pinned\n");
 		return 0;
@@ -630,6 +642,21 @@ static int vb2_dc_map_dmabuf(void *mem_priv)
 	return 0;
 }
 
+static void __vb2_dc_unmap_dmabuf(struct vb2_dc_buf *buf)
+{
+	struct sg_table *sgt = buf->dma_sgt;
+
+	if (buf->vaddr) {
+		dma_buf_vunmap(buf->db_attach->dmabuf, buf->vaddr);
+		buf->vaddr = NULL;
+	}
+	dma_buf_unmap_attachment(buf->db_attach, sgt, buf->dma_dir);
+
+	buf->dma_addr = 0;
+	buf->dma_sgt = NULL;
+	buf->db_parked = false;
+}
+
 static void vb2_dc_unmap_dmabuf(void *mem_priv)
 {
 	struct vb2_dc_buf *buf = mem_priv;
@@ -640,28 +667,36 @@ static void vb2_dc_unmap_dmabuf(void *mem_priv)
 		return;
 	}
 
-	if (WARN_ON(!sgt)) {
+	if (WARN_ON(!sgt || buf->db_parked)) {
 		pr_err("dmabuf buffer is already unpinned\n");
 		return;
 	}
 
-	if (buf->vaddr) {
-		dma_buf_vunmap(buf->db_attach->dmabuf, buf->vaddr);
-		buf->vaddr = NULL;
+	/*
+	 * Keep the device mapping until the buffer is detached, so a
+	 * dmabuf queued again does not pay for an IOMMU map/unmap and
+	 * keeps its device address. Only hand the data back to the cpu.
+	 */
+	if (buf->db_keep_mapped) {
+		dma_sync_sg_for_cpu(buf->dev, sgt->sgl, sgt->orig_nents,
+				    buf->dma_dir);
+		buf->db_parked = true;
+		return;
 	}
-	dma_buf_unmap_attachment(buf->db_attach, sgt, buf->dma_dir);
 
-	buf->dma_addr = 0;
-	buf->dma_sgt = NULL;
+	__vb2_dc_unmap_dmabuf(buf);
 }
 
 static void vb2_dc_detach_dmabuf(void *mem_priv)
 {
 	struct vb2_dc_buf *buf = mem_priv;
 
+	if (buf->db_parked)
+		__vb2_dc_unmap_dmabuf(buf);
+
 	/* if vb2 works correctly you should never detach mapped buffer */
 	if (WARN_ON(buf->dma_addr))
-		vb2_dc_unmap_dmabuf(buf);
+		__vb2_dc_unmap_dmabuf(buf);
 
 	/* detach this attachment */
 	dma_buf_detach(buf->db_attach->dmabuf, buf->db_attach);
@@ -694,6 +729,7 @@ static void *vb2_dc_attach_dmabuf(void *alloc_ctx, struct dma_buf *dbuf,
 	buf->dma_dir = dma_dir;
 	buf->size = size;
 	buf->db_attach = dba;
+	buf->db_keep_mapped = conf->keep_dmabuf_mapped;
 
 	return buf;
 }
@@ -735,6 +771,23 @@ void *vb2_dma_contig_init_ctx(struct device *dev)
 }
 EXPORT_SYMBOL_GPL(vb2_dma_contig_init_ctx);
 
+/**
+ * vb2_dma_contig_keep_dmabuf_mapped() - keep imported dmabufs mapped
+ * @alloc_ctx:	context returned by vb2_dma_contig_init_ctx()
+ *
+ * By default an imported dmabuf is mapped for the device on every QBUF
+ * and unmapped on DQBUF. With this set, the mapping made on the first
+ * QBUF is kept until the dmabuf is detached from the vb2 buffer, and
+ * only the cache maintenance is done per queue cycle.
+ */
+void vb2_dma_contig_keep_dmabuf_mapped(void *alloc_ctx)
+{
+	struct vb2_dc_conf *conf = alloc_ctx;
+
+	conf->keep_dmabuf_mapped = true;
+}
+EXPORT_SYMBOL_GPL(vb2_dma_contig_keep_dmabuf_mapped);
+
 void vb2_dma_contig_cleanup_ctx(void *alloc_ctx)
 {
 	if (!IS_ERR_OR_NULL(alloc_ctx))
@@ -185,7 +185,7 @@ static void mmc_blk_put(struct mmc_blk_data *md)
 	md->usage--;
 	if (md->usage == 0) {
 		int devidx = mmc_get_devidx(md->disk);
-		blk_cleanup_queue(md->queue.queue);
+		mmc_queue_free(&md->queue);
 
 		__clear_bit(devidx, dev_use);
 
@@ -744,6 +744,14 @@ static inline int mmc_blk_part_switch(struct mmc_card *card,
 	if (mmc_card_mmc(card)) {
 		u8 part_config = card->ext_csd.part_config;
 
+		/* RPMB is not accessible in command queue mode */
+		if (md->part_type == EXT_CSD_PART_CONFIG_ACC_RPMB &&
+		    card->ext_csd.cmdq_en) {
+			ret = mmc_cmdq_disable(card);
+			if (ret)
+				return ret;
+		}
+
 		part_config &= ~EXT_CSD_PART_CONFIG_ACC_MASK;
 		part_config |= md->part_type;
 
@@ -754,6 +762,13 @@ static inline int mmc_blk_part_switch(struct mmc_card *card,
 			return ret;
 
 		card->ext_csd.part_config = part_config;
+
+		if (main_md->part_curr == EXT_CSD_PART_CONFIG_ACC_RPMB &&
+		    card->host->cqe_enabled && !card->ext_csd.cmdq_en) {
+			ret = mmc_cmdq_enable(card);
+			if (ret)
+				return ret;
+		}
 	}
 
 	main_md->part_curr = md->part_type;
@@ -1173,7 +1188,7 @@ out:
 		goto retry;
 	if (!err)
 		mmc_blk_reset_success(md, type);
-	blk_end_request(req, err, blk_rq_bytes(req));
+	mmc_queue_end_request(req, err, blk_rq_bytes(req));
 
 	return err ? 0 : 1;
 }
@@ -1240,7 +1255,7 @@ out_retry:
 	if (!err)
 		mmc_blk_reset_success(md, type);
 out:
-	blk_end_request(req, err, blk_rq_bytes(req));
+	mmc_queue_end_request(req, err, blk_rq_bytes(req));
 
 	return err ? 0 : 1;
 }
@@ -1255,7 +1270,7 @@ static int mmc_blk_issue_flush(struct mmc_queue *mq, struct request *req)
 	if (ret)
 		ret = -EIO;
 
-	blk_end_request_all(req, ret);
+	mmc_queue_end_request_all(req, ret);
 
 	return ret ? 0 : 1;
 }
@@ -1841,11 +1856,12 @@ static int mmc_blk_cmd_err(struct mmc_blk_data *md, struct mmc_card *card,
 
 		blocks = mmc_sd_num_wr_blocks(card);
 		if (blocks != (u32)-1) {
-			ret = blk_end_request(req, 0, blocks << 9);
+			ret = mmc_queue_end_request(req, 0, blocks << 9);
 		}
 	} else {
 		if (!mmc_packed_cmd(mq_rq->cmd_type))
-			ret = blk_end_request(req, 0, brq->data.bytes_xfered);
+			ret = mmc_queue_end_request(req, 0,
+						    brq->data.bytes_xfered);
 	}
 	return ret;
 }
@@ -1874,7 +1890,7 @@ static int mmc_blk_end_packed_req(struct mmc_queue_req *mq_rq)
 			return ret;
 		}
 		list_del_init(&prq->queuelist);
-		blk_end_request(prq, 0, blk_rq_bytes(prq));
+		mmc_queue_end_request(prq, 0, blk_rq_bytes(prq));
 		i++;
 	}
 
@@ -1892,7 +1908,7 @@ static void mmc_blk_abort_packed_req(struct mmc_queue_req *mq_rq)
 	while (!list_empty(&packed->list)) {
 		prq = list_entry_rq(packed->list.next);
 		list_del_init(&prq->queuelist);
-		blk_end_request(prq, -EIO, blk_rq_bytes(prq));
+		mmc_queue_end_request(prq, -EIO, blk_rq_bytes(prq));
 	}
 
 	mmc_blk_clear_packed(mq_rq);
@@ -1988,7 +2004,7 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 				ret = mmc_blk_end_packed_req(mq_rq);
 				break;
 			} else {
-				ret = blk_end_request(req, 0,
+				ret = mmc_queue_end_request(req, 0,
 						brq->data.bytes_xfered);
 			}
 
@@ -2045,7 +2061,7 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 			 * time, so we only reach here after trying to
 			 * read a single sector.
 			 */
-			ret = blk_end_request(req, -EIO,
+			ret = mmc_queue_end_request(req, -EIO,
 						brq->data.blksz);
 			if (!ret)
 				goto start_new_req;
@@ -2089,7 +2105,7 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 		if (mmc_card_removed(card))
 			req->cmd_flags |= REQ_QUIET;
 		while (ret)
-			ret = blk_end_request(req, -EIO,
+			ret = mmc_queue_end_request(req, -EIO,
 					blk_rq_cur_bytes(req));
 	}
 
@@ -2097,7 +2113,7 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 	if (rqc) {
 		if (mmc_card_removed(card)) {
 			rqc->cmd_flags |= REQ_QUIET;
-			blk_end_request_all(rqc, -EIO);
+			mmc_queue_end_request_all(rqc, -EIO);
 		} else {
 			/*
 			 * If current request is packed, it needs to put back.
@@ -2114,6 +2130,128 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 	return 0;
 }
 
+static enum mmc_issued mmc_blk_cqe_start_req(struct mmc_host *host,
+					     struct mmc_request *mrq)
+{
+	int err;
+
+	mrq->done = mmc_cqe_req_done;
+	mrq->recovery_notifier = mmc_cqe_recovery_notifier;
+
+	err = mmc_cqe_start_req(host, mrq);
+	if (!err)
+		return MMC_REQ_STARTED;
+	if (err == -EBUSY)
+		return MMC_REQ_BUSY;
+	return MMC_REQ_FAILED_TO_START;
+}
+
+/* A cache flush goes to the CQE as a direct command (DCMD) */
+static enum mmc_issued mmc_blk_cqe_issue_flush(struct mmc_queue *mq,
+					       struct request *req)
+{
+	struct mmc_queue_req *mqrq = blk_mq_rq_to_pdu(req);
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct mmc_card *card = mq->card;
+
+	if (!(card->ext_csd.cache_size > 0 && card->ext_csd.cache_ctrl & 1)) {
+		mmc_queue_end_request_all(req, 0);
+		return MMC_REQ_FINISHED;
+	}
+
+	brq->cmd.opcode = MMC_SWITCH;
+	brq->cmd.arg = (MMC_SWITCH_MODE_WRITE_BYTE << 24) |
+		       (EXT_CSD_FLUSH_CACHE << 16) |
+		       (1 << 8) |
+		       EXT_CSD_CMD_SET_NORMAL;
+	brq->cmd.flags = MMC_CMD_AC | MMC_RSP_R1B;
+	brq->cmd.busy_timeout = card->ext_csd.generic_cmd6_time;
+	brq->mrq.cmd = &brq->cmd;
+	brq->mrq.tag = req->tag;
+
+	return mmc_blk_cqe_start_req(card->host, &brq->mrq);
+}
+
+static enum mmc_issued mmc_blk_cqe_issue_rw_rq(struct mmc_queue *mq,
+					       struct request *req)
+{
+	struct mmc_queue_req *mqrq = blk_mq_rq_to_pdu(req);
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = mq->card;
+	bool fua_write = (req->cmd_flags & REQ_FUA) &&
+			 rq_data_dir(req) == WRITE;
+
+	brq->data.blksz = 512;
+	brq->data.blocks = blk_rq_sectors(req);
+	brq->data.blk_addr = blk_rq_pos(req);
+	if (!mmc_card_blockaddr(card))
+		brq->data.blk_addr <<= 9;
+
+	if (rq_data_dir(req) == READ)
+		brq->data.flags = MMC_DATA_READ;
+	else
+		brq->data.flags = MMC_DATA_WRITE;
+
+	/* Forced Unit Access, as a reliable write where the card has those */
+	if (fua_write && (md->flags & MMC_BLK_REL_WR))
+		brq->data.flags |= MMC_DATA_REL_WR;
+	else if (fua_write)
+		brq->data.flags |= MMC_DATA_FORCED_PRG;
+
+	mmc_set_data_timeout(&brq->data, card);
+
+	brq->data.sg = mqrq->sg;
+	brq->data.sg_len = mmc_queue_map_sg(mq, mqrq);
+	mmc_queue_bounce_pre(mqrq);
+
+	brq->mrq.data = &brq->data;
+	brq->mrq.tag = req->tag;
+
+	return mmc_blk_cqe_start_req(card->host, &brq->mrq);
+}
+
+/*
+ * Issue a request to a queue in command queue mode. Reads, writes and
+ * flushes are queued to the CQE and complete asynchronously; anything
+ * that needs legacy commands waits for the CQE to go idle and is done
+ * synchronously.
+ */
+static enum mmc_issued mmc_blk_cqe_issue_rq(struct mmc_queue *mq,
+					    struct request *req)
+{
+	struct mmc_queue_req *mqrq = blk_mq_rq_to_pdu(req);
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_host *host = card->host;
+
+	/* a NULL mrq->host tells the timeout handler it is not on the CQE */
+	memset(&mqrq->brq, 0, sizeof(mqrq->brq));
+
+	if (mmc_blk_part_switch(card, md)) {
+		mmc_queue_end_request_all(req, -EIO);
+		return MMC_REQ_FINISHED;
+	}
+
+	if (req->cmd_flags & REQ_FLUSH && host->caps2 & MMC_CAP2_CQE_DCMD)
+		return mmc_blk_cqe_issue_flush(mq, req);
+
+	if (req->cmd_flags & (REQ_DISCARD | REQ_FLUSH)) {
+		if (host->cqe_ops->cqe_wait_for_idle(host))
+			return MMC_REQ_BUSY;
+
+		if (req->cmd_flags & REQ_FLUSH)
+			mmc_blk_issue_flush(mq, req);
+		else if (req->cmd_flags & REQ_SECURE)
+			mmc_blk_issue_secdiscard_rq(mq, req);
+		else
+			mmc_blk_issue_discard_rq(mq, req);
+		return MMC_REQ_FINISHED;
+	}
+
+	return mmc_blk_cqe_issue_rw_rq(mq, req);
+}
+
 static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 {
 	int ret;
@@ -2123,6 +2261,9 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 	unsigned long flags;
 	unsigned int cmd_flags = req ? req->cmd_flags : 0;
 
+	if (mq->use_cqe)
+		return mmc_blk_cqe_issue_rq(mq, req);
+
 	if (req && !mq->mqrq_prev->req)
 		/* claim host only for the first request */
 		mmc_get_card(card);
@@ -2130,7 +2271,7 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 	ret = mmc_blk_part_switch(card, md);
 	if (ret) {
 		if (req) {
-			blk_end_request_all(req, -EIO);
+			mmc_queue_end_request_all(req, -EIO);
 		}
 		ret = 0;
 		goto out;
@@ -2289,7 +2430,9 @@ static struct mmc_blk_data *mmc_blk_alloc_req(struct mmc_card *card,
 	    (area_type == MMC_BLK_DATA_AREA_MAIN) &&
 	    (md->flags & MMC_BLK_CMD23) &&
 	    card->ext_csd.packed_event_en) {
-		if (!mmc_packed_init(&md->queue, card))
+		/* packing pulls more requests off a legacy queue */
+		if (!mmc_queue_is_mq(&md->queue) &&
+		    !mmc_packed_init(&md->queue, card))
 			md->flags |= MMC_BLK_PACKED_CMD;
 	}
 
@@ -24,12 +24,17 @@
 #define MMC_QUEUE_BOUNCESZ	65536
 
 /*
- * Prepare a MMC request. This just filters out odd stuff.
+ * Tags of the blk-mq queue: as with the thread, one request is executed
+ * by the host while the next one is prepared.
  */
-static int mmc_prep_request(struct request_queue *q, struct request *req)
-{
-	struct mmc_queue *mq = q->queuedata;
+#define MMC_QUEUE_DEPTH		2
+
+static bool mmc_use_blk_mq = IS_ENABLED(CONFIG_MMC_BLOCK_MQ);
+module_param_named(use_blk_mq, mmc_use_blk_mq, bool, 0444);
+MODULE_PARM_DESC(use_blk_mq, "Use blk-mq instead of the mmcqd thread");
 
+static int __mmc_prep_request(struct mmc_queue *mq, struct request *req)
+{
 	/*
 	 * We only like normal block requests and discards.
 	 */
@@ -41,11 +46,23 @@ static int mmc_prep_request(struct request_queue *q, struct request *req)
 	if (mq && (mmc_card_removed(mq->card) || mmc_access_rpmb(mq)))
 		return BLKPREP_KILL;
 
-	req->cmd_flags |= REQ_DONTPREP;
-
 	return BLKPREP_OK;
 }
 
+/*
+ * Prepare a MMC request. This just filters out odd stuff.
+ */
+static int mmc_prep_request(struct request_queue *q, struct request *req)
+{
+	int ret;
+
+	ret = __mmc_prep_request(q->queuedata, req);
+	if (ret == BLKPREP_OK)
+		req->cmd_flags |= REQ_DONTPREP;
+
+	return ret;
+}
+
 static int mmc_queue_thread(void *d)
 {
 	struct mmc_queue *mq = d;
@@ -108,12 +125,28 @@ static int mmc_queue_thread(void *d)
  * on any queue on this host, and attempt to issue it.  This may
  * not be the queue we were asked to process.
  */
+/*
+ * New MMC request arrived when the issuer may be blocked on the previous
+ * request to be complete with no current request fetched: let it return
+ * so the new request gets prepared while the previous one is running.
+ */
+static void mmc_queue_new_request(struct mmc_host *host)
+{
+	struct mmc_context_info *cntx = &host->context_info;
+	unsigned long flags;
+
+	spin_lock_irqsave(&cntx->lock, flags);
+	if (cntx->is_waiting_last_req) {
+		cntx->is_new_req = true;
+		wake_up_interruptible(&cntx->wait);
+	}
+	spin_unlock_irqrestore(&cntx->lock, flags);
+}
+
 static void mmc_request_fn(struct request_queue *q)
 {
 	struct mmc_queue *mq = q->queuedata;
 	struct request *req;
-	unsigned long flags;
-	struct mmc_context_info *cntx;
 
 	if (!mq) {
 		while ((req = blk_fetch_request(q)) != NULL) {
@@ -123,23 +156,393 @@ static void mmc_request_fn(struct request_queue *q)
 		return;
 	}
 
-	cntx = &mq->card->host->context_info;
-	if (!mq->mqrq_cur->req && mq->mqrq_prev->req) {
-		/*
-		 * New MMC request arrived when MMC thread may be
-		 * blocked on the previous request to be complete
-		 * with no current request fetched
-		 */
-		spin_lock_irqsave(&cntx->lock, flags);
-		if (cntx->is_waiting_last_req) {
-			cntx->is_new_req = true;
-			wake_up_interruptible(&cntx->wait);
-		}
-		spin_unlock_irqrestore(&cntx->lock, flags);
-	} else if (!mq->mqrq_cur->req && !mq->mqrq_prev->req)
+	if (!mq->mqrq_cur->req && mq->mqrq_prev->req)
+		mmc_queue_new_request(mq->card->host);
+	else if (!mq->mqrq_cur->req && !mq->mqrq_prev->req)
 		wake_up_process(mq->thread);
 }
 
+/*
+ * Finish the request left running by the last ->queue_rq(), unless a new
+ * request arrives meanwhile and takes over. Called with issue_mutex held.
+ */
+static void mmc_mq_complete_prev(struct mmc_queue *mq)
+{
+	if (!mq->mqrq_prev->req)
+		return;
+
+	mq->issue_fn(mq, NULL);
+	if (mq->flags & MMC_QUEUE_NEW_REQUEST) {
+		mq->flags &= ~MMC_QUEUE_NEW_REQUEST;
+		return;
+	}
+
+	mq->mqrq_prev->brq.mrq.data = NULL;
+	mq->mqrq_prev->req = NULL;
+	swap(mq->mqrq_prev, mq->mqrq_cur);
+}
+
+static void mmc_mq_complete_work(struct work_struct *work)
+{
+	struct mmc_queue *mq = container_of(work, struct mmc_queue,
+					    complete_work);
+
+	mutex_lock(&mq->issue_mutex);
+	mmc_mq_complete_prev(mq);
+	mutex_unlock(&mq->issue_mutex);
+}
+
+/*
+ * blk-mq ->poll. Finish the request left running from the polling task,
+ * rather than through the host interrupt and then the completion work.
+ */
+static int mmc_mq_poll(struct blk_mq_hw_ctx *hctx, unsigned int tag)
+{
+	struct mmc_queue *mq = hctx->queue->queuedata;
+	struct mmc_card *card = mq ? READ_ONCE(mq->card) : NULL;
+	struct mmc_host *host;
+	struct request *req;
+	int ret = 0;
+
+	if (!card)
+		return -ENODEV;
+
+	host = card->host;
+	if (!host->context_info.is_done_rcv && host->ops->poll)
+		host->ops->poll(host);
+	if (!host->context_info.is_done_rcv)
+		return 0;
+
+	/* a submitter or the completion work already has it in hand */
+	if (!mutex_trylock(&mq->issue_mutex))
+		return 0;
+
+	req = mq->mqrq_prev->req;
+	if (req && req->tag == tag) {
+		/* completing may sleep, the poller is woken up anyway */
+		__set_current_state(TASK_RUNNING);
+		mmc_mq_complete_prev(mq);
+		ret = 1;
+	}
+	mutex_unlock(&mq->issue_mutex);
+
+	return ret;
+}
+
+/*
+ * blk-mq request handler. The queue is BLK_MQ_F_BLOCKING, so this runs
+ * either from kblockd or, for sync IO, straight from the submitter, and
+ * issues to the host in that context instead of waking up a thread.
+ */
+static int mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
+			   const struct blk_mq_queue_data *bd)
+{
+	struct request *req = bd->rq;
+	struct mmc_queue *mq = req->q->queuedata;
+	struct mmc_queue_req *mqrq = blk_mq_rq_to_pdu(req);
+	unsigned int cmd_flags = req->cmd_flags;
+	int ret = BLK_MQ_RQ_QUEUE_OK;
+	struct mmc_card *card;
+
+	if (!mq) {
+		req->cmd_flags |= REQ_QUIET;
+		return BLK_MQ_RQ_QUEUE_ERROR;
+	}
+
+	card = READ_ONCE(mq->card);
+	if (card && mq->mqrq_prev->req)
+		mmc_queue_new_request(card->host);
+
+	mutex_lock(&mq->issue_mutex);
+
+	if (!mq->card) {
+		req->cmd_flags |= REQ_QUIET;
+		ret = BLK_MQ_RQ_QUEUE_ERROR;
+		goto out;
+	}
+
+	if (mq->flags & MMC_QUEUE_SUSPENDED) {
+		ret = BLK_MQ_RQ_QUEUE_BUSY;
+		goto out;
+	}
+
+	if (__mmc_prep_request(mq, req) != BLKPREP_OK) {
+		ret = BLK_MQ_RQ_QUEUE_ERROR;
+		goto out;
+	}
+
+	blk_mq_start_request(req);
+
+	mq->mqrq_cur = mqrq;
+	mqrq->req = req;
+	mq->issue_fn(mq, req);
+
+	/* same bookkeeping as mmc_queue_thread() */
+	if (cmd_flags & MMC_REQ_SPECIAL_MASK)
+		mq->mqrq_cur->req = NULL;
+
+	mq->mqrq_prev->brq.mrq.data = NULL;
+	mq->mqrq_prev->req = NULL;
+	swap(mq->mqrq_prev, mq->mqrq_cur);
+
+out:
+	/* nobody else is going to wait for the request left running */
+	if (mq->mqrq_prev->req)
+		kblockd_schedule_work(&mq->complete_work);
+	mutex_unlock(&mq->issue_mutex);
+
+	return ret;
+}
+
+/*
+ * Command queue engine (CQE) support. The requests are issued to the host
+ * asynchronously, up to the queue depth of the card, and complete from
+ * the host interrupt through mmc_cqe_req_done(). The host stays claimed
+ * for as long as any of them is in flight.
+ */
+#define MMC_CQE_RETRIES		2
+
+static void mmc_cqe_schedule_recovery(struct mmc_queue *mq)
+{
+	if (test_and_set_bit(MMC_CQE_RECOVERY_NEEDED, &mq->cqe_flags))
+		return;
+
+	blk_mq_stop_hw_queues(mq->queue);
+	wake_up(&mq->cqe_wait);
+	kblockd_schedule_work(&mq->cqe_recovery_work);
+}
+
+void mmc_cqe_recovery_notifier(struct mmc_request *mrq)
+{
+	struct mmc_queue_req *mqrq = container_of(mrq, struct mmc_queue_req,
+						  brq.mrq);
+
+	mmc_cqe_schedule_recovery(mqrq->req->q->queuedata);
+}
+
+void mmc_cqe_req_done(struct mmc_request *mrq)
+{
+	struct mmc_queue_req *mqrq = container_of(mrq, struct mmc_queue_req,
+						  brq.mrq);
+
+	blk_mq_complete_request(mqrq->req, 0);
+}
+
+/* Called with issue_mutex held */
+static void __mmc_cqe_recovery(struct mmc_queue *mq)
+{
+	struct mmc_host *host = mq->card->host;
+
+	if (!test_bit(MMC_CQE_RECOVERY_NEEDED, &mq->cqe_flags))
+		return;
+
+	if (mmc_cqe_recovery(host))
+		pr_err("%s: CQE recovery failed\n", mmc_hostname(host));
+
+	clear_bit(MMC_CQE_RECOVERY_NEEDED, &mq->cqe_flags);
+}
+
+static void mmc_cqe_recovery_work(struct work_struct *work)
+{
+	struct mmc_queue *mq = container_of(work, struct mmc_queue,
+					    cqe_recovery_work);
+
+	mutex_lock(&mq->issue_mutex);
+	if (mq->card)
+		__mmc_cqe_recovery(mq);
+	if (!atomic_read(&mq->cqe_in_flight))
+		kblockd_schedule_work(&mq->complete_work);
+	mutex_unlock(&mq->issue_mutex);
+
+	blk_mq_start_stopped_hw_queues(mq->queue, true);
+	blk_mq_kick_requeue_list(mq->queue);
+}
+
+/* Give the host back once the last request in flight has completed */
+static void mmc_cqe_release_work(struct work_struct *work)
+{
+	struct mmc_queue *mq = container_of(work, struct mmc_queue,
+					    complete_work);
+
+	mutex_lock(&mq->issue_mutex);
+	if (mq->cqe_claimed && !atomic_read(&mq->cqe_in_flight) &&
+	    !test_bit(MMC_CQE_RECOVERY_NEEDED, &mq->cqe_flags)) {
+		mmc_put_card(mq->card);
+		mq->cqe_claimed = false;
+	}
+	mutex_unlock(&mq->issue_mutex);
+}
+
+static int mmc_cqe_queue_rq(struct blk_mq_hw_ctx *hctx,
+			    const struct blk_mq_queue_data *bd)
+{
+	struct request *req = bd->rq;
+	struct mmc_queue *mq = req->q->queuedata;
+	struct mmc_queue_req *mqrq = blk_mq_rq_to_pdu(req);
+	int ret = BLK_MQ_RQ_QUEUE_OK;
+	enum mmc_issued issued;
+
+	if (!mq) {
+		req->cmd_flags |= REQ_QUIET;
+		return BLK_MQ_RQ_QUEUE_ERROR;
+	}
+
+	mutex_lock(&mq->issue_mutex);
+
+	if (!mq->card) {
+		req->cmd_flags |= REQ_QUIET;
+		ret = BLK_MQ_RQ_QUEUE_ERROR;
+		goto out;
+	}
+
+	/* restarted by mmc_queue_resume() or the recovery work */
+	if ((mq->flags & MMC_QUEUE_SUSPENDED) ||
+	    test_bit(MMC_CQE_RECOVERY_NEEDED, &mq->cqe_flags)) {
+		blk_mq_stop_hw_queue(hctx);
+		ret = BLK_MQ_RQ_QUEUE_BUSY;
+		goto out;
+	}
+
+	if (__mmc_prep_request(mq, req) != BLKPREP_OK) {
+		ret = BLK_MQ_RQ_QUEUE_ERROR;
+		goto out;
+	}
+
+	if (!mq->cqe_claimed) {
+		mmc_get_card(mq->card);
+		mq->cqe_claimed = true;
+	}
+
+	blk_mq_start_request(req);
+
+	mqrq->req = req;
+	atomic_inc(&mq->cqe_in_flight);
+	issued = mq->issue_fn(mq, req);
+	if (issued == MMC_REQ_STARTED)
+		goto out;
+
+	if (issued == MMC_REQ_BUSY) {
+		blk_mq_stop_hw_queue(hctx);
+		ret = BLK_MQ_RQ_QUEUE_BUSY;
+	} else if (issued == MMC_REQ_FAILED_TO_START) {
+		ret = BLK_MQ_RQ_QUEUE_ERROR;
+	}
+	if (atomic_dec_and_test(&mq->cqe_in_flight))
+		kblockd_schedule_work(&mq->complete_work);
+
+out:
+	mutex_unlock(&mq->issue_mutex);
+
+	return ret;
+}
+
+/* blk-mq ->complete, may run from the host interrupt handler */
+static void mmc_cqe_complete_rq(struct request *req)
+{
+	struct mmc_queue_req *mqrq = blk_mq_rq_to_pdu(req);
+	struct mmc_request *mrq = &mqrq->brq.mrq;
+	struct mmc_queue *mq = req->q->queuedata;
+	bool requeue = false;
+	int err = 0;
+
+	mmc_cqe_post_req(mrq->host, mrq);
+	if (mrq->data)
+		mmc_queue_bounce_post(mqrq);
+
+	if (mrq->cmd && mrq->cmd->error)
+		err = mrq->cmd->error;
+	else if (mrq->data && mrq->data->error)
+		err = mrq->data->error;
+
+	if (err) {
+		if (mqrq->retries++ < MMC_CQE_RETRIES) {
+			requeue = true;
+		} else {
+			mqrq->retries = 0;
+			blk_mq_end_request(req, -EIO);
+		}
+	} else if (mrq->data) {
+		if (blk_update_request(req, 0, mrq->data->bytes_xfered)) {
+			requeue = true;
+		} else {
+			mqrq->retries = 0;
+			__blk_mq_end_request(req, 0);
+		}
+	} else {
+		mqrq->retries = 0;
+		blk_mq_end_request(req, 0);
+	}
+
+	if (requeue) {
+		blk_mq_requeue_request(req);
+		blk_mq_kick_requeue_list(req->q);
+	}
+
+	if (atomic_dec_and_test(&mq->cqe_in_flight)) {
+		wake_up(&mq->cqe_wait);
+		kblockd_schedule_work(&mq->complete_work);
+	}
+}
+
+static enum blk_eh_timer_return mmc_cqe_timed_out(struct request *req,
+						  bool reserved)
+{
+	struct mmc_queue_req *mqrq = blk_mq_rq_to_pdu(req);
+	struct mmc_request *mrq = &mqrq->brq.mrq;
+	struct mmc_host *host = mrq->host;
+	bool recovery_needed = false;
+
+	/* not issued to the CQE, e.g. a discard waited on synchronously */
+	if (!host)
+		return BLK_EH_RESET_TIMER;
+
+	/*
+	 * blk-mq marked the request complete before calling us, so a
+	 * completion that raced with the timeout was dropped: finish it here.
+	 */
+	if (!host->cqe_ops->cqe_timeout(host, mrq, &recovery_needed))
+		return BLK_EH_HANDLED;
+
+	if (recovery_needed)
+		mmc_cqe_schedule_recovery(req->q->queuedata);
+
+	return BLK_EH_RESET_TIMER;
+}
+
+/*
+ * Wait for all requests in flight, recovering the CQE on the way if an
+ * error gets in between, then give the host back. Called with issue_mutex
+ * held, so no new request is issued meanwhile.
+ */
+static void mmc_cqe_quiesce(struct mmc_queue *mq)
+{
+	struct mmc_host *host = mq->card->host;
+
+	while (atomic_read(&mq->cqe_in_flight) ||
+	       test_bit(MMC_CQE_RECOVERY_NEEDED, &mq->cqe_flags)) {
+		if (test_bit(MMC_CQE_RECOVERY_NEEDED, &mq->cqe_flags)) {
+			__mmc_cqe_recovery(mq);
+			continue;
+		}
+
+		/* -EBUSY means the CQE halted, recovery is on the way */
+		if (host->cqe_ops->cqe_wait_for_idle(host))
+			wait_event(mq->cqe_wait,
+				   test_bit(MMC_CQE_RECOVERY_NEEDED,
+					    &mq->cqe_flags));
+		else
+			wait_event(mq->cqe_wait,
+				   !atomic_read(&mq->cqe_in_flight) ||
+				   test_bit(MMC_CQE_RECOVERY_NEEDED,
+					    &mq->cqe_flags));
+	}
+
+	if (mq->cqe_claimed) {
+		mmc_put_card(mq->card);
+		mq->cqe_claimed = false;
+	}
+}
+
 static struct scatterlist *mmc_alloc_sg(int sg_len, int *err)
 {
 	struct scatterlist *sg;
@@ -176,6 +579,210 @@ static void mmc_queue_setup_discard(struct request_queue *q,
 		queue_flag_set_unlocked(QUEUE_FLAG_SECDISCARD, q);
 }
 
+static unsigned int mmc_queue_calc_bouncesz(struct mmc_host *host)
+{
+	unsigned int bouncesz = 0;
+
+#ifdef CONFIG_MMC_BLOCK_BOUNCE
+	if (host->max_segs == 1) {
+		bouncesz = MMC_QUEUE_BOUNCESZ;
+
+		if (bouncesz > host->max_req_size)
+			bouncesz = host->max_req_size;
+		if (bouncesz > host->max_seg_size)
+			bouncesz = host->max_seg_size;
+		if (bouncesz > (host->max_blk_count * 512))
+			bouncesz = host->max_blk_count * 512;
+
+		if (bouncesz <= 512)
+			bouncesz = 0;
+	}
+#endif
+
+	return bouncesz;
+}
+
+static void mmc_queue_setup_limits(struct mmc_queue *mq,
+				   struct mmc_host *host,
+				   unsigned int bouncesz)
+{
+	u64 limit = BLK_BOUNCE_HIGH;
+
+	if (bouncesz) {
+		blk_queue_bounce_limit(mq->queue, BLK_BOUNCE_ANY);
+		blk_queue_max_hw_sectors(mq->queue, bouncesz / 512);
+		blk_queue_max_segments(mq->queue, bouncesz / 512);
+		blk_queue_max_segment_size(mq->queue, bouncesz);
+		return;
+	}
+
+	if (mmc_dev(host)->dma_mask && *mmc_dev(host)->dma_mask)
+		limit = (u64)dma_max_pfn(mmc_dev(host)) << PAGE_SHIFT;
+
+	blk_queue_bounce_limit(mq->queue, limit);
+	blk_queue_max_hw_sectors(mq->queue,
+		min(host->max_blk_count, host->max_req_size / 512));
+	blk_queue_max_segments(mq->queue, host->max_segs);
+	blk_queue_max_segment_size(mq->queue, host->max_seg_size);
+}
+
+static void mmc_queue_setup(struct mmc_queue *mq, struct mmc_card *card)
+{
+	mq->queue->queuedata = mq;
+
+	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, mq->queue);
+	queue_flag_clear_unlocked(QUEUE_FLAG_ADD_RANDOM, mq->queue);
+	if (mmc_can_erase(card))
+		mmc_queue_setup_discard(mq->queue, card);
+}
+
+static void mmc_queue_req_free_bufs(struct mmc_queue_req *mqrq)
+{
+	kfree(mqrq->bounce_sg);
+	mqrq->bounce_sg = NULL;
+
+	kfree(mqrq->sg);
+	mqrq->sg = NULL;
+
+	kfree(mqrq->bounce_buf);
+	mqrq->bounce_buf = NULL;
+}
+
+static int mmc_mq_init_request(void *data, struct request *req,
+			       unsigned int hctx_idx, unsigned int request_idx,
+			       unsigned int numa_node)
+{
+	struct mmc_queue_req *mqrq = blk_mq_rq_to_pdu(req);
+	struct mmc_queue *mq = data;
+	int ret;
+
+	memset(mqrq, 0, sizeof(*mqrq));
+
+	if (!mq->bouncesz) {
+		mqrq->sg = mmc_alloc_sg(mq->card->host->max_segs, &ret);
+		return ret;
+	}
+
+	mqrq->bounce_buf = kmalloc(mq->bouncesz, GFP_KERNEL);
+	if (!mqrq->bounce_buf)
+		return -ENOMEM;
+
+	mqrq->sg = mmc_alloc_sg(1, &ret);
+	if (!ret)
+		mqrq->bounce_sg = mmc_alloc_sg(mq->bouncesz / 512, &ret);
+	if (ret)
+		mmc_queue_req_free_bufs(mqrq);
+
+	return ret;
+}
+
+static void mmc_mq_exit_request(void *data, struct request *req,
+				unsigned int hctx_idx, unsigned int request_idx)
+{
+	mmc_queue_req_free_bufs(blk_mq_rq_to_pdu(req));
+}
+
+static struct blk_mq_ops mmc_mq_ops = {
+	.queue_rq	= mmc_mq_queue_rq,
+	.map_queue	= blk_mq_map_queue,
+	.init_request	= mmc_mq_init_request,
+	.exit_request	= mmc_mq_exit_request,
+	.poll		= mmc_mq_poll,
+};
+
+static struct blk_mq_ops mmc_cqe_mq_ops = {
+	.queue_rq	= mmc_cqe_queue_rq,
+	.map_queue	= blk_mq_map_queue,
+	.init_request	= mmc_mq_init_request,
+	.exit_request	= mmc_mq_exit_request,
+	.complete	= mmc_cqe_complete_rq,
+	.timeout	= mmc_cqe_timed_out,
+};
+
+/*
+ * One hardware queue per host partition, dispatching from the submitter
+ * where blk-mq allows it. Each tag carries its own mmc_queue_req, so the
+ * request pipeline no longer needs the mqrq[] pair of the thread.
+ */
+static int mmc_mq_init_queue(struct mmc_queue *mq, struct mmc_card *card)
+{
+	struct mmc_host *host = card->host;
+	int ret;
+
+	mq->card = card;
+	mq->bouncesz = mmc_queue_calc_bouncesz(host);
+
+	/* idle slots, so there is always a cur and a prev to look at */
+	mq->mqrq_cur = &mq->mqrq[0];
+	mq->mqrq_prev = &mq->mqrq[1];
+	mutex_init(&mq->issue_mutex);
+
+	memset(&mq->tag_set, 0, sizeof(mq->tag_set));
+	mq->use_cqe = host->cqe_enabled;
+	if (mq->use_cqe) {
+		INIT_WORK(&mq->complete_work, mmc_cqe_release_work);
+		INIT_WORK(&mq->cqe_recovery_work, mmc_cqe_recovery_work);
+		init_waitqueue_head(&mq->cqe_wait);
+		atomic_set(&mq->cqe_in_flight, 0);
+		mq->tag_set.ops = &mmc_cqe_mq_ops;
+		mq->tag_set.queue_depth = min_t(unsigned int,
+						card->ext_csd.cmdq_depth,
+						host->cqe_qdepth);
+	} else {
+		INIT_WORK(&mq->complete_work, mmc_mq_complete_work);
+		mq->tag_set.ops = &mmc_mq_ops;
+		mq->tag_set.queue_depth = MMC_QUEUE_DEPTH;
+	}
+	mq->tag_set.nr_hw_queues = 1;
+	mq->tag_set.numa_node = NUMA_NO_NODE;
+	mq->tag_set.cmd_size = sizeof(struct mmc_queue_req);
+	mq->tag_set.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_BLOCKING;
+	mq->tag_set.driver_data = mq;
+
+	ret = blk_mq_alloc_tag_set(&mq->tag_set);
+	if (ret)
+		return ret;
+
+	mq->queue = blk_mq_init_queue(&mq->tag_set);
+	if (IS_ERR(mq->queue)) {
+		ret = PTR_ERR(mq->queue);
+		goto free_tag_set;
+	}
+
+	mmc_queue_setup(mq, card);
+	mmc_queue_setup_limits(mq, host, mq->bouncesz);
+
+	/*
+	 * Command queue completions all come from the one host interrupt,
+	 * run them in a batch rather than an IPI each.
+	 */
+	if (mq->use_cqe)
+		queue_flag_set_unlocked(QUEUE_FLAG_COMP_BATCH, mq->queue);
+
+	return 0;
+
+ free_tag_set:
+	blk_mq_free_tag_set(&mq->tag_set);
+	return ret;
+}
+
+/*
+ * Wait for the request left running on the host. Called with issue_mutex
+ * held, so no new request can start meanwhile, but one may still cut the
+ * wait short through mmc_queue_new_request() before it blocks on the
+ * mutex, hence the loop.
+ */
+static void mmc_mq_quiesce(struct mmc_queue *mq)
+{
+	if (mq->use_cqe) {
+		mmc_cqe_quiesce(mq);
+		return;
+	}
+
+	while (mq->mqrq_prev->req)
+		mmc_mq_complete_prev(mq);
+}
+
 /**
  * mmc_init_queue - initialise a queue structure.
  * @mq: mmc queue
@@ -189,13 +796,14 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 		   spinlock_t *lock, const char *subname)
 {
 	struct mmc_host *host = card->host;
-	u64 limit = BLK_BOUNCE_HIGH;
+	unsigned int bouncesz;
 	int ret;
 	struct mmc_queue_req *mqrq_cur = &mq->mqrq[0];
 	struct mmc_queue_req *mqrq_prev = &mq->mqrq[1];
 
-	if (mmc_dev(host)->dma_mask && *mmc_dev(host)->dma_mask)
-		limit = (u64)dma_max_pfn(mmc_dev(host)) << PAGE_SHIFT;
+	/* a card in command queue mode only takes requests through the CQE */
+	if (mmc_use_blk_mq || host->cqe_enabled)
+		return mmc_mq_init_queue(mq, card);
 
 	mq->card = card;
 	mq->queue = blk_init_queue(mmc_request_fn, lock);
@@ -204,78 +812,52 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 
 	mq->mqrq_cur = mqrq_cur;
 	mq->mqrq_prev = mqrq_prev;
-	mq->queue->queuedata = mq;
 
 	blk_queue_prep_rq(mq->queue, mmc_prep_request);
-	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, mq->queue);
-	queue_flag_clear_unlocked(QUEUE_FLAG_ADD_RANDOM, mq->queue);
-	if (mmc_can_erase(card))
-		mmc_queue_setup_discard(mq->queue, card);
-
-#ifdef CONFIG_MMC_BLOCK_BOUNCE
-	if (host->max_segs == 1) {
-		unsigned int bouncesz;
-
-		bouncesz = MMC_QUEUE_BOUNCESZ;
-
-		if (bouncesz > host->max_req_size)
-			bouncesz = host->max_req_size;
-		if (bouncesz > host->max_seg_size)
-			bouncesz = host->max_seg_size;
-		if (bouncesz > (host->max_blk_count * 512))
-			bouncesz = host->max_blk_count * 512;
-
-		if (bouncesz > 512) {
-			mqrq_cur->bounce_buf = kmalloc(bouncesz, GFP_KERNEL);
-			if (!mqrq_cur->bounce_buf) {
-				pr_warn("%s: unable to allocate bounce cur buffer\n",
+	mmc_queue_setup(mq, card);
+
+	bouncesz = mmc_queue_calc_bouncesz(host);
+	if (bouncesz) {
+		mqrq_cur->bounce_buf = kmalloc(bouncesz, GFP_KERNEL);
+		if (!mqrq_cur->bounce_buf) {
+			pr_warn("%s: unable to allocate bounce cur buffer\n",
+				mmc_card_name(card));
+		} else {
+			mqrq_prev->bounce_buf =
+					kmalloc(bouncesz, GFP_KERNEL);
+			if (!mqrq_prev->bounce_buf) {
+				pr_warn("%s: unable to allocate bounce prev buffer\n",
 					mmc_card_name(card));
-			} else {
-				mqrq_prev->bounce_buf =
-						kmalloc(bouncesz, GFP_KERNEL);
-				if (!mqrq_prev->bounce_buf) {
-					pr_warn("%s: unable to allocate bounce prev buffer\n",
-						mmc_card_name(card));
-					kfree(mqrq_cur->bounce_buf);
-					mqrq_cur->bounce_buf = NULL;
-				}
+				kfree(mqrq_cur->bounce_buf);
+				mqrq_cur->bounce_buf = NULL;
 			}
 		}
 
-		if (mqrq_cur->bounce_buf && mqrq_prev->bounce_buf) {
-			blk_queue_bounce_limit(mq->queue, BLK_BOUNCE_ANY);
-			blk_queue_max_hw_sectors(mq->queue, bouncesz / 512);
-			blk_queue_max_segments(mq->queue, bouncesz / 512);
-			blk_queue_max_segment_size(mq->queue, bouncesz);
-
-			mqrq_cur->sg = mmc_alloc_sg(1, &ret);
-			if (ret)
-				goto cleanup_queue;
-
-			mqrq_cur->bounce_sg =
-				mmc_alloc_sg(bouncesz / 512, &ret);
-			if (ret)
-				goto cleanup_queue;
-
-			mqrq_prev->sg = mmc_alloc_sg(1, &ret);
-			if (ret)
-				goto cleanup_queue;
-
-			mqrq_prev->bounce_sg =
-				mmc_alloc_sg(bouncesz / 512, &ret);
-			if (ret)
-				goto cleanup_queue;
-		}
+		if (!mqrq_cur->bounce_buf || !mqrq_prev->bounce_buf)
+			bouncesz = 0;
 	}
-#endif
 
-	if (!mqrq_cur->bounce_buf && !mqrq_prev->bounce_buf) {
-		blk_queue_bounce_limit(mq->queue, limit);
-		blk_queue_max_hw_sectors(mq->queue,
-			min(host->max_blk_count, host->max_req_size / 512));
-		blk_queue_max_segments(mq->queue, host->max_segs);
-		blk_queue_max_segment_size(mq->queue, host->max_seg_size);
+	mmc_queue_setup_limits(mq, host, bouncesz);
+
+	if (bouncesz) {
+		mqrq_cur->sg = mmc_alloc_sg(1, &ret);
+		if (ret)
+			goto cleanup_queue;
+
+		mqrq_cur->bounce_sg =
+			mmc_alloc_sg(bouncesz / 512, &ret);
+		if (ret)
+			goto cleanup_queue;
+
+		mqrq_prev->sg = mmc_alloc_sg(1, &ret);
+		if (ret)
+			goto cleanup_queue;
 
+		mqrq_prev->bounce_sg =
+			mmc_alloc_sg(bouncesz / 512, &ret);
+		if (ret)
+			goto cleanup_queue;
+	} else {
 		mqrq_cur->sg = mmc_alloc_sg(host->max_segs, &ret);
 		if (ret)
 			goto cleanup_queue;
@@ -293,26 +875,14 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 
 	if (IS_ERR(mq->thread)) {
 		ret = PTR_ERR(mq->thread);
-		goto free_bounce_sg;
+		goto cleanup_queue;
 	}
 
 	return 0;
- free_bounce_sg:
-	kfree(mqrq_cur->bounce_sg);
-	mqrq_cur->bounce_sg = NULL;
-	kfree(mqrq_prev->bounce_sg);
-	mqrq_prev->bounce_sg = NULL;
 
  cleanup_queue:
-	kfree(mqrq_cur->sg);
-	mqrq_cur->sg = NULL;
-	kfree(mqrq_cur->bounce_buf);
-	mqrq_cur->bounce_buf = NULL;
-
-	kfree(mqrq_prev->sg);
-	mqrq_prev->sg = NULL;
-	kfree(mqrq_prev->bounce_buf);
-	mqrq_prev->bounce_buf = NULL;
+	mmc_queue_req_free_bufs(mqrq_cur);
+	mmc_queue_req_free_bufs(mqrq_prev);
 
 	blk_cleanup_queue(mq->queue);
 	return ret;
@@ -328,6 +898,21 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	/* Make sure the queue isn't suspended, as that will deadlock */
 	mmc_queue_resume(mq);
 
+	if (mmc_queue_is_mq(mq)) {
+		/* Fail whatever comes in from now on */
+		mutex_lock(&mq->issue_mutex);
+		mmc_mq_quiesce(mq);
+		q->queuedata = NULL;
+		mq->card = NULL;
+		mutex_unlock(&mq->issue_mutex);
+		if (mq->use_cqe)
+			cancel_work_sync(&mq->cqe_recovery_work);
+		cancel_work_sync(&mq->complete_work);
+		blk_mq_start_stopped_hw_queues(q, true);
+		/* the buffers go with the tag set, see mmc_queue_free() */
+		return;
+	}
+
 	/* Then terminate our worker thread */
 	kthread_stop(mq->thread);
 
@@ -337,28 +922,28 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	blk_start_queue(q);
 	spin_unlock_irqrestore(q->queue_lock, flags);
 
-	kfree(mqrq_cur->bounce_sg);
-	mqrq_cur->bounce_sg = NULL;
-
-	kfree(mqrq_cur->sg);
-	mqrq_cur->sg = NULL;
-
-	kfree(mqrq_cur->bounce_buf);
-	mqrq_cur->bounce_buf = NULL;
-
-	kfree(mqrq_prev->bounce_sg);
-	mqrq_prev->bounce_sg = NULL;
-
-	kfree(mqrq_prev->sg);
-	mqrq_prev->sg = NULL;
-
-	kfree(mqrq_prev->bounce_buf);
-	mqrq_prev->bounce_buf = NULL;
+	mmc_queue_req_free_bufs(mqrq_cur);
+	mmc_queue_req_free_bufs(mqrq_prev);
 
 	mq->card = NULL;
 }
 EXPORT_SYMBOL(mmc_cleanup_queue);
 
+/**
+ * mmc_queue_free - release the request queue of a MMC queue
+ * @mq: MMC queue, cleaned up by mmc_cleanup_queue() before
+ *
+ * Called once the last user of the disk is gone.
+ */
+void mmc_queue_free(struct mmc_queue *mq)
+{
+	bool is_mq = mmc_queue_is_mq(mq);
+
+	blk_cleanup_queue(mq->queue);
+	if (is_mq)
+		blk_mq_free_tag_set(&mq->tag_set);
+}
+
 int mmc_packed_init(struct mmc_queue *mq, struct mmc_card *card)
 {
 	struct mmc_queue_req *mqrq_cur = &mq->mqrq[0];
@@ -415,6 +1000,21 @@ void mmc_queue_suspend(struct mmc_queue *mq)
 	struct request_queue *q = mq->queue;
 	unsigned long flags;
 
+	if (mmc_queue_is_mq(mq)) {
+		if (mq->flags & MMC_QUEUE_SUSPENDED)
+			return;
+
+		blk_mq_stop_hw_queues(q);
+		mutex_lock(&mq->issue_mutex);
+		mq->flags |= MMC_QUEUE_SUSPENDED;
+		mmc_mq_quiesce(mq);
+		mutex_unlock(&mq->issue_mutex);
+		if (mq->use_cqe)
+			cancel_work_sync(&mq->cqe_recovery_work);
+		cancel_work_sync(&mq->complete_work);
+		return;
+	}
+
 	if (!(mq->flags & MMC_QUEUE_SUSPENDED)) {
 		mq->flags |= MMC_QUEUE_SUSPENDED;
 
@@ -435,6 +1035,17 @@ void mmc_queue_resume(struct mmc_queue *mq)
 	struct request_queue *q = mq->queue;
 	unsigned long flags;
 
+	if (mmc_queue_is_mq(mq)) {
+		if (!(mq->flags & MMC_QUEUE_SUSPENDED))
+			return;
+
+		mutex_lock(&mq->issue_mutex);
+		mq->flags &= ~MMC_QUEUE_SUSPENDED;
+		mutex_unlock(&mq->issue_mutex);
+		blk_mq_start_stopped_hw_queues(q, true);
+		return;
+	}
+
 	if (mq->flags & MMC_QUEUE_SUSPENDED) {
 		mq->flags &= ~MMC_QUEUE_SUSPENDED;
 
@@ -552,3 +1163,28 @@ void mmc_queue_bounce_post(struct mmc_queue_req *mqrq)
 	sg_copy_from_buffer(mqrq->bounce_sg, mqrq->bounce_sg_len,
 		mqrq->bounce_buf, mqrq->sg[0].length);
 }
+
+/*
+ * Complete @nr_bytes of @req, the blk-mq counterpart of blk_end_request().
+ * Returns true if the request still has bytes left.
+ */
+bool mmc_queue_end_request(struct request *req, int error,
+			   unsigned int nr_bytes)
+{
+	if (!req->q->mq_ops)
+		return blk_end_request(req, error, nr_bytes);
+
+	if (blk_update_request(req, error, nr_bytes))
+		return true;
+
+	__blk_mq_end_request(req, error);
+	return false;
+}
+
+void mmc_queue_end_request_all(struct request *req, int error)
+{
+	if (!req->q->mq_ops)
+		blk_end_request_all(req, error);
+	else
+		blk_mq_end_request(req, error);
+}
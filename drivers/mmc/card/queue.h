@@ -1,6 +1,10 @@
 #ifndef MMC_QUEUE_H
 #define MMC_QUEUE_H
 
+#include <linux/blk-mq.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+
 #define MMC_REQ_SPECIAL_MASK	(REQ_DISCARD | REQ_FLUSH)
 
 struct request;
@@ -42,6 +46,15 @@ struct mmc_queue_req {
 	struct mmc_async_req	mmc_active;
 	enum mmc_packed_type	cmd_type;
 	struct mmc_packed	*packed;
+	int			retries;	/* CQE only */
+};
+
+/* What mmc_blk_issue_rq() did with a request for a CQE queue */
+enum mmc_issued {
+	MMC_REQ_STARTED,
+	MMC_REQ_BUSY,
+	MMC_REQ_FAILED_TO_START,
+	MMC_REQ_FINISHED,
 };
 
 struct mmc_queue {
@@ -58,11 +71,38 @@ struct mmc_queue {
 	struct mmc_queue_req	mqrq[2];
 	struct mmc_queue_req	*mqrq_cur;
 	struct mmc_queue_req	*mqrq_prev;
+
+	/*
+	 * blk-mq only: mqrq_cur/mqrq_prev point to the mmc_queue_req of
+	 * the tag, mqrq[] just seeds them with idle slots.
+	 */
+	struct blk_mq_tag_set	tag_set;
+	struct mutex		issue_mutex;	/* serializes ->issue_fn() */
+	struct work_struct	complete_work;	/* completes mqrq_prev */
+	unsigned int		bouncesz;
+
+	/*
+	 * CQE only: the host stays claimed while requests are in flight,
+	 * complete_work releases it once the last one completes.
+	 */
+	bool			use_cqe;
+	bool			cqe_claimed;
+	unsigned long		cqe_flags;
+#define MMC_CQE_RECOVERY_NEEDED	0
+	atomic_t		cqe_in_flight;
+	wait_queue_head_t	cqe_wait;
+	struct work_struct	cqe_recovery_work;
 };
 
+static inline bool mmc_queue_is_mq(struct mmc_queue *mq)
+{
+	return mq->queue->mq_ops;
+}
+
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *, spinlock_t *,
 			  const char *);
 extern void mmc_cleanup_queue(struct mmc_queue *);
+extern void mmc_queue_free(struct mmc_queue *);
 extern void mmc_queue_suspend(struct mmc_queue *);
 extern void mmc_queue_resume(struct mmc_queue *);
 
@@ -71,6 +111,12 @@ extern unsigned int mmc_queue_map_sg(struct mmc_queue *,
 extern void mmc_queue_bounce_pre(struct mmc_queue_req *);
 extern void mmc_queue_bounce_post(struct mmc_queue_req *);
 
+extern bool mmc_queue_end_request(struct request *, int, unsigned int);
+extern void mmc_queue_end_request_all(struct request *, int);
+
+extern void mmc_cqe_req_done(struct mmc_request *);
+extern void mmc_cqe_recovery_notifier(struct mmc_request *);
+
 extern int mmc_packed_init(struct mmc_queue *, struct mmc_card *);
 extern void mmc_packed_clean(struct mmc_queue *);
 
@@ -54,6 +54,7 @@
  * operations the card has to perform.
  */
 #define MMC_BKOPS_MAX_TIMEOUT	(4 * 60 * 1000) /* max time to wait in ms */
+#define MMC_CQE_RECOVERY_TIMEOUT 1000	/* busy timeout of recovery cmds in ms */
 
 static struct workqueue_struct *workqueue;
 static const unsigned freqs[] = { 400000, 300000, 200000, 100000 };
@@ -221,6 +222,10 @@ static void __mmc_start_request(struct mmc_host *host, struct mmc_request *mrq)
 		}
 	}
 
+	/* The CQE has to be off before non-CQ commands can be issued */
+	if (host->cqe_on)
+		host->cqe_ops->cqe_off(host);
+
 	host->ops->request(host, mrq);
 }
 
@@ -750,6 +755,140 @@ int mmc_wait_for_cmd(struct mmc_host *host, struct mmc_command *cmd, int retries
 
 EXPORT_SYMBOL(mmc_wait_for_cmd);
 
+/**
+ *	mmc_cqe_start_req - start a CQE request
+ *	@host: MMC host to start the request
+ *	@mrq: request to start
+ *
+ *	Start the request, re-tuning if needed and it is possible. Returns an
+ *	error code if the request fails to start or -EBUSY if CQE is busy.
+ *	The request completes through mmc_cqe_request_done() calling
+ *	@mrq->done.
+ */
+int mmc_cqe_start_req(struct mmc_host *host, struct mmc_request *mrq)
+{
+	int err;
+
+	/*
+	 * CQE cannot process re-tuning commands. The engine is only off
+	 * when it has no tasks, so that is the time it can be done.
+	 */
+	if (!host->cqe_on) {
+		mmc_retune_hold(host);
+		err = mmc_retune(host);
+		mmc_retune_release(host);
+		if (err)
+			goto out_err;
+	}
+
+	mrq->host = host;
+
+	if (mrq->cmd) {
+		mrq->cmd->error = 0;
+		mrq->cmd->retries = 0;
+		mrq->cmd->mrq = mrq;
+		pr_debug("%s: starting CQE DCMD%u arg %08x flags %08x\n",
+			 mmc_hostname(host), mrq->cmd->opcode, mrq->cmd->arg,
+			 mrq->cmd->flags);
+	}
+
+	if (mrq->data) {
+		mrq->data->error = 0;
+		mrq->data->bytes_xfered = 0;
+		mrq->data->mrq = mrq;
+		pr_debug("%s: starting CQE task %d blk_addr %u blocks %u "
+			 "flags %08x\n", mmc_hostname(host), mrq->tag,
+			 mrq->data->blk_addr, mrq->data->blocks,
+			 mrq->data->flags);
+	}
+
+	err = host->cqe_ops->cqe_request(host, mrq);
+	if (err)
+		goto out_err;
+
+	return 0;
+
+out_err:
+	pr_debug("%s: failed to start CQE request, error %d\n",
+		 mmc_hostname(host), err);
+	return err;
+}
+EXPORT_SYMBOL(mmc_cqe_start_req);
+
+/**
+ *	mmc_cqe_request_done - CQE has finished processing an MMC request
+ *	@host: MMC host which completed request
+ *	@mrq: MMC request which completed
+ *
+ *	CQE drivers should call this function when they have completed
+ *	their processing of a request.
+ */
+void mmc_cqe_request_done(struct mmc_host *host, struct mmc_request *mrq)
+{
+	/* Flag re-tuning needed on CRC errors */
+	if ((mrq->cmd && mrq->cmd->error == -EILSEQ) ||
+	    (mrq->data && mrq->data->error == -EILSEQ))
+		mmc_retune_needed(host);
+
+	pr_debug("%s: CQE req done (task %d): %d %d\n", mmc_hostname(host),
+		 mrq->tag, mrq->cmd ? mrq->cmd->error : 0,
+		 mrq->data ? mrq->data->error : 0);
+
+	mrq->done(mrq);
+}
+EXPORT_SYMBOL(mmc_cqe_request_done);
+
+/**
+ *	mmc_cqe_post_req - CQE post process of a completed MMC request
+ *	@host: MMC host
+ *	@mrq: MMC request to be processed
+ */
+void mmc_cqe_post_req(struct mmc_host *host, struct mmc_request *mrq)
+{
+	if (host->cqe_ops->cqe_post_req)
+		host->cqe_ops->cqe_post_req(host, mrq);
+}
+EXPORT_SYMBOL(mmc_cqe_post_req);
+
+/**
+ *	mmc_cqe_recovery - recover from CQE errors
+ *	@host: MMC host to recover
+ *
+ *	Recovery consists of stopping CQE, stopping eMMC, discarding the queue
+ *	in eMMC, and discarding the queue in CQE. CQE must call
+ *	mmc_cqe_request_done() on all requests. An error is returned if the
+ *	eMMC could not be made to discard its queue; the caller should then
+ *	reset the card.
+ */
+int mmc_cqe_recovery(struct mmc_host *host)
+{
+	struct mmc_command cmd = {0};
+	int err;
+
+	pr_warn("%s: running CQE recovery\n", mmc_hostname(host));
+
+	host->cqe_ops->cqe_recovery_start(host);
+
+	cmd.opcode = MMC_STOP_TRANSMISSION;
+	cmd.flags = MMC_RSP_R1B | MMC_CMD_AC;
+	cmd.flags &= ~MMC_RSP_CRC; /* Ignore CRC */
+	cmd.busy_timeout = MMC_CQE_RECOVERY_TIMEOUT;
+	mmc_wait_for_cmd(host, &cmd, 0);
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.opcode = MMC_CMDQ_TASK_MGMT;
+	cmd.arg = 1; /* Discard entire queue */
+	cmd.flags = MMC_RSP_R1B | MMC_CMD_AC;
+	cmd.flags &= ~MMC_RSP_CRC; /* Ignore CRC */
+	cmd.busy_timeout = MMC_CQE_RECOVERY_TIMEOUT;
+	err = mmc_wait_for_cmd(host, &cmd, 0);
+
+	host->cqe_ops->cqe_recovery_finish(host);
+
+	return err;
+}
+EXPORT_SYMBOL(mmc_cqe_recovery);
+
 /**
  *	mmc_stop_bkops - stop ongoing BKOPS
  *	@card: MMC card to check BKOPS
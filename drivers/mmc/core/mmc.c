@@ -586,6 +586,14 @@ static int mmc_decode_ext_csd(struct mmc_card *card, u8 *ext_csd)
 			(ext_csd[EXT_CSD_SUPPORTED_MODE] & 0x1) &&
 			!(ext_csd[EXT_CSD_FW_CONFIG] & 0x1);
 	}
+
+	/* eMMC v5.1 or later */
+	if (card->ext_csd.rev >= 8) {
+		card->ext_csd.cmdq_support = ext_csd[EXT_CSD_CMDQ_SUPPORT] &
+					     EXT_CSD_CMDQ_SUPPORTED;
+		card->ext_csd.cmdq_depth = (ext_csd[EXT_CSD_CMDQ_DEPTH] &
+					    EXT_CSD_CMDQ_DEPTH_MASK) + 1;
+	}
 out:
 	return err;
 }
@@ -1368,6 +1376,12 @@ static int mmc_init_card(struct mmc_host *host, u32 ocr,
 	BUG_ON(!host);
 	WARN_ON(!host->claimed);
 
+	/* The card is reset below, so it leaves command queue mode */
+	if (host->cqe_enabled) {
+		host->cqe_ops->cqe_disable(host);
+		host->cqe_enabled = false;
+	}
+
 	/* Set correct bus mode for MMC before attempting init */
 	if (!mmc_host_is_spi(host))
 		mmc_set_bus_mode(host, MMC_BUSMODE_OPENDRAIN);
@@ -1653,6 +1667,41 @@ static int mmc_init_card(struct mmc_host *host, u32 ocr,
 		}
 	}
 
+	/*
+	 * Enable the Command Queue if both the card and a host CQE support
+	 * it. In command queue mode all reads and writes have to go through
+	 * the CQE, so the block driver keys off host->cqe_enabled.
+	 */
+	card->ext_csd.cmdq_en = false;
+	if (card->ext_csd.cmdq_support && host->caps2 & MMC_CAP2_CQE &&
+	    host->cqe_ops) {
+		err = mmc_cmdq_enable(card);
+		if (err && err != -EBADMSG)
+			goto free_card;
+		if (err) {
+			pr_warn("%s: Enabling CMDQ failed\n",
+				mmc_hostname(card->host));
+			card->ext_csd.cmdq_support = false;
+			card->ext_csd.cmdq_depth = 0;
+			err = 0;
+		}
+	}
+
+	if (card->ext_csd.cmdq_en) {
+		err = host->cqe_ops->cqe_enable(host, card);
+		if (err) {
+			pr_err("%s: Failed to enable CQE, error %d\n",
+			       mmc_hostname(host), err);
+			err = mmc_cmdq_disable(card);
+			if (err)
+				goto free_card;
+		} else {
+			host->cqe_enabled = true;
+			pr_info("%s: Command Queue Engine enabled, depth %u\n",
+				mmc_hostname(host), card->ext_csd.cmdq_depth);
+		}
+	}
+
 	if (!oldcard)
 		host->card = card;
 
@@ -1817,6 +1866,12 @@ static int _mmc_suspend(struct mmc_host *host, bool is_suspend)
 			goto out;
 	}
 
+	/* The card leaves command queue mode, it is re-enabled on resume */
+	if (host->cqe_enabled) {
+		host->cqe_ops->cqe_disable(host);
+		host->cqe_enabled = false;
+	}
+
 	err = mmc_flush_cache(host->card);
 	if (err)
 		goto out;
@@ -1834,6 +1889,9 @@ static int _mmc_suspend(struct mmc_host *host, bool is_suspend)
 		mmc_card_set_suspended(host->card);
 	}
 out:
+	if (err && host->card->ext_csd.cmdq_en && !host->cqe_enabled &&
+	    !host->cqe_ops->cqe_enable(host, host->card))
+		host->cqe_enabled = true;
 	mmc_release_host(host);
 	return err;
 }
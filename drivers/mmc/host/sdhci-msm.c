@@ -17,10 +17,12 @@
 #include <linux/module.h>
 #include <linux/of_device.h>
 #include <linux/delay.h>
+#include <linux/interrupt.h>
 #include <linux/mmc/mmc.h>
 #include <linux/slab.h>
 
 #include "sdhci-pltfm.h"
+#include "cqhci.h"
 
 #define CORE_MCI_VERSION		0x50
 #define CORE_VERSION_MAJOR_SHIFT	28
@@ -418,14 +420,73 @@ static const struct of_device_id sdhci_msm_dt_match[] = {
 
 MODULE_DEVICE_TABLE(of, sdhci_msm_dt_match);
 
+/* While the CQE is on, hand the SDHCI interrupts over to CQHCI */
+static u32 sdhci_msm_cqe_irq(struct sdhci_host *host, u32 intmask)
+{
+	int cmd_error = 0;
+	int data_error = 0;
+
+	if (!sdhci_cqe_irq(host, intmask, &cmd_error, &data_error))
+		return intmask;
+
+	cqhci_irq(host->mmc, intmask, cmd_error, data_error);
+	return 0;
+}
+
 static struct sdhci_ops sdhci_msm_ops = {
 	.platform_execute_tuning = sdhci_msm_execute_tuning,
 	.reset = sdhci_reset,
 	.set_clock = sdhci_set_clock,
 	.set_bus_width = sdhci_set_bus_width,
 	.set_uhs_signaling = sdhci_set_uhs_signaling,
+	.irq = sdhci_msm_cqe_irq,
 };
 
+static const struct cqhci_host_ops sdhci_msm_cqhci_ops = {
+	.enable = sdhci_cqe_enable,
+	.disable = sdhci_cqe_disable,
+};
+
+/*
+ * Set up the command queue engine when the device tree asks for it. It has
+ * to be in place before the card is scanned for the core to enable command
+ * queueing on the eMMC. Failing this is not fatal, the controller keeps
+ * working without the CQE.
+ */
+static void sdhci_msm_cqe_init(struct sdhci_host *host,
+			       struct platform_device *pdev)
+{
+	struct mmc_host *mmc = host->mmc;
+	struct cqhci_host *cq_host;
+	bool dma64;
+	int ret;
+
+	if (!of_property_read_bool(pdev->dev.of_node, "supports-cqe"))
+		return;
+
+	cq_host = cqhci_pltfm_init(pdev);
+	if (IS_ERR(cq_host)) {
+		dev_warn(&pdev->dev, "cqhci registers not found (%ld)\n",
+			 PTR_ERR(cq_host));
+		return;
+	}
+
+	cq_host->ops = &sdhci_msm_cqhci_ops;
+
+	mmc->caps2 |= MMC_CAP2_CQE | MMC_CAP2_CQE_DCMD;
+
+	/* Same decision as sdhci_add_host() makes for the ADMA tables */
+	dma64 = readl_relaxed(host->ioaddr + SDHCI_CAPABILITIES) &
+		SDHCI_CAN_64BIT;
+
+	ret = cqhci_init(cq_host, mmc, dma64);
+	if (ret) {
+		dev_warn(&pdev->dev, "cqhci init failed (%d)\n", ret);
+		mmc->caps2 &= ~(MMC_CAP2_CQE | MMC_CAP2_CQE_DCMD);
+		mmc->cqe_ops = NULL;
+	}
+}
+
 static int sdhci_msm_probe(struct platform_device *pdev)
 {
 	struct sdhci_host *host;
@@ -526,6 +587,9 @@ static int sdhci_msm_probe(struct platform_device *pdev)
 	host->quirks |= SDHCI_QUIRK_BROKEN_CARD_DETECTION;
 	host->quirks |= SDHCI_QUIRK_SINGLE_POWER_WRITE;
 
+	/* Complete requests on the cpu of the task that issued them */
+	host->irq_thread_policy = IRQ_THREAD_FOLLOW_CONSUMER;
+
 	host_version = readw_relaxed((host->ioaddr + SDHCI_HOST_VERSION));
 	dev_dbg(&pdev->dev, "Host Version: 0x%x Vendor Version 0x%x\n",
 		host_version, ((host_version & SDHCI_VENDOR_VER_MASK) >>
@@ -549,6 +613,10 @@ static int sdhci_msm_probe(struct platform_device *pdev)
 			       CORE_VENDOR_SPEC_CAPABILITIES0);
 	}
 
+	sdhci_msm_cqe_init(host, pdev);
+
+	device_enable_async_suspend(&pdev->dev);
+
 	ret = sdhci_add_host(host);
 	if (ret)
 		goto clk_disable;
@@ -13,6 +13,7 @@
  *     - JMicron (hardware and technical support)
  */
 
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/highmem.h>
 #include <linux/io.h>
@@ -20,6 +21,7 @@
 #include <linux/dma-mapping.h>
 #include <linux/slab.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/regulator/consumer.h>
 #include <linux/pm_runtime.h>
 
@@ -56,6 +58,7 @@ static void sdhci_enable_preset_value(struct sdhci_host *host, bool enable);
 static int sdhci_pre_dma_transfer(struct sdhci_host *host,
 					struct mmc_data *data);
 static int sdhci_do_get_cd(struct sdhci_host *host);
+static bool sdhci_poll(struct mmc_host *mmc);
 
 #ifdef CONFIG_PM
 static int sdhci_runtime_pm_get(struct sdhci_host *host);
@@ -225,13 +228,8 @@ static void sdhci_do_reset(struct sdhci_host *host, u8 mask)
 
 static void sdhci_set_ios(struct mmc_host *mmc, struct mmc_ios *ios);
 
-static void sdhci_init(struct sdhci_host *host, int soft)
+static void sdhci_set_default_irqs(struct sdhci_host *host)
 {
-	if (soft)
-		sdhci_do_reset(host, SDHCI_RESET_CMD|SDHCI_RESET_DATA);
-	else
-		sdhci_do_reset(host, SDHCI_RESET_ALL);
-
 	host->ier = SDHCI_INT_BUS_POWER | SDHCI_INT_DATA_END_BIT |
 		    SDHCI_INT_DATA_CRC | SDHCI_INT_DATA_TIMEOUT |
 		    SDHCI_INT_INDEX | SDHCI_INT_END_BIT | SDHCI_INT_CRC |
@@ -240,6 +238,16 @@ static void sdhci_init(struct sdhci_host *host, int soft)
 
 	sdhci_writel(host, host->ier, SDHCI_INT_ENABLE);
 	sdhci_writel(host, host->ier, SDHCI_SIGNAL_ENABLE);
+}
+
+static void sdhci_init(struct sdhci_host *host, int soft)
+{
+	if (soft)
+		sdhci_do_reset(host, SDHCI_RESET_CMD|SDHCI_RESET_DATA);
+	else
+		sdhci_do_reset(host, SDHCI_RESET_ALL);
+
+	sdhci_set_default_irqs(host);
 
 	if (soft) {
 		/* force clock reconfiguration */
@@ -465,8 +473,6 @@ static void sdhci_adma_mark_end(void *desc)
 static int sdhci_adma_table_pre(struct sdhci_host *host,
 	struct mmc_data *data)
 {
-	int direction;
-
 	void *desc;
 	void *align;
 	dma_addr_t addr;
@@ -482,21 +488,11 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 	 * The spec does not specify endianness of descriptor table.
 	 * We currently guess that it is LE.
 	 */
-
-	if (data->flags & MMC_DATA_READ)
-		direction = DMA_FROM_DEVICE;
-	else
-		direction = DMA_TO_DEVICE;
-
-	host->align_addr = dma_map_single(mmc_dev(host->mmc),
-		host->align_buffer, host->align_buffer_sz, direction);
-	if (dma_mapping_error(mmc_dev(host->mmc), host->align_addr))
-		goto fail;
-	BUG_ON(host->align_addr & host->align_mask);
-
 	host->sg_count = sdhci_pre_dma_transfer(host, data);
 	if (host->sg_count < 0)
-		goto unmap_align;
+		return -EINVAL;
+
+	host->adma_reqs++;
 
 	desc = host->adma_table;
 	align = host->align_buffer;
@@ -517,6 +513,9 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 		offset = (host->align_sz - (addr & host->align_mask)) &
 			 host->align_mask;
 		if (offset) {
+			host->align_copies++;
+			host->align_bytes += offset;
+
 			if (data->flags & MMC_DATA_WRITE) {
 				buffer = sdhci_kmap_atomic(sg, &flags);
 				memcpy(align, buffer, offset);
@@ -538,13 +537,22 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 			len -= offset;
 		}
 
-		BUG_ON(len > 65536);
+		/*
+		 * Segments are merged up to the request size, so one may
+		 * take several descriptors. Each piece but the last is
+		 * max_adma long, which keeps the next one aligned.
+		 */
+		while (len) {
+			int n = min_t(int, len, host->max_adma);
 
-		if (len) {
 			/* tran, valid */
-			sdhci_adma_write_desc(host, desc, addr, len,
+			sdhci_adma_write_desc(host, desc, addr, n,
 					      ADMA2_TRAN_VALID);
 			desc += host->desc_sz;
+			host->adma_descs++;
+
+			addr += n;
+			len -= n;
 		}
 
 		/*
@@ -571,21 +579,8 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 		sdhci_adma_write_desc(host, desc, 0, 0, ADMA2_NOP_END_VALID);
 	}
 
-	/*
-	 * Resync align buffer as we might have changed it.
-	 */
-	if (data->flags & MMC_DATA_WRITE) {
-		dma_sync_single_for_device(mmc_dev(host->mmc),
-			host->align_addr, host->align_buffer_sz, direction);
-	}
-
+	/* the align buffer is coherent, nothing to sync */
 	return 0;
-
-unmap_align:
-	dma_unmap_single(mmc_dev(host->mmc), host->align_addr,
-		host->align_buffer_sz, direction);
-fail:
-	return -EINVAL;
 }
 
 static void sdhci_adma_table_post(struct sdhci_host *host,
@@ -605,9 +600,6 @@ static void sdhci_adma_table_post(struct sdhci_host *host,
 	else
 		direction = DMA_TO_DEVICE;
 
-	dma_unmap_single(mmc_dev(host->mmc), host->align_addr,
-		host->align_buffer_sz, direction);
-
 	/* Do a quick scan of the SG list for any unaligned mappings */
 	has_unaligned = false;
 	for_each_sg(data->sg, sg, host->sg_count, i)
@@ -1356,6 +1348,17 @@ static void sdhci_set_power(struct sdhci_host *host, unsigned char mode,
  *                                                                           *
 \*****************************************************************************/
 
+/*
+ * With forced irq threading (PREEMPT_RT) the whole of sdhci_irq() runs in
+ * the irq thread, which then follows the consumer per irq_thread_policy.
+ */
+static void sdhci_set_irq_thread_policy(struct sdhci_host *host)
+{
+	if (host->irq_thread_policy &&
+	    irq_set_thread_policy(host->irq, host, host->irq_thread_policy))
+		host->irq_thread_policy = 0;
+}
+
 static void sdhci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 {
 	struct sdhci_host *host;
@@ -1364,6 +1367,10 @@ static void sdhci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 
 	host = mmc_priv(mmc);
 
+	/* The issuer is the one waiting for the request to complete */
+	if (host->irq_thread_policy)
+		irq_set_thread_consumer(host->irq, host, current);
+
 	sdhci_runtime_pm_get(host);
 
 	/* Firstly check card presence */
@@ -2215,6 +2222,7 @@ static const struct mmc_host_ops sdhci_ops = {
 	.select_drive_strength		= sdhci_select_drive_strength,
 	.card_event			= sdhci_card_event,
 	.card_busy	= sdhci_card_busy,
+	.poll		= sdhci_poll,
 };
 
 /*****************************************************************************\
@@ -2523,35 +2531,35 @@ static void sdhci_data_irq(struct sdhci_host *host, u32 intmask)
 	}
 }
 
-static irqreturn_t sdhci_irq(int irq, void *dev_id)
+/* Handle pending events, with host->lock held */
+static irqreturn_t __sdhci_irq(struct sdhci_host *host, u32 *unexpected)
 {
 	irqreturn_t result = IRQ_NONE;
-	struct sdhci_host *host = dev_id;
-	u32 intmask, mask, unexpected = 0;
+	u32 intmask, mask;
 	int max_loops = 16;
 
-	spin_lock(&host->lock);
-
-	if (host->runtime_suspended && !sdhci_sdio_irq_enabled(host)) {
-		spin_unlock(&host->lock);
+	if (host->runtime_suspended && !sdhci_sdio_irq_enabled(host))
 		return IRQ_NONE;
-	}
 
 	intmask = sdhci_readl(host, SDHCI_INT_STATUS);
-	if (!intmask || intmask == 0xffffffff) {
-		result = IRQ_NONE;
-		goto out;
-	}
+	if (!intmask || intmask == 0xffffffff)
+		return IRQ_NONE;
 
 	do {
+		DBG("*** %s got interrupt: 0x%08x\n",
+			mmc_hostname(host->mmc), intmask);
+
+		if (host->ops->irq) {
+			intmask = host->ops->irq(host, intmask);
+			if (!intmask)
+				goto cont;
+		}
+
 		/* Clear selected interrupts. */
 		mask = intmask & (SDHCI_INT_CMD_MASK | SDHCI_INT_DATA_MASK |
 				  SDHCI_INT_BUS_POWER);
 		sdhci_writel(host, mask, SDHCI_INT_STATUS);
 
-		DBG("*** %s got interrupt: 0x%08x\n",
-			mmc_hostname(host->mmc), intmask);
-
 		if (intmask & (SDHCI_INT_CARD_INSERT | SDHCI_INT_CARD_REMOVE)) {
 			u32 present = sdhci_readl(host, SDHCI_PRESENT_STATE) &
 				      SDHCI_CARD_PRESENT;
@@ -2605,23 +2613,39 @@ static irqreturn_t sdhci_irq(int irq, void *dev_id)
 			     SDHCI_INT_CARD_INT);
 
 		if (intmask) {
-			unexpected |= intmask;
+			*unexpected |= intmask;
 			sdhci_writel(host, intmask, SDHCI_INT_STATUS);
 		}
-
+cont:
 		if (result == IRQ_NONE)
 			result = IRQ_HANDLED;
 
 		intmask = sdhci_readl(host, SDHCI_INT_STATUS);
 	} while (intmask && --max_loops);
-out:
-	spin_unlock(&host->lock);
 
+	return result;
+}
+
+static void sdhci_report_unexpected(struct sdhci_host *host, u32 unexpected)
+{
 	if (unexpected) {
 		pr_err("%s: Unexpected interrupt 0x%08x.\n",
 			   mmc_hostname(host->mmc), unexpected);
 		sdhci_dumpregs(host);
 	}
+}
+
+static irqreturn_t sdhci_irq(int irq, void *dev_id)
+{
+	struct sdhci_host *host = dev_id;
+	irqreturn_t result;
+	u32 unexpected = 0;
+
+	spin_lock(&host->lock);
+	result = __sdhci_irq(host, &unexpected);
+	spin_unlock(&host->lock);
+
+	sdhci_report_unexpected(host, unexpected);
 
 	return result;
 }
@@ -2654,6 +2678,163 @@ static irqreturn_t sdhci_thread_irq(int irq, void *dev_id)
 	return isr ? IRQ_HANDLED : IRQ_NONE;
 }
 
+/*
+ * Handle command and data events inline, and run the finish tasklet, so
+ * that a polling submitter doesn't wait for the interrupt thread and the
+ * tasklet. Card and SDIO events are left to the interrupt. This takes
+ * host->lock like any other process context user, which keeps it
+ * preemptible on RT.
+ */
+static bool sdhci_poll(struct mmc_host *mmc)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	u32 mask = SDHCI_INT_CMD_MASK | SDHCI_INT_DATA_MASK;
+	u32 unexpected = 0;
+	unsigned long flags;
+	irqreturn_t ret;
+	u32 intmask;
+
+	if (host->runtime_suspended)
+		return false;
+
+	intmask = sdhci_readl(host, SDHCI_INT_STATUS);
+	if (!(intmask & mask) || (intmask & ~mask) || intmask == 0xffffffff)
+		return false;
+
+	spin_lock_irqsave(&host->lock, flags);
+	ret = __sdhci_irq(host, &unexpected);
+	spin_unlock_irqrestore(&host->lock, flags);
+
+	sdhci_report_unexpected(host, unexpected);
+
+	/* raced with a card event */
+	if (ret == IRQ_WAKE_THREAD)
+		irq_wake_thread(host->irq, host);
+
+	if (test_bit(TASKLET_STATE_SCHED, &host->finish_tasklet.state))
+		sdhci_tasklet_finish((unsigned long)host);
+
+	return ret != IRQ_NONE;
+}
+
+/*****************************************************************************\
+ *                                                                           *
+ * Command Queue Engine (CQE) helpers                                        *
+ *                                                                           *
+\*****************************************************************************/
+
+void sdhci_cqe_enable(struct mmc_host *mmc)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	unsigned long flags;
+	u8 ctrl;
+
+	spin_lock_irqsave(&host->lock, flags);
+
+	/* The CQE fetches its transfer descriptors in ADMA2 format */
+	ctrl = sdhci_readb(host, SDHCI_HOST_CONTROL);
+	ctrl &= ~SDHCI_CTRL_DMA_MASK;
+	if (host->flags & SDHCI_USE_64_BIT_DMA)
+		ctrl |= SDHCI_CTRL_ADMA64;
+	else
+		ctrl |= SDHCI_CTRL_ADMA32;
+	sdhci_writeb(host, ctrl, SDHCI_HOST_CONTROL);
+
+	sdhci_writew(host, SDHCI_MAKE_BLKSZ(SDHCI_DEFAULT_BOUNDARY_ARG, 512),
+		     SDHCI_BLOCK_SIZE);
+
+	/* Set maximum timeout */
+	sdhci_writeb(host, 0xE, SDHCI_TIMEOUT_CONTROL);
+
+	host->ier = host->cqe_ier;
+
+	sdhci_writel(host, host->ier, SDHCI_INT_ENABLE);
+	sdhci_writel(host, host->ier, SDHCI_SIGNAL_ENABLE);
+
+	host->cqe_on = true;
+
+	pr_debug("%s: sdhci: CQE on, IRQ mask %#x, IRQ status %#x\n",
+		 mmc_hostname(mmc), host->ier,
+		 sdhci_readl(host, SDHCI_INT_STATUS));
+
+	mmiowb();
+	spin_unlock_irqrestore(&host->lock, flags);
+}
+EXPORT_SYMBOL_GPL(sdhci_cqe_enable);
+
+void sdhci_cqe_disable(struct mmc_host *mmc, bool recovery)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	unsigned long flags;
+
+	spin_lock_irqsave(&host->lock, flags);
+
+	sdhci_set_default_irqs(host);
+
+	host->cqe_on = false;
+
+	if (recovery) {
+		sdhci_do_reset(host, SDHCI_RESET_CMD);
+		sdhci_do_reset(host, SDHCI_RESET_DATA);
+	}
+
+	pr_debug("%s: sdhci: CQE off, IRQ mask %#x, IRQ status %#x\n",
+		 mmc_hostname(mmc), host->ier,
+		 sdhci_readl(host, SDHCI_INT_STATUS));
+
+	mmiowb();
+	spin_unlock_irqrestore(&host->lock, flags);
+}
+EXPORT_SYMBOL_GPL(sdhci_cqe_disable);
+
+/*
+ * Decode and clear the SDHCI interrupts raised while the CQE is on; returns
+ * false if the CQE is off and sdhci_irq() has to handle @intmask itself.
+ */
+bool sdhci_cqe_irq(struct sdhci_host *host, u32 intmask, int *cmd_error,
+		   int *data_error)
+{
+	u32 mask;
+
+	if (!host->cqe_on)
+		return false;
+
+	if (intmask & (SDHCI_INT_INDEX | SDHCI_INT_END_BIT | SDHCI_INT_CRC))
+		*cmd_error = -EILSEQ;
+	else if (intmask & SDHCI_INT_TIMEOUT)
+		*cmd_error = -ETIMEDOUT;
+	else
+		*cmd_error = 0;
+
+	if (intmask & (SDHCI_INT_DATA_END_BIT | SDHCI_INT_DATA_CRC))
+		*data_error = -EILSEQ;
+	else if (intmask & SDHCI_INT_DATA_TIMEOUT)
+		*data_error = -ETIMEDOUT;
+	else if (intmask & SDHCI_INT_ADMA_ERROR)
+		*data_error = -EIO;
+	else
+		*data_error = 0;
+
+	/* Clear selected interrupts. */
+	mask = intmask & host->cqe_ier;
+	sdhci_writel(host, mask, SDHCI_INT_STATUS);
+
+	if (intmask & SDHCI_INT_BUS_POWER)
+		pr_err("%s: Card is consuming too much power!\n",
+		       mmc_hostname(host->mmc));
+
+	intmask &= ~(host->cqe_ier | SDHCI_INT_ERROR);
+	if (intmask) {
+		sdhci_writel(host, intmask, SDHCI_INT_STATUS);
+		pr_err("%s: CQE: Unexpected interrupt 0x%08x.\n",
+		       mmc_hostname(host->mmc), intmask);
+		sdhci_dumpregs(host);
+	}
+
+	return true;
+}
+EXPORT_SYMBOL_GPL(sdhci_cqe_irq);
+
 /*****************************************************************************\
  *                                                                           *
  * Suspend/resume                                                            *
@@ -2735,6 +2916,7 @@ int sdhci_resume_host(struct sdhci_host *host)
 					   mmc_hostname(host->mmc), host);
 		if (ret)
 			return ret;
+		sdhci_set_irq_thread_policy(host);
 	} else {
 		sdhci_disable_irq_wakeups(host);
 		disable_irq_wake(host->irq);
@@ -2841,6 +3023,56 @@ EXPORT_SYMBOL_GPL(sdhci_runtime_resume_host);
 
 #endif /* CONFIG_PM */
 
+#ifdef CONFIG_DEBUG_FS
+
+/*
+ * How much of the ADMA work goes to bouncing misaligned segment heads;
+ * sample twice for rates.
+ */
+static int sdhci_adma_stats_show(struct seq_file *s, void *data)
+{
+	struct sdhci_host *host = s->private;
+	unsigned long flags;
+
+	spin_lock_irqsave(&host->lock, flags);
+	seq_printf(s, "requests %lu descriptors %lu align_copies %lu align_bytes %lu\n",
+		   host->adma_reqs, host->adma_descs, host->align_copies,
+		   host->align_bytes);
+	spin_unlock_irqrestore(&host->lock, flags);
+
+	return 0;
+}
+
+static int sdhci_adma_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sdhci_adma_stats_show, inode->i_private);
+}
+
+static const struct file_operations sdhci_adma_stats_fops = {
+	.open		= sdhci_adma_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void sdhci_init_debugfs(struct sdhci_host *host)
+{
+	struct mmc_host *mmc = host->mmc;
+
+	if (!mmc->debugfs_root || !(host->flags & SDHCI_USE_ADMA))
+		return;
+
+	if (!debugfs_create_file("adma_stats", S_IRUSR, mmc->debugfs_root,
+				 host, &sdhci_adma_stats_fops))
+		dev_err(&mmc->class_dev, "failed to create adma_stats\n");
+}
+
+#else
+
+static inline void sdhci_init_debugfs(struct sdhci_host *host) { }
+
+#endif /* CONFIG_DEBUG_FS */
+
 /*****************************************************************************\
  *                                                                           *
  * Device allocation/registration                                            *
@@ -2864,6 +3096,8 @@ struct sdhci_host *sdhci_alloc_host(struct device *dev,
 	host->mmc_host_ops = sdhci_ops;
 	mmc->ops = &host->mmc_host_ops;
 
+	host->cqe_ier = SDHCI_CQE_INT_MASK;
+
 	return host;
 }
 
@@ -2960,14 +3194,16 @@ int sdhci_add_host(struct sdhci_host *host)
 		host->flags &= ~SDHCI_USE_SDMA;
 
 	if (host->flags & SDHCI_USE_ADMA) {
+		void *buf;
+		dma_addr_t dma;
+
 		/*
-		 * The DMA descriptor table size is calculated as the maximum
-		 * number of segments times 2, to allow for an alignment
-		 * descriptor for each segment, plus 1 for a nop end descriptor,
-		 * all multipled by the descriptor size.
+		 * The DMA descriptor table size is SDHCI_ADMA2_DESC_CNT
+		 * descriptors, the align buffer holds up to one alignment
+		 * chunk per segment.
 		 */
 		if (host->flags & SDHCI_USE_64_BIT_DMA) {
-			host->adma_table_sz = (SDHCI_MAX_SEGS * 2 + 1) *
+			host->adma_table_sz = SDHCI_ADMA2_DESC_CNT *
 					      SDHCI_ADMA2_64_DESC_SZ;
 			host->align_buffer_sz = SDHCI_MAX_SEGS *
 						SDHCI_ADMA2_64_ALIGN;
@@ -2975,7 +3211,7 @@ int sdhci_add_host(struct sdhci_host *host)
 			host->align_sz = SDHCI_ADMA2_64_ALIGN;
 			host->align_mask = SDHCI_ADMA2_64_ALIGN - 1;
 		} else {
-			host->adma_table_sz = (SDHCI_MAX_SEGS * 2 + 1) *
+			host->adma_table_sz = SDHCI_ADMA2_DESC_CNT *
 					      SDHCI_ADMA2_32_DESC_SZ;
 			host->align_buffer_sz = SDHCI_MAX_SEGS *
 						SDHCI_ADMA2_32_ALIGN;
@@ -2983,32 +3219,35 @@ int sdhci_add_host(struct sdhci_host *host)
 			host->align_sz = SDHCI_ADMA2_32_ALIGN;
 			host->align_mask = SDHCI_ADMA2_32_ALIGN - 1;
 		}
-		host->adma_table = dma_alloc_coherent(mmc_dev(mmc),
-						      host->adma_table_sz,
-						      &host->adma_addr,
-						      GFP_KERNEL);
-		host->align_buffer = kmalloc(host->align_buffer_sz, GFP_KERNEL);
-		if (!host->adma_table || !host->align_buffer) {
-			if (host->adma_table)
-				dma_free_coherent(mmc_dev(mmc),
-						  host->adma_table_sz,
-						  host->adma_table,
-						  host->adma_addr);
-			kfree(host->align_buffer);
+
+		/* a zero length descriptor means 64KiB, unless it is broken */
+		if (host->quirks & SDHCI_QUIRK_BROKEN_ADMA_ZEROLEN_DESC)
+			host->max_adma = 65536 - host->align_sz;
+		else
+			host->max_adma = 65536;
+
+		/*
+		 * Allocated once and kept coherent, so requests neither map
+		 * nor sync the align buffer.
+		 */
+		buf = dma_alloc_coherent(mmc_dev(mmc), host->align_buffer_sz +
+					 host->adma_table_sz, &dma, GFP_KERNEL);
+		if (!buf) {
 			pr_warn("%s: Unable to allocate ADMA buffers - falling back to standard DMA\n",
 				mmc_hostname(mmc));
 			host->flags &= ~SDHCI_USE_ADMA;
-			host->adma_table = NULL;
-			host->align_buffer = NULL;
-		} else if (host->adma_addr & host->align_mask) {
+		} else if (dma & host->align_mask) {
 			pr_warn("%s: unable to allocate aligned ADMA descriptor\n",
 				mmc_hostname(mmc));
 			host->flags &= ~SDHCI_USE_ADMA;
-			dma_free_coherent(mmc_dev(mmc), host->adma_table_sz,
-					  host->adma_table, host->adma_addr);
-			kfree(host->align_buffer);
-			host->adma_table = NULL;
-			host->align_buffer = NULL;
+			dma_free_coherent(mmc_dev(mmc), host->align_buffer_sz +
+					  host->adma_table_sz, buf, dma);
+		} else {
+			host->align_buffer = buf;
+			host->align_addr = dma;
+
+			host->adma_table = buf + host->align_buffer_sz;
+			host->adma_addr = dma + host->align_buffer_sz;
 		}
 	}
 
@@ -3318,21 +3557,19 @@ int sdhci_add_host(struct sdhci_host *host)
 	 * size (512KiB). Note some tuning modes impose a 4MiB limit, but this
 	 * is less anyway.
 	 */
-	mmc->max_req_size = 524288;
+	mmc->max_req_size = SDHCI_MAX_REQ_SIZE;
 
 	/*
 	 * Maximum segment size. Could be one segment with the maximum number
-	 * of bytes. When doing hardware scatter/gather, each entry cannot
-	 * be larger than 64 KiB though.
+	 * of bytes. With ADMA a segment longer than 64 KiB is split over
+	 * several descriptors, so physically contiguous pages still merge.
+	 * The CQE builds its own ADMA2 descriptors, one per segment, and
+	 * their 16-bit length field (0 meaning 64 KiB) caps a segment there.
 	 */
-	if (host->flags & SDHCI_USE_ADMA) {
-		if (host->quirks & SDHCI_QUIRK_BROKEN_ADMA_ZEROLEN_DESC)
-			mmc->max_seg_size = 65535;
-		else
-			mmc->max_seg_size = 65536;
-	} else {
-		mmc->max_seg_size = mmc->max_req_size;
-	}
+	mmc->max_seg_size = mmc->max_req_size;
+	if (mmc->caps2 & MMC_CAP2_CQE)
+		mmc->max_seg_size = min_t(unsigned int, mmc->max_seg_size,
+					  65536);
 
 	/*
 	 * Maximum block size. This varies from controller to controller and
@@ -3376,6 +3613,7 @@ int sdhci_add_host(struct sdhci_host *host)
 		       mmc_hostname(mmc), host->irq, ret);
 		goto untasklet;
 	}
+	sdhci_set_irq_thread_policy(host);
 
 #ifdef CONFIG_MMC_DEBUG
 	sdhci_dumpregs(host);
@@ -3400,6 +3638,7 @@ int sdhci_add_host(struct sdhci_host *host)
 	mmiowb();
 
 	mmc_add_host(mmc);
+	sdhci_init_debugfs(host);
 
 	pr_info("%s: SDHCI controller on %s [%s] using %s\n",
 		mmc_hostname(mmc), host->hw_name, dev_name(mmc_dev(mmc)),
@@ -3469,10 +3708,10 @@ void sdhci_remove_host(struct sdhci_host *host, int dead)
 	if (!IS_ERR(mmc->supply.vqmmc))
 		regulator_disable(mmc->supply.vqmmc);
 
-	if (host->adma_table)
-		dma_free_coherent(mmc_dev(mmc), host->adma_table_sz,
-				  host->adma_table, host->adma_addr);
-	kfree(host->align_buffer);
+	if (host->align_buffer)
+		dma_free_coherent(mmc_dev(mmc), host->align_buffer_sz +
+				  host->adma_table_sz, host->align_buffer,
+				  host->align_addr);
 
 	host->adma_table = NULL;
 	host->align_buffer = NULL;
@@ -128,6 +128,7 @@
 #define  SDHCI_INT_CARD_INSERT	0x00000040
 #define  SDHCI_INT_CARD_REMOVE	0x00000080
 #define  SDHCI_INT_CARD_INT	0x00000100
+#define  SDHCI_INT_CQE		0x00004000
 #define  SDHCI_INT_ERROR	0x00008000
 #define  SDHCI_INT_TIMEOUT	0x00010000
 #define  SDHCI_INT_CRC		0x00020000
@@ -152,6 +153,13 @@
 		SDHCI_INT_BLK_GAP)
 #define SDHCI_INT_ALL_MASK	((unsigned int)-1)
 
+#define SDHCI_CQE_INT_ERR_MASK ( \
+	SDHCI_INT_ADMA_ERROR | SDHCI_INT_BUS_POWER | SDHCI_INT_DATA_END_BIT | \
+	SDHCI_INT_DATA_CRC | SDHCI_INT_DATA_TIMEOUT | SDHCI_INT_INDEX | \
+	SDHCI_INT_END_BIT | SDHCI_INT_CRC | SDHCI_INT_TIMEOUT)
+
+#define SDHCI_CQE_INT_MASK (SDHCI_CQE_INT_ERR_MASK | SDHCI_INT_CQE)
+
 #define SDHCI_ACMD12_ERR	0x3C
 
 #define SDHCI_HOST_CONTROL2		0x3E
@@ -309,6 +317,17 @@ struct sdhci_adma2_64_desc {
  */
 #define SDHCI_MAX_SEGS		128
 
+/* Maximum request size, bounded by the SDMA boundary */
+#define SDHCI_MAX_REQ_SIZE	524288
+
+/*
+ * ADMA descriptors for the largest request: an alignment and a data
+ * descriptor per segment, one more data descriptor for each (no more than)
+ * 64KiB a segment is split at, plus a nop end descriptor.
+ */
+#define SDHCI_ADMA2_DESC_CNT	(SDHCI_MAX_SEGS * 2 + \
+				 SDHCI_MAX_REQ_SIZE / 65536 + 1)
+
 enum sdhci_cookie {
 	COOKIE_UNMAPPED,
 	COOKIE_MAPPED,
@@ -419,6 +438,7 @@ struct sdhci_host {
 #define SDHCI_QUIRK2_NEED_DELAY_AFTER_INT_CLK_RST	(1<<16)
 
 	int irq;		/* Device IRQ */
+	unsigned int irq_thread_policy;	/* IRQ_THREAD_* for the irq thread */
 	void __iomem *ioaddr;	/* Mapped address */
 
 	const struct sdhci_ops *ops;	/* Low level hw interface */
@@ -479,12 +499,20 @@ struct sdhci_host {
 	size_t adma_table_sz;	/* ADMA descriptor table size */
 	size_t align_buffer_sz;	/* Bounce buffer size */
 
+	/* both live in one coherent allocation, align buffer first */
 	dma_addr_t adma_addr;	/* Mapped ADMA descr. table */
 	dma_addr_t align_addr;	/* Mapped bounce buffer */
 
 	unsigned int desc_sz;	/* ADMA descriptor size */
 	unsigned int align_sz;	/* ADMA alignment */
 	unsigned int align_mask;	/* ADMA alignment mask */
+	unsigned int max_adma;	/* Longest ADMA data descriptor */
+
+	/* ADMA statistics, in debugfs */
+	unsigned long adma_reqs;	/* Requests using ADMA */
+	unsigned long adma_descs;	/* Data descriptors written */
+	unsigned long align_copies;	/* Segments bounced for alignment */
+	unsigned long align_bytes;	/* Bytes bounced for alignment */
 
 	struct tasklet_struct finish_tasklet;	/* Tasklet structures */
 
@@ -505,6 +533,9 @@ struct sdhci_host {
 	/* cached registers */
 	u32			ier;
 
+	bool			cqe_on;		/* CQE is operating */
+	u32			cqe_ier;	/* CQE interrupt mask */
+
 	wait_queue_head_t	buf_ready_int;	/* Waitqueue for Buffer Read Ready interrupt */
 	unsigned int		tuning_done;	/* Condition flag set when CMD19 succeeds */
 
@@ -550,6 +581,8 @@ struct sdhci_ops {
 					 struct mmc_card *card,
 					 unsigned int max_dtr, int host_drv,
 					 int card_drv, int *drv_type);
+	/* Returns the interrupts left for sdhci_irq() to handle */
+	u32	(*irq)(struct sdhci_host *host, u32 intmask);
 };
 
 #ifdef CONFIG_MMC_SDHCI_IO_ACCESSORS
@@ -661,6 +694,11 @@ void sdhci_set_bus_width(struct sdhci_host *host, int width);
 void sdhci_reset(struct sdhci_host *host, u8 mask);
 void sdhci_set_uhs_signaling(struct sdhci_host *host, unsigned timing);
 
+void sdhci_cqe_enable(struct mmc_host *mmc);
+void sdhci_cqe_disable(struct mmc_host *mmc, bool recovery);
+bool sdhci_cqe_irq(struct sdhci_host *host, u32 intmask, int *cmd_error,
+		   int *data_error);
+
 #ifdef CONFIG_PM
 extern int sdhci_suspend_host(struct sdhci_host *host);
 extern int sdhci_resume_host(struct sdhci_host *host);
@@ -73,6 +73,33 @@ MODULE_PARM_DESC(qcaspi_pluggable, "Pluggable SPI connection (yes/no).");
 #define QCASPI_TX_TIMEOUT (1 * HZ)
 #define QCASPI_QCA7K_REBOOT_TIME_MS 1000
 
+/* Write buffer fill level below which the QCA7000 raises
+ * SPI_INT_WRBUF_BELOW_WM: room for one more maximum sized frame.
+ */
+#define QCASPI_WRBUF_WM (QCASPI_HW_BUF_LEN - QCAFRM_ETHMAXLEN - \
+			 QCAFRM_HEADER_LEN - QCAFRM_FOOTER_LEN - \
+			 QCASPI_HW_PKT_LEN)
+
+/* Fallback in case the watermark interrupt gets lost */
+#define QCASPI_TX_WAIT_TIMEOUT (HZ / 100 ? : 1)
+
+/* Maximum number of RX buffer reads per interrupt */
+#define QCASPI_RX_MAX_READS 4
+
+static u16
+qcaspi_intr_enable(struct qcaspi *qca)
+{
+	u16 intr_enable = (SPI_INT_CPU_ON |
+			   SPI_INT_PKT_AVLBL |
+			   SPI_INT_RDBUF_ERR |
+			   SPI_INT_WRBUF_ERR);
+
+	if (qca->tx_wait)
+		intr_enable |= SPI_INT_WRBUF_BELOW_WM;
+
+	return intr_enable;
+}
+
 static void
 start_spi_intr_handling(struct qcaspi *qca, u16 *intr_cause)
 {
@@ -86,10 +113,7 @@ start_spi_intr_handling(struct qcaspi *qca, u16 *intr_cause)
 static void
 end_spi_intr_handling(struct qcaspi *qca, u16 intr_cause)
 {
-	u16 intr_enable = (SPI_INT_CPU_ON |
-			   SPI_INT_PKT_AVLBL |
-			   SPI_INT_RDBUF_ERR |
-			   SPI_INT_WRBUF_ERR);
+	u16 intr_enable = qcaspi_intr_enable(qca);
 
 	qcaspi_write_register(qca, SPI_REG_INTR_CAUSE, intr_cause);
 	qcaspi_write_register(qca, SPI_REG_INTR_ENABLE, intr_enable);
@@ -232,14 +256,69 @@ qcaspi_tx_frame(struct qcaspi *qca, struct sk_buff *skb)
 	return 0;
 }
 
+/*   Write @packets framed skbs starting at the ring head with a single
+ *   BFR_SIZE write and one SPI burst of @len bytes. The skbs are chained
+ *   as separate transfers of the same message, so chip select stays
+ *   asserted and the controller can DMA straight from the skb data.
+ */
+
+static int
+qcaspi_tx_burst(struct qcaspi *qca, u16 packets, u32 len)
+{
+	struct spi_message *msg = &qca->spi_msg_tx;
+	struct spi_transfer *transfer = &qca->spi_xfer_tx[0];
+	u16 idx = qca->txr.head;
+	int ret;
+	u16 i;
+
+	qcaspi_write_register(qca, SPI_REG_BFR_SIZE, len);
+
+	spi_message_init(msg);
+
+	qca->tx_cmd = cpu_to_be16(QCA7K_SPI_WRITE | QCA7K_SPI_EXTERNAL);
+	transfer->tx_buf = &qca->tx_cmd;
+	transfer->rx_buf = NULL;
+	transfer->len = QCASPI_CMD_LEN;
+	spi_message_add_tail(transfer, msg);
+
+	for (i = 0; i < packets; i++) {
+		transfer = &qca->spi_xfer_tx[i + 1];
+		transfer->tx_buf = qca->txr.skb[idx]->data;
+		transfer->rx_buf = NULL;
+		transfer->len = qca->txr.skb[idx]->len;
+		spi_message_add_tail(transfer, msg);
+
+		if (++idx >= qca->txr.count)
+			idx = 0;
+	}
+
+	ret = spi_sync(qca->spi_dev, msg);
+
+	if (ret || (msg->actual_length != QCASPI_CMD_LEN + len)) {
+		qcaspi_spi_error(qca);
+		return -1;
+	}
+
+	return 0;
+}
+
 static int
 qcaspi_transmit(struct qcaspi *qca)
 {
 	struct net_device_stats *n_stats = &qca->net_dev->stats;
+	struct sk_buff *skb;
 	u16 available = 0;
 	u32 pkt_len;
+	u32 burst;
+	u32 needed;
 	u16 new_head;
+	u16 idx;
+	u16 batch;
 	u16 packets = 0;
+	bool tx_wait = qca->tx_wait;
+	int ret;
+
+	qca->tx_wait = false;
 
 	if (qca->txr.skb[qca->txr.head] == NULL)
 		return 0;
@@ -247,51 +326,109 @@ qcaspi_transmit(struct qcaspi *qca)
 	qcaspi_read_register(qca, SPI_REG_WRBUF_SPC_AVA, &available);
 
 	while (qca->txr.skb[qca->txr.head]) {
-		pkt_len = qca->txr.skb[qca->txr.head]->len + QCASPI_HW_PKT_LEN;
+		/* Gather as many frames as fit into the write buffer space
+		 * and the burst length. Legacy mode and frames longer than
+		 * a burst go out one at a time.
+		 */
+		batch = 0;
+		burst = 0;
+		needed = 0;
+		idx = qca->txr.head;
+		while (qca->txr.skb[idx] && batch < qca->txr.count) {
+			pkt_len = qca->txr.skb[idx]->len;
+
+			if (needed + pkt_len + QCASPI_HW_PKT_LEN > available)
+				break;
+			if (batch && (qca->legacy_mode ||
+				      burst + pkt_len > qca->burst_len))
+				break;
+
+			needed += pkt_len + QCASPI_HW_PKT_LEN;
+			burst += pkt_len;
+			batch++;
+			if (++idx >= qca->txr.count)
+				idx = 0;
+		}
 
-		if (available < pkt_len) {
+		if (!batch) {
 			if (packets == 0)
 				qca->stats.write_buf_miss++;
+			qca->tx_wait = true;
 			break;
 		}
 
-		if (qcaspi_tx_frame(qca, qca->txr.skb[qca->txr.head]) == -1) {
+		if (!qca->legacy_mode && burst <= qca->burst_len)
+			ret = qcaspi_tx_burst(qca, batch, burst);
+		else
+			ret = qcaspi_tx_frame(qca, qca->txr.skb[qca->txr.head]);
+
+		if (ret == -1) {
 			qca->stats.write_err++;
 			return -1;
 		}
 
-		packets++;
-		n_stats->tx_packets++;
-		n_stats->tx_bytes += qca->txr.skb[qca->txr.head]->len;
-		available -= pkt_len;
+		packets += batch;
+		available -= needed;
 
-		/* remove the skb from the queue */
+		/* remove the skbs from the queue */
 		/* XXX After inconsistent lock states netif_tx_lock()
 		 * has been replaced by netif_tx_lock_bh() and so on.
 		 */
 		netif_tx_lock_bh(qca->net_dev);
-		dev_kfree_skb(qca->txr.skb[qca->txr.head]);
-		qca->txr.skb[qca->txr.head] = NULL;
-		qca->txr.size -= pkt_len;
-		new_head = qca->txr.head + 1;
-		if (new_head >= qca->txr.count)
-			new_head = 0;
-		qca->txr.head = new_head;
+		while (batch--) {
+			skb = qca->txr.skb[qca->txr.head];
+			n_stats->tx_packets++;
+			n_stats->tx_bytes += skb->len;
+			qca->txr.size -= skb->len + QCASPI_HW_PKT_LEN;
+			dev_kfree_skb(skb);
+			qca->txr.skb[qca->txr.head] = NULL;
+			new_head = qca->txr.head + 1;
+			if (new_head >= qca->txr.count)
+				new_head = 0;
+			qca->txr.head = new_head;
+		}
 		if (netif_queue_stopped(qca->net_dev))
 			netif_wake_queue(qca->net_dev);
 		netif_tx_unlock_bh(qca->net_dev);
 	}
 
+	/* Instead of polling the buffer space, let the chip tell us */
+	if (qca->tx_wait && !tx_wait)
+		qcaspi_write_register(qca, SPI_REG_INTR_ENABLE,
+				      qcaspi_intr_enable(qca));
+
 	return 0;
 }
 
+/*   Hand the frames decoded by qcaspi_receive() to the stack. They are
+ *   queued with bottom halves disabled, so the RX softirq runs once for
+ *   the whole batch rather than once per frame as with netif_rx_ni().
+ */
+
+static void
+qcaspi_rx_deliver(struct sk_buff_head *rxq)
+{
+	struct sk_buff *skb;
+
+	if (skb_queue_empty(rxq))
+		return;
+
+	local_bh_disable();
+	while ((skb = __skb_dequeue(rxq)))
+		netif_rx(skb);
+	local_bh_enable();
+}
+
 static int
 qcaspi_receive(struct qcaspi *qca)
 {
 	struct net_device *net_dev = qca->net_dev;
 	struct net_device_stats *n_stats = &net_dev->stats;
+	struct sk_buff_head rxq;
 	u16 available = 0;
 	u32 bytes_read;
+	int reads = 0;
+	int ret = 0;
 	u8 *cp;
 
 	/* Allocate rx SKB if we don't have one available. */
@@ -305,6 +442,8 @@ qcaspi_receive(struct qcaspi *qca)
 		}
 	}
 
+	__skb_queue_head_init(&rxq);
+
 	/* Read the packet size. */
 	qcaspi_read_register(qca, SPI_REG_RDBUF_BYTE_AVA, &available);
 	netdev_dbg(net_dev, "qcaspi_receive: SPI_REG_RDBUF_BYTE_AVA: Value: %08x\n",
@@ -315,6 +454,7 @@ qcaspi_receive(struct qcaspi *qca)
 		return -1;
 	}
 
+next_read:
 	qcaspi_write_register(qca, SPI_REG_BFR_SIZE, available);
 
 	if (qca->legacy_mode)
@@ -341,7 +481,8 @@ qcaspi_receive(struct qcaspi *qca)
 			available -= bytes_read;
 		} else {
 			qca->stats.read_err++;
-			return -1;
+			ret = -1;
+			goto out;
 		}
 
 		cp = qca->rx_buffer;
@@ -376,7 +517,7 @@ qcaspi_receive(struct qcaspi *qca)
 				qca->rx_skb->protocol = eth_type_trans(
 					qca->rx_skb, qca->rx_skb->dev);
 				qca->rx_skb->ip_summed = CHECKSUM_UNNECESSARY;
-				netif_rx_ni(qca->rx_skb);
+				__skb_queue_tail(&rxq, qca->rx_skb);
 				qca->rx_skb = netdev_alloc_skb(net_dev,
 					net_dev->mtu + VLAN_ETH_HLEN);
 				if (!qca->rx_skb) {
@@ -389,7 +530,20 @@ qcaspi_receive(struct qcaspi *qca)
 		}
 	}
 
-	return 0;
+	/* Frames that arrived meanwhile are read right away, which is
+	 * cheaper than another round of interrupt handling.
+	 */
+	if (qca->rx_skb && ++reads < QCASPI_RX_MAX_READS) {
+		available = 0;
+		qcaspi_read_register(qca, SPI_REG_RDBUF_BYTE_AVA, &available);
+		if (available)
+			goto next_read;
+	}
+
+out:
+	qcaspi_rx_deliver(&rxq);
+
+	return ret;
 }
 
 /*   Check that tx ring stores only so much bytes
@@ -428,6 +582,7 @@ qcaspi_flush_tx_ring(struct qcaspi *qca)
 	qca->txr.tail = 0;
 	qca->txr.head = 0;
 	qca->txr.size = 0;
+	qca->tx_wait = false;
 	netif_tx_unlock_bh(qca->net_dev);
 }
 
@@ -516,9 +671,12 @@ qcaspi_spi_thread(void *data)
 	while (!kthread_should_stop()) {
 		set_current_state(TASK_INTERRUPTIBLE);
 		if ((qca->intr_req == qca->intr_svc) &&
-		    (qca->txr.skb[qca->txr.head] == NULL) &&
-		    (qca->sync == QCASPI_SYNC_READY))
-			schedule();
+		    (qca->sync == QCASPI_SYNC_READY)) {
+			if (qca->txr.skb[qca->txr.head] == NULL)
+				schedule();
+			else if (qca->tx_wait)
+				schedule_timeout(QCASPI_TX_WAIT_TIMEOUT);
+		}
 
 		set_current_state(TASK_RUNNING);
 
@@ -549,6 +707,9 @@ qcaspi_spi_thread(void *data)
 					continue;
 
 				qca->stats.device_reset++;
+				qcaspi_write_register(qca,
+						      SPI_REG_WRBUF_WATERMARK,
+						      QCASPI_WRBUF_WM);
 				netif_wake_queue(qca->net_dev);
 				netif_carrier_on(qca->net_dev);
 			}
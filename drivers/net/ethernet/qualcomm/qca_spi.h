@@ -88,6 +88,13 @@ struct qcaspi {
 	struct spi_transfer spi_xfer1;
 	struct spi_transfer spi_xfer2[2];
 
+	/* multi frame burst: command plus one transfer per ring entry */
+	struct spi_message spi_msg_tx;
+	struct spi_transfer spi_xfer_tx[TX_RING_MAX_LEN + 1];
+	__be16 tx_cmd;
+	/* waiting for SPI_INT_WRBUF_BELOW_WM to transmit */
+	bool tx_wait;
+
 	u8 *rx_buffer;
 	u32 buffer_size;
 	u8 sync;
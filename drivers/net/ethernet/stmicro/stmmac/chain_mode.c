@@ -30,10 +30,11 @@
 
 static int stmmac_jumbo_frm(void *p, struct sk_buff *skb, int csum)
 {
-	struct stmmac_priv *priv = (struct stmmac_priv *)p;
+	struct stmmac_channel *ch = (struct stmmac_channel *)p;
+	struct stmmac_priv *priv = ch->priv;
 	unsigned int txsize = priv->dma_tx_size;
-	unsigned int entry = priv->cur_tx % txsize;
-	struct dma_desc *desc = priv->dma_tx + entry;
+	unsigned int entry = ch->cur_tx % txsize;
+	struct dma_desc *desc = ch->dma_tx + entry;
 	unsigned int nopaged_len = skb_headlen(skb);
 	unsigned int bmax;
 	unsigned int i = 1, len;
@@ -49,13 +50,13 @@ static int stmmac_jumbo_frm(void *p, struct sk_buff *skb, int csum)
 				    bmax, DMA_TO_DEVICE);
 	if (dma_mapping_error(priv->device, desc->des2))
 		return -1;
-	priv->tx_skbuff_dma[entry].buf = desc->des2;
+	ch->tx_skbuff_dma[entry].buf = desc->des2;
 	priv->hw->desc->prepare_tx_desc(desc, 1, bmax, csum, STMMAC_CHAIN_MODE);
 
 	while (len != 0) {
-		priv->tx_skbuff[entry] = NULL;
-		entry = (++priv->cur_tx) % txsize;
-		desc = priv->dma_tx + entry;
+		ch->tx_skbuff[entry] = NULL;
+		entry = (++ch->cur_tx) % txsize;
+		desc = ch->dma_tx + entry;
 
 		if (len > bmax) {
 			desc->des2 = dma_map_single(priv->device,
@@ -63,7 +64,7 @@ static int stmmac_jumbo_frm(void *p, struct sk_buff *skb, int csum)
 						    bmax, DMA_TO_DEVICE);
 			if (dma_mapping_error(priv->device, desc->des2))
 				return -1;
-			priv->tx_skbuff_dma[entry].buf = desc->des2;
+			ch->tx_skbuff_dma[entry].buf = desc->des2;
 			priv->hw->desc->prepare_tx_desc(desc, 0, bmax, csum,
 							STMMAC_CHAIN_MODE);
 			priv->hw->desc->set_tx_owner(desc);
@@ -75,7 +76,7 @@ static int stmmac_jumbo_frm(void *p, struct sk_buff *skb, int csum)
 						    DMA_TO_DEVICE);
 			if (dma_mapping_error(priv->device, desc->des2))
 				return -1;
-			priv->tx_skbuff_dma[entry].buf = desc->des2;
+			ch->tx_skbuff_dma[entry].buf = desc->des2;
 			priv->hw->desc->prepare_tx_desc(desc, 0, len, csum,
 							STMMAC_CHAIN_MODE);
 			priv->hw->desc->set_tx_owner(desc);
@@ -127,32 +128,34 @@ static void stmmac_init_dma_chain(void *des, dma_addr_t phy_addr,
 	}
 }
 
-static void stmmac_refill_desc3(void *priv_ptr, struct dma_desc *p)
+static void stmmac_refill_desc3(void *chan, struct dma_desc *p)
 {
-	struct stmmac_priv *priv = (struct stmmac_priv *)priv_ptr;
+	struct stmmac_channel *ch = (struct stmmac_channel *)chan;
+	struct stmmac_priv *priv = ch->priv;
 
 	if (priv->hwts_rx_en && !priv->extend_desc)
 		/* NOTE: Device will overwrite des3 with timestamp value if
 		 * 1588-2002 time stamping is enabled, hence reinitialize it
 		 * to keep explicit chaining in the descriptor.
 		 */
-		p->des3 = (unsigned int)(priv->dma_rx_phy +
-					 (((priv->dirty_rx) + 1) %
+		p->des3 = (unsigned int)(ch->dma_rx_phy +
+					 (((ch->dirty_rx) + 1) %
 					  priv->dma_rx_size) *
 					 sizeof(struct dma_desc));
 }
 
-static void stmmac_clean_desc3(void *priv_ptr, struct dma_desc *p)
+static void stmmac_clean_desc3(void *chan, struct dma_desc *p)
 {
-	struct stmmac_priv *priv = (struct stmmac_priv *)priv_ptr;
+	struct stmmac_channel *ch = (struct stmmac_channel *)chan;
+	struct stmmac_priv *priv = ch->priv;
 
 	if (priv->hw->desc->get_tx_ls(p) && !priv->extend_desc)
 		/* NOTE: Device will overwrite des3 with timestamp value if
 		 * 1588-2002 time stamping is enabled, hence reinitialize it
 		 * to keep explicit chaining in the descriptor.
 		 */
-		p->des3 = (unsigned int)(priv->dma_tx_phy +
-					 (((priv->dirty_tx + 1) %
+		p->des3 = (unsigned int)(ch->dma_tx_phy +
+					 (((ch->dirty_tx + 1) %
 					   priv->dma_tx_size) *
 					  sizeof(struct dma_desc)));
 }
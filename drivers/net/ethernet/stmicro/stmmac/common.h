@@ -93,10 +93,20 @@ struct stmmac_extra_stats {
 	unsigned long normal_irq_n;
 	unsigned long rx_normal_irq_n;
 	unsigned long napi_poll;
+	unsigned long busy_poll;
 	unsigned long tx_normal_irq_n;
 	unsigned long tx_clean;
 	unsigned long tx_reset_ic_bit;
+	unsigned long tx_tso_frames;
+	unsigned long tx_tso_segs;
 	unsigned long irq_receive_pmt_irq_n;
+	/* RX buffer recycling */
+	unsigned long rx_page_reuse;
+	unsigned long rx_page_alloc;
+	unsigned long rx_copybreak;
+	/* Adaptive coalescing */
+	unsigned long rx_coal_update;
+	unsigned long tx_coal_update;
 	/* MMC info */
 	unsigned long mmc_tx_irq_n;
 	unsigned long mmc_rx_irq_n;
@@ -197,6 +207,11 @@ struct stmmac_extra_stats {
 #define DMA_HW_FEAT_ACTPHYIF	0x70000000	/* Active/selected PHY iface */
 #define DEFAULT_DMA_PBL		8
 
+/* The DMA registers of the additional channels (AV feature) follow the
+ * ones of channel 0 at this stride
+ */
+#define DMA_CHAN_OFFSET(chan)	((chan) * 0x100)
+
 /* Max/Min RI Watchdog Timer count value */
 #define MAX_DMA_RIWT		0xff
 #define MIN_DMA_RIWT		0x20
@@ -353,6 +368,11 @@ struct stmmac_dma_ops {
 	/* DMA core initialization */
 	int (*init) (void __iomem *ioaddr, int pbl, int fb, int mb,
 		     int burst_len, u32 dma_tx, u32 dma_rx, int atds);
+	/* Initialization of the additional DMA channels (if any), ioaddr
+	 * is shifted by DMA_CHAN_OFFSET() as for all the per channel ops
+	 */
+	void (*init_chan)(void __iomem *ioaddr, int pbl, int fb, int mb,
+			  u32 dma_tx, u32 dma_rx, int atds);
 	/* Dump DMA registers */
 	void (*dump_regs) (void __iomem *ioaddr);
 	/* Set tx/rx threshold in the csr6 register
@@ -439,11 +459,12 @@ struct stmmac_mode_ops {
 	void (*init) (void *des, dma_addr_t phy_addr, unsigned int size,
 		      unsigned int extend_desc);
 	unsigned int (*is_jumbo_frm) (int len, int ehn_desc);
-	int (*jumbo_frm)(void *priv, struct sk_buff *skb, int csum);
+	/* the void pointers are the struct stmmac_channel of the ring */
+	int (*jumbo_frm)(void *chan, struct sk_buff *skb, int csum);
 	int (*set_16kib_bfsize)(int mtu);
 	void (*init_desc3)(struct dma_desc *p);
-	void (*refill_desc3) (void *priv, struct dma_desc *p);
-	void (*clean_desc3) (void *priv, struct dma_desc *p);
+	void (*refill_desc3) (void *chan, struct dma_desc *p);
+	void (*clean_desc3) (void *chan, struct dma_desc *p);
 };
 
 struct mac_device_info {
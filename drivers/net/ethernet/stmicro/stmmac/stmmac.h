@@ -34,12 +34,17 @@
 #include <linux/ptp_clock_kernel.h>
 #include <linux/reset.h>
 
+/* DMA channels (TX/RX ring pairs) the driver can drive */
+#define STMMAC_MAX_CHANNELS	4
+
 struct stmmac_resources {
 	void __iomem *addr;
 	const char *mac;
 	int wol_irq;
 	int lpi_irq;
 	int irq;
+	/* optional dedicated IRQs of the channels >= 1 */
+	int chan_irq[STMMAC_MAX_CHANNELS];
 };
 
 struct stmmac_tx_info {
@@ -47,40 +52,113 @@ struct stmmac_tx_info {
 	bool map_as_page;
 };
 
-struct stmmac_priv {
+/* RX buffer carved out of a page that stays DMA mapped while the driver
+ * keeps recycling it, see stmmac_rx_reuse_page()
+ */
+struct stmmac_rx_buffer {
+	struct page *page;
+	dma_addr_t dma;
+	unsigned int page_offset;
+};
+
+/* Room in front of the received frame, as netdev_alloc_skb_ip_align()
+ * would leave it
+ */
+#define STMMAC_RX_HEADROOM	(NET_SKB_PAD + NET_IP_ALIGN)
+
+/* Adaptive interrupt moderation of one direction of a channel: the
+ * traffic is sampled over a window of NAPI polls and the profile moved
+ * one step at a time towards the one giving the best rates.
+ */
+#define STMMAC_COAL_PROFILES	5
+
+struct stmmac_coal_stats {
+	u32 ppms;	/* packets per msec */
+	u32 bpms;	/* bytes per msec */
+	u32 epms;	/* interrupt events per msec */
+};
+
+struct stmmac_coal {
+	ktime_t start;
+	unsigned long start_pkts;
+	unsigned long start_bytes;
+	unsigned int start_events;
+	struct stmmac_coal_stats prev;
+	unsigned int profile;
+	int step;	/* +1 to throughput, -1 to latency, 0 parked */
+};
+
+struct stmmac_priv;
+
+/* A DMA channel: one TX and one RX ring, served by their own NAPI context
+ * and, if the platform wires it, their own IRQ. Channel 0 is the one of
+ * the older single channel cores.
+ */
+struct stmmac_channel {
 	/* Frequently used values are kept adjacent for cache effect */
 	struct dma_extended_desc *dma_etx ____cacheline_aligned_in_smp;
 	struct dma_desc *dma_tx;
 	struct sk_buff **tx_skbuff;
 	unsigned int cur_tx;
 	unsigned int dirty_tx;
-	unsigned int dma_tx_size;
 	u32 tx_count_frames;
-	u32 tx_coal_frames;
-	u32 tx_coal_timer;
 	struct stmmac_tx_info *tx_skbuff_dma;
 	dma_addr_t dma_tx_phy;
-	int tx_coalesce;
-	int hwts_tx_en;
 	spinlock_t tx_lock;
-	bool tx_path_in_lpi_mode;
 	struct timer_list txtimer;
+	u32 tx_coal_frames;
+	u32 tx_coal_timer;
+	unsigned long tx_pkts;
+	unsigned long tx_bytes;
+	/* STMMAC_TSO_HDR_SIZE bytes of header per TX descriptor */
+	char *tso_hdrs;
+	dma_addr_t tso_hdrs_phy;
 
 	struct dma_desc *dma_rx	____cacheline_aligned_in_smp;
 	struct dma_extended_desc *dma_erx;
 	struct sk_buff **rx_skbuff;
 	unsigned int cur_rx;
 	unsigned int dirty_rx;
-	unsigned int dma_rx_size;
-	unsigned int dma_buf_sz;
-	u32 rx_riwt;
-	int hwts_rx_en;
 	dma_addr_t *rx_skbuff_dma;
 	dma_addr_t dma_rx_phy;
+	struct stmmac_rx_buffer *rx_buf;
+	unsigned long rx_pkts;
+	unsigned long rx_bytes;
 
 	struct napi_struct napi ____cacheline_aligned_in_smp;
+	unsigned int coal_polls;
+	unsigned int coal_events;
+	bool busy_polling;
+	struct stmmac_coal rx_coal;
+	struct stmmac_coal tx_coal;
+	struct stmmac_priv *priv;
+	void __iomem *ioaddr;	/* DMA registers of the channel */
+	unsigned int index;
+	int irq;
+	char irq_name[IFNAMSIZ + 8];
+};
+
+struct stmmac_priv {
+	struct stmmac_channel chan[STMMAC_MAX_CHANNELS];
+	unsigned int num_chans;
+
+	unsigned int dma_tx_size;
+	u32 tx_coal_frames;
+	u32 tx_coal_timer;
+	int tx_coalesce;
+	bool adaptive_tx_coal;
+	bool adaptive_rx_coal;
+	int hwts_tx_en;
+	bool tx_path_in_lpi_mode;
+
+	unsigned int dma_rx_size;
+	unsigned int dma_buf_sz;
+	u32 rx_riwt;
+	int hwts_rx_en;
+	/* page buffers, used instead of rx_skbuff when not zero */
+	unsigned int rx_buf_truesize;
 
-	void __iomem *ioaddr;
+	void __iomem *ioaddr ____cacheline_aligned_in_smp;
 	struct net_device *dev;
 	struct device *device;
 	struct mac_device_info *hw;
@@ -95,10 +95,20 @@ static const struct stmmac_stats stmmac_gstrings_stats[] = {
 	STMMAC_STAT(normal_irq_n),
 	STMMAC_STAT(rx_normal_irq_n),
 	STMMAC_STAT(napi_poll),
+	STMMAC_STAT(busy_poll),
 	STMMAC_STAT(tx_normal_irq_n),
 	STMMAC_STAT(tx_clean),
 	STMMAC_STAT(tx_reset_ic_bit),
+	STMMAC_STAT(tx_tso_frames),
+	STMMAC_STAT(tx_tso_segs),
 	STMMAC_STAT(irq_receive_pmt_irq_n),
+	/* RX buffer recycling */
+	STMMAC_STAT(rx_page_reuse),
+	STMMAC_STAT(rx_page_alloc),
+	STMMAC_STAT(rx_copybreak),
+	/* Adaptive coalescing */
+	STMMAC_STAT(rx_coal_update),
+	STMMAC_STAT(tx_coal_update),
 	/* MMC info */
 	STMMAC_STAT(mmc_tx_irq_n),
 	STMMAC_STAT(mmc_rx_irq_n),
@@ -666,6 +676,9 @@ static int stmmac_get_coalesce(struct net_device *dev,
 	if (priv->use_riwt)
 		ec->rx_coalesce_usecs = stmmac_riwt2usec(priv->rx_riwt, priv);
 
+	ec->use_adaptive_rx_coalesce = priv->adaptive_rx_coal;
+	ec->use_adaptive_tx_coalesce = priv->adaptive_tx_coal;
+
 	return 0;
 }
 
@@ -674,11 +687,11 @@ static int stmmac_set_coalesce(struct net_device *dev,
 {
 	struct stmmac_priv *priv = netdev_priv(dev);
 	unsigned int rx_riwt;
+	int i;
 
 	/* Check not supported parameters  */
 	if ((ec->rx_max_coalesced_frames) || (ec->rx_coalesce_usecs_irq) ||
 	    (ec->rx_max_coalesced_frames_irq) || (ec->tx_coalesce_usecs_irq) ||
-	    (ec->use_adaptive_rx_coalesce) || (ec->use_adaptive_tx_coalesce) ||
 	    (ec->pkt_rate_low) || (ec->rx_coalesce_usecs_low) ||
 	    (ec->rx_max_coalesced_frames_low) || (ec->tx_coalesce_usecs_high) ||
 	    (ec->tx_max_coalesced_frames_low) || (ec->pkt_rate_high) ||
@@ -707,11 +720,25 @@ static int stmmac_set_coalesce(struct net_device *dev,
 	else if (!priv->use_riwt)
 		return -EOPNOTSUPP;
 
-	/* Only copy relevant parameters, ignore all others. */
+	/* Only copy relevant parameters, ignore all others. The static
+	 * values are the ones used while the adaptive mode is off, the
+	 * adaptive one starts from the default profile.
+	 */
 	priv->tx_coal_frames = ec->tx_max_coalesced_frames;
 	priv->tx_coal_timer = ec->tx_coalesce_usecs;
 	priv->rx_riwt = rx_riwt;
-	priv->hw->dma->rx_watchdog(priv->ioaddr, priv->rx_riwt);
+	priv->adaptive_rx_coal = !!ec->use_adaptive_rx_coalesce;
+	priv->adaptive_tx_coal = !!ec->use_adaptive_tx_coalesce;
+	for (i = 0; i < priv->num_chans; i++) {
+		struct stmmac_channel *ch = &priv->chan[i];
+
+		if (!priv->adaptive_rx_coal)
+			priv->hw->dma->rx_watchdog(ch->ioaddr, priv->rx_riwt);
+		if (!priv->adaptive_tx_coal) {
+			ch->tx_coal_frames = priv->tx_coal_frames;
+			ch->tx_coal_timer = priv->tx_coal_timer;
+		}
+	}
 
 	return 0;
 }
@@ -49,6 +49,8 @@
 #include <linux/seq_file.h>
 #endif /* CONFIG_DEBUG_FS */
 #include <linux/net_tstamp.h>
+#include <net/tso.h>
+#include <net/busy_poll.h>
 #include "stmmac_ptp.h"
 #include "stmmac.h"
 #include <linux/reset.h>
@@ -98,6 +100,11 @@ static int buf_sz = DEFAULT_BUFSIZE;
 module_param(buf_sz, int, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(buf_sz, "DMA buffer size");
 
+#define STMMAC_RX_COPYBREAK	256
+static int copybreak = STMMAC_RX_COPYBREAK;
+module_param(copybreak, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(copybreak, "Copy RX frames up to this size instead of passing the buffer up");
+
 static const u32 default_msg_level = (NETIF_MSG_DRV | NETIF_MSG_PROBE |
 				      NETIF_MSG_LINK | NETIF_MSG_IFUP |
 				      NETIF_MSG_IFDOWN | NETIF_MSG_TIMER);
@@ -116,6 +123,7 @@ module_param(chain_mode, int, S_IRUGO);
 MODULE_PARM_DESC(chain_mode, "To use chain instead of ring mode");
 
 static irqreturn_t stmmac_interrupt(int irq, void *dev_id);
+static irqreturn_t stmmac_chan_interrupt(int irq, void *dev_id);
 
 #ifdef CONFIG_DEBUG_FS
 static int stmmac_init_fs(struct net_device *dev);
@@ -199,9 +207,42 @@ static void print_pkt(unsigned char *buf, int len)
 /* minimum number of free TX descriptors required to wake up TX process */
 #define STMMAC_TX_THRESH(x)	(x->dma_tx_size/4)
 
-static inline u32 stmmac_tx_avail(struct stmmac_priv *priv)
+/* The TSO path needs a header and at least one data descriptor per
+ * segment, plus one per fragment boundary crossed. The headers are built
+ * in a per ring buffer of STMMAC_TSO_HDR_SIZE bytes per descriptor.
+ */
+#define STMMAC_TSO_HDR_SIZE	128
+#define STMMAC_TSO_MAX_SEGS	32
+#define STMMAC_TSO_MAX_DESCS	(STMMAC_TSO_MAX_SEGS * 2 + MAX_SKB_FRAGS)
+
+static inline u32 stmmac_tx_avail(struct stmmac_channel *ch)
+{
+	return ch->dirty_tx + ch->priv->dma_tx_size - ch->cur_tx - 1;
+}
+
+/* Free descriptors below which the queue is stopped: room for the worst
+ * case skb the stack can send
+ */
+static inline u32 stmmac_tx_stop_thresh(struct stmmac_priv *priv)
+{
+	if (priv->dev->features & (NETIF_F_TSO | NETIF_F_TSO6))
+		return STMMAC_TSO_MAX_DESCS;
+
+	return MAX_SKB_FRAGS + 1;
+}
+
+static inline u32 stmmac_tx_wake_thresh(struct stmmac_priv *priv)
+{
+	return max_t(u32, STMMAC_TX_THRESH(priv), stmmac_tx_stop_thresh(priv));
+}
+
+static inline struct dma_desc *stmmac_tx_desc(struct stmmac_channel *ch,
+					      unsigned int entry)
 {
-	return priv->dirty_tx + priv->dma_tx_size - priv->cur_tx - 1;
+	if (ch->priv->extend_desc)
+		return (struct dma_desc *)(ch->dma_etx + entry);
+
+	return ch->dma_tx + entry;
 }
 
 /**
@@ -226,9 +267,14 @@ static inline void stmmac_hw_fix_mac_speed(struct stmmac_priv *priv)
  */
 static void stmmac_enable_eee_mode(struct stmmac_priv *priv)
 {
-	/* Check and enter in LPI mode */
-	if ((priv->dirty_tx == priv->cur_tx) &&
-	    (priv->tx_path_in_lpi_mode == false))
+	int i;
+
+	/* Check and enter in LPI mode, all the TX rings have to be idle */
+	for (i = 0; i < priv->num_chans; i++)
+		if (priv->chan[i].dirty_tx != priv->chan[i].cur_tx)
+			return;
+
+	if (priv->tx_path_in_lpi_mode == false)
 		priv->hw->mac->set_eee_mode(priv->hw);
 }
 
@@ -334,16 +380,17 @@ out:
 }
 
 /* stmmac_get_tx_hwtstamp - get HW TX timestamps
- * @priv: driver private structure
+ * @ch: DMA channel
  * @entry : descriptor index to be used.
  * @skb : the socket buffer
  * Description :
  * This function will read timestamp from the descriptor & pass it to stack.
  * and also perform some sanity checks.
  */
-static void stmmac_get_tx_hwtstamp(struct stmmac_priv *priv,
+static void stmmac_get_tx_hwtstamp(struct stmmac_channel *ch,
 				   unsigned int entry, struct sk_buff *skb)
 {
+	struct stmmac_priv *priv = ch->priv;
 	struct skb_shared_hwtstamps shhwtstamp;
 	u64 ns;
 	void *desc = NULL;
@@ -356,9 +403,9 @@ static void stmmac_get_tx_hwtstamp(struct stmmac_priv *priv,
 		return;
 
 	if (priv->adv_ts)
-		desc = (priv->dma_etx + entry);
+		desc = (ch->dma_etx + entry);
 	else
-		desc = (priv->dma_tx + entry);
+		desc = (ch->dma_tx + entry);
 
 	/* check tx tstamp status */
 	if (!priv->hw->desc->get_tx_timestamp_status((struct dma_desc *)desc))
@@ -376,16 +423,17 @@ static void stmmac_get_tx_hwtstamp(struct stmmac_priv *priv,
 }
 
 /* stmmac_get_rx_hwtstamp - get HW RX timestamps
- * @priv: driver private structure
+ * @ch: DMA channel
  * @entry : descriptor index to be used.
  * @skb : the socket buffer
  * Description :
  * This function will read received packet's timestamp from the descriptor
  * and pass it to stack. It also perform some sanity checks.
  */
-static void stmmac_get_rx_hwtstamp(struct stmmac_priv *priv,
+static void stmmac_get_rx_hwtstamp(struct stmmac_channel *ch,
 				   unsigned int entry, struct sk_buff *skb)
 {
+	struct stmmac_priv *priv = ch->priv;
 	struct skb_shared_hwtstamps *shhwtstamp = NULL;
 	u64 ns;
 	void *desc = NULL;
@@ -394,9 +442,9 @@ static void stmmac_get_rx_hwtstamp(struct stmmac_priv *priv,
 		return;
 
 	if (priv->adv_ts)
-		desc = (priv->dma_erx + entry);
+		desc = (ch->dma_erx + entry);
 	else
-		desc = (priv->dma_rx + entry);
+		desc = (ch->dma_rx + entry);
 
 	/* exit if rx tstamp is not valid */
 	if (!priv->hw->desc->get_rx_timestamp_status(desc, priv->adv_ts))
@@ -911,17 +959,22 @@ static void stmmac_display_rings(struct stmmac_priv *priv)
 {
 	unsigned int txsize = priv->dma_tx_size;
 	unsigned int rxsize = priv->dma_rx_size;
+	int i;
 
-	if (priv->extend_desc) {
-		pr_info("Extended RX descriptor ring:\n");
-		stmmac_display_ring((void *)priv->dma_erx, rxsize, 1);
-		pr_info("Extended TX descriptor ring:\n");
-		stmmac_display_ring((void *)priv->dma_etx, txsize, 1);
-	} else {
-		pr_info("RX descriptor ring:\n");
-		stmmac_display_ring((void *)priv->dma_rx, rxsize, 0);
-		pr_info("TX descriptor ring:\n");
-		stmmac_display_ring((void *)priv->dma_tx, txsize, 0);
+	for (i = 0; i < priv->num_chans; i++) {
+		struct stmmac_channel *ch = &priv->chan[i];
+
+		if (priv->extend_desc) {
+			pr_info("Channel %d extended RX descriptor ring:\n", i);
+			stmmac_display_ring((void *)ch->dma_erx, rxsize, 1);
+			pr_info("Channel %d extended TX descriptor ring:\n", i);
+			stmmac_display_ring((void *)ch->dma_etx, txsize, 1);
+		} else {
+			pr_info("Channel %d RX descriptor ring:\n", i);
+			stmmac_display_ring((void *)ch->dma_rx, rxsize, 0);
+			pr_info("Channel %d TX descriptor ring:\n", i);
+			stmmac_display_ring((void *)ch->dma_tx, txsize, 0);
+		}
 	}
 }
 
@@ -949,61 +1002,202 @@ static int stmmac_set_bfsize(int mtu, int bufsize)
  */
 static void stmmac_clear_descriptors(struct stmmac_priv *priv)
 {
-	int i;
+	int i, j;
 	unsigned int txsize = priv->dma_tx_size;
 	unsigned int rxsize = priv->dma_rx_size;
 
 	/* Clear the Rx/Tx descriptors */
-	for (i = 0; i < rxsize; i++)
-		if (priv->extend_desc)
-			priv->hw->desc->init_rx_desc(&priv->dma_erx[i].basic,
-						     priv->use_riwt, priv->mode,
-						     (i == rxsize - 1));
-		else
-			priv->hw->desc->init_rx_desc(&priv->dma_rx[i],
-						     priv->use_riwt, priv->mode,
-						     (i == rxsize - 1));
-	for (i = 0; i < txsize; i++)
-		if (priv->extend_desc)
-			priv->hw->desc->init_tx_desc(&priv->dma_etx[i].basic,
-						     priv->mode,
-						     (i == txsize - 1));
-		else
-			priv->hw->desc->init_tx_desc(&priv->dma_tx[i],
-						     priv->mode,
-						     (i == txsize - 1));
+	for (j = 0; j < priv->num_chans; j++) {
+		struct stmmac_channel *ch = &priv->chan[j];
+
+		for (i = 0; i < rxsize; i++)
+			if (priv->extend_desc)
+				priv->hw->desc->init_rx_desc(&ch->dma_erx[i].basic,
+							     priv->use_riwt,
+							     priv->mode,
+							     (i == rxsize - 1));
+			else
+				priv->hw->desc->init_rx_desc(&ch->dma_rx[i],
+							     priv->use_riwt,
+							     priv->mode,
+							     (i == rxsize - 1));
+		for (i = 0; i < txsize; i++)
+			if (priv->extend_desc)
+				priv->hw->desc->init_tx_desc(&ch->dma_etx[i].basic,
+							     priv->mode,
+							     (i == txsize - 1));
+			else
+				priv->hw->desc->init_tx_desc(&ch->dma_tx[i],
+							     priv->mode,
+							     (i == txsize - 1));
+	}
 }
 
 /**
- * stmmac_init_rx_buffers - init the RX descriptor buffer.
+ * stmmac_rx_truesize - size of the RX page buffers
+ * @bfsize: DMA buffer size
+ * Description: the frame, its headroom and the skb_shared_info that
+ * build_skb() appends have to fit in half a page, so that the two halves
+ * can be flipped, or else in a whole page. Returns 0 if they don't; the
+ * RX path then uses pre-allocated skbs (jumbo frames).
+ */
+static unsigned int stmmac_rx_truesize(unsigned int bfsize)
+{
+	unsigned int size = SKB_DATA_ALIGN(STMMAC_RX_HEADROOM + bfsize) +
+			    SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+
+	if (size <= PAGE_SIZE / 2)
+		return PAGE_SIZE / 2;
+	if (size <= PAGE_SIZE)
+		return PAGE_SIZE;
+	return 0;
+}
+
+/**
+ * stmmac_rx_map_buffer - give a page buffer (back) to the DMA
+ * @priv: driver private structure
+ * @p: descriptor pointer
+ * @buf: RX buffer of the descriptor
+ * @flags: gfp flag.
+ * Description: a new page is only allocated and mapped if the buffer lost
+ * its page to the stack; a recycled one just gets synced for the device.
+ */
+static int stmmac_rx_map_buffer(struct stmmac_priv *priv, struct dma_desc *p,
+				struct stmmac_rx_buffer *buf, gfp_t flags)
+{
+	if (!buf->page) {
+		struct page *page = __dev_alloc_page(flags);
+
+		if (!page)
+			return -ENOMEM;
+
+		buf->dma = dma_map_page(priv->device, page, 0, PAGE_SIZE,
+					DMA_FROM_DEVICE);
+		if (dma_mapping_error(priv->device, buf->dma)) {
+			__free_page(page);
+			return -EINVAL;
+		}
+		buf->page = page;
+		buf->page_offset = 0;
+		priv->xstats.rx_page_alloc++;
+	} else {
+		dma_sync_single_range_for_device(priv->device, buf->dma,
+						 buf->page_offset +
+						 STMMAC_RX_HEADROOM,
+						 priv->dma_buf_sz,
+						 DMA_FROM_DEVICE);
+	}
+
+	p->des2 = buf->dma + buf->page_offset + STMMAC_RX_HEADROOM;
+
+	return 0;
+}
+
+/**
+ * stmmac_rx_reuse_page - keep the page of a buffer passed to the stack
  * @priv: driver private structure
+ * @buf: RX buffer
+ * Description: the skb built around the buffer now owns the page reference
+ * of the ring. If nobody holds the other half of the page anymore, take a
+ * new reference and flip to that half, so the page stays mapped. Otherwise
+ * the page is left to the stack and the refill allocates a new one.
+ */
+static void stmmac_rx_reuse_page(struct stmmac_priv *priv,
+				 struct stmmac_rx_buffer *buf)
+{
+	struct page *page = buf->page;
+
+	if (priv->rx_buf_truesize == PAGE_SIZE || page_count(page) != 1 ||
+	    page_is_pfmemalloc(page) || page_to_nid(page) != numa_mem_id()) {
+		dma_unmap_page(priv->device, buf->dma, PAGE_SIZE,
+			       DMA_FROM_DEVICE);
+		buf->page = NULL;
+		return;
+	}
+
+	get_page(page);
+	buf->page_offset ^= priv->rx_buf_truesize;
+	priv->xstats.rx_page_reuse++;
+}
+
+/**
+ * stmmac_rx_page_skb - get the skb for a frame received in a page buffer
+ * @ch: DMA channel
+ * @entry: descriptor index
+ * @frame_len: frame length
+ * Description: small frames are copied, leaving the buffer in the ring,
+ * larger ones get an skb built around the buffer.
+ */
+static struct sk_buff *stmmac_rx_page_skb(struct stmmac_channel *ch,
+					  unsigned int entry, int frame_len)
+{
+	struct stmmac_priv *priv = ch->priv;
+	struct stmmac_rx_buffer *buf = &ch->rx_buf[entry];
+	void *va = page_address(buf->page) + buf->page_offset;
+	struct sk_buff *skb;
+
+	dma_sync_single_range_for_cpu(priv->device, buf->dma,
+				      buf->page_offset + STMMAC_RX_HEADROOM,
+				      frame_len, DMA_FROM_DEVICE);
+	prefetch(va + STMMAC_RX_HEADROOM);
+
+	if (frame_len <= copybreak) {
+		skb = napi_alloc_skb(&ch->napi, frame_len);
+		if (unlikely(!skb))
+			return NULL;
+
+		memcpy(__skb_put(skb, frame_len), va + STMMAC_RX_HEADROOM,
+		       frame_len);
+		priv->xstats.rx_copybreak++;
+		return skb;
+	}
+
+	skb = build_skb(va, priv->rx_buf_truesize);
+	if (unlikely(!skb))
+		return NULL;
+
+	skb_reserve(skb, STMMAC_RX_HEADROOM);
+	__skb_put(skb, frame_len);
+
+	stmmac_rx_reuse_page(priv, buf);
+
+	return skb;
+}
+
+/**
+ * stmmac_init_rx_buffers - init the RX descriptor buffer.
+ * @ch: DMA channel
  * @p: descriptor pointer
  * @i: descriptor index
  * @flags: gfp flag.
  * Description: this function is called to allocate a receive buffer, perform
  * the DMA mapping and init the descriptor.
  */
-static int stmmac_init_rx_buffers(struct stmmac_priv *priv, struct dma_desc *p,
+static int stmmac_init_rx_buffers(struct stmmac_channel *ch, struct dma_desc *p,
 				  int i, gfp_t flags)
 {
+	struct stmmac_priv *priv = ch->priv;
 	struct sk_buff *skb;
 
+	if (priv->rx_buf_truesize)
+		return stmmac_rx_map_buffer(priv, p, &ch->rx_buf[i], flags);
+
 	skb = __netdev_alloc_skb_ip_align(priv->dev, priv->dma_buf_sz, flags);
 	if (!skb) {
 		pr_err("%s: Rx init fails; skb is NULL\n", __func__);
 		return -ENOMEM;
 	}
-	priv->rx_skbuff[i] = skb;
-	priv->rx_skbuff_dma[i] = dma_map_single(priv->device, skb->data,
+	ch->rx_skbuff[i] = skb;
+	ch->rx_skbuff_dma[i] = dma_map_single(priv->device, skb->data,
 						priv->dma_buf_sz,
 						DMA_FROM_DEVICE);
-	if (dma_mapping_error(priv->device, priv->rx_skbuff_dma[i])) {
+	if (dma_mapping_error(priv->device, ch->rx_skbuff_dma[i])) {
 		pr_err("%s: DMA mapping error\n", __func__);
 		dev_kfree_skb_any(skb);
 		return -EINVAL;
 	}
 
-	p->des2 = priv->rx_skbuff_dma[i];
+	p->des2 = ch->rx_skbuff_dma[i];
 
 	if ((priv->hw->mode->init_desc3) &&
 	    (priv->dma_buf_sz == BUF_SIZE_16KiB))
@@ -1012,48 +1206,45 @@ static int stmmac_init_rx_buffers(struct stmmac_priv *priv, struct dma_desc *p,
 	return 0;
 }
 
-static void stmmac_free_rx_buffers(struct stmmac_priv *priv, int i)
+static void stmmac_free_rx_buffers(struct stmmac_channel *ch, int i)
 {
-	if (priv->rx_skbuff[i]) {
-		dma_unmap_single(priv->device, priv->rx_skbuff_dma[i],
+	struct stmmac_priv *priv = ch->priv;
+	struct stmmac_rx_buffer *buf = &ch->rx_buf[i];
+
+	if (buf->page) {
+		dma_unmap_page(priv->device, buf->dma, PAGE_SIZE,
+			       DMA_FROM_DEVICE);
+		put_page(buf->page);
+		buf->page = NULL;
+	}
+
+	if (ch->rx_skbuff[i]) {
+		dma_unmap_single(priv->device, ch->rx_skbuff_dma[i],
 				 priv->dma_buf_sz, DMA_FROM_DEVICE);
-		dev_kfree_skb_any(priv->rx_skbuff[i]);
+		dev_kfree_skb_any(ch->rx_skbuff[i]);
 	}
-	priv->rx_skbuff[i] = NULL;
+	ch->rx_skbuff[i] = NULL;
 }
 
 /**
- * init_dma_desc_rings - init the RX/TX descriptor rings
- * @dev: net device structure
+ * init_dma_chan_rings - init the RX/TX descriptor rings of a channel
+ * @ch: DMA channel
  * @flags: gfp flag.
- * Description: this function initializes the DMA RX/TX descriptors
- * and allocates the socket buffers. It suppors the chained and ring
- * modes.
+ * Description: this function allocates the receive buffers of the channel
+ * and links the descriptors in chain mode.
  */
-static int init_dma_desc_rings(struct net_device *dev, gfp_t flags)
+static int init_dma_chan_rings(struct stmmac_channel *ch, gfp_t flags)
 {
 	int i;
-	struct stmmac_priv *priv = netdev_priv(dev);
+	struct stmmac_priv *priv = ch->priv;
 	unsigned int txsize = priv->dma_tx_size;
 	unsigned int rxsize = priv->dma_rx_size;
-	unsigned int bfsize = 0;
-	int ret = -ENOMEM;
-
-	if (priv->hw->mode->set_16kib_bfsize)
-		bfsize = priv->hw->mode->set_16kib_bfsize(dev->mtu);
-
-	if (bfsize < BUF_SIZE_16KiB)
-		bfsize = stmmac_set_bfsize(dev->mtu, priv->dma_buf_sz);
-
-	priv->dma_buf_sz = bfsize;
-
-	if (netif_msg_probe(priv))
-		pr_debug("%s: txsize %d, rxsize %d, bfsize %d\n", __func__,
-			 txsize, rxsize, bfsize);
+	int ret;
 
 	if (netif_msg_probe(priv)) {
-		pr_debug("(%s) dma_rx_phy=0x%08x dma_tx_phy=0x%08x\n", __func__,
-			 (u32) priv->dma_rx_phy, (u32) priv->dma_tx_phy);
+		pr_debug("(%s) chan %d dma_rx_phy=0x%08x dma_tx_phy=0x%08x\n",
+			 __func__, ch->index, (u32) ch->dma_rx_phy,
+			 (u32) ch->dma_tx_phy);
 
 		/* RX INITIALIZATION */
 		pr_debug("\tSKB addresses:\nskb\t\tskb data\tdma data\n");
@@ -1061,34 +1252,33 @@ static int init_dma_desc_rings(struct net_device *dev, gfp_t flags)
 	for (i = 0; i < rxsize; i++) {
 		struct dma_desc *p;
 		if (priv->extend_desc)
-			p = &((priv->dma_erx + i)->basic);
+			p = &((ch->dma_erx + i)->basic);
 		else
-			p = priv->dma_rx + i;
+			p = ch->dma_rx + i;
 
-		ret = stmmac_init_rx_buffers(priv, p, i, flags);
+		ret = stmmac_init_rx_buffers(ch, p, i, flags);
 		if (ret)
 			goto err_init_rx_buffers;
 
-		if (netif_msg_probe(priv))
-			pr_debug("[%p]\t[%p]\t[%x]\n", priv->rx_skbuff[i],
-				 priv->rx_skbuff[i]->data,
-				 (unsigned int)priv->rx_skbuff_dma[i]);
+		if (netif_msg_probe(priv) && !priv->rx_buf_truesize)
+			pr_debug("[%p]\t[%p]\t[%x]\n", ch->rx_skbuff[i],
+				 ch->rx_skbuff[i]->data,
+				 (unsigned int)ch->rx_skbuff_dma[i]);
 	}
-	priv->cur_rx = 0;
-	priv->dirty_rx = (unsigned int)(i - rxsize);
-	buf_sz = bfsize;
+	ch->cur_rx = 0;
+	ch->dirty_rx = (unsigned int)(i - rxsize);
 
 	/* Setup the chained descriptor addresses */
 	if (priv->mode == STMMAC_CHAIN_MODE) {
 		if (priv->extend_desc) {
-			priv->hw->mode->init(priv->dma_erx, priv->dma_rx_phy,
+			priv->hw->mode->init(ch->dma_erx, ch->dma_rx_phy,
 					     rxsize, 1);
-			priv->hw->mode->init(priv->dma_etx, priv->dma_tx_phy,
+			priv->hw->mode->init(ch->dma_etx, ch->dma_tx_phy,
 					     txsize, 1);
 		} else {
-			priv->hw->mode->init(priv->dma_rx, priv->dma_rx_phy,
+			priv->hw->mode->init(ch->dma_rx, ch->dma_rx_phy,
 					     rxsize, 0);
-			priv->hw->mode->init(priv->dma_tx, priv->dma_tx_phy,
+			priv->hw->mode->init(ch->dma_tx, ch->dma_tx_phy,
 					     txsize, 0);
 		}
 	}
@@ -1097,144 +1287,199 @@ static int init_dma_desc_rings(struct net_device *dev, gfp_t flags)
 	for (i = 0; i < txsize; i++) {
 		struct dma_desc *p;
 		if (priv->extend_desc)
-			p = &((priv->dma_etx + i)->basic);
+			p = &((ch->dma_etx + i)->basic);
 		else
-			p = priv->dma_tx + i;
+			p = ch->dma_tx + i;
 		p->des2 = 0;
-		priv->tx_skbuff_dma[i].buf = 0;
-		priv->tx_skbuff_dma[i].map_as_page = false;
-		priv->tx_skbuff[i] = NULL;
+		ch->tx_skbuff_dma[i].buf = 0;
+		ch->tx_skbuff_dma[i].map_as_page = false;
+		ch->tx_skbuff[i] = NULL;
 	}
 
-	priv->dirty_tx = 0;
-	priv->cur_tx = 0;
-	netdev_reset_queue(priv->dev);
-
-	stmmac_clear_descriptors(priv);
-
-	if (netif_msg_hw(priv))
-		stmmac_display_rings(priv);
+	ch->dirty_tx = 0;
+	ch->cur_tx = 0;
+	netdev_tx_reset_queue(netdev_get_tx_queue(priv->dev, ch->index));
 
 	return 0;
 err_init_rx_buffers:
 	while (--i >= 0)
-		stmmac_free_rx_buffers(priv, i);
+		stmmac_free_rx_buffers(ch, i);
 	return ret;
 }
 
-static void dma_free_rx_skbufs(struct stmmac_priv *priv)
+static void dma_free_rx_skbufs(struct stmmac_channel *ch)
 {
 	int i;
 
-	for (i = 0; i < priv->dma_rx_size; i++)
-		stmmac_free_rx_buffers(priv, i);
+	for (i = 0; i < ch->priv->dma_rx_size; i++)
+		stmmac_free_rx_buffers(ch, i);
 }
 
-static void dma_free_tx_skbufs(struct stmmac_priv *priv)
+/**
+ * init_dma_desc_rings - init the RX/TX descriptor rings
+ * @dev: net device structure
+ * @flags: gfp flag.
+ * Description: this function initializes the DMA RX/TX descriptors
+ * and allocates the socket buffers of all the channels. It suppors the
+ * chained and ring modes.
+ */
+static int init_dma_desc_rings(struct net_device *dev, gfp_t flags)
 {
 	int i;
+	struct stmmac_priv *priv = netdev_priv(dev);
+	unsigned int txsize = priv->dma_tx_size;
+	unsigned int rxsize = priv->dma_rx_size;
+	unsigned int bfsize = 0;
+	int ret;
+
+	if (priv->hw->mode->set_16kib_bfsize)
+		bfsize = priv->hw->mode->set_16kib_bfsize(dev->mtu);
+
+	if (bfsize < BUF_SIZE_16KiB)
+		bfsize = stmmac_set_bfsize(dev->mtu, priv->dma_buf_sz);
+
+	priv->dma_buf_sz = bfsize;
+	priv->rx_buf_truesize = stmmac_rx_truesize(bfsize);
+
+	if (netif_msg_probe(priv))
+		pr_debug("%s: txsize %d, rxsize %d, bfsize %d, truesize %d, channels %d\n",
+			 __func__, txsize, rxsize, bfsize,
+			 priv->rx_buf_truesize, priv->num_chans);
+
+	for (i = 0; i < priv->num_chans; i++) {
+		ret = init_dma_chan_rings(&priv->chan[i], flags);
+		if (ret)
+			goto err_init_chan_rings;
+	}
+	buf_sz = bfsize;
+
+	stmmac_clear_descriptors(priv);
+
+	if (netif_msg_hw(priv))
+		stmmac_display_rings(priv);
+
+	return 0;
+err_init_chan_rings:
+	while (--i >= 0)
+		dma_free_rx_skbufs(&priv->chan[i]);
+	return ret;
+}
+
+static void dma_free_tx_skbufs(struct stmmac_channel *ch)
+{
+	struct stmmac_priv *priv = ch->priv;
+	int i;
 
 	for (i = 0; i < priv->dma_tx_size; i++) {
 		struct dma_desc *p;
 
 		if (priv->extend_desc)
-			p = &((priv->dma_etx + i)->basic);
+			p = &((ch->dma_etx + i)->basic);
 		else
-			p = priv->dma_tx + i;
+			p = ch->dma_tx + i;
 
-		if (priv->tx_skbuff_dma[i].buf) {
-			if (priv->tx_skbuff_dma[i].map_as_page)
+		if (ch->tx_skbuff_dma[i].buf) {
+			if (ch->tx_skbuff_dma[i].map_as_page)
 				dma_unmap_page(priv->device,
-					       priv->tx_skbuff_dma[i].buf,
+					       ch->tx_skbuff_dma[i].buf,
 					       priv->hw->desc->get_tx_len(p),
 					       DMA_TO_DEVICE);
 			else
 				dma_unmap_single(priv->device,
-						 priv->tx_skbuff_dma[i].buf,
+						 ch->tx_skbuff_dma[i].buf,
 						 priv->hw->desc->get_tx_len(p),
 						 DMA_TO_DEVICE);
 		}
 
-		if (priv->tx_skbuff[i] != NULL) {
-			dev_kfree_skb_any(priv->tx_skbuff[i]);
-			priv->tx_skbuff[i] = NULL;
-			priv->tx_skbuff_dma[i].buf = 0;
-			priv->tx_skbuff_dma[i].map_as_page = false;
+		if (ch->tx_skbuff[i] != NULL) {
+			dev_kfree_skb_any(ch->tx_skbuff[i]);
+			ch->tx_skbuff[i] = NULL;
+			ch->tx_skbuff_dma[i].buf = 0;
+			ch->tx_skbuff_dma[i].map_as_page = false;
 		}
 	}
 }
 
 /**
- * alloc_dma_desc_resources - alloc TX/RX resources.
- * @priv: private structure
+ * alloc_dma_chan_resources - alloc TX/RX resources of a channel.
+ * @ch: DMA channel
  * Description: according to which descriptor can be used (extend or basic)
  * this function allocates the resources for TX and RX paths. In case of
  * reception, for example, it pre-allocated the RX socket buffer in order to
  * allow zero-copy mechanism.
  */
-static int alloc_dma_desc_resources(struct stmmac_priv *priv)
+static int alloc_dma_chan_resources(struct stmmac_channel *ch)
 {
+	struct stmmac_priv *priv = ch->priv;
 	unsigned int txsize = priv->dma_tx_size;
 	unsigned int rxsize = priv->dma_rx_size;
 	int ret = -ENOMEM;
 
-	priv->rx_skbuff_dma = kmalloc_array(rxsize, sizeof(dma_addr_t),
-					    GFP_KERNEL);
-	if (!priv->rx_skbuff_dma)
+	ch->rx_skbuff_dma = kmalloc_array(rxsize, sizeof(dma_addr_t),
+					  GFP_KERNEL);
+	if (!ch->rx_skbuff_dma)
 		return -ENOMEM;
 
-	priv->rx_skbuff = kmalloc_array(rxsize, sizeof(struct sk_buff *),
-					GFP_KERNEL);
-	if (!priv->rx_skbuff)
+	ch->rx_skbuff = kcalloc(rxsize, sizeof(struct sk_buff *), GFP_KERNEL);
+	if (!ch->rx_skbuff)
 		goto err_rx_skbuff;
 
-	priv->tx_skbuff_dma = kmalloc_array(txsize,
-					    sizeof(*priv->tx_skbuff_dma),
-					    GFP_KERNEL);
-	if (!priv->tx_skbuff_dma)
+	ch->rx_buf = kcalloc(rxsize, sizeof(*ch->rx_buf), GFP_KERNEL);
+	if (!ch->rx_buf)
+		goto err_rx_buf;
+
+	ch->tx_skbuff_dma = kmalloc_array(txsize, sizeof(*ch->tx_skbuff_dma),
+					  GFP_KERNEL);
+	if (!ch->tx_skbuff_dma)
 		goto err_tx_skbuff_dma;
 
-	priv->tx_skbuff = kmalloc_array(txsize, sizeof(struct sk_buff *),
-					GFP_KERNEL);
-	if (!priv->tx_skbuff)
+	ch->tx_skbuff = kmalloc_array(txsize, sizeof(struct sk_buff *),
+				      GFP_KERNEL);
+	if (!ch->tx_skbuff)
 		goto err_tx_skbuff;
 
+	ch->tso_hdrs = dma_alloc_coherent(priv->device,
+					  txsize * STMMAC_TSO_HDR_SIZE,
+					  &ch->tso_hdrs_phy, GFP_KERNEL);
+	if (!ch->tso_hdrs)
+		goto err_tso_hdrs;
+
 	if (priv->extend_desc) {
-		priv->dma_erx = dma_zalloc_coherent(priv->device, rxsize *
-						    sizeof(struct
-							   dma_extended_desc),
-						    &priv->dma_rx_phy,
-						    GFP_KERNEL);
-		if (!priv->dma_erx)
+		ch->dma_erx = dma_zalloc_coherent(priv->device, rxsize *
+						  sizeof(struct
+							 dma_extended_desc),
+						  &ch->dma_rx_phy,
+						  GFP_KERNEL);
+		if (!ch->dma_erx)
 			goto err_dma;
 
-		priv->dma_etx = dma_zalloc_coherent(priv->device, txsize *
-						    sizeof(struct
-							   dma_extended_desc),
-						    &priv->dma_tx_phy,
-						    GFP_KERNEL);
-		if (!priv->dma_etx) {
+		ch->dma_etx = dma_zalloc_coherent(priv->device, txsize *
+						  sizeof(struct
+							 dma_extended_desc),
+						  &ch->dma_tx_phy,
+						  GFP_KERNEL);
+		if (!ch->dma_etx) {
 			dma_free_coherent(priv->device, priv->dma_rx_size *
 					  sizeof(struct dma_extended_desc),
-					  priv->dma_erx, priv->dma_rx_phy);
+					  ch->dma_erx, ch->dma_rx_phy);
 			goto err_dma;
 		}
 	} else {
-		priv->dma_rx = dma_zalloc_coherent(priv->device, rxsize *
-						   sizeof(struct dma_desc),
-						   &priv->dma_rx_phy,
-						   GFP_KERNEL);
-		if (!priv->dma_rx)
+		ch->dma_rx = dma_zalloc_coherent(priv->device, rxsize *
+						 sizeof(struct dma_desc),
+						 &ch->dma_rx_phy,
+						 GFP_KERNEL);
+		if (!ch->dma_rx)
 			goto err_dma;
 
-		priv->dma_tx = dma_zalloc_coherent(priv->device, txsize *
-						   sizeof(struct dma_desc),
-						   &priv->dma_tx_phy,
-						   GFP_KERNEL);
-		if (!priv->dma_tx) {
+		ch->dma_tx = dma_zalloc_coherent(priv->device, txsize *
+						 sizeof(struct dma_desc),
+						 &ch->dma_tx_phy,
+						 GFP_KERNEL);
+		if (!ch->dma_tx) {
 			dma_free_coherent(priv->device, priv->dma_rx_size *
 					  sizeof(struct dma_desc),
-					  priv->dma_rx, priv->dma_rx_phy);
+					  ch->dma_rx, ch->dma_rx_phy);
 			goto err_dma;
 		}
 	}
@@ -1242,42 +1487,78 @@ static int alloc_dma_desc_resources(struct stmmac_priv *priv)
 	return 0;
 
 err_dma:
-	kfree(priv->tx_skbuff);
+	dma_free_coherent(priv->device, txsize * STMMAC_TSO_HDR_SIZE,
+			  ch->tso_hdrs, ch->tso_hdrs_phy);
+err_tso_hdrs:
+	kfree(ch->tx_skbuff);
 err_tx_skbuff:
-	kfree(priv->tx_skbuff_dma);
+	kfree(ch->tx_skbuff_dma);
 err_tx_skbuff_dma:
-	kfree(priv->rx_skbuff);
+	kfree(ch->rx_buf);
+err_rx_buf:
+	kfree(ch->rx_skbuff);
 err_rx_skbuff:
-	kfree(priv->rx_skbuff_dma);
+	kfree(ch->rx_skbuff_dma);
 	return ret;
 }
 
-static void free_dma_desc_resources(struct stmmac_priv *priv)
+static void free_dma_chan_resources(struct stmmac_channel *ch)
 {
+	struct stmmac_priv *priv = ch->priv;
+
 	/* Release the DMA TX/RX socket buffers */
-	dma_free_rx_skbufs(priv);
-	dma_free_tx_skbufs(priv);
+	dma_free_rx_skbufs(ch);
+	dma_free_tx_skbufs(ch);
 
 	/* Free DMA regions of consistent memory previously allocated */
 	if (!priv->extend_desc) {
 		dma_free_coherent(priv->device,
 				  priv->dma_tx_size * sizeof(struct dma_desc),
-				  priv->dma_tx, priv->dma_tx_phy);
+				  ch->dma_tx, ch->dma_tx_phy);
 		dma_free_coherent(priv->device,
 				  priv->dma_rx_size * sizeof(struct dma_desc),
-				  priv->dma_rx, priv->dma_rx_phy);
+				  ch->dma_rx, ch->dma_rx_phy);
 	} else {
 		dma_free_coherent(priv->device, priv->dma_tx_size *
 				  sizeof(struct dma_extended_desc),
-				  priv->dma_etx, priv->dma_tx_phy);
+				  ch->dma_etx, ch->dma_tx_phy);
 		dma_free_coherent(priv->device, priv->dma_rx_size *
 				  sizeof(struct dma_extended_desc),
-				  priv->dma_erx, priv->dma_rx_phy);
+				  ch->dma_erx, ch->dma_rx_phy);
+	}
+	dma_free_coherent(priv->device, priv->dma_tx_size * STMMAC_TSO_HDR_SIZE,
+			  ch->tso_hdrs, ch->tso_hdrs_phy);
+	kfree(ch->rx_skbuff_dma);
+	kfree(ch->rx_skbuff);
+	kfree(ch->rx_buf);
+	kfree(ch->tx_skbuff_dma);
+	kfree(ch->tx_skbuff);
+}
+
+static int alloc_dma_desc_resources(struct stmmac_priv *priv)
+{
+	int i, ret;
+
+	for (i = 0; i < priv->num_chans; i++) {
+		ret = alloc_dma_chan_resources(&priv->chan[i]);
+		if (ret)
+			goto err_chan;
 	}
-	kfree(priv->rx_skbuff_dma);
-	kfree(priv->rx_skbuff);
-	kfree(priv->tx_skbuff_dma);
-	kfree(priv->tx_skbuff);
+
+	return 0;
+
+err_chan:
+	while (--i >= 0)
+		free_dma_chan_resources(&priv->chan[i]);
+	return ret;
+}
+
+static void free_dma_desc_resources(struct stmmac_priv *priv)
+{
+	int i;
+
+	for (i = 0; i < priv->num_chans; i++)
+		free_dma_chan_resources(&priv->chan[i]);
 }
 
 /**
@@ -1289,9 +1570,11 @@ static void free_dma_desc_resources(struct stmmac_priv *priv)
 static void stmmac_dma_operation_mode(struct stmmac_priv *priv)
 {
 	int rxfifosz = priv->plat->rx_fifo_size;
+	int txmode = tc, rxmode = SF_DMA_MODE;
+	int i;
 
 	if (priv->plat->force_thresh_dma_mode)
-		priv->hw->dma->dma_mode(priv->ioaddr, tc, tc, rxfifosz);
+		rxmode = tc;
 	else if (priv->plat->force_sf_dma_mode || priv->plat->tx_coe) {
 		/*
 		 * In case of GMAC, SF mode can be enabled
@@ -1300,38 +1583,42 @@ static void stmmac_dma_operation_mode(struct stmmac_priv *priv)
 		 * 2) There is no bugged Jumbo frame support
 		 *    that needs to not insert csum in the TDES.
 		 */
-		priv->hw->dma->dma_mode(priv->ioaddr, SF_DMA_MODE, SF_DMA_MODE,
-					rxfifosz);
+		txmode = SF_DMA_MODE;
 		priv->xstats.threshold = SF_DMA_MODE;
-	} else
-		priv->hw->dma->dma_mode(priv->ioaddr, tc, SF_DMA_MODE,
+	}
+
+	for (i = 0; i < priv->num_chans; i++)
+		priv->hw->dma->dma_mode(priv->chan[i].ioaddr, txmode, rxmode,
 					rxfifosz);
 }
 
 /**
  * stmmac_tx_clean - to manage the transmission completion
- * @priv: driver private structure
+ * @ch: DMA channel
+ * @budget: NAPI budget, 0 when not called from the NAPI poll
  * Description: it reclaims the transmit resources after transmission completes.
  */
-static void stmmac_tx_clean(struct stmmac_priv *priv)
+static void stmmac_tx_clean(struct stmmac_channel *ch, int budget)
 {
+	struct stmmac_priv *priv = ch->priv;
+	struct netdev_queue *txq = netdev_get_tx_queue(priv->dev, ch->index);
 	unsigned int txsize = priv->dma_tx_size;
 	unsigned int bytes_compl = 0, pkts_compl = 0;
 
-	spin_lock(&priv->tx_lock);
+	spin_lock(&ch->tx_lock);
 
 	priv->xstats.tx_clean++;
 
-	while (priv->dirty_tx != priv->cur_tx) {
+	while (ch->dirty_tx != ch->cur_tx) {
 		int last;
-		unsigned int entry = priv->dirty_tx % txsize;
-		struct sk_buff *skb = priv->tx_skbuff[entry];
+		unsigned int entry = ch->dirty_tx % txsize;
+		struct sk_buff *skb = ch->tx_skbuff[entry];
 		struct dma_desc *p;
 
 		if (priv->extend_desc)
-			p = (struct dma_desc *)(priv->dma_etx + entry);
+			p = (struct dma_desc *)(ch->dma_etx + entry);
 		else
-			p = priv->dma_tx + entry;
+			p = ch->dma_tx + entry;
 
 		/* Check if the descriptor is owned by the DMA. */
 		if (priv->hw->desc->get_tx_owner(p))
@@ -1350,120 +1637,126 @@ static void stmmac_tx_clean(struct stmmac_priv *priv)
 			} else
 				priv->dev->stats.tx_errors++;
 
-			stmmac_get_tx_hwtstamp(priv, entry, skb);
+			stmmac_get_tx_hwtstamp(ch, entry, skb);
 		}
 		if (netif_msg_tx_done(priv))
-			pr_debug("%s: curr %d, dirty %d\n", __func__,
-				 priv->cur_tx, priv->dirty_tx);
+			pr_debug("%s: chan %d curr %d, dirty %d\n", __func__,
+				 ch->index, ch->cur_tx, ch->dirty_tx);
 
-		if (likely(priv->tx_skbuff_dma[entry].buf)) {
-			if (priv->tx_skbuff_dma[entry].map_as_page)
+		if (likely(ch->tx_skbuff_dma[entry].buf)) {
+			if (ch->tx_skbuff_dma[entry].map_as_page)
 				dma_unmap_page(priv->device,
-					       priv->tx_skbuff_dma[entry].buf,
+					       ch->tx_skbuff_dma[entry].buf,
 					       priv->hw->desc->get_tx_len(p),
 					       DMA_TO_DEVICE);
 			else
 				dma_unmap_single(priv->device,
-						 priv->tx_skbuff_dma[entry].buf,
+						 ch->tx_skbuff_dma[entry].buf,
 						 priv->hw->desc->get_tx_len(p),
 						 DMA_TO_DEVICE);
-			priv->tx_skbuff_dma[entry].buf = 0;
-			priv->tx_skbuff_dma[entry].map_as_page = false;
+			ch->tx_skbuff_dma[entry].buf = 0;
+			ch->tx_skbuff_dma[entry].map_as_page = false;
 		}
-		priv->hw->mode->clean_desc3(priv, p);
+		priv->hw->mode->clean_desc3(ch, p);
 
 		if (likely(skb != NULL)) {
 			pkts_compl++;
 			bytes_compl += skb->len;
-			dev_consume_skb_any(skb);
-			priv->tx_skbuff[entry] = NULL;
+			napi_consume_skb(skb, budget);
+			ch->tx_skbuff[entry] = NULL;
 		}
 
 		priv->hw->desc->release_tx_desc(p, priv->mode);
 
-		priv->dirty_tx++;
+		ch->dirty_tx++;
 	}
 
-	netdev_completed_queue(priv->dev, pkts_compl, bytes_compl);
+	netdev_tx_completed_queue(txq, pkts_compl, bytes_compl);
+	ch->tx_pkts += pkts_compl;
+	ch->tx_bytes += bytes_compl;
 
-	if (unlikely(netif_queue_stopped(priv->dev) &&
-		     stmmac_tx_avail(priv) > STMMAC_TX_THRESH(priv))) {
-		netif_tx_lock(priv->dev);
-		if (netif_queue_stopped(priv->dev) &&
-		    stmmac_tx_avail(priv) > STMMAC_TX_THRESH(priv)) {
+	if (unlikely(netif_tx_queue_stopped(txq) &&
+		     stmmac_tx_avail(ch) > stmmac_tx_wake_thresh(priv))) {
+		__netif_tx_lock(txq, smp_processor_id());
+		if (netif_tx_queue_stopped(txq) &&
+		    stmmac_tx_avail(ch) > stmmac_tx_wake_thresh(priv)) {
 			if (netif_msg_tx_done(priv))
 				pr_debug("%s: restart transmit\n", __func__);
-			netif_wake_queue(priv->dev);
+			netif_tx_wake_queue(txq);
 		}
-		netif_tx_unlock(priv->dev);
+		__netif_tx_unlock(txq);
 	}
 
 	if ((priv->eee_enabled) && (!priv->tx_path_in_lpi_mode)) {
 		stmmac_enable_eee_mode(priv);
 		mod_timer(&priv->eee_ctrl_timer, STMMAC_LPI_T(eee_timer));
 	}
-	spin_unlock(&priv->tx_lock);
+	spin_unlock(&ch->tx_lock);
 }
 
-static inline void stmmac_enable_dma_irq(struct stmmac_priv *priv)
+static inline void stmmac_enable_dma_irq(struct stmmac_channel *ch)
 {
-	priv->hw->dma->enable_dma_irq(priv->ioaddr);
+	ch->priv->hw->dma->enable_dma_irq(ch->ioaddr);
 }
 
-static inline void stmmac_disable_dma_irq(struct stmmac_priv *priv)
+static inline void stmmac_disable_dma_irq(struct stmmac_channel *ch)
 {
-	priv->hw->dma->disable_dma_irq(priv->ioaddr);
+	ch->priv->hw->dma->disable_dma_irq(ch->ioaddr);
 }
 
 /**
  * stmmac_tx_err - to manage the tx error
- * @priv: driver private structure
+ * @ch: DMA channel
  * Description: it cleans the descriptors and restarts the transmission
  * in case of transmission errors.
  */
-static void stmmac_tx_err(struct stmmac_priv *priv)
+static void stmmac_tx_err(struct stmmac_channel *ch)
 {
+	struct stmmac_priv *priv = ch->priv;
+	struct netdev_queue *txq = netdev_get_tx_queue(priv->dev, ch->index);
 	int i;
 	int txsize = priv->dma_tx_size;
-	netif_stop_queue(priv->dev);
+	netif_tx_stop_queue(txq);
 
-	priv->hw->dma->stop_tx(priv->ioaddr);
-	dma_free_tx_skbufs(priv);
+	priv->hw->dma->stop_tx(ch->ioaddr);
+	dma_free_tx_skbufs(ch);
 	for (i = 0; i < txsize; i++)
 		if (priv->extend_desc)
-			priv->hw->desc->init_tx_desc(&priv->dma_etx[i].basic,
+			priv->hw->desc->init_tx_desc(&ch->dma_etx[i].basic,
 						     priv->mode,
 						     (i == txsize - 1));
 		else
-			priv->hw->desc->init_tx_desc(&priv->dma_tx[i],
+			priv->hw->desc->init_tx_desc(&ch->dma_tx[i],
 						     priv->mode,
 						     (i == txsize - 1));
-	priv->dirty_tx = 0;
-	priv->cur_tx = 0;
-	netdev_reset_queue(priv->dev);
-	priv->hw->dma->start_tx(priv->ioaddr);
+	ch->dirty_tx = 0;
+	ch->cur_tx = 0;
+	netdev_tx_reset_queue(txq);
+	priv->hw->dma->start_tx(ch->ioaddr);
 
 	priv->dev->stats.tx_errors++;
-	netif_wake_queue(priv->dev);
+	netif_tx_wake_queue(txq);
 }
 
 /**
  * stmmac_dma_interrupt - DMA ISR
- * @priv: driver private structure
- * Description: this is the DMA ISR. It is called by the main ISR.
+ * @ch: DMA channel
+ * Description: this is the DMA ISR of a channel. It is called by the main
+ * ISR or by the one of the channel.
  * It calls the dwmac dma routine and schedule poll method in case of some
  * work can be done.
  */
-static void stmmac_dma_interrupt(struct stmmac_priv *priv)
+static void stmmac_dma_interrupt(struct stmmac_channel *ch)
 {
+	struct stmmac_priv *priv = ch->priv;
 	int status;
 	int rxfifosz = priv->plat->rx_fifo_size;
 
-	status = priv->hw->dma->dma_interrupt(priv->ioaddr, &priv->xstats);
+	status = priv->hw->dma->dma_interrupt(ch->ioaddr, &priv->xstats);
 	if (likely((status & handle_rx)) || (status & handle_tx)) {
-		if (likely(napi_schedule_prep(&priv->napi))) {
-			stmmac_disable_dma_irq(priv);
-			__napi_schedule(&priv->napi);
+		if (likely(napi_schedule_prep(&ch->napi))) {
+			stmmac_disable_dma_irq(ch);
+			__napi_schedule(&ch->napi);
 		}
 	}
 	if (unlikely(status & tx_hard_error_bump_tc)) {
@@ -1472,15 +1765,15 @@ static void stmmac_dma_interrupt(struct stmmac_priv *priv)
 		    (tc <= 256)) {
 			tc += 64;
 			if (priv->plat->force_thresh_dma_mode)
-				priv->hw->dma->dma_mode(priv->ioaddr, tc, tc,
+				priv->hw->dma->dma_mode(ch->ioaddr, tc, tc,
 							rxfifosz);
 			else
-				priv->hw->dma->dma_mode(priv->ioaddr, tc,
+				priv->hw->dma->dma_mode(ch->ioaddr, tc,
 							SF_DMA_MODE, rxfifosz);
 			priv->xstats.threshold = tc;
 		}
 	} else if (unlikely(status == tx_hard_error))
-		stmmac_tx_err(priv);
+		stmmac_tx_err(ch);
 }
 
 /**
@@ -1641,6 +1934,7 @@ static int stmmac_init_dma_engine(struct stmmac_priv *priv)
 	int pbl = DEFAULT_DMA_PBL, fixed_burst = 0, burst_len = 0;
 	int mixed_burst = 0;
 	int atds = 0;
+	int i, ret;
 
 	if (priv->plat->dma_cfg) {
 		pbl = priv->plat->dma_cfg->pbl;
@@ -1652,9 +1946,22 @@ static int stmmac_init_dma_engine(struct stmmac_priv *priv)
 	if (priv->extend_desc && (priv->mode == STMMAC_RING_MODE))
 		atds = 1;
 
-	return priv->hw->dma->init(priv->ioaddr, pbl, fixed_burst, mixed_burst,
-				   burst_len, priv->dma_tx_phy,
-				   priv->dma_rx_phy, atds);
+	ret = priv->hw->dma->init(priv->ioaddr, pbl, fixed_burst, mixed_burst,
+				  burst_len, priv->chan[0].dma_tx_phy,
+				  priv->chan[0].dma_rx_phy, atds);
+	if (ret)
+		return ret;
+
+	/* The SW reset above also reset the additional channels */
+	for (i = 1; i < priv->num_chans; i++) {
+		struct stmmac_channel *ch = &priv->chan[i];
+
+		priv->hw->dma->init_chan(ch->ioaddr, pbl, fixed_burst,
+					 mixed_burst, ch->dma_tx_phy,
+					 ch->dma_rx_phy, atds);
+	}
+
+	return 0;
 }
 
 /**
@@ -1665,9 +1972,9 @@ static int stmmac_init_dma_engine(struct stmmac_priv *priv)
  */
 static void stmmac_tx_timer(unsigned long data)
 {
-	struct stmmac_priv *priv = (struct stmmac_priv *)data;
+	struct stmmac_channel *ch = (struct stmmac_channel *)data;
 
-	stmmac_tx_clean(priv);
+	stmmac_tx_clean(ch, 0);
 }
 
 /**
@@ -1680,13 +1987,251 @@ static void stmmac_tx_timer(unsigned long data)
  */
 static void stmmac_init_tx_coalesce(struct stmmac_priv *priv)
 {
+	int i;
+
 	priv->tx_coal_frames = STMMAC_TX_FRAMES;
 	priv->tx_coal_timer = STMMAC_COAL_TX_TIMER;
-	init_timer(&priv->txtimer);
-	priv->txtimer.expires = STMMAC_COAL_TIMER(priv->tx_coal_timer);
-	priv->txtimer.data = (unsigned long)priv;
-	priv->txtimer.function = stmmac_tx_timer;
-	add_timer(&priv->txtimer);
+	for (i = 0; i < priv->num_chans; i++) {
+		struct stmmac_channel *ch = &priv->chan[i];
+
+		ch->tx_coal_frames = priv->tx_coal_frames;
+		ch->tx_coal_timer = priv->tx_coal_timer;
+		init_timer(&ch->txtimer);
+		ch->txtimer.expires = STMMAC_COAL_TIMER(priv->tx_coal_timer);
+		ch->txtimer.data = (unsigned long)ch;
+		ch->txtimer.function = stmmac_tx_timer;
+		add_timer(&ch->txtimer);
+	}
+}
+
+/* Adaptive coalescing profiles, from the lowest latency to the highest
+ * throughput. The last ones are the static defaults.
+ */
+static const u32 stmmac_rx_coal_riwt[STMMAC_COAL_PROFILES] = {
+	MIN_DMA_RIWT, 0x40, 0x80, 0xc0, MAX_DMA_RIWT,
+};
+
+static const struct {
+	u32 frames;
+	u32 timer;
+} stmmac_tx_coal_prof[STMMAC_COAL_PROFILES] = {
+	{ 1, 1000 },
+	{ 8, 4000 },
+	{ 16, 10000 },
+	{ 32, 20000 },
+	{ STMMAC_TX_FRAMES, STMMAC_COAL_TX_TIMER },
+};
+
+/* NAPI polls per sample window, and the rate under which the traffic is
+ * taken as latency sensitive and gets the first profile straight away
+ */
+#define STMMAC_COAL_POLLS	64
+#define STMMAC_COAL_LOW_PPMS	8
+
+static void stmmac_coal_reset(struct stmmac_coal *coal, ktime_t now,
+			      unsigned long pkts, unsigned long bytes,
+			      unsigned int events)
+{
+	memset(coal, 0, sizeof(*coal));
+	coal->start = now;
+	coal->start_pkts = pkts;
+	coal->start_bytes = bytes;
+	coal->start_events = events;
+	coal->profile = STMMAC_COAL_PROFILES - 1;
+}
+
+/**
+ * stmmac_init_adaptive_coal - reset the adaptive moderation
+ * @priv: driver private structure
+ * Description: every channel restarts from the static default profiles,
+ * which are the ones just programmed by stmmac_hw_setup() and
+ * stmmac_init_tx_coalesce().
+ */
+static void stmmac_init_adaptive_coal(struct stmmac_priv *priv)
+{
+	ktime_t now = ktime_get();
+	int i;
+
+	for (i = 0; i < priv->num_chans; i++) {
+		struct stmmac_channel *ch = &priv->chan[i];
+
+		ch->coal_polls = 0;
+		stmmac_coal_reset(&ch->rx_coal, now, ch->rx_pkts, ch->rx_bytes,
+				  ch->coal_events);
+		stmmac_coal_reset(&ch->tx_coal, now, ch->tx_pkts, ch->tx_bytes,
+				  ch->coal_events);
+	}
+}
+
+/* More than 10% of difference */
+static bool stmmac_coal_differ(u32 a, u32 b)
+{
+	u32 diff = a > b ? a - b : b - a;
+
+	return diff > max(a, b) / 10;
+}
+
+/* Compare the rates of the last window with the previous ones: > 0 if
+ * they got better, < 0 if they got worse, 0 if there is no significant
+ * change. More bytes, then more packets, then fewer interrupts is better.
+ */
+static int stmmac_coal_cmp(const struct stmmac_coal_stats *curr,
+			   const struct stmmac_coal_stats *prev)
+{
+	if (stmmac_coal_differ(curr->bpms, prev->bpms))
+		return curr->bpms > prev->bpms ? 1 : -1;
+	if (stmmac_coal_differ(curr->ppms, prev->ppms))
+		return curr->ppms > prev->ppms ? 1 : -1;
+	if (stmmac_coal_differ(curr->epms, prev->epms))
+		return curr->epms < prev->epms ? 1 : -1;
+
+	return 0;
+}
+
+/**
+ * stmmac_coal_tune - move the profile of one direction of a channel
+ * @coal: moderation state
+ * @now: end of the sample window
+ * @pkts: packets done so far
+ * @bytes: bytes done so far
+ * @events: interrupt events so far
+ * Description: the profile keeps moving in the same direction as long as
+ * the rates improve, turns back when they get worse and parks once they
+ * are stable. A parked profile restarts when the load changes: towards
+ * throughput if it grows, towards latency otherwise.
+ * Return value: true if the profile changed.
+ */
+static bool stmmac_coal_tune(struct stmmac_coal *coal, ktime_t now,
+			     unsigned long pkts, unsigned long bytes,
+			     unsigned int events)
+{
+	struct stmmac_coal_stats curr;
+	unsigned int profile;
+	s64 delta;
+	int cmp;
+
+	delta = ktime_us_delta(now, coal->start);
+	if (delta <= 0)
+		return false;
+
+	curr.ppms = div64_u64((u64)(pkts - coal->start_pkts) * USEC_PER_MSEC,
+			      delta);
+	curr.bpms = div64_u64((u64)(bytes - coal->start_bytes) * USEC_PER_MSEC,
+			      delta);
+	curr.epms = div64_u64((u64)(events - coal->start_events) *
+			      USEC_PER_MSEC, delta);
+
+	coal->start = now;
+	coal->start_pkts = pkts;
+	coal->start_bytes = bytes;
+	coal->start_events = events;
+
+	if (curr.ppms < STMMAC_COAL_LOW_PPMS) {
+		profile = coal->profile;
+		coal->profile = 0;
+		coal->step = 0;
+		coal->prev = curr;
+		return profile != 0;
+	}
+
+	cmp = stmmac_coal_cmp(&curr, &coal->prev);
+	if (!coal->step) {
+		if (cmp)
+			coal->step = curr.ppms > coal->prev.ppms ? 1 : -1;
+	} else if (cmp < 0) {
+		coal->step = -coal->step;
+	} else if (!cmp) {
+		coal->step = 0;
+	}
+	coal->prev = curr;
+
+	if (!coal->step)
+		return false;
+
+	profile = coal->profile + coal->step;
+	if (profile >= STMMAC_COAL_PROFILES) {
+		/* at the end of the table */
+		coal->step = 0;
+		return false;
+	}
+	coal->profile = profile;
+
+	return true;
+}
+
+/**
+ * stmmac_adaptive_coal - run the adaptive moderation of a channel
+ * @ch: DMA channel
+ * Description: called from the NAPI poll, once every STMMAC_COAL_POLLS
+ * polls it samples the RX and TX rates of the channel and reprograms the
+ * RX watchdog and the TX coalescing parameters when their profile moves.
+ */
+static void stmmac_adaptive_coal(struct stmmac_channel *ch)
+{
+	struct stmmac_priv *priv = ch->priv;
+	unsigned int profile;
+	ktime_t now;
+
+	if (++ch->coal_polls < STMMAC_COAL_POLLS)
+		return;
+	ch->coal_polls = 0;
+
+	now = ktime_get();
+
+	if (priv->adaptive_rx_coal &&
+	    stmmac_coal_tune(&ch->rx_coal, now, ch->rx_pkts, ch->rx_bytes,
+			     ch->coal_events)) {
+		profile = ch->rx_coal.profile;
+		priv->hw->dma->rx_watchdog(ch->ioaddr,
+					   stmmac_rx_coal_riwt[profile]);
+		priv->xstats.rx_coal_update++;
+	}
+
+	if (priv->adaptive_tx_coal &&
+	    stmmac_coal_tune(&ch->tx_coal, now, ch->tx_pkts, ch->tx_bytes,
+			     ch->coal_events)) {
+		profile = ch->tx_coal.profile;
+		ch->tx_coal_frames = stmmac_tx_coal_prof[profile].frames;
+		ch->tx_coal_timer = stmmac_tx_coal_prof[profile].timer;
+		priv->xstats.tx_coal_update++;
+	}
+}
+
+/* Start and stop the TX/RX DMA of all the channels */
+static void stmmac_start_all_dma(struct stmmac_priv *priv)
+{
+	int i;
+
+	for (i = 0; i < priv->num_chans; i++) {
+		priv->hw->dma->start_tx(priv->chan[i].ioaddr);
+		priv->hw->dma->start_rx(priv->chan[i].ioaddr);
+	}
+}
+
+static void stmmac_stop_all_dma(struct stmmac_priv *priv)
+{
+	int i;
+
+	for (i = 0; i < priv->num_chans; i++) {
+		priv->hw->dma->stop_tx(priv->chan[i].ioaddr);
+		priv->hw->dma->stop_rx(priv->chan[i].ioaddr);
+	}
+}
+
+static void stmmac_enable_all_napi(struct stmmac_priv *priv)
+{
+	int i;
+
+	for (i = 0; i < priv->num_chans; i++)
+		napi_enable(&priv->chan[i].napi);
+}
+
+static void stmmac_disable_all_napi(struct stmmac_priv *priv)
+{
+	int i;
+
+	for (i = 0; i < priv->num_chans; i++)
+		napi_disable(&priv->chan[i].napi);
 }
 
 /**
@@ -1751,8 +2296,7 @@ static int stmmac_hw_setup(struct net_device *dev, bool init_ptp)
 #endif
 	/* Start the ball rolling... */
 	pr_debug("%s: DMA RX/TX processes started...\n", dev->name);
-	priv->hw->dma->start_tx(priv->ioaddr);
-	priv->hw->dma->start_rx(priv->ioaddr);
+	stmmac_start_all_dma(priv);
 
 	/* Dump DMA/MAC registers */
 	if (netif_msg_hw(priv)) {
@@ -1762,8 +2306,12 @@ static int stmmac_hw_setup(struct net_device *dev, bool init_ptp)
 	priv->tx_lpi_timer = STMMAC_DEFAULT_TWT_LS;
 
 	if ((priv->use_riwt) && (priv->hw->dma->rx_watchdog)) {
+		int i;
+
 		priv->rx_riwt = MAX_DMA_RIWT;
-		priv->hw->dma->rx_watchdog(priv->ioaddr, MAX_DMA_RIWT);
+		for (i = 0; i < priv->num_chans; i++)
+			priv->hw->dma->rx_watchdog(priv->chan[i].ioaddr,
+						   MAX_DMA_RIWT);
 	}
 
 	if (priv->pcs && priv->hw->mac->ctrl_ane)
@@ -1772,6 +2320,68 @@ static int stmmac_hw_setup(struct net_device *dev, bool init_ptp)
 	return 0;
 }
 
+/**
+ * stmmac_request_chan_irqs - request the IRQs of the additional channels
+ * @priv: driver private structure
+ * Description: a channel without its own IRQ is served by the main ISR. The
+ * ones having it get spread over the CPUs, and the TX queues are mapped
+ * (XPS) to the CPU on which their channel completes.
+ */
+static int stmmac_request_chan_irqs(struct stmmac_priv *priv)
+{
+	int node = dev_to_node(priv->device);
+	int i, ret;
+
+	for (i = 0; i < priv->num_chans; i++) {
+		struct stmmac_channel *ch = &priv->chan[i];
+		unsigned int cpu = cpumask_local_spread(i, node);
+
+		if (priv->num_chans > 1)
+			netif_set_xps_queue(priv->dev, cpumask_of(cpu), i);
+
+		if (ch->irq <= 0)
+			continue;
+
+		snprintf(ch->irq_name, sizeof(ch->irq_name), "%s-ch%d",
+			 priv->dev->name, i);
+		ret = request_irq(ch->irq, stmmac_chan_interrupt, 0,
+				  ch->irq_name, ch);
+		if (unlikely(ret < 0)) {
+			pr_err("%s: ERROR: allocating the IRQ %d of channel %d (%d)\n",
+			       __func__, ch->irq, i, ret);
+			goto err_irq;
+		}
+		irq_set_affinity_hint(ch->irq, cpumask_of(cpu));
+	}
+
+	return 0;
+
+err_irq:
+	while (--i >= 0) {
+		struct stmmac_channel *ch = &priv->chan[i];
+
+		if (ch->irq <= 0)
+			continue;
+		irq_set_affinity_hint(ch->irq, NULL);
+		free_irq(ch->irq, ch);
+	}
+	return ret;
+}
+
+static void stmmac_free_chan_irqs(struct stmmac_priv *priv)
+{
+	int i;
+
+	for (i = 0; i < priv->num_chans; i++) {
+		struct stmmac_channel *ch = &priv->chan[i];
+
+		if (ch->irq <= 0)
+			continue;
+		irq_set_affinity_hint(ch->irq, NULL);
+		free_irq(ch->irq, ch);
+	}
+}
+
 /**
  *  stmmac_open - open entry point of the driver
  *  @dev : pointer to the device structure.
@@ -1826,6 +2436,7 @@ static int stmmac_open(struct net_device *dev)
 	}
 
 	stmmac_init_tx_coalesce(priv);
+	stmmac_init_adaptive_coal(priv);
 
 	if (priv->phydev)
 		phy_start(priv->phydev);
@@ -1861,11 +2472,18 @@ static int stmmac_open(struct net_device *dev)
 		}
 	}
 
-	napi_enable(&priv->napi);
-	netif_start_queue(dev);
+	ret = stmmac_request_chan_irqs(priv);
+	if (ret)
+		goto chanirq_error;
+
+	stmmac_enable_all_napi(priv);
+	netif_tx_start_all_queues(dev);
 
 	return 0;
 
+chanirq_error:
+	if (priv->lpi_irq > 0)
+		free_irq(priv->lpi_irq, dev);
 lpiirq_error:
 	if (priv->wol_irq != dev->irq)
 		free_irq(priv->wol_irq, dev);
@@ -1890,6 +2508,7 @@ dma_desc_error:
 static int stmmac_release(struct net_device *dev)
 {
 	struct stmmac_priv *priv = netdev_priv(dev);
+	int i;
 
 	if (priv->eee_enabled)
 		del_timer_sync(&priv->eee_ctrl_timer);
@@ -1901,11 +2520,12 @@ static int stmmac_release(struct net_device *dev)
 		priv->phydev = NULL;
 	}
 
-	netif_stop_queue(dev);
+	netif_tx_stop_all_queues(dev);
 
-	napi_disable(&priv->napi);
+	stmmac_disable_all_napi(priv);
 
-	del_timer_sync(&priv->txtimer);
+	for (i = 0; i < priv->num_chans; i++)
+		del_timer_sync(&priv->chan[i].txtimer);
 
 	/* Free the IRQ lines */
 	free_irq(dev->irq, dev);
@@ -1913,10 +2533,10 @@ static int stmmac_release(struct net_device *dev)
 		free_irq(priv->wol_irq, dev);
 	if (priv->lpi_irq > 0)
 		free_irq(priv->lpi_irq, dev);
+	stmmac_free_chan_irqs(priv);
 
 	/* Stop TX/RX DMA and clear the descriptors */
-	priv->hw->dma->stop_tx(priv->ioaddr);
-	priv->hw->dma->stop_rx(priv->ioaddr);
+	stmmac_stop_all_dma(priv);
 
 	/* Release and free the Rx/Tx resources */
 	free_dma_desc_resources(priv);
@@ -1935,6 +2555,170 @@ static int stmmac_release(struct net_device *dev)
 	return 0;
 }
 
+/**
+ *  stmmac_tso_xmit - segment and transmit a GSO frame
+ *  @skb : the socket buffer
+ *  @ch : DMA channel of the queue
+ *  @txq : netdev TX queue
+ *  Description : the cores in this driver have no TSO engine, so the
+ *  segmentation is done here with the net/core/tso.c helpers: each
+ *  segment is a header built into the per ring buffer, in the descriptor
+ *  of the same index, followed by descriptors pointing straight into the
+ *  payload of the skb. The checksums are left to the TX COE.
+ */
+static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb,
+				   struct stmmac_channel *ch,
+				   struct netdev_queue *txq)
+{
+	struct stmmac_priv *priv = ch->priv;
+	unsigned int txsize = priv->dma_tx_size;
+	int hdr_len = skb_transport_offset(skb) + tcp_hdrlen(skb);
+	int total_len = skb->len - hdr_len;
+	int descs = tso_count_descs(skb);
+	struct dma_desc *desc = NULL, *first = NULL;
+	unsigned int first_tx, entry = 0;
+	struct tso_t tso;
+
+	spin_lock(&ch->tx_lock);
+
+	if (unlikely(descs >= txsize)) {
+		/* the ring can never take it */
+		spin_unlock(&ch->tx_lock);
+		dev_kfree_skb_any(skb);
+		priv->dev->stats.tx_dropped++;
+		return NETDEV_TX_OK;
+	}
+
+	if (unlikely(stmmac_tx_avail(ch) < descs)) {
+		spin_unlock(&ch->tx_lock);
+		if (!netif_tx_queue_stopped(txq)) {
+			netif_tx_stop_queue(txq);
+			/* This is a hard error, log it. */
+			pr_err("%s: Tx Ring full when queue awake\n", __func__);
+		}
+		return NETDEV_TX_BUSY;
+	}
+
+	if (priv->tx_path_in_lpi_mode)
+		stmmac_disable_eee_mode(priv);
+
+	first_tx = ch->cur_tx;
+	descs = 0;
+
+	tso_start(skb, &tso);
+	while (total_len > 0) {
+		int data_left = min_t(int, skb_shinfo(skb)->gso_size,
+				      total_len);
+
+		total_len -= data_left;
+
+		/* Header of the segment */
+		entry = ch->cur_tx % txsize;
+		desc = stmmac_tx_desc(ch, entry);
+		tso_build_hdr(skb, ch->tso_hdrs + entry * STMMAC_TSO_HDR_SIZE, &tso,
+			      data_left, total_len == 0);
+		desc->des2 = ch->tso_hdrs_phy + entry * STMMAC_TSO_HDR_SIZE;
+		ch->tx_skbuff_dma[entry].buf = 0;
+		ch->tx_skbuff[entry] = NULL;
+		priv->hw->desc->prepare_tx_desc(desc, 1, hdr_len, 1,
+						priv->mode);
+		if (first) {
+			wmb();
+			priv->hw->desc->set_tx_owner(desc);
+		} else {
+			first = desc;
+		}
+		ch->cur_tx++;
+		descs++;
+
+		/* Payload, one descriptor per contiguous chunk */
+		while (data_left > 0) {
+			int size = min_t(int, tso.size, data_left);
+
+			entry = ch->cur_tx % txsize;
+			desc = stmmac_tx_desc(ch, entry);
+			desc->des2 = dma_map_single(priv->device, tso.data,
+						    size, DMA_TO_DEVICE);
+			if (dma_mapping_error(priv->device, desc->des2))
+				goto dma_map_err;
+
+			ch->tx_skbuff_dma[entry].buf = desc->des2;
+			ch->tx_skbuff_dma[entry].map_as_page = false;
+			ch->tx_skbuff[entry] = NULL;
+			priv->hw->desc->prepare_tx_desc(desc, 0, size, 1,
+							priv->mode);
+			wmb();
+			priv->hw->desc->set_tx_owner(desc);
+			ch->cur_tx++;
+			descs++;
+
+			data_left -= size;
+			tso_build_data(skb, &tso, size);
+		}
+
+		/* Only the last segment can raise the TX interrupt */
+		priv->hw->desc->close_tx_desc(desc);
+		if (total_len)
+			priv->hw->desc->clear_tx_ic(desc);
+		priv->xstats.tx_tso_segs++;
+	}
+
+	ch->tx_skbuff[entry] = skb;
+
+	wmb();
+	ch->tx_count_frames += descs;
+	if (ch->tx_coal_frames > ch->tx_count_frames) {
+		priv->hw->desc->clear_tx_ic(desc);
+		priv->xstats.tx_reset_ic_bit++;
+		mod_timer(&ch->txtimer,
+			  STMMAC_COAL_TIMER(ch->tx_coal_timer));
+	} else
+		ch->tx_count_frames = 0;
+
+	/* To avoid raise condition */
+	priv->hw->desc->set_tx_owner(first);
+	wmb();
+
+	if (unlikely(stmmac_tx_avail(ch) <= stmmac_tx_stop_thresh(priv))) {
+		if (netif_msg_hw(priv))
+			pr_debug("%s: stop transmitted packets\n", __func__);
+		netif_tx_stop_queue(txq);
+	}
+
+	priv->dev->stats.tx_bytes += skb->len;
+	priv->xstats.tx_tso_frames++;
+
+	skb_tx_timestamp(skb);
+
+	netdev_tx_sent_queue(txq, skb->len);
+	priv->hw->dma->enable_dma_transmission(ch->ioaddr);
+
+	spin_unlock(&ch->tx_lock);
+	return NETDEV_TX_OK;
+
+dma_map_err:
+	/* Nothing was given to the DMA yet, the first descriptor still
+	 * belongs to the driver: just unwind the ring.
+	 */
+	for (; ch->cur_tx != first_tx; ch->cur_tx--) {
+		entry = (ch->cur_tx - 1) % txsize;
+		desc = stmmac_tx_desc(ch, entry);
+		if (ch->tx_skbuff_dma[entry].buf) {
+			dma_unmap_single(priv->device,
+					 ch->tx_skbuff_dma[entry].buf,
+					 priv->hw->desc->get_tx_len(desc),
+					 DMA_TO_DEVICE);
+			ch->tx_skbuff_dma[entry].buf = 0;
+		}
+		priv->hw->desc->release_tx_desc(desc, priv->mode);
+	}
+	spin_unlock(&ch->tx_lock);
+	dev_err(priv->device, "Tx dma map failed\n");
+	dev_kfree_skb_any(skb);
+	priv->dev->stats.tx_dropped++;
+	return NETDEV_TX_OK;
+}
+
 /**
  *  stmmac_xmit - Tx entry point of the driver
  *  @skb : the socket buffer
@@ -1946,6 +2730,9 @@ static int stmmac_release(struct net_device *dev)
 static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	struct stmmac_priv *priv = netdev_priv(dev);
+	u16 queue = skb_get_queue_mapping(skb);
+	struct stmmac_channel *ch = &priv->chan[queue];
+	struct netdev_queue *txq = netdev_get_tx_queue(dev, queue);
 	unsigned int txsize = priv->dma_tx_size;
 	int entry;
 	int i, csum_insertion = 0, is_jumbo = 0;
@@ -1954,12 +2741,15 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 	unsigned int nopaged_len = skb_headlen(skb);
 	unsigned int enh_desc = priv->plat->enh_desc;
 
-	spin_lock(&priv->tx_lock);
+	if (skb_is_gso(skb))
+		return stmmac_tso_xmit(skb, ch, txq);
 
-	if (unlikely(stmmac_tx_avail(priv) < nfrags + 1)) {
-		spin_unlock(&priv->tx_lock);
-		if (!netif_queue_stopped(dev)) {
-			netif_stop_queue(dev);
+	spin_lock(&ch->tx_lock);
+
+	if (unlikely(stmmac_tx_avail(ch) < nfrags + 1)) {
+		spin_unlock(&ch->tx_lock);
+		if (!netif_tx_queue_stopped(txq)) {
+			netif_tx_stop_queue(txq);
 			/* This is a hard error, log it. */
 			pr_err("%s: Tx Ring full when queue awake\n", __func__);
 		}
@@ -1969,14 +2759,14 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 	if (priv->tx_path_in_lpi_mode)
 		stmmac_disable_eee_mode(priv);
 
-	entry = priv->cur_tx % txsize;
+	entry = ch->cur_tx % txsize;
 
 	csum_insertion = (skb->ip_summed == CHECKSUM_PARTIAL);
 
 	if (priv->extend_desc)
-		desc = (struct dma_desc *)(priv->dma_etx + entry);
+		desc = (struct dma_desc *)(ch->dma_etx + entry);
 	else
-		desc = priv->dma_tx + entry;
+		desc = ch->dma_tx + entry;
 
 	first = desc;
 
@@ -1989,12 +2779,12 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 					    nopaged_len, DMA_TO_DEVICE);
 		if (dma_mapping_error(priv->device, desc->des2))
 			goto dma_map_err;
-		priv->tx_skbuff_dma[entry].buf = desc->des2;
+		ch->tx_skbuff_dma[entry].buf = desc->des2;
 		priv->hw->desc->prepare_tx_desc(desc, 1, nopaged_len,
 						csum_insertion, priv->mode);
 	} else {
 		desc = first;
-		entry = priv->hw->mode->jumbo_frm(priv, skb, csum_insertion);
+		entry = priv->hw->mode->jumbo_frm(ch, skb, csum_insertion);
 		if (unlikely(entry < 0))
 			goto dma_map_err;
 	}
@@ -2003,20 +2793,20 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 		const skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
 		int len = skb_frag_size(frag);
 
-		priv->tx_skbuff[entry] = NULL;
-		entry = (++priv->cur_tx) % txsize;
+		ch->tx_skbuff[entry] = NULL;
+		entry = (++ch->cur_tx) % txsize;
 		if (priv->extend_desc)
-			desc = (struct dma_desc *)(priv->dma_etx + entry);
+			desc = (struct dma_desc *)(ch->dma_etx + entry);
 		else
-			desc = priv->dma_tx + entry;
+			desc = ch->dma_tx + entry;
 
 		desc->des2 = skb_frag_dma_map(priv->device, frag, 0, len,
 					      DMA_TO_DEVICE);
 		if (dma_mapping_error(priv->device, desc->des2))
 			goto dma_map_err; /* should reuse desc w/o issues */
 
-		priv->tx_skbuff_dma[entry].buf = desc->des2;
-		priv->tx_skbuff_dma[entry].map_as_page = true;
+		ch->tx_skbuff_dma[entry].buf = desc->des2;
+		ch->tx_skbuff_dma[entry].map_as_page = true;
 		priv->hw->desc->prepare_tx_desc(desc, 0, len, csum_insertion,
 						priv->mode);
 		wmb();
@@ -2024,7 +2814,7 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 		wmb();
 	}
 
-	priv->tx_skbuff[entry] = skb;
+	ch->tx_skbuff[entry] = skb;
 
 	/* Finalize the latest segment. */
 	priv->hw->desc->close_tx_desc(desc);
@@ -2034,38 +2824,38 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 	 * segment could be reset and the timer re-started to invoke the
 	 * stmmac_tx function. This approach takes care about the fragments.
 	 */
-	priv->tx_count_frames += nfrags + 1;
-	if (priv->tx_coal_frames > priv->tx_count_frames) {
+	ch->tx_count_frames += nfrags + 1;
+	if (ch->tx_coal_frames > ch->tx_count_frames) {
 		priv->hw->desc->clear_tx_ic(desc);
 		priv->xstats.tx_reset_ic_bit++;
-		mod_timer(&priv->txtimer,
-			  STMMAC_COAL_TIMER(priv->tx_coal_timer));
+		mod_timer(&ch->txtimer,
+			  STMMAC_COAL_TIMER(ch->tx_coal_timer));
 	} else
-		priv->tx_count_frames = 0;
+		ch->tx_count_frames = 0;
 
 	/* To avoid raise condition */
 	priv->hw->desc->set_tx_owner(first);
 	wmb();
 
-	priv->cur_tx++;
+	ch->cur_tx++;
 
 	if (netif_msg_pktdata(priv)) {
 		pr_debug("%s: curr %d dirty=%d entry=%d, first=%p, nfrags=%d",
-			__func__, (priv->cur_tx % txsize),
-			(priv->dirty_tx % txsize), entry, first, nfrags);
+			__func__, (ch->cur_tx % txsize),
+			(ch->dirty_tx % txsize), entry, first, nfrags);
 
 		if (priv->extend_desc)
-			stmmac_display_ring((void *)priv->dma_etx, txsize, 1);
+			stmmac_display_ring((void *)ch->dma_etx, txsize, 1);
 		else
-			stmmac_display_ring((void *)priv->dma_tx, txsize, 0);
+			stmmac_display_ring((void *)ch->dma_tx, txsize, 0);
 
 		pr_debug(">>> frame to be transmitted: ");
 		print_pkt(skb->data, skb->len);
 	}
-	if (unlikely(stmmac_tx_avail(priv) <= (MAX_SKB_FRAGS + 1))) {
+	if (unlikely(stmmac_tx_avail(ch) <= stmmac_tx_stop_thresh(priv))) {
 		if (netif_msg_hw(priv))
 			pr_debug("%s: stop transmitted packets\n", __func__);
-		netif_stop_queue(dev);
+		netif_tx_stop_queue(txq);
 	}
 
 	dev->stats.tx_bytes += skb->len;
@@ -2080,14 +2870,14 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 	if (!priv->hwts_tx_en)
 		skb_tx_timestamp(skb);
 
-	netdev_sent_queue(dev, skb->len);
-	priv->hw->dma->enable_dma_transmission(priv->ioaddr);
+	netdev_tx_sent_queue(txq, skb->len);
+	priv->hw->dma->enable_dma_transmission(ch->ioaddr);
 
-	spin_unlock(&priv->tx_lock);
+	spin_unlock(&ch->tx_lock);
 	return NETDEV_TX_OK;
 
 dma_map_err:
-	spin_unlock(&priv->tx_lock);
+	spin_unlock(&ch->tx_lock);
 	dev_err(priv->device, "Tx dma map failed\n");
 	dev_kfree_skb(skb);
 	priv->dev->stats.tx_dropped++;
@@ -2117,21 +2907,28 @@ static void stmmac_rx_vlan(struct net_device *dev, struct sk_buff *skb)
  * Description : this is to reallocate the skb for the reception process
  * that is based on zero-copy.
  */
-static inline void stmmac_rx_refill(struct stmmac_priv *priv)
+static inline void stmmac_rx_refill(struct stmmac_channel *ch)
 {
+	struct stmmac_priv *priv = ch->priv;
 	unsigned int rxsize = priv->dma_rx_size;
 	int bfsize = priv->dma_buf_sz;
 
-	for (; priv->cur_rx - priv->dirty_rx > 0; priv->dirty_rx++) {
-		unsigned int entry = priv->dirty_rx % rxsize;
+	for (; ch->cur_rx - ch->dirty_rx > 0; ch->dirty_rx++) {
+		unsigned int entry = ch->dirty_rx % rxsize;
 		struct dma_desc *p;
 
 		if (priv->extend_desc)
-			p = (struct dma_desc *)(priv->dma_erx + entry);
+			p = (struct dma_desc *)(ch->dma_erx + entry);
 		else
-			p = priv->dma_rx + entry;
+			p = ch->dma_rx + entry;
 
-		if (likely(priv->rx_skbuff[entry] == NULL)) {
+		if (priv->rx_buf_truesize) {
+			if (stmmac_rx_map_buffer(priv, p, &ch->rx_buf[entry],
+						 GFP_ATOMIC))
+				break;
+
+			priv->hw->mode->refill_desc3(ch, p);
+		} else if (likely(ch->rx_skbuff[entry] == NULL)) {
 			struct sk_buff *skb;
 
 			skb = netdev_alloc_skb_ip_align(priv->dev, bfsize);
@@ -2139,19 +2936,19 @@ static inline void stmmac_rx_refill(struct stmmac_priv *priv)
 			if (unlikely(skb == NULL))
 				break;
 
-			priv->rx_skbuff[entry] = skb;
-			priv->rx_skbuff_dma[entry] =
+			ch->rx_skbuff[entry] = skb;
+			ch->rx_skbuff_dma[entry] =
 			    dma_map_single(priv->device, skb->data, bfsize,
 					   DMA_FROM_DEVICE);
 			if (dma_mapping_error(priv->device,
-					      priv->rx_skbuff_dma[entry])) {
+					      ch->rx_skbuff_dma[entry])) {
 				dev_err(priv->device, "Rx dma map failed\n");
 				dev_kfree_skb(skb);
 				break;
 			}
-			p->des2 = priv->rx_skbuff_dma[entry];
+			p->des2 = ch->rx_skbuff_dma[entry];
 
-			priv->hw->mode->refill_desc3(priv, p);
+			priv->hw->mode->refill_desc3(ch, p);
 
 			if (netif_msg_rx_status(priv))
 				pr_debug("\trefill entry #%d\n", entry);
@@ -2164,15 +2961,16 @@ static inline void stmmac_rx_refill(struct stmmac_priv *priv)
 
 /**
  * stmmac_rx - manage the receive process
- * @priv: driver private structure
+ * @ch: DMA channel
  * @limit: napi bugget.
  * Description :  this the function called by the napi poll method.
  * It gets all the frames inside the ring.
  */
-static int stmmac_rx(struct stmmac_priv *priv, int limit)
+static int stmmac_rx(struct stmmac_channel *ch, int limit)
 {
+	struct stmmac_priv *priv = ch->priv;
 	unsigned int rxsize = priv->dma_rx_size;
-	unsigned int entry = priv->cur_rx % rxsize;
+	unsigned int entry = ch->cur_rx % rxsize;
 	unsigned int next_entry;
 	unsigned int count = 0;
 	int coe = priv->hw->rx_csum;
@@ -2180,29 +2978,29 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit)
 	if (netif_msg_rx_status(priv)) {
 		pr_debug("%s: descriptor ring:\n", __func__);
 		if (priv->extend_desc)
-			stmmac_display_ring((void *)priv->dma_erx, rxsize, 1);
+			stmmac_display_ring((void *)ch->dma_erx, rxsize, 1);
 		else
-			stmmac_display_ring((void *)priv->dma_rx, rxsize, 0);
+			stmmac_display_ring((void *)ch->dma_rx, rxsize, 0);
 	}
 	while (count < limit) {
 		int status;
 		struct dma_desc *p;
 
 		if (priv->extend_desc)
-			p = (struct dma_desc *)(priv->dma_erx + entry);
+			p = (struct dma_desc *)(ch->dma_erx + entry);
 		else
-			p = priv->dma_rx + entry;
+			p = ch->dma_rx + entry;
 
 		if (priv->hw->desc->get_rx_owner(p))
 			break;
 
 		count++;
 
-		next_entry = (++priv->cur_rx) % rxsize;
+		next_entry = (++ch->cur_rx) % rxsize;
 		if (priv->extend_desc)
-			prefetch(priv->dma_erx + next_entry);
+			prefetch(ch->dma_erx + next_entry);
 		else
-			prefetch(priv->dma_rx + next_entry);
+			prefetch(ch->dma_rx + next_entry);
 
 		/* read the status of the incoming frame */
 		status = priv->hw->desc->rx_status(&priv->dev->stats,
@@ -2210,19 +3008,21 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit)
 		if ((priv->extend_desc) && (priv->hw->desc->rx_extended_status))
 			priv->hw->desc->rx_extended_status(&priv->dev->stats,
 							   &priv->xstats,
-							   priv->dma_erx +
+							   ch->dma_erx +
 							   entry);
 		if (unlikely(status == discard_frame)) {
 			priv->dev->stats.rx_errors++;
-			if (priv->hwts_rx_en && !priv->extend_desc) {
+			if (priv->hwts_rx_en && !priv->extend_desc &&
+			    !priv->rx_buf_truesize) {
 				/* DESC2 & DESC3 will be overwitten by device
 				 * with timestamp value, hence reinitialize
 				 * them in stmmac_rx_refill() function so that
-				 * device can reuse it.
+				 * device can reuse it (page buffers always
+				 * get DESC2 rewritten there).
 				 */
-				priv->rx_skbuff[entry] = NULL;
+				ch->rx_skbuff[entry] = NULL;
 				dma_unmap_single(priv->device,
-						 priv->rx_skbuff_dma[entry],
+						 ch->rx_skbuff_dma[entry],
 						 priv->dma_buf_sz,
 						 DMA_FROM_DEVICE);
 			}
@@ -2251,22 +3051,36 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit)
 					pr_debug("\tframe size %d, COE: %d\n",
 						 frame_len, status);
 			}
-			skb = priv->rx_skbuff[entry];
-			if (unlikely(!skb)) {
-				pr_err("%s: Inconsistent Rx descriptor chain\n",
-				       priv->dev->name);
-				priv->dev->stats.rx_dropped++;
-				break;
-			}
-			prefetch(skb->data - NET_IP_ALIGN);
-			priv->rx_skbuff[entry] = NULL;
+			if (priv->rx_buf_truesize) {
+				skb = stmmac_rx_page_skb(ch, entry,
+							 frame_len);
+				if (unlikely(!skb)) {
+					/* the buffer stays in the ring */
+					priv->dev->stats.rx_dropped++;
+					entry = next_entry;
+					continue;
+				}
 
-			stmmac_get_rx_hwtstamp(priv, entry, skb);
+				stmmac_get_rx_hwtstamp(ch, entry, skb);
+			} else {
+				skb = ch->rx_skbuff[entry];
+				if (unlikely(!skb)) {
+					pr_err("%s: Inconsistent Rx descriptor chain\n",
+					       priv->dev->name);
+					priv->dev->stats.rx_dropped++;
+					break;
+				}
+				prefetch(skb->data - NET_IP_ALIGN);
+				ch->rx_skbuff[entry] = NULL;
 
-			skb_put(skb, frame_len);
-			dma_unmap_single(priv->device,
-					 priv->rx_skbuff_dma[entry],
-					 priv->dma_buf_sz, DMA_FROM_DEVICE);
+				stmmac_get_rx_hwtstamp(ch, entry, skb);
+
+				skb_put(skb, frame_len);
+				dma_unmap_single(priv->device,
+						 ch->rx_skbuff_dma[entry],
+						 priv->dma_buf_sz,
+						 DMA_FROM_DEVICE);
+			}
 
 			if (netif_msg_pktdata(priv)) {
 				pr_debug("frame received (%dbytes)", frame_len);
@@ -2282,17 +3096,26 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit)
 			else
 				skb->ip_summed = CHECKSUM_UNNECESSARY;
 
-			napi_gro_receive(&priv->napi, skb);
+			skb_record_rx_queue(skb, ch->index);
+			skb_mark_napi_id(skb, &ch->napi);
+
+			/* GRO would hold the frame until napi_complete() */
+			if (ch->busy_polling)
+				netif_receive_skb(skb);
+			else
+				napi_gro_receive(&ch->napi, skb);
 
 			priv->dev->stats.rx_packets++;
 			priv->dev->stats.rx_bytes += frame_len;
+			ch->rx_bytes += frame_len;
 		}
 		entry = next_entry;
 	}
 
-	stmmac_rx_refill(priv);
+	stmmac_rx_refill(ch);
 
 	priv->xstats.rx_pkt_n += count;
+	ch->rx_pkts += count;
 
 	return count;
 }
@@ -2307,20 +3130,63 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit)
  */
 static int stmmac_poll(struct napi_struct *napi, int budget)
 {
-	struct stmmac_priv *priv = container_of(napi, struct stmmac_priv, napi);
+	struct stmmac_channel *ch = container_of(napi, struct stmmac_channel,
+						 napi);
 	int work_done = 0;
 
-	priv->xstats.napi_poll++;
-	stmmac_tx_clean(priv);
+	ch->priv->xstats.napi_poll++;
+	stmmac_tx_clean(ch, budget);
+
+	work_done = stmmac_rx(ch, budget);
+
+	if (ch->priv->adaptive_rx_coal || ch->priv->adaptive_tx_coal)
+		stmmac_adaptive_coal(ch);
 
-	work_done = stmmac_rx(priv, budget);
 	if (work_done < budget) {
 		napi_complete(napi);
-		stmmac_enable_dma_irq(priv);
+		ch->coal_events++;
+		stmmac_enable_dma_irq(ch);
 	}
 	return work_done;
 }
 
+#ifdef CONFIG_NET_RX_BUSY_POLL
+#define STMMAC_BUSY_POLL_BUDGET	4
+
+/**
+ *  stmmac_busy_poll - busy poll method
+ *  @napi : pointer to the napi structure of the channel.
+ *  Description :
+ *  Called by a task spinning on a socket (SO_BUSY_POLL) to process the RX
+ *  ring of the channel from its own context, without waiting for the IRQ
+ *  and NET_RX softirq. Owning the NAPI context keeps stmmac_poll away and
+ *  the DMA IRQ of the channel is masked meanwhile.
+ */
+static int stmmac_busy_poll(struct napi_struct *napi)
+{
+	struct stmmac_channel *ch = container_of(napi, struct stmmac_channel,
+						 napi);
+	int found;
+
+	if (!napi_schedule_prep(napi))
+		return LL_FLUSH_BUSY;
+
+	stmmac_disable_dma_irq(ch);
+	ch->busy_polling = true;
+	ch->priv->xstats.busy_poll++;
+
+	/* not run from NET_RX softirq, which flushes the NAPI skb cache */
+	stmmac_tx_clean(ch, 0);
+	found = stmmac_rx(ch, STMMAC_BUSY_POLL_BUDGET);
+
+	ch->busy_polling = false;
+	napi_complete(napi);
+	stmmac_enable_dma_irq(ch);
+
+	return found;
+}
+#endif
+
 /**
  *  stmmac_tx_timeout
  *  @dev : Pointer to net device structure
@@ -2332,9 +3198,11 @@ static int stmmac_poll(struct napi_struct *napi, int budget)
 static void stmmac_tx_timeout(struct net_device *dev)
 {
 	struct stmmac_priv *priv = netdev_priv(dev);
+	int i;
 
 	/* Clear Tx resources and restart transmitting again */
-	stmmac_tx_err(priv);
+	for (i = 0; i < priv->num_chans; i++)
+		stmmac_tx_err(&priv->chan[i]);
 }
 
 /**
@@ -2433,6 +3301,20 @@ static int stmmac_set_features(struct net_device *netdev,
 	return 0;
 }
 
+static netdev_features_t stmmac_features_check(struct sk_buff *skb,
+					       struct net_device *dev,
+					       netdev_features_t features)
+{
+	/* Headers that do not fit the TSO header buffer are left to the
+	 * software GSO.
+	 */
+	if (skb_is_gso(skb) &&
+	    skb_transport_offset(skb) + tcp_hdrlen(skb) > STMMAC_TSO_HDR_SIZE)
+		features &= ~NETIF_F_GSO_MASK;
+
+	return features;
+}
+
 /**
  *  stmmac_interrupt - main ISR
  *  @irq: interrupt number.
@@ -2448,6 +3330,7 @@ static irqreturn_t stmmac_interrupt(int irq, void *dev_id)
 {
 	struct net_device *dev = (struct net_device *)dev_id;
 	struct stmmac_priv *priv = netdev_priv(dev);
+	int i;
 
 	if (priv->irq_wake)
 		pm_wakeup_event(priv->device, 0);
@@ -2470,8 +3353,24 @@ static irqreturn_t stmmac_interrupt(int irq, void *dev_id)
 		}
 	}
 
-	/* To handle DMA interrupts */
-	stmmac_dma_interrupt(priv);
+	/* To handle DMA interrupts of the channels without their own IRQ */
+	for (i = 0; i < priv->num_chans; i++)
+		if (priv->chan[i].irq <= 0)
+			stmmac_dma_interrupt(&priv->chan[i]);
+
+	return IRQ_HANDLED;
+}
+
+/**
+ *  stmmac_chan_interrupt - ISR of a DMA channel
+ *  @irq: interrupt number.
+ *  @dev_id: to pass the channel pointer.
+ */
+static irqreturn_t stmmac_chan_interrupt(int irq, void *dev_id)
+{
+	struct stmmac_channel *ch = (struct stmmac_channel *)dev_id;
+
+	stmmac_dma_interrupt(ch);
 
 	return IRQ_HANDLED;
 }
@@ -2482,9 +3381,22 @@ static irqreturn_t stmmac_interrupt(int irq, void *dev_id)
  */
 static void stmmac_poll_controller(struct net_device *dev)
 {
+	struct stmmac_priv *priv = netdev_priv(dev);
+	int i;
+
 	disable_irq(dev->irq);
 	stmmac_interrupt(dev->irq, dev);
 	enable_irq(dev->irq);
+
+	for (i = 0; i < priv->num_chans; i++) {
+		struct stmmac_channel *ch = &priv->chan[i];
+
+		if (ch->irq <= 0)
+			continue;
+		disable_irq(ch->irq);
+		stmmac_chan_interrupt(ch->irq, ch);
+		enable_irq(ch->irq);
+	}
 }
 #endif
 
@@ -2560,17 +3472,24 @@ static int stmmac_sysfs_ring_read(struct seq_file *seq, void *v)
 	struct stmmac_priv *priv = netdev_priv(dev);
 	unsigned int txsize = priv->dma_tx_size;
 	unsigned int rxsize = priv->dma_rx_size;
+	int i;
 
-	if (priv->extend_desc) {
-		seq_printf(seq, "Extended RX descriptor ring:\n");
-		sysfs_display_ring((void *)priv->dma_erx, rxsize, 1, seq);
-		seq_printf(seq, "Extended TX descriptor ring:\n");
-		sysfs_display_ring((void *)priv->dma_etx, txsize, 1, seq);
-	} else {
-		seq_printf(seq, "RX descriptor ring:\n");
-		sysfs_display_ring((void *)priv->dma_rx, rxsize, 0, seq);
-		seq_printf(seq, "TX descriptor ring:\n");
-		sysfs_display_ring((void *)priv->dma_tx, txsize, 0, seq);
+	for (i = 0; i < priv->num_chans; i++) {
+		struct stmmac_channel *ch = &priv->chan[i];
+
+		if (priv->extend_desc) {
+			seq_printf(seq, "Channel %d extended RX descriptor ring:\n",
+				   i);
+			sysfs_display_ring((void *)ch->dma_erx, rxsize, 1, seq);
+			seq_printf(seq, "Channel %d extended TX descriptor ring:\n",
+				   i);
+			sysfs_display_ring((void *)ch->dma_etx, txsize, 1, seq);
+		} else {
+			seq_printf(seq, "Channel %d RX descriptor ring:\n", i);
+			sysfs_display_ring((void *)ch->dma_rx, rxsize, 0, seq);
+			seq_printf(seq, "Channel %d TX descriptor ring:\n", i);
+			sysfs_display_ring((void *)ch->dma_tx, txsize, 0, seq);
+		}
 	}
 
 	return 0;
@@ -2644,6 +3563,7 @@ static int stmmac_sysfs_dma_cap_read(struct seq_file *seq, void *v)
 		   priv->dma_cap.number_tx_channel);
 	seq_printf(seq, "\tEnhanced descriptors: %s\n",
 		   (priv->dma_cap.enh_desc) ? "Y" : "N");
+	seq_printf(seq, "\tDMA channels in use: %d\n", priv->num_chans);
 
 	return 0;
 }
@@ -2718,11 +3638,15 @@ static const struct net_device_ops stmmac_netdev_ops = {
 	.ndo_change_mtu = stmmac_change_mtu,
 	.ndo_fix_features = stmmac_fix_features,
 	.ndo_set_features = stmmac_set_features,
+	.ndo_features_check = stmmac_features_check,
 	.ndo_set_rx_mode = stmmac_set_rx_mode,
 	.ndo_tx_timeout = stmmac_tx_timeout,
 	.ndo_do_ioctl = stmmac_ioctl,
 #ifdef CONFIG_NET_POLL_CONTROLLER
 	.ndo_poll_controller = stmmac_poll_controller,
+#endif
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	.ndo_busy_poll = stmmac_busy_poll,
 #endif
 	.ndo_set_mac_address = eth_mac_addr,
 };
@@ -2813,6 +3737,52 @@ static int stmmac_hw_init(struct stmmac_priv *priv)
 	return 0;
 }
 
+/**
+ * stmmac_init_chans - setup the DMA channels
+ * @priv: driver private structure
+ * @res: stmmac resource pointer
+ * Description: the platform asks for a number of channels, used as far as
+ * the core has them and knows how to program the additional ones. Each
+ * channel gets a TX and an RX queue of the netdev.
+ */
+static void stmmac_init_chans(struct stmmac_priv *priv,
+			      struct stmmac_resources *res)
+{
+	unsigned int max_chans = 1;
+	unsigned int i;
+
+	if (priv->hw->dma->init_chan && priv->hw_cap_support)
+		max_chans += min(priv->dma_cap.number_tx_channel,
+				 priv->dma_cap.number_rx_channel);
+	max_chans = min_t(unsigned int, max_chans, STMMAC_MAX_CHANNELS);
+
+	priv->num_chans = 1;
+	if (priv->plat->dma_channels > 1) {
+		priv->num_chans = min_t(unsigned int, priv->plat->dma_channels,
+					max_chans);
+		if (priv->num_chans < priv->plat->dma_channels)
+			pr_warn(" Only %d DMA channels available\n",
+				priv->num_chans);
+	}
+	pr_info(" Using %d DMA channel(s)\n", priv->num_chans);
+
+	for (i = 0; i < priv->num_chans; i++) {
+		struct stmmac_channel *ch = &priv->chan[i];
+
+		ch->priv = priv;
+		ch->index = i;
+		ch->ioaddr = priv->ioaddr + DMA_CHAN_OFFSET(i);
+		/* channel 0 is always served by the main ISR */
+		ch->irq = i ? res->chan_irq[i] : 0;
+		spin_lock_init(&ch->tx_lock);
+		netif_napi_add(priv->dev, &ch->napi, stmmac_poll, 64);
+		napi_hash_add(&ch->napi);
+	}
+
+	netif_set_real_num_tx_queues(priv->dev, priv->num_chans);
+	netif_set_real_num_rx_queues(priv->dev, priv->num_chans);
+}
+
 /**
  * stmmac_dvr_probe
  * @device: device pointer
@@ -2830,8 +3800,10 @@ int stmmac_dvr_probe(struct device *device,
 	int ret = 0;
 	struct net_device *ndev = NULL;
 	struct stmmac_priv *priv;
+	int i;
 
-	ndev = alloc_etherdev(sizeof(struct stmmac_priv));
+	ndev = alloc_etherdev_mqs(sizeof(struct stmmac_priv),
+				  STMMAC_MAX_CHANNELS, STMMAC_MAX_CHANNELS);
 	if (!ndev)
 		return -ENOMEM;
 
@@ -2913,6 +3885,14 @@ int stmmac_dvr_probe(struct device *device,
 
 	ndev->hw_features = NETIF_F_SG | NETIF_F_IP_CSUM | NETIF_F_IPV6_CSUM |
 			    NETIF_F_RXCSUM;
+	/* The TSO is done by the driver on top of the TX COE, and needs
+	 * a ring that takes a few of the largest frames.
+	 */
+	if (priv->plat->tx_coe &&
+	    STMMAC_ALIGN(dma_txsize) >= 2 * STMMAC_TSO_MAX_DESCS) {
+		ndev->hw_features |= NETIF_F_TSO | NETIF_F_TSO6;
+		ndev->gso_max_segs = STMMAC_TSO_MAX_SEGS;
+	}
 	ndev->features |= ndev->hw_features | NETIF_F_HIGHDMA;
 	ndev->watchdog_timeo = msecs_to_jiffies(watchdog);
 #ifdef STMMAC_VLAN_TAG_USED
@@ -2934,10 +3914,9 @@ int stmmac_dvr_probe(struct device *device,
 		pr_info(" Enable RX Mitigation via HW Watchdog Timer\n");
 	}
 
-	netif_napi_add(ndev, &priv->napi, stmmac_poll, 64);
+	stmmac_init_chans(priv, res);
 
 	spin_lock_init(&priv->lock);
-	spin_lock_init(&priv->tx_lock);
 
 	ret = register_netdev(ndev);
 	if (ret) {
@@ -2974,7 +3953,10 @@ int stmmac_dvr_probe(struct device *device,
 error_mdio_register:
 	unregister_netdev(ndev);
 error_netdev_register:
-	netif_napi_del(&priv->napi);
+	for (i = 0; i < priv->num_chans; i++) {
+		napi_hash_del(&priv->chan[i].napi);
+		netif_napi_del(&priv->chan[i].napi);
+	}
 error_hw_init:
 	clk_disable_unprepare(priv->pclk);
 error_pclk_get:
@@ -2995,14 +3977,17 @@ EXPORT_SYMBOL_GPL(stmmac_dvr_probe);
 int stmmac_dvr_remove(struct net_device *ndev)
 {
 	struct stmmac_priv *priv = netdev_priv(ndev);
+	int i;
 
 	pr_info("%s:\n\tremoving driver", __func__);
 
-	priv->hw->dma->stop_rx(priv->ioaddr);
-	priv->hw->dma->stop_tx(priv->ioaddr);
+	stmmac_stop_all_dma(priv);
 
 	stmmac_set_mac(priv->ioaddr, false);
 	netif_carrier_off(ndev);
+	/* unregister_netdev() waits for busy pollers still holding them */
+	for (i = 0; i < priv->num_chans; i++)
+		napi_hash_del(&priv->chan[i].napi);
 	unregister_netdev(ndev);
 	if (priv->stmmac_rst)
 		reset_control_assert(priv->stmmac_rst);
@@ -3038,13 +4023,12 @@ int stmmac_suspend(struct net_device *ndev)
 	spin_lock_irqsave(&priv->lock, flags);
 
 	netif_device_detach(ndev);
-	netif_stop_queue(ndev);
+	netif_tx_stop_all_queues(ndev);
 
-	napi_disable(&priv->napi);
+	stmmac_disable_all_napi(priv);
 
 	/* Stop TX/RX DMA */
-	priv->hw->dma->stop_tx(priv->ioaddr);
-	priv->hw->dma->stop_rx(priv->ioaddr);
+	stmmac_stop_all_dma(priv);
 
 	/* Enable Power down mode by programming the PMT regs */
 	if (device_may_wakeup(priv->device)) {
@@ -3076,6 +4060,7 @@ int stmmac_resume(struct net_device *ndev)
 {
 	struct stmmac_priv *priv = netdev_priv(ndev);
 	unsigned long flags;
+	int i;
 
 	if (!netif_running(ndev))
 		return 0;
@@ -3103,19 +4088,24 @@ int stmmac_resume(struct net_device *ndev)
 
 	netif_device_attach(ndev);
 
-	priv->cur_rx = 0;
-	priv->dirty_rx = 0;
-	priv->dirty_tx = 0;
-	priv->cur_tx = 0;
+	for (i = 0; i < priv->num_chans; i++) {
+		struct stmmac_channel *ch = &priv->chan[i];
+
+		ch->cur_rx = 0;
+		ch->dirty_rx = 0;
+		ch->dirty_tx = 0;
+		ch->cur_tx = 0;
+	}
 	stmmac_clear_descriptors(priv);
 
 	stmmac_hw_setup(ndev, false);
 	stmmac_init_tx_coalesce(priv);
+	stmmac_init_adaptive_coal(priv);
 	stmmac_set_rx_mode(ndev);
 
-	napi_enable(&priv->napi);
+	stmmac_enable_all_napi(priv);
 
-	netif_start_queue(ndev);
+	netif_tx_start_all_queues(ndev);
 
 	spin_unlock_irqrestore(&priv->lock, flags);
 
@@ -158,6 +158,8 @@ stmmac_probe_config_dt(struct platform_device *pdev, const char **mac)
 
 	of_property_read_u32(np, "rx-fifo-depth", &plat->rx_fifo_size);
 
+	of_property_read_u32(np, "snps,dma-channels", &plat->dma_channels);
+
 	plat->force_sf_dma_mode =
 		of_property_read_bool(np, "snps,force_sf_dma_mode");
 
@@ -245,6 +247,8 @@ int stmmac_get_platform_resources(struct platform_device *pdev,
 				  struct stmmac_resources *stmmac_res)
 {
 	struct resource *res;
+	char name[16];
+	int i;
 
 	memset(stmmac_res, 0, sizeof(*stmmac_res));
 
@@ -278,6 +282,18 @@ int stmmac_get_platform_resources(struct platform_device *pdev,
 	if (stmmac_res->lpi_irq == -EPROBE_DEFER)
 		return -EPROBE_DEFER;
 
+	/* The additional DMA channels can have their own irq, named as
+	 * "dma_chan<n>"; without it the channel is served by the mac irq.
+	 */
+	for (i = 1; i < STMMAC_MAX_CHANNELS; i++) {
+		snprintf(name, sizeof(name), "dma_chan%d", i);
+		stmmac_res->chan_irq[i] = platform_get_irq_byname(pdev, name);
+		if (stmmac_res->chan_irq[i] == -EPROBE_DEFER)
+			return -EPROBE_DEFER;
+		if (stmmac_res->chan_irq[i] < 0)
+			stmmac_res->chan_irq[i] = 0;
+	}
+
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	stmmac_res->addr = devm_ioremap_resource(&pdev->dev, res);
 
@@ -103,6 +103,12 @@ struct ath10k_skb_cb {
 	} bcn;
 } __packed;
 
+/* Driver private part of a mac80211 txq */
+struct ath10k_txq {
+	/* entry in ath10k::txqs while the txq has frames to push */
+	struct list_head list;
+};
+
 struct ath10k_skb_rxcb {
 	dma_addr_t paddr;
 	struct hlist_node hlist;
@@ -789,6 +795,10 @@ struct ath10k {
 	struct work_struct wmi_mgmt_tx_work;
 	struct sk_buff_head wmi_mgmt_tx_queue;
 
+	/* mac80211 txqs waiting to be pushed, protected by txqs_lock */
+	struct list_head txqs;
+	spinlock_t txqs_lock;
+
 	enum ath10k_state state;
 
 	struct work_struct register_work;
@@ -1495,8 +1495,10 @@ struct ath10k_htt {
 	struct tasklet_struct rx_replenish_task;
 
 	/* This is used to group tx/rx completions separately and process them
-	 * in batches to reduce cache stalls */
-	struct tasklet_struct txrx_compl_task;
+	 * in batches to reduce cache stalls. They are processed by a NAPI
+	 * context, on a dummy netdev, within its budget. */
+	struct net_device napi_dev;
+	struct napi_struct napi;
 	struct sk_buff_head tx_compl_q;
 	struct sk_buff_head rx_compl_q;
 	struct sk_buff_head rx_in_ord_compl_q;
@@ -1557,6 +1559,9 @@ struct htt_rx_desc {
  * aggregated traffic more nicely. */
 #define ATH10K_HTT_MAX_NUM_REFILL 16
 
+/* NAPI weight of the rx processing, in MSDUs */
+#define ATH10K_HTT_NAPI_WEIGHT 64
+
 /*
  * DMA_MAP expects the buffer to be an integral number of cache lines.
  * Rather than checking the actual cache line size, this code makes a
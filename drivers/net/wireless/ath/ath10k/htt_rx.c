@@ -32,7 +32,7 @@
 #define HTT_RX_RING_REFILL_RETRY_MS 50
 
 static int ath10k_htt_rx_get_csum_state(struct sk_buff *skb);
-static void ath10k_htt_txrx_compl_task(unsigned long ptr);
+static int ath10k_htt_txrx_compl_poll(struct napi_struct *napi, int budget);
 
 static struct sk_buff *
 ath10k_htt_rx_find_skb_paddr(struct ath10k *ar, u32 paddr)
@@ -158,7 +158,8 @@ static int ath10k_htt_rx_ring_fill_n(struct ath10k_htt *htt, int num)
 	return __ath10k_htt_rx_ring_fill_n(htt, num);
 }
 
-static void ath10k_htt_rx_msdu_buff_replenish(struct ath10k_htt *htt)
+static void ath10k_htt_rx_msdu_buff_replenish(struct ath10k_htt *htt,
+					       int max_fill)
 {
 	int ret, num_deficit, num_to_fill;
 
@@ -176,10 +177,13 @@ static void ath10k_htt_rx_msdu_buff_replenish(struct ath10k_htt *htt)
 	 * automatically balances load wrt to CPU power.
 	 *
 	 * This probably comes at a cost of lower maximum throughput but
-	 * improves the average and stability. */
+	 * improves the average and stability.
+	 *
+	 * The NAPI poll refills what it consumed in one go, the budget already
+	 * bounds it, and the ring index is written once per batch. */
 	spin_lock_bh(&htt->rx_ring.lock);
 	num_deficit = htt->rx_ring.fill_level - htt->rx_ring.fill_cnt;
-	num_to_fill = min(ATH10K_HTT_MAX_NUM_REFILL, num_deficit);
+	num_to_fill = min(max_fill, num_deficit);
 	num_deficit -= num_to_fill;
 	ret = ath10k_htt_rx_ring_fill_n(htt, num_to_fill);
 	if (ret == -ENOMEM) {
@@ -201,7 +205,7 @@ static void ath10k_htt_rx_ring_refill_retry(unsigned long arg)
 {
 	struct ath10k_htt *htt = (struct ath10k_htt *)arg;
 
-	ath10k_htt_rx_msdu_buff_replenish(htt);
+	ath10k_htt_rx_msdu_buff_replenish(htt, ATH10K_HTT_MAX_NUM_REFILL);
 }
 
 int ath10k_htt_rx_ring_refill(struct ath10k *ar)
@@ -223,8 +227,9 @@ int ath10k_htt_rx_ring_refill(struct ath10k *ar)
 void ath10k_htt_rx_free(struct ath10k_htt *htt)
 {
 	del_timer_sync(&htt->rx_ring.refill_retry_timer);
+	napi_disable(&htt->napi);
+	netif_napi_del(&htt->napi);
 	tasklet_kill(&htt->rx_replenish_task);
-	tasklet_kill(&htt->txrx_compl_task);
 
 	skb_queue_purge(&htt->tx_compl_q);
 	skb_queue_purge(&htt->rx_compl_q);
@@ -427,7 +432,7 @@ static void ath10k_htt_rx_replenish_task(unsigned long ptr)
 {
 	struct ath10k_htt *htt = (struct ath10k_htt *)ptr;
 
-	ath10k_htt_rx_msdu_buff_replenish(htt);
+	ath10k_htt_rx_msdu_buff_replenish(htt, ATH10K_HTT_MAX_NUM_REFILL);
 }
 
 static struct sk_buff *ath10k_htt_rx_pop_paddr(struct ath10k_htt *htt,
@@ -570,8 +575,10 @@ int ath10k_htt_rx_alloc(struct ath10k_htt *htt)
 	skb_queue_head_init(&htt->rx_compl_q);
 	skb_queue_head_init(&htt->rx_in_ord_compl_q);
 
-	tasklet_init(&htt->txrx_compl_task, ath10k_htt_txrx_compl_task,
-		     (unsigned long)htt);
+	init_dummy_netdev(&htt->napi_dev);
+	netif_napi_add(&htt->napi_dev, &htt->napi, ath10k_htt_txrx_compl_poll,
+		       ATH10K_HTT_NAPI_WEIGHT);
+	napi_enable(&htt->napi);
 
 	ath10k_dbg(ar, ATH10K_DBG_BOOT, "htt rx ring size %d fill_level %d\n",
 		   htt->rx_ring.size, htt->rx_ring.fill_level);
@@ -1005,7 +1012,7 @@ static void ath10k_process_rx(struct ath10k *ar,
 	trace_ath10k_rx_hdr(ar, skb->data, skb->len);
 	trace_ath10k_rx_payload(ar, skb->data, skb->len);
 
-	ieee80211_rx(ar->hw, skb);
+	ieee80211_rx_napi(ar->hw, skb, &ar->htt.napi);
 }
 
 static int ath10k_htt_rx_nwifi_hdrlen(struct ath10k *ar,
@@ -1409,11 +1416,12 @@ static void ath10k_htt_rx_h_mpdu(struct ath10k *ar,
 	}
 }
 
-static void ath10k_htt_rx_h_deliver(struct ath10k *ar,
-				    struct sk_buff_head *amsdu,
-				    struct ieee80211_rx_status *status)
+static int ath10k_htt_rx_h_deliver(struct ath10k *ar,
+				   struct sk_buff_head *amsdu,
+				   struct ieee80211_rx_status *status)
 {
 	struct sk_buff *msdu;
+	int num_msdus = 0;
 
 	while ((msdu = __skb_dequeue(amsdu))) {
 		/* Setup per-MSDU flags */
@@ -1423,7 +1431,10 @@ static void ath10k_htt_rx_h_deliver(struct ath10k *ar,
 			status->flag |= RX_FLAG_AMSDU_MORE;
 
 		ath10k_process_rx(ar, status, msdu);
+		num_msdus++;
 	}
+
+	return num_msdus;
 }
 
 static int ath10k_unchain_msdu(struct sk_buff_head *amsdu)
@@ -1558,8 +1569,9 @@ static void ath10k_htt_rx_h_filter(struct ath10k *ar,
 	__skb_queue_purge(amsdu);
 }
 
-static void ath10k_htt_rx_handler(struct ath10k_htt *htt,
-				  struct htt_rx_indication *rx)
+/* Returns the number of MSDUs delivered */
+static int ath10k_htt_rx_handler(struct ath10k_htt *htt,
+				 struct htt_rx_indication *rx)
 {
 	struct ath10k *ar = htt->ar;
 	struct ieee80211_rx_status *rx_status = &htt->rx_status;
@@ -1569,11 +1581,12 @@ static void ath10k_htt_rx_handler(struct ath10k_htt *htt,
 	int fw_desc_len;
 	u8 *fw_desc;
 	int i, ret, mpdu_count = 0;
+	int num_msdus = 0;
 
 	lockdep_assert_held(&htt->rx_ring.lock);
 
 	if (htt->rx_confused)
-		return;
+		return 0;
 
 	fw_desc_len = __le16_to_cpu(rx->prefix.fw_rx_desc_bytes);
 	fw_desc = (u8 *)&rx->fw_desc;
@@ -1608,14 +1621,15 @@ static void ath10k_htt_rx_handler(struct ath10k_htt *htt,
 		ath10k_htt_rx_h_unchain(ar, &amsdu, ret > 0);
 		ath10k_htt_rx_h_filter(ar, &amsdu, rx_status);
 		ath10k_htt_rx_h_mpdu(ar, &amsdu, rx_status);
-		ath10k_htt_rx_h_deliver(ar, &amsdu, rx_status);
+		num_msdus += ath10k_htt_rx_h_deliver(ar, &amsdu, rx_status);
 	}
 
-	tasklet_schedule(&htt->rx_replenish_task);
+	return num_msdus;
 }
 
-static void ath10k_htt_rx_frag_handler(struct ath10k_htt *htt,
-				       struct htt_rx_fragment_indication *frag)
+/* Returns the number of MSDUs delivered */
+static int ath10k_htt_rx_frag_handler(struct ath10k_htt *htt,
+				      struct htt_rx_fragment_indication *frag)
 {
 	struct ath10k *ar = htt->ar;
 	struct ieee80211_rx_status *rx_status = &htt->rx_status;
@@ -1624,17 +1638,15 @@ static void ath10k_htt_rx_frag_handler(struct ath10k_htt *htt,
 	u8 *fw_desc;
 	int fw_desc_len;
 
+	lockdep_assert_held(&htt->rx_ring.lock);
+
 	fw_desc_len = __le16_to_cpu(frag->fw_rx_desc_bytes);
 	fw_desc = (u8 *)frag->fw_msdu_rx_desc;
 
 	__skb_queue_head_init(&amsdu);
 
-	spin_lock_bh(&htt->rx_ring.lock);
 	ret = ath10k_htt_rx_amsdu_pop(htt, &fw_desc, &fw_desc_len,
 				      &amsdu);
-	spin_unlock_bh(&htt->rx_ring.lock);
-
-	tasklet_schedule(&htt->rx_replenish_task);
 
 	ath10k_dbg(ar, ATH10K_DBG_HTT_DUMP, "htt rx frag ahead\n");
 
@@ -1642,25 +1654,26 @@ static void ath10k_htt_rx_frag_handler(struct ath10k_htt *htt,
 		ath10k_warn(ar, "failed to pop amsdu from httr rx ring for fragmented rx %d\n",
 			    ret);
 		__skb_queue_purge(&amsdu);
-		return;
+		return 0;
 	}
 
 	if (skb_queue_len(&amsdu) != 1) {
 		ath10k_warn(ar, "failed to pop frag amsdu: too many msdus\n");
 		__skb_queue_purge(&amsdu);
-		return;
+		return 0;
 	}
 
 	ath10k_htt_rx_h_ppdu(ar, &amsdu, rx_status, 0xffff);
 	ath10k_htt_rx_h_filter(ar, &amsdu, rx_status);
 	ath10k_htt_rx_h_mpdu(ar, &amsdu, rx_status);
-	ath10k_htt_rx_h_deliver(ar, &amsdu, rx_status);
 
 	if (fw_desc_len > 0) {
 		ath10k_dbg(ar, ATH10K_DBG_HTT,
 			   "expecting more fragmented rx in one indication %d\n",
 			   fw_desc_len);
 	}
+
+	return ath10k_htt_rx_h_deliver(ar, &amsdu, rx_status);
 }
 
 static void ath10k_htt_rx_frm_tx_compl(struct ath10k *ar,
@@ -1882,7 +1895,8 @@ static void ath10k_htt_rx_h_rx_offload(struct ath10k *ar,
 	}
 }
 
-static void ath10k_htt_rx_in_ord_ind(struct ath10k *ar, struct sk_buff *skb)
+/* Returns the number of MSDUs delivered */
+static int ath10k_htt_rx_in_ord_ind(struct ath10k *ar, struct sk_buff *skb)
 {
 	struct ath10k_htt *htt = &ar->htt;
 	struct htt_resp *resp = (void *)skb->data;
@@ -1900,7 +1914,7 @@ static void ath10k_htt_rx_in_ord_ind(struct ath10k *ar, struct sk_buff *skb)
 	lockdep_assert_held(&htt->rx_ring.lock);
 
 	if (htt->rx_confused)
-		return;
+		return 0;
 
 	skb_pull(skb, sizeof(resp->hdr));
 	skb_pull(skb, sizeof(resp->rx_in_ord_ind));
@@ -1919,7 +1933,7 @@ static void ath10k_htt_rx_in_ord_ind(struct ath10k *ar, struct sk_buff *skb)
 
 	if (skb->len < msdu_count * sizeof(*resp->rx_in_ord_ind.msdu_descs)) {
 		ath10k_warn(ar, "dropping invalid in order rx indication\n");
-		return;
+		return 0;
 	}
 
 	/* The event can deliver more than 1 A-MSDU. Each A-MSDU is later
@@ -1930,7 +1944,7 @@ static void ath10k_htt_rx_in_ord_ind(struct ath10k *ar, struct sk_buff *skb)
 	if (ret < 0) {
 		ath10k_warn(ar, "failed to pop paddr list: %d\n", ret);
 		htt->rx_confused = true;
-		return;
+		return 0;
 	}
 
 	/* Offloaded frames are very different and need to be handled
@@ -1962,11 +1976,11 @@ static void ath10k_htt_rx_in_ord_ind(struct ath10k *ar, struct sk_buff *skb)
 			ath10k_warn(ar, "failed to extract amsdu: %d\n", ret);
 			htt->rx_confused = true;
 			__skb_queue_purge(&list);
-			return;
+			return msdu_count;
 		}
 	}
 
-	tasklet_schedule(&htt->rx_replenish_task);
+	return msdu_count;
 }
 
 void ath10k_htt_t2h_msg_handler(struct ath10k *ar, struct sk_buff *skb)
@@ -1998,10 +2012,14 @@ void ath10k_htt_t2h_msg_handler(struct ath10k *ar, struct sk_buff *skb)
 		break;
 	}
 	case HTT_T2H_MSG_TYPE_RX_IND:
+	case HTT_T2H_MSG_TYPE_RX_FRAG_IND:
+		/* Both pop from the rx ring, so they share a queue to be
+		 * processed in order.
+		 */
 		spin_lock_bh(&htt->rx_ring.lock);
 		__skb_queue_tail(&htt->rx_compl_q, skb);
 		spin_unlock_bh(&htt->rx_ring.lock);
-		tasklet_schedule(&htt->txrx_compl_task);
+		napi_schedule(&htt->napi);
 		return;
 	case HTT_T2H_MSG_TYPE_PEER_MAP: {
 		struct htt_peer_map_event ev = {
@@ -2043,7 +2061,7 @@ void ath10k_htt_t2h_msg_handler(struct ath10k *ar, struct sk_buff *skb)
 	}
 	case HTT_T2H_MSG_TYPE_TX_COMPL_IND:
 		skb_queue_tail(&htt->tx_compl_q, skb);
-		tasklet_schedule(&htt->txrx_compl_task);
+		napi_schedule(&htt->napi);
 		return;
 	case HTT_T2H_MSG_TYPE_SEC_IND: {
 		struct ath10k *ar = htt->ar;
@@ -2057,12 +2075,6 @@ void ath10k_htt_t2h_msg_handler(struct ath10k *ar, struct sk_buff *skb)
 		complete(&ar->install_key_done);
 		break;
 	}
-	case HTT_T2H_MSG_TYPE_RX_FRAG_IND: {
-		ath10k_dbg_dump(ar, ATH10K_DBG_HTT_DUMP, NULL, "htt event: ",
-				skb->data, skb->len);
-		ath10k_htt_rx_frag_handler(htt, &resp->rx_frag_ind);
-		break;
-	}
 	case HTT_T2H_MSG_TYPE_TEST:
 		break;
 	case HTT_T2H_MSG_TYPE_STATS_CONF:
@@ -2101,7 +2113,7 @@ void ath10k_htt_t2h_msg_handler(struct ath10k *ar, struct sk_buff *skb)
 		spin_lock_bh(&htt->rx_ring.lock);
 		__skb_queue_tail(&htt->rx_in_ord_compl_q, skb);
 		spin_unlock_bh(&htt->rx_ring.lock);
-		tasklet_schedule(&htt->txrx_compl_task);
+		napi_schedule(&htt->napi);
 		return;
 	}
 	case HTT_T2H_MSG_TYPE_TX_CREDIT_UPDATE_IND:
@@ -2127,28 +2139,68 @@ void ath10k_htt_t2h_msg_handler(struct ath10k *ar, struct sk_buff *skb)
 }
 EXPORT_SYMBOL(ath10k_htt_t2h_msg_handler);
 
-static void ath10k_htt_txrx_compl_task(unsigned long ptr)
+static int ath10k_htt_txrx_compl_poll(struct napi_struct *napi, int budget)
 {
-	struct ath10k_htt *htt = (struct ath10k_htt *)ptr;
+	struct ath10k_htt *htt = container_of(napi, struct ath10k_htt, napi);
 	struct ath10k *ar = htt->ar;
 	struct htt_resp *resp;
 	struct sk_buff *skb;
+	int done = 0, num_ind = 0;
 
+	/* tx completions are cheap and free ring space, they don't count */
 	while ((skb = skb_dequeue(&htt->tx_compl_q))) {
 		ath10k_htt_rx_frm_tx_compl(htt->ar, skb);
 		dev_kfree_skb_any(skb);
 	}
 
+	/* Refill the firmware from the mac80211 txqs now that there is room */
+	ath10k_mac_tx_push_pending(ar);
+
+	/* An indication is always processed as a whole, the budget is only
+	 * checked in between.
+	 */
 	spin_lock_bh(&htt->rx_ring.lock);
-	while ((skb = __skb_dequeue(&htt->rx_compl_q))) {
+	while (done < budget && (skb = __skb_dequeue(&htt->rx_compl_q))) {
 		resp = (struct htt_resp *)skb->data;
-		ath10k_htt_rx_handler(htt, &resp->rx_ind);
+		if (ar->htt.t2h_msg_types[resp->hdr.msg_type] ==
+		    HTT_T2H_MSG_TYPE_RX_FRAG_IND) {
+			ath10k_dbg_dump(ar, ATH10K_DBG_HTT_DUMP, NULL,
+					"htt event: ", skb->data, skb->len);
+			done += ath10k_htt_rx_frag_handler(htt,
+							   &resp->rx_frag_ind);
+		} else {
+			done += ath10k_htt_rx_handler(htt, &resp->rx_ind);
+		}
 		dev_kfree_skb_any(skb);
+		num_ind++;
 	}
 
-	while ((skb = __skb_dequeue(&htt->rx_in_ord_compl_q))) {
-		ath10k_htt_rx_in_ord_ind(ar, skb);
+	while (done < budget &&
+	       (skb = __skb_dequeue(&htt->rx_in_ord_compl_q))) {
+		done += ath10k_htt_rx_in_ord_ind(ar, skb);
 		dev_kfree_skb_any(skb);
+		num_ind++;
 	}
 	spin_unlock_bh(&htt->rx_ring.lock);
+
+	/* Give the ring back what this poll took from it, in one batch */
+	if (num_ind)
+		ath10k_htt_rx_msdu_buff_replenish(htt, max(done,
+						  ATH10K_HTT_MAX_NUM_REFILL));
+
+	if (done >= budget)
+		return budget;
+
+	napi_complete(napi);
+
+	/* Indications queued while the poll was still scheduled did not
+	 * schedule it again.
+	 */
+	if (!skb_queue_empty(&htt->tx_compl_q) ||
+	    !skb_queue_empty(&htt->rx_compl_q) ||
+	    !skb_queue_empty(&htt->rx_in_ord_compl_q) ||
+	    ath10k_mac_tx_has_pending(ar))
+		napi_schedule(napi);
+
+	return done;
 }
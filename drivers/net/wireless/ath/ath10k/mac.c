@@ -3626,14 +3626,11 @@ static int ath10k_start_scan(struct ath10k *ar,
 /* mac80211 callbacks */
 /**********************/
 
-static void ath10k_tx(struct ieee80211_hw *hw,
-		      struct ieee80211_tx_control *control,
-		      struct sk_buff *skb)
+static void ath10k_mac_tx_frame(struct ath10k *ar, struct ieee80211_vif *vif,
+				struct ieee80211_sta *sta, struct sk_buff *skb)
 {
-	struct ath10k *ar = hw->priv;
+	struct ieee80211_hw *hw = ar->hw;
 	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
-	struct ieee80211_vif *vif = info->control.vif;
-	struct ieee80211_sta *sta = control->sta;
 	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)skb->data;
 	__le16 fc = hdr->frame_control;
 
@@ -3689,12 +3686,152 @@ static void ath10k_tx(struct ieee80211_hw *hw,
 	ath10k_mac_tx(ar, skb);
 }
 
+static void ath10k_tx(struct ieee80211_hw *hw,
+		      struct ieee80211_tx_control *control,
+		      struct sk_buff *skb)
+{
+	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+
+	ath10k_mac_tx_frame(hw->priv, info->control.vif, control->sta, skb);
+}
+
+/* Data frames are not handed over by mac80211 anymore but wait in its
+ * per station/tid txqs until the driver pulls them. Only a limited number
+ * of frames is kept in flight in the firmware, the rest stays in the
+ * txqs where it is scheduled fairly between stations instead of sitting
+ * in one long firmware queue.
+ */
+#define ATH10K_MAC_TX_MAX_FW_QUEUED	256
+
+/* Frames taken from one txq before moving on to the next one */
+#define ATH10K_MAC_TX_TXQ_QUANTUM	16
+
+static void ath10k_mac_txq_init(struct ieee80211_txq *txq)
+{
+	struct ath10k_txq *artxq;
+
+	if (!txq)
+		return;
+
+	artxq = (void *)txq->drv_priv;
+	INIT_LIST_HEAD(&artxq->list);
+}
+
+static void ath10k_mac_txq_unref(struct ath10k *ar, struct ieee80211_txq *txq)
+{
+	struct ath10k_txq *artxq;
+
+	if (!txq)
+		return;
+
+	artxq = (void *)txq->drv_priv;
+
+	spin_lock_bh(&ar->txqs_lock);
+	list_del_init(&artxq->list);
+	spin_unlock_bh(&ar->txqs_lock);
+}
+
+static bool ath10k_mac_tx_can_push(struct ath10k *ar)
+{
+	struct ath10k_htt *htt = &ar->htt;
+
+	return htt->num_pending_tx < min(htt->max_num_pending_tx,
+					 ATH10K_MAC_TX_MAX_FW_QUEUED);
+}
+
+bool ath10k_mac_tx_has_pending(struct ath10k *ar)
+{
+	return !list_empty_careful(&ar->txqs) && ath10k_mac_tx_can_push(ar);
+}
+
+static int ath10k_mac_tx_push_txq(struct ath10k *ar,
+				  struct ieee80211_txq *txq)
+{
+	struct sk_buff *skb;
+
+	skb = ieee80211_tx_dequeue(ar->hw, txq);
+	if (!skb)
+		return -ENOENT;
+
+	ath10k_mac_tx_frame(ar, txq->vif, txq->sta, skb);
+	return 0;
+}
+
+/* Called from the htt NAPI poll, which serializes all pushing */
+void ath10k_mac_tx_push_pending(struct ath10k *ar)
+{
+	struct ath10k_txq *artxq, *last;
+	struct ieee80211_txq *txq;
+	int quantum, ret;
+
+	spin_lock_bh(&ar->txqs_lock);
+	rcu_read_lock();
+
+	if (list_empty(&ar->txqs))
+		goto out;
+
+	/* Go over each txq at most once per call */
+	last = list_last_entry(&ar->txqs, struct ath10k_txq, list);
+	while (ath10k_mac_tx_can_push(ar)) {
+		artxq = list_first_entry(&ar->txqs, struct ath10k_txq, list);
+		txq = container_of((void *)artxq, struct ieee80211_txq,
+				   drv_priv);
+
+		ret = 0;
+		quantum = ATH10K_MAC_TX_TXQ_QUANTUM;
+		while (quantum-- && ath10k_mac_tx_can_push(ar)) {
+			ret = ath10k_mac_tx_push_txq(ar, txq);
+			if (ret)
+				break;
+		}
+
+		/* An emptied txq is put back by its next wake_tx_queue */
+		list_del_init(&artxq->list);
+		if (ret != -ENOENT)
+			list_add_tail(&artxq->list, &ar->txqs);
+
+		if (artxq == last || list_empty(&ar->txqs))
+			break;
+	}
+
+out:
+	rcu_read_unlock();
+	spin_unlock_bh(&ar->txqs_lock);
+}
+
+static void ath10k_wake_tx_queue(struct ieee80211_hw *hw,
+				 struct ieee80211_txq *txq)
+{
+	struct ath10k *ar = hw->priv;
+	struct ath10k_txq *artxq = (void *)txq->drv_priv;
+
+	spin_lock_bh(&ar->txqs_lock);
+	if (list_empty(&artxq->list))
+		list_add_tail(&artxq->list, &ar->txqs);
+	spin_unlock_bh(&ar->txqs_lock);
+
+	/* Otherwise the next tx completion pushes it */
+	if (ath10k_mac_tx_can_push(ar)) {
+		local_bh_disable();
+		napi_schedule(&ar->htt.napi);
+		local_bh_enable();
+	}
+}
+
 /* Must not be called with conf_mutex held as workers can use that also. */
 void ath10k_drain_tx(struct ath10k *ar)
 {
+	struct ath10k_txq *artxq, *tmp;
+
 	/* make sure rcu-protected mac80211 tx path itself is drained */
 	synchronize_net();
 
+	/* mac80211 keeps the frames, the txqs are woken again on restart */
+	spin_lock_bh(&ar->txqs_lock);
+	list_for_each_entry_safe(artxq, tmp, &ar->txqs, list)
+		list_del_init(&artxq->list);
+	spin_unlock_bh(&ar->txqs_lock);
+
 	ath10k_offchan_tx_purge(ar);
 	ath10k_mgmt_over_wmi_tx_purge(ar);
 
@@ -4299,6 +4436,7 @@ static int ath10k_add_interface(struct ieee80211_hw *hw,
 	mutex_lock(&ar->conf_mutex);
 
 	memset(arvif, 0, sizeof(*arvif));
+	ath10k_mac_txq_init(vif->txq);
 
 	arvif->ar = ar;
 	arvif->vif = vif;
@@ -4594,6 +4732,8 @@ static void ath10k_remove_interface(struct ieee80211_hw *hw,
 	cancel_work_sync(&arvif->ap_csa_work);
 	cancel_delayed_work_sync(&arvif->connection_loss_work);
 
+	ath10k_mac_txq_unref(ar, vif->txq);
+
 	mutex_lock(&ar->conf_mutex);
 
 	spin_lock_bh(&ar->data_lock);
@@ -5361,19 +5501,27 @@ static int ath10k_sta_state(struct ieee80211_hw *hw,
 	struct ath10k_vif *arvif = ath10k_vif_to_arvif(vif);
 	struct ath10k_sta *arsta = (struct ath10k_sta *)sta->drv_priv;
 	int ret = 0;
+	int i;
 
 	if (old_state == IEEE80211_STA_NOTEXIST &&
 	    new_state == IEEE80211_STA_NONE) {
 		memset(arsta, 0, sizeof(*arsta));
 		arsta->arvif = arvif;
 		INIT_WORK(&arsta->update_wk, ath10k_sta_rc_update_wk);
+
+		for (i = 0; i < ARRAY_SIZE(sta->txq); i++)
+			ath10k_mac_txq_init(sta->txq[i]);
 	}
 
 	/* cancel must be done outside the mutex to avoid deadlock */
 	if ((old_state == IEEE80211_STA_NONE &&
-	     new_state == IEEE80211_STA_NOTEXIST))
+	     new_state == IEEE80211_STA_NOTEXIST)) {
 		cancel_work_sync(&arsta->update_wk);
 
+		for (i = 0; i < ARRAY_SIZE(sta->txq); i++)
+			ath10k_mac_txq_unref(ar, sta->txq[i]);
+	}
+
 	mutex_lock(&ar->conf_mutex);
 
 	if (old_state == IEEE80211_STA_NOTEXIST &&
@@ -6774,6 +6922,7 @@ ath10k_mac_op_switch_vif_chanctx(struct ieee80211_hw *hw,
 
 static const struct ieee80211_ops ath10k_ops = {
 	.tx				= ath10k_tx,
+	.wake_tx_queue			= ath10k_wake_tx_queue,
 	.start				= ath10k_start,
 	.stop				= ath10k_stop,
 	.config				= ath10k_config,
@@ -7224,6 +7373,7 @@ int ath10k_mac_register(struct ath10k *ar)
 
 	ar->hw->vif_data_size = sizeof(struct ath10k_vif);
 	ar->hw->sta_data_size = sizeof(struct ath10k_sta);
+	ar->hw->txq_data_size = sizeof(struct ath10k_txq);
 
 	ar->hw->max_listen_interval = ATH10K_MAX_HW_LISTEN_INTERVAL;
 
@@ -23,6 +23,7 @@
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
 #include <linux/interrupt.h>
+#include <linux/netdevice.h>
 #include "wcn36xx.h"
 #include "txrx.h"
 
@@ -348,12 +349,20 @@ static void reap_tx_dxes(struct wcn36xx *wcn, struct wcn36xx_dxe_ch *ch)
 {
 	struct wcn36xx_dxe_ctl *ctl;
 	struct ieee80211_tx_info *info;
+	struct sk_buff_head done;
+	struct sk_buff *skb;
 	unsigned long flags;
+	bool wake = false;
+
+	__skb_queue_head_init(&done);
 
 	/*
 	 * Make at least one loop of do-while because in case ring is
 	 * completely full head and tail are pointing to the same element
 	 * and while-do will not make any cycles.
+	 *
+	 * The completed frames are only collected under the ring lock and
+	 * freed, and the queues woken, once for the whole batch.
 	 */
 	spin_lock_irqsave(&ch->lock, flags);
 	ctl = ch->tail_blk_ctl;
@@ -366,12 +375,12 @@ static void reap_tx_dxes(struct wcn36xx *wcn, struct wcn36xx_dxe_ch *ch)
 			info = IEEE80211_SKB_CB(ctl->skb);
 			if (!(info->flags & IEEE80211_TX_CTL_REQ_TX_STATUS)) {
 				/* Keep frame until TX status comes */
-				ieee80211_free_txskb(wcn->hw, ctl->skb);
+				__skb_queue_tail(&done, ctl->skb);
 			}
 			spin_lock(&ctl->skb_lock);
 			if (wcn->queues_stopped) {
 				wcn->queues_stopped = false;
-				ieee80211_wake_queues(wcn->hw);
+				wake = true;
 			}
 			spin_unlock(&ctl->skb_lock);
 
@@ -383,6 +392,12 @@ static void reap_tx_dxes(struct wcn36xx *wcn, struct wcn36xx_dxe_ch *ch)
 
 	ch->tail_blk_ctl = ctl;
 	spin_unlock_irqrestore(&ch->lock, flags);
+
+	while ((skb = __skb_dequeue(&done)))
+		ieee80211_free_txskb(wcn->hw, skb);
+
+	if (wake)
+		ieee80211_wake_queues(wcn->hw);
 }
 
 static irqreturn_t wcn36xx_irq_tx_complete(int irq, void *dev)
@@ -432,9 +447,9 @@ static irqreturn_t wcn36xx_irq_rx_ready(int irq, void *dev)
 {
 	struct wcn36xx *wcn = (struct wcn36xx *)dev;
 
+	/* Kept disabled until the NAPI poll has emptied the rings */
 	disable_irq_nosync(wcn->rx_irq);
-	wcn36xx_dxe_rx_frame(wcn);
-	enable_irq(wcn->rx_irq);
+	napi_schedule(&wcn->napi);
 	return IRQ_HANDLED;
 }
 
@@ -467,14 +482,54 @@ out_err:
 
 }
 
+/*
+ * Copy a small frame out of its RX buffer, which stays mapped and goes
+ * back to the ring as it is. Returns the copy, or NULL if the frame is
+ * too large or the allocation failed.
+ */
+static struct sk_buff *wcn36xx_rx_copybreak(struct wcn36xx *wcn,
+					    struct wcn36xx_dxe_ctl *ctl,
+					    dma_addr_t dma_addr)
+{
+	struct wcn36xx_rx_bd bd;
+	struct sk_buff *skb;
+	unsigned int len;
+
+	dma_sync_single_for_cpu(wcn->dev, dma_addr, sizeof(bd),
+				DMA_FROM_DEVICE);
+	memcpy(&bd, ctl->skb->data, sizeof(bd));
+	buff_to_be((u32 *)&bd, sizeof(bd)/sizeof(u32));
+
+	len = bd.pdu.mpdu_header_off + bd.pdu.mpdu_len;
+	if (len > WCN36XX_RX_COPYBREAK || len < sizeof(bd))
+		goto out;
+
+	skb = napi_alloc_skb(&wcn->napi, len);
+	if (!skb)
+		goto out;
+
+	dma_sync_single_for_cpu(wcn->dev, dma_addr, len, DMA_FROM_DEVICE);
+	/* the BD is parsed again, and the frame put, by wcn36xx_rx_skb() */
+	memcpy(skb_tail_pointer(skb), ctl->skb->data, len);
+	dma_sync_single_for_device(wcn->dev, dma_addr, len, DMA_FROM_DEVICE);
+
+	return skb;
+
+out:
+	dma_sync_single_for_device(wcn->dev, dma_addr, sizeof(bd),
+				   DMA_FROM_DEVICE);
+	return NULL;
+}
+
 static int wcn36xx_rx_handle_packets(struct wcn36xx *wcn,
-				     struct wcn36xx_dxe_ch *ch)
+				     struct wcn36xx_dxe_ch *ch, int budget)
 {
 	struct wcn36xx_dxe_ctl *ctl = ch->head_blk_ctl;
 	struct wcn36xx_dxe_desc *dxe = ctl->desc;
 	dma_addr_t  dma_addr;
 	struct sk_buff *skb;
 	int ret = 0, int_mask;
+	int done = 0;
 	u32 value;
 
 	if (ch->ch_type == WCN36XX_DXE_CH_RX_L) {
@@ -485,52 +540,81 @@ static int wcn36xx_rx_handle_packets(struct wcn36xx *wcn,
 		int_mask = WCN36XX_DXE_INT_CH3_MASK;
 	}
 
-	while (!(dxe->ctrl & WCN36XX_DXE_CTRL_VALID_MASK)) {
-		skb = ctl->skb;
+	while (done < budget && !(dxe->ctrl & WCN36XX_DXE_CTRL_VALID_MASK)) {
 		dma_addr = dxe->dst_addr_l;
-		ret = wcn36xx_dxe_fill_skb(wcn->dev, ctl);
-		if (0 == ret) {
-			/* new skb allocation ok. Use the new one and queue
-			 * the old one to network system.
-			 */
-			dma_unmap_single(wcn->dev, dma_addr, WCN36XX_PKT_SIZE,
-					DMA_FROM_DEVICE);
+		skb = wcn36xx_rx_copybreak(wcn, ctl, dma_addr);
+		if (skb) {
+			/* the buffer is reused as it is */
 			wcn36xx_rx_skb(wcn, skb);
-		} /* else keep old skb not submitted and use it for rx DMA */
+		} else {
+			skb = ctl->skb;
+			ret = wcn36xx_dxe_fill_skb(wcn->dev, ctl);
+			if (0 == ret) {
+				/* new skb allocation ok. Use the new one and
+				 * queue the old one to network system.
+				 */
+				dma_unmap_single(wcn->dev, dma_addr,
+						 WCN36XX_PKT_SIZE,
+						 DMA_FROM_DEVICE);
+				wcn36xx_rx_skb(wcn, skb);
+			}
+			/* else keep old skb not submitted and use it for
+			 * rx DMA
+			 */
+		}
 
 		dxe->ctrl = value;
 		ctl = ctl->next;
 		dxe = ctl->desc;
+		done++;
 	}
 	wcn36xx_dxe_write_register(wcn, WCN36XX_DXE_ENCH_ADDR, int_mask);
 
 	ch->head_blk_ctl = ctl;
-	return 0;
+	return done;
 }
 
-void wcn36xx_dxe_rx_frame(struct wcn36xx *wcn)
+static int wcn36xx_dxe_rx_frame(struct wcn36xx *wcn, int budget)
 {
-	int int_src;
+	int int_src, done;
 
 	wcn36xx_dxe_read_register(wcn, WCN36XX_DXE_INT_SRC_RAW_REG, &int_src);
 
 	/* RX_LOW_PRI */
-	if (int_src & WCN36XX_DXE_INT_CH1_MASK) {
+	if (int_src & WCN36XX_DXE_INT_CH1_MASK)
 		wcn36xx_dxe_write_register(wcn, WCN36XX_DXE_0_INT_CLR,
 					   WCN36XX_DXE_INT_CH1_MASK);
-		wcn36xx_rx_handle_packets(wcn, &(wcn->dxe_rx_l_ch));
-	}
 
 	/* RX_HIGH_PRI */
-	if (int_src & WCN36XX_DXE_INT_CH3_MASK) {
+	if (int_src & WCN36XX_DXE_INT_CH3_MASK)
 		/* Clean up all the INT within this channel */
 		wcn36xx_dxe_write_register(wcn, WCN36XX_DXE_0_INT_CLR,
 					   WCN36XX_DXE_INT_CH3_MASK);
-		wcn36xx_rx_handle_packets(wcn, &(wcn->dxe_rx_h_ch));
+
+	/*
+	 * The rings are walked whether or not their interrupt is pending:
+	 * a previous poll may have left frames behind once out of budget.
+	 */
+	done = wcn36xx_rx_handle_packets(wcn, &wcn->dxe_rx_l_ch, budget);
+	if (done < budget)
+		done += wcn36xx_rx_handle_packets(wcn, &wcn->dxe_rx_h_ch,
+						  budget - done);
+
+	return done;
+}
+
+static int wcn36xx_dxe_poll(struct napi_struct *napi, int budget)
+{
+	struct wcn36xx *wcn = container_of(napi, struct wcn36xx, napi);
+	int done;
+
+	done = wcn36xx_dxe_rx_frame(wcn, budget);
+	if (done < budget) {
+		napi_complete(napi);
+		enable_irq(wcn->rx_irq);
 	}
 
-	if (!int_src)
-		wcn36xx_warn("No DXE interrupt pending\n");
+	return done;
 }
 
 int wcn36xx_dxe_allocate_mem_pools(struct wcn36xx *wcn)
@@ -803,6 +887,11 @@ int wcn36xx_dxe_init(struct wcn36xx *wcn)
 	/* Enable channel interrupts */
 	wcn36xx_dxe_enable_ch_int(wcn, WCN36XX_INT_MASK_CHAN_RX_H);
 
+	init_dummy_netdev(&wcn->napi_dev);
+	netif_napi_add(&wcn->napi_dev, &wcn->napi, wcn36xx_dxe_poll,
+		       WCN36XX_NAPI_WEIGHT);
+	napi_enable(&wcn->napi);
+
 	ret = wcn36xx_dxe_request_irqs(wcn);
 	if (ret < 0)
 		goto out_err;
@@ -810,11 +899,17 @@ int wcn36xx_dxe_init(struct wcn36xx *wcn)
 	return 0;
 
 out_err:
+	napi_disable(&wcn->napi);
+	netif_napi_del(&wcn->napi);
 	return ret;
 }
 
 void wcn36xx_dxe_deinit(struct wcn36xx *wcn)
 {
+	/* a disabled napi ignores the schedules of interrupts still firing */
+	napi_disable(&wcn->napi);
+	netif_napi_del(&wcn->napi);
+
 	free_irq(wcn->tx_irq, wcn);
 	free_irq(wcn->rx_irq, wcn);
 
@@ -176,6 +176,12 @@ H2H_TEST_RX_TX = DMA2
 #define WCN36XX_BD_CHUNK_SIZE			128
 
 #define WCN36XX_PKT_SIZE			0xF20
+
+/* RX frames up to this size, BD included, are copied out so that their
+ * buffer goes back to the ring without being unmapped
+ */
+#define WCN36XX_RX_COPYBREAK			256
+#define WCN36XX_NAPI_WEIGHT			64
 enum wcn36xx_dxe_ch_type {
 	WCN36XX_DXE_CH_TX_L,
 	WCN36XX_DXE_CH_TX_H,
@@ -270,7 +276,6 @@ struct wcn36xx_dxe_mem_pool {
 struct wcn36xx_vif;
 int wcn36xx_dxe_allocate_mem_pools(struct wcn36xx *wcn);
 void wcn36xx_dxe_free_mem_pools(struct wcn36xx *wcn);
-void wcn36xx_dxe_rx_frame(struct wcn36xx *wcn);
 int wcn36xx_dxe_alloc_ctl_blks(struct wcn36xx *wcn);
 void wcn36xx_dxe_free_ctl_blks(struct wcn36xx *wcn);
 int wcn36xx_dxe_init(struct wcn36xx *wcn);
@@ -77,7 +77,7 @@ int wcn36xx_rx_skb(struct wcn36xx *wcn, struct sk_buff *skb)
 				 (char *)skb->data, skb->len);
 	}
 
-	ieee80211_rx_irqsafe(wcn->hw, skb);
+	ieee80211_rx_napi(wcn->hw, skb, &wcn->napi);
 
 	return 0;
 }
@@ -259,6 +259,10 @@ struct wcn36xx {
 	spinlock_t	dxe_lock;
 	bool                    queues_stopped;
 
+	/* RX is processed by NAPI, on a dummy netdev */
+	struct net_device	napi_dev;
+	struct napi_struct	napi;
+
 	/* Memory pools */
 	struct wcn36xx_dxe_mem_pool mgmt_mem_pool;
 	struct wcn36xx_dxe_mem_pool data_mem_pool;
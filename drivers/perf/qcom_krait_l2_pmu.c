@@ -0,0 +1,479 @@
+/*
+ * Qualcomm Krait L2 cache performance monitor
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/bitops.h>
+#include <linux/cpu.h>
+#include <linux/interrupt.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/perf_event.h>
+#include <linux/platform_device.h>
+
+#include <asm/krait-l2-accessors.h>
+
+/*
+ * The L2 PMU is shared by all Krait cores and is reached through the L2
+ * indirect register window, so it is exposed as an uncore PMU: events
+ * count for the whole cluster and are bound to the one CPU in "cpumask".
+ */
+#define L2PMCR			0x400
+#define L2PMCR_GLOBAL_ENABLE	BIT(0)
+#define L2PMCR_RESET_ALL	0x6
+#define L2PMCR_NUM_EV_SHIFT	11
+#define L2PMCR_NUM_EV_MASK	0x1f
+#define L2PMCNTENCLR		0x402
+#define L2PMCNTENSET		0x403
+#define L2PMINTENCLR		0x404
+#define L2PMINTENSET		0x405
+#define L2PMOVSR		0x406
+#define L2PMCCNTR		0x409
+#define L2PMRESR(n)		(0x410 + (n))
+#define L2PMRESR_EN		BIT(31)
+#define L2PMnEVCNTR(n)		(0x421 + (n) * 0x10)
+#define L2PMnEVFILTER(n)	(0x423 + (n) * 0x10)
+#define L2PMnEVTYPER(n)		(0x424 + (n) * 0x10)
+
+/* Count for every CPU of the cluster, in every mode */
+#define L2PMnEVFILTER_ALL	0x000f003f
+
+#define L2_MAX_COUNTERS		32
+#define L2_CYCLE_CTR_IDX	31
+
+/*
+ * Events are encoded as 0xRCCG: R selects the L2PMRESR register, CC is
+ * the group code and G which of its four byte-wide groups holds it.
+ * 0xfe, an invalid group, selects the cycle counter.
+ */
+#define L2_EVT_CYCLES		0xfe
+#define L2_EVT_REG(c)		(((c) >> 12) & 0xf)
+#define L2_EVT_CODE(c)		(((c) >> 4) & 0xff)
+#define L2_EVT_GROUP(c)		((c) & 0xf)
+#define L2_EVT_MASK		0xffff
+#define L2_MAX_RESR		4
+#define L2_MAX_GROUP		4
+
+struct krait_l2_pmu {
+	struct pmu pmu;
+	struct device *dev;
+	struct perf_event *events[L2_MAX_COUNTERS];
+	DECLARE_BITMAP(used_mask, L2_MAX_COUNTERS);
+	int num_counters;
+	int irq;
+	cpumask_t cpu;
+	struct notifier_block cpu_nb;
+};
+
+#define to_krait_l2_pmu(p) (container_of(p, struct krait_l2_pmu, pmu))
+
+static u32 krait_l2_counter_read(int idx)
+{
+	if (idx == L2_CYCLE_CTR_IDX)
+		return krait_get_l2_indirect_reg(L2PMCCNTR);
+	return krait_get_l2_indirect_reg(L2PMnEVCNTR(idx));
+}
+
+static void krait_l2_counter_write(int idx, u32 val)
+{
+	if (idx == L2_CYCLE_CTR_IDX)
+		krait_set_l2_indirect_reg(L2PMCCNTR, val);
+	else
+		krait_set_l2_indirect_reg(L2PMnEVCNTR(idx), val);
+}
+
+static void krait_l2_event_update(struct perf_event *event)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	u64 prev, now;
+
+	/* The counters are 32 bits wide, the overflow interrupt folds wraps */
+	do {
+		prev = local64_read(&hwc->prev_count);
+		now = krait_l2_counter_read(hwc->idx);
+	} while (local64_cmpxchg(&hwc->prev_count, prev, now) != prev);
+
+	local64_add((now - prev) & 0xffffffff, &event->count);
+}
+
+static void krait_l2_event_setup(int idx, u32 config)
+{
+	unsigned int reg = L2_EVT_REG(config);
+	unsigned int shift = L2_EVT_GROUP(config) * 8;
+	u32 resr;
+
+	krait_set_l2_indirect_reg(L2PMnEVTYPER(idx),
+				  L2_EVT_GROUP(config) + 4 * reg);
+
+	resr = krait_get_l2_indirect_reg(L2PMRESR(reg));
+	resr &= ~(0xff << shift);
+	resr |= L2PMRESR_EN | (L2_EVT_CODE(config) << shift);
+	krait_set_l2_indirect_reg(L2PMRESR(reg), resr);
+
+	krait_set_l2_indirect_reg(L2PMnEVFILTER(idx), L2PMnEVFILTER_ALL);
+}
+
+static void krait_l2_pmu_enable(struct pmu *pmu)
+{
+	krait_set_l2_indirect_reg(L2PMCR, L2PMCR_GLOBAL_ENABLE);
+}
+
+static void krait_l2_pmu_disable(struct pmu *pmu)
+{
+	krait_set_l2_indirect_reg(L2PMCR, 0);
+}
+
+static int krait_l2_event_init(struct perf_event *event)
+{
+	struct krait_l2_pmu *l2pmu;
+	struct hw_perf_event *hwc = &event->hw;
+	u64 config = event->attr.config;
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	l2pmu = to_krait_l2_pmu(event->pmu);
+
+	if (hwc->sample_period) {
+		dev_warn(l2pmu->dev, "Sampling not supported!\n");
+		return -EOPNOTSUPP;
+	}
+
+	if (has_branch_stack(event) || event->attr.exclude_user ||
+			event->attr.exclude_kernel || event->attr.exclude_hv ||
+			event->attr.exclude_idle) {
+		dev_warn(l2pmu->dev, "Can't exclude execution levels!\n");
+		return -EOPNOTSUPP;
+	}
+
+	if (event->cpu < 0) {
+		dev_warn(l2pmu->dev, "Can't provide per-task data!\n");
+		return -EOPNOTSUPP;
+	}
+
+	if (config & ~(u64)L2_EVT_MASK)
+		return -EINVAL;
+	if (config != L2_EVT_CYCLES &&
+	    (L2_EVT_REG(config) >= L2_MAX_RESR ||
+	     L2_EVT_GROUP(config) >= L2_MAX_GROUP))
+		return -EINVAL;
+
+	/* As for other uncore PMUs, keep all events on one CPU */
+	event->cpu = cpumask_first(&l2pmu->cpu);
+
+	hwc->idx = -1;
+	hwc->config_base = config;
+
+	return 0;
+}
+
+static void krait_l2_event_start(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	int idx = hwc->idx;
+
+	hwc->state = 0;
+
+	if (idx != L2_CYCLE_CTR_IDX)
+		krait_l2_event_setup(idx, hwc->config_base);
+
+	local64_set(&hwc->prev_count, 0);
+	krait_l2_counter_write(idx, 0);
+
+	krait_set_l2_indirect_reg(L2PMINTENSET, BIT(idx));
+	krait_set_l2_indirect_reg(L2PMCNTENSET, BIT(idx));
+}
+
+static void krait_l2_event_stop(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	int idx = hwc->idx;
+
+	if (hwc->state & PERF_HES_STOPPED)
+		return;
+
+	krait_set_l2_indirect_reg(L2PMCNTENCLR, BIT(idx));
+	krait_set_l2_indirect_reg(L2PMINTENCLR, BIT(idx));
+
+	krait_l2_event_update(event);
+	hwc->state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+/* Two events may only share an L2PMRESR group if they use the same code */
+static bool krait_l2_group_busy(struct krait_l2_pmu *l2pmu, u32 config)
+{
+	int idx;
+
+	for_each_set_bit(idx, l2pmu->used_mask, l2pmu->num_counters) {
+		u32 other = l2pmu->events[idx]->hw.config_base;
+
+		if (L2_EVT_REG(other) == L2_EVT_REG(config) &&
+		    L2_EVT_GROUP(other) == L2_EVT_GROUP(config) &&
+		    L2_EVT_CODE(other) != L2_EVT_CODE(config))
+			return true;
+	}
+
+	return false;
+}
+
+static int krait_l2_event_add(struct perf_event *event, int flags)
+{
+	struct krait_l2_pmu *l2pmu = to_krait_l2_pmu(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+	u32 config = hwc->config_base;
+	int idx;
+
+	if (config == L2_EVT_CYCLES) {
+		idx = L2_CYCLE_CTR_IDX;
+		if (test_bit(idx, l2pmu->used_mask))
+			return -EAGAIN;
+	} else {
+		idx = find_first_zero_bit(l2pmu->used_mask,
+					  l2pmu->num_counters);
+		if (idx >= l2pmu->num_counters ||
+		    krait_l2_group_busy(l2pmu, config))
+			return -EAGAIN;
+	}
+
+	set_bit(idx, l2pmu->used_mask);
+	l2pmu->events[idx] = event;
+	hwc->idx = idx;
+	hwc->state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+
+	if (flags & PERF_EF_START)
+		krait_l2_event_start(event, PERF_EF_RELOAD);
+
+	perf_event_update_userpage(event);
+
+	return 0;
+}
+
+static void krait_l2_event_del(struct perf_event *event, int flags)
+{
+	struct krait_l2_pmu *l2pmu = to_krait_l2_pmu(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+
+	krait_l2_event_stop(event, PERF_EF_UPDATE);
+	l2pmu->events[hwc->idx] = NULL;
+	clear_bit(hwc->idx, l2pmu->used_mask);
+	hwc->idx = -1;
+
+	perf_event_update_userpage(event);
+}
+
+static void krait_l2_event_read(struct perf_event *event)
+{
+	krait_l2_event_update(event);
+}
+
+static irqreturn_t krait_l2_pmu_irq(int irq, void *dev_id)
+{
+	struct krait_l2_pmu *l2pmu = dev_id;
+	unsigned long ovsr;
+	int idx;
+
+	ovsr = krait_get_l2_indirect_reg(L2PMOVSR);
+	if (!ovsr)
+		return IRQ_NONE;
+	krait_set_l2_indirect_reg(L2PMOVSR, ovsr);
+
+	for_each_set_bit(idx, &ovsr, L2_MAX_COUNTERS) {
+		struct perf_event *event = l2pmu->events[idx];
+
+		if (event)
+			krait_l2_event_update(event);
+	}
+
+	return IRQ_HANDLED;
+}
+
+static ssize_t krait_l2_pmu_cpumask_show(struct device *dev,
+					 struct device_attribute *attr,
+					 char *buf)
+{
+	struct krait_l2_pmu *l2pmu = to_krait_l2_pmu(dev_get_drvdata(dev));
+
+	return cpumap_print_to_pagebuf(true, buf, &l2pmu->cpu);
+}
+
+static struct device_attribute krait_l2_pmu_cpumask_attr =
+	__ATTR(cpumask, S_IRUGO, krait_l2_pmu_cpumask_show, NULL);
+
+static struct attribute *krait_l2_pmu_cpumask_attrs[] = {
+	&krait_l2_pmu_cpumask_attr.attr,
+	NULL,
+};
+
+static struct attribute_group krait_l2_pmu_cpumask_attr_group = {
+	.attrs = krait_l2_pmu_cpumask_attrs,
+};
+
+PMU_FORMAT_ATTR(event, "config:0-15");
+
+static struct attribute *krait_l2_pmu_format_attrs[] = {
+	&format_attr_event.attr,
+	NULL,
+};
+
+static struct attribute_group krait_l2_pmu_format_attr_group = {
+	.name = "format",
+	.attrs = krait_l2_pmu_format_attrs,
+};
+
+PMU_EVENT_ATTR_STRING(cycles, krait_l2_pmu_event_cycles, "event=0xfe");
+
+static struct attribute *krait_l2_pmu_event_attrs[] = {
+	&krait_l2_pmu_event_cycles.attr.attr,
+	NULL,
+};
+
+static struct attribute_group krait_l2_pmu_event_attr_group = {
+	.name = "events",
+	.attrs = krait_l2_pmu_event_attrs,
+};
+
+static const struct attribute_group *krait_l2_pmu_attr_groups[] = {
+	&krait_l2_pmu_cpumask_attr_group,
+	&krait_l2_pmu_format_attr_group,
+	&krait_l2_pmu_event_attr_group,
+	NULL,
+};
+
+static int krait_l2_pmu_cpu_notifier(struct notifier_block *nb,
+				     unsigned long action, void *hcpu)
+{
+	struct krait_l2_pmu *l2pmu = container_of(nb, struct krait_l2_pmu,
+						  cpu_nb);
+	unsigned int cpu = (long)hcpu; /* for (long) see kernel/cpu.c */
+	unsigned int target;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_DOWN_PREPARE:
+		if (!cpumask_test_and_clear_cpu(cpu, &l2pmu->cpu))
+			break;
+		target = cpumask_any_but(cpu_online_mask, cpu);
+		if (target >= nr_cpu_ids)
+			break;
+		perf_pmu_migrate_context(&l2pmu->pmu, cpu, target);
+		cpumask_set_cpu(target, &l2pmu->cpu);
+		WARN_ON(irq_set_affinity(l2pmu->irq, &l2pmu->cpu) != 0);
+	default:
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+static int krait_l2_pmu_probe(struct platform_device *pdev)
+{
+	struct krait_l2_pmu *l2pmu;
+	int err;
+
+	l2pmu = devm_kzalloc(&pdev->dev, sizeof(*l2pmu), GFP_KERNEL);
+	if (!l2pmu)
+		return -ENOMEM;
+
+	l2pmu->dev = &pdev->dev;
+	platform_set_drvdata(pdev, l2pmu);
+
+	l2pmu->irq = platform_get_irq(pdev, 0);
+	if (l2pmu->irq < 0) {
+		dev_err(&pdev->dev, "no overflow interrupt\n");
+		return l2pmu->irq;
+	}
+
+	/* Start from a clean state, everything stopped and cleared */
+	krait_set_l2_indirect_reg(L2PMCR, L2PMCR_RESET_ALL);
+	krait_set_l2_indirect_reg(L2PMCNTENCLR, ~0);
+	krait_set_l2_indirect_reg(L2PMINTENCLR, ~0);
+	krait_set_l2_indirect_reg(L2PMOVSR, ~0);
+
+	l2pmu->num_counters = (krait_get_l2_indirect_reg(L2PMCR) >>
+			       L2PMCR_NUM_EV_SHIFT) & L2PMCR_NUM_EV_MASK;
+	l2pmu->num_counters = min(l2pmu->num_counters, L2_CYCLE_CTR_IDX);
+
+	err = devm_request_irq(&pdev->dev, l2pmu->irq, krait_l2_pmu_irq,
+			       IRQF_NOBALANCING | IRQF_NO_THREAD,
+			       dev_name(&pdev->dev), l2pmu);
+	if (err)
+		return err;
+
+	/* Pick one CPU to collect data, and move when it goes offline */
+	cpumask_set_cpu(smp_processor_id(), &l2pmu->cpu);
+
+	l2pmu->cpu_nb.notifier_call = krait_l2_pmu_cpu_notifier;
+	l2pmu->cpu_nb.priority = CPU_PRI_PERF + 1;
+	err = register_cpu_notifier(&l2pmu->cpu_nb);
+	if (err)
+		return err;
+
+	err = irq_set_affinity(l2pmu->irq, &l2pmu->cpu);
+	if (err) {
+		dev_err(&pdev->dev, "Failed to set interrupt affinity!\n");
+		goto err_notifier;
+	}
+
+	l2pmu->pmu = (struct pmu) {
+		.task_ctx_nr	= perf_invalid_context,
+		.pmu_enable	= krait_l2_pmu_enable,
+		.pmu_disable	= krait_l2_pmu_disable,
+		.event_init	= krait_l2_event_init,
+		.add		= krait_l2_event_add,
+		.del		= krait_l2_event_del,
+		.start		= krait_l2_event_start,
+		.stop		= krait_l2_event_stop,
+		.read		= krait_l2_event_read,
+		.attr_groups	= krait_l2_pmu_attr_groups,
+	};
+
+	err = perf_pmu_register(&l2pmu->pmu, "krait_l2", -1);
+	if (err)
+		goto err_notifier;
+
+	dev_info(&pdev->dev, "registered with %d event counters\n",
+		 l2pmu->num_counters);
+
+	return 0;
+
+err_notifier:
+	unregister_cpu_notifier(&l2pmu->cpu_nb);
+	return err;
+}
+
+static int krait_l2_pmu_remove(struct platform_device *pdev)
+{
+	struct krait_l2_pmu *l2pmu = platform_get_drvdata(pdev);
+
+	unregister_cpu_notifier(&l2pmu->cpu_nb);
+	perf_pmu_unregister(&l2pmu->pmu);
+
+	return 0;
+}
+
+static const struct of_device_id krait_l2_pmu_of_match[] = {
+	{ .compatible = "qcom,krait-l2-pmu" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, krait_l2_pmu_of_match);
+
+static struct platform_driver krait_l2_pmu_driver = {
+	.driver = {
+		.name = "krait-l2-pmu",
+		.of_match_table = krait_l2_pmu_of_match,
+	},
+	.probe = krait_l2_pmu_probe,
+	.remove = krait_l2_pmu_remove,
+};
+module_platform_driver(krait_l2_pmu_driver);
+
+MODULE_DESCRIPTION("Qualcomm Krait L2 cache PMU driver");
+MODULE_LICENSE("GPL v2");
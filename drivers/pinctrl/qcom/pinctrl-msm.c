@@ -136,6 +136,22 @@ static int msm_get_function_groups(struct pinctrl_dev *pctldev,
 	return 0;
 }
 
+/*
+ * Update the bits in @mask of a register, skipping the write when nothing
+ * changes, e.g. when a state is selected again on every runtime resume.
+ * Must be called with pctrl->lock held.
+ */
+static void msm_pinctrl_rmw(struct msm_pinctrl *pctrl, u32 reg, u32 mask,
+			    u32 bits)
+{
+	u32 old, val;
+
+	old = readl(pctrl->regs + reg);
+	val = (old & ~mask) | bits;
+	if (val != old)
+		writel(val, pctrl->regs + reg);
+}
+
 static int msm_pinmux_set_mux(struct pinctrl_dev *pctldev,
 			      unsigned function,
 			      unsigned group)
@@ -143,7 +159,6 @@ static int msm_pinmux_set_mux(struct pinctrl_dev *pctldev,
 	struct msm_pinctrl *pctrl = pinctrl_dev_get_drvdata(pctldev);
 	const struct msm_pingroup *g;
 	unsigned long flags;
-	u32 val;
 	int i;
 
 	g = &pctrl->soc->groups[group];
@@ -158,10 +173,7 @@ static int msm_pinmux_set_mux(struct pinctrl_dev *pctldev,
 
 	spin_lock_irqsave(&pctrl->lock, flags);
 
-	val = readl(pctrl->regs + g->ctl_reg);
-	val &= ~(0x7 << g->mux_bit);
-	val |= i << g->mux_bit;
-	writel(val, pctrl->regs + g->ctl_reg);
+	msm_pinctrl_rmw(pctrl, g->ctl_reg, 0x7 << g->mux_bit, i << g->mux_bit);
 
 	spin_unlock_irqrestore(&pctrl->lock, flags);
 
@@ -289,12 +301,18 @@ static int msm_config_group_set(struct pinctrl_dev *pctldev,
 	unsigned mask;
 	unsigned arg;
 	unsigned bit;
+	u32 ctl_mask = 0, ctl_val = 0;
+	u32 io_mask = 0, io_val = 0;
 	int ret;
-	u32 val;
 	int i;
 
 	g = &pctrl->soc->groups[group];
 
+	/*
+	 * Fold all the configs into one value per register first, so that
+	 * applying a state costs a single read-modify-write of each, and
+	 * an invalid config leaves the pin untouched.
+	 */
 	for (i = 0; i < num_configs; i++) {
 		param = pinconf_to_config_param(configs[i]);
 		arg = pinconf_to_config_argument(configs[i]);
@@ -326,14 +344,11 @@ static int msm_config_group_set(struct pinctrl_dev *pctldev,
 			break;
 		case PIN_CONFIG_OUTPUT:
 			/* set output value */
-			spin_lock_irqsave(&pctrl->lock, flags);
-			val = readl(pctrl->regs + g->io_reg);
+			io_mask |= BIT(g->out_bit);
 			if (arg)
-				val |= BIT(g->out_bit);
+				io_val |= BIT(g->out_bit);
 			else
-				val &= ~BIT(g->out_bit);
-			writel(val, pctrl->regs + g->io_reg);
-			spin_unlock_irqrestore(&pctrl->lock, flags);
+				io_val &= ~BIT(g->out_bit);
 
 			/* enable output */
 			arg = 1;
@@ -354,14 +369,18 @@ static int msm_config_group_set(struct pinctrl_dev *pctldev,
 			return -EINVAL;
 		}
 
-		spin_lock_irqsave(&pctrl->lock, flags);
-		val = readl(pctrl->regs + g->ctl_reg);
-		val &= ~(mask << bit);
-		val |= arg << bit;
-		writel(val, pctrl->regs + g->ctl_reg);
-		spin_unlock_irqrestore(&pctrl->lock, flags);
+		ctl_mask |= mask << bit;
+		ctl_val = (ctl_val & ~(mask << bit)) | (arg << bit);
 	}
 
+	spin_lock_irqsave(&pctrl->lock, flags);
+	/* The output value is set before the output gets enabled */
+	if (io_mask)
+		msm_pinctrl_rmw(pctrl, g->io_reg, io_mask, io_val);
+	if (ctl_mask)
+		msm_pinctrl_rmw(pctrl, g->ctl_reg, ctl_mask, ctl_val);
+	spin_unlock_irqrestore(&pctrl->lock, flags);
+
 	return 0;
 }
 
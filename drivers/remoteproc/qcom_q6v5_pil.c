@@ -33,6 +33,7 @@
 #include <linux/soc/qcom/smem.h>
 #include <linux/reset.h>
 #include <linux/qcom_scm.h>
+#include <linux/workqueue.h>
 
 #include "remoteproc_internal.h"
 
@@ -484,13 +485,6 @@ static int qproc_verify_segment(struct qproc *qproc, phys_addr_t paddr, size_t s
 	u32 img_length;
 
 	img_length = readl_relaxed(qproc->rmb_base + RMB_PMI_CODE_LENGTH);
-	dev_err(qproc->dev, "RMB_PMI_CODE_LENGTH: %x\n", img_length);
-
-	msleep(1);
-	img_length = readl_relaxed(qproc->rmb_base + RMB_PMI_CODE_LENGTH);
-	dev_err(qproc->dev, "RMB_PMI_CODE_LENGTH: %x\n", img_length);
-
-
 	if (img_length == 0) {
 		writel_relaxed(paddr, qproc->rmb_base + RMB_PMI_CODE_START);
 		writel(CMD_LOAD_READY, qproc->rmb_base + RMB_MBA_COMMAND);
@@ -498,83 +492,99 @@ static int qproc_verify_segment(struct qproc *qproc, phys_addr_t paddr, size_t s
 	img_length += size;
 	writel(img_length, qproc->rmb_base + RMB_PMI_CODE_LENGTH);
 
-	img_length = readl_relaxed(qproc->rmb_base + RMB_PMI_CODE_LENGTH);
-	dev_err(qproc->dev, "RMB_PMI_CODE_LENGTH: %x\n", img_length);
-	
 	status = readl_relaxed(qproc->rmb_base + RMB_MBA_STATUS);
-
-
 	if (status < 0) {
 		dev_err(qproc->dev, "MBA returned error %d\n", status);
+		return -EINVAL;
 	}
 
-	printk("DEBUG:pil: status... %08x\n", readl_relaxed(qproc->rmb_base + RMB_MBA_STATUS));
-
 	return 0;
 }
 
-static int qproc_load_segment(struct qproc *rproc, const char *fw_name,
+/*
+ * Segments are fetched and copied into the carveout from an unbound
+ * workqueue, several at a time. The MBA authenticates the image as
+ * RMB_PMI_CODE_LENGTH grows, so segments are handed to it strictly in
+ * order as soon as they and all the segments before them are in place.
+ * Authentication of the first segments thereby overlaps with loading
+ * the remaining ones.
+ */
+struct qproc_segment {
+	struct qproc *qproc;
+	const struct elf32_phdr *phdr;
+	phys_addr_t paddr;
+	char fw_name[20];
+
+	struct work_struct work;
+	struct completion done;
+	int ret;
+};
+
+static int qproc_load_segment(struct qproc *qproc, const char *fw_name,
 				const struct elf32_phdr *phdr, phys_addr_t paddr)
 {
 	const struct firmware *fw;
-	void *ptr;
+	void __iomem *ptr;
 	int ret = 0;
 
 	ptr = ioremap_nocache(paddr, phdr->p_memsz);
 	if (!ptr) {
-		dev_err(rproc->dev, "failed to ioremap segment area (%pa+0x%x)\n", &paddr, phdr->p_memsz);
+		dev_err(qproc->dev, "failed to ioremap segment area (%pa+0x%x)\n", &paddr, phdr->p_memsz);
 		return -EBUSY;
 	}
 
 	if (phdr->p_filesz) {
-		ret = request_firmware(&fw, fw_name, rproc->dev);
+		ret = rproc_request_firmware(qproc->rproc, &fw, fw_name);
 		if (ret) {
-			dev_err(rproc->dev, "failed to load %s\n", fw_name);
+			dev_err(qproc->dev, "failed to load %s\n", fw_name);
 			goto out;
 		}
 
-		memcpy_toio(ptr, fw->data, fw->size);
+		if (fw->size > phdr->p_memsz) {
+			dev_err(qproc->dev, "%s is larger than its segment\n", fw_name);
+			ret = -EINVAL;
+		} else {
+			memcpy_toio(ptr, fw->data, fw->size);
+		}
 
-		release_firmware(fw);
+		rproc_release_firmware(qproc->rproc, fw);
+		if (ret)
+			goto out;
 	}
 
 	if (phdr->p_memsz > phdr->p_filesz)
 		memset_io(ptr + phdr->p_filesz, 0,
 			  phdr->p_memsz - phdr->p_filesz);
 
-	printk("DEBUG:pil: verifing %s size: %x\n",fw_name, phdr->p_memsz);
-	qproc_verify_segment(rproc, paddr, phdr->p_memsz);
-
 out:
 	iounmap(ptr);
 	return ret;
 }
 
+static void qproc_load_segment_work(struct work_struct *work)
+{
+	struct qproc_segment *seg = container_of(work, struct qproc_segment, work);
+
+	seg->ret = qproc_load_segment(seg->qproc, seg->fw_name, seg->phdr,
+				      seg->paddr);
+	complete(&seg->done);
+}
+
 static int
 qproc_load_segments(struct qproc *qproc, const struct firmware *fw)
 {
-	struct device *dev = qproc->dev;
-	struct elf32_hdr *ehdr;
-	struct elf32_phdr *phdr;
-	int i, ret = 0;
-	const u8 *elf_data = fw->data;
-	const struct firmware *seg_fw;
-	char fw_name[20];
-
-	const struct mdt_hdr *mdt;
+	const struct mdt_hdr *mdt = (struct mdt_hdr *)fw->data;
+	const struct elf32_hdr *ehdr = &mdt->hdr;
+	const struct elf32_phdr *phdr;
 	phys_addr_t min_addr = (phys_addr_t)ULLONG_MAX;
-	phys_addr_t max_addr = 0;
-	size_t align = 0;
+	struct qproc_segment *segs;
+	struct qproc_segment *seg;
 	bool relocatable = false;
-	phys_addr_t paddr;
-
-
-	ehdr = (struct elf32_hdr *)elf_data;
-	phdr = (struct elf32_phdr *)(elf_data + ehdr->e_phoff);
-
-
-	mdt = (struct mdt_hdr *)fw->data;
-	ehdr = &mdt->hdr;
+	int window;
+	int nsegs = 0;
+	int queued;
+	int ret = 0;
+	int i;
 
 	for (i = 0; i < ehdr->e_phnum; i++) {
 		phdr = &mdt->phdr[i];
@@ -582,94 +592,75 @@ qproc_load_segments(struct qproc *qproc, const struct firmware *fw)
 		if (!segment_is_loadable(phdr))
 			continue;
 
+		if (phdr->p_filesz > phdr->p_memsz) {
+			dev_err(qproc->dev, "bad phdr filesz 0x%x memsz 0x%x\n",
+				phdr->p_filesz, phdr->p_memsz);
+			return -EINVAL;
+		}
+
 		if (phdr->p_paddr < min_addr) {
 			min_addr = phdr->p_paddr;
-
-			if (segment_is_relocatable(phdr)) {
-				align = phdr->p_align;
-				relocatable = true;
-			}
+			relocatable = segment_is_relocatable(phdr);
 		}
 
-		if (phdr->p_paddr + phdr->p_memsz > max_addr)
-			max_addr = round_up(phdr->p_paddr + phdr->p_memsz, SZ_4K);
+		nsegs++;
 	}
 
-	ehdr = (struct elf32_hdr *)elf_data;
-	phdr = (struct elf32_phdr *)(elf_data + ehdr->e_phoff);
-	/* go through the available ELF segments */
-	for (i = 0; i < ehdr->e_phnum; i++, phdr++) {
-		u32 da = phdr->p_paddr;
-		u32 paddr = phdr->p_paddr;
-		u32 memsz = phdr->p_memsz;
-		u32 filesz = phdr->p_filesz;
-		void *ptr;
+	if (!nsegs)
+		return 0;
 
-		if (!segment_is_loadable(phdr))
-			continue;
-		/*
-		if (phdr->p_type != PT_LOAD)
-			continue;
+	segs = kcalloc(nsegs, sizeof(*segs), GFP_KERNEL);
+	if (!segs)
+		return -ENOMEM;
 
-		if (segment_is_hash(phdr->p_flags))
-			continue;
+	for (i = 0, seg = segs; i < ehdr->e_phnum; i++) {
+		phdr = &mdt->phdr[i];
 
-		if (filesz == 0)
+		if (!segment_is_loadable(phdr))
 			continue;
-*/
-		//dev_dbg(dev, "phdr: type %d da 0x%x memsz 0x%x filesz 0x%x\n",
-		pr_emerg("phdr(%d): type %d paddr 0x%x memsz 0x%x filesz 0x%x\n",
-					i, phdr->p_type, paddr, memsz, filesz);
 
-		if (filesz > memsz) {
-			dev_err(dev, "bad phdr filesz 0x%x memsz 0x%x\n",
-							filesz, memsz);
-			ret = -EINVAL;
-			break;
-		}
-
-		paddr = relocatable ?
+		seg->qproc = qproc;
+		seg->phdr = phdr;
+		seg->paddr = relocatable ?
 				(phdr->p_paddr - min_addr + qproc->reloc_phys) :
 				phdr->p_paddr;
+		snprintf(seg->fw_name, sizeof(seg->fw_name), "modem.b%02d", i);
+		INIT_WORK(&seg->work, qproc_load_segment_work);
+		init_completion(&seg->done);
 
-		pr_emerg("Relocated-phdr(%d): type %d paddr 0x%x memsz 0x%x filesz 0x%x\n",
-					i, phdr->p_type, paddr, memsz, filesz);
-//		if (filesz) {
-			snprintf(fw_name, sizeof(fw_name), "modem.b%02d", i);
-			ret = qproc_load_segment(qproc, fw_name, phdr, paddr);
-//		}
-#if 0
-
-		ptr = ioremap(da, memsz);
-		if (!ptr) {
-			dev_err(qproc->dev, "failed to allocate mba metadata buffer\n");
-			ret = -ENOMEM;
-			break;
-		}
-
-		if (filesz) {
-			snprintf(fw_name, sizeof(fw_name), "modem.b%02d", i);
-			ret = request_firmware(&seg_fw, fw_name, qproc->dev);
-			if (ret) {
-				iounmap(ptr);
-				break;
-			}
-
-			memcpy(ptr, seg_fw->data, filesz);
+		dev_dbg(qproc->dev, "segment %d: paddr %pa memsz 0x%x filesz 0x%x\n",
+			i, &seg->paddr, phdr->p_memsz, phdr->p_filesz);
+		seg++;
+	}
 
-			release_firmware(seg_fw);
-		}
+	/*
+	 * Every segment in flight holds a firmware buffer and a mapping of
+	 * its part of the carveout, so bound the window to the cpus that
+	 * can copy at the same time.
+	 */
+	window = min(nsegs, (int)num_online_cpus());
+	for (queued = 0; queued < window; queued++)
+		queue_work(system_unbound_wq, &segs[queued].work);
 
-		if (memsz > filesz)
-			memset(ptr + filesz, 0, memsz - filesz);
+	/* After a failure, only wait for the segments already queued */
+	for (i = 0; i < queued; i++) {
+		seg = &segs[i];
 
+		wait_for_completion(&seg->done);
+		if (ret)
+			continue;
 
+		ret = seg->ret;
+		if (!ret)
+			ret = qproc_verify_segment(qproc, seg->paddr,
+						   seg->phdr->p_memsz);
 
-		wmb();
-		iounmap(ptr);
-#endif
+		if (!ret && queued < nsegs)
+			queue_work(system_unbound_wq, &segs[queued++].work);
 	}
 
+	kfree(segs);
+
 	return ret;
 }
 
@@ -805,7 +796,7 @@ static int qproc_load_modem(struct qproc *qproc)
 	const struct firmware *fw;
 	int ret;
 
-	ret = request_firmware(&fw, "modem.mdt", qproc->dev);
+	ret = rproc_request_firmware(qproc->rproc, &fw, "modem.mdt");
 	if (ret < 0) {
 		dev_err(qproc->dev, "unable to load modem.mdt\n");
 		return ret;
@@ -826,9 +817,8 @@ static int qproc_load_modem(struct qproc *qproc)
 //	ret = qproc_verify_segments(qproc, fw);
 //	if (ret)
 //		goto out;
-	return 0;
 out:
-	release_firmware(fw);
+	rproc_release_firmware(qproc->rproc, fw);
 
 	return ret;
 }
@@ -1281,6 +1271,12 @@ static int qproc_probe(struct platform_device *pdev)
 
 		dev_info(&pdev->dev, "Found relocation area %lu@%pad\n",
 				qproc->reloc_size, &qproc->reloc_phys);
+
+		/* dump the modem memory on crashes */
+		ret = rproc_coredump_add_segment(rproc, qproc->reloc_phys,
+						 qproc->reloc_size);
+		if (ret)
+			dev_warn(&pdev->dev, "no crash dumps: %d\n", ret);
 	}
 
 
@@ -214,7 +214,7 @@ static int qproc_load_segment(struct rproc *rproc, const char *fw_name,
 	}
 
 	if (phdr->p_filesz) {
-		ret = request_firmware(&fw, fw_name, &rproc->dev);
+		ret = rproc_request_firmware(rproc, &fw, fw_name);
 		if (ret) {
 			dev_err(&rproc->dev, "failed to load %s\n", fw_name);
 			goto out;
@@ -222,7 +222,7 @@ static int qproc_load_segment(struct rproc *rproc, const char *fw_name,
 
 		memcpy_toio(ptr, fw->data, fw->size);
 
-		release_firmware(fw);
+		rproc_release_firmware(rproc, fw);
 	}
 
 	if (phdr->p_memsz > phdr->p_filesz)
@@ -891,17 +891,14 @@ clean_up:
 }
 
 /*
- * take a firmware and look for virtio devices to register.
- *
- * Note: this function is called asynchronously upon registration of the
- * remote processor (so we must wait until it completes before we try
- * to unregister the device. one other option is just to use kref here,
- * that might be cleaner).
+ * copy the resource table of a firmware, returning its size; everything
+ * after this works on the copy, not on the firmware image.
  */
-static int __rproc_fw_config_virtio(struct rproc *rproc, const struct firmware *fw)
+static int rproc_fw_copy_rsc_table(struct rproc *rproc,
+				   const struct firmware *fw)
 {
 	struct resource_table *table;
-	int ret, tablesz;
+	int tablesz;
 
 	/* look for the resource table */
 	table = rproc_find_rsc_table(rproc, fw,  &tablesz);
@@ -922,6 +919,13 @@ static int __rproc_fw_config_virtio(struct rproc *rproc, const struct firmware *
 
 	rproc->table_ptr = rproc->cached_table;
 
+	return tablesz;
+}
+
+static int rproc_config_virtio(struct rproc *rproc, int tablesz)
+{
+	int ret;
+
 	/* count the number of notify-ids */
 	rproc->max_notifyid = -1;
 	ret = rproc_handle_resources(rproc, tablesz,
@@ -935,6 +939,25 @@ static int __rproc_fw_config_virtio(struct rproc *rproc, const struct firmware *
 	return ret;
 }
 
+/*
+ * take a firmware and look for virtio devices to register.
+ *
+ * Note: this function is called asynchronously upon registration of the
+ * remote processor (so we must wait until it completes before we try
+ * to unregister the device. one other option is just to use kref here,
+ * that might be cleaner).
+ */
+static int __rproc_fw_config_virtio(struct rproc *rproc, const struct firmware *fw)
+{
+	int tablesz;
+
+	tablesz = rproc_fw_copy_rsc_table(rproc, fw);
+	if (tablesz < 0)
+		return tablesz;
+
+	return rproc_config_virtio(rproc, tablesz);
+}
+
 static void rproc_fw_config_virtio(const struct firmware *fw, void *context)
 {
 	struct rproc *rproc = context;
@@ -973,6 +996,42 @@ static int rproc_add_virtio_devices(struct rproc *rproc)
 	return ret;
 }
 
+/*
+ * Unlike at registration, recovery reads the resource table synchronously
+ * and through rproc_request_firmware(), so that a crash loop is served
+ * from the firmware cache. The cache is only used under rproc->lock, which
+ * is dropped before the virtio devices are added, as their probe boots the
+ * remote processor.
+ */
+static int rproc_recover_virtio_devices(struct rproc *rproc)
+{
+	const struct firmware *fw;
+	int ret;
+
+	/* rproc_del() calls must wait until the devices are added */
+	init_completion(&rproc->firmware_loading_complete);
+
+	mutex_lock(&rproc->lock);
+	ret = rproc_request_firmware(rproc, &fw, rproc->firmware);
+	if (!ret) {
+		ret = rproc_fw_sanity_check(rproc, fw);
+		if (!ret)
+			ret = rproc_fw_copy_rsc_table(rproc, fw);
+		rproc_release_firmware(rproc, fw);
+	}
+	mutex_unlock(&rproc->lock);
+
+	if (ret >= 0)
+		ret = rproc_config_virtio(rproc, ret);
+	else
+		dev_err(&rproc->dev, "failed to load %s: %d\n",
+			rproc->firmware, ret);
+
+	complete_all(&rproc->firmware_loading_complete);
+
+	return ret;
+}
+
 /**
  * rproc_trigger_recovery() - recover a remoteproc
  * @rproc: the remote processor
@@ -998,10 +1057,13 @@ int rproc_trigger_recovery(struct rproc *rproc)
 	/* wait until there is no more rproc users */
 	wait_for_completion(&rproc->crash_comp);
 
+	/* the crash dump is read from the memory the next boot reuses */
+	rproc_coredump_detach(rproc);
+
 	/* Free the copy of the resource table */
 	kfree(rproc->cached_table);
 
-	return rproc_add_virtio_devices(rproc);
+	return rproc_recover_virtio_devices(rproc);
 }
 
 /**
@@ -1031,6 +1093,8 @@ static void rproc_crash_handler_work(struct work_struct *work)
 
 	mutex_unlock(&rproc->lock);
 
+	rproc_coredump(rproc);
+
 	if (!rproc->recovery_disabled)
 		rproc_trigger_recovery(rproc);
 }
@@ -1088,7 +1152,7 @@ int rproc_boot(struct rproc *rproc)
 	dev_info(dev, "powering up %s\n", rproc->name);
 
 	/* load firmware */
-	ret = request_firmware(&firmware_p, rproc->firmware, dev);
+	ret = rproc_request_firmware(rproc, &firmware_p, rproc->firmware);
 	if (ret < 0) {
 		dev_err(dev, "request_firmware failed: %d\n", ret);
 		goto downref_rproc;
@@ -1096,7 +1160,8 @@ int rproc_boot(struct rproc *rproc)
 
 	ret = rproc_fw_boot(rproc, firmware_p);
 
-	release_firmware(firmware_p);
+	rproc_release_firmware(rproc, firmware_p);
+	rproc_fw_cache_boot_done(rproc, ret);
 
 downref_rproc:
 	if (ret) {
@@ -1281,6 +1346,10 @@ static void rproc_type_release(struct device *dev)
 
 	rproc_delete_debug_dir(rproc);
 
+	rproc_fw_cache_drop(rproc);
+
+	rproc_coredump_cleanup(rproc);
+
 	idr_destroy(&rproc->notifyids);
 
 	if (rproc->index >= 0)
@@ -1291,6 +1360,7 @@ static void rproc_type_release(struct device *dev)
 
 static struct device_type rproc_type = {
 	.name		= "remoteproc",
+	.groups		= rproc_fw_cache_groups,
 	.release	= rproc_type_release,
 };
 
@@ -1376,12 +1446,15 @@ struct rproc *rproc_alloc(struct device *dev, const char *name,
 
 	mutex_init(&rproc->lock);
 
+	rproc_fw_cache_init(rproc);
+
 	idr_init(&rproc->notifyids);
 
 	INIT_LIST_HEAD(&rproc->carveouts);
 	INIT_LIST_HEAD(&rproc->mappings);
 	INIT_LIST_HEAD(&rproc->traces);
 	INIT_LIST_HEAD(&rproc->rvdevs);
+	INIT_LIST_HEAD(&rproc->dump_segments);
 
 	INIT_WORK(&rproc->crash_handler, rproc_crash_handler_work);
 	init_completion(&rproc->crash_comp);
@@ -0,0 +1,387 @@
+/*
+ * Remote Processor Framework - crash dumps
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/completion.h>
+#include <linux/device.h>
+#include <linux/devcoredump.h>
+#include <linux/elf.h>
+#include <linux/io.h>
+#include <linux/kref.h>
+#include <linux/mutex.h>
+#include <linux/remoteproc.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+#include "remoteproc_internal.h"
+
+/*
+ * On a crash the memory segments registered by the driver are handed to
+ * devcoredump as an ELF core file. Nothing is copied up front: the
+ * segments are mapped when the crash is handled and every read of the dump
+ * is served straight from the memory of the remote processor, so a dump of
+ * a few hundred MB costs neither time nor memory at crash time.
+ *
+ * As the next boot overwrites that memory, recovery invalidates a dump
+ * that has not been read yet, and further reads fail with -ENODEV. With
+ * recovery disabled, the dump stays readable until the next crash.
+ *
+ * Keeping the dump across recovery is opt-in: with a non-zero dump_timeout,
+ * recovery waits that many seconds for user space to read the dump, and
+ * then copies whatever is still unread to kernel memory. If the copy can't
+ * be allocated, reads fail with -ENOMEM instead.
+ */
+static unsigned int dump_timeout;
+module_param(dump_timeout, uint, 0644);
+MODULE_PARM_DESC(dump_timeout, "Seconds recovery waits for a crash dump to be read before copying it (0=don't keep the dump)");
+
+struct rproc_dump_segment {
+	struct list_head node;
+	phys_addr_t addr;
+	size_t size;
+};
+
+struct rproc_coredump_seg {
+	void *va;
+	size_t size;
+	size_t offset;
+	bool copied;
+};
+
+/**
+ * struct rproc_coredump - a crash dump handed to devcoredump
+ * @refcount: held by the rproc until recovery and by devcoredump
+ * @lock: serializes reads against invalidation
+ * @stale: the segments were unmapped, the memory is reused
+ * @error: what reads of a stale dump return
+ * @released: devcoredump is done with the dump
+ * @hdr: ELF header and program headers
+ * @hdr_size: size of @hdr
+ * @nr_segs: number of @segs
+ * @segs: the mapped segments, at their offset in the file
+ */
+struct rproc_coredump {
+	struct kref refcount;
+	struct mutex lock;
+	bool stale;
+	int error;
+	struct completion released;
+	void *hdr;
+	size_t hdr_size;
+	unsigned int nr_segs;
+	struct rproc_coredump_seg segs[];
+};
+
+/**
+ * rproc_coredump_add_segment() - add a memory segment to the crash dump
+ * @rproc: handle of a remote processor
+ * @addr: physical address of the segment
+ * @size: size of the segment
+ *
+ * Registers memory of the remote processor to be included, in order, in
+ * the ELF core file created when it crashes. The memory must be reserved
+ * for the remote processor, it is mapped and read from as is.
+ *
+ * Returns 0 on success or a negative error code.
+ */
+int rproc_coredump_add_segment(struct rproc *rproc, phys_addr_t addr,
+			       size_t size)
+{
+	struct rproc_dump_segment *segment;
+
+	/* the core file is ELF32 */
+	if (!size || addr + size - 1 > U32_MAX)
+		return -EINVAL;
+
+	segment = kzalloc(sizeof(*segment), GFP_KERNEL);
+	if (!segment)
+		return -ENOMEM;
+
+	segment->addr = addr;
+	segment->size = size;
+
+	mutex_lock(&rproc->lock);
+	list_add_tail(&segment->node, &rproc->dump_segments);
+	mutex_unlock(&rproc->lock);
+
+	return 0;
+}
+EXPORT_SYMBOL(rproc_coredump_add_segment);
+
+/* Unmap the segments, with dump->lock held or on the last reference */
+static void rproc_coredump_unmap(struct rproc_coredump *dump)
+{
+	struct rproc_coredump_seg *seg;
+	unsigned int i;
+
+	for (i = 0; i < dump->nr_segs; i++) {
+		seg = &dump->segs[i];
+		if (seg->copied)
+			vfree(seg->va);
+		else if (seg->va)
+			memunmap(seg->va);
+		seg->va = NULL;
+	}
+
+	dump->stale = true;
+}
+
+/*
+ * Replace the mapped segments with copies in kernel memory, with dump->lock
+ * held. Returns the segment that could not be allocated, or NULL.
+ */
+static struct rproc_coredump_seg *
+rproc_coredump_copy(struct rproc_coredump *dump)
+{
+	struct rproc_coredump_seg *seg;
+	unsigned int i;
+	void *copy;
+
+	for (i = 0; i < dump->nr_segs; i++) {
+		seg = &dump->segs[i];
+		if (seg->copied)
+			continue;
+
+		copy = vmalloc(seg->size);
+		if (!copy)
+			return seg;
+
+		memcpy(copy, seg->va, seg->size);
+		memunmap(seg->va);
+		seg->va = copy;
+		seg->copied = true;
+	}
+
+	return NULL;
+}
+
+static void rproc_coredump_release(struct kref *kref)
+{
+	struct rproc_coredump *dump = container_of(kref, struct rproc_coredump,
+						   refcount);
+
+	if (!dump->stale)
+		rproc_coredump_unmap(dump);
+	kfree(dump->hdr);
+	kfree(dump);
+}
+
+void rproc_coredump_cleanup(struct rproc *rproc)
+{
+	struct rproc_dump_segment *segment, *tmp;
+
+	if (rproc->dump)
+		kref_put(&rproc->dump->refcount, rproc_coredump_release);
+
+	list_for_each_entry_safe(segment, tmp, &rproc->dump_segments, node) {
+		list_del(&segment->node);
+		kfree(segment);
+	}
+}
+
+static ssize_t rproc_coredump_read(char *buffer, loff_t offset, size_t count,
+				   const void *data, size_t datalen)
+{
+	struct rproc_coredump *dump = (struct rproc_coredump *)data;
+	struct rproc_coredump_seg *seg;
+	size_t copied = 0, len;
+	unsigned int i = 0;
+
+	if (offset > datalen)
+		return -EINVAL;
+
+	count = min_t(size_t, count, datalen - offset);
+
+	mutex_lock(&dump->lock);
+	if (dump->stale) {
+		mutex_unlock(&dump->lock);
+		return dump->error;
+	}
+
+	while (copied < count) {
+		if (offset < dump->hdr_size) {
+			len = min_t(size_t, count - copied,
+				    dump->hdr_size - offset);
+			memcpy(buffer + copied, dump->hdr + offset, len);
+		} else {
+			for (; i < dump->nr_segs; i++) {
+				seg = &dump->segs[i];
+				if (offset < seg->offset + seg->size)
+					break;
+			}
+			if (i == dump->nr_segs)
+				break;
+
+			len = min_t(size_t, count - copied,
+				    seg->offset + seg->size - offset);
+			memcpy(buffer + copied, seg->va + offset - seg->offset,
+			       len);
+		}
+
+		copied += len;
+		offset += len;
+	}
+	mutex_unlock(&dump->lock);
+
+	return copied;
+}
+
+static void rproc_coredump_free(const void *data)
+{
+	struct rproc_coredump *dump = (struct rproc_coredump *)data;
+
+	complete(&dump->released);
+	kref_put(&dump->refcount, rproc_coredump_release);
+}
+
+/**
+ * rproc_coredump() - hand a crash dump of the remote processor to devcoredump
+ * @rproc: handle of a crashed remote processor
+ *
+ * Does nothing if no segment was registered.
+ */
+void rproc_coredump(struct rproc *rproc)
+{
+	struct rproc_dump_segment *segment;
+	struct rproc_coredump *dump;
+	struct elf32_phdr *phdr;
+	struct elf32_hdr *ehdr;
+	unsigned int nr_segs = 0, i = 0;
+	size_t offset;
+
+	/* left over from a crash without recovery */
+	if (rproc->dump) {
+		kref_put(&rproc->dump->refcount, rproc_coredump_release);
+		rproc->dump = NULL;
+	}
+
+	list_for_each_entry(segment, &rproc->dump_segments, node)
+		nr_segs++;
+	if (!nr_segs)
+		return;
+
+	dump = kzalloc(sizeof(*dump) + nr_segs * sizeof(dump->segs[0]),
+		       GFP_KERNEL);
+	if (!dump)
+		return;
+
+	kref_init(&dump->refcount);
+	mutex_init(&dump->lock);
+	dump->error = -ENODEV;
+	init_completion(&dump->released);
+	dump->nr_segs = nr_segs;
+	dump->hdr_size = sizeof(*ehdr) + nr_segs * sizeof(*phdr);
+	dump->hdr = kzalloc(dump->hdr_size, GFP_KERNEL);
+	if (!dump->hdr)
+		goto free_dump;
+
+	ehdr = dump->hdr;
+	memcpy(ehdr->e_ident, ELFMAG, SELFMAG);
+	ehdr->e_ident[EI_CLASS] = ELFCLASS32;
+	ehdr->e_ident[EI_DATA] = ELFDATA2LSB;
+	ehdr->e_ident[EI_VERSION] = EV_CURRENT;
+	ehdr->e_ident[EI_OSABI] = ELFOSABI_NONE;
+	ehdr->e_type = ET_CORE;
+	ehdr->e_machine = EM_NONE;
+	ehdr->e_version = EV_CURRENT;
+	ehdr->e_phoff = sizeof(*ehdr);
+	ehdr->e_ehsize = sizeof(*ehdr);
+	ehdr->e_phentsize = sizeof(*phdr);
+	ehdr->e_phnum = nr_segs;
+
+	phdr = dump->hdr + sizeof(*ehdr);
+	offset = dump->hdr_size;
+	list_for_each_entry(segment, &rproc->dump_segments, node) {
+		dump->segs[i].va = memremap(segment->addr, segment->size,
+					    MEMREMAP_WC);
+		if (!dump->segs[i].va) {
+			dev_err(&rproc->dev, "failed to map dump segment %pa\n",
+				&segment->addr);
+			goto unmap;
+		}
+		dump->segs[i].size = segment->size;
+		dump->segs[i].offset = offset;
+
+		phdr->p_type = PT_LOAD;
+		phdr->p_offset = offset;
+		phdr->p_vaddr = segment->addr;
+		phdr->p_paddr = segment->addr;
+		phdr->p_filesz = segment->size;
+		phdr->p_memsz = segment->size;
+		phdr->p_flags = PF_R | PF_W | PF_X;
+
+		offset += segment->size;
+		phdr++;
+		i++;
+	}
+
+	/* one reference for devcoredump, one until recovery */
+	kref_get(&dump->refcount);
+	rproc->dump = dump;
+
+	dev_coredumpm(&rproc->dev, THIS_MODULE, dump, offset, GFP_KERNEL,
+		      rproc_coredump_read, rproc_coredump_free);
+	return;
+
+unmap:
+	dump->nr_segs = i;
+	rproc_coredump_unmap(dump);
+	kfree(dump->hdr);
+free_dump:
+	kfree(dump);
+}
+
+/**
+ * rproc_coredump_detach() - detach the crash dump from the device memory
+ * @rproc: handle of a crashed remote processor
+ *
+ * Called by recovery before the remote processor memory is reused. A dump
+ * still held by devcoredump is invalidated, unless dump_timeout is set: it
+ * is then given that many seconds to be read and copied to kernel memory
+ * after that, so that it stays readable until devcoredump drops it.
+ */
+void rproc_coredump_detach(struct rproc *rproc)
+{
+	struct rproc_coredump *dump = rproc->dump;
+	struct rproc_coredump_seg *seg = NULL;
+
+	if (!dump)
+		return;
+
+	rproc->dump = NULL;
+
+	if (dump_timeout)
+		wait_for_completion_timeout(&dump->released,
+					    dump_timeout * HZ);
+
+	if (!completion_done(&dump->released)) {
+		mutex_lock(&dump->lock);
+		if (!dump->stale) {
+			if (dump_timeout)
+				seg = rproc_coredump_copy(dump);
+			if (!dump_timeout || seg)
+				rproc_coredump_unmap(dump);
+			if (seg)
+				dump->error = -ENOMEM;
+		}
+		mutex_unlock(&dump->lock);
+	}
+
+	if (seg)
+		dev_err(&rproc->dev,
+			"failed to allocate %zu bytes to keep the crash dump, discarding it\n",
+			seg->size);
+
+	kref_put(&dump->refcount, rproc_coredump_release);
+}
@@ -0,0 +1,303 @@
+/*
+ * Remote Processor Framework - firmware cache
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/device.h>
+#include <linux/firmware.h>
+#include <linux/remoteproc.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#include "remoteproc_internal.h"
+
+/*
+ * Crash recovery reloads the firmware of a remote processor from the
+ * filesystem. In a crash loop that hits the storage again and again, and
+ * it fails altogether when the rootfs is not responsive. When the cache
+ * is enabled, every file requested through rproc_request_firmware() while
+ * booting is kept in memory. Once the boot succeeds the files are kept
+ * for the next boot; a failed boot drops the cache, so the next attempt
+ * goes back to the filesystem.
+ *
+ * Entries are only handed out during a boot, which runs under
+ * rproc->lock, so dropping the cache from sysfs takes that lock as well.
+ */
+static bool fw_cache;
+module_param(fw_cache, bool, 0644);
+MODULE_PARM_DESC(fw_cache, "Cache remote processor firmware across restarts by default");
+
+struct rproc_fw_cache_entry {
+	struct list_head node;
+	struct firmware fw;
+	bool used;
+	char name[];
+};
+
+static void rproc_fw_cache_free(struct rproc *rproc,
+				struct rproc_fw_cache_entry *entry)
+{
+	rproc->fw_cache_bytes -= entry->fw.size;
+	list_del(&entry->node);
+	vfree(entry->fw.data);
+	kfree(entry);
+}
+
+static struct rproc_fw_cache_entry *
+rproc_fw_cache_find(struct rproc *rproc, const char *name)
+{
+	struct rproc_fw_cache_entry *entry;
+
+	list_for_each_entry(entry, &rproc->fw_cache, node) {
+		if (!strcmp(entry->name, name))
+			return entry;
+	}
+
+	return NULL;
+}
+
+/**
+ * rproc_request_firmware() - request a firmware file of a remote processor
+ * @rproc: the remote processor
+ * @fw: returns the firmware image
+ * @name: name of the firmware file
+ *
+ * Works like request_firmware(), but serves the file from the firmware
+ * cache of @rproc when it is enabled. The image must be released with
+ * rproc_release_firmware(), and must only be requested while booting.
+ *
+ * Returns 0 on success and an appropriate error code otherwise.
+ */
+int rproc_request_firmware(struct rproc *rproc, const struct firmware **fw,
+			   const char *name)
+{
+	struct rproc_fw_cache_entry *entry;
+	struct rproc_fw_cache_entry *found;
+	const struct firmware *orig;
+	void *data;
+	int ret;
+
+	if (!READ_ONCE(rproc->fw_cache_enabled))
+		return request_firmware(fw, name, &rproc->dev);
+
+	mutex_lock(&rproc->fw_cache_lock);
+	entry = rproc_fw_cache_find(rproc, name);
+	if (entry)
+		entry->used = true;
+	mutex_unlock(&rproc->fw_cache_lock);
+
+	if (entry) {
+		*fw = &entry->fw;
+		return 0;
+	}
+
+	ret = request_firmware(&orig, name, &rproc->dev);
+	if (ret)
+		return ret;
+
+	/* If we can't keep a copy, just hand out the original */
+	entry = kzalloc(sizeof(*entry) + strlen(name) + 1, GFP_KERNEL);
+	data = vmalloc(orig->size);
+	if (!entry || !data) {
+		kfree(entry);
+		vfree(data);
+		*fw = orig;
+		return 0;
+	}
+
+	memcpy(data, orig->data, orig->size);
+	entry->fw.data = data;
+	entry->fw.size = orig->size;
+	entry->used = true;
+	strcpy(entry->name, name);
+	release_firmware(orig);
+
+	/* Segments may be requested in parallel, keep the first copy */
+	mutex_lock(&rproc->fw_cache_lock);
+	found = rproc_fw_cache_find(rproc, name);
+	if (!found) {
+		list_add_tail(&entry->node, &rproc->fw_cache);
+		rproc->fw_cache_bytes += entry->fw.size;
+		found = entry;
+		entry = NULL;
+	}
+	found->used = true;
+	mutex_unlock(&rproc->fw_cache_lock);
+
+	if (entry) {
+		vfree(entry->fw.data);
+		kfree(entry);
+	}
+
+	*fw = &found->fw;
+	return 0;
+}
+EXPORT_SYMBOL(rproc_request_firmware);
+
+/**
+ * rproc_release_firmware() - release a firmware file of a remote processor
+ * @rproc: the remote processor
+ * @fw: the image returned by rproc_request_firmware()
+ *
+ * Cached images stay in the cache, everything else is released.
+ */
+void rproc_release_firmware(struct rproc *rproc, const struct firmware *fw)
+{
+	struct rproc_fw_cache_entry *entry;
+	bool cached = false;
+
+	if (!fw)
+		return;
+
+	mutex_lock(&rproc->fw_cache_lock);
+	list_for_each_entry(entry, &rproc->fw_cache, node) {
+		if (&entry->fw == fw) {
+			cached = true;
+			break;
+		}
+	}
+	mutex_unlock(&rproc->fw_cache_lock);
+
+	if (!cached)
+		release_firmware(fw);
+}
+EXPORT_SYMBOL(rproc_release_firmware);
+
+/**
+ * rproc_fw_cache_boot_done() - update the firmware cache after a boot
+ * @rproc: the remote processor
+ * @ret: the result of the boot
+ *
+ * After a successful boot only the files used by that boot are kept,
+ * after a failed boot the whole cache is dropped.
+ */
+void rproc_fw_cache_boot_done(struct rproc *rproc, int ret)
+{
+	struct rproc_fw_cache_entry *entry, *tmp;
+
+	mutex_lock(&rproc->fw_cache_lock);
+	list_for_each_entry_safe(entry, tmp, &rproc->fw_cache, node) {
+		if (ret || !entry->used)
+			rproc_fw_cache_free(rproc, entry);
+		else
+			entry->used = false;
+	}
+	mutex_unlock(&rproc->fw_cache_lock);
+}
+
+/**
+ * rproc_fw_cache_drop() - drop all cached firmware files
+ * @rproc: the remote processor
+ *
+ * Must not be called while a boot is in progress.
+ */
+void rproc_fw_cache_drop(struct rproc *rproc)
+{
+	struct rproc_fw_cache_entry *entry, *tmp;
+
+	mutex_lock(&rproc->fw_cache_lock);
+	list_for_each_entry_safe(entry, tmp, &rproc->fw_cache, node)
+		rproc_fw_cache_free(rproc, entry);
+	mutex_unlock(&rproc->fw_cache_lock);
+}
+
+void rproc_fw_cache_init(struct rproc *rproc)
+{
+	INIT_LIST_HEAD(&rproc->fw_cache);
+	mutex_init(&rproc->fw_cache_lock);
+	rproc->fw_cache_enabled = fw_cache;
+}
+
+static ssize_t fw_cache_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct rproc *rproc = container_of(dev, struct rproc, dev);
+
+	return sprintf(buf, "%d\n", rproc->fw_cache_enabled);
+}
+
+static ssize_t fw_cache_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct rproc *rproc = container_of(dev, struct rproc, dev);
+	bool enable;
+	int ret;
+
+	ret = strtobool(buf, &enable);
+	if (ret)
+		return ret;
+
+	ret = mutex_lock_interruptible(&rproc->lock);
+	if (ret)
+		return ret;
+
+	WRITE_ONCE(rproc->fw_cache_enabled, enable);
+	if (!enable)
+		rproc_fw_cache_drop(rproc);
+
+	mutex_unlock(&rproc->lock);
+
+	return count;
+}
+static DEVICE_ATTR_RW(fw_cache);
+
+static ssize_t fw_cache_drop_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct rproc *rproc = container_of(dev, struct rproc, dev);
+	int ret;
+
+	ret = mutex_lock_interruptible(&rproc->lock);
+	if (ret)
+		return ret;
+
+	rproc_fw_cache_drop(rproc);
+
+	mutex_unlock(&rproc->lock);
+
+	return count;
+}
+static DEVICE_ATTR_WO(fw_cache_drop);
+
+static ssize_t fw_cache_bytes_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct rproc *rproc = container_of(dev, struct rproc, dev);
+	size_t bytes;
+
+	mutex_lock(&rproc->fw_cache_lock);
+	bytes = rproc->fw_cache_bytes;
+	mutex_unlock(&rproc->fw_cache_lock);
+
+	return sprintf(buf, "%zu\n", bytes);
+}
+static DEVICE_ATTR_RO(fw_cache_bytes);
+
+static struct attribute *rproc_fw_cache_attrs[] = {
+	&dev_attr_fw_cache.attr,
+	&dev_attr_fw_cache_drop.attr,
+	&dev_attr_fw_cache_bytes.attr,
+	NULL
+};
+
+static const struct attribute_group rproc_fw_cache_group = {
+	.attrs = rproc_fw_cache_attrs,
+};
+
+const struct attribute_group *rproc_fw_cache_groups[] = {
+	&rproc_fw_cache_group,
+	NULL
+};
@@ -62,6 +62,17 @@ void rproc_create_debug_dir(struct rproc *rproc);
 void rproc_init_debugfs(void);
 void rproc_exit_debugfs(void);
 
+/* from remoteproc_fw_cache.c */
+void rproc_fw_cache_init(struct rproc *rproc);
+void rproc_fw_cache_boot_done(struct rproc *rproc, int ret);
+void rproc_fw_cache_drop(struct rproc *rproc);
+extern const struct attribute_group *rproc_fw_cache_groups[];
+
+/* from remoteproc_coredump.c */
+void rproc_coredump(struct rproc *rproc);
+void rproc_coredump_detach(struct rproc *rproc);
+void rproc_coredump_cleanup(struct rproc *rproc);
+
 void rproc_free_vring(struct rproc_vring *rvring);
 int rproc_alloc_vring(struct rproc_vdev *rvdev, int i);
 
@@ -108,6 +108,8 @@ struct msm_bus_node_device_type {
 	struct msm_bus_fab_device_type *fabdev;
 	int num_lnodes;
 	struct link_node *lnode_list;
+	uint64_t lnode_ab_sum[NUM_CTX];
+	uint64_t lnode_ib_max[NUM_CTX];
 	uint64_t cur_clk_hz[NUM_CTX];
 	struct nodebw node_ab;
 	struct list_head link;
@@ -129,6 +131,7 @@ void *msm_bus_realloc_devmem(struct device *dev, void *p, size_t old_size,
 extern struct msm_bus_device_node_registration
 	*msm_bus_of_to_pdata(struct platform_device *pdev);
 extern void msm_bus_arb_setops_adhoc(struct msm_bus_arb_ops *arb_ops);
+extern void msm_bus_adhoc_flush_routes(void);
 extern int msm_bus_bimc_set_ops(struct msm_bus_node_device_type *bus_dev);
 extern int msm_bus_noc_set_ops(struct msm_bus_node_device_type *bus_dev);
 extern int msm_bus_of_get_static_rules(struct platform_device *pdev,
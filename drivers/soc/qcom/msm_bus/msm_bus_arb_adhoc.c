@@ -12,6 +12,7 @@
 #include <linux/kernel.h>
 #include <linux/init.h>
 #include <linux/list.h>
+#include <linux/hashtable.h>
 #include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/mutex.h>
@@ -24,22 +25,48 @@
 #define NUM_CL_HANDLES	50
 #define NUM_LNODES	3
 #define MAX_STR_CL	50
+#define ROUTE_HASH_BITS	6
 
 struct bus_search_type {
 	struct list_head link;
 	struct list_head node_list;
 };
 
+/*
+ * Result of the route search between a master and a slave. The search
+ * only depends on the topology, so it is done once per (src, dest) pair
+ * and reused by every client voting on that pair; the link nodes holding
+ * the votes of a client are still allocated per client along the hops.
+ */
+struct msm_bus_route {
+	struct hlist_node hnode;
+	int src;
+	int dest;
+	int num_hops;
+	struct device *hops[];	/* dest first, src last */
+};
+
 struct handle_type {
 	int num_entries;
 	struct msm_bus_client **cl_list;
 };
 
+/*
+ * Nodes dirtied by the votes of a transaction, per context. They are
+ * flushed to the clocks and the RPM once by commit_txn(), however many
+ * paths the transaction updated.
+ */
+struct msm_bus_txn {
+	int *dirty_nodes[NUM_CTX];
+	int num_dirty[NUM_CTX];
+};
+
 static struct handle_type handle_list;
 struct list_head input_list;
 struct list_head apply_list;
 
 DEFINE_MUTEX(msm_bus_adhoc_lock);
+static DEFINE_HASHTABLE(route_cache, ROUTE_HASH_BITS);
 
 static bool chk_bl_list(struct list_head *black_list, unsigned int id)
 {
@@ -108,7 +135,7 @@ int msm_bus_device_match_adhoc(struct device *dev, void *id)
 }
 
 static int gen_lnode(struct device *dev,
-			int next_hop, int prev_idx)
+			struct device *next_dev, int prev_idx)
 {
 	struct link_node *lnode;
 	struct msm_bus_node_device_type *cur_dev = NULL;
@@ -166,14 +193,12 @@ static int gen_lnode(struct device *dev,
 	}
 
 	lnode->in_use = 1;
-	if (next_hop == cur_dev->node_info->id) {
+	if (!next_dev) {
 		lnode->next = -1;
 		lnode->next_dev = NULL;
 	} else {
 		lnode->next = prev_idx;
-		lnode->next_dev = bus_find_device(&msm_bus_type, NULL,
-					(void *) &next_hop,
-					msm_bus_device_match_adhoc);
+		lnode->next_dev = next_dev;
 	}
 
 	memset(lnode->lnode_ib, 0, sizeof(uint64_t) * NUM_CTX);
@@ -183,10 +208,39 @@ exit_gen_lnode:
 	return lnode_idx;
 }
 
+/*
+ * Set the vote of one link node and keep the aggregates of the node up to
+ * date: the ab sum moves by the delta, the ib max is only searched for
+ * again when the vote holding it goes down.
+ */
+static void update_lnode_vote(struct msm_bus_node_device_type *bus_dev,
+			int lnode_idx, int ctx, uint64_t ib, uint64_t ab)
+{
+	struct link_node *lnode = &bus_dev->lnode_list[lnode_idx];
+	uint64_t old_ib = lnode->lnode_ib[ctx];
+	int i;
+
+	bus_dev->lnode_ab_sum[ctx] -= lnode->lnode_ab[ctx];
+	bus_dev->lnode_ab_sum[ctx] += ab;
+	lnode->lnode_ab[ctx] = ab;
+	lnode->lnode_ib[ctx] = ib;
+
+	if (ib >= bus_dev->lnode_ib_max[ctx]) {
+		bus_dev->lnode_ib_max[ctx] = ib;
+	} else if (old_ib == bus_dev->lnode_ib_max[ctx]) {
+		bus_dev->lnode_ib_max[ctx] = 0;
+		for (i = 0; i < bus_dev->num_lnodes; i++)
+			bus_dev->lnode_ib_max[ctx] =
+				max(bus_dev->lnode_ib_max[ctx],
+					bus_dev->lnode_list[i].lnode_ib[ctx]);
+	}
+}
+
 static int remove_lnode(struct msm_bus_node_device_type *cur_dev,
 				int lnode_idx)
 {
 	int ret = 0;
+	int ctx;
 
 	if (!cur_dev) {
 		MSM_BUS_ERR("%s: Null device ptr", __func__);
@@ -203,6 +257,10 @@ static int remove_lnode(struct msm_bus_node_device_type *cur_dev,
 			goto exit_remove_lnode;
 		}
 
+		/* Drop whatever is left of the vote from the aggregates */
+		for (ctx = 0; ctx < NUM_CTX; ctx++)
+			update_lnode_vote(cur_dev, lnode_idx, ctx, 0, 0);
+
 		cur_dev->lnode_list[lnode_idx].next = -1;
 		cur_dev->lnode_list[lnode_idx].next_dev = NULL;
 		cur_dev->lnode_list[lnode_idx].in_use = 0;
@@ -212,8 +270,8 @@ exit_remove_lnode:
 	return ret;
 }
 
-static int prune_path(struct list_head *route_list, int dest, int src,
-				struct list_head *black_list, int found)
+static struct msm_bus_route *prune_path(struct list_head *route_list,
+		int dest, int src, struct list_head *black_list, int found)
 {
 	struct bus_search_type *search_node, *temp_search_node;
 	struct msm_bus_node_device_type *bus_node;
@@ -223,17 +281,31 @@ static int prune_path(struct list_head *route_list, int dest, int src,
 	struct device *dest_dev = bus_find_device(&msm_bus_type, NULL,
 					(void *) &dest,
 					msm_bus_device_match_adhoc);
-	int lnode_hop = -1;
+	struct msm_bus_route *route = NULL;
+	int max_hops = 1;
 
 	if (!found)
 		goto reset_links;
 
 	if (!dest_dev) {
 		MSM_BUS_ERR("%s: Can't find dest dev %d", __func__, dest);
-		goto exit_prune_path;
+		goto reset_links;
 	}
 
-	lnode_hop = gen_lnode(dest_dev, search_dev_id, lnode_hop);
+	list_for_each_entry(search_node, route_list, link)
+		list_for_each_entry(bus_node, &search_node->node_list, link)
+			max_hops++;
+
+	route = kzalloc(sizeof(struct msm_bus_route) +
+			max_hops * sizeof(struct device *), GFP_KERNEL);
+	if (!route) {
+		MSM_BUS_ERR("%s: Error allocating route %d -> %d", __func__,
+							src, dest);
+		goto reset_links;
+	}
+	route->src = src;
+	route->dest = dest;
+	route->hops[route->num_hops++] = dest_dev;
 
 	list_for_each_entry_reverse(search_node, route_list, link) {
 		list_for_each_entry(bus_node, &search_node->node_list, link) {
@@ -251,13 +323,13 @@ static int prune_path(struct list_head *route_list, int dest, int src,
 						msm_bus_device_match_adhoc);
 
 					if (!dest_dev) {
-						lnode_hop = -1;
+						kfree(route);
+						route = NULL;
 						goto reset_links;
 					}
 
-					lnode_hop = gen_lnode(dest_dev,
-							search_dev_id,
-							lnode_hop);
+					route->hops[route->num_hops++] =
+								dest_dev;
 					search_dev_id =
 						bus_node->node_info->id;
 					break;
@@ -279,8 +351,7 @@ reset_links:
 	list_for_each_safe(bl_list, temp_bl_list, black_list)
 		list_del(bl_list);
 
-exit_prune_path:
-	return lnode_hop;
+	return route;
 }
 
 static void setup_bl_list(struct msm_bus_node_device_type *node,
@@ -295,7 +366,7 @@ static void setup_bl_list(struct msm_bus_node_device_type *node,
 	}
 }
 
-static int getpath(int src, int dest)
+static struct msm_bus_route *find_route(int src, int dest)
 {
 	struct list_head traverse_list;
 	struct list_head edge_list;
@@ -308,7 +379,7 @@ static int getpath(int src, int dest)
 	struct bus_search_type *search_node;
 	int found = 0;
 	int depth_index = 0;
-	int first_hop = -1;
+	struct msm_bus_route *route = NULL;
 
 	INIT_LIST_HEAD(&traverse_list);
 	INIT_LIST_HEAD(&edge_list);
@@ -385,26 +456,105 @@ static int getpath(int src, int dest)
 	}
 reset_traversed:
 	copy_remaining_nodes(&edge_list, &traverse_list, &route_list);
-	first_hop = prune_path(&route_list, dest, src, &black_list, found);
+	route = prune_path(&route_list, dest, src, &black_list, found);
 
 exit_getpath:
-	return first_hop;
+	return route;
+}
+
+static inline u32 route_key(int src, int dest)
+{
+	return (u32)src ^ ((u32)dest << 16);
+}
+
+static struct msm_bus_route *lookup_route(int src, int dest)
+{
+	struct msm_bus_route *route;
+
+	hash_for_each_possible(route_cache, route, hnode,
+					route_key(src, dest)) {
+		if (route->src == src && route->dest == dest)
+			return route;
+	}
+	return NULL;
+}
+
+/**
+ * msm_bus_adhoc_flush_routes() - Drop the cached routes
+ *
+ * Must be called whenever nodes are added to or removed from the bus, the
+ * routes hold pointers to the node devices.
+ */
+void msm_bus_adhoc_flush_routes(void)
+{
+	struct msm_bus_route *route;
+	struct hlist_node *tmp;
+	int bkt;
+
+	mutex_lock(&msm_bus_adhoc_lock);
+	hash_for_each_safe(route_cache, bkt, tmp, route, hnode) {
+		hash_del(&route->hnode);
+		kfree(route);
+	}
+	mutex_unlock(&msm_bus_adhoc_lock);
+}
+
+static void free_lnodes(struct device *dev, int lnode_idx)
+{
+	struct msm_bus_node_device_type *dev_info;
+	struct link_node *lnode;
+	int next_idx;
+
+	while (dev) {
+		dev_info = dev->platform_data;
+		lnode = &dev_info->lnode_list[lnode_idx];
+		next_idx = lnode->next;
+		dev = lnode->next_dev;
+		remove_lnode(dev_info, lnode_idx);
+		lnode_idx = next_idx;
+	}
+}
+
+static int getpath(int src, int dest)
+{
+	struct msm_bus_route *route;
+	struct device *next_dev = NULL;
+	int lnode_hop = -1;
+	int i;
+
+	route = lookup_route(src, dest);
+	if (!route) {
+		route = find_route(src, dest);
+		if (!route)
+			return -1;
+		hash_add(route_cache, &route->hnode, route_key(src, dest));
+	}
+
+	/* Chain up a link node of this client on every hop from dest */
+	for (i = 0; i < route->num_hops; i++) {
+		int idx = gen_lnode(route->hops[i], next_dev, lnode_hop);
+
+		if (idx < 0) {
+			MSM_BUS_ERR("%s: Can't alloc lnode for %d -> %d",
+							__func__, src, dest);
+			free_lnodes(next_dev, lnode_hop);
+			return -1;
+		}
+		next_dev = route->hops[i];
+		lnode_hop = idx;
+	}
+
+	return lnode_hop;
 }
 
 static uint64_t arbitrate_bus_req(struct msm_bus_node_device_type *bus_dev,
 								int ctx)
 {
-	int i;
-	uint64_t max_ib = 0;
-	uint64_t sum_ab = 0;
+	uint64_t max_ib = bus_dev->lnode_ib_max[ctx];
+	uint64_t sum_ab = bus_dev->lnode_ab_sum[ctx];
 	uint64_t bw_max_hz;
 	struct msm_bus_node_device_type *fab_dev = NULL;
 
-	/* Find max ib */
-	for (i = 0; i < bus_dev->num_lnodes; i++) {
-		max_ib = max(max_ib, bus_dev->lnode_list[i].lnode_ib[ctx]);
-		sum_ab += bus_dev->lnode_list[i].lnode_ab[ctx];
-	}
 	/*
 	 *  Account for Util factor and vrail comp. The new aggregation
 	 *  formula is:
@@ -496,14 +646,12 @@ static int msm_bus_apply_rules(struct list_head *list, bool after_clk_commit)
 
 static uint64_t get_node_aggab(struct msm_bus_node_device_type *bus_dev)
 {
-	int i;
 	int ctx;
 	uint64_t max_agg_ab = 0;
 	uint64_t agg_ab = 0;
 
 	for (ctx = 0; ctx < NUM_CTX; ctx++) {
-		for (i = 0; i < bus_dev->num_lnodes; i++)
-			agg_ab += bus_dev->lnode_list[i].lnode_ab[ctx];
+		agg_ab += bus_dev->lnode_ab_sum[ctx];
 
 		if (bus_dev->node_info->num_qports > 1)
 			agg_ab = msm_bus_div64(bus_dev->node_info->num_qports,
@@ -517,20 +665,33 @@ static uint64_t get_node_aggab(struct msm_bus_node_device_type *bus_dev)
 
 static uint64_t get_node_ib(struct msm_bus_node_device_type *bus_dev)
 {
-	int i;
 	int ctx;
 	uint64_t max_ib = 0;
 
+	for (ctx = 0; ctx < NUM_CTX; ctx++)
+		max_ib = max(max_ib, bus_dev->lnode_ib_max[ctx]);
+
+	return max_ib;
+}
+
+static void commit_txn(struct msm_bus_txn *txn)
+{
+	int ctx;
+
 	for (ctx = 0; ctx < NUM_CTX; ctx++) {
-		for (i = 0; i < bus_dev->num_lnodes; i++)
-			max_ib = max(max_ib,
-				bus_dev->lnode_list[i].lnode_ib[ctx]);
+		if (!txn->num_dirty[ctx])
+			continue;
+
+		msm_bus_commit_data(txn->dirty_nodes[ctx], ctx,
+						txn->num_dirty[ctx]);
+		txn->dirty_nodes[ctx] = NULL;
+		txn->num_dirty[ctx] = 0;
 	}
-	return max_ib;
 }
 
 static int update_path(int src, int dest, uint64_t req_ib, uint64_t req_bw,
-			uint64_t cur_ib, uint64_t cur_bw, int src_idx, int ctx)
+			uint64_t cur_ib, uint64_t cur_bw, int src_idx, int ctx,
+			struct msm_bus_txn *txn)
 {
 	struct device *src_dev = NULL;
 	struct device *next_dev = NULL;
@@ -538,8 +699,8 @@ static int update_path(int src, int dest, uint64_t req_ib, uint64_t req_bw,
 	struct msm_bus_node_device_type *dev_info = NULL;
 	int curr_idx;
 	int ret = 0;
-	int *dirty_nodes = NULL;
-	int num_dirty = 0;
+	int **dirty_nodes = &txn->dirty_nodes[ctx];
+	int *num_dirty = &txn->num_dirty[ctx];
 	struct rule_update_path_info *rule_node;
 	bool rules_registered = msm_rule_are_rules_registered();
 
@@ -576,8 +737,7 @@ static int update_path(int src, int dest, uint64_t req_ib, uint64_t req_bw,
 		}
 
 		lnode = &dev_info->lnode_list[curr_idx];
-		lnode->lnode_ib[ctx] = req_ib;
-		lnode->lnode_ab[ctx] = req_bw;
+		update_lnode_vote(dev_info, curr_idx, ctx, req_ib, req_bw);
 
 		dev_info->cur_clk_hz[ctx] = arbitrate_bus_req(dev_info, ctx);
 
@@ -586,8 +746,8 @@ static int update_path(int src, int dest, uint64_t req_ib, uint64_t req_bw,
 		 * request at this node.
 		 */
 		if (src_dev != next_dev) {
-			ret = msm_bus_update_clks(dev_info, ctx, &dirty_nodes,
-								&num_dirty);
+			ret = msm_bus_update_clks(dev_info, ctx, dirty_nodes,
+								num_dirty);
 			if (ret) {
 				MSM_BUS_ERR("%s: Failed to update clks dev %d",
 					__func__, dev_info->node_info->id);
@@ -595,8 +755,8 @@ static int update_path(int src, int dest, uint64_t req_ib, uint64_t req_bw,
 			}
 		}
 
-		ret = msm_bus_update_bw(dev_info, ctx, req_bw, &dirty_nodes,
-								&num_dirty);
+		ret = msm_bus_update_bw(dev_info, ctx, req_bw, dirty_nodes,
+								num_dirty);
 		if (ret) {
 			MSM_BUS_ERR("%s: Failed to update bw dev %d",
 				__func__, dev_info->node_info->id);
@@ -617,14 +777,14 @@ static int update_path(int src, int dest, uint64_t req_ib, uint64_t req_bw,
 		curr_idx = lnode->next;
 	}
 
+	/*
+	 * The rules act on the nodes of this path around the clock commit,
+	 * so with rules registered each path is committed on its own.
+	 */
 	if (rules_registered) {
 		msm_rules_update_path(&input_list, &apply_list);
 		msm_bus_apply_rules(&apply_list, false);
-	}
-
-	msm_bus_commit_data(dirty_nodes, ctx, num_dirty);
-
-	if (rules_registered) {
+		commit_txn(txn);
 		msm_bus_apply_rules(&apply_list, true);
 		del_inp_list(&input_list);
 		del_op_list(&apply_list);
@@ -634,7 +794,7 @@ exit_update_path:
 }
 
 static int remove_path(int src, int dst, uint64_t cur_ib, uint64_t cur_ab,
-				int src_idx, int active_only)
+			int src_idx, int active_only, struct msm_bus_txn *txn)
 {
 	struct device *src_dev = NULL;
 	struct device *next_dev = NULL;
@@ -649,7 +809,7 @@ static int remove_path(int src, int dst, uint64_t cur_ib, uint64_t cur_ab,
 	 */
 
 	ret = update_path(src, dst, 0, 0, cur_ib, cur_ab, src_idx,
-							active_only);
+							active_only, txn);
 	if (ret) {
 		MSM_BUS_ERR("%s: Error zeroing out path ctx %d",
 					__func__, ACTIVE_CTX);
@@ -738,6 +898,7 @@ static void unregister_client_adhoc(uint32_t cl)
 	int lnode, src, curr, dest;
 	uint64_t  cur_clk, cur_bw;
 	struct msm_bus_client *client;
+	struct msm_bus_txn txn = { };
 
 	mutex_lock(&msm_bus_adhoc_lock);
 	if (!cl) {
@@ -769,8 +930,9 @@ static void unregister_client_adhoc(uint32_t cl)
 		cur_clk = client->pdata->usecase[curr].vectors[i].ib;
 		cur_bw = client->pdata->usecase[curr].vectors[i].ab;
 		remove_path(src, dest, cur_clk, cur_bw, lnode,
-						pdata->active_only);
+						pdata->active_only, &txn);
 	}
+	commit_txn(&txn);
 	msm_bus_dbg_client_data(client->pdata, MSM_BUS_DBG_UNREGISTER, cl);
 	kfree(client->src_pnode);
 	kfree(client);
@@ -896,7 +1058,8 @@ exit_register_client:
 	return handle;
 }
 
-static int update_request_adhoc(uint32_t cl, unsigned int index)
+static int __update_request_adhoc(uint32_t cl, unsigned int index,
+					struct msm_bus_txn *txn)
 {
 	int i, ret = 0;
 	struct msm_bus_scale_pdata *pdata;
@@ -906,8 +1069,6 @@ static int update_request_adhoc(uint32_t cl, unsigned int index)
 	const char *test_cl = "Null";
 	bool log_transaction = false;
 
-	mutex_lock(&msm_bus_adhoc_lock);
-
 	if (!cl) {
 		MSM_BUS_ERR("%s: Invalid client handle %d", __func__, cl);
 		ret = -ENXIO;
@@ -964,7 +1125,8 @@ static int update_request_adhoc(uint32_t cl, unsigned int index)
 		}
 
 		ret = update_path(src, dest, req_clk, req_bw,
-				curr_clk, curr_bw, lnode, pdata->active_only);
+				curr_clk, curr_bw, lnode, pdata->active_only,
+				txn);
 
 		if (ret) {
 			MSM_BUS_ERR("%s: Update path failed! %d ctx %d\n",
@@ -977,6 +1139,39 @@ static int update_request_adhoc(uint32_t cl, unsigned int index)
 	}
 	trace_bus_update_request_end(pdata->name);
 exit_update_request:
+	return ret;
+}
+
+static int update_request_adhoc(uint32_t cl, unsigned int index)
+{
+	struct msm_bus_txn txn = { };
+	int ret;
+
+	mutex_lock(&msm_bus_adhoc_lock);
+	ret = __update_request_adhoc(cl, index, &txn);
+	commit_txn(&txn);
+	mutex_unlock(&msm_bus_adhoc_lock);
+	return ret;
+}
+
+static int update_request_vec_adhoc(uint32_t *cl, unsigned int *index,
+						unsigned int num)
+{
+	struct msm_bus_txn txn = { };
+	unsigned int i;
+	int ret = 0;
+
+	mutex_lock(&msm_bus_adhoc_lock);
+	for (i = 0; i < num; i++) {
+		ret = __update_request_adhoc(cl[i], index[i], &txn);
+		if (ret) {
+			MSM_BUS_ERR("%s: Update of client %u failed %d",
+						__func__, cl[i], ret);
+			break;
+		}
+	}
+	/* Whatever got voted so far goes out, as with single updates */
+	commit_txn(&txn);
 	mutex_unlock(&msm_bus_adhoc_lock);
 	return ret;
 }
@@ -995,6 +1190,7 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 	int ret = 0;
 	char *test_cl = "test-client";
 	bool log_transaction = false;
+	struct msm_bus_txn txn = { };
 
 	mutex_lock(&msm_bus_adhoc_lock);
 
@@ -1015,7 +1211,8 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 	}
 
 	ret = update_path(cl->mas, cl->slv, ib, ab, cl->cur_ib, cl->cur_ab,
-						cl->first_hop, cl->active_only);
+					cl->first_hop, cl->active_only, &txn);
+	commit_txn(&txn);
 
 	if (ret) {
 		MSM_BUS_ERR("%s: Update path failed! %d active_only %d\n",
@@ -1037,6 +1234,8 @@ exit_update_request:
 
 static void unregister_adhoc(struct msm_bus_client_handle *cl)
 {
+	struct msm_bus_txn txn = { };
+
 	mutex_lock(&msm_bus_adhoc_lock);
 	if (!cl) {
 		MSM_BUS_ERR("%s: Null cl handle passed unregister\n",
@@ -1047,7 +1246,8 @@ static void unregister_adhoc(struct msm_bus_client_handle *cl)
 	MSM_BUS_DBG("%s: Unregistering client %p", __func__, cl);
 
 	remove_path(cl->mas, cl->slv, cl->cur_ib, cl->cur_ab,
-				cl->first_hop, cl->active_only);
+				cl->first_hop, cl->active_only, &txn);
+	commit_txn(&txn);
 
 	msm_bus_dbg_remove_client(cl);
 	kfree(cl);
@@ -1110,8 +1310,12 @@ exit_register:
  */
 void msm_bus_arb_setops_adhoc(struct msm_bus_arb_ops *arb_ops)
 {
+	/* The topology was (re)probed, the cached routes are stale */
+	msm_bus_adhoc_flush_routes();
+
 	arb_ops->register_client = register_client_adhoc;
 	arb_ops->update_request = update_request_adhoc;
+	arb_ops->update_request_vec = update_request_vec_adhoc;
 	arb_ops->unregister_client = unregister_client_adhoc;
 
 	arb_ops->register_cl = register_adhoc;
@@ -67,6 +67,41 @@ int msm_bus_scale_client_update_request(uint32_t cl, unsigned int index)
 }
 EXPORT_SYMBOL(msm_bus_scale_client_update_request);
 
+/**
+ * msm_bus_scale_client_update_request_vec() - Update the requests of several
+ * clients in one transaction
+ *
+ * cl: Handles of the clients
+ * index: Index into the vector of each client, to which the bw and clock
+ * values need to be updated
+ * num: Number of clients
+ *
+ * The votes of all the clients are aggregated before the resulting bus
+ * clocks and bandwidths are sent out, once for the whole transaction.
+ * Updating stops at the first failing client.
+ */
+int msm_bus_scale_client_update_request_vec(uint32_t *cl, unsigned int *index,
+						unsigned int num)
+{
+	unsigned int i;
+	int ret = 0;
+
+	if (arb_ops.update_request_vec)
+		return arb_ops.update_request_vec(cl, index, num);
+
+	if (!arb_ops.update_request) {
+		pr_err("%s: Bus driver not ready.",
+				__func__);
+		return -EPROBE_DEFER;
+	}
+
+	for (i = 0; i < num && !ret; i++)
+		ret = arb_ops.update_request(cl[i], index[i]);
+
+	return ret;
+}
+EXPORT_SYMBOL(msm_bus_scale_client_update_request_vec);
+
 /**
  * msm_bus_scale_unregister_client() - Unregister the client from the bus driver
  * @cl: Handle to the client
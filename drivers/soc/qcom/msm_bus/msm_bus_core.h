@@ -57,6 +57,8 @@ enum msm_bus_hw_sel {
 struct msm_bus_arb_ops {
 	uint32_t (*register_client)(struct msm_bus_scale_pdata *pdata);
 	int (*update_request)(uint32_t cl, unsigned int index);
+	int (*update_request_vec)(uint32_t *cl, unsigned int *index,
+						unsigned int num);
 	void (*unregister_client)(uint32_t cl);
 	struct msm_bus_client_handle*
 		(*register_cl)(uint32_t mas, uint32_t slv, char *name,
@@ -140,6 +142,7 @@ struct msm_bus_link_info {
 struct nodeclk {
 	struct clk *clk;
 	uint64_t rate;
+	long applied_rate;
 	bool dirty;
 	bool enable;
 };
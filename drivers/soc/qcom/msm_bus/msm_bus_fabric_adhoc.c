@@ -63,8 +63,11 @@ static int setrate_nodeclk(struct nodeclk *nclk, long rate)
 
 	ret = clk_set_rate(nclk->clk, rate);
 
-	if (ret)
+	if (ret) {
 		MSM_BUS_ERR("%s: failed to setrate clk", __func__);
+		nclk->applied_rate = 0;
+	} else
+		nclk->applied_rate = rate;
 	return ret;
 }
 
@@ -254,7 +257,13 @@ static int flush_clk_data(struct device *node_device, int ctx)
 		if (nodeclk->rate) {
 			rounded_rate = clk_round_rate(nodeclk->clk,
 							nodeclk->rate);
-			ret = setrate_nodeclk(nodeclk, rounded_rate);
+			/*
+			 * Only go to the clock (and the RPM behind it) when
+			 * the request moved to another step of the plan.
+			 */
+			if (!nodeclk->enable ||
+					nodeclk->applied_rate != rounded_rate)
+				ret = setrate_nodeclk(nodeclk, rounded_rate);
 
 			if (ret) {
 				MSM_BUS_ERR("%s: Failed to set_rate %lu for %d",
@@ -398,7 +407,7 @@ int msm_bus_update_bw(struct msm_bus_node_device_type *nodedev, int ctx,
 			int64_t add_bw, int **dirty_nodes, int *num_dirty)
 {
 	int ret = 0;
-	int i, j;
+	int i;
 	uint64_t cur_ab_slp = 0;
 	uint64_t cur_ab_act = 0;
 
@@ -406,16 +415,9 @@ int msm_bus_update_bw(struct msm_bus_node_device_type *nodedev, int ctx,
 		goto exit_update_bw;
 
 	for (i = 0; i < NUM_CTX; i++) {
-		for (j = 0; j < nodedev->num_lnodes; j++) {
-			if (i == DUAL_CTX) {
-				cur_ab_act +=
-					nodedev->lnode_list[j].lnode_ab[i];
-				cur_ab_slp +=
-					nodedev->lnode_list[j].lnode_ab[i];
-			} else
-				cur_ab_act +=
-					nodedev->lnode_list[j].lnode_ab[i];
-		}
+		cur_ab_act += nodedev->lnode_ab_sum[i];
+		if (i == DUAL_CTX)
+			cur_ab_slp += nodedev->lnode_ab_sum[i];
 	}
 
 	if (nodedev->node_ab.ab[QCOM_SMD_RPM_ACTIVE_STATE] != cur_ab_act) {
@@ -1212,6 +1214,7 @@ static int msm_bus_free_dev(struct device *dev, void *data)
 
 int msm_bus_device_remove(struct platform_device *pdev)
 {
+	msm_bus_adhoc_flush_routes();
 	bus_for_each_dev(&msm_bus_type, NULL, NULL, msm_bus_free_dev);
 	return 0;
 }
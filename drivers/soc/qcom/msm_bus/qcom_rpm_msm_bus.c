@@ -26,9 +26,20 @@ struct qcom_rpm_msm_bus_info {
 
 static struct qcom_rpm_msm_bus_info rpm_bus_info;
 
+/*
+ * Sleep set votes only take effect once the application processor goes
+ * to sleep, so nobody waits for them: they are queued without waiting for
+ * the ack. Active set votes stay synchronous, as clients expect the
+ * bandwidth to be there once their request returns.
+ */
 int qcom_rpm_bus_send_message(int ctx, int rsc_type, int id,
 	struct qcom_msm_bus_req *req)
 {
+	if (ctx == QCOM_SMD_RPM_SLEEP_STATE)
+		return qcom_rpm_smd_write_async(rpm_bus_info.rpm, ctx,
+						rsc_type, id, req,
+						sizeof(*req), NULL, NULL);
+
 	return qcom_rpm_smd_write(rpm_bus_info.rpm, ctx, rsc_type, id, req,
 				  sizeof(*req));
 }
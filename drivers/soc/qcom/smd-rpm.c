@@ -17,26 +17,57 @@
 #include <linux/of_platform.h>
 #include <linux/io.h>
 #include <linux/interrupt.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
 
 #include <linux/soc/qcom/smd.h>
 #include <linux/soc/qcom/smd-rpm.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/qcom_smd_rpm.h>
+
 #define RPM_REQUEST_TIMEOUT     (5 * HZ)
 
+/* SMD packets to the RPM may not exceed 256 bytes */
+#define RPM_MAX_PKT_SIZE	256
+
+#define RPM_VOTE_POOL_SIZE	32
+#define RPM_MAX_INFLIGHT	8
+
+struct qcom_rpm_vote;
+
 /**
  * struct qcom_smd_rpm - state of the rpm device driver
  * @rpm_channel:	reference to the smd channel
- * @ack:		completion for acks
- * @lock:		mutual exclusion around the send/complete pair
- * @ack_status:		result of the rpm request
+ * @lock:		serializes transmission, keeping msg_ids in send order
+ * @vote_lock:		guard for the vote lists and @inflight_count
+ * @votes:		preallocated pool of vote packets
+ * @free:		list of unused entries in @votes
+ * @pending:		votes waiting for a slot in the in-flight window
+ * @inflight:		votes sent to the rpm, waiting to be acked
+ * @inflight_count:	number of entries in @inflight
+ * @msg_id:		identifier of the next outgoing message
+ * @pool_wait:		wait queue for entries to be returned to @free
+ * @kick_work:		work item transmitting pending votes as acks arrive
  */
 struct qcom_smd_rpm {
 	struct qcom_smd_channel *rpm_channel;
 
-	struct completion ack;
 	struct mutex lock;
-	int ack_status;
+
+	spinlock_t vote_lock;
+	struct qcom_rpm_vote *votes;
+	struct list_head free;
+	struct list_head pending;
+	struct list_head inflight;
+	unsigned inflight_count;
+	u32 msg_id;
+
+	wait_queue_head_t pool_wait;
+	struct work_struct kick_work;
 };
 
 /**
@@ -88,13 +119,376 @@ struct qcom_rpm_message {
 #define RPM_MSG_TYPE_ERR		0x00727265 /* "err\0" */
 #define RPM_MSG_TYPE_MSG_ID		0x2367736d /* "msg#" */
 
+#define RPM_MAX_PAYLOAD_SIZE	(RPM_MAX_PKT_SIZE - 1 - \
+				 sizeof(struct qcom_rpm_header) - \
+				 sizeof(struct qcom_rpm_request))
+
+/**
+ * struct qcom_rpm_vote - a single request for a resource in the rpm
+ * @node:	entry in one of the free, pending or inflight lists
+ * @merged:	votes superseded by this one, to be completed along with it
+ * @state:	active/sleep set the vote applies to
+ * @type:	resource type
+ * @id:		resource identifier
+ * @msg_id:	identifier assigned when the vote is transmitted
+ * @sent:	time of transmission, for the ack latency tracepoint
+ * @count:	number of bytes in @pkt.payload
+ * @cb:		completion callback, NULL for fire-and-forget votes
+ * @cb_data:	context passed to @cb
+ * @pkt:	the packet, as transmitted to the rpm
+ */
+struct qcom_rpm_vote {
+	struct list_head node;
+	struct list_head merged;
+
+	int state;
+	u32 type;
+	u32 id;
+	u32 msg_id;
+	ktime_t sent;
+	size_t count;
+
+	qcom_rpm_smd_cb_t cb;
+	void *cb_data;
+
+	struct {
+		struct qcom_rpm_header hdr;
+		struct qcom_rpm_request req;
+		u8 payload[RPM_MAX_PAYLOAD_SIZE];
+	} pkt;
+};
+
+/*
+ * Grab an entry from the vote pool, returns NULL if the pool is exhausted.
+ */
+static struct qcom_rpm_vote *qcom_rpm_vote_get(struct qcom_smd_rpm *rpm)
+{
+	struct qcom_rpm_vote *vote;
+	unsigned long flags;
+
+	spin_lock_irqsave(&rpm->vote_lock, flags);
+	vote = list_first_entry_or_null(&rpm->free, struct qcom_rpm_vote, node);
+	if (vote)
+		list_del(&vote->node);
+	spin_unlock_irqrestore(&rpm->vote_lock, flags);
+
+	return vote;
+}
+
+/*
+ * Return a vote to the pool.
+ *
+ * LOCKING: must be called with rpm->vote_lock held
+ */
+static void qcom_rpm_vote_put(struct qcom_smd_rpm *rpm,
+			      struct qcom_rpm_vote *vote)
+{
+	list_add(&vote->node, &rpm->free);
+	wake_up(&rpm->pool_wait);
+}
+
+/*
+ * Report the status of a vote, and any votes it superseded, back to the
+ * submitters and release the entries.
+ *
+ * LOCKING: must be called with rpm->vote_lock held
+ */
+static void qcom_rpm_vote_complete(struct qcom_smd_rpm *rpm,
+				   struct qcom_rpm_vote *vote,
+				   int status)
+{
+	struct qcom_rpm_vote *tmp;
+	struct qcom_rpm_vote *old;
+
+	list_for_each_entry_safe(old, tmp, &vote->merged, node) {
+		list_del(&old->node);
+		if (old->cb)
+			old->cb(old->cb_data, status);
+		qcom_rpm_vote_put(rpm, old);
+	}
+
+	if (vote->cb)
+		vote->cb(vote->cb_data, status);
+	qcom_rpm_vote_put(rpm, vote);
+}
+
+/*
+ * Take an in-flight vote out of the window and complete it.
+ *
+ * LOCKING: must be called with rpm->vote_lock held
+ */
+static void qcom_rpm_vote_retire(struct qcom_smd_rpm *rpm,
+				 struct qcom_rpm_vote *vote,
+				 int status)
+{
+	list_del(&vote->node);
+	rpm->inflight_count--;
+	qcom_rpm_vote_complete(rpm, vote, status);
+}
+
+/*
+ * Retire in-flight votes the rpm hasn't acked within RPM_REQUEST_TIMEOUT, so
+ * that a lost ack doesn't hold on to a slot in the window forever. A late ack
+ * for a retired vote is dropped by the rx callback.
+ *
+ * LOCKING: must be called with rpm->vote_lock held
+ */
+static void qcom_rpm_smd_expire(struct qcom_smd_rpm *rpm)
+{
+	struct qcom_rpm_vote *vote;
+	struct qcom_rpm_vote *tmp;
+	ktime_t limit;
+
+	limit = ktime_sub_ns(ktime_get(),
+			     jiffies_to_nsecs(RPM_REQUEST_TIMEOUT));
+
+	/* The in-flight list is in transmission order */
+	list_for_each_entry_safe(vote, tmp, &rpm->inflight, node) {
+		if (ktime_after(vote->sent, limit))
+			break;
+
+		qcom_rpm_vote_retire(rpm, vote, -ETIMEDOUT);
+	}
+}
+
+/*
+ * Transmit pending votes, for as long as there's room in the in-flight window.
+ */
+static void qcom_rpm_smd_kick(struct qcom_smd_rpm *rpm)
+{
+	struct qcom_rpm_vote *vote;
+	unsigned long flags;
+	size_t size;
+	int ret;
+
+	mutex_lock(&rpm->lock);
+
+	for (;;) {
+		spin_lock_irqsave(&rpm->vote_lock, flags);
+		if (rpm->inflight_count >= RPM_MAX_INFLIGHT)
+			qcom_rpm_smd_expire(rpm);
+
+		if (rpm->inflight_count >= RPM_MAX_INFLIGHT ||
+		    list_empty(&rpm->pending)) {
+			spin_unlock_irqrestore(&rpm->vote_lock, flags);
+			break;
+		}
+
+		vote = list_first_entry(&rpm->pending, struct qcom_rpm_vote,
+					node);
+		list_move_tail(&vote->node, &rpm->inflight);
+		rpm->inflight_count++;
+
+		vote->msg_id = rpm->msg_id++;
+		vote->sent = ktime_get();
+
+		/* Skip 0, as that's what acks lacking a msg# entry resolve to */
+		if (!rpm->msg_id)
+			rpm->msg_id = 1;
+		spin_unlock_irqrestore(&rpm->vote_lock, flags);
+
+		/*
+		 * Votes are no longer merged after this point, so the packet
+		 * is stable.
+		 */
+		vote->pkt.req.msg_id = cpu_to_le32(vote->msg_id);
+		size = sizeof(vote->pkt.hdr) + sizeof(vote->pkt.req) +
+		       vote->count;
+
+		trace_qcom_rpm_smd_send(vote->state, vote->type, vote->id,
+					vote->msg_id, vote->count);
+
+		ret = qcom_smd_send(rpm->rpm_channel, &vote->pkt, size);
+		if (ret) {
+			spin_lock_irqsave(&rpm->vote_lock, flags);
+			qcom_rpm_vote_retire(rpm, vote, ret);
+			spin_unlock_irqrestore(&rpm->vote_lock, flags);
+		}
+	}
+
+	mutex_unlock(&rpm->lock);
+}
+
+static void qcom_rpm_smd_kick_work(struct work_struct *work)
+{
+	struct qcom_smd_rpm *rpm = container_of(work, struct qcom_smd_rpm,
+						kick_work);
+
+	qcom_rpm_smd_kick(rpm);
+}
+
+/**
+ * qcom_rpm_smd_write_async - queue a write of @buf to @type:@id
+ * @rpm:	rpm handle
+ * @state:	active/sleep set to vote for
+ * @type:	resource type
+ * @id:		resource identifier
+ * @buf:	the data to be written
+ * @count:	number of bytes in @buf
+ * @cb:		callback invoked with the rpm's response, or NULL
+ * @cb_data:	context passed to @cb
+ *
+ * Queues the vote and returns without waiting for the rpm to acknowledge it.
+ * A vote for a resource that still has a vote queued for the same set is
+ * merged into the queued one, replacing its payload. @cb is called, in
+ * atomic context, once a packet carrying the vote has been acknowledged; the
+ * callback of a superseded vote is called along with the one superseding it.
+ *
+ * Passing a NULL @cb makes this a fire-and-forget vote, which is suitable for
+ * sleep set votes where nobody waits for the resource to change state.
+ *
+ * Must be called from process context, as this might sleep waiting for an
+ * entry in the packet pool. Entries are returned to the pool at the latest
+ * when a vote is retired for lack of an ack, so the wait is bounded.
+ */
+int qcom_rpm_smd_write_async(struct qcom_smd_rpm *rpm,
+			     int state,
+			     u32 type, u32 id,
+			     void *buf,
+			     size_t count,
+			     qcom_rpm_smd_cb_t cb,
+			     void *cb_data)
+{
+	struct qcom_rpm_vote *queued;
+	struct qcom_rpm_vote *vote;
+	unsigned long flags;
+
+	if (WARN_ON(count > RPM_MAX_PAYLOAD_SIZE))
+		return -EINVAL;
+
+	wait_event(rpm->pool_wait, (vote = qcom_rpm_vote_get(rpm)) != NULL);
+
+	INIT_LIST_HEAD(&vote->merged);
+	vote->state = state;
+	vote->type = type;
+	vote->id = id;
+	vote->count = count;
+	vote->cb = cb;
+	vote->cb_data = cb_data;
+
+	spin_lock_irqsave(&rpm->vote_lock, flags);
+
+	list_for_each_entry(queued, &rpm->pending, node) {
+		if (queued->state != state || queued->type != type ||
+		    queued->id != id)
+			continue;
+
+		/* Replace the payload of the queued vote with the new one */
+		queued->count = count;
+		queued->pkt.hdr.length = cpu_to_le32(sizeof(queued->pkt.req) +
+						     count);
+		queued->pkt.req.data_len = cpu_to_le32(count);
+		memcpy(queued->pkt.payload, buf, count);
+
+		/* Completion is only tracked for votes with a callback */
+		if (cb)
+			list_add_tail(&vote->node, &queued->merged);
+		else
+			qcom_rpm_vote_put(rpm, vote);
+
+		spin_unlock_irqrestore(&rpm->vote_lock, flags);
+		return 0;
+	}
+
+	vote->pkt.hdr.service_type = cpu_to_le32(RPM_SERVICE_TYPE_REQUEST);
+	vote->pkt.hdr.length = cpu_to_le32(sizeof(vote->pkt.req) + count);
+
+	vote->pkt.req.flags = cpu_to_le32(state);
+	vote->pkt.req.type = cpu_to_le32(type);
+	vote->pkt.req.id = cpu_to_le32(id);
+	vote->pkt.req.data_len = cpu_to_le32(count);
+	memcpy(vote->pkt.payload, buf, count);
+
+	list_add_tail(&vote->node, &rpm->pending);
+
+	spin_unlock_irqrestore(&rpm->vote_lock, flags);
+
+	qcom_rpm_smd_kick(rpm);
+
+	return 0;
+}
+EXPORT_SYMBOL(qcom_rpm_smd_write_async);
+
+/**
+ * struct qcom_rpm_sync_req - context of a synchronous rpm write
+ * @ack:	completion for the ack
+ * @status:	result of the rpm request
+ */
+struct qcom_rpm_sync_req {
+	struct completion ack;
+	int status;
+};
+
+static void qcom_rpm_smd_sync_cb(void *data, int status)
+{
+	struct qcom_rpm_sync_req *req = data;
+
+	req->status = status;
+	complete(&req->ack);
+}
+
+/*
+ * Detach a timed out synchronous request from any vote still referencing it,
+ * so that a late ack doesn't touch the (stack allocated) request. An in-flight
+ * vote carrying the request is retired, releasing its slot in the window; its
+ * ack is presumed lost.
+ */
+static void qcom_rpm_smd_abandon(struct qcom_smd_rpm *rpm,
+				 struct qcom_rpm_sync_req *req)
+{
+	struct qcom_rpm_vote *vote;
+	struct qcom_rpm_vote *tmp;
+	struct qcom_rpm_vote *old;
+	unsigned long flags;
+	bool kick = false;
+
+	spin_lock_irqsave(&rpm->vote_lock, flags);
+	list_for_each_entry(vote, &rpm->pending, node) {
+		if (vote->cb_data == req)
+			vote->cb = NULL;
+
+		list_for_each_entry(old, &vote->merged, node) {
+			if (old->cb_data == req)
+				old->cb = NULL;
+		}
+	}
+
+	list_for_each_entry_safe(vote, tmp, &rpm->inflight, node) {
+		bool found = vote->cb_data == req;
+
+		list_for_each_entry(old, &vote->merged, node) {
+			if (old->cb_data == req) {
+				old->cb = NULL;
+				found = true;
+			}
+		}
+
+		if (!found)
+			continue;
+
+		if (vote->cb_data == req)
+			vote->cb = NULL;
+		qcom_rpm_vote_retire(rpm, vote, -ETIMEDOUT);
+		kick = !list_empty(&rpm->pending);
+		break;
+	}
+	spin_unlock_irqrestore(&rpm->vote_lock, flags);
+
+	if (kick)
+		schedule_work(&rpm->kick_work);
+}
+
 /**
  * qcom_rpm_smd_write - write @buf to @type:@id
  * @rpm:	rpm handle
+ * @state:	active/sleep set to vote for
  * @type:	resource type
  * @id:		resource identifier
  * @buf:	the data to be written
  * @count:	number of bytes in @buf
+ *
+ * Synchronous version of qcom_rpm_smd_write_async(), waiting for the rpm to
+ * acknowledge the vote.
  */
 int qcom_rpm_smd_write(struct qcom_smd_rpm *rpm,
 		       int state,
@@ -102,50 +496,27 @@ int qcom_rpm_smd_write(struct qcom_smd_rpm *rpm,
 		       void *buf,
 		       size_t count)
 {
-	static unsigned msg_id = 1;
+	struct qcom_rpm_sync_req req;
 	int left;
 	int ret;
-	struct {
-		struct qcom_rpm_header hdr;
-		struct qcom_rpm_request req;
-		u8 payload[];
-	} *pkt;
-	size_t size = sizeof(*pkt) + count;
-
-	/* SMD packets to the RPM may not exceed 256 bytes */
-	if (WARN_ON(size >= 256))
-		return -EINVAL;
 
-	pkt = kmalloc(size, GFP_KERNEL);
-	if (!pkt)
-		return -ENOMEM;
-
-	mutex_lock(&rpm->lock);
-
-	pkt->hdr.service_type = cpu_to_le32(RPM_SERVICE_TYPE_REQUEST);
-	pkt->hdr.length = cpu_to_le32(sizeof(struct qcom_rpm_request) + count);
-
-	pkt->req.msg_id = cpu_to_le32(msg_id++);
-	pkt->req.flags = cpu_to_le32(state);
-	pkt->req.type = cpu_to_le32(type);
-	pkt->req.id = cpu_to_le32(id);
-	pkt->req.data_len = cpu_to_le32(count);
-	memcpy(pkt->payload, buf, count);
+	init_completion(&req.ack);
 
-	ret = qcom_smd_send(rpm->rpm_channel, pkt, size);
+	ret = qcom_rpm_smd_write_async(rpm, state, type, id, buf, count,
+				       qcom_rpm_smd_sync_cb, &req);
 	if (ret)
-		goto out;
+		return ret;
 
-	left = wait_for_completion_timeout(&rpm->ack, RPM_REQUEST_TIMEOUT);
-	if (!left)
-		ret = -ETIMEDOUT;
-	else
-		ret = rpm->ack_status;
+	left = wait_for_completion_timeout(&req.ack, RPM_REQUEST_TIMEOUT);
+	if (!left) {
+		qcom_rpm_smd_abandon(rpm, &req);
 
-out:
-	kfree(pkt);
-	mutex_unlock(&rpm->lock);
-	return ret;
+		/* The ack might have raced with us detaching the request */
+		if (!try_wait_for_completion(&req.ack))
+			return -ETIMEDOUT;
+	}
+
+	return req.status;
 }
 EXPORT_SYMBOL(qcom_rpm_smd_write);
 
@@ -159,8 +530,11 @@ static int qcom_smd_rpm_callback(struct qcom_smd_device *qsdev,
 	struct qcom_smd_rpm *rpm = dev_get_drvdata(&qsdev->dev);
 	const u8 *buf = data + sizeof(struct qcom_rpm_header);
 	const u8 *end = buf + hdr_length;
+	struct qcom_rpm_vote *vote;
+	unsigned long flags;
 	char msgbuf[32];
 	int status = 0;
+	u32 msg_id = 0;
 	u32 len, msg_length;
 
 	if (le32_to_cpu(hdr->service_type) != RPM_SERVICE_TYPE_REQUEST ||
@@ -174,6 +548,7 @@ static int qcom_smd_rpm_callback(struct qcom_smd_device *qsdev,
 		msg_length = le32_to_cpu(msg->length);
 		switch (le32_to_cpu(msg->msg_type)) {
 		case RPM_MSG_TYPE_MSG_ID:
+			msg_id = le32_to_cpu(msg->msg_id);
 			break;
 		case RPM_MSG_TYPE_ERR:
 			len = min_t(u32, ALIGN(msg_length, 4), sizeof(msgbuf));
@@ -190,22 +565,54 @@ static int qcom_smd_rpm_callback(struct qcom_smd_device *qsdev,
 		buf = PTR_ALIGN(buf + 2 * sizeof(u32) + msg_length, 4);
 	}
 
-	rpm->ack_status = status;
-	complete(&rpm->ack);
+	spin_lock_irqsave(&rpm->vote_lock, flags);
+	list_for_each_entry(vote, &rpm->inflight, node) {
+		if (vote->msg_id != msg_id)
+			continue;
+
+		trace_qcom_rpm_smd_ack(vote->type, vote->id, msg_id, status,
+				ktime_to_ns(ktime_sub(ktime_get(), vote->sent)));
+		qcom_rpm_vote_retire(rpm, vote, status);
+
+		if (!list_empty(&rpm->pending))
+			schedule_work(&rpm->kick_work);
+
+		spin_unlock_irqrestore(&rpm->vote_lock, flags);
+		return 0;
+	}
+	spin_unlock_irqrestore(&rpm->vote_lock, flags);
+
+	/* Most likely the ack of a vote that was retired after timing out */
+	dev_dbg(&qsdev->dev, "ack for unknown msg_id %u\n", msg_id);
 	return 0;
 }
 
 static int qcom_smd_rpm_probe(struct qcom_smd_device *sdev)
 {
 	struct qcom_smd_rpm *rpm;
+	int i;
 
 	rpm = devm_kzalloc(&sdev->dev, sizeof(*rpm), GFP_KERNEL);
 	if (!rpm)
 		return -ENOMEM;
 
+	rpm->votes = devm_kcalloc(&sdev->dev, RPM_VOTE_POOL_SIZE,
+				  sizeof(*rpm->votes), GFP_KERNEL);
+	if (!rpm->votes)
+		return -ENOMEM;
+
 	mutex_init(&rpm->lock);
-	init_completion(&rpm->ack);
+	spin_lock_init(&rpm->vote_lock);
+	INIT_LIST_HEAD(&rpm->free);
+	INIT_LIST_HEAD(&rpm->pending);
+	INIT_LIST_HEAD(&rpm->inflight);
+	init_waitqueue_head(&rpm->pool_wait);
+	INIT_WORK(&rpm->kick_work, qcom_rpm_smd_kick_work);
+
+	for (i = 0; i < RPM_VOTE_POOL_SIZE; i++)
+		list_add_tail(&rpm->votes[i].node, &rpm->free);
 
+	rpm->msg_id = 1;
 	rpm->rpm_channel = sdev->channel;
 
 	dev_set_drvdata(&sdev->dev, rpm);
@@ -215,7 +622,11 @@ static int qcom_smd_rpm_probe(struct qcom_smd_device *sdev)
 
 static void qcom_smd_rpm_remove(struct qcom_smd_device *sdev)
 {
+	struct qcom_smd_rpm *rpm = dev_get_drvdata(&sdev->dev);
+
 	of_platform_depopulate(&sdev->dev);
+
+	cancel_work_sync(&rpm->kick_work);
 }
 
 static const struct of_device_id qcom_smd_rpm_of_match[] = {
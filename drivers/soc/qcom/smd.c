@@ -14,6 +14,7 @@
 
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/kthread.h>
 #include <linux/mfd/syscon.h>
 #include <linux/module.h>
 #include <linux/of_irq.h>
@@ -26,6 +27,9 @@
 #include <linux/soc/qcom/smem.h>
 #include <linux/wait.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/qcom_smd.h>
+
 /*
  * The Qualcomm Shared Memory communication solution provides point-to-point
  * channels for clients to send and receive streaming or packet based data.
@@ -62,6 +66,13 @@
  * receiving the interrupt we check the channel info for new data and delivers
  * this to the attached device. If the device is not ready to receive the data
  * we leave it in the ring buffer for now.
+ *
+ * By default the rx processing, including invoking the client callback, is
+ * done in the edge interrupt handler. A client may request its channel to be
+ * serviced by a dedicated SCHED_FIFO thread, through the
+ * qcom,rx-thread-priority (and optionally qcom,rx-thread-cpu) property of its
+ * device node, isolating it from other, potentially slow, clients on the same
+ * edge.
  */
 
 struct smd_channel_info;
@@ -358,6 +369,7 @@ static void qcom_smd_channel_set_state(struct qcom_smd_channel *channel,
 		return;
 
 	dev_dbg(edge->smd->dev, "set_state(%s, %d)\n", channel->name, state);
+	trace_qcom_smd_channel_state(channel->name, state, false);
 
 	SET_TX_CHANNEL_FLAG(channel, fDSR, is_open);
 	SET_TX_CHANNEL_FLAG(channel, fCTS, is_open);
@@ -388,17 +400,15 @@ static void smd_copy_to_fifo(void __iomem *dst,
 /*
  * Copy count bytes of data using 32bit accesses, if that is required.
  */
-static void smd_copy_from_fifo(void *_dst, const void __iomem *_src, size_t count, bool word_aligned)
+static void smd_copy_from_fifo(void *dst,
+			       const void __iomem *src,
+			       size_t count,
+			       bool word_aligned)
 {
-	u32 *dst = (u32 *)_dst;
-	u32 *src = (u32 *)_src;
-
 	if (word_aligned) {
-		count /= sizeof(u32);
-		while (count--)
-			*dst++ = __raw_readl(src++);
+		__ioread32_copy(dst, src, count / sizeof(u32));
 	} else {
-		memcpy_fromio(_dst, _src, count);
+		memcpy_fromio(dst, src, count);
 	}
 }
 
@@ -477,6 +487,8 @@ static int qcom_smd_channel_recv_single(struct qcom_smd_channel *channel)
 	if (ret < 0)
 		return ret;
 
+	trace_qcom_smd_recv(channel->name, len);
+
 	/* Only forward the tail if the client consumed the data */
 	qcom_smd_channel_advance(channel, len);
 
@@ -501,6 +513,7 @@ static bool qcom_smd_channel_intr(struct qcom_smd_channel *channel)
 	if (remote_state != channel->remote_state) {
 		channel->remote_state = remote_state;
 		need_state_scan = true;
+		trace_qcom_smd_channel_state(channel->name, remote_state, true);
 	}
 	/* Indicate that we have seen any state change */
 	SET_RX_CHANNEL_FLAG(channel, fSTATE, 0);
@@ -565,7 +578,11 @@ static irqreturn_t qcom_smd_edge_intr(int irq, void *data)
 	read_lock(&edge->channels_lock);
 	list_for_each_entry(channel, &edge->channels, list) {
 		spin_lock(&channel->recv_lock);
-		kick_worker |= qcom_smd_channel_intr(channel);
+		if (channel->rx_task)
+			queue_kthread_work(&channel->rx_worker,
+					   &channel->rx_work);
+		else
+			kick_worker |= qcom_smd_channel_intr(channel);
 		spin_unlock(&channel->recv_lock);
 	}
 	read_unlock(&edge->channels_lock);
@@ -587,6 +604,108 @@ static irqreturn_t qcom_smd_edge_intr(int irq, void *data)
 	return IRQ_HANDLED;
 }
 
+/*
+ * Per channel rx thread, doing the work of qcom_smd_channel_intr() on behalf
+ * of the edge interrupt handler.
+ */
+static void qcom_smd_channel_rx_work(struct kthread_work *work)
+{
+	struct qcom_smd_channel *channel = container_of(work,
+							struct qcom_smd_channel,
+							rx_work);
+	unsigned long flags;
+	bool kick_worker;
+
+	spin_lock_irqsave(&channel->recv_lock, flags);
+	kick_worker = qcom_smd_channel_intr(channel);
+	spin_unlock_irqrestore(&channel->recv_lock, flags);
+
+	if (kick_worker)
+		schedule_work(&channel->edge->scan_work);
+}
+
+/*
+ * Spawn a dedicated rx thread for the channel, if requested by the client's
+ * device node.
+ */
+static int qcom_smd_channel_start_rx_thread(struct qcom_smd_channel *channel,
+					    struct device_node *node)
+{
+	struct sched_param param;
+	struct task_struct *task;
+	unsigned long flags;
+	u32 prio;
+	u32 cpu;
+	int ret;
+
+	if (!node)
+		return 0;
+
+	ret = of_property_read_u32(node, "qcom,rx-thread-priority", &prio);
+	if (ret)
+		return 0;
+
+	if (!prio || prio >= MAX_RT_PRIO)
+		return -EINVAL;
+
+	init_kthread_worker(&channel->rx_worker);
+	init_kthread_work(&channel->rx_work, qcom_smd_channel_rx_work);
+
+	task = kthread_create(kthread_worker_fn, &channel->rx_worker,
+			      "smd/%s", channel->name);
+	if (IS_ERR(task))
+		return PTR_ERR(task);
+
+	param.sched_priority = prio;
+	ret = sched_setscheduler(task, SCHED_FIFO, &param);
+	if (ret)
+		goto err;
+
+	if (!of_property_read_u32(node, "qcom,rx-thread-cpu", &cpu)) {
+		if (cpu >= nr_cpu_ids) {
+			ret = -EINVAL;
+			goto err;
+		}
+
+		ret = set_cpus_allowed_ptr(task, cpumask_of(cpu));
+		if (ret)
+			goto err;
+	}
+
+	wake_up_process(task);
+
+	spin_lock_irqsave(&channel->recv_lock, flags);
+	channel->rx_task = task;
+	spin_unlock_irqrestore(&channel->recv_lock, flags);
+
+	return 0;
+
+err:
+	kthread_stop(task);
+	return ret;
+}
+
+/*
+ * Return rx processing of the channel to the edge interrupt handler and stop
+ * the channel's rx thread, if any.
+ */
+static void qcom_smd_channel_stop_rx_thread(struct qcom_smd_channel *channel)
+{
+	struct task_struct *task;
+	unsigned long flags;
+
+	spin_lock_irqsave(&channel->recv_lock, flags);
+	task = channel->rx_task;
+	channel->rx_task = NULL;
+	spin_unlock_irqrestore(&channel->recv_lock, flags);
+
+	if (!task)
+		return;
+
+	flush_kthread_worker(&channel->rx_worker);
+	kthread_stop(task);
+}
+
 /*
  * Delivers any outstanding packets in the rx fifo, can be used after probe of
  * the clients to deliver any packets that wasn't delivered before the client
@@ -667,6 +786,7 @@ int qcom_smd_send(struct qcom_smd_channel *channel, const void *data, int len)
 {
 	__le32 hdr[5] = { cpu_to_le32(len), };
 	int tlen = sizeof(hdr) + len;
+	ktime_t wait_start = ktime_set(0, 0);
 	int ret, length;
 
 	/* Word aligned channels only accept word size aligned data */
@@ -684,6 +804,8 @@ int qcom_smd_send(struct qcom_smd_channel *channel, const void *data, int len)
 		return ret;
 
 	length = qcom_smd_get_tx_avail(channel);
+	if (length < tlen)
+		wait_start = ktime_get();
 	while (qcom_smd_get_tx_avail(channel) < tlen) {
 		if (channel->state != SMD_CHANNEL_OPENED) {
 			ret = -EPIPE;
@@ -701,6 +823,12 @@ int qcom_smd_send(struct qcom_smd_channel *channel, const void *data, int len)
 		SET_TX_CHANNEL_FLAG(channel, fBLOCKREADINTR, 1);
 	}
 
+	/* The fifo was full: report how long the sender was held up */
+	if (length < tlen)
+		trace_qcom_smd_send_wait(channel->name, len, length,
+				ktime_to_ns(ktime_sub(ktime_get(), wait_start)));
+	trace_qcom_smd_send(channel->name, len);
+
 	SET_TX_CHANNEL_FLAG(channel, fTAIL, 0);
 
 	length = qcom_smd_get_tx_avail(channel);
@@ -801,9 +929,15 @@ static int qcom_smd_dev_probe(struct device *dev)
 	struct qcom_smd_channel *channel = qsdev->channel;
 	int ret;
 
+	ret = qcom_smd_channel_start_rx_thread(channel, qsdev->dev.of_node);
+	if (ret) {
+		dev_err(&qsdev->dev, "failed to start rx thread: %d\n", ret);
+		return ret;
+	}
+
 	ret = qcom_smd_channel_open(channel, qsdrv->callback);
 	if (ret)
-		return ret;
+		goto stop_rx_thread;
 
 	ret = qsdrv->probe(qsdev);
 	if (ret)
@@ -817,6 +951,8 @@ err:
 	dev_err(&qsdev->dev, "probe failed\n");
 
 	qcom_smd_channel_close(channel);
+stop_rx_thread:
+	qcom_smd_channel_stop_rx_thread(channel);
 	return ret;
 }
 
@@ -861,6 +997,8 @@ static int qcom_smd_dev_remove(struct device *dev)
 		ch->qsdev = NULL;
 	}
 
+	qcom_smd_channel_stop_rx_thread(channel);
+
 	return 0;
 }
 
@@ -22,6 +22,9 @@
 #include <linux/soc/qcom/smem.h>
 #include <linux/debugfs.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/qcom_smem.h>
+
 /*
  * The Qualcomm shared memory system is a allocate only heap structure that
  * consists of one of more memory areas that can be accessed by the processors
@@ -60,6 +63,11 @@
  * be held - currently lock number 3 of the sfpb or tcsr is used for this on all
  * platforms.
  *
+ * As the heaps are allocate only, the location of each item found in a private
+ * partition is recorded in an index (@smem_partition_index) the first time the
+ * list is walked past it. Subsequent lookups only walk entries added since,
+ * as indicated by the free uncached offset of the partition having moved.
+ *
  */
 
 /*
@@ -227,12 +235,25 @@ struct smem_region {
 	size_t size;
 };
 
+/**
+ * struct smem_partition_index - item lookup index of a private partition
+ * @offset:	offset of each item's entry within the partition, or 0 if the item
+ *		has not been found
+ * @indexed:	offset of the first entry not yet recorded in @offset
+ */
+struct smem_partition_index {
+	u32 offset[SMEM_ITEM_COUNT];
+	u32 indexed;
+};
+
 /**
  * struct qcom_smem - device data for the smem device
  * @dev:	device pointer
  * @hwlock:	reference to a hwspinlock
  * @partitions:	list of pointers to partitions affecting the current
  *		processor/host
+ * @index:	item lookup index for each of the @partitions
+ * @index_lock:	serializes updates of @index
  * @num_regions: number of @regions
  * @regions:	list of the memory regions defining the shared memory
  */
@@ -242,6 +263,8 @@ struct qcom_smem {
 	struct hwspinlock *hwlock;
 
 	struct smem_partition_header *partitions[SMEM_HOST_COUNT];
+	struct smem_partition_index *index[SMEM_HOST_COUNT];
+	raw_spinlock_t index_lock;
 
 	struct dentry *dent;
 	u32 version;
@@ -289,6 +312,139 @@ static void *entry_to_item(struct smem_private_entry *e)
 	return p + sizeof(*e) + le16_to_cpu(e->padding_hdr);
 }
 
+/*
+ * Snapshot the end of the allocated entries of a partition. Entries are
+ * written before the free offset is advanced past them (see
+ * qcom_smem_alloc_private()), so everything below the returned end can be
+ * read without the remote spinlock. Returns NULL if the free offset is out of
+ * the partition.
+ */
+static struct smem_private_entry *
+phdr_to_published_end(struct smem_partition_header *phdr)
+{
+	u32 offset = le32_to_cpu(READ_ONCE(phdr->offset_free_uncached));
+
+	/* pairs with the wmb() of the allocating processor */
+	rmb();
+
+	if (offset < sizeof(*phdr) || offset > le32_to_cpu(phdr->size))
+		return NULL;
+
+	return (void *)phdr + offset;
+}
+
+/* Check that @e is a complete entry below @end */
+static bool private_entry_valid(struct smem_private_entry *e,
+				struct smem_private_entry *end)
+{
+	return (void *)e + sizeof(*e) <= (void *)end &&
+	       e->canary == SMEM_PRIVATE_CANARY &&
+	       private_entry_next(e) <= end;
+}
+
+/*
+ * Record any entries added to the partition of @host since it was last indexed.
+ *
+ * LOCKING: takes the index lock, the remote spinlock is not needed
+ */
+static int qcom_smem_index_private(struct qcom_smem *smem, unsigned host)
+{
+	struct smem_partition_index *index = smem->index[host];
+	struct smem_partition_header *phdr = smem->partitions[host];
+	struct smem_private_entry *e, *end;
+	unsigned long flags;
+	unsigned item;
+	int ret = 0;
+
+	end = phdr_to_published_end(phdr);
+	if (!end)
+		return -EINVAL;
+
+	raw_spin_lock_irqsave(&smem->index_lock, flags);
+
+	e = (void *)phdr + index->indexed;
+	while (e < end) {
+		if (!private_entry_valid(e, end)) {
+			dev_err(smem->dev,
+				"Found invalid canary in host %d partition\n",
+				host);
+			ret = -EINVAL;
+			break;
+		}
+
+		item = le16_to_cpu(e->item);
+		if (item < SMEM_ITEM_COUNT && !index->offset[item])
+			WRITE_ONCE(index->offset[item],
+				   (void *)e - (void *)phdr);
+
+		e = private_entry_next(e);
+	}
+
+	index->indexed = (void *)e - (void *)phdr;
+
+	raw_spin_unlock_irqrestore(&smem->index_lock, flags);
+
+	return ret;
+}
+
+/*
+ * Find the entry of @item in the partition of @host, returns NULL if the item
+ * is not allocated.
+ *
+ * LOCKING: the remote spinlock is not needed, only published entries are read
+ */
+static struct smem_private_entry *
+qcom_smem_find_private(struct qcom_smem *smem, unsigned host, unsigned item)
+{
+	struct smem_partition_header *phdr = smem->partitions[host];
+	struct smem_private_entry *e, *end;
+	u32 offset;
+	int ret;
+
+	if (item >= SMEM_ITEM_COUNT) {
+		e = phdr_to_first_private_entry(phdr);
+		end = phdr_to_published_end(phdr);
+		if (!end)
+			return ERR_PTR(-EINVAL);
+
+		while (e < end) {
+			if (!private_entry_valid(e, end)) {
+				dev_err(smem->dev,
+					"Found invalid canary in host %d partition\n",
+					host);
+				return ERR_PTR(-EINVAL);
+			}
+
+			if (le16_to_cpu(e->item) == item)
+				return e;
+
+			e = private_entry_next(e);
+		}
+
+		return NULL;
+	}
+
+	offset = READ_ONCE(smem->index[host]->offset[item]);
+	if (!offset) {
+		ret = qcom_smem_index_private(smem, host);
+		if (ret)
+			return ERR_PTR(ret);
+
+		offset = READ_ONCE(smem->index[host]->offset[item]);
+		if (!offset)
+			return NULL;
+	}
+
+	e = (void *)phdr + offset;
+	if (e->canary != SMEM_PRIVATE_CANARY) {
+		dev_err(smem->dev,
+			"Found invalid canary in host %d partition\n", host);
+		return ERR_PTR(-EINVAL);
+	}
+
+	return e;
+}
+
 /* Pointer to the one and only smem handle */
 static struct qcom_smem *__smem;
 
@@ -301,29 +457,20 @@ static int qcom_smem_alloc_private(struct qcom_smem *smem,
 				   size_t size)
 {
 	struct smem_partition_header *phdr;
-	struct smem_private_entry *hdr, *end;
+	struct smem_private_entry *hdr;
 	size_t alloc_size;
 	void *cached;
 
+	hdr = qcom_smem_find_private(smem, host, item);
+	if (IS_ERR(hdr))
+		return PTR_ERR(hdr);
+	else if (hdr)
+		return -EEXIST;
+
 	phdr = smem->partitions[host];
-	hdr = phdr_to_first_private_entry(phdr);
-	end = phdr_to_last_private_entry(phdr);
+	hdr = phdr_to_last_private_entry(phdr);
 	cached = phdr_to_first_cached_entry(phdr);
 
-	while (hdr < end) {
-		if (hdr->canary != SMEM_PRIVATE_CANARY) {
-			dev_err(smem->dev,
-				"Found invalid canary in host %d partition\n",
-				host);
-			return -EINVAL;
-		}
-
-		if (le16_to_cpu(hdr->item) == item)
-			return -EEXIST;
-
-		hdr = private_entry_next(hdr);
-	}
-
 	/* Check that we don't grow into the cached region */
 	alloc_size = sizeof(*hdr) + ALIGN(size, 8);
 	if ((void *)hdr + alloc_size >= cached) {
@@ -420,6 +567,8 @@ int qcom_smem_alloc(unsigned host, unsigned item, size_t size)
 
 	hwspin_unlock_irqrestore(__smem->hwlock, &flags);
 
+	trace_qcom_smem_alloc(host, item, size, ret);
+
 	return ret;
 }
 EXPORT_SYMBOL(qcom_smem_alloc);
@@ -439,9 +588,12 @@ static void *qcom_smem_get_global(struct qcom_smem *smem,
 
 	header = smem->regions[0].virt_base;
 	entry = &header->toc[item];
-	if (!entry->allocated)
+	if (!READ_ONCE(entry->allocated))
 		return ERR_PTR(-ENXIO);
 
+	/* pairs with the wmb() of the allocating processor */
+	rmb();
+
 	aux_base = le32_to_cpu(entry->aux_base) & AUX_BASE_MASK;
 
 	for (i = 0; i < smem->num_regions; i++) {
@@ -462,33 +614,18 @@ static void *qcom_smem_get_private(struct qcom_smem *smem,
 				   unsigned item,
 				   size_t *size)
 {
-	struct smem_partition_header *phdr;
-	struct smem_private_entry *e, *end;
+	struct smem_private_entry *e;
 
-	phdr = smem->partitions[host];
-	e = phdr_to_first_private_entry(phdr);
-	end = phdr_to_last_private_entry(phdr);
+	e = qcom_smem_find_private(smem, host, item);
+	if (IS_ERR(e))
+		return e;
+	else if (!e)
+		return ERR_PTR(-ENOENT);
 
-	while (e < end) {
-		if (e->canary != SMEM_PRIVATE_CANARY) {
-			dev_err(smem->dev,
-				"Found invalid canary in host %d partition\n",
-				host);
-			return ERR_PTR(-EINVAL);
-		}
-
-		if (le16_to_cpu(e->item) == item) {
-			if (size != NULL)
-				*size = le32_to_cpu(e->size) -
-					le16_to_cpu(e->padding_data);
-
-			return entry_to_item(e);
-		}
-
-		e = private_entry_next(e);
-	}
+	if (size != NULL)
+		*size = le32_to_cpu(e->size) - le16_to_cpu(e->padding_data);
 
-	return ERR_PTR(-ENOENT);
+	return entry_to_item(e);
 }
 
 /**
@@ -499,28 +636,24 @@ static void *qcom_smem_get_private(struct qcom_smem *smem,
  *
  * Looks up smem item and returns pointer to it. Size of smem
  * item is returned in @size.
+ *
+ * The lookup does not take the remote spinlock: allocations are published
+ * by the allocated flag of global items and by the free offset of private
+ * partitions, which are only updated once the item headers are written.
  */
 void *qcom_smem_get(unsigned host, unsigned item, size_t *size)
 {
-	unsigned long flags;
-	int ret;
 	void *ptr = ERR_PTR(-EPROBE_DEFER);
 
 	if (!__smem)
 		return ptr;
 
-	ret = hwspin_lock_timeout_irqsave(__smem->hwlock,
-					  HWSPINLOCK_TIMEOUT,
-					  &flags);
-	if (ret)
-		return ERR_PTR(ret);
-
 	if (host < SMEM_HOST_COUNT && __smem->partitions[host])
 		ptr = qcom_smem_get_private(__smem, host, item, size);
 	else
 		ptr = qcom_smem_get_global(__smem, item, size);
 
-	hwspin_unlock_irqrestore(__smem->hwlock, &flags);
+	trace_qcom_smem_get(host, item, PTR_ERR_OR_ZERO(ptr));
 
 	return ptr;
 
@@ -578,6 +711,7 @@ static int qcom_smem_get_sbl_version(struct qcom_smem *smem)
 static int qcom_smem_enumerate_partitions(struct qcom_smem *smem,
 					  unsigned local_host)
 {
+	struct smem_partition_index *index;
 	struct smem_partition_header *header;
 	struct smem_ptable_entry *entry;
 	struct smem_ptable *ptable;
@@ -664,7 +798,14 @@ static int qcom_smem_enumerate_partitions(struct qcom_smem *smem,
 			return -EINVAL;
 		}
 
+		index = devm_kzalloc(smem->dev, sizeof(*index), GFP_KERNEL);
+		if (!index)
+			return -ENOMEM;
+
+		index->indexed = sizeof(*header);
+
 		smem->partitions[remote_host] = header;
+		smem->index[remote_host] = index;
 	}
 
 	return 0;
@@ -702,8 +843,7 @@ static void smem_debug_read_mem(struct seq_file *s)
 {
 	u32 *info;
 	size_t size;
-	int ret, i;
-	long flags;
+	int i;
 
 	info = qcom_smem_get(QCOM_SMEM_HOST_ANY, SMEM_HEAP_INFO, &size);
 
@@ -726,13 +866,9 @@ static void smem_debug_read_mem(struct seq_file *s)
 
 	seq_printf(s, "\nSecure partitions accessible from APPS:\n");
 
-	ret = hwspin_lock_timeout_irqsave(__smem->hwlock,
-					  HWSPINLOCK_TIMEOUT,
-					  &flags);
-
 	for (i = 0; i < SMEM_HOST_COUNT; i++) {
 		struct smem_partition_header *part_hdr = __smem->partitions[i];
-		void *p;
+		void *p, *end;
 
 		if (!part_hdr)
 			continue;
@@ -746,8 +882,12 @@ static void smem_debug_read_mem(struct seq_file *s)
 			i, part_hdr->host0, part_hdr->host1, part_hdr->size,
 			part_hdr->offset_free_uncached);
 
+		end = phdr_to_published_end(part_hdr);
+		if (!end)
+			continue;
+
 		p = (void *)part_hdr + sizeof(*part_hdr);
-		while (p < (void *)part_hdr + part_hdr->offset_free_uncached) {
+		while (p < end) {
 			struct smem_private_entry *entry = p;
 
 			seq_printf(s,
@@ -761,8 +901,6 @@ static void smem_debug_read_mem(struct seq_file *s)
 			p += sizeof(*entry) + entry->padding_hdr + entry->size;
 		}
 	}
-
-	hwspin_unlock_irqrestore(__smem->hwlock, &flags);
 }
 
 static void smem_debug_read_version(struct seq_file *s)
@@ -814,6 +952,7 @@ static int qcom_smem_probe(struct platform_device *pdev)
 
 	smem->dev = &pdev->dev;
 	smem->num_regions = num_regions;
+	raw_spin_lock_init(&smem->index_lock);
 
 	ret = qcom_smem_map_memory(smem, &pdev->dev, "memory-region", 0);
 	if (ret)
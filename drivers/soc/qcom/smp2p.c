@@ -12,6 +12,7 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/list.h>
 #include <linux/io.h>
@@ -50,6 +51,9 @@
 
 #define SMP2P_MAGIC 0x504d5324
 
+/* Outbound updates within this window share a single kick */
+#define SMP2P_KICK_WINDOW_NS	20000
+
 /**
  * struct smp2p_smem_item - in memory communication structure
  * @magic:		magic number
@@ -126,6 +130,10 @@ struct smp2p_entry {
  * @ipc_regmap:	regmap for the outbound ipc
  * @ipc_offset:	offset within the regmap
  * @ipc_bit:	bit in regmap@offset to kick to signal remote processor
+ * @kick_lock:	lock protecting the kick coalescing state
+ * @kick_timer:	timer sending a deferred kick
+ * @kick_pending: a deferred kick is scheduled
+ * @last_kick:	time of the last kick
  * @inbound:	list of inbound entries
  * @outbound:	list of outbound entries
  */
@@ -146,6 +154,11 @@ struct qcom_smp2p {
 	int ipc_offset;
 	int ipc_bit;
 
+	spinlock_t kick_lock;
+	struct hrtimer kick_timer;
+	bool kick_pending;
+	ktime_t last_kick;
+
 	struct list_head inbound;
 	struct list_head outbound;
 };
@@ -157,6 +170,52 @@ static void qcom_smp2p_kick(struct qcom_smp2p *smp2p)
 	regmap_write(smp2p->ipc_regmap, smp2p->ipc_offset, BIT(smp2p->ipc_bit));
 }
 
+static enum hrtimer_restart qcom_smp2p_kick_timeout(struct hrtimer *timer)
+{
+	struct qcom_smp2p *smp2p = container_of(timer, struct qcom_smp2p,
+						kick_timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&smp2p->kick_lock, flags);
+	smp2p->kick_pending = false;
+	smp2p->last_kick = ktime_get();
+	qcom_smp2p_kick(smp2p);
+	spin_unlock_irqrestore(&smp2p->kick_lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * The first update after a quiet period kicks the remote right away, any
+ * further updates within SMP2P_KICK_WINDOW_NS are covered by one deferred
+ * kick at the end of the window. The remote reads the whole entry, so it
+ * sees every update made before the kick.
+ */
+static void qcom_smp2p_kick_coalesced(struct qcom_smp2p *smp2p)
+{
+	unsigned long flags;
+	ktime_t now;
+
+	spin_lock_irqsave(&smp2p->kick_lock, flags);
+	if (smp2p->kick_pending)
+		goto out;
+
+	now = ktime_get();
+	if (ktime_to_ns(ktime_sub(now, smp2p->last_kick)) <
+	    SMP2P_KICK_WINDOW_NS) {
+		smp2p->kick_pending = true;
+		hrtimer_start(&smp2p->kick_timer,
+			      ktime_add_ns(smp2p->last_kick,
+					   SMP2P_KICK_WINDOW_NS),
+			      HRTIMER_MODE_ABS);
+	} else {
+		smp2p->last_kick = now;
+		qcom_smp2p_kick(smp2p);
+	}
+out:
+	spin_unlock_irqrestore(&smp2p->kick_lock, flags);
+}
+
 /**
  * qcom_smp2p_intr() - interrupt handler for incoming notifications
  * @irq:	unused
@@ -174,7 +233,7 @@ static irqreturn_t qcom_smp2p_intr(int irq, void *data)
 	unsigned pid = smp2p->remote_pid;
 	size_t size;
 	int irq_pin;
-	u32 status;
+	unsigned long status;
 	char buf[SMP2P_MAX_ENTRY_NAME];
 	u32 val;
 	int i;
@@ -216,14 +275,12 @@ static irqreturn_t qcom_smp2p_intr(int irq, void *data)
 		status = val ^ entry->last_value;
 		entry->last_value = val;
 
-		/* No changes of this entry? */
+		/* Only look at the bits that changed and are enabled */
+		status &= entry->irq_enabled[0];
 		if (!status)
 			continue;
 
-		for_each_set_bit(i, entry->irq_enabled, 32) {
-			if (!(status & BIT(i)))
-				continue;
-
+		for_each_set_bit(i, &status, 32) {
 			if ((val & BIT(i) && test_bit(i, entry->irq_rising)) ||
 			    (!(val & BIT(i)) && test_bit(i, entry->irq_falling))) {
 				irq_pin = irq_find_mapping(entry->domain, i);
@@ -325,7 +382,7 @@ static int smp2p_update_bits(void *data, u32 mask, u32 value)
 	spin_unlock(&entry->lock);
 
 	if (val != orig)
-		qcom_smp2p_kick(entry->smp2p);
+		qcom_smp2p_kick_coalesced(entry->smp2p);
 
 	return 0;
 }
@@ -450,6 +507,10 @@ static int qcom_smp2p_probe(struct platform_device *pdev)
 	INIT_LIST_HEAD(&smp2p->inbound);
 	INIT_LIST_HEAD(&smp2p->outbound);
 
+	spin_lock_init(&smp2p->kick_lock);
+	hrtimer_init(&smp2p->kick_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	smp2p->kick_timer.function = qcom_smp2p_kick_timeout;
+
 	platform_set_drvdata(pdev, smp2p);
 
 	ret = smp2p_parse_ipc(smp2p);
@@ -537,6 +598,8 @@ unwind_interfaces:
 	list_for_each_entry(entry, &smp2p->outbound, node)
 		qcom_smem_state_unregister(entry->state);
 
+	hrtimer_cancel(&smp2p->kick_timer);
+
 	smp2p->out->valid_entries = 0;
 
 	return ret;
@@ -553,6 +616,8 @@ static int qcom_smp2p_remove(struct platform_device *pdev)
 	list_for_each_entry(entry, &smp2p->outbound, node)
 		qcom_smem_state_unregister(entry->state);
 
+	hrtimer_cancel(&smp2p->kick_timer);
+
 	smp2p->out->valid_entries = 0;
 
 	return 0;
@@ -208,17 +208,17 @@ static irqreturn_t smsm_intr(int irq, void *data)
 	struct smsm_entry *entry = data;
 	unsigned i;
 	int irq_pin;
-	u32 changed;
+	unsigned long changed;
 	u32 val;
 
 	val = readl(entry->remote_state);
 	changed = val ^ entry->last_value;
 	entry->last_value = val;
 
-	for_each_set_bit(i, entry->irq_enabled, 32) {
-		if (!(changed & BIT(i)))
-			continue;
+	/* Only look at the bits that changed and are enabled */
+	changed &= entry->irq_enabled[0];
 
+	for_each_set_bit(i, &changed, 32) {
 		if (val & BIT(i)) {
 			if (test_bit(i, entry->irq_rising)) {
 				irq_pin = irq_find_mapping(entry->domain, i);
@@ -25,6 +25,10 @@
 #include <linux/platform_device.h>
 #include <linux/cpuidle.h>
 #include <linux/cpu_pm.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
+#include <linux/tick.h>
 #include <linux/qcom_scm.h>
 #include <linux/regulator/driver.h>
 #include <linux/regulator/of_regulator.h>
@@ -74,6 +78,7 @@ struct spm_reg_data {
 	u32 pmic_data[MAX_PMIC_DATA];
 	u8 seq[MAX_SEQ_DATA];
 	u8 start_index[PM_SLEEP_MODE_NR];
+	bool l2;
 };
 
 struct spm_vlevel_data {
@@ -114,6 +119,15 @@ static const struct spm_reg_data spm_reg_8974_8084_cpu  = {
 	.start_index[PM_SLEEP_MODE_SPC] = 3,
 };
 
+/*
+ * The L2 SAW sequence depends on the board's PMIC and rail setup, it is
+ * taken from the "qcom,saw2-*" properties of the SAW node.
+ */
+static const struct spm_reg_data spm_reg_8974_8084_l2  = {
+	.reg_offset = spm_reg_offset_v2_1,
+	.l2 = true,
+};
+
 static const u8 spm_reg_offset_v1_1[SPM_REG_NR] = {
 	[SPM_REG_CFG]		= 0x08,
 	[SPM_REG_STS_1]		= 0x10,
@@ -144,6 +158,37 @@ static DEFINE_PER_CPU(struct spm_driver_data *, cpu_spm_drv);
 typedef int (*idle_fn)(void);
 static DEFINE_PER_CPU(idle_fn*, qcom_idle_ops);
 
+/*
+ * Per state outcome of the low power modes entered through the SPM. An
+ * entry is aborted when an interrupt was already pending and the SPM did
+ * not power down, and wakes early when it was left before the target
+ * residency of the state, i.e. the governor should have picked a shallower
+ * state. Both cost the entry and exit latency for no power gain.
+ */
+struct qcom_idle_stats {
+	u64 entries;
+	u64 aborted;
+	u64 early;
+	u64 residency_ns;
+	u64 timer_wakeups;
+	u64 exit_ns;
+	u64 exit_max_ns;
+};
+
+static DEFINE_PER_CPU(struct qcom_idle_stats [CPUIDLE_STATE_MAX],
+		      qcom_idle_stats);
+
+/*
+ * Cluster power collapse is done by the last CPU to enter the cluster
+ * idle state, the first CPU to come back restores the cluster. Both run
+ * with interrupts off under cluster_lock.
+ */
+static struct spm_driver_data *l2_spm_drv;
+static DEFINE_RAW_SPINLOCK(cluster_lock);
+static struct cpumask cluster_idle_mask;
+static bool cluster_down;
+static u64 cluster_collapses;
+
 static inline void spm_register_write(struct spm_driver_data *drv,
 					enum spm_reg reg, u32 val)
 {
@@ -193,9 +238,17 @@ static void spm_set_low_power_mode(struct spm_driver_data *drv,
 	spm_register_write_sync(drv, SPM_REG_SPM_CTL, ctl_val);
 }
 
-static int qcom_pm_collapse(unsigned long int unused)
+static void spm_disable(struct spm_driver_data *drv)
+{
+	u32 ctl_val;
+
+	ctl_val = spm_register_read(drv, SPM_REG_SPM_CTL);
+	spm_register_write_sync(drv, SPM_REG_SPM_CTL, ctl_val & ~SPM_CTL_EN);
+}
+
+static int qcom_pm_collapse(unsigned long int flags)
 {
-	qcom_scm_cpu_power_down(QCOM_SCM_CPU_PWR_DOWN_L2_ON);
+	qcom_scm_cpu_power_down(flags);
 
 	/*
 	 * Returns here only if there was a pending interrupt and we did not
@@ -210,7 +263,7 @@ static int qcom_cpu_spc(void)
 	struct spm_driver_data *drv = __this_cpu_read(cpu_spm_drv);
 
 	spm_set_low_power_mode(drv, PM_SLEEP_MODE_SPC);
-	ret = cpu_suspend(0, qcom_pm_collapse);
+	ret = cpu_suspend(QCOM_SCM_CPU_PWR_DOWN_L2_ON, qcom_pm_collapse);
 	/*
 	 * ARM common code executes WFI without calling into our driver and
 	 * if the SPM mode is not reset, then we may accidently power down the
@@ -222,13 +275,101 @@ static int qcom_cpu_spc(void)
 	return ret;
 }
 
+static bool qcom_cluster_enter(void)
+{
+	bool last = false;
+
+	raw_spin_lock(&cluster_lock);
+	cpumask_set_cpu(smp_processor_id(), &cluster_idle_mask);
+	if (l2_spm_drv && !cluster_down &&
+	    cpumask_subset(cpu_online_mask, &cluster_idle_mask) &&
+	    !cpu_cluster_pm_enter()) {
+		spm_set_low_power_mode(l2_spm_drv, PM_SLEEP_MODE_PC);
+		cluster_down = true;
+		cluster_collapses++;
+		last = true;
+	}
+	raw_spin_unlock(&cluster_lock);
+
+	return last;
+}
+
+static void qcom_cluster_exit(void)
+{
+	raw_spin_lock(&cluster_lock);
+	if (cluster_down) {
+		spm_disable(l2_spm_drv);
+		cpu_cluster_pm_exit();
+		cluster_down = false;
+	}
+	cpumask_clear_cpu(smp_processor_id(), &cluster_idle_mask);
+	raw_spin_unlock(&cluster_lock);
+}
+
+static int qcom_cpu_pc(void)
+{
+	int ret;
+	unsigned long flags = QCOM_SCM_CPU_PWR_DOWN_L2_ON;
+	struct spm_driver_data *drv = __this_cpu_read(cpu_spm_drv);
+
+	/* Only the last man flushes the L2 and arms the L2 SAW */
+	if (qcom_cluster_enter())
+		flags = QCOM_SCM_CPU_PWR_DOWN_L2_OFF;
+
+	spm_set_low_power_mode(drv, PM_SLEEP_MODE_SPC);
+	ret = cpu_suspend(flags, qcom_pm_collapse);
+	spm_set_low_power_mode(drv, PM_SLEEP_MODE_STBY);
+
+	qcom_cluster_exit();
+
+	return ret;
+}
+
+static void qcom_idle_account(unsigned long index, int ret, u64 delta,
+			      u64 expected)
+{
+	struct qcom_idle_stats *stats = this_cpu_ptr(qcom_idle_stats) + index;
+	struct cpuidle_device *dev = __this_cpu_read(cpuidle_devices);
+	struct cpuidle_driver *drv = cpuidle_get_cpu_driver(dev);
+
+	stats->entries++;
+	stats->residency_ns += delta;
+	if (ret) {
+		stats->aborted++;
+		return;
+	}
+
+	if (drv && delta < (u64)drv->states[index].target_residency *
+				NSEC_PER_USEC)
+		stats->early++;
+
+	/*
+	 * Woken up by the timer we went to sleep for, anything past its
+	 * expiry is the cost of getting back out of the state.
+	 */
+	if (delta >= expected) {
+		stats->timer_wakeups++;
+		stats->exit_ns += delta - expected;
+		if (delta - expected > stats->exit_max_ns)
+			stats->exit_max_ns = delta - expected;
+	}
+}
+
 static int qcom_idle_enter(unsigned long index)
 {
-	return __this_cpu_read(qcom_idle_ops)[index]();
+	u64 expected = ktime_to_ns(tick_nohz_get_sleep_length());
+	u64 start = local_clock();
+	int ret;
+
+	ret = __this_cpu_read(qcom_idle_ops)[index]();
+	qcom_idle_account(index, ret, local_clock() - start, expected);
+
+	return ret;
 }
 
 static const struct of_device_id qcom_idle_state_match[] __initconst = {
 	{ .compatible = "qcom,idle-state-spc", .data = qcom_cpu_spc },
+	{ .compatible = "qcom,idle-state-pc", .data = qcom_cpu_pc },
 	{ },
 };
 
@@ -264,7 +405,8 @@ static int __init qcom_cpuidle_init(struct device_node *cpu_node, int cpu)
 		idle_fns[state_count] = match_id->data;
 
 		/* Check if any of the states allow power down */
-		if (match_id->data == qcom_cpu_spc)
+		if (match_id->data == qcom_cpu_spc ||
+		    match_id->data == qcom_cpu_pc)
 			use_scm_power_down = true;
 
 		state_count++;
@@ -307,6 +449,62 @@ static struct cpuidle_ops qcom_cpuidle_ops __initdata = {
 CPUIDLE_METHOD_OF_DECLARE(qcom_idle_v1, "qcom,kpss-acc-v1", &qcom_cpuidle_ops);
 CPUIDLE_METHOD_OF_DECLARE(qcom_idle_v2, "qcom,kpss-acc-v2", &qcom_cpuidle_ops);
 
+#ifdef CONFIG_DEBUG_FS
+static int qcom_idle_stats_show(struct seq_file *s, void *unused)
+{
+	struct qcom_idle_stats *st;
+	u64 exit_avg;
+	int cpu, i;
+
+	seq_puts(s, "cpu state entries aborted early residency_us "
+		    "timer_wakeups exit_avg_us exit_max_us\n");
+	for_each_possible_cpu(cpu) {
+		if (!per_cpu(qcom_idle_ops, cpu))
+			continue;
+
+		for (i = 1; i < CPUIDLE_STATE_MAX; i++) {
+			st = &per_cpu(qcom_idle_stats, cpu)[i];
+			if (!st->entries)
+				continue;
+
+			exit_avg = st->timer_wakeups ?
+				   div64_u64(st->exit_ns, st->timer_wakeups) : 0;
+			seq_printf(s, "%3d %5d %7llu %7llu %5llu %llu %llu %llu %llu\n",
+				   cpu, i, st->entries, st->aborted, st->early,
+				   div_u64(st->residency_ns, NSEC_PER_USEC),
+				   st->timer_wakeups,
+				   div_u64(exit_avg, NSEC_PER_USEC),
+				   div_u64(st->exit_max_ns, NSEC_PER_USEC));
+		}
+	}
+
+	if (l2_spm_drv)
+		seq_printf(s, "cluster collapses %llu\n", cluster_collapses);
+
+	return 0;
+}
+
+static int qcom_idle_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, qcom_idle_stats_show, inode->i_private);
+}
+
+static const struct file_operations qcom_idle_stats_fops = {
+	.open = qcom_idle_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init qcom_idle_stats_init(void)
+{
+	debugfs_create_file("qcom_idle_stats", S_IRUGO, NULL, NULL,
+			    &qcom_idle_stats_fops);
+	return 0;
+}
+late_initcall(qcom_idle_stats_init);
+#endif
+
 static const unsigned int saw2_volt_table[] = {
 	850000, 862500, 875000, 887500, 900000, 912500,
 	925000, 937500, 950000, 962500, 975000, 987500,
@@ -483,9 +681,66 @@ static const struct of_device_id spm_match_table[] = {
 	  .data = &spm_reg_8974_8084_cpu },
 	{ .compatible = "qcom,apq8064-saw2-v1.1-cpu",
 	  .data = &spm_reg_8064_cpu },
+	{ .compatible = "qcom,msm8974-saw2-v2.1-l2",
+	  .data = &spm_reg_8974_8084_l2 },
+	{ .compatible = "qcom,apq8084-saw2-v2.1-l2",
+	  .data = &spm_reg_8974_8084_l2 },
 	{ },
 };
 
+static int spm_l2_probe(struct platform_device *pdev,
+			const struct spm_reg_data *reg_data)
+{
+	struct device_node *np = pdev->dev.of_node;
+	struct spm_driver_data *drv;
+	struct spm_reg_data *data;
+	struct resource *res;
+	void __iomem *addr;
+	int len, ret;
+
+	drv = devm_kzalloc(&pdev->dev, sizeof(*drv), GFP_KERNEL);
+	data = devm_kmemdup(&pdev->dev, reg_data, sizeof(*data), GFP_KERNEL);
+	if (!drv || !data)
+		return -ENOMEM;
+
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	drv->reg_base = devm_ioremap_resource(&pdev->dev, res);
+	if (IS_ERR(drv->reg_base))
+		return PTR_ERR(drv->reg_base);
+
+	of_property_read_u32(np, "qcom,saw2-cfg", &data->spm_cfg);
+	of_property_read_u32(np, "qcom,saw2-spm-dly", &data->spm_dly);
+
+	len = of_property_count_u8_elems(np, "qcom,saw2-spm-cmd-pc");
+	if (len <= 0 || len > MAX_SEQ_DATA) {
+		dev_err(&pdev->dev, "invalid L2 power collapse sequence\n");
+		return -EINVAL;
+	}
+
+	ret = of_property_read_u8_array(np, "qcom,saw2-spm-cmd-pc", data->seq,
+					len);
+	if (ret)
+		return ret;
+
+	data->start_index[PM_SLEEP_MODE_PC] = 0;
+	drv->reg_data = data;
+
+	addr = drv->reg_base + data->reg_offset[SPM_REG_SEQ_ENTRY];
+	__iowrite32_copy(addr, data->seq, ARRAY_SIZE(data->seq) / 4);
+
+	spm_register_write(drv, SPM_REG_CFG, data->spm_cfg);
+	spm_register_write(drv, SPM_REG_DLY, data->spm_dly);
+
+	/* The L2 SAW is only armed by the last CPU going down */
+	spm_disable(drv);
+
+	raw_spin_lock_irq(&cluster_lock);
+	l2_spm_drv = drv;
+	raw_spin_unlock_irq(&cluster_lock);
+
+	return 0;
+}
+
 static int spm_dev_probe(struct platform_device *pdev)
 {
 	struct spm_driver_data *drv;
@@ -494,6 +749,13 @@ static int spm_dev_probe(struct platform_device *pdev)
 	void __iomem *addr;
 	int cpu, ret;
 
+	match_id = of_match_node(spm_match_table, pdev->dev.of_node);
+	if (!match_id)
+		return -ENODEV;
+
+	if (((const struct spm_reg_data *)match_id->data)->l2)
+		return spm_l2_probe(pdev, match_id->data);
+
 	drv = spm_get_drv(pdev, &cpu);
 	if (!drv)
 		return -EINVAL;
@@ -503,10 +765,6 @@ static int spm_dev_probe(struct platform_device *pdev)
 	if (IS_ERR(drv->reg_base))
 		return PTR_ERR(drv->reg_base);
 
-	match_id = of_match_node(spm_match_table, pdev->dev.of_node);
-	if (!match_id)
-		return -ENODEV;
-
 	drv->reg_data = match_id->data;
 
 	/* Write the SPM sequences first.. */
@@ -150,6 +150,8 @@ struct spi_qup {
 	int			qup_v1;
 
 	int			use_dma;
+	struct spi_transfer	*chain_last;	/* end of the DMA chain */
+	unsigned int		chain_len;
 	struct dma_slave_config	rx_conf;
 	struct dma_slave_config	tx_conf;
 };
@@ -274,6 +276,29 @@ static void spi_qup_fifo_write(struct spi_qup *controller,
 	}
 }
 
+static u32
+spi_qup_get_mode(struct spi_master *master, struct spi_transfer *xfer)
+{
+	struct spi_qup *qup = spi_master_get_devdata(master);
+	u32 mode;
+
+	qup->w_size = 4;
+
+	if (xfer->bits_per_word <= 8)
+		qup->w_size = 1;
+	else if (xfer->bits_per_word <= 16)
+		qup->w_size = 2;
+
+	qup->n_words = xfer->len / qup->w_size;
+
+	if (qup->n_words <= (qup->in_fifo_sz / sizeof(u32)))
+		mode = QUP_IO_M_MODE_FIFO;
+	else
+		mode = QUP_IO_M_MODE_BLOCK;
+
+	return mode;
+}
+
 static void spi_qup_dma_done(void *data)
 {
 	struct spi_qup *qup = data;
@@ -288,7 +313,7 @@ static int spi_qup_prep_sg(struct spi_master *master, struct spi_transfer *xfer,
 	struct spi_qup *qup = spi_master_get_devdata(master);
 	unsigned long flags = DMA_PREP_INTERRUPT | DMA_PREP_FENCE;
 	struct dma_async_tx_descriptor *desc;
-	struct scatterlist *sgl;
+	struct scatterlist *sgl, sg;
 	struct dma_chan *chan;
 	dma_cookie_t cookie;
 	unsigned int nents;
@@ -303,6 +328,19 @@ static int spi_qup_prep_sg(struct spi_master *master, struct spi_transfer *xfer,
 		sgl = xfer->rx_sg.sgl;
 	}
 
+	/*
+	 * Pre-mapped buffers are not mapped by the core, describe them with
+	 * a single entry. The DMA engine is done with it once prepared.
+	 */
+	if (master->cur_msg->is_dma_mapped) {
+		sg_init_table(&sg, 1);
+		sg_dma_address(&sg) = dir == DMA_MEM_TO_DEV ?
+				      xfer->tx_dma : xfer->rx_dma;
+		sg_dma_len(&sg) = xfer->len;
+		sgl = &sg;
+		nents = 1;
+	}
+
 	desc = dmaengine_prep_slave_sg(chan, sgl, nents, dir, flags);
 	if (!desc)
 		return -EINVAL;
@@ -315,6 +353,89 @@ static int spi_qup_prep_sg(struct spi_master *master, struct spi_transfer *xfer,
 	return dma_submit_error(cookie);
 }
 
+static bool spi_qup_is_dma_xfer(struct spi_master *master,
+				struct spi_transfer *xfer, bool mapped)
+{
+	struct spi_qup *qup = spi_master_get_devdata(master);
+	size_t dma_align = dma_get_cache_alignment();
+	unsigned long tx, rx;
+	u32 mode;
+
+	tx = mapped ? (unsigned long)xfer->tx_dma : (unsigned long)xfer->tx_buf;
+	rx = mapped ? (unsigned long)xfer->rx_dma : (unsigned long)xfer->rx_buf;
+
+	if (xfer->rx_buf && (xfer->len % qup->in_blk_sz ||
+	    IS_ERR_OR_NULL(master->dma_rx) ||
+	    !IS_ALIGNED(rx, dma_align)))
+		return false;
+
+	if (xfer->tx_buf && (xfer->len % qup->out_blk_sz ||
+	    IS_ERR_OR_NULL(master->dma_tx) ||
+	    !IS_ALIGNED(tx, dma_align)))
+		return false;
+
+	mode = spi_qup_get_mode(master, xfer);
+	if (mode == QUP_IO_M_MODE_FIFO)
+		return false;
+
+	return true;
+}
+
+static bool spi_qup_use_dma(struct spi_master *master,
+			    struct spi_transfer *xfer)
+{
+	struct spi_message *msg = master->cur_msg;
+
+	if (!master->can_dma)
+		return false;
+
+	if (msg->is_dma_mapped)
+		return spi_qup_is_dma_xfer(master, xfer, true);
+
+	return master->cur_msg_mapped &&
+	       spi_qup_is_dma_xfer(master, xfer, false);
+}
+
+/*
+ * Consecutive DMA transfers of a message that share the same settings are
+ * queued to the BAM as one descriptor chain, so the bus does not go idle
+ * between them. The chain ends at a transfer that asks for a delay or a
+ * chip select change. Returns the last transfer of the chain.
+ */
+static struct spi_transfer *spi_qup_dma_chain(struct spi_master *master,
+					      struct spi_transfer *xfer,
+					      unsigned int *len)
+{
+	struct spi_message *msg = master->cur_msg;
+	struct spi_transfer *last = xfer, *next = xfer;
+
+	*len = xfer->len;
+
+	if (xfer->delay_usecs || xfer->cs_change)
+		return last;
+
+	list_for_each_entry_continue(next, &msg->transfers, transfer_list) {
+		if (next->speed_hz != xfer->speed_hz ||
+		    next->bits_per_word != xfer->bits_per_word ||
+		    !next->tx_buf != !xfer->tx_buf ||
+		    !next->rx_buf != !xfer->rx_buf ||
+		    !spi_qup_use_dma(master, next))
+			break;
+
+		/* Without tx the input count covers the whole chain */
+		if (!xfer->tx_buf && *len + next->len > SPI_MAX_DMA_XFER)
+			break;
+
+		*len += next->len;
+		last = next;
+
+		if (next->delay_usecs || next->cs_change)
+			break;
+	}
+
+	return last;
+}
+
 static void spi_qup_dma_terminate(struct spi_master *master,
 				  struct spi_transfer *xfer)
 {
@@ -324,6 +445,27 @@ static void spi_qup_dma_terminate(struct spi_master *master,
 		dmaengine_terminate_all(master->dma_rx);
 }
 
+static int spi_qup_prep_chain(struct spi_master *master,
+			      struct spi_transfer *xfer,
+			      enum dma_transfer_direction dir,
+			      dma_async_tx_callback callback)
+{
+	struct spi_qup *qup = spi_master_get_devdata(master);
+	struct spi_transfer *last = qup->chain_last ?: xfer;
+	int ret;
+
+	/* Only the last descriptor of the chain signals completion */
+	list_for_each_entry_from(xfer, &master->cur_msg->transfers,
+				 transfer_list) {
+		ret = spi_qup_prep_sg(master, xfer, dir,
+				      xfer == last ? callback : NULL);
+		if (ret || xfer == last)
+			return ret;
+	}
+
+	return 0;
+}
+
 static int spi_qup_do_dma(struct spi_master *master, struct spi_transfer *xfer)
 {
 	dma_async_tx_callback rx_done = NULL, tx_done = NULL;
@@ -335,7 +477,7 @@ static int spi_qup_do_dma(struct spi_master *master, struct spi_transfer *xfer)
 		tx_done = spi_qup_dma_done;
 
 	if (xfer->rx_buf) {
-		ret = spi_qup_prep_sg(master, xfer, DMA_DEV_TO_MEM, rx_done);
+		ret = spi_qup_prep_chain(master, xfer, DMA_DEV_TO_MEM, rx_done);
 		if (ret)
 			return ret;
 
@@ -343,7 +485,7 @@ static int spi_qup_do_dma(struct spi_master *master, struct spi_transfer *xfer)
 	}
 
 	if (xfer->tx_buf) {
-		ret = spi_qup_prep_sg(master, xfer, DMA_MEM_TO_DEV, tx_done);
+		ret = spi_qup_prep_chain(master, xfer, DMA_MEM_TO_DEV, tx_done);
 		if (ret)
 			return ret;
 
@@ -443,29 +585,6 @@ static irqreturn_t spi_qup_qup_irq(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
-static u32
-spi_qup_get_mode(struct spi_master *master, struct spi_transfer *xfer)
-{
-	struct spi_qup *qup = spi_master_get_devdata(master);
-	u32 mode;
-
-	qup->w_size = 4;
-
-	if (xfer->bits_per_word <= 8)
-		qup->w_size = 1;
-	else if (xfer->bits_per_word <= 16)
-		qup->w_size = 2;
-
-	qup->n_words = xfer->len / qup->w_size;
-
-	if (qup->n_words <= (qup->in_fifo_sz / sizeof(u32)))
-		mode = QUP_IO_M_MODE_FIFO;
-	else
-		mode = QUP_IO_M_MODE_BLOCK;
-
-	return mode;
-}
-
 /* set clock freq ... bits per word */
 static int spi_qup_io_config(struct spi_device *spi, struct spi_transfer *xfer)
 {
@@ -524,7 +643,8 @@ static int spi_qup_io_config(struct spi_device *spi, struct spi_transfer *xfer)
 			if (xfer->tx_buf)
 				writel_relaxed(0, input_cnt);
 			else
-				writel_relaxed(n_words, input_cnt);
+				writel_relaxed(controller->chain_len /
+					       controller->w_size, input_cnt);
 
 			writel_relaxed(0, controller->base + QUP_MX_OUTPUT_CNT);
 		}
@@ -616,12 +736,29 @@ static int spi_qup_transfer_one(struct spi_master *master,
 	unsigned long timeout, flags;
 	int ret = -EIO;
 
+	/* Already sent as part of a DMA chain */
+	if (controller->chain_last) {
+		if (xfer == controller->chain_last)
+			controller->chain_last = NULL;
+		return 0;
+	}
+
+	controller->use_dma = spi_qup_use_dma(master, xfer);
+	if (controller->use_dma) {
+		struct spi_transfer *last;
+
+		last = spi_qup_dma_chain(master, xfer, &controller->chain_len);
+		controller->chain_last = last != xfer ? last : NULL;
+	} else {
+		controller->chain_len = xfer->len;
+	}
+
 	ret = spi_qup_io_config(spi, xfer);
 	if (ret)
-		return ret;
+		goto out;
 
 	timeout = DIV_ROUND_UP(xfer->speed_hz, MSEC_PER_SEC);
-	timeout = DIV_ROUND_UP(xfer->len * 8, timeout);
+	timeout = DIV_ROUND_UP(controller->chain_len * 8, timeout);
 	timeout = 100 * msecs_to_jiffies(timeout);
 
 	reinit_completion(&controller->done);
@@ -659,6 +796,10 @@ exit:
 
 	if (ret && controller->use_dma)
 		spi_qup_dma_terminate(master, xfer);
+out:
+	/* The core stops the message on error, drop the rest of the chain */
+	if (ret)
+		controller->chain_last = NULL;
 
 	return ret;
 }
@@ -666,29 +807,11 @@ exit:
 static bool spi_qup_can_dma(struct spi_master *master, struct spi_device *spi,
 			    struct spi_transfer *xfer)
 {
-	struct spi_qup *qup = spi_master_get_devdata(master);
-	size_t dma_align = dma_get_cache_alignment();
-	u32 mode;
-
-	qup->use_dma = 0;
-
-	if (xfer->rx_buf && (xfer->len % qup->in_blk_sz ||
-	    IS_ERR_OR_NULL(master->dma_rx) ||
-	    !IS_ALIGNED((size_t)xfer->rx_buf, dma_align)))
-		return false;
-
-	if (xfer->tx_buf && (xfer->len % qup->out_blk_sz ||
-	    IS_ERR_OR_NULL(master->dma_tx) ||
-	    !IS_ALIGNED((size_t)xfer->tx_buf, dma_align)))
-		return false;
-
-	mode = spi_qup_get_mode(master, xfer);
-	if (mode == QUP_IO_M_MODE_FIFO)
+	/* Pre-mapped messages carry their own DMA addresses */
+	if (master->cur_msg && master->cur_msg->is_dma_mapped)
 		return false;
 
-	qup->use_dma = 1;
-
-	return true;
+	return spi_qup_is_dma_xfer(master, xfer, false);
 }
 
 static void spi_qup_release_dma(struct spi_master *master)
@@ -908,6 +1031,7 @@ static int spi_qup_probe(struct platform_device *pdev)
 	pm_runtime_use_autosuspend(dev);
 	pm_runtime_set_active(dev);
 	pm_runtime_enable(dev);
+	device_enable_async_suspend(dev);
 
 	ret = devm_spi_register_master(dev, master);
 	if (ret)
@@ -116,6 +116,8 @@ struct pmic_arb_ver_ops;
  * @domain:		irq domain object for PMIC IRQ domain
  * @spmic:		SPMI controller object
  * @apid_to_ppid:	in-memory copy of APID -> PPID mapping table.
+ * @irq_descs:		mapped interrupts, by APID and interrupt bit, so that
+ *			the chained handler does not need a domain lookup.
  * @ver_ops:		version dependent operations.
  * @ppid_to_chan	in-memory copy of PPID -> channel (APID) mapping table.
  *			v2 only.
@@ -135,6 +137,7 @@ struct spmi_pmic_arb_dev {
 	struct irq_domain	*domain;
 	struct spmi_controller	*spmic;
 	u16			apid_to_ppid[256];
+	struct irq_desc		*irq_descs[PMIC_ARB_MAX_PERIPHS][8];
 	const struct pmic_arb_ver_ops *ver_ops;
 	u8			*ppid_to_chan;
 };
@@ -289,8 +292,8 @@ static int pmic_arb_cmd(struct spmi_controller *ctrl, u8 opc, u8 sid)
 	return pmic_arb->ver_ops->non_data_cmd(ctrl, opc, sid);
 }
 
-static int pmic_arb_read_cmd(struct spmi_controller *ctrl, u8 opc, u8 sid,
-			     u16 addr, u8 *buf, size_t len)
+static int pmic_arb_read_cmd_one(struct spmi_controller *ctrl, u8 opc,
+				 u8 sid, u16 addr, u8 *buf, size_t len)
 {
 	struct spmi_pmic_arb_dev *pmic_arb = spmi_controller_get_drvdata(ctrl);
 	unsigned long flags;
@@ -336,8 +339,32 @@ done:
 	return rc;
 }
 
-static int pmic_arb_write_cmd(struct spmi_controller *ctrl, u8 opc, u8 sid,
-			      u16 addr, const u8 *buf, size_t len)
+/*
+ * The arbiter moves at most PMIC_ARB_MAX_TRANS_BYTES per transaction, so
+ * longer accesses are split into maximal bursts here instead of failing.
+ */
+static int pmic_arb_read_cmd(struct spmi_controller *ctrl, u8 opc, u8 sid,
+			     u16 addr, u8 *buf, size_t len)
+{
+	size_t chunk;
+	int rc;
+
+	do {
+		chunk = min_t(size_t, len, PMIC_ARB_MAX_TRANS_BYTES);
+		rc = pmic_arb_read_cmd_one(ctrl, opc, sid, addr, buf, chunk);
+		if (rc)
+			return rc;
+
+		addr += chunk;
+		buf += chunk;
+		len -= chunk;
+	} while (len);
+
+	return 0;
+}
+
+static int pmic_arb_write_cmd_one(struct spmi_controller *ctrl, u8 opc,
+				  u8 sid, u16 addr, const u8 *buf, size_t len)
 {
 	struct spmi_pmic_arb_dev *pmic_arb = spmi_controller_get_drvdata(ctrl);
 	unsigned long flags;
@@ -383,6 +410,26 @@ static int pmic_arb_write_cmd(struct spmi_controller *ctrl, u8 opc, u8 sid,
 	return rc;
 }
 
+static int pmic_arb_write_cmd(struct spmi_controller *ctrl, u8 opc, u8 sid,
+			      u16 addr, const u8 *buf, size_t len)
+{
+	size_t chunk;
+	int rc;
+
+	do {
+		chunk = min_t(size_t, len, PMIC_ARB_MAX_TRANS_BYTES);
+		rc = pmic_arb_write_cmd_one(ctrl, opc, sid, addr, buf, chunk);
+		if (rc)
+			return rc;
+
+		addr += chunk;
+		buf += chunk;
+		len -= chunk;
+	} while (len);
+
+	return 0;
+}
+
 enum qpnpint_regs {
 	QPNPINT_REG_RT_STS		= 0x10,
 	QPNPINT_REG_SET_TYPE		= 0x11,
@@ -430,7 +477,7 @@ static void qpnpint_spmi_read(struct irq_data *d, u8 reg, void *buf, size_t len)
 
 static void periph_interrupt(struct spmi_pmic_arb_dev *pa, u8 apid)
 {
-	unsigned int irq;
+	struct irq_desc *desc;
 	u32 status;
 	int id;
 
@@ -438,11 +485,9 @@ static void periph_interrupt(struct spmi_pmic_arb_dev *pa, u8 apid)
 	while (status) {
 		id = ffs(status) - 1;
 		status &= ~(1 << id);
-		irq = irq_find_mapping(pa->domain,
-				       pa->apid_to_ppid[apid] << 16
-				     | id << 8
-				     | apid);
-		generic_handle_irq(irq);
+		desc = pa->irq_descs[apid][id];
+		if (desc)
+			generic_handle_irq_desc(desc);
 	}
 }
 
@@ -697,9 +742,19 @@ static int qpnpint_irq_domain_map(struct irq_domain *d,
 	irq_set_chip_and_handler(virq, &pmic_arb_irqchip, handle_level_irq);
 	irq_set_chip_data(virq, d->host_data);
 	irq_set_noprobe(virq);
+	pa->irq_descs[hwirq & 0xff][(hwirq >> 8) & 0x7] = irq_to_desc(virq);
 	return 0;
 }
 
+static void qpnpint_irq_domain_unmap(struct irq_domain *d, unsigned int virq)
+{
+	struct spmi_pmic_arb_dev *pa = d->host_data;
+	struct irq_data *data = irq_domain_get_irq_data(d, virq);
+	irq_hw_number_t hwirq = data->hwirq;
+
+	pa->irq_descs[hwirq & 0xff][(hwirq >> 8) & 0x7] = NULL;
+}
+
 /* v1 offset per ee */
 static u32 pmic_arb_offset_v1(struct spmi_pmic_arb_dev *pa, u8 sid, u16 addr)
 {
@@ -787,6 +842,7 @@ static const struct pmic_arb_ver_ops pmic_arb_v2 = {
 
 static const struct irq_domain_ops pmic_arb_irq_domain_ops = {
 	.map	= qpnpint_irq_domain_map,
+	.unmap	= qpnpint_irq_domain_unmap,
 	.xlate	= qpnpint_irq_domain_dt_translate,
 };
 
@@ -626,6 +626,15 @@ static ssize_t lio_target_nacl_info_show(struct config_item *item, char *page)
 			(max_cmd_sn - sess->exp_cmd_sn) + 1,
 			sess->exp_cmd_sn, max_cmd_sn,
 			sess->init_task_tag, sess->targ_xfer_tag);
+		if (se_sess->sess_cmd_map) {
+			struct percpu_ida_stats stats;
+
+			percpu_ida_get_stats(&se_sess->sess_tag_pool, &stats);
+			rb += sprintf(page+rb, "Tag pool: slow allocs %lu"
+				"  steals %lu  sleeps %lu  failed %lu\n",
+				stats.alloc_slow, stats.steals, stats.sleeps,
+				stats.failed);
+		}
 		rb += sprintf(page+rb, "----------------------[iSCSI"
 				" Connections]-------------------------\n");
 
@@ -270,6 +270,14 @@ int transport_alloc_session_tags(struct se_session *se_sess,
 		return -ENOMEM;
 	}
 
+	/*
+	 * Fabrics sleep in percpu_ida_alloc() when the session runs out of
+	 * tags. Wake them a few at a time once as many tags came back, like
+	 * blk-mq does, instead of all of them on every free.
+	 */
+	percpu_ida_set_wake_batch(&se_sess->sess_tag_pool,
+				  clamp(tag_num / 8, 1U, 8U));
+
 	return 0;
 }
 EXPORT_SYMBOL(transport_alloc_session_tags);
@@ -236,4 +236,6 @@ const struct tsens_ops ops_8974 = {
 	.init		= init_common,
 	.calibrate	= calibrate_8974,
 	.get_temp	= get_temp_common,
+	.set_trips	= set_trips_common,
+	.setup_irq	= setup_irq_common,
 };
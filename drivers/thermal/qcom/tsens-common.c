@@ -15,14 +15,27 @@
 #include <linux/platform_device.h>
 #include <linux/nvmem-consumer.h>
 #include <linux/err.h>
+#include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/of_address.h>
 #include <linux/regmap.h>
+#include <linux/thermal.h>
 #include "tsens.h"
 
+#define TM_INT_EN_ADDR		0x1000
+#define TM_INT_EN		BIT(0)
+#define SN_CTRL_ADDR		0x1004
+#define SN_LOW_THRESH_SHIFT	0
+#define SN_UP_THRESH_SHIFT	10
+#define SN_LOW_INT_CLEAR	BIT(20)
+#define SN_UP_INT_CLEAR		BIT(21)
+#define SN_CTRL_MASK		GENMASK(21, 0)
 #define S0_ST_ADDR		0x1030
 #define SN_ADDR_OFFSET		0x4
 #define SN_ST_TEMP_MASK		0x3ff
+#define SN_ST_LOWER		BIT(11)
+#define SN_ST_UPPER		BIT(12)
+#define MAX_SENSORS		16
 #define CAL_DEGC_PT1		30
 #define CAL_DEGC_PT2		120
 #define SLOPE_FACTOR		1000
@@ -90,6 +103,15 @@ static inline int code_to_degc(u32 adc_code, const struct tsens_sensor *s)
 	return degc;
 }
 
+static inline int degc_to_code(int degc, const struct tsens_sensor *s)
+{
+	int code;
+
+	code = (degc * (int)s->slope + s->offset) / SLOPE_FACTOR;
+
+	return clamp(code, 0, SN_ST_TEMP_MASK);
+}
+
 int get_temp_common(struct tsens_device *tmdev, int id, int *temp)
 {
 	struct tsens_sensor *s = &tmdev->sensor[id];
@@ -108,6 +130,106 @@ int get_temp_common(struct tsens_device *tmdev, int id, int *temp)
 	return 0;
 }
 
+/*
+ * Program the window of @s, leaving a side masked when the current reading
+ * @code is already past it, so a threshold that the thermal core did not
+ * move can't fire again and again.
+ */
+static int tsens_arm_trips(struct tsens_device *tmdev, struct tsens_sensor *s,
+			   u32 code)
+{
+	unsigned int addr = SN_CTRL_ADDR + s->hw_id * SN_ADDR_OFFSET;
+	u32 val = 0;
+
+	code &= SN_ST_TEMP_MASK;
+
+	if (s->low_code >= 0 && code > s->low_code)
+		val |= s->low_code << SN_LOW_THRESH_SHIFT;
+	else
+		val |= SN_LOW_INT_CLEAR;
+
+	if (s->up_code >= 0 && code < s->up_code)
+		val |= s->up_code << SN_UP_THRESH_SHIFT;
+	else
+		val |= SN_UP_INT_CLEAR;
+
+	return regmap_update_bits(tmdev->map, addr, SN_CTRL_MASK, val);
+}
+
+int set_trips_common(struct tsens_device *tmdev, int id, int low, int high)
+{
+	struct tsens_sensor *s = &tmdev->sensor[id];
+	u32 code;
+	int ret;
+
+	ret = regmap_read(tmdev->map, S0_ST_ADDR + s->hw_id * SN_ADDR_OFFSET,
+			  &code);
+	if (ret)
+		return ret;
+
+	mutex_lock(&tmdev->trip_lock);
+	s->low_code = low > -INT_MAX ? degc_to_code(low / 1000, s) : -1;
+	s->up_code = high < INT_MAX ? degc_to_code(high / 1000, s) : -1;
+	ret = tsens_arm_trips(tmdev, s, code);
+	mutex_unlock(&tmdev->trip_lock);
+
+	return ret;
+}
+
+static irqreturn_t tsens_irq_thread(int irq, void *data)
+{
+	struct tsens_device *tmdev = data;
+	struct tsens_sensor *s;
+	u32 status[MAX_SENSORS];
+	u32 code;
+	int i, n = 0;
+
+	for (i = 0; i < tmdev->num_sensors; i++)
+		n = max_t(int, n, tmdev->sensor[i].hw_id + 1);
+
+	/* One bulk read of all status registers instead of one per sensor */
+	if (regmap_bulk_read(tmdev->map, S0_ST_ADDR, status, n))
+		return IRQ_NONE;
+
+	for (i = 0; i < tmdev->num_sensors; i++) {
+		s = &tmdev->sensor[i];
+		if (!s->tzd)
+			continue;
+		if (!(status[s->hw_id] & (SN_ST_UPPER | SN_ST_LOWER)))
+			continue;
+
+		thermal_zone_device_update(s->tzd);
+
+		if (regmap_read(tmdev->map,
+				S0_ST_ADDR + s->hw_id * SN_ADDR_OFFSET, &code))
+			continue;
+
+		mutex_lock(&tmdev->trip_lock);
+		tsens_arm_trips(tmdev, s, code);
+		mutex_unlock(&tmdev->trip_lock);
+	}
+
+	return IRQ_HANDLED;
+}
+
+int setup_irq_common(struct tsens_device *tmdev)
+{
+	int i, ret;
+
+	for (i = 0; i < tmdev->num_sensors; i++)
+		if (tmdev->sensor[i].hw_id >= MAX_SENSORS)
+			return -EINVAL;
+
+	ret = devm_request_threaded_irq(tmdev->dev, tmdev->irq, NULL,
+					tsens_irq_thread, IRQF_ONESHOT,
+					dev_name(tmdev->dev), tmdev);
+	if (ret)
+		return ret;
+
+	return regmap_update_bits(tmdev->map, TM_INT_EN_ADDR, TM_INT_EN,
+				  TM_INT_EN);
+}
+
 static const struct regmap_config tsens_config = {
 	.reg_bits	= 32,
 	.val_bits	= 32,
@@ -15,6 +15,7 @@
 #include <linux/err.h>
 #include <linux/module.h>
 #include <linux/of.h>
+#include <linux/of_irq.h>
 #include <linux/platform_device.h>
 #include <linux/pm.h>
 #include <linux/slab.h>
@@ -40,6 +41,14 @@ static int tsens_get_trend(void *data, long *temp)
 	return -ENOSYS;
 }
 
+static int tsens_set_trips(void *data, int low, int high)
+{
+	const struct tsens_sensor *s = data;
+	struct tsens_device *tmdev = s->tmdev;
+
+	return tmdev->ops->set_trips(tmdev, s->id, low, high);
+}
+
 static int tsens_suspend(struct device *dev)
 {
 	struct tsens_device *tmdev = dev_get_drvdata(dev);
@@ -79,12 +88,23 @@ static const struct thermal_zone_of_device_ops tsens_of_ops = {
 	.get_trend = tsens_get_trend,
 };
 
+/* Sensors with a threshold interrupt don't need to be polled */
+static const struct thermal_zone_of_device_ops tsens_irq_of_ops = {
+	.get_temp = tsens_get_temp,
+	.get_trend = tsens_get_trend,
+	.set_trips = tsens_set_trips,
+};
+
 static int tsens_register(struct tsens_device *tmdev)
 {
 	int i, ret;
 	struct thermal_zone_device *tzd;
 	u32 *hw_id, n = tmdev->num_sensors;
 	struct device_node *np = tmdev->dev->of_node;
+	const struct thermal_zone_of_device_ops *of_ops = &tsens_of_ops;
+
+	if (tmdev->irq > 0)
+		of_ops = &tsens_irq_of_ops;
 
 	hw_id = devm_kcalloc(tmdev->dev, n, sizeof(u32), GFP_KERNEL);
 	if (!hw_id)
@@ -98,12 +118,23 @@ static int tsens_register(struct tsens_device *tmdev)
 			tmdev->sensor[i].hw_id = hw_id[i];
 		tmdev->sensor[i].tmdev = tmdev;
 		tmdev->sensor[i].id = i;
+		tmdev->sensor[i].low_code = -1;
+		tmdev->sensor[i].up_code = -1;
 		tzd = thermal_zone_of_sensor_register(tmdev->dev, i,
 						      &tmdev->sensor[i],
-						      &tsens_of_ops);
+						      of_ops);
 		if (IS_ERR(tzd))
 			continue;
 		tmdev->sensor[i].tzd = tzd;
+		/*
+		 * The window is armed by now, leave polling to the passive
+		 * delay while the zone is being throttled.
+		 */
+		if (tmdev->irq > 0) {
+			mutex_lock(&tzd->lock);
+			tzd->polling_delay = 0;
+			mutex_unlock(&tzd->lock);
+		}
 		if (tmdev->ops->enable)
 			tmdev->ops->enable(tmdev, i);
 	}
@@ -166,6 +197,25 @@ static int tsens_probe(struct platform_device *pdev)
 		return ret;
 	}
 
+	mutex_init(&tmdev->trip_lock);
+
+	/*
+	 * Arm the threshold interrupt before the zones get registered, they
+	 * program their first window as soon as they are enabled.
+	 */
+	if (tmdev->ops->set_trips && tmdev->ops->setup_irq) {
+		tmdev->irq = of_irq_get(np, 0);
+		if (tmdev->irq == -EPROBE_DEFER)
+			return tmdev->irq;
+		if (tmdev->irq > 0) {
+			ret = tmdev->ops->setup_irq(tmdev);
+			if (ret) {
+				dev_warn(dev, "no threshold irq, polling\n");
+				tmdev->irq = 0;
+			}
+		}
+	}
+
 	ret = tsens_register(tmdev);
 
 	platform_set_drvdata(pdev, tmdev);
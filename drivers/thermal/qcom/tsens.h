@@ -13,6 +13,8 @@
 #ifndef __QCOM_TSENS_H__
 #define __QCOM_TSENS_H__
 
+#include <linux/mutex.h>
+
 #define ONE_PT_CALIB		0x1
 #define ONE_PT_CALIB2		0x2
 #define TWO_PT_CALIB		0x3
@@ -27,6 +29,9 @@ struct tsens_sensor {
 	int				hw_id;
 	u32				slope;
 	u32				status;
+	/* threshold codes of the armed window, -1 when unbounded */
+	int				low_code;
+	int				up_code;
 };
 
 struct tsens_ops {
@@ -40,6 +45,8 @@ struct tsens_ops {
 	int (*suspend)(struct tsens_device *);
 	int (*resume)(struct tsens_device *);
 	int (*get_trend)(struct tsens_device *, int, long *);
+	int (*set_trips)(struct tsens_device *, int, int, int);
+	int (*setup_irq)(struct tsens_device *);
 };
 
 /* Registers to be saved/restored across a context loss */
@@ -55,6 +62,8 @@ struct tsens_device {
 	struct regmap_field		*status_field;
 	struct tsens_context		ctx;
 	bool				trdy;
+	int				irq;
+	struct mutex			trip_lock;
 	const struct tsens_ops		*ops;
 	struct tsens_sensor		sensor[0];
 };
@@ -63,6 +72,8 @@ char *qfprom_read(struct device *, const char *);
 void compute_intercept_slope(struct tsens_device *, u32 *, u32 *, u32);
 int init_common(struct tsens_device *);
 int get_temp_common(struct tsens_device *, int, int *);
+int set_trips_common(struct tsens_device *, int, int, int);
+int setup_irq_common(struct tsens_device *);
 
 extern const struct tsens_ops ops_8960, ops_8916, ops_8974;
 
@@ -27,6 +27,7 @@
 #include <linux/io.h>
 #include <linux/ioport.h>
 #include <linux/irq.h>
+#include <linux/scatterlist.h>
 #include <linux/init.h>
 #include <linux/console.h>
 #include <linux/tty.h>
@@ -46,6 +47,7 @@
 #define UARTDM_TX_AIGN(x)	((x) & ~0x3) /* valid for > 1p3 */
 #define UARTDM_TX_MAX		256   /* in bytes, valid for <= 1p3 */
 #define UARTDM_RX_SIZE		(UART_XMIT_SIZE / 4)
+#define UARTDM_CONS_SIZE	2048  /* per console buffer, valid for > 1p3 */
 
 enum {
 	UARTDM_1P1 = 1,
@@ -63,6 +65,19 @@ struct msm_dma {
 	u32			enable_bit;
 	unsigned int		count;
 	struct dma_async_tx_descriptor	*desc;
+	/* Tx: xmit buffer split at the wrap, nents is 0 for a console buffer */
+	struct scatterlist	sg[2];
+	int			nents;
+};
+
+/*
+ * Console output is staged in two coherent buffers: one is filled by
+ * msm_console_write() while tx_dma sends the other.
+ */
+struct msm_cons_buf {
+	unsigned char		*virt;
+	dma_addr_t		phys;
+	unsigned int		len;
 };
 
 struct msm_port {
@@ -76,6 +91,8 @@ struct msm_port {
 	bool			break_detected;
 	struct msm_dma		tx_dma;
 	struct msm_dma		rx_dma;
+	struct msm_cons_buf	cons[2];
+	unsigned int		cons_fill;
 };
 
 static void msm_handle_tx(struct uart_port *port);
@@ -103,13 +120,29 @@ void msm_stop_dma(struct uart_port *port, struct msm_dma *dma)
 	val &= ~dma->enable_bit;
 	msm_write(port, val, UARTDM_DMEN);
 
-	if (mapped)
+	if (!mapped)
+		return;
+
+	if (dma->dir == DMA_FROM_DEVICE)
 		dma_unmap_single(dev, dma->phys, mapped, dma->dir);
+	else if (dma->nents)
+		dma_unmap_sg(dev, dma->sg, dma->nents, dma->dir);
 }
 
 static void msm_release_dma(struct msm_port *msm_port)
 {
+	struct uart_port *port = &msm_port->uart;
 	struct msm_dma *dma;
+	unsigned char *cons_virt;
+	dma_addr_t cons_phys;
+	unsigned long flags;
+
+	/* Detach the console buffers before the channel goes away */
+	spin_lock_irqsave(&port->lock, flags);
+	cons_virt = msm_port->cons[0].virt;
+	cons_phys = msm_port->cons[0].phys;
+	memset(msm_port->cons, 0, sizeof(msm_port->cons));
+	spin_unlock_irqrestore(&port->lock, flags);
 
 	dma = &msm_port->tx_dma;
 	if (dma->chan) {
@@ -127,6 +160,38 @@ static void msm_release_dma(struct msm_port *msm_port)
 	}
 
 	memset(dma, 0, sizeof(*dma));
+
+	if (cons_virt)
+		dma_free_coherent(port->dev, 2 * UARTDM_CONS_SIZE, cons_virt,
+				  cons_phys);
+}
+
+static void msm_request_cons_dma(struct msm_port *msm_port)
+{
+	struct uart_port *port = &msm_port->uart;
+	unsigned char *virt;
+	dma_addr_t phys;
+	unsigned long flags;
+
+	/*
+	 * ADM transfers are limited to UARTDM_TX_MAX, too short for a
+	 * console line, so only BAM ports send the console by DMA.
+	 */
+	if (!uart_console(port) || msm_port->is_uartdm < UARTDM_1P4)
+		return;
+
+	virt = dma_alloc_coherent(port->dev, 2 * UARTDM_CONS_SIZE, &phys,
+				  GFP_KERNEL);
+	if (!virt)
+		return;
+
+	spin_lock_irqsave(&port->lock, flags);
+	msm_port->cons[0].virt = virt;
+	msm_port->cons[0].phys = phys;
+	msm_port->cons[1].virt = virt + UARTDM_CONS_SIZE;
+	msm_port->cons[1].phys = phys + UARTDM_CONS_SIZE;
+	msm_port->cons_fill = 0;
+	spin_unlock_irqrestore(&port->lock, flags);
 }
 
 static void msm_request_tx_dma(struct msm_port *msm_port, resource_size_t base)
@@ -164,6 +229,7 @@ static void msm_request_tx_dma(struct msm_port *msm_port, resource_size_t base)
 	else
 		dma->enable_bit = UARTDM_DMEN_TX_BAM_ENABLE;
 
+	msm_request_cons_dma(msm_port);
 	return;
 
 rel_tx:
@@ -258,27 +324,23 @@ static void msm_reset_dm_count(struct uart_port *port, int count)
 	msm_read(port, UARTDM_NCF_TX);
 }
 
-static void msm_complete_tx_dma(void *args)
+static int msm_start_cons_dma(struct msm_port *msm_port);
+
+/*
+ * Called with port->lock held, once the transfer on tx_dma is complete
+ * and @count characters of it have been sent.
+ */
+static void __msm_complete_tx_dma(struct msm_port *msm_port,
+				  unsigned int count)
 {
-	struct msm_port *msm_port = args;
 	struct uart_port *port = &msm_port->uart;
 	struct circ_buf *xmit = &port->state->xmit;
 	struct msm_dma *dma = &msm_port->tx_dma;
-	struct dma_tx_state state;
-	enum dma_status status;
-	unsigned long flags;
-	unsigned int count;
+	struct msm_cons_buf *cons;
 	u32 val;
 
-	spin_lock_irqsave(&port->lock, flags);
-
-	/* Already stopped */
-	if (!dma->count)
-		goto done;
-
-	status = dmaengine_tx_status(dma->chan, dma->cookie, &state);
-
-	dma_unmap_single(port->dev, dma->phys, dma->count, dma->dir);
+	if (dma->nents)
+		dma_unmap_sg(port->dev, dma->sg, dma->nents, dma->dir);
 
 	val = msm_read(port, UARTDM_DMEN);
 	val &= ~dma->enable_bit;
@@ -289,12 +351,16 @@ static void msm_complete_tx_dma(void *args)
 		msm_write(port, UART_CR_TX_ENABLE, UART_CR);
 	}
 
-	count = dma->count - state.residue;
-	port->icount.tx += count;
-	dma->count = 0;
+	if (dma->nents) {
+		port->icount.tx += count;
 
-	xmit->tail += count;
-	xmit->tail &= UART_XMIT_SIZE - 1;
+		xmit->tail += count;
+		xmit->tail &= UART_XMIT_SIZE - 1;
+	} else {
+		/* msm_start_cons_dma() already moved on to the other buffer */
+		msm_port->cons[msm_port->cons_fill ^ 1].len = 0;
+	}
+	dma->count = 0;
 
 	/* Restore "Tx FIFO below watermark" interrupt */
 	msm_port->imr |= UART_IMR_TXLEV;
@@ -303,35 +369,64 @@ static void msm_complete_tx_dma(void *args)
 	if (uart_circ_chars_pending(xmit) < WAKEUP_CHARS)
 		uart_write_wakeup(port);
 
-	msm_handle_tx(port);
+	/* Console output queued meanwhile goes first */
+	cons = &msm_port->cons[msm_port->cons_fill];
+	if (!cons->len || msm_start_cons_dma(msm_port))
+		msm_handle_tx(port);
+}
+
+static void msm_complete_tx_dma(void *args)
+{
+	struct msm_port *msm_port = args;
+	struct uart_port *port = &msm_port->uart;
+	struct msm_dma *dma = &msm_port->tx_dma;
+	struct dma_tx_state state;
+	unsigned long flags;
+
+	spin_lock_irqsave(&port->lock, flags);
+
+	/*
+	 * Already stopped, or already completed by msm_wait_tx_dma() and
+	 * the transfer in flight now is a later one.
+	 */
+	if (!dma->count ||
+	    dmaengine_tx_status(dma->chan, dma->cookie, &state) != DMA_COMPLETE)
+		goto done;
+
+	__msm_complete_tx_dma(msm_port, dma->count - state.residue);
 done:
 	spin_unlock_irqrestore(&port->lock, flags);
 }
 
-static int msm_handle_tx_dma(struct msm_port *msm_port, unsigned int count)
+/*
+ * Busy-wait for the transfer in flight on tx_dma and complete it, which
+ * may start the next one. Called with port->lock held.
+ *
+ * BAM only completes the cookie from its interrupt, which may be routed
+ * to this CPU, so poll the UART instead: TX_READY is set once it has
+ * taken all NCF_TX characters. The finished descriptor is then dropped
+ * with dmaengine_terminate_all() so its callback never runs.
+ */
+static void msm_wait_tx_dma(struct msm_port *msm_port)
 {
-	struct circ_buf *xmit = &msm_port->uart.state->xmit;
 	struct uart_port *port = &msm_port->uart;
 	struct msm_dma *dma = &msm_port->tx_dma;
-	void *cpu_addr;
-	int ret;
-	u32 val;
 
-	cpu_addr = &xmit->buf[xmit->tail];
+	while (!(msm_read(port, UART_ISR) & UART_ISR_TX_READY))
+		cpu_relax();
 
-	dma->phys = dma_map_single(port->dev, cpu_addr, count, dma->dir);
-	ret = dma_mapping_error(port->dev, dma->phys);
-	if (ret)
-		return ret;
+	dmaengine_terminate_all(dma->chan);
 
-	dma->desc = dmaengine_prep_slave_single(dma->chan, dma->phys,
-						count, DMA_MEM_TO_DEV,
-						DMA_PREP_INTERRUPT |
-						DMA_PREP_FENCE);
-	if (!dma->desc) {
-		ret = -EIO;
-		goto unmap;
-	}
+	__msm_complete_tx_dma(msm_port, dma->count);
+}
+
+/* Submit the prepared dma->desc and have the UART send @count characters */
+static int msm_submit_tx_dma(struct msm_port *msm_port, unsigned int count)
+{
+	struct uart_port *port = &msm_port->uart;
+	struct msm_dma *dma = &msm_port->tx_dma;
+	int ret;
+	u32 val;
 
 	dma->desc->callback = msm_complete_tx_dma;
 	dma->desc->callback_param = msm_port;
@@ -339,7 +434,7 @@ static int msm_handle_tx_dma(struct msm_port *msm_port, unsigned int count)
 	dma->cookie = dmaengine_submit(dma->desc);
 	ret = dma_submit_error(dma->cookie);
 	if (ret)
-		goto unmap;
+		return ret;
 
 	/*
 	 * Using DMA complete for Tx FIFO reload, no need for
@@ -363,8 +458,81 @@ static int msm_handle_tx_dma(struct msm_port *msm_port, unsigned int count)
 
 	dma_async_issue_pending(dma->chan);
 	return 0;
+}
+
+static int msm_handle_tx_dma(struct msm_port *msm_port, unsigned int count)
+{
+	struct circ_buf *xmit = &msm_port->uart.state->xmit;
+	struct uart_port *port = &msm_port->uart;
+	struct msm_dma *dma = &msm_port->tx_dma;
+	unsigned int first;
+	int mapped, ret;
+
+	/* One transfer covers the data on both sides of the wrap */
+	first = min_t(unsigned int, count, UART_XMIT_SIZE - xmit->tail);
+	dma->nents = first < count ? 2 : 1;
+
+	sg_init_table(dma->sg, dma->nents);
+	sg_set_buf(&dma->sg[0], &xmit->buf[xmit->tail], first);
+	if (first < count)
+		sg_set_buf(&dma->sg[1], xmit->buf, count - first);
+
+	mapped = dma_map_sg(port->dev, dma->sg, dma->nents, dma->dir);
+	if (!mapped)
+		return -ENOMEM;
+
+	dma->desc = dmaengine_prep_slave_sg(dma->chan, dma->sg, mapped,
+					    DMA_MEM_TO_DEV,
+					    DMA_PREP_INTERRUPT |
+					    DMA_PREP_FENCE);
+	if (!dma->desc) {
+		ret = -EIO;
+		goto unmap;
+	}
+
+	ret = msm_submit_tx_dma(msm_port, count);
+	if (ret)
+		goto unmap;
+
+	return 0;
 unmap:
-	dma_unmap_single(port->dev, dma->phys, count, dma->dir);
+	dma_unmap_sg(port->dev, dma->sg, dma->nents, dma->dir);
+	return ret;
+}
+
+/*
+ * Send the console buffer being filled and switch filling to the other
+ * one. On failure the buffered output is dropped.
+ */
+static int msm_start_cons_dma(struct msm_port *msm_port)
+{
+	struct msm_cons_buf *cons = &msm_port->cons[msm_port->cons_fill];
+	struct msm_dma *dma = &msm_port->tx_dma;
+	int ret;
+
+	/*
+	 * BAM moves whole words. The UART only sends the characters set
+	 * in NCF_TX, so the padding of the last word is never on the line.
+	 */
+	dma->desc = dmaengine_prep_slave_single(dma->chan, cons->phys,
+						ALIGN(cons->len, 4),
+						DMA_MEM_TO_DEV,
+						DMA_PREP_INTERRUPT |
+						DMA_PREP_FENCE);
+	if (!dma->desc) {
+		ret = -EIO;
+		goto drop;
+	}
+
+	dma->nents = 0;
+	ret = msm_submit_tx_dma(msm_port, cons->len);
+	if (ret)
+		goto drop;
+
+	msm_port->cons_fill ^= 1;
+	return 0;
+drop:
+	cons->len = 0;
 	return ret;
 }
 
@@ -702,10 +870,14 @@ static void msm_handle_tx(struct uart_port *port)
 	struct msm_port *msm_port = UART_TO_MSM(port);
 	struct circ_buf *xmit = &msm_port->uart.state->xmit;
 	struct msm_dma *dma = &msm_port->tx_dma;
-	unsigned int pio_count, dma_count, dma_min;
+	unsigned int pio_count, dma_count, dma_min, to_end;
 	void __iomem *tf;
 	int err = 0;
 
+	/* The completion of the transfer in flight sends the rest */
+	if (dma->count)
+		return;
+
 	if (port->x_char) {
 		if (msm_port->is_uartdm)
 			tf = port->membase + UARTDM_TF;
@@ -727,10 +899,14 @@ static void msm_handle_tx(struct uart_port *port)
 	}
 
 	pio_count = CIRC_CNT(xmit->head, xmit->tail, UART_XMIT_SIZE);
-	dma_count = CIRC_CNT_TO_END(xmit->head, xmit->tail, UART_XMIT_SIZE);
+	dma_count = pio_count;
+	to_end = CIRC_CNT_TO_END(xmit->head, xmit->tail, UART_XMIT_SIZE);
 
 	dma_min = 1;	/* Always DMA */
 	if (msm_port->is_uartdm > UARTDM_1P3) {
+		/* BAM moves whole words, so only wrap after a full one */
+		if (UARTDM_TX_AIGN(to_end) != to_end)
+			dma_count = to_end;
 		dma_count = UARTDM_TX_AIGN(dma_count);
 		dma_min = UARTDM_BURST_SIZE;
 	} else {
@@ -1363,8 +1539,9 @@ static inline struct uart_port *msm_get_port_from_line(unsigned int line)
 }
 
 #ifdef CONFIG_SERIAL_MSM_CONSOLE
-static void __msm_console_write(struct uart_port *port, const char *s,
-				unsigned int count, bool is_uartdm)
+/* Called with port->lock held */
+static void msm_console_write_pio(struct uart_port *port, const char *s,
+				  unsigned int count, bool is_uartdm)
 {
 	int i;
 	int num_newlines = 0;
@@ -1382,7 +1559,6 @@ static void __msm_console_write(struct uart_port *port, const char *s,
 			num_newlines++;
 	count += num_newlines;
 
-	spin_lock(&port->lock);
 	if (is_uartdm)
 		msm_reset_dm_count(port, count);
 
@@ -1418,21 +1594,83 @@ static void __msm_console_write(struct uart_port *port, const char *s,
 		iowrite32_rep(tf, buf, 1);
 		i += num_chars;
 	}
+}
+
+static void __msm_console_write(struct uart_port *port, const char *s,
+				unsigned int count, bool is_uartdm)
+{
+	spin_lock(&port->lock);
+	msm_console_write_pio(port, s, count, is_uartdm);
 	spin_unlock(&port->lock);
 }
 
+/*
+ * Queue console output for tx_dma, starting it if idle, so the caller does
+ * not wait for the UART. Called with port->lock held.
+ */
+static bool msm_console_write_dma(struct msm_port *msm_port, const char *s,
+				  unsigned int count)
+{
+	struct msm_dma *dma = &msm_port->tx_dma;
+	struct msm_cons_buf *cons;
+	unsigned int i, len = count;
+	unsigned char *p;
+
+	for (i = 0; i < count; i++)
+		if (s[i] == '\n')
+			len++;
+	if (len > UARTDM_CONS_SIZE)
+		return false;
+
+	/* Both buffers busy: wait for the one on the line */
+	cons = &msm_port->cons[msm_port->cons_fill];
+	while (cons->len + len > UARTDM_CONS_SIZE) {
+		if (!dma->count)
+			return false;
+		msm_wait_tx_dma(msm_port);
+		cons = &msm_port->cons[msm_port->cons_fill];
+	}
+
+	p = cons->virt + cons->len;
+	for (i = 0; i < count; i++) {
+		if (s[i] == '\n')
+			*p++ = '\r';
+		*p++ = s[i];
+	}
+	cons->len += len;
+
+	if (!dma->count)
+		return !msm_start_cons_dma(msm_port);
+	return true;
+}
+
 static void msm_console_write(struct console *co, const char *s,
 			      unsigned int count)
 {
 	struct uart_port *port;
 	struct msm_port *msm_port;
+	unsigned long flags;
 
 	BUG_ON(co->index < 0 || co->index >= UART_NR);
 
 	port = msm_get_port_from_line(co->index);
 	msm_port = UART_TO_MSM(port);
 
-	__msm_console_write(port, s, count, msm_port->is_uartdm);
+	if (!msm_port->cons[0].virt) {
+		__msm_console_write(port, s, count, msm_port->is_uartdm);
+		return;
+	}
+
+	spin_lock_irqsave(&port->lock, flags);
+	/* Check again, msm_release_dma() clears it under port->lock */
+	if (!msm_port->cons[0].virt ||
+	    oops_in_progress || !msm_console_write_dma(msm_port, s, count)) {
+		/* Oops output must be on the line when this returns */
+		while (msm_port->tx_dma.count)
+			msm_wait_tx_dma(msm_port);
+		msm_console_write_pio(port, s, count, msm_port->is_uartdm);
+	}
+	spin_unlock_irqrestore(&port->lock, flags);
 }
 
 static int __init msm_console_setup(struct console *co, char *options)
@@ -1597,6 +1835,7 @@ static int msm_serial_probe(struct platform_device *pdev)
 	port->irq = irq;
 
 	platform_set_drvdata(pdev, port);
+	device_enable_async_suspend(&pdev->dev);
 
 	return uart_add_one_port(&msm_uart_driver, port);
 }
@@ -437,6 +437,9 @@ struct dwc3_event_buffer {
 #define DWC3_TRB_NUM		32
 #define DWC3_TRB_MASK		(DWC3_TRB_NUM - 1)
 
+/* bulk and interrupt TRBs only interrupt every DWC3_TRB_IOC_INTERVAL */
+#define DWC3_TRB_IOC_INTERVAL	(DWC3_TRB_NUM / 4)
+
 /**
  * struct dwc3_ep - device side endpoint representation
  * @endpoint: usb endpoint
@@ -76,6 +76,8 @@ static int dwc3_qcom_probe(struct platform_device *pdev)
 		goto err_sleep;
 	}
 
+	device_enable_async_suspend(qdwc->dev);
+
 	ret = of_platform_populate(node, NULL, NULL, qdwc->dev);
 	if (ret) {
 		dev_err(qdwc->dev, "failed to register core - %d\n", ret);
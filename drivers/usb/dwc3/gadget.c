@@ -780,6 +780,7 @@ static void dwc3_prepare_one_trb(struct dwc3_ep *dep,
 		unsigned length, unsigned last, unsigned chain, unsigned node)
 {
 	struct dwc3_trb		*trb;
+	unsigned int		slot;
 
 	dwc3_trace(trace_dwc3_gadget, "%s: req %p dma %08llx length %d%s%s",
 			dep->name, req, (unsigned long long) dma,
@@ -787,7 +788,8 @@ static void dwc3_prepare_one_trb(struct dwc3_ep *dep,
 			chain ? " chain" : "");
 
 
-	trb = &dep->trb_pool[dep->free_slot & DWC3_TRB_MASK];
+	slot = dep->free_slot & DWC3_TRB_MASK;
+	trb = &dep->trb_pool[slot];
 
 	if (!req->trb) {
 		dwc3_gadget_move_request_queued(req);
@@ -830,14 +832,30 @@ static void dwc3_prepare_one_trb(struct dwc3_ep *dep,
 		BUG();
 	}
 
-	if (!req->request.no_interrupt && !chain)
-		trb->ctrl |= DWC3_TRB_CTRL_IOC;
-
 	if (usb_endpoint_xfer_isoc(dep->endpoint.desc)) {
+		if (!req->request.no_interrupt && !chain)
+			trb->ctrl |= DWC3_TRB_CTRL_IOC;
+
 		trb->ctrl |= DWC3_TRB_CTRL_ISP_IMI;
 		trb->ctrl |= DWC3_TRB_CTRL_CSP;
-	} else if (last) {
-		trb->ctrl |= DWC3_TRB_CTRL_LST;
+	} else if (!chain) {
+		/*
+		 * Requests prepared together complete together: only the
+		 * last TRB of the batch interrupts, plus one every
+		 * DWC3_TRB_IOC_INTERVAL TRBs so the ring is refilled with
+		 * an Update Transfer before it runs dry. The others are
+		 * given back when the next interrupting TRB completes.
+		 * A short packet ends an OUT request early, so it has to
+		 * interrupt as well.
+		 */
+		if (last || ((slot + 1) % DWC3_TRB_IOC_INTERVAL == 0 &&
+			     !req->request.no_interrupt))
+			trb->ctrl |= DWC3_TRB_CTRL_IOC;
+		else if (!dep->direction)
+			trb->ctrl |= DWC3_TRB_CTRL_ISP_IMI;
+
+		if (last)
+			trb->ctrl |= DWC3_TRB_CTRL_LST;
 	}
 
 	if (chain)
@@ -2636,6 +2654,7 @@ static irqreturn_t dwc3_process_event_buf(struct dwc3 *dwc, u32 buf)
 {
 	struct dwc3_event_buffer *evt;
 	irqreturn_t ret = IRQ_NONE;
+	int budget = DWC3_EVENT_BUFFERS_SIZE;
 	int left;
 	u32 reg;
 
@@ -2646,25 +2665,41 @@ static irqreturn_t dwc3_process_event_buf(struct dwc3 *dwc, u32 buf)
 		return IRQ_NONE;
 
 	while (left > 0) {
-		union dwc3_event event;
+		int count = left;
+
+		while (left > 0) {
+			union dwc3_event event;
 
-		event.raw = *(u32 *) (evt->buf + evt->lpos);
+			event.raw = *(u32 *) (evt->buf + evt->lpos);
 
-		dwc3_process_event_entry(dwc, &event);
+			dwc3_process_event_entry(dwc, &event);
+
+			/*
+			 * FIXME we wrap around correctly to the next entry as
+			 * almost all entries are 4 bytes in size. There is one
+			 * entry which has 12 bytes which is a regular entry
+			 * followed by 8 bytes data. ATM I don't know how
+			 * things are organized if we get next to the a
+			 * boundary so I worry about that once we try to handle
+			 * that.
+			 */
+			evt->lpos = (evt->lpos + 4) % DWC3_EVENT_BUFFERS_SIZE;
+			left -= 4;
+		}
+
+		dwc3_writel(dwc->regs, DWC3_GEVNTCOUNT(buf), count);
 
 		/*
-		 * FIXME we wrap around correctly to the next entry as
-		 * almost all entries are 4 bytes in size. There is one
-		 * entry which has 12 bytes which is a regular entry
-		 * followed by 8 bytes data. ATM I don't know how
-		 * things are organized if we get next to the a
-		 * boundary so I worry about that once we try to handle
-		 * that.
+		 * Events that came in meanwhile are handled in this run as
+		 * well, up to one buffer worth. Anything left over raises
+		 * the interrupt again once it is unmasked.
 		 */
-		evt->lpos = (evt->lpos + 4) % DWC3_EVENT_BUFFERS_SIZE;
-		left -= 4;
+		budget -= count;
+		if (budget <= 0)
+			break;
 
-		dwc3_writel(dwc->regs, DWC3_GEVNTCOUNT(buf), 4);
+		left = dwc3_readl(dwc->regs, DWC3_GEVNTCOUNT(buf));
+		left &= DWC3_GEVNTCOUNT_MASK;
 	}
 
 	evt->count = 0;
@@ -78,6 +78,7 @@ struct f_ncm {
 	bool				timer_force_tx;
 	struct tasklet_struct		tx_tasklet;
 	struct hrtimer			task_timer;
+	u32				tx_timeout_ns;
 
 	bool				timer_stopping;
 };
@@ -119,6 +120,14 @@ static inline unsigned ncm_bitrate(struct usb_gadget *g)
 /* Delay for the transmit to wait before sending an unfilled NTB frame. */
 #define TX_TIMEOUT_NSECS	300000
 
+/*
+ * The delay adapts to the traffic: a timeout that finds a single datagram
+ * means latency matters more than aggregation and the delay is halved,
+ * an NTB that fills up before the timeout doubles it.
+ */
+#define TX_TIMEOUT_MIN_NSECS	50000
+#define TX_TIMEOUT_MAX_NSECS	1000000
+
 #define FORMATS_SUPPORTED	(USB_CDC_NCM_NTB16_SUPPORTED |	\
 				 USB_CDC_NCM_NTB32_SUPPORTED)
 
@@ -989,6 +998,8 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		    div + rem + skb->len +
 		    ncm->skb_tx_ndp->len + ndp_align + (2 * dgram_idx_len))
 		    > max_size)) {
+			ncm->tx_timeout_ns = min_t(u32, ncm->tx_timeout_ns * 2,
+						   TX_TIMEOUT_MAX_NSECS);
 			skb2 = package_for_tx(ncm);
 			if (!skb2)
 				goto err;
@@ -1035,10 +1046,14 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 			/* Note: we skip opts->next_ndp_index */
 		}
 
-		/* Delay the timer. */
-		hrtimer_start(&ncm->task_timer,
-			      ktime_set(0, TX_TIMEOUT_NSECS),
-			      HRTIMER_MODE_REL);
+		/*
+		 * Delay the timer, unless the stack already has the next
+		 * frame lined up and the timer is armed anyway.
+		 */
+		if (!skb->xmit_more || !hrtimer_active(&ncm->task_timer))
+			hrtimer_start(&ncm->task_timer,
+				      ktime_set(0, ncm->tx_timeout_ns),
+				      HRTIMER_MODE_REL);
 
 		/* Add the datagram position entries */
 		ntb_ndp = (void *) skb_put(ncm->skb_tx_ndp, dgram_idx_len);
@@ -1064,6 +1079,9 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 
 	} else if (ncm->skb_tx_data && ncm->timer_force_tx) {
 		/* If the tx was requested because of a timeout then send */
+		if (ncm->ndp_dgram_count <= 2)
+			ncm->tx_timeout_ns = max_t(u32, ncm->tx_timeout_ns / 2,
+						   TX_TIMEOUT_MIN_NSECS);
 		skb2 = package_for_tx(ncm);
 		if (!skb2)
 			goto err;
@@ -1448,6 +1466,7 @@ static int ncm_bind(struct usb_configuration *c, struct usb_function *f)
 	tasklet_init(&ncm->tx_tasklet, ncm_tx_tasklet, (unsigned long) ncm);
 	hrtimer_init(&ncm->task_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 	ncm->task_timer.function = ncm_tx_timeout;
+	ncm->tx_timeout_ns = TX_TIMEOUT_NSECS;
 
 	DBG(cdev, "CDC Network: %s speed IN/%s OUT/%s NOTIFY/%s\n",
 			gadget_is_dualspeed(c->cdev->gadget) ? "dual" : "full",
@@ -2668,6 +2668,11 @@ int ext4_mb_init(struct super_block *sb)
 	if (ret != 0)
 		goto out_free_locality_groups;
 
+	/* also allocated without -o discard to allow enabling it on remount */
+	sbi->s_discard_queue = blk_alloc_discard_queue(sb->s_bdev, GFP_KERNEL);
+	if (IS_ERR(sbi->s_discard_queue))
+		sbi->s_discard_queue = NULL;
+
 	return 0;
 
 out_free_locality_groups:
@@ -2708,6 +2713,9 @@ int ext4_mb_release(struct super_block *sb)
 	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	struct kmem_cache *cachep = get_groupinfo_cache(sb->s_blocksize_bits);
 
+	blk_free_discard_queue(sbi->s_discard_queue);
+	sbi->s_discard_queue = NULL;
+
 	if (sbi->s_group_info) {
 		for (i = 0; i < ngroups; i++) {
 			grinfo = ext4_get_group_info(sb, i);
@@ -2751,6 +2759,9 @@ int ext4_mb_release(struct super_block *sb)
 		       "mballoc: %u preallocated, %u discarded",
 				atomic_read(&sbi->s_mb_preallocated),
 				atomic_read(&sbi->s_mb_discarded));
+		ext4_msg(sb, KERN_INFO,
+		       "mballoc: %u group lock contentions",
+				atomic_read(&sbi->s_bal_lock_contended));
 	}
 
 	free_percpu(sbi->s_locality_groups);
@@ -2758,9 +2769,16 @@ int ext4_mb_release(struct super_block *sb)
 	return 0;
 }
 
+/*
+ * With @async the discard is queued to be issued in the background, the
+ * allocator cancels it in case the blocks are reused before.
+ */
 static inline int ext4_issue_discard(struct super_block *sb,
-		ext4_group_t block_group, ext4_grpblk_t cluster, int count)
+		ext4_group_t block_group, ext4_grpblk_t cluster, int count,
+		bool async)
 {
+	struct blk_discard_queue *dq = EXT4_SB(sb)->s_discard_queue;
+	int shift = sb->s_blocksize_bits - 9;
 	ext4_fsblk_t discard_block;
 
 	discard_block = (EXT4_C2B(EXT4_SB(sb), cluster) +
@@ -2768,6 +2786,10 @@ static inline int ext4_issue_discard(struct super_block *sb,
 	count = EXT4_C2B(EXT4_SB(sb), count);
 	trace_ext4_discard_blocks(sb,
 			(unsigned long long) discard_block, count);
+	if (async && dq &&
+	    !blk_discard_queue_add(dq, (sector_t)discard_block << shift,
+				   (sector_t)count << shift, GFP_NOFS))
+		return 0;
 	return sb_issue_discard(sb, discard_block, count, GFP_NOFS, 0);
 }
 
@@ -2790,7 +2812,7 @@ static void ext4_free_data_callback(struct super_block *sb,
 	if (test_opt(sb, DISCARD)) {
 		err = ext4_issue_discard(sb, entry->efd_group,
 					 entry->efd_start_cluster,
-					 entry->efd_count);
+					 entry->efd_count, true);
 		if (err && err != -EOPNOTSUPP)
 			ext4_msg(sb, KERN_WARNING, "discard request in"
 				 " group:%d block:%d count:%d failed"
@@ -2941,6 +2963,11 @@ ext4_mb_mark_diskspace_used(struct ext4_allocation_context *ac,
 		goto out_err;
 	}
 
+	if (sbi->s_discard_queue)
+		blk_discard_queue_cancel(sbi->s_discard_queue,
+				(sector_t)block << (sb->s_blocksize_bits - 9),
+				(sector_t)len << (sb->s_blocksize_bits - 9));
+
 	ext4_lock_group(sb, ac->ac_b_ex.fe_group);
 #ifdef AGGRESSIVE_CHECK
 	{
@@ -4844,7 +4871,8 @@ do_more:
 		 * them with group lock_held
 		 */
 		if (test_opt(sb, DISCARD)) {
-			err = ext4_issue_discard(sb, block_group, bit, count);
+			err = ext4_issue_discard(sb, block_group, bit, count,
+						 false);
 			if (err && err != -EOPNOTSUPP)
 				ext4_msg(sb, KERN_WARNING, "discard request in"
 					 " group:%d block:%d count:%lu failed"
@@ -5067,7 +5095,7 @@ __acquires(bitlock)
 	 */
 	mb_mark_used(e4b, &ex);
 	ext4_unlock_group(sb, group);
-	ret = ext4_issue_discard(sb, group, start, count);
+	ret = ext4_issue_discard(sb, group, start, count, false);
 	ext4_lock_group(sb, group);
 	mb_free_blocks(NULL, e4b, start, ex.fe_len);
 	return ret;
@@ -1340,6 +1340,10 @@ static int is_dx_internal_node(struct inode *dir, ext4_lblk_t block,
  *
  * The returned buffer_head has ->b_count elevated.  The caller is expected
  * to brelse() it when appropriate.
+ *
+ * Nothing here depends on the caller holding the directory's i_mutex
+ * exclusively; concurrent lookups only share i_dir_start_lookup, which
+ * is a hint.
  */
 static struct buffer_head * ext4_find_entry (struct inode *dir,
 					const struct qstr *d_name,
@@ -1404,7 +1408,7 @@ static struct buffer_head * ext4_find_entry (struct inode *dir,
 			       "falling back\n"));
 	}
 	nblocks = dir->i_size >> EXT4_BLOCK_SIZE_BITS(sb);
-	start = EXT4_I(dir)->i_dir_start_lookup;
+	start = READ_ONCE(EXT4_I(dir)->i_dir_start_lookup);
 	if (start >= nblocks)
 		start = 0;
 	block = start;
@@ -1466,7 +1470,7 @@ restart:
 		i = search_dirblock(bh, dir, &fname, d_name,
 			    block << EXT4_BLOCK_SIZE_BITS(sb), res_dir);
 		if (i == 1) {
-			EXT4_I(dir)->i_dir_start_lookup = block;
+			WRITE_ONCE(EXT4_I(dir)->i_dir_start_lookup, block);
 			ret = bh;
 			goto cleanup_and_exit;
 		} else {
@@ -32,6 +32,7 @@ static struct extent_node *__attach_extent_node(struct f2fs_sb_info *sbi,
 		return NULL;
 
 	en->ei = *ei;
+	en->age = jiffies;
 	INIT_LIST_HEAD(&en->list);
 
 	rb_link_node(&en->rb_node, parent, p);
@@ -230,8 +231,10 @@ static bool f2fs_lookup_extent_tree(struct inode *inode, pgoff_t pgofs,
 	if (en) {
 		*ei = en->ei;
 		spin_lock(&sbi->extent_lock);
-		if (!list_empty(&en->list))
+		if (!list_empty(&en->list)) {
 			list_move_tail(&en->list, &sbi->extent_list);
+			en->age = jiffies;
+		}
 		et->cached_en = en;
 		spin_unlock(&sbi->extent_lock);
 		ret = true;
@@ -529,6 +532,7 @@ static unsigned int f2fs_update_extent_tree_range(struct inode *inode,
 				list_add_tail(&en1->list, &sbi->extent_list);
 			else
 				list_move_tail(&en1->list, &sbi->extent_list);
+			en1->age = jiffies;
 		}
 		if (den && !list_empty(&den->list))
 			list_del(&den->list);
@@ -546,13 +550,61 @@ static unsigned int f2fs_update_extent_tree_range(struct inode *inode,
 	return !__is_extent_same(&prev, &et->largest);
 }
 
-unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
+/*
+ * Unlink up to @nr_shrink extent nodes from the head of the LRU list, stopping
+ * at the first one used within the last @age jiffies if @age is not zero, and
+ * free them. Called with extent_tree_lock held for write.
+ */
+static unsigned int __shrink_lru_extent_nodes(struct f2fs_sb_info *sbi,
+					int nr_shrink, unsigned long age)
 {
 	struct extent_tree *treevec[EXT_TREE_VEC_SIZE];
 	struct extent_node *en, *tmp;
 	unsigned long ino = F2FS_ROOT_INO(sbi);
 	struct radix_tree_root *root = &sbi->extent_tree_root;
 	unsigned int found;
+	unsigned int node_cnt = 0;
+	int isolated = 0;
+
+	spin_lock(&sbi->extent_lock);
+	list_for_each_entry_safe(en, tmp, &sbi->extent_list, list) {
+		if (isolated >= nr_shrink)
+			break;
+		if (age && time_before(jiffies, en->age + age))
+			break;
+		list_del_init(&en->list);
+		isolated++;
+	}
+	spin_unlock(&sbi->extent_lock);
+
+	if (!isolated)
+		return 0;
+
+	while ((found = radix_tree_gang_lookup(root,
+				(void **)treevec, ino, EXT_TREE_VEC_SIZE))) {
+		unsigned i;
+
+		ino = treevec[found - 1]->ino + 1;
+		for (i = 0; i < found; i++) {
+			struct extent_tree *et = treevec[i];
+
+			write_lock(&et->lock);
+			node_cnt += __free_extent_tree(sbi, et, false);
+			write_unlock(&et->lock);
+
+			if (node_cnt >= isolated)
+				return node_cnt;
+		}
+	}
+	return node_cnt;
+}
+
+unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
+{
+	struct extent_tree *treevec[EXT_TREE_VEC_SIZE];
+	unsigned long ino = F2FS_ROOT_INO(sbi);
+	struct radix_tree_root *root = &sbi->extent_tree_root;
+	unsigned int found;
 	unsigned int node_cnt = 0, tree_cnt = 0;
 	int remained;
 
@@ -593,36 +645,7 @@ unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
 		goto out;
 
 	remained = nr_shrink - (node_cnt + tree_cnt);
-
-	spin_lock(&sbi->extent_lock);
-	list_for_each_entry_safe(en, tmp, &sbi->extent_list, list) {
-		if (!remained--)
-			break;
-		list_del_init(&en->list);
-	}
-	spin_unlock(&sbi->extent_lock);
-
-	/*
-	 * reset ino for searching victims from beginning of global extent tree.
-	 */
-	ino = F2FS_ROOT_INO(sbi);
-
-	while ((found = radix_tree_gang_lookup(root,
-				(void **)treevec, ino, EXT_TREE_VEC_SIZE))) {
-		unsigned i;
-
-		ino = treevec[found - 1]->ino + 1;
-		for (i = 0; i < found; i++) {
-			struct extent_tree *et = treevec[i];
-
-			write_lock(&et->lock);
-			node_cnt += __free_extent_tree(sbi, et, false);
-			write_unlock(&et->lock);
-
-			if (node_cnt + tree_cnt >= nr_shrink)
-				goto unlock_out;
-		}
-	}
+	node_cnt += __shrink_lru_extent_nodes(sbi, remained, 0);
 unlock_out:
 	up_write(&sbi->extent_tree_lock);
 out:
@@ -631,6 +654,30 @@ out:
 	return node_cnt + tree_cnt;
 }
 
+/*
+ * Drop the extent nodes which were not used for extent_age_interval seconds,
+ * oldest first. Unlike f2fs_shrink_extent_tree() this keeps the cache of
+ * files still being read however large it grows within the memory budget.
+ */
+unsigned int f2fs_age_extent_tree(struct f2fs_sb_info *sbi)
+{
+	unsigned long age = sbi->extent_age_interval * HZ;
+	unsigned int node_cnt;
+
+	if (!test_opt(sbi, EXTENT_CACHE) || !age)
+		return 0;
+
+	if (!down_write_trylock(&sbi->extent_tree_lock))
+		return 0;
+	node_cnt = __shrink_lru_extent_nodes(sbi, INT_MAX, age);
+	up_write(&sbi->extent_tree_lock);
+
+	stat_add_aged_node(sbi, node_cnt);
+	trace_f2fs_shrink_extent_tree(sbi, node_cnt, 0);
+
+	return node_cnt;
+}
+
 unsigned int f2fs_destroy_extent_node(struct inode *inode)
 {
 	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
@@ -724,6 +771,8 @@ void init_extent_cache_info(struct f2fs_sb_info *sbi)
 	spin_lock_init(&sbi->extent_lock);
 	sbi->total_ext_tree = 0;
 	atomic_set(&sbi->total_ext_node, 0);
+	sbi->extent_cache_ratio = DEF_EXTENT_CACHE_RATIO;
+	sbi->extent_age_interval = DEF_EXTENT_AGE_INTERVAL;
 }
 
 int __init create_extent_cache(void)
@@ -338,6 +338,12 @@ enum {
 /* number of extent info in extent cache we try to shrink */
 #define EXTENT_CACHE_SHRINK_NUMBER	128
 
+/* memory budget of extent cache in % of low memory */
+#define DEF_EXTENT_CACHE_RATIO		10
+
+/* extent nodes not used for this many seconds are dropped in background */
+#define DEF_EXTENT_AGE_INTERVAL		300
+
 struct extent_info {
 	unsigned int fofs;		/* start offset in a file */
 	u32 blk;			/* start block address of the extent */
@@ -348,6 +354,7 @@ struct extent_node {
 	struct rb_node rb_node;		/* rb node located in rb-tree */
 	struct list_head list;		/* node in global extent list of sbi */
 	struct extent_info ei;		/* extent info */
+	unsigned long age;		/* jiffies of the last use */
 };
 
 struct extent_tree {
@@ -618,6 +625,7 @@ struct f2fs_sm_info {
 	struct list_head discard_list;		/* 4KB discard list */
 	int nr_discards;			/* # of discards in the list */
 	int max_discards;			/* max. discards to be issued */
+	struct blk_discard_queue *dq;		/* deferred discards */
 
 	/* for batched trimming */
 	unsigned int trim_sections;		/* # of sections to trim */
@@ -753,6 +761,8 @@ struct f2fs_sb_info {
 	spinlock_t extent_lock;			/* locking extent lru list */
 	int total_ext_tree;			/* extent tree count */
 	atomic_t total_ext_node;		/* extent info count */
+	unsigned int extent_cache_ratio;	/* memory budget in % */
+	unsigned int extent_age_interval;	/* idle time to drop nodes */
 
 	/* basic filesystem units */
 	unsigned int log_sectors_per_block;	/* log2 sectors per block */
@@ -790,6 +800,9 @@ struct f2fs_sb_info {
 	/* maximum # of trials to find a victim segment for SSR and GC */
 	unsigned int max_victim_search;
 
+	/* maximum # of victim sections per foreground GC, 0 for no limit */
+	unsigned int fg_gc_max_secs;
+
 	/*
 	 * for stat information.
 	 * one is for the LFS mode, and the other is for the SSR mode.
@@ -803,6 +816,7 @@ struct f2fs_sb_info {
 	atomic64_t read_hit_rbtree;		/* # of hit rbtree extent node */
 	atomic64_t read_hit_largest;		/* # of hit largest extent node */
 	atomic64_t read_hit_cached;		/* # of hit cached extent node */
+	atomic64_t ext_node_aged;		/* # of aged out extent node */
 	atomic_t inline_xattr;			/* # of inline_xattr inodes */
 	atomic_t inline_inode;			/* # of inline_data inodes */
 	atomic_t inline_dir;			/* # of inline_dentry inodes */
@@ -1874,7 +1888,7 @@ struct f2fs_stat_info {
 	int all_area_segs, sit_area_segs, nat_area_segs, ssa_area_segs;
 	int main_area_segs, main_area_sections, main_area_zones;
 	unsigned long long hit_largest, hit_cached, hit_rbtree;
-	unsigned long long hit_total, total_ext;
+	unsigned long long hit_total, total_ext, ext_aged;
 	int ext_tree, ext_node;
 	int ndirty_node, ndirty_dent, ndirty_dirs, ndirty_meta;
 	int nats, dirty_nats, sits, dirty_sits, fnids;
@@ -1915,6 +1929,7 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 #define stat_inc_rbtree_node_hit(sbi)	(atomic64_inc(&(sbi)->read_hit_rbtree))
 #define stat_inc_largest_node_hit(sbi)	(atomic64_inc(&(sbi)->read_hit_largest))
 #define stat_inc_cached_node_hit(sbi)	(atomic64_inc(&(sbi)->read_hit_cached))
+#define stat_add_aged_node(sbi, cnt)	(atomic64_add(cnt, &(sbi)->ext_node_aged))
 #define stat_inc_inline_xattr(inode)					\
 	do {								\
 		if (f2fs_has_inline_xattr(inode))			\
@@ -1997,6 +2012,7 @@ void f2fs_destroy_root_stats(void);
 #define stat_inc_rbtree_node_hit(sb)
 #define stat_inc_largest_node_hit(sbi)
 #define stat_inc_cached_node_hit(sbi)
+#define stat_add_aged_node(sbi, cnt)
 #define stat_inc_inline_xattr(inode)
 #define stat_dec_inline_xattr(inode)
 #define stat_inc_inline_inode(inode)
@@ -2067,6 +2083,7 @@ void f2fs_leave_shrinker(struct f2fs_sb_info *);
  * extent_cache.c
  */
 unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *, int);
+unsigned int f2fs_age_extent_tree(struct f2fs_sb_info *);
 void f2fs_drop_largest_extent(struct inode *, pgoff_t);
 void f2fs_init_extent_tree(struct inode *, struct f2fs_extent *);
 unsigned int f2fs_destroy_extent_node(struct inode *);
@@ -24,14 +24,40 @@
 #include "gc.h"
 #include <trace/events/f2fs.h>
 
+/*
+ * Scale the sleep time of the GC thread with the free space and the idle
+ * time of the device: urgent_sleep_time once free segments are below
+ * urgent_ratio, otherwise proportional to the ratio of free segments, and
+ * halved if the device has been idle for idle_interval.
+ */
+static long gc_scale_sleep_time(struct f2fs_sb_info *sbi,
+			struct f2fs_gc_kthread *gc_th, long wait_ms, bool urgent)
+{
+	long sleep_ms;
+
+	if (wait_ms == gc_th->no_gc_sleep_time)
+		return wait_ms;
+
+	if (urgent)
+		return gc_th->urgent_sleep_time;
+
+	sleep_ms = div_u64((u64)wait_ms * free_segments(sbi), MAIN_SEGS(sbi));
+	if (gc_th->idle_since && time_after(jiffies, gc_th->idle_since +
+				msecs_to_jiffies(gc_th->idle_interval)))
+		sleep_ms /= 2;
+
+	return max_t(long, sleep_ms, gc_th->urgent_sleep_time);
+}
+
 static int gc_thread_func(void *data)
 {
 	struct f2fs_sb_info *sbi = data;
 	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
 	wait_queue_head_t *wq = &sbi->gc_thread->gc_wait_queue_head;
-	long wait_ms;
+	long wait_ms, sleep_ms;
+	bool urgent;
 
-	wait_ms = gc_th->min_sleep_time;
+	wait_ms = sleep_ms = gc_th->min_sleep_time;
 
 	do {
 		if (try_to_freeze())
@@ -39,12 +65,13 @@ static int gc_thread_func(void *data)
 		else
 			wait_event_interruptible_timeout(*wq,
 						kthread_should_stop(),
-						msecs_to_jiffies(wait_ms));
+						msecs_to_jiffies(sleep_ms));
 		if (kthread_should_stop())
 			break;
 
 		if (sbi->sb->s_writers.frozen >= SB_FREEZE_WRITE) {
 			increase_sleep_time(gc_th, &wait_ms);
+			sleep_ms = wait_ms;
 			continue;
 		}
 
@@ -60,14 +87,26 @@ static int gc_thread_func(void *data)
 		 * Because it is possible that some segments can be
 		 * invalidated soon after by user update or deletion.
 		 * So, I'd like to wait some time to collect dirty segments.
+		 *
+		 * Unless we are running out of free segments: then GC goes on
+		 * at a bounded rate even if IO is not idle, so that writers do
+		 * not end up stalling in foreground GC.
 		 */
 		if (!mutex_trylock(&sbi->gc_mutex))
 			continue;
 
-		if (!is_idle(sbi)) {
-			increase_sleep_time(gc_th, &wait_ms);
-			mutex_unlock(&sbi->gc_mutex);
-			continue;
+		urgent = gc_is_urgent(sbi, gc_th);
+		if (is_idle(sbi)) {
+			if (!gc_th->idle_since)
+				gc_th->idle_since = jiffies ? : 1;
+		} else {
+			gc_th->idle_since = 0;
+			if (!urgent) {
+				increase_sleep_time(gc_th, &wait_ms);
+				sleep_ms = wait_ms;
+				mutex_unlock(&sbi->gc_mutex);
+				continue;
+			}
 		}
 
 		if (has_enough_invalid_blocks(sbi))
@@ -81,7 +120,9 @@ static int gc_thread_func(void *data)
 		if (f2fs_gc(sbi, test_opt(sbi, FORCE_FG_GC)))
 			wait_ms = gc_th->no_gc_sleep_time;
 
-		trace_f2fs_background_gc(sbi->sb, wait_ms,
+		sleep_ms = gc_scale_sleep_time(sbi, gc_th, wait_ms, urgent);
+
+		trace_f2fs_background_gc(sbi->sb, sleep_ms,
 				prefree_segments(sbi), free_segments(sbi));
 
 		/* balancing f2fs's metadata periodically */
@@ -109,6 +150,11 @@ int start_gc_thread(struct f2fs_sb_info *sbi)
 
 	gc_th->gc_idle = 0;
 
+	gc_th->urgent_sleep_time = DEF_GC_THREAD_URGENT_SLEEP_TIME;
+	gc_th->urgent_ratio = DEF_GC_URGENT_RATIO;
+	gc_th->idle_interval = DEF_GC_IDLE_INTERVAL;
+	gc_th->idle_since = 0;
+
 	sbi->gc_thread = gc_th;
 	init_waitqueue_head(&sbi->gc_thread->gc_wait_queue_head);
 	sbi->gc_thread->f2fs_gc_task = kthread_run(gc_thread_func, sbi,
@@ -814,11 +860,25 @@ static int do_garbage_collect(struct f2fs_sb_info *sbi, unsigned int segno,
 	return nfree;
 }
 
+/*
+ * Foreground GC stops after fg_gc_max_secs victim sections and leaves the
+ * rest to the next f2fs_balance_fs(), so that a writer never stalls for
+ * long, unless free sections are already down to the reserved ones.
+ */
+static bool fg_gc_limit_reached(struct f2fs_sb_info *sbi, int gc_type,
+						unsigned int nr_victims)
+{
+	return gc_type == FG_GC && sbi->fg_gc_max_secs &&
+		nr_victims >= sbi->fg_gc_max_secs &&
+		free_sections(sbi) > reserved_sections(sbi);
+}
+
 int f2fs_gc(struct f2fs_sb_info *sbi, bool sync)
 {
 	unsigned int segno, i;
 	int gc_type = sync ? FG_GC : BG_GC;
 	int sec_freed = 0;
+	unsigned int nr_victims = 0;
 	int ret = -EINVAL;
 	struct cp_control cpc;
 	struct gc_inode_list gc_list = {
@@ -826,6 +886,9 @@ int f2fs_gc(struct f2fs_sb_info *sbi, bool sync)
 		.iroot = RADIX_TREE_INIT(GFP_NOFS),
 	};
 
+	trace_f2fs_gc_begin(sbi->sb, sync, gc_type, free_sections(sbi),
+				prefree_segments(sbi), reserved_sections(sbi));
+
 	cpc.reason = __get_cp_reason(sbi);
 gc_more:
 	segno = NULL_SEGNO;
@@ -862,12 +925,14 @@ gc_more:
 
 	if (i == sbi->segs_per_sec && gc_type == FG_GC)
 		sec_freed++;
+	nr_victims++;
 
 	if (gc_type == FG_GC)
 		sbi->cur_victim_sec = NULL_SEGNO;
 
 	if (!sync) {
-		if (has_not_enough_free_secs(sbi, sec_freed))
+		if (has_not_enough_free_secs(sbi, sec_freed) &&
+				!fg_gc_limit_reached(sbi, gc_type, nr_victims))
 			goto gc_more;
 
 		if (gc_type == FG_GC)
@@ -880,6 +945,9 @@ stop:
 
 	if (sync)
 		ret = sec_freed ? 0 : -EAGAIN;
+
+	trace_f2fs_gc_end(sbi->sb, ret, gc_type, nr_victims, sec_freed,
+				free_sections(sbi), prefree_segments(sbi));
 	return ret;
 }
 
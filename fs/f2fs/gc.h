@@ -16,6 +16,10 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define DEF_GC_THREAD_URGENT_SLEEP_TIME	500	/* 500 ms */
+#define DEF_GC_URGENT_RATIO		10	/* % of free main segments */
+#define DEF_GC_IDLE_INTERVAL		5000	/* ms the device is idle */
+#define DEF_FG_GC_MAX_SECTIONS		4	/* victims per foreground GC */
 #define LIMIT_INVALID_BLOCK	40 /* percentage over total user space */
 #define LIMIT_FREE_BLOCK	40 /* percentage over invalid + free space */
 
@@ -33,6 +37,16 @@ struct f2fs_gc_kthread {
 
 	/* for changing gc mode */
 	unsigned int gc_idle;
+
+	/*
+	 * for urgency: below urgent_ratio % of free segments the thread cleans
+	 * every urgent_sleep_time even if the device is busy, and it cleans
+	 * faster once the device has been idle for idle_interval
+	 */
+	unsigned int urgent_sleep_time;
+	unsigned int urgent_ratio;
+	unsigned int idle_interval;
+	unsigned long idle_since;	/* jiffies, 0 if not idle */
 };
 
 struct gc_inode_list {
@@ -101,6 +115,13 @@ static inline bool has_enough_invalid_blocks(struct f2fs_sb_info *sbi)
 	return false;
 }
 
+static inline bool gc_is_urgent(struct f2fs_sb_info *sbi,
+					struct f2fs_gc_kthread *gc_th)
+{
+	return (u64)free_segments(sbi) * 100 <
+			(u64)gc_th->urgent_ratio * MAIN_SEGS(sbi);
+}
+
 static inline int is_idle(struct f2fs_sb_info *sbi)
 {
 	struct block_device *bdev = sbi->sb->s_bdev;
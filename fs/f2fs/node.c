@@ -68,7 +68,7 @@ bool available_free_memory(struct f2fs_sb_info *sbi, int type)
 		mem_size = (sbi->total_ext_tree * sizeof(struct extent_tree) +
 				atomic_read(&sbi->total_ext_node) *
 				sizeof(struct extent_node)) >> PAGE_CACHE_SHIFT;
-		res = mem_size < ((avail_ram * nm_i->ram_thresh / 100) >> 1);
+		res = mem_size < (avail_ram * sbi->extent_cache_ratio / 100);
 	} else {
 		if (sbi->sb->s_bdi->wb.dirty_exceeded)
 			return false;
@@ -295,9 +295,14 @@ void f2fs_balance_fs(struct f2fs_sb_info *sbi)
 
 void f2fs_balance_fs_bg(struct f2fs_sb_info *sbi)
 {
-	/* try to shrink extent cache when there is no enough memory */
+	/*
+	 * try to shrink extent cache when there is no enough memory,
+	 * otherwise only drop the extents which went idle
+	 */
 	if (!available_free_memory(sbi, EXTENT_CACHE))
 		f2fs_shrink_extent_tree(sbi, EXTENT_CACHE_SHRINK_NUMBER);
+	else
+		f2fs_age_extent_tree(sbi);
 
 	/* check the # of cached NAT entries */
 	if (!available_free_memory(sbi, NAT_ENTRIES))
@@ -494,8 +499,9 @@ static void locate_dirty_segment(struct f2fs_sb_info *sbi, unsigned int segno)
 }
 
 static int f2fs_issue_discard(struct f2fs_sb_info *sbi,
-				block_t blkstart, block_t blklen)
+				block_t blkstart, block_t blklen, bool async)
 {
+	struct blk_discard_queue *dq = SM_I(sbi)->dq;
 	sector_t start = SECTOR_FROM_BLOCK(blkstart);
 	sector_t len = SECTOR_FROM_BLOCK(blklen);
 	struct seg_entry *se;
@@ -510,6 +516,8 @@ static int f2fs_issue_discard(struct f2fs_sb_info *sbi,
 			sbi->discard_blks--;
 	}
 	trace_f2fs_issue_discard(sbi->sb, blkstart, blklen);
+	if (async && dq && !blk_discard_queue_add(dq, start, len, GFP_NOFS))
+		return 0;
 	return blkdev_issue_discard(sbi->sb->s_bdev, start, len, GFP_NOFS, 0);
 }
 
@@ -525,7 +533,8 @@ bool discard_next_dnode(struct f2fs_sb_info *sbi, block_t blkaddr)
 		if (f2fs_test_bit(offset, se->discard_map))
 			return false;
 
-		err = f2fs_issue_discard(sbi, blkaddr, 1);
+		/* the block is written right after, don't defer it */
+		err = f2fs_issue_discard(sbi, blkaddr, 1, false);
 	}
 
 	if (err) {
@@ -650,7 +659,7 @@ void clear_prefree_segments(struct f2fs_sb_info *sbi, struct cp_control *cpc)
 			continue;
 
 		f2fs_issue_discard(sbi, START_BLOCK(sbi, start),
-				(end - start) << sbi->log_blocks_per_seg);
+				(end - start) << sbi->log_blocks_per_seg, true);
 	}
 	mutex_unlock(&dirty_i->seglist_lock);
 
@@ -658,7 +667,7 @@ void clear_prefree_segments(struct f2fs_sb_info *sbi, struct cp_control *cpc)
 	list_for_each_entry_safe(entry, this, head, list) {
 		if (cpc->reason == CP_DISCARD && entry->len < cpc->trim_minlen)
 			goto skip;
-		f2fs_issue_discard(sbi, entry->blkaddr, entry->len);
+		f2fs_issue_discard(sbi, entry->blkaddr, entry->len, true);
 		cpc->trimmed += entry->len;
 skip:
 		list_del(&entry->list);
@@ -1167,6 +1176,8 @@ int f2fs_trim_fs(struct f2fs_sb_info *sbi, struct fstrim_range *range)
 		write_checkpoint(sbi, &cpc);
 		mutex_unlock(&sbi->gc_mutex);
 	}
+	if (SM_I(sbi)->dq)
+		blk_discard_queue_flush(SM_I(sbi)->dq);
 out:
 	range->len = F2FS_BLK_TO_BYTES(cpc.trimmed);
 	return 0;
@@ -1286,6 +1297,12 @@ void allocate_data_block(struct f2fs_sb_info *sbi, struct page *page,
 		fill_node_footer_blkaddr(page, NEXT_FREE_BLKADDR(sbi, curseg));
 
 	mutex_unlock(&curseg->curseg_mutex);
+
+	/* the block may still have a deferred discard of its last life */
+	if (SM_I(sbi)->dq)
+		blk_discard_queue_cancel(SM_I(sbi)->dq,
+				SECTOR_FROM_BLOCK(*new_blkaddr),
+				SECTOR_FROM_BLOCK(1));
 }
 
 static void do_write_page(struct f2fs_summary *sum, struct f2fs_io_info *fio)
@@ -2309,6 +2326,11 @@ int build_segment_manager(struct f2fs_sb_info *sbi)
 	sm_info->nr_discards = 0;
 	sm_info->max_discards = 0;
 
+	/* kept even without -o discard to allow enabling it on remount */
+	sm_info->dq = blk_alloc_discard_queue(sbi->sb->s_bdev, GFP_KERNEL);
+	if (IS_ERR(sm_info->dq))
+		sm_info->dq = NULL;
+
 	sm_info->trim_sections = DEF_BATCHED_TRIM_SECTIONS;
 
 	INIT_LIST_HEAD(&sm_info->sit_entry_set);
@@ -2431,6 +2453,7 @@ void destroy_segment_manager(struct f2fs_sb_info *sbi)
 
 	if (!sm_info)
 		return;
+	blk_free_discard_queue(sm_info->dq);
 	destroy_flush_cmd_control(sbi);
 	destroy_dirty_segmap(sbi);
 	destroy_curseg(sbi);
@@ -15,6 +15,7 @@
 #include <linux/pagemap.h>
 #include <linux/sched.h>
 #include <linux/fsnotify.h>
+#include <linux/hash.h>
 
 #include "kernfs-internal.h"
 
@@ -28,9 +29,36 @@
  * filp->private_data points to seq_file whose ->private points to
  * kernfs_open_file.  kernfs_open_files are chained at
  * kernfs_open_node->files, which is protected by kernfs_open_file_mutex.
+ *
+ * Both locks are hashed on the kernfs_node so that opening and closing
+ * unrelated files, e.g. by tools polling many sysfs attributes, does not
+ * serialize on a single lock.
  */
-static DEFINE_SPINLOCK(kernfs_open_node_lock);
-static DEFINE_MUTEX(kernfs_open_file_mutex);
+#define KERNFS_OPEN_LOCK_BITS	(ilog2(NR_CPUS < 32 ? NR_CPUS : 32) + 1)
+#define KERNFS_OPEN_LOCKS	(1 << KERNFS_OPEN_LOCK_BITS)
+
+static spinlock_t kernfs_open_node_locks[KERNFS_OPEN_LOCKS];
+static struct mutex kernfs_open_file_mutexes[KERNFS_OPEN_LOCKS];
+
+static spinlock_t *kernfs_open_node_lock(struct kernfs_node *kn)
+{
+	return &kernfs_open_node_locks[hash_ptr(kn, KERNFS_OPEN_LOCK_BITS)];
+}
+
+static struct mutex *kernfs_open_file_mutex(struct kernfs_node *kn)
+{
+	return &kernfs_open_file_mutexes[hash_ptr(kn, KERNFS_OPEN_LOCK_BITS)];
+}
+
+void __init kernfs_file_init(void)
+{
+	int i;
+
+	for (i = 0; i < KERNFS_OPEN_LOCKS; i++) {
+		spin_lock_init(&kernfs_open_node_locks[i]);
+		mutex_init(&kernfs_open_file_mutexes[i]);
+	}
+}
 
 struct kernfs_open_node {
 	atomic_t		refcnt;
@@ -541,8 +569,8 @@ static int kernfs_get_open_node(struct kernfs_node *kn,
 	struct kernfs_open_node *on, *new_on = NULL;
 
  retry:
-	mutex_lock(&kernfs_open_file_mutex);
-	spin_lock_irq(&kernfs_open_node_lock);
+	mutex_lock(kernfs_open_file_mutex(kn));
+	spin_lock_irq(kernfs_open_node_lock(kn));
 
 	if (!kn->attr.open && new_on) {
 		kn->attr.open = new_on;
@@ -555,8 +583,8 @@ static int kernfs_get_open_node(struct kernfs_node *kn,
 		list_add_tail(&of->list, &on->files);
 	}
 
-	spin_unlock_irq(&kernfs_open_node_lock);
-	mutex_unlock(&kernfs_open_file_mutex);
+	spin_unlock_irq(kernfs_open_node_lock(kn));
+	mutex_unlock(kernfs_open_file_mutex(kn));
 
 	if (on) {
 		kfree(new_on);
@@ -592,8 +620,8 @@ static void kernfs_put_open_node(struct kernfs_node *kn,
 	struct kernfs_open_node *on = kn->attr.open;
 	unsigned long flags;
 
-	mutex_lock(&kernfs_open_file_mutex);
-	spin_lock_irqsave(&kernfs_open_node_lock, flags);
+	mutex_lock(kernfs_open_file_mutex(kn));
+	spin_lock_irqsave(kernfs_open_node_lock(kn), flags);
 
 	if (of)
 		list_del(&of->list);
@@ -603,8 +631,8 @@ static void kernfs_put_open_node(struct kernfs_node *kn,
 	else
 		on = NULL;
 
-	spin_unlock_irqrestore(&kernfs_open_node_lock, flags);
-	mutex_unlock(&kernfs_open_file_mutex);
+	spin_unlock_irqrestore(kernfs_open_node_lock(kn), flags);
+	mutex_unlock(kernfs_open_file_mutex(kn));
 
 	kfree(on);
 }
@@ -747,20 +775,20 @@ void kernfs_unmap_bin_file(struct kernfs_node *kn)
 	if (!(kn->flags & KERNFS_HAS_MMAP))
 		return;
 
-	spin_lock_irq(&kernfs_open_node_lock);
+	spin_lock_irq(kernfs_open_node_lock(kn));
 	on = kn->attr.open;
 	if (on)
 		atomic_inc(&on->refcnt);
-	spin_unlock_irq(&kernfs_open_node_lock);
+	spin_unlock_irq(kernfs_open_node_lock(kn));
 	if (!on)
 		return;
 
-	mutex_lock(&kernfs_open_file_mutex);
+	mutex_lock(kernfs_open_file_mutex(kn));
 	list_for_each_entry(of, &on->files, list) {
 		struct inode *inode = file_inode(of->file);
 		unmap_mapping_range(inode->i_mapping, 0, 0, 1);
 	}
-	mutex_unlock(&kernfs_open_file_mutex);
+	mutex_unlock(kernfs_open_file_mutex(kn));
 
 	kernfs_put_open_node(kn, NULL);
 }
@@ -819,7 +847,7 @@ repeat:
 	spin_unlock_irq(&kernfs_notify_lock);
 
 	/* kick poll */
-	spin_lock_irq(&kernfs_open_node_lock);
+	spin_lock_irq(kernfs_open_node_lock(kn));
 
 	on = kn->attr.open;
 	if (on) {
@@ -827,7 +855,7 @@ repeat:
 		wake_up_interruptible(&on->poll);
 	}
 
-	spin_unlock_irq(&kernfs_open_node_lock);
+	spin_unlock_irq(kernfs_open_node_lock(kn));
 
 	/* kick fsnotify */
 	mutex_lock(&kernfs_mutex);
@@ -98,6 +98,7 @@ enum {
 	Opt_acregmin, Opt_acregmax,
 	Opt_acdirmin, Opt_acdirmax,
 	Opt_actimeo,
+	Opt_nconnect,
 	Opt_namelen,
 	Opt_mountport,
 	Opt_mountvers,
@@ -163,6 +164,7 @@ static const match_table_t nfs_mount_option_tokens = {
 	{ Opt_acdirmin, "acdirmin=%s" },
 	{ Opt_acdirmax, "acdirmax=%s" },
 	{ Opt_actimeo, "actimeo=%s" },
+	{ Opt_nconnect, "nconnect=%s" },
 	{ Opt_namelen, "namlen=%s" },
 	{ Opt_mountport, "mountport=%s" },
 	{ Opt_mountvers, "mountvers=%s" },
@@ -682,6 +684,8 @@ static void nfs_show_mount_options(struct seq_file *m, struct nfs_server *nfss,
 
 	seq_printf(m, ",timeo=%lu", 10U * nfss->client->cl_timeout->to_initval / HZ);
 	seq_printf(m, ",retrans=%u", nfss->client->cl_timeout->to_retries);
+	if (nfss->nfs_client->cl_nconnect > 1)
+		seq_printf(m, ",nconnect=%u", nfss->nfs_client->cl_nconnect);
 	seq_printf(m, ",sec=%s", nfs_pseudoflavour_to_name(nfss->client->cl_auth->au_flavor));
 
 	if (version != 4)
@@ -1187,6 +1191,19 @@ static int nfs_get_option_ul(substring_t args[], unsigned long *option)
 	return rc;
 }
 
+static int nfs_get_option_ul_bound(substring_t args[], unsigned long *option,
+		unsigned long l_bound, unsigned long u_bound)
+{
+	int ret;
+
+	ret = nfs_get_option_ul(args, option);
+	if (ret != 0)
+		return ret;
+	if (*option < l_bound || *option > u_bound)
+		return -ERANGE;
+	return 0;
+}
+
 /*
  * Error-check and convert a string of mount options from user space into
  * a data structure.  The whole mount string is processed; bad options are
@@ -1385,6 +1402,12 @@ static int nfs_parse_mount_options(char *raw,
 			mnt->acregmin = mnt->acregmax =
 			mnt->acdirmin = mnt->acdirmax = option;
 			break;
+		case Opt_nconnect:
+			if (nfs_get_option_ul_bound(args, &option,
+						    1, RPC_MAX_XPRTS))
+				goto out_invalid_value;
+			mnt->nfs_server.nconnect = option;
+			break;
 		case Opt_namelen:
 			if (nfs_get_option_ul(args, &option))
 				goto out_invalid_value;
@@ -87,6 +87,8 @@ static int ovl_copy_up_data(struct path *old, struct path *new, loff_t len)
 	struct file *new_file;
 	loff_t old_pos = 0;
 	loff_t new_pos = 0;
+	loff_t data_pos = -1;
+	bool skip_hole = false;
 	int error = 0;
 
 	if (len == 0)
@@ -102,7 +104,13 @@ static int ovl_copy_up_data(struct path *old, struct path *new, loff_t len)
 		goto out_fput;
 	}
 
-	/* FIXME: copy up sparse files efficiently */
+	/*
+	 * Holes of the lower file are not copied, the size of the upper file
+	 * is set by the caller. This needs SEEK_DATA support on the lower fs.
+	 */
+	if ((old_file->f_mode & FMODE_LSEEK) && old_file->f_op->llseek)
+		skip_hole = true;
+
 	while (len) {
 		size_t this_len = OVL_COPY_UP_CHUNK_SIZE;
 		long bytes;
@@ -115,6 +123,20 @@ static int ovl_copy_up_data(struct path *old, struct path *new, loff_t len)
 			break;
 		}
 
+		if (skip_hole && data_pos < old_pos) {
+			data_pos = vfs_llseek(old_file, old_pos, SEEK_DATA);
+			if (data_pos > old_pos) {
+				len -= data_pos - old_pos;
+				old_pos = new_pos = data_pos;
+				continue;
+			} else if (data_pos == -ENXIO) {
+				/* Only a hole is left */
+				break;
+			} else if (data_pos < 0) {
+				skip_hole = false;
+			}
+		}
+
 		bytes = do_splice_direct(old_file, &old_pos,
 					 new_file, &new_pos,
 					 this_len, SPLICE_F_MOVE);
@@ -249,7 +271,17 @@ static int ovl_copy_up_locked(struct dentry *workdir, struct dentry *upperdir,
 		goto out_cleanup;
 
 	mutex_lock(&newdentry->d_inode->i_mutex);
-	err = ovl_set_attr(newdentry, stat);
+	if (S_ISREG(stat->mode)) {
+		/* Trailing holes were not copied */
+		struct iattr attr = {
+			.ia_valid = ATTR_SIZE,
+			.ia_size = stat->size,
+		};
+
+		err = notify_change(newdentry, &attr, NULL);
+	}
+	if (!err)
+		err = ovl_set_attr(newdentry, stat);
 	mutex_unlock(&newdentry->d_inode->i_mutex);
 	if (err)
 		goto out_cleanup;
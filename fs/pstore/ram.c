@@ -51,6 +51,11 @@ static ulong ramoops_ftrace_size = MIN_MEM_SIZE;
 module_param_named(ftrace_size, ramoops_ftrace_size, ulong, 0400);
 MODULE_PARM_DESC(ftrace_size, "size of ftrace log");
 
+static bool ramoops_ftrace_per_cpu;
+module_param_named(ftrace_per_cpu, ramoops_ftrace_per_cpu, bool, 0400);
+MODULE_PARM_DESC(ftrace_per_cpu,
+		"split the ftrace log in one zone per CPU (default 0)");
+
 static ulong ramoops_pmsg_size = MIN_MEM_SIZE;
 module_param_named(pmsg_size, ramoops_pmsg_size, ulong, 0400);
 MODULE_PARM_DESC(pmsg_size, "size of user space message log");
@@ -85,7 +90,7 @@ MODULE_PARM_DESC(ramoops_ecc,
 struct ramoops_context {
 	struct persistent_ram_zone **przs;
 	struct persistent_ram_zone *cprz;
-	struct persistent_ram_zone *fprz;
+	struct persistent_ram_zone **fprzs;
 	struct persistent_ram_zone *mprz;
 	phys_addr_t phys_addr;
 	unsigned long size;
@@ -95,8 +100,10 @@ struct ramoops_context {
 	size_t ftrace_size;
 	size_t pmsg_size;
 	int dump_oops;
+	unsigned long flags;
 	struct persistent_ram_ecc_info ecc_info;
 	unsigned int max_dump_cnt;
+	unsigned int max_ftrace_cnt;
 	unsigned int dump_write_cnt;
 	/* _read_cnt need clear on ramoops_pstore_open */
 	unsigned int dump_read_cnt;
@@ -217,9 +224,10 @@ static ssize_t ramoops_pstore_read(u64 *id, enum pstore_type_id *type,
 	if (!prz_ok(prz))
 		prz = ramoops_get_next_prz(&cxt->cprz, &cxt->console_read_cnt,
 					   1, id, type, PSTORE_TYPE_CONSOLE, 0);
-	if (!prz_ok(prz))
-		prz = ramoops_get_next_prz(&cxt->fprz, &cxt->ftrace_read_cnt,
-					   1, id, type, PSTORE_TYPE_FTRACE, 0);
+	while (cxt->ftrace_read_cnt < cxt->max_ftrace_cnt && !prz_ok(prz))
+		prz = ramoops_get_next_prz(cxt->fprzs, &cxt->ftrace_read_cnt,
+					   cxt->max_ftrace_cnt, id, type,
+					   PSTORE_TYPE_FTRACE, 0);
 	if (!prz_ok(prz))
 		prz = ramoops_get_next_prz(&cxt->mprz, &cxt->pmsg_read_cnt,
 					   1, id, type, PSTORE_TYPE_PMSG, 0);
@@ -281,9 +289,14 @@ static int notrace ramoops_pstore_write_buf(enum pstore_type_id type,
 		persistent_ram_write(cxt->cprz, buf, size);
 		return 0;
 	} else if (type == PSTORE_TYPE_FTRACE) {
-		if (!cxt->fprz)
+		int zonenum = 0;
+
+		if (!cxt->fprzs)
 			return -ENOMEM;
-		persistent_ram_write(cxt->fprz, buf, size);
+		/* Called with interrupts disabled, see pstore_ftrace_call() */
+		if (cxt->flags & RAMOOPS_FLAG_FTRACE_PER_CPU)
+			zonenum = raw_smp_processor_id();
+		persistent_ram_write(cxt->fprzs[zonenum], buf, size);
 		return 0;
 	} else if (type == PSTORE_TYPE_PMSG) {
 		if (!cxt->mprz)
@@ -345,7 +358,9 @@ static int ramoops_pstore_erase(enum pstore_type_id type, u64 id, int count,
 		prz = cxt->cprz;
 		break;
 	case PSTORE_TYPE_FTRACE:
-		prz = cxt->fprz;
+		if (id >= cxt->max_ftrace_cnt)
+			return -EINVAL;
+		prz = cxt->fprzs[id];
 		break;
 	case PSTORE_TYPE_PMSG:
 		prz = cxt->mprz;
@@ -458,6 +473,65 @@ static int ramoops_init_prz(struct device *dev, struct ramoops_context *cxt,
 	return 0;
 }
 
+static void ramoops_free_ftrace_przs(struct ramoops_context *cxt)
+{
+	int i;
+
+	if (!cxt->fprzs)
+		return;
+
+	for (i = 0; i < cxt->max_ftrace_cnt; i++)
+		persistent_ram_free(cxt->fprzs[i]);
+	kfree(cxt->fprzs);
+	cxt->fprzs = NULL;
+	cxt->max_ftrace_cnt = 0;
+}
+
+/*
+ * With RAMOOPS_FLAG_FTRACE_PER_CPU every CPU records into a zone of its
+ * own, so the CPUs do not fight over the start/size words of a single
+ * buffer in uncached memory.
+ */
+static int ramoops_init_ftrace_przs(struct device *dev,
+				    struct ramoops_context *cxt,
+				    phys_addr_t *paddr)
+{
+	unsigned int cnt = 1;
+	size_t zone_sz;
+	int err, i;
+
+	if (!cxt->ftrace_size)
+		return 0;
+
+	if (cxt->flags & RAMOOPS_FLAG_FTRACE_PER_CPU)
+		cnt = nr_cpu_ids;
+	zone_sz = cxt->ftrace_size / cnt;
+	if (!zone_sz) {
+		dev_err(dev, "ftrace size too small for %u zones\n", cnt);
+		return -ENOMEM;
+	}
+
+	cxt->fprzs = kcalloc(cnt, sizeof(*cxt->fprzs), GFP_KERNEL);
+	if (!cxt->fprzs)
+		return -ENOMEM;
+	cxt->max_ftrace_cnt = cnt;
+
+	for (i = 0; i < cnt; i++) {
+		err = ramoops_init_prz(dev, cxt, &cxt->fprzs[i], paddr,
+				       zone_sz, LINUX_VERSION_CODE);
+		if (err) {
+			cxt->fprzs[i] = NULL;
+			ramoops_free_ftrace_przs(cxt);
+			return err;
+		}
+	}
+
+	/* Leave the remainder of an uneven split unused */
+	*paddr += cxt->ftrace_size - zone_sz * cnt;
+
+	return 0;
+}
+
 static int ramoops_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
@@ -497,6 +571,7 @@ static int ramoops_probe(struct platform_device *pdev)
 	cxt->ftrace_size = pdata->ftrace_size;
 	cxt->pmsg_size = pdata->pmsg_size;
 	cxt->dump_oops = pdata->dump_oops;
+	cxt->flags = pdata->flags;
 	cxt->ecc_info = pdata->ecc_info;
 
 	paddr = cxt->phys_addr;
@@ -512,8 +587,7 @@ static int ramoops_probe(struct platform_device *pdev)
 	if (err)
 		goto fail_init_cprz;
 
-	err = ramoops_init_prz(dev, cxt, &cxt->fprz, &paddr, cxt->ftrace_size,
-			       LINUX_VERSION_CODE);
+	err = ramoops_init_ftrace_przs(dev, cxt, &paddr);
 	if (err)
 		goto fail_init_fprz;
 
@@ -556,6 +630,7 @@ static int ramoops_probe(struct platform_device *pdev)
 	ramoops_console_size = pdata->console_size;
 	ramoops_pmsg_size = pdata->pmsg_size;
 	ramoops_ftrace_size = pdata->ftrace_size;
+	ramoops_ftrace_per_cpu = !!(pdata->flags & RAMOOPS_FLAG_FTRACE_PER_CPU);
 
 	pr_info("attached 0x%lx@0x%llx, ecc: %d/%d\n",
 		cxt->size, (unsigned long long)cxt->phys_addr,
@@ -569,7 +644,7 @@ fail_clear:
 	cxt->pstore.bufsize = 0;
 	kfree(cxt->mprz);
 fail_init_mprz:
-	kfree(cxt->fprz);
+	ramoops_free_ftrace_przs(cxt);
 fail_init_fprz:
 	kfree(cxt->cprz);
 fail_init_cprz:
@@ -589,7 +664,7 @@ static int ramoops_remove(struct platform_device *pdev)
 	cxt->pstore.bufsize = 0;
 
 	persistent_ram_free(cxt->mprz);
-	persistent_ram_free(cxt->fprz);
+	ramoops_free_ftrace_przs(cxt);
 	persistent_ram_free(cxt->cprz);
 	ramoops_free_przs(cxt);
 
@@ -625,6 +700,8 @@ static void ramoops_register_dummy(void)
 	dummy_data->ftrace_size = ramoops_ftrace_size;
 	dummy_data->pmsg_size = ramoops_pmsg_size;
 	dummy_data->dump_oops = dump_oops;
+	if (ramoops_ftrace_per_cpu)
+		dummy_data->flags |= RAMOOPS_FLAG_FTRACE_PER_CPU;
 	/*
 	 * For backwards compatibility ramoops.ecc=1 means 16 bytes ECC
 	 * (using 1 byte for ECC isn't much of use anyway).
@@ -0,0 +1,218 @@
+/*
+ * Squashfs - decompressor benchmark
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * bench.c
+ */
+
+/*
+ * Writing the path of a regular file on a mounted Squashfs filesystem to
+ * <debugfs>/squashfs/bench decompresses every compressed datablock of the
+ * file with the decompressor of the filesystem, once to get the compressed
+ * data into the buffer cache and once timed.  Reading the file reports the
+ * decompressed throughput and the per-block latency percentiles of the
+ * timed pass.  An image can only be decompressed with the compressor it
+ * was made with, so to compare compressors make one image of the same data
+ * with each of them and benchmark a file on each.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/mutex.h>
+#include <linux/namei.h>
+#include <linux/pagemap.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs_fs_i.h"
+#include "squashfs.h"
+#include "decompressor.h"
+#include "page_actor.h"
+
+static DEFINE_MUTEX(squashfs_bench_mutex);
+static char squashfs_bench_result[256] = "no benchmark run\n";
+static struct dentry *squashfs_bench_dir;
+
+static int squashfs_bench_cmp(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int squashfs_bench_inode(struct inode *inode)
+{
+	struct super_block *sb = inode->i_sb;
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int pages = msblk->block_size >> PAGE_CACHE_SHIFT;
+	int blocks = i_size_read(inode) >> msblk->block_log;
+	struct squashfs_page_actor *actor = NULL;
+	void **buffer = NULL, *data;
+	u64 *lat = NULL, bytes = 0, ns = 0;
+	int i, n = 0, pass, res = -ENOMEM;
+
+	/* the tail end of the file may be in a fragment, leave it out */
+	if (blocks == 0)
+		return -ENODATA;
+
+	data = vmalloc(msblk->block_size);
+	if (data == NULL)
+		return -ENOMEM;
+
+	buffer = kcalloc(pages, sizeof(*buffer), GFP_KERNEL);
+	lat = vmalloc(blocks * sizeof(*lat));
+	if (buffer == NULL || lat == NULL)
+		goto out;
+
+	for (i = 0; i < pages; i++)
+		buffer[i] = data + i * PAGE_CACHE_SIZE;
+
+	actor = squashfs_page_actor_init(buffer, pages, 0);
+	if (actor == NULL)
+		goto out;
+	/* as the pages vmapped by squashfs_readpage_block() */
+	if (msblk->decompressor->linear)
+		actor->vaddr = data;
+
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < blocks; i++) {
+			u64 block = 0;
+			int bsize = squashfs_read_blocklist(inode, i, &block);
+			ktime_t start;
+
+			if (bsize < 0) {
+				res = bsize;
+				goto out;
+			}
+
+			/* sparse, or stored uncompressed */
+			if (bsize == 0 || !SQUASHFS_COMPRESSED_BLOCK(bsize))
+				continue;
+
+			start = ktime_get();
+			res = squashfs_read_data(sb, block, bsize, NULL, actor);
+			if (res < 0)
+				goto out;
+
+			if (pass) {
+				lat[n] = ktime_to_ns(ktime_sub(ktime_get(),
+							       start));
+				ns += lat[n++];
+				bytes += res;
+			}
+			cond_resched();
+		}
+	}
+
+	if (n == 0) {
+		res = -ENODATA;
+		goto out;
+	}
+
+	sort(lat, n, sizeof(*lat), squashfs_bench_cmp, NULL);
+	snprintf(squashfs_bench_result, sizeof(squashfs_bench_result),
+		"%s: %d blocks, %llu bytes, %llu MB/s, latency us p50 %llu p90 %llu p99 %llu max %llu\n",
+		msblk->decompressor->name, n, bytes,
+		div64_u64(bytes * NSEC_PER_USEC, ns ? : 1),
+		div_u64(lat[n / 2], NSEC_PER_USEC),
+		div_u64(lat[n * 90 / 100], NSEC_PER_USEC),
+		div_u64(lat[n * 99 / 100], NSEC_PER_USEC),
+		div_u64(lat[n - 1], NSEC_PER_USEC));
+	res = 0;
+
+out:
+	kfree(actor);
+	vfree(lat);
+	kfree(buffer);
+	vfree(data);
+	return res;
+}
+
+static ssize_t squashfs_bench_write(struct file *file, const char __user *ubuf,
+	size_t cnt, loff_t *ppos)
+{
+	struct inode *inode;
+	struct path path;
+	char *name;
+	int res;
+
+	if (cnt >= PATH_MAX)
+		return -ENAMETOOLONG;
+
+	name = kmalloc(cnt + 1, GFP_KERNEL);
+	if (name == NULL)
+		return -ENOMEM;
+
+	if (copy_from_user(name, ubuf, cnt)) {
+		kfree(name);
+		return -EFAULT;
+	}
+	name[cnt] = '\0';
+
+	res = kern_path(strim(name), LOOKUP_FOLLOW, &path);
+	kfree(name);
+	if (res)
+		return res;
+
+	inode = d_inode(path.dentry);
+	if (inode->i_sb->s_magic != SQUASHFS_MAGIC || !S_ISREG(inode->i_mode)) {
+		res = -EINVAL;
+		goto out;
+	}
+
+	mutex_lock(&squashfs_bench_mutex);
+	res = squashfs_bench_inode(inode);
+	mutex_unlock(&squashfs_bench_mutex);
+
+out:
+	path_put(&path);
+	return res ? : cnt;
+}
+
+static ssize_t squashfs_bench_read(struct file *file, char __user *ubuf,
+	size_t cnt, loff_t *ppos)
+{
+	ssize_t res;
+
+	mutex_lock(&squashfs_bench_mutex);
+	res = simple_read_from_buffer(ubuf, cnt, ppos, squashfs_bench_result,
+		strlen(squashfs_bench_result));
+	mutex_unlock(&squashfs_bench_mutex);
+
+	return res;
+}
+
+static const struct file_operations squashfs_bench_fops = {
+	.read		= squashfs_bench_read,
+	.write		= squashfs_bench_write,
+	.llseek		= default_llseek,
+};
+
+void __init squashfs_bench_init(void)
+{
+	squashfs_bench_dir = debugfs_create_dir("squashfs", NULL);
+	if (!squashfs_bench_dir)
+		return;
+
+	debugfs_create_file("bench", S_IRUSR | S_IWUSR, squashfs_bench_dir,
+		NULL, &squashfs_bench_fops);
+}
+
+void squashfs_bench_exit(void)
+{
+	debugfs_remove_recursive(squashfs_bench_dir);
+}
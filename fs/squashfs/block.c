@@ -212,3 +212,39 @@ read_failure:
 	kfree(bh);
 	return -EIO;
 }
+
+/*
+ * Start reading a datablock into the buffer cache without waiting for it,
+ * so that a later squashfs_read_data() of the same block finds its buffers
+ * in flight or uptodate.  This is only a hint, failures are ignored.
+ */
+void squashfs_prefetch_data(struct super_block *sb, u64 index, int length)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int offset = index & ((1 << msblk->devblksize_log2) - 1);
+	u64 cur_index = index >> msblk->devblksize_log2;
+	struct buffer_head **bh;
+	int b, nr;
+
+	length = SQUASHFS_COMPRESSED_SIZE_BLOCK(length);
+	if (length <= 0 || length > msblk->block_size ||
+			(index + length) > msblk->bytes_used)
+		return;
+
+	nr = (offset + length + msblk->devblksize - 1) >>
+		msblk->devblksize_log2;
+	bh = kcalloc(nr, sizeof(*bh), GFP_KERNEL);
+	if (bh == NULL)
+		return;
+
+	for (b = 0; b < nr; b++, cur_index++) {
+		bh[b] = sb_getblk(sb, cur_index);
+		if (bh[b] == NULL)
+			break;
+	}
+	ll_rw_block(READA, b, bh);
+
+	while (b--)
+		put_bh(bh[b]);
+	kfree(bh);
+}
@@ -33,6 +33,8 @@ struct squashfs_decompressor {
 	int	id;
 	char	*name;
 	int	supported;
+	/* decompresses straight into a linear output, squashfs_actor_vaddr() */
+	int	linear;
 };
 
 static inline void *squashfs_comp_opts(struct squashfs_sb_info *msblk,
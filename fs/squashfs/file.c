@@ -47,6 +47,8 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/blkdev.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -332,7 +334,7 @@ failed:
  * Get the on-disk location and compressed size of the datablock
  * specified by index.  Fill_meta_index() does most of the work.
  */
-static int read_blocklist(struct inode *inode, int index, u64 *block)
+int squashfs_read_blocklist(struct inode *inode, int index, u64 *block)
 {
 	u64 start;
 	long long blks;
@@ -340,7 +342,7 @@ static int read_blocklist(struct inode *inode, int index, u64 *block)
 	__le32 size;
 	int res = fill_meta_index(inode, index, &start, &offset, block);
 
-	TRACE("read_blocklist: res %d, index %d, start 0x%llx, offset"
+	TRACE("squashfs_read_blocklist: res %d, index %d, start 0x%llx, offset"
 		       " 0x%x, block 0x%llx\n", res, index, start, offset,
 			*block);
 
@@ -469,7 +471,7 @@ static int squashfs_readpage(struct file *file, struct page *page)
 	if (index < file_end || squashfs_i(inode)->fragment_block ==
 					SQUASHFS_INVALID_BLK) {
 		u64 block = 0;
-		int bsize = read_blocklist(inode, index, &block);
+		int bsize = squashfs_read_blocklist(inode, index, &block);
 		if (bsize < 0)
 			goto error_out;
 
@@ -497,7 +499,96 @@ out:
 	return 0;
 }
 
+struct squashfs_readahead_work {
+	struct work_struct	work;
+	struct page		*page;
+};
+
+static void squashfs_readahead_work(struct work_struct *work)
+{
+	struct squashfs_readahead_work *ra = container_of(work,
+				struct squashfs_readahead_work, work);
+
+	squashfs_readpage(NULL, ra->page);
+	page_cache_release(ra->page);
+	kfree(ra);
+}
+
+/*
+ * Readahead a datablock at a time.  Only one page of each datablock goes into
+ * the page cache here, filling it fills the rest of the datablock as
+ * squashfs_readpage() does, the other pages on the list are dropped.  The
+ * reads of all the datablocks are started first, then they are decompressed
+ * in parallel from an unbound workqueue, each using the decompressor of
+ * the cpu it runs on with CONFIG_SQUASHFS_DECOMP_MULTI_PERCPU.  The last
+ * datablock is done by the caller instead of waiting.
+ */
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+	struct list_head *pages, unsigned nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+	int file_end = i_size_read(inode) >> msblk->block_log;
+	struct page **target;
+	struct blk_plug plug;
+	int i, n = 0, last = -1;
+
+	target = kmalloc_array(nr_pages, sizeof(*target), GFP_KERNEL);
+	if (target == NULL)
+		return -ENOMEM;
+
+	blk_start_plug(&plug);
+	while (!list_empty(pages)) {
+		struct page *page = list_entry(pages->prev, struct page, lru);
+		int index = page->index >> shift;
+		u64 block = 0;
+		int bsize;
+
+		list_del(&page->lru);
+		if (index == last || add_to_page_cache_lru(page, mapping,
+				page->index,
+				mapping_gfp_constraint(mapping, GFP_KERNEL))) {
+			page_cache_release(page);
+			continue;
+		}
+
+		last = index;
+		target[n++] = page;
+
+		if (index < file_end || squashfs_i(inode)->fragment_block ==
+						SQUASHFS_INVALID_BLK) {
+			bsize = squashfs_read_blocklist(inode, index, &block);
+			if (bsize > 0)
+				squashfs_prefetch_data(inode->i_sb, block,
+						bsize);
+		}
+	}
+	blk_finish_plug(&plug);
+
+	for (i = 0; i < n; i++) {
+		struct squashfs_readahead_work *ra = NULL;
+
+		if (i < n - 1)
+			ra = kmalloc(sizeof(*ra), GFP_KERNEL);
+
+		if (ra == NULL) {
+			squashfs_readpage(file, target[i]);
+			page_cache_release(target[i]);
+			continue;
+		}
+
+		INIT_WORK(&ra->work, squashfs_readahead_work);
+		ra->page = target[i];
+		queue_work(system_unbound_wq, &ra->work);
+	}
+
+	kfree(target);
+	return 0;
+}
+
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+	.readpages = squashfs_readpages
 };
@@ -18,6 +18,7 @@
 #include "squashfs_fs_sb.h"
 #include "squashfs_fs_i.h"
 #include "squashfs.h"
+#include "decompressor.h"
 #include "page_actor.h"
 
 static int squashfs_read_cache(struct page *target_page, u64 block, int bsize,
@@ -91,7 +92,10 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize)
 	}
 
 	/* Decompress directly into the page cache buffers */
+	if (msblk->decompressor->linear)
+		squashfs_page_actor_vmap(actor);
 	res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+	squashfs_page_actor_vunmap(actor);
 	if (res < 0)
 		goto mark_errored;
 
@@ -96,6 +96,7 @@ static int lz4_uncompress(struct squashfs_sb_info *msblk, void *strm,
 {
 	struct squashfs_lz4 *stream = strm;
 	void *buff = stream->input, *data;
+	void *linear = squashfs_actor_vaddr(output);
 	int avail, i, bytes = length, res;
 	size_t dest_len = output->length;
 
@@ -109,10 +110,13 @@ static int lz4_uncompress(struct squashfs_sb_info *msblk, void *strm,
 	}
 
 	res = lz4_decompress_unknownoutputsize(stream->input, length,
-					stream->output, &dest_len);
+					linear ? : stream->output, &dest_len);
 	if (res)
 		return -EIO;
 
+	if (linear)
+		return dest_len;
+
 	bytes = dest_len;
 	data = squashfs_first_page(output);
 	buff = stream->output;
@@ -138,5 +142,6 @@ const struct squashfs_decompressor squashfs_lz4_comp_ops = {
 	.decompress = lz4_uncompress,
 	.id = LZ4_COMPRESSION,
 	.name = "lz4",
-	.supported = 1
+	.supported = 1,
+	.linear = 1
 };
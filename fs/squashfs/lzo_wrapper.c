@@ -81,6 +81,7 @@ static int lzo_uncompress(struct squashfs_sb_info *msblk, void *strm,
 {
 	struct squashfs_lzo *stream = strm;
 	void *buff = stream->input, *data;
+	void *linear = squashfs_actor_vaddr(output);
 	int avail, i, bytes = length, res;
 	size_t out_len = output->length;
 
@@ -94,10 +95,13 @@ static int lzo_uncompress(struct squashfs_sb_info *msblk, void *strm,
 	}
 
 	res = lzo1x_decompress_safe(stream->input, (size_t)length,
-					stream->output, &out_len);
+					linear ? : stream->output, &out_len);
 	if (res != LZO_E_OK)
 		goto failed;
 
+	if (linear)
+		return (int)out_len;
+
 	res = bytes = (int)out_len;
 	data = squashfs_first_page(output);
 	buff = stream->output;
@@ -126,5 +130,6 @@ const struct squashfs_decompressor squashfs_lzo_comp_ops = {
 	.decompress = lzo_uncompress,
 	.id = LZO_COMPRESSION,
 	.name = "lzo",
-	.supported = 1
+	.supported = 1,
+	.linear = 1
 };
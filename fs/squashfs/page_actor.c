@@ -9,6 +9,8 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/pagemap.h>
+#include <linux/highmem.h>
+#include <linux/vmalloc.h>
 #include "page_actor.h"
 
 /*
@@ -50,6 +52,7 @@ struct squashfs_page_actor *squashfs_page_actor_init(void **buffer,
 
 	actor->length = length ? : pages * PAGE_CACHE_SIZE;
 	actor->buffer = buffer;
+	actor->vaddr = NULL;
 	actor->pages = pages;
 	actor->next_page = 0;
 	actor->squashfs_first_page = cache_first_page;
@@ -93,8 +96,35 @@ struct squashfs_page_actor *squashfs_page_actor_init_special(struct page **page,
 	actor->pages = pages;
 	actor->next_page = 0;
 	actor->pageaddr = NULL;
+	actor->vaddr = NULL;
 	actor->squashfs_first_page = direct_first_page;
 	actor->squashfs_next_page = direct_next_page;
 	actor->squashfs_finish_page = direct_finish_page;
 	return actor;
 }
+
+/*
+ * Map the page cache pages of a direct page actor covering whole pages
+ * contiguously, so that decompressors needing a linear output buffer can
+ * decompress straight into them.  This may sleep, so is done before
+ * squashfs_read_data(), not from within the decompressor.  If it fails the
+ * decompressor falls back to its own buffer.
+ */
+void squashfs_page_actor_vmap(struct squashfs_page_actor *actor)
+{
+	if (actor->squashfs_first_page != direct_first_page ||
+			actor->length != actor->pages * PAGE_CACHE_SIZE)
+		return;
+
+	actor->vaddr = vmap(actor->page, actor->pages, VM_MAP, PAGE_KERNEL);
+}
+
+void squashfs_page_actor_vunmap(struct squashfs_page_actor *actor)
+{
+	if (actor->vaddr == NULL)
+		return;
+
+	flush_kernel_vmap_range(actor->vaddr, actor->length);
+	vunmap(actor->vaddr);
+	actor->vaddr = NULL;
+}
@@ -11,6 +11,7 @@
 #ifndef CONFIG_SQUASHFS_FILE_DIRECT
 struct squashfs_page_actor {
 	void	**page;
+	void	*vaddr;
 	int	pages;
 	int	length;
 	int	next_page;
@@ -26,6 +27,7 @@ static inline struct squashfs_page_actor *squashfs_page_actor_init(void **page,
 
 	actor->length = length ? : pages * PAGE_CACHE_SIZE;
 	actor->page = page;
+	actor->vaddr = NULL;
 	actor->pages = pages;
 	actor->next_page = 0;
 	return actor;
@@ -54,6 +56,7 @@ struct squashfs_page_actor {
 		struct page	**page;
 	};
 	void	*pageaddr;
+	void	*vaddr;
 	void    *(*squashfs_first_page)(struct squashfs_page_actor *);
 	void    *(*squashfs_next_page)(struct squashfs_page_actor *);
 	void    (*squashfs_finish_page)(struct squashfs_page_actor *);
@@ -65,6 +68,8 @@ struct squashfs_page_actor {
 extern struct squashfs_page_actor *squashfs_page_actor_init(void **, int, int);
 extern struct squashfs_page_actor *squashfs_page_actor_init_special(struct page
 							 **, int, int);
+extern void squashfs_page_actor_vmap(struct squashfs_page_actor *);
+extern void squashfs_page_actor_vunmap(struct squashfs_page_actor *);
 static inline void *squashfs_first_page(struct squashfs_page_actor *actor)
 {
 	return actor->squashfs_first_page(actor);
@@ -78,4 +83,13 @@ static inline void squashfs_finish_page(struct squashfs_page_actor *actor)
 	actor->squashfs_finish_page(actor);
 }
 #endif
+
+/*
+ * The whole output of the actor as one linear buffer of actor->length
+ * bytes, or NULL if it is only reachable a page at a time.
+ */
+static inline void *squashfs_actor_vaddr(struct squashfs_page_actor *actor)
+{
+	return actor->vaddr;
+}
 #endif
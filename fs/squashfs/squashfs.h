@@ -27,9 +27,19 @@
 
 #define WARNING(s, args...)	pr_warn("SQUASHFS: "s, ## args)
 
+/* bench.c */
+#ifdef CONFIG_SQUASHFS_BENCH
+extern void squashfs_bench_init(void);
+extern void squashfs_bench_exit(void);
+#else
+static inline void squashfs_bench_init(void) { }
+static inline void squashfs_bench_exit(void) { }
+#endif
+
 /* block.c */
 extern int squashfs_read_data(struct super_block *, u64, int, u64 *,
 				struct squashfs_page_actor *);
+extern void squashfs_prefetch_data(struct super_block *, u64, int);
 
 /* cache.c */
 extern struct squashfs_cache *squashfs_cache_init(char *, int, int);
@@ -67,6 +77,7 @@ extern __le64 *squashfs_read_fragment_index_table(struct super_block *,
 				u64, u64, unsigned int);
 
 /* file.c */
+extern int squashfs_read_blocklist(struct inode *, int, u64 *);
 void squashfs_copy_cache(struct page *, struct squashfs_cache_entry *, int,
 				int);
 
@@ -450,6 +450,8 @@ static int __init init_squashfs_fs(void)
 		return err;
 	}
 
+	squashfs_bench_init();
+
 	pr_info("version 4.0 (2009/01/31) Phillip Lougher\n");
 
 	return 0;
@@ -458,6 +460,7 @@ static int __init init_squashfs_fs(void)
 
 static void __exit exit_squashfs_fs(void)
 {
+	squashfs_bench_exit();
 	unregister_filesystem(&squashfs_fs_type);
 	destroy_inodecache();
 }
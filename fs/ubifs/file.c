@@ -811,14 +811,19 @@ out_bu_off:
 
 /**
  * ubifs_bulk_read - determine whether to bulk-read and, if so, do it.
+ * @file: file the page is read for (may be %NULL)
  * @page: page from which to start bulk-read.
  *
  * Some flash media are capable of reading sequentially at faster rates. UBIFS
  * bulk-read facility is designed to take advantage of that, by reading in one
  * go consecutive data nodes that are also located consecutively in the same
  * LEB. This function returns %1 if a bulk-read is done and %0 otherwise.
+ *
+ * Bulk-read is never done for files opened for random access (see
+ * 'posix_fadvise(POSIX_FADV_RANDOM)'), the extra data would only be thrown
+ * away.
  */
-static int ubifs_bulk_read(struct page *page)
+static int ubifs_bulk_read(struct file *file, struct page *page)
 {
 	struct inode *inode = page->mapping->host;
 	struct ubifs_info *c = inode->i_sb->s_fs_info;
@@ -830,6 +835,8 @@ static int ubifs_bulk_read(struct page *page)
 	ui->last_page_read = index;
 	if (!c->bulk_read)
 		return 0;
+	if (file && (file->f_mode & FMODE_RANDOM))
+		return 0;
 
 	/*
 	 * Bulk-read is protected by @ui->ui_mutex, but it is an optimization,
@@ -886,7 +893,7 @@ out_unlock:
 
 static int ubifs_readpage(struct file *file, struct page *page)
 {
-	if (ubifs_bulk_read(page))
+	if (ubifs_bulk_read(file, page))
 		return 0;
 	do_readpage(page);
 	unlock_page(page);
@@ -293,6 +293,12 @@ struct vgic_v3_cpu_if {
 #endif
 };
 
+struct vgic_latency_stats {
+	u64	count;
+	u64	total_ns;
+	u64	max_ns;
+};
+
 struct vgic_cpu {
 	/* Pending/active/both interrupts on this VCPU */
 	DECLARE_BITMAP(pending_percpu, VGIC_NR_PRIVATE_IRQS);
@@ -315,6 +321,10 @@ struct vgic_cpu {
 
 	/* Protected by the distributor's irq_phys_map_lock */
 	struct list_head	irq_phys_map_list;
+
+	/* Injection to LR latency, protected by the distributor lock */
+	u64			pending_since;
+	struct vgic_latency_stats	latency;
 };
 
 #define LR_EMPTY	0xff
@@ -78,6 +78,11 @@ struct bio {
 	 */
 	struct io_context	*bi_ioc;
 	struct cgroup_subsys_state *bi_css;
+#ifdef CONFIG_BLK_DEV_THROTTLING
+	/* blk-throttle group tracking the completion latency, issue time */
+	struct blkcg_gq		*bi_throtl_blkg;
+	u64			bi_throtl_issue_ns;
+#endif
 #endif
 	union {
 #if defined(CONFIG_BLK_DEV_INTEGRITY)
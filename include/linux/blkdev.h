@@ -153,6 +153,7 @@ struct request {
 	struct gendisk *rq_disk;
 	struct hd_struct *part;
 	unsigned long start_time;
+	u64 issue_time_ns;		/* for polled queues' service time */
 #ifdef CONFIG_BLK_CGROUP
 	struct request_list *rl;		/* rl this rq is alloced from */
 	unsigned long long start_time_ns;
@@ -465,6 +466,13 @@ struct request_queue {
 	struct bio_set		*bio_split;
 
 	bool			mq_sysfs_init_done;
+
+	/*
+	 * Polling: sleep before polling for this long, or for half the mean
+	 * service time of reads and writes if 0, or not at all if -1.
+	 */
+	int			poll_nsec;
+	u64			poll_mean_ns[2];
 };
 
 #define QUEUE_FLAG_QUEUED	1	/* uses generic tag queueing */
@@ -490,6 +498,7 @@ struct request_queue {
 #define QUEUE_FLAG_INIT_DONE   20	/* queue is initialized */
 #define QUEUE_FLAG_NO_SG_MERGE 21	/* don't attempt to merge SG segments*/
 #define QUEUE_FLAG_POLL	       22	/* IO polling enabled if set */
+#define QUEUE_FLAG_COMP_BATCH  23	/* batch mq completions in softirq */
 
 #define QUEUE_FLAG_DEFAULT	((1 << QUEUE_FLAG_IO_STAT) |		\
 				 (1 << QUEUE_FLAG_STACKABLE)	|	\
@@ -1123,6 +1132,18 @@ extern int blkdev_issue_discard(struct block_device *bdev, sector_t sector,
 		sector_t nr_sects, gfp_t gfp_mask, unsigned long flags);
 extern int blkdev_issue_write_same(struct block_device *bdev, sector_t sector,
 		sector_t nr_sects, gfp_t gfp_mask, struct page *page);
+
+struct blk_discard_queue;
+extern struct blk_discard_queue *blk_alloc_discard_queue(
+		struct block_device *bdev, gfp_t gfp_mask);
+extern void blk_free_discard_queue(struct blk_discard_queue *dq);
+extern void blk_discard_queue_set_rate(struct blk_discard_queue *dq,
+		unsigned int max_sects, unsigned int interval);
+extern int blk_discard_queue_add(struct blk_discard_queue *dq,
+		sector_t sector, sector_t nr_sects, gfp_t gfp_mask);
+extern void blk_discard_queue_cancel(struct blk_discard_queue *dq,
+		sector_t sector, sector_t nr_sects);
+extern void blk_discard_queue_flush(struct blk_discard_queue *dq);
 extern int blkdev_issue_zeroout(struct block_device *bdev, sector_t sector,
 		sector_t nr_sects, gfp_t gfp_mask, bool discard);
 static inline int sb_issue_discard(struct super_block *sb, sector_t block,
@@ -17,6 +17,14 @@ struct cpufreq_dt_platform_data {
 	 * clock.
 	 */
 	bool independent_clocks;
+
+	/*
+	 * Dynamic power coefficient of the CPUs, in mW/MHz/V^2 scaled as
+	 * expected by the cpu cooling device, used when the CPU node does
+	 * not carry a "dynamic-power-coefficient" property. 0 leaves the
+	 * cooling device without a power model.
+	 */
+	u32 dynamic_power_coefficient;
 };
 
 #endif /* __CPUFREQ_DT_H__ */
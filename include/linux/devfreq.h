@@ -13,6 +13,7 @@
 #ifndef __LINUX_DEVFREQ_H__
 #define __LINUX_DEVFREQ_H__
 
+#include <linux/cpumask.h>
 #include <linux/device.h>
 #include <linux/notifier.h>
 #include <linux/pm_opp.h>
@@ -241,6 +242,41 @@ struct devfreq_simple_ondemand_data {
 };
 #endif
 
+#if IS_ENABLED(CONFIG_DEVFREQ_GOV_MEMLAT)
+/**
+ * struct devfreq_memlat_map - CPU to device frequency map entry
+ * @core_khz:	CPU frequency in kHz.
+ * @dev_freq:	Device frequency to vote for while a latency bound CPU
+ *		runs at up to core_khz.
+ */
+struct devfreq_memlat_map {
+	unsigned int core_khz;
+	unsigned long dev_freq;
+};
+
+/**
+ * struct devfreq_memlat_data - void *data fed to struct devfreq
+ *	and devfreq_add_device
+ * @cpus:		CPUs whose counters are sampled.
+ * @ratio_ceil:		A CPU retiring fewer instructions than this per
+ *			cache miss is considered memory latency bound.
+ *			Specify 0 to use the default.
+ * @cachemiss_ev:	Raw PMU event number counting the cache misses.
+ *			Specify 0 to use the generic cache miss event.
+ * @map:		CPU to device frequency map, ascending in core_khz.
+ * @map_len:		Number of entries in map.
+ *
+ * The mem_latency governor requires this data, it does not start without.
+ */
+struct devfreq_memlat_data {
+	cpumask_t cpus;
+	unsigned int ratio_ceil;
+	unsigned int cachemiss_ev;
+	struct devfreq_memlat_map *map;
+	unsigned int map_len;
+};
+#endif
+
 #else /* !CONFIG_PM_DEVFREQ */
 static inline struct devfreq *devfreq_add_device(struct device *dev,
 					  struct devfreq_dev_profile *profile,
@@ -424,6 +424,7 @@ static inline void bpf_prog_unlock_ro(struct bpf_prog *fp)
 int sk_filter(struct sock *sk, struct sk_buff *skb);
 
 int bpf_prog_select_runtime(struct bpf_prog *fp);
+unsigned int bpf_prog_run_interp(const struct bpf_prog *fp, const void *ctx);
 void bpf_prog_free(struct bpf_prog *fp);
 
 struct bpf_prog *bpf_prog_alloc(unsigned int size, gfp_t gfp_extra_flags);
@@ -107,6 +107,9 @@ typedef irqreturn_t (*irq_handler_t)(int, void *);
  * @secondary:	pointer to secondary irqaction (force threading)
  * @thread_flags:	flags related to @thread
  * @thread_mask:	bitmask for keeping track of @thread activity
+ * @thread_policy:	IRQ_THREAD_* policy of @thread
+ * @thread_prio:	default RT priority of @thread
+ * @consumer_cpu:	cpu @thread follows, or -1
  * @dir:	pointer to the proc/irq/NN/name entry
  */
 struct irqaction {
@@ -121,6 +124,9 @@ struct irqaction {
 	unsigned int		flags;
 	unsigned long		thread_flags;
 	unsigned long		thread_mask;
+	unsigned int		thread_policy;
+	int			thread_prio;
+	int			consumer_cpu;
 	const char		*name;
 	struct proc_dir_entry	*dir;
 } ____cacheline_internodealigned_in_smp;
@@ -354,6 +360,22 @@ static inline void enable_irq_lockdep_irqrestore(unsigned int irq, unsigned long
 	enable_irq(irq);
 }
 
+/*
+ * Policy of an irq thread towards the task consuming the device's events,
+ * see irq_set_thread_consumer():
+ *
+ * IRQ_THREAD_INHERIT_PRIO	- run at the consumer's RT priority if higher
+ * IRQ_THREAD_FOLLOW_CONSUMER	- run on the consumer's cpu instead of
+ *				  following the affinity of the interrupt
+ */
+#define IRQ_THREAD_INHERIT_PRIO		0x00000001
+#define IRQ_THREAD_FOLLOW_CONSUMER	0x00000002
+
+extern int irq_set_thread_policy(unsigned int irq, void *dev_id,
+				 unsigned int policy);
+extern int irq_set_thread_consumer(unsigned int irq, void *dev_id,
+				   struct task_struct *tsk);
+
 /* IRQ wakeup (PM) control: */
 extern int irq_set_irq_wake(unsigned int irq, unsigned int on);
 
@@ -387,6 +387,9 @@ struct kvm {
 	struct kvm_vcpu *vcpus[KVM_MAX_VCPUS];
 	atomic_t online_vcpus;
 	int last_boosted_vcpu;
+	/* Per-VM replacement for the halt_poll_ns module parameter */
+	bool override_halt_poll_ns;
+	unsigned int max_halt_poll_ns;
 	struct list_head vm_list;
 	struct mutex lock;
 	struct kvm_io_bus *buses[KVM_NR_BUSES];
@@ -14,6 +14,13 @@
  * Brlocks are also implemented as a short-hand notation for the latter use
  * case.
  *
+ * On PREEMPT_RT_FULL the per-CPU locks are sleeping locks, and taking all
+ * of them for the global side would be linear in the number of CPUs and
+ * stall behind every preempted local holder in turn. There the local side
+ * additionally holds a percpu_rw_semaphore for read, which is a per-CPU
+ * counter in the common case, and the global side only takes it for
+ * write instead of walking the per-CPU locks.
+ *
  * Copyright 2009, 2010, Nick Piggin, Novell Inc.
  */
 #ifndef __LINUX_LGLOCK_H
@@ -24,6 +31,7 @@
 #include <linux/percpu.h>
 #include <linux/cpu.h>
 #include <linux/notifier.h>
+#include <linux/percpu-rwsem.h>
 
 #ifdef CONFIG_SMP
 
@@ -36,6 +44,8 @@
 struct lglock {
 #ifdef CONFIG_PREEMPT_RT_FULL
 	struct rt_mutex __percpu *lock;
+	struct percpu_rw_semaphore rwsem;
+	bool relaxed;	/* held via lg_global_trylock_relax() */
 #else
 	arch_spinlock_t __percpu *lock;
 #endif
@@ -69,7 +79,8 @@ struct lglock {
 	static struct lglock name = { .lock = &name ## _lock }
 #endif
 
-void lg_lock_init(struct lglock *lg, char *name);
+int lg_lock_init(struct lglock *lg, char *name);
+void lg_lock_free(struct lglock *lg);
 
 void lg_local_lock(struct lglock *lg);
 void lg_local_unlock(struct lglock *lg);
@@ -93,7 +104,8 @@ void lg_global_trylock_relax(struct lglock *lg);
 #define lglock spinlock
 #define DEFINE_LGLOCK(name) DEFINE_SPINLOCK(name)
 #define DEFINE_STATIC_LGLOCK(name) static DEFINE_SPINLOCK(name)
-#define lg_lock_init(lg, name) spin_lock_init(lg)
+#define lg_lock_init(lg, name) ({ spin_lock_init(lg); 0; })
+#define lg_lock_free(lg) do { } while (0)
 #define lg_local_lock spin_lock
 #define lg_local_unlock spin_unlock
 #define lg_local_lock_cpu(lg, cpu) spin_lock(lg)
@@ -682,6 +682,16 @@ static inline bool hlist_fake(struct hlist_node *h)
  * Move a list from one list head to another. Fixup the pprev
  * reference of the first entry if it exists.
  */
+/*
+ * Check whether the node is the only node of the head without
+ * accessing head:
+ */
+static inline bool
+hlist_is_singular_node(struct hlist_node *n, struct hlist_head *h)
+{
+	return !n->next && n->pprev == &h->first;
+}
+
 static inline void hlist_move_list(struct hlist_head *old,
 				   struct hlist_head *new)
 {
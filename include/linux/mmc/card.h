@@ -121,6 +121,10 @@ struct mmc_ext_csd {
 
 	unsigned int            feature_support;
 #define MMC_DISCARD_FEATURE	BIT(0)                  /* CMD38 feature */
+
+	bool			cmdq_support;	/* Command Queue supported */
+	bool			cmdq_en;	/* Command Queue enabled */
+	unsigned int		cmdq_depth;	/* Command Queue depth */
 };
 
 struct sd_scr {
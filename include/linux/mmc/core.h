@@ -114,8 +114,14 @@ struct mmc_data {
 #define MMC_DATA_WRITE	(1 << 8)
 #define MMC_DATA_READ	(1 << 9)
 #define MMC_DATA_STREAM	(1 << 10)
+#define MMC_DATA_QBR		(1 << 11)	/* CQE queue barrier */
+#define MMC_DATA_PRIO		(1 << 12)	/* CQE high priority */
+#define MMC_DATA_REL_WR		(1 << 13)	/* Reliable write */
+#define MMC_DATA_DAT_TAG	(1 << 14)	/* Tag request */
+#define MMC_DATA_FORCED_PRG	(1 << 15)	/* Forced programming */
 
 	unsigned int		bytes_xfered;
+	unsigned int		blk_addr;	/* CQE block address */
 
 	struct mmc_command	*stop;		/* stop command */
 	struct mmc_request	*mrq;		/* associated request */
@@ -135,7 +141,15 @@ struct mmc_request {
 
 	struct completion	completion;
 	void			(*done)(struct mmc_request *);/* completion function */
+	/*
+	 * Notify the upper layers (e.g. mmc block driver) that recovery is
+	 * needed due to an error associated with the mmc_request. Currently
+	 * used only by CQE.
+	 */
+	void			(*recovery_notifier)(struct mmc_request *);
 	struct mmc_host		*host;
+
+	int			tag;		/* CQE task id */
 };
 
 struct mmc_card;
@@ -155,6 +169,12 @@ extern void mmc_start_bkops(struct mmc_card *card, bool from_exception);
 extern int mmc_switch(struct mmc_card *, u8, u8, u8, unsigned int);
 extern int mmc_send_tuning(struct mmc_host *host, u32 opcode, int *cmd_error);
 extern int mmc_get_ext_csd(struct mmc_card *card, u8 **new_ext_csd);
+extern int mmc_cmdq_enable(struct mmc_card *card);
+extern int mmc_cmdq_disable(struct mmc_card *card);
+
+extern int mmc_cqe_start_req(struct mmc_host *host, struct mmc_request *mrq);
+extern void mmc_cqe_post_req(struct mmc_host *host, struct mmc_request *mrq);
+extern int mmc_cqe_recovery(struct mmc_host *host);
 
 #define MMC_ERASE_ARG		0x00000000
 #define MMC_SECURE_ERASE_ARG	0x80000000
@@ -97,6 +97,8 @@ int qcom_rpm_bus_send_message(int ctx, int type, int id,
 int __init msm_bus_fabric_init_driver(void);
 uint32_t msm_bus_scale_register_client(struct msm_bus_scale_pdata *pdata);
 int msm_bus_scale_client_update_request(uint32_t cl, unsigned int index);
+int msm_bus_scale_client_update_request_vec(uint32_t *cl, unsigned int *index,
+						unsigned int num);
 void msm_bus_scale_unregister_client(uint32_t cl);
 
 struct msm_bus_client_handle*
@@ -124,6 +126,13 @@ msm_bus_scale_client_update_request(uint32_t cl, unsigned int index)
 	return 0;
 }
 
+static inline int
+msm_bus_scale_client_update_request_vec(uint32_t *cl, unsigned int *index,
+						unsigned int num)
+{
+	return 0;
+}
+
 static inline void
 msm_bus_scale_unregister_client(uint32_t cl)
 {
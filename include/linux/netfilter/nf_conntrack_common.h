@@ -20,6 +20,11 @@ struct ip_conntrack_stat {
 	unsigned int expect_create;
 	unsigned int expect_delete;
 	unsigned int search_restart;
+
+	/* Connections created during the last full second */
+	unsigned long create_stamp;
+	unsigned int create_cur;
+	unsigned int create_rate;
 };
 
 /* call to create an explicit dependency on nf_conntrack. */
@@ -2,6 +2,7 @@
 #define __PERCPU_IDA_H__
 
 #include <linux/types.h>
+#include <linux/atomic.h>
 #include <linux/bitops.h>
 #include <linux/init.h>
 #include <linux/sched.h>
@@ -11,6 +12,17 @@
 
 struct percpu_ida_cpu;
 
+/*
+ * Contention counters. They are only updated on the slow paths, under the
+ * pool lock.
+ */
+struct percpu_ida_stats {
+	unsigned long		alloc_slow;	/* percpu freelist was empty */
+	unsigned long		steals;		/* tags from another cpu */
+	unsigned long		sleeps;		/* waits for a free tag */
+	unsigned long		failed;		/* -ENOSPC without waiting */
+};
+
 struct percpu_ida {
 	/*
 	 * number of tags available to be allocated, as passed to
@@ -20,6 +32,12 @@ struct percpu_ida {
 	unsigned			percpu_max_size;
 	unsigned			percpu_batch_size;
 
+	/*
+	 * Number of frees to collect before waking up waiters, see
+	 * percpu_ida_set_wake_batch()
+	 */
+	unsigned			wake_batch;
+
 	struct percpu_ida_cpu __percpu	*tag_cpu;
 
 	/*
@@ -51,6 +69,9 @@ struct percpu_ida {
 		 */
 		unsigned		nr_free;
 		unsigned		*freelist;
+
+		atomic_t		wake_pending;
+		struct percpu_ida_stats	stats;
 	} ____cacheline_aligned_in_smp;
 };
 
@@ -68,12 +89,24 @@ void percpu_ida_free(struct percpu_ida *pool, unsigned tag);
 void percpu_ida_destroy(struct percpu_ida *pool);
 int __percpu_ida_init(struct percpu_ida *pool, unsigned long nr_tags,
 	unsigned long max_size, unsigned long batch_size);
+/*
+ * Small pools get smaller percpu freelists, so that a single cpu cannot
+ * hoard the whole tag space and force the others to steal it back.
+ */
 static inline int percpu_ida_init(struct percpu_ida *pool, unsigned long nr_tags)
 {
-	return __percpu_ida_init(pool, nr_tags, IDA_DEFAULT_PCPU_SIZE,
-		IDA_DEFAULT_PCPU_BATCH_MOVE);
+	unsigned long batch = clamp_t(unsigned long,
+				      nr_tags / (2 * num_possible_cpus()),
+				      1, IDA_DEFAULT_PCPU_BATCH_MOVE);
+
+	return __percpu_ida_init(pool, nr_tags,
+		max(batch * 3 / 2, batch + 1), batch);
 }
 
+void percpu_ida_set_wake_batch(struct percpu_ida *pool, unsigned batch);
+void percpu_ida_get_stats(struct percpu_ida *pool,
+			  struct percpu_ida_stats *stats);
+
 typedef int (*percpu_ida_cb)(unsigned, void *);
 int percpu_ida_for_each_free(struct percpu_ida *pool, percpu_ida_cb fn,
 	void *data);
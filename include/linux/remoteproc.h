@@ -324,6 +324,7 @@ struct rproc_mem_entry {
 };
 
 struct rproc;
+struct rproc_coredump;
 
 /**
  * struct rproc_ops - platform-specific device handlers
@@ -411,6 +412,12 @@ enum rproc_crash_type {
  * @cached_table: copy of the resource table
  * @table_csum: checksum of the resource table
  * @has_iommu: flag to indicate if remote processor is behind an MMU
+ * @fw_cache: firmware files kept from the last successful boot
+ * @fw_cache_lock: protects @fw_cache and @fw_cache_bytes
+ * @fw_cache_bytes: memory used by @fw_cache
+ * @fw_cache_enabled: keep firmware files in @fw_cache across restarts
+ * @dump_segments: memory segments included in crash dumps
+ * @dump: crash dump to be read before the next boot
  */
 struct rproc {
 	struct list_head node;
@@ -443,6 +450,12 @@ struct rproc {
 	struct resource_table *cached_table;
 	u32 table_csum;
 	bool has_iommu;
+	struct list_head fw_cache;
+	struct mutex fw_cache_lock;
+	size_t fw_cache_bytes;
+	bool fw_cache_enabled;
+	struct list_head dump_segments;
+	struct rproc_coredump *dump;
 };
 
 /* we currently support only two vrings per rvdev */
@@ -498,6 +511,13 @@ int rproc_del(struct rproc *rproc);
 int rproc_boot(struct rproc *rproc);
 void rproc_shutdown(struct rproc *rproc);
 void rproc_report_crash(struct rproc *rproc, enum rproc_crash_type type);
+int rproc_coredump_add_segment(struct rproc *rproc, phys_addr_t addr,
+			       size_t size);
+
+struct firmware;
+int rproc_request_firmware(struct rproc *rproc, const struct firmware **fw,
+			   const char *name);
+void rproc_release_firmware(struct rproc *rproc, const struct firmware *fw);
 
 static inline struct rproc_vdev *vdev_to_rvdev(struct virtio_device *vdev)
 {
@@ -108,6 +108,8 @@ struct rhashtable;
  * @nulls_base: Base value to generate nulls marker
  * @insecure_elasticity: Set to true to disable chain length checks
  * @automatic_shrinking: Enable automatic shrinking of tables
+ * @sync_resize: Expand the table from the inserting context instead of the
+ *	deferred worker; inserts must then be made from process context
  * @locks_mul: Number of bucket locks to allocate per cpu (default: 128)
  * @hashfn: Hash function (default: jhash2 if !(key_len % 4), or jhash)
  * @obj_hashfn: Function to hash object
@@ -124,6 +126,7 @@ struct rhashtable_params {
 	u32			nulls_base;
 	bool			insecure_elasticity;
 	bool			automatic_shrinking;
+	bool			sync_resize;
 	size_t			locks_mul;
 	rht_hashfn_t		hashfn;
 	rht_obj_hashfn_t	obj_hashfn;
@@ -345,6 +348,7 @@ struct bucket_table *rhashtable_insert_slow(struct rhashtable *ht,
 					    struct rhash_head *obj,
 					    struct bucket_table *old_tbl);
 int rhashtable_insert_rehash(struct rhashtable *ht, struct bucket_table *tbl);
+int rhashtable_reserve(struct rhashtable *ht, unsigned int n);
 
 int rhashtable_walk_init(struct rhashtable *ht, struct rhashtable_iter *iter);
 void rhashtable_walk_exit(struct rhashtable_iter *iter);
@@ -576,6 +580,7 @@ static inline int __rhashtable_insert_fast(
 	spinlock_t *lock;
 	unsigned int elasticity;
 	unsigned int hash;
+	bool grow = false;
 	int err;
 
 restart:
@@ -644,16 +649,48 @@ slow_path:
 	rcu_assign_pointer(tbl->buckets[hash], obj);
 
 	atomic_inc(&ht->nelems);
-	if (rht_grow_above_75(ht, tbl))
-		schedule_work(&ht->run_work);
+	if (rht_grow_above_75(ht, tbl)) {
+		if (params.sync_resize)
+			grow = true;
+		else
+			schedule_work(&ht->run_work);
+	}
 
 out:
 	spin_unlock_bh(lock);
 	rcu_read_unlock();
 
+	if (grow)
+		rhashtable_reserve(ht, 0);
+
 	return err;
 }
 
+/* Insert @obj into bucket @hash of @tbl, whose lock is held by the caller */
+static inline bool __rhashtable_insert_locked(struct rhashtable *ht,
+					      struct bucket_table *tbl,
+					      unsigned int hash,
+					      struct rhash_head *obj)
+{
+	unsigned int elasticity = ht->elasticity;
+	struct rhash_head *head;
+
+	if (unlikely(rht_grow_above_max(ht, tbl) ||
+		     rht_grow_above_100(ht, tbl)))
+		return false;
+
+	rht_for_each(head, tbl, hash)
+		if (!--elasticity)
+			return false;
+
+	head = rht_dereference_bucket(tbl->buckets[hash], tbl, hash);
+	RCU_INIT_POINTER(obj->next, head);
+	rcu_assign_pointer(tbl->buckets[hash], obj);
+	atomic_inc(&ht->nelems);
+
+	return true;
+}
+
 /**
  * rhashtable_insert_fast - insert object into hash table
  * @ht:		hash table
@@ -677,6 +714,101 @@ static inline int rhashtable_insert_fast(
 	return __rhashtable_insert_fast(ht, NULL, obj, params);
 }
 
+#define RHT_BATCH_SIZE	16
+
+/**
+ * rhashtable_insert_fast_batch - insert several objects into hash table
+ * @ht:		hash table
+ * @objs:	array of pointers to hash heads inside objects
+ * @n:		number of entries in @objs
+ * @params:	hash table parameters
+ *
+ * Works like calling rhashtable_insert_fast() on every object, but takes
+ * each bucket lock once for all the objects of a group of RHT_BATCH_SIZE
+ * that map to it. Objects that cannot be inserted that way, because a
+ * resize is in progress or the chain is too long, go through
+ * rhashtable_insert_fast() one by one.
+ *
+ * Entries of @objs are set to NULL as their objects are inserted. Returns
+ * 0 once all objects are inserted, or the error of the first object that
+ * could not be inserted; the remaining non-NULL entries were not.
+ *
+ * It is safe to call this function from atomic context, unless the table
+ * uses sync_resize.
+ */
+static inline int rhashtable_insert_fast_batch(
+	struct rhashtable *ht, struct rhash_head **objs, unsigned int n,
+	const struct rhashtable_params params)
+{
+	unsigned int hash[RHT_BATCH_SIZE];
+	struct rhash_head **batch;
+	struct bucket_table *tbl;
+	unsigned int i, j, nr;
+	spinlock_t *lock;
+	bool grow = false;
+	u32 pending;
+	int err = 0;
+
+	if (params.sync_resize)
+		rhashtable_reserve(ht, n);
+
+	for (batch = objs; batch < objs + n; batch += nr) {
+		nr = min_t(unsigned int, objs + n - batch, RHT_BATCH_SIZE);
+		pending = (1U << (nr - 1) << 1) - 1;
+
+		rcu_read_lock();
+		tbl = rht_dereference_rcu(ht->tbl, ht);
+
+		for (i = 0; i < nr; i++)
+			hash[i] = rht_head_hashfn(ht, tbl, batch[i], params);
+
+		while (pending) {
+			i = __ffs(pending);
+			lock = rht_bucket_lock(tbl, hash[i]);
+			spin_lock_bh(lock);
+
+			for (j = i; j < nr; j++) {
+				if (!(pending & (1U << j)) ||
+				    rht_bucket_lock(tbl, hash[j]) != lock)
+					continue;
+
+				pending &= ~(1U << j);
+				if (rcu_access_pointer(tbl->future_tbl))
+					continue;
+				if (__rhashtable_insert_locked(ht, tbl, hash[j],
+							       batch[j]))
+					batch[j] = NULL;
+			}
+
+			if (rht_grow_above_75(ht, tbl))
+				grow = true;
+			spin_unlock_bh(lock);
+		}
+
+		rcu_read_unlock();
+
+		for (i = 0; i < nr; i++) {
+			if (!batch[i])
+				continue;
+
+			err = rhashtable_insert_fast(ht, batch[i], params);
+			if (err)
+				goto out;
+			batch[i] = NULL;
+		}
+	}
+
+out:
+	if (grow) {
+		if (params.sync_resize)
+			rhashtable_reserve(ht, 0);
+		else
+			schedule_work(&ht->run_work);
+	}
+
+	return err;
+}
+
 /**
  * rhashtable_lookup_insert_fast - lookup and insert object into hash table
  * @ht:		hash table
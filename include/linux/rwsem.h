@@ -95,6 +95,13 @@ do {								\
 	__init_rwsem((sem), #sem, &__key);			\
 } while (0)
 
+/* Readers share the lock anyway here, the opt-in only matters on RT */
+#define DECLARE_RWSEM_MULTI_READER(name)	DECLARE_RWSEM(name)
+
+static inline void rwsem_set_multi_reader(struct rw_semaphore *sem)
+{
+}
+
 /*
  * This is the same regardless of which rwsem implementation that is being used.
  * It is just a heuristic meant to be called by somebody alreadying holding the
@@ -14,13 +14,27 @@
  * a read-lock owner to read-lock recursively. This is
  * better for latency, makes the implementation inherently
  * fair and makes it simpler as well.
+ *
+ * Read-mostly locks can opt in to multiple concurrent readers, with
+ * DECLARE_RWSEM_MULTI_READER() or rwsem_set_multi_reader(). Readers then
+ * only count themselves in @readers, writers take @lock, which keeps
+ * priority inheritance for writers and for readers blocked on a writer.
+ * A writer waiting for readers to leave can not boost them though, and
+ * readers keep getting in until the writer owns the lock, so a steady
+ * stream of readers can hold a writer off.
  */
 
 #include <linux/rtmutex.h>
+#include <linux/atomic.h>
+
+#define RWSEM_READER_BIAS	(1U << 31)
+#define RWSEM_WRITER_BIAS	(1U << 30)
 
 struct rw_semaphore {
 	struct rt_mutex		lock;
 	int			read_depth;
+	bool			multi_reader;
+	atomic_t		readers;
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 	struct lockdep_map	dep_map;
 #endif
@@ -30,9 +44,18 @@ struct rw_semaphore {
 	{ .lock = __RT_MUTEX_INITIALIZER(name.lock), \
 	  RW_DEP_MAP_INIT(name) }
 
+#define __RWSEM_MULTI_READER_INITIALIZER(name) \
+	{ .lock = __RT_MUTEX_INITIALIZER(name.lock), \
+	  .multi_reader = true, \
+	  .readers = ATOMIC_INIT(RWSEM_READER_BIAS), \
+	  RW_DEP_MAP_INIT(name) }
+
 #define DECLARE_RWSEM(lockname) \
 	struct rw_semaphore lockname = __RWSEM_INITIALIZER(lockname)
 
+#define DECLARE_RWSEM_MULTI_READER(lockname) \
+	struct rw_semaphore lockname = __RWSEM_MULTI_READER_INITIALIZER(lockname)
+
 extern void  __rt_rwsem_init(struct rw_semaphore *rwsem, const char *name,
 				     struct lock_class_key *key);
 
@@ -65,9 +88,17 @@ extern void __rt_up_read(struct rw_semaphore *rwsem);
 extern void rt_up_read(struct rw_semaphore *rwsem);
 extern void rt_up_write(struct rw_semaphore *rwsem);
 extern void rt_downgrade_write(struct rw_semaphore *rwsem);
+extern void rwsem_set_multi_reader(struct rw_semaphore *rwsem);
 
 #define init_rwsem(sem)		rt_init_rwsem(sem)
-#define rwsem_is_locked(s)	rt_mutex_is_locked(&(s)->lock)
+
+static inline int rwsem_is_locked(struct rw_semaphore *sem)
+{
+	if (sem->multi_reader &&
+	    atomic_read(&sem->readers) != RWSEM_READER_BIAS)
+		return 1;
+	return rt_mutex_is_locked(&sem->lock);
+}
 
 static inline int rwsem_is_contended(struct rw_semaphore *sem)
 {
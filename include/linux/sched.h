@@ -340,6 +340,17 @@ extern void init_idle_bootup_task(struct task_struct *idle);
 
 extern cpumask_var_t cpu_isolated_map;
 
+#ifdef CONFIG_SMP
+/*
+ * hard_isolcpus= cpus are isolated from the scheduler domains and from
+ * housekeeping work: RCU callbacks, unbound timers, swork and the do_timer
+ * duty go to cpu_housekeeping_map.
+ */
+extern bool cpu_hard_isolation;
+extern cpumask_var_t cpu_hard_isolated_map;
+extern cpumask_var_t cpu_housekeeping_map;
+#endif
+
 extern int runqueue_is_locked(int cpu);
 
 #if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
@@ -1250,6 +1261,7 @@ struct sched_statistics {
 	u64			nr_wakeups_affine_attempts;
 	u64			nr_wakeups_passive;
 	u64			nr_wakeups_idle;
+	u64			nr_wakeups_cap;
 };
 #endif
 
@@ -1440,6 +1452,9 @@ struct task_struct {
 	union rcu_special rcu_read_unlock_special;
 	struct list_head rcu_node_entry;
 	struct rcu_node *rcu_blocked_node;
+#ifdef CONFIG_RCU_BOOST
+	unsigned long rcu_blocked_jiffies;
+#endif /* #ifdef CONFIG_RCU_BOOST */
 #endif /* #ifdef CONFIG_PREEMPT_RCU */
 #ifdef CONFIG_TASKS_RCU
 	unsigned long rcu_tasks_nvcsw;
@@ -1823,8 +1838,10 @@ struct task_struct {
 	unsigned long trace_recursion;
 #ifdef CONFIG_WAKEUP_LATENCY_HIST
 	u64 preempt_timestamp_hist;
+	/* timestamps of the hops which led to the last wakeup */
+	u64 wakeup_chain[6];
 #ifdef CONFIG_MISSED_TIMER_OFFSETS_HIST
-	long timer_offset;
+	s64 timer_offset;
 #endif
 #endif
 #endif /* CONFIG_TRACING */
@@ -3377,4 +3394,16 @@ static inline unsigned long rlimit_max(unsigned int limit)
 	return task_rlimit_max(current, limit);
 }
 
+#ifdef CONFIG_CPU_FREQ
+struct update_util_data {
+	void (*func)(struct update_util_data *data,
+		     u64 time, unsigned long util, unsigned long max);
+};
+
+void cpufreq_add_update_util_hook(int cpu, struct update_util_data *data,
+			void (*func)(struct update_util_data *data, u64 time,
+				     unsigned long util, unsigned long max));
+void cpufreq_remove_update_util_hook(int cpu);
+#endif /* CONFIG_CPU_FREQ */
+
 #endif
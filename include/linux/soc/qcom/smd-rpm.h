@@ -27,9 +27,17 @@ struct qcom_smd_rpm;
 #define QCOM_SMD_RPM_SPDM	0x63707362
 #define QCOM_SMD_RPM_VSA	0x00617376
 
+typedef void (*qcom_rpm_smd_cb_t)(void *data, int status);
+
 int qcom_rpm_smd_write(struct qcom_smd_rpm *rpm,
 		       int state,
 		       u32 resource_type, u32 resource_id,
 		       void *buf, size_t count);
 
+int qcom_rpm_smd_write_async(struct qcom_smd_rpm *rpm,
+			     int state,
+			     u32 resource_type, u32 resource_id,
+			     void *buf, size_t count,
+			     qcom_rpm_smd_cb_t cb, void *cb_data);
+
 #endif
@@ -2,6 +2,7 @@
 #define __QCOM_SMD_H__
 
 #include <linux/device.h>
+#include <linux/kthread.h>
 #include <linux/mod_devicetable.h>
 
 struct qcom_smd;
@@ -40,6 +41,9 @@ enum smd_channel_state {
  * @bounce_buffer:	bounce buffer for reading wrapped packets
  * @cb:			callback function registered for this channel
  * @recv_lock:		guard for rx info modifications and cb pointer
+ * @rx_task:		dedicated rx thread, or NULL if rx is handled in irq
+ * @rx_worker:		kthread worker run by @rx_task
+ * @rx_work:		work item for processing rx on @rx_worker
  * @pkt_size:		size of the currently handled packet
  * @list:		lite entry for @channels in qcom_smd_edge
  */
@@ -68,6 +72,10 @@ struct qcom_smd_channel {
 
 	spinlock_t recv_lock;
 
+	struct task_struct *rx_task;
+	struct kthread_worker rx_worker;
+	struct kthread_work rx_work;
+
 	int pkt_size;
 
 	struct list_head list;
@@ -28,6 +28,9 @@
 
 struct rpc_inode;
 
+/* Maximum number of transports an rpc_clnt spreads its requests over */
+#define RPC_MAX_XPRTS		16
+
 /*
  * The high-level client handle
  */
@@ -38,6 +41,9 @@ struct rpc_clnt {
 	struct list_head	cl_tasks;	/* List of tasks */
 	spinlock_t		cl_lock;	/* spinlock */
 	struct rpc_xprt __rcu *	cl_xprt;	/* transport */
+	unsigned int		cl_nr_xprts;	/* extra transports */
+	unsigned int		cl_xprt_next;	/* transport to try first */
+	struct rpc_xprt *	cl_xprts[RPC_MAX_XPRTS - 1];
 	struct rpc_procinfo *	cl_procinfo;	/* procedure info */
 	u32			cl_prog,	/* RPC program number */
 				cl_vers,	/* RPC version number */
@@ -121,6 +127,7 @@ struct rpc_create_args {
 	unsigned long		flags;
 	char			*client_name;
 	struct svc_xprt		*bc_xprt;	/* NFSv4.1 backchannel */
+	unsigned int		nconnect;	/* number of transports */
 };
 
 /* Values for "flags" field */
@@ -44,6 +44,7 @@ struct rpc_task {
 	atomic_t		tk_count;	/* Reference count */
 	struct list_head	tk_task;	/* global list of tasks */
 	struct rpc_clnt *	tk_client;	/* RPC client */
+	struct rpc_xprt *	tk_xprt;	/* Transport, if not cl_xprt */
 	struct rpc_rqst *	tk_rqstp;	/* RPC request */
 
 	/*
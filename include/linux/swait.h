@@ -37,6 +37,9 @@ struct task_struct;
 struct swait_queue_head {
 	raw_spinlock_t		lock;
 	struct list_head	task_list;
+#ifdef CONFIG_SCHED_DEBUG
+	u64			hold_start;	/* for swait_max_hold_ns */
+#endif
 };
 
 struct swait_queue {
@@ -84,10 +87,19 @@ static inline int swait_active(struct swait_queue_head *q)
 	return !list_empty(&q->task_list);
 }
 
+#ifdef CONFIG_SCHED_DEBUG
+extern void swait_hold_start(struct swait_queue_head *q);
+extern void swait_hold_end(struct swait_queue_head *q);
+#else
+static inline void swait_hold_start(struct swait_queue_head *q) { }
+static inline void swait_hold_end(struct swait_queue_head *q) { }
+#endif
+
 extern void swake_up(struct swait_queue_head *q);
 extern void swake_up_all(struct swait_queue_head *q);
 extern void swake_up_locked(struct swait_queue_head *q);
-extern void swake_up_all_locked(struct swait_queue_head *q);
+extern void swake_up_all_locked(struct swait_queue_head *q,
+				unsigned long *flags);
 
 extern void __prepare_to_swait(struct swait_queue_head *q, struct swait_queue *wait);
 extern void prepare_to_swait(struct swait_queue_head *q, struct swait_queue *wait, int state);
@@ -110,6 +110,7 @@ struct thermal_zone_device_ops {
 	int (*set_trip_hyst) (struct thermal_zone_device *, int, int);
 	int (*get_crit_temp) (struct thermal_zone_device *, int *);
 	int (*set_emul_temp) (struct thermal_zone_device *, int);
+	int (*set_trips) (struct thermal_zone_device *, int, int);
 	int (*get_trend) (struct thermal_zone_device *, int,
 			  enum thermal_trend *);
 	int (*notify) (struct thermal_zone_device *, int,
@@ -196,6 +197,8 @@ struct thermal_zone_device {
 	int temperature;
 	int last_temperature;
 	int emul_temperature;
+	int prev_low_trip;
+	int prev_high_trip;
 	int passive;
 	unsigned int forced_passive;
 	atomic_t need_update;
@@ -333,11 +336,15 @@ struct thermal_genl_event {
  * @get_trend: a pointer to a function that reads the sensor temperature trend.
  * @set_emul_temp: a pointer to a function that sets sensor emulated
  *		   temperature.
+ * @set_trips: a pointer to a function that sets a temperature window. When
+ *	       the temperature leaves this window the sensor must call
+ *	       thermal_zone_device_update().
  */
 struct thermal_zone_of_device_ops {
 	int (*get_temp)(void *, int *);
 	int (*get_trend)(void *, long *);
 	int (*set_emul_temp)(void *, int);
+	int (*set_trips)(void *, int, int);
 };
 
 /**
@@ -106,7 +106,7 @@ static inline int test_ti_thread_flag(struct thread_info *ti, int flag)
 #define tif_need_resched()	(test_thread_flag(TIF_NEED_RESCHED) || \
 				 test_thread_flag(TIF_NEED_RESCHED_LAZY))
 #define tif_need_resched_now()	(test_thread_flag(TIF_NEED_RESCHED))
-#define tif_need_resched_lazy()	test_thread_flag(TIF_NEED_RESCHED_LAZY))
+#define tif_need_resched_lazy()	test_thread_flag(TIF_NEED_RESCHED_LAZY)
 
 #else
 #define tif_need_resched()	test_thread_flag(TIF_NEED_RESCHED)
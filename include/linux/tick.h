@@ -147,20 +147,11 @@ static inline void tick_nohz_full_add_cpus_to(struct cpumask *mask)
 		cpumask_or(mask, mask, tick_nohz_full_mask);
 }
 
-static inline int housekeeping_any_cpu(void)
-{
-	return cpumask_any_and(housekeeping_mask, cpu_online_mask);
-}
-
 extern void tick_nohz_full_kick(void);
 extern void tick_nohz_full_kick_cpu(int cpu);
 extern void tick_nohz_full_kick_all(void);
 extern void __tick_nohz_task_switch(void);
 #else
-static inline int housekeeping_any_cpu(void)
-{
-	return smp_processor_id();
-}
 static inline bool tick_nohz_full_enabled(void) { return false; }
 static inline bool tick_nohz_full_cpu(int cpu) { return false; }
 static inline void tick_nohz_full_add_cpus_to(struct cpumask *mask) { }
@@ -170,31 +161,46 @@ static inline void tick_nohz_full_kick_all(void) { }
 static inline void __tick_nohz_task_switch(void) { }
 #endif
 
+static inline bool housekeeping_restricted(void)
+{
+#ifdef CONFIG_SMP
+	if (cpu_hard_isolation)
+		return true;
+#endif
+	return tick_nohz_full_enabled();
+}
+
 static inline const struct cpumask *housekeeping_cpumask(void)
 {
 #ifdef CONFIG_NO_HZ_FULL
 	if (tick_nohz_full_enabled())
 		return housekeeping_mask;
+#endif
+#ifdef CONFIG_SMP
+	if (cpu_hard_isolation)
+		return cpu_housekeeping_map;
 #endif
 	return cpu_possible_mask;
 }
 
+static inline int housekeeping_any_cpu(void)
+{
+	if (housekeeping_restricted())
+		return cpumask_any_and(housekeeping_cpumask(), cpu_online_mask);
+	return smp_processor_id();
+}
+
 static inline bool is_housekeeping_cpu(int cpu)
 {
-#ifdef CONFIG_NO_HZ_FULL
-	if (tick_nohz_full_enabled())
-		return cpumask_test_cpu(cpu, housekeeping_mask);
-#endif
+	if (housekeeping_restricted())
+		return cpumask_test_cpu(cpu, housekeeping_cpumask());
 	return true;
 }
 
 static inline void housekeeping_affine(struct task_struct *t)
 {
-#ifdef CONFIG_NO_HZ_FULL
-	if (tick_nohz_full_enabled())
-		set_cpus_allowed_ptr(t, housekeeping_mask);
-
-#endif
+	if (housekeeping_restricted())
+		set_cpus_allowed_ptr(t, housekeeping_cpumask());
 }
 
 static inline void tick_nohz_task_switch(void)
@@ -1,10 +1,10 @@
 #ifndef _LINUX_SWORK_H
 #define _LINUX_SWORK_H
 
-#include <linux/list.h>
+#include <linux/llist.h>
 
 struct swork_event {
-	struct list_head item;
+	struct llist_node node;
 	unsigned long flags;
 	void (*func)(struct swork_event *);
 };
@@ -17,6 +17,9 @@ static inline void INIT_SWORK(struct swork_event *event,
 }
 
 bool swork_queue(struct swork_event *sev);
+bool swork_queue_on(int cpu, struct swork_event *sev);
+
+int swork_set_priority(int cpu, int policy, int prio);
 
 int swork_get(void);
 void swork_put(void);
@@ -147,6 +147,22 @@ static inline struct net *nf_ct_net(const struct nf_conn *ct)
 	return read_pnet(&ct->ct_net);
 }
 
+/*
+ * Number of conntrack entries in @net. The per-cpu deltas are folded in
+ * every NF_CT_COUNT_BATCH updates, so this can be off by that much per
+ * cpu, which is fine for comparing against nf_conntrack_max.
+ */
+#define NF_CT_COUNT_BATCH	32
+
+static inline unsigned int nf_conntrack_count(struct net *net)
+{
+	return percpu_counter_read_positive(&net->ct.count);
+}
+
+struct ctl_table;
+int nf_conntrack_count_sysctl(struct ctl_table *table, int write,
+			      void __user *buffer, size_t *lenp, loff_t *ppos);
+
 /* Alter reply tuple (maybe alter helper). */
 void nf_conntrack_alter_reply(struct nf_conn *ct,
 			      const struct nf_conntrack_tuple *newreply);
@@ -286,6 +286,10 @@ struct sock *__udp6_lib_lookup(struct net *net,
 	if (__lite) SNMP_INC_STATS_USER((net)->mib.udplite_stats_in6, field);  \
 	else	    SNMP_INC_STATS_USER((net)->mib.udp_stats_in6, field);      \
 } while(0)
+#define UDP6_ADD_STATS_BH(net, field, val, __lite)	    do { \
+	if (__lite) SNMP_ADD_STATS_BH((net)->mib.udplite_stats_in6, field, val);\
+	else	    SNMP_ADD_STATS_BH((net)->mib.udp_stats_in6, field, val);    \
+} while (0)
 
 #if IS_ENABLED(CONFIG_IPV6)
 #define UDPX_INC_STATS_BH(sk, field)					\
@@ -332,5 +336,6 @@ void udp_init(void);
 void udp_encap_enable(void);
 #if IS_ENABLED(CONFIG_IPV6)
 void udpv6_encap_enable(void);
+void udpv6_gro_enable(void);
 #endif
 #endif	/* _UDP_H */
@@ -156,6 +156,11 @@ struct audio_client {
 	uint64_t         time_stamp;
 	atomic_t         cmd_response;
 	bool             perf_mode;
+	/* commands sent between q6asm_async_begin() and _end() */
+	bool             cmd_async;
+	uint32_t         cmd_seq;
+	atomic_t         cmd_done_seq;
+	atomic_t         cmd_async_err;
 };
 
 void q6asm_audio_client_free(struct audio_client *ac);
@@ -228,6 +233,10 @@ int q6asm_cmd(struct audio_client *ac, int cmd);
 
 int q6asm_cmd_nowait(struct audio_client *ac, int cmd);
 
+void q6asm_async_begin(struct audio_client *ac);
+
+int q6asm_async_end(struct audio_client *ac);
+
 void *q6asm_is_cpu_buf_avail(int dir, struct audio_client *ac,
 				uint32_t *size, uint32_t *idx);
 
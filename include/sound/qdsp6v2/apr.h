@@ -97,6 +97,10 @@ struct apr_hdr {
 
 #define APR_NAME_MAX		0x40
 
+/* Preallocated command packets per service */
+#define APR_PKT_POOL_CNT	4
+#define APR_PKT_POOL_SIZE	512
+
 #define RESET_EVENTS		0xFFFFFFFF
 
 #define LPASS_RESTART_EVENT	0x1000
@@ -133,6 +137,8 @@ struct apr_svc {
 	void *priv;
 	struct mutex m_lock;
 	spinlock_t w_lock;
+	void *pkt_pool;
+	unsigned long pkt_free;
 };
 
 struct apr_client {
@@ -157,6 +163,9 @@ inline int apr_fill_hdr(void *handle, uint32_t *buf, uint16_t src_port,
 			uint32_t token, uint32_t opcode, uint16_t len);
 
 int apr_send_pkt(void *handle, uint32_t *buf);
+void apr_pkt_pool_init(struct apr_svc *svc);
+void *apr_pkt_alloc(void *handle, size_t size, gfp_t gfp);
+void apr_pkt_free(void *handle, void *pkt);
 int apr_deregister(void *handle);
 void change_q6_state(int state);
 void q6audio_dsp_not_responding(void);
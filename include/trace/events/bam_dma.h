@@ -0,0 +1,35 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM bam_dma
+
+#if !defined(_TRACE_BAM_DMA_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_BAM_DMA_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(bam_dma_complete,
+
+	TP_PROTO(struct device *dev, u32 pipe, u64 latency),
+
+	TP_ARGS(dev, pipe, latency),
+
+	TP_STRUCT__entry(
+		__string(	dev,		dev_name(dev)	)
+		__field(	u32,		pipe		)
+		__field(	u64,		latency		)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(dev));
+		__entry->pipe = pipe;
+		__entry->latency = latency;
+	),
+
+	TP_printk("%s pipe=%u irq-to-callback=%llu ns",
+		  __get_str(dev), __entry->pipe,
+		  (unsigned long long)__entry->latency)
+);
+
+#endif /* _TRACE_BAM_DMA_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
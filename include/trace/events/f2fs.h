@@ -542,6 +542,81 @@ TRACE_EVENT(f2fs_background_gc,
 		__entry->free)
 );
 
+TRACE_EVENT(f2fs_gc_begin,
+
+	TP_PROTO(struct super_block *sb, bool sync, int gc_type,
+			unsigned int free_sec, unsigned int prefree,
+			unsigned int reserved_sec),
+
+	TP_ARGS(sb, sync, gc_type, free_sec, prefree, reserved_sec),
+
+	TP_STRUCT__entry(
+		__field(dev_t,	dev)
+		__field(bool,	sync)
+		__field(int,	gc_type)
+		__field(unsigned int,	free_sec)
+		__field(unsigned int,	prefree)
+		__field(unsigned int,	reserved_sec)
+	),
+
+	TP_fast_assign(
+		__entry->dev		= sb->s_dev;
+		__entry->sync		= sync;
+		__entry->gc_type	= gc_type;
+		__entry->free_sec	= free_sec;
+		__entry->prefree	= prefree;
+		__entry->reserved_sec	= reserved_sec;
+	),
+
+	TP_printk("dev = (%d,%d), sync = %d, gc_type = %s, free_sec = %u, "
+		"prefree = %u, reserved_sec = %u",
+		show_dev(__entry),
+		__entry->sync,
+		show_gc_type(__entry->gc_type),
+		__entry->free_sec,
+		__entry->prefree,
+		__entry->reserved_sec)
+);
+
+TRACE_EVENT(f2fs_gc_end,
+
+	TP_PROTO(struct super_block *sb, int ret, int gc_type,
+			unsigned int victims, int sec_freed,
+			unsigned int free_sec, unsigned int prefree),
+
+	TP_ARGS(sb, ret, gc_type, victims, sec_freed, free_sec, prefree),
+
+	TP_STRUCT__entry(
+		__field(dev_t,	dev)
+		__field(int,	ret)
+		__field(int,	gc_type)
+		__field(unsigned int,	victims)
+		__field(int,	sec_freed)
+		__field(unsigned int,	free_sec)
+		__field(unsigned int,	prefree)
+	),
+
+	TP_fast_assign(
+		__entry->dev		= sb->s_dev;
+		__entry->ret		= ret;
+		__entry->gc_type	= gc_type;
+		__entry->victims	= victims;
+		__entry->sec_freed	= sec_freed;
+		__entry->free_sec	= free_sec;
+		__entry->prefree	= prefree;
+	),
+
+	TP_printk("dev = (%d,%d), ret = %d, gc_type = %s, victims = %u, "
+		"sec_freed = %d, free_sec = %u, prefree = %u",
+		show_dev(__entry),
+		__entry->ret,
+		show_gc_type(__entry->gc_type),
+		__entry->victims,
+		__entry->sec_freed,
+		__entry->free_sec,
+		__entry->prefree)
+);
+
 TRACE_EVENT(f2fs_get_victim,
 
 	TP_PROTO(struct super_block *sb, int type, int gc_type,
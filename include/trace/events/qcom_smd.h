@@ -0,0 +1,92 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM qcom_smd
+
+#if !defined(_TRACE_QCOM_SMD_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_QCOM_SMD_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(qcom_smd_channel_state,
+
+	TP_PROTO(const char *name, int state, bool remote),
+
+	TP_ARGS(name, state, remote),
+
+	TP_STRUCT__entry(
+		__string(	name,		name		)
+		__field(	int,		state		)
+		__field(	bool,		remote		)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->state = state;
+		__entry->remote = remote;
+	),
+
+	TP_printk("%s %s state=%d", __get_str(name),
+		  __entry->remote ? "remote" : "local", __entry->state)
+);
+
+DECLARE_EVENT_CLASS(qcom_smd_packet,
+
+	TP_PROTO(const char *name, size_t len),
+
+	TP_ARGS(name, len),
+
+	TP_STRUCT__entry(
+		__string(	name,		name		)
+		__field(	size_t,		len		)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->len = len;
+	),
+
+	TP_printk("%s len=%zu", __get_str(name), __entry->len)
+);
+
+DEFINE_EVENT(qcom_smd_packet, qcom_smd_send,
+
+	TP_PROTO(const char *name, size_t len),
+
+	TP_ARGS(name, len)
+);
+
+DEFINE_EVENT(qcom_smd_packet, qcom_smd_recv,
+
+	TP_PROTO(const char *name, size_t len),
+
+	TP_ARGS(name, len)
+);
+
+TRACE_EVENT(qcom_smd_send_wait,
+
+	TP_PROTO(const char *name, size_t len, size_t avail, u64 wait),
+
+	TP_ARGS(name, len, avail, wait),
+
+	TP_STRUCT__entry(
+		__string(	name,		name		)
+		__field(	size_t,		len		)
+		__field(	size_t,		avail		)
+		__field(	u64,		wait		)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->len = len;
+		__entry->avail = avail;
+		__entry->wait = wait;
+	),
+
+	TP_printk("%s len=%zu avail=%zu waited=%llu ns", __get_str(name),
+		  __entry->len, __entry->avail,
+		  (unsigned long long)__entry->wait)
+);
+
+#endif /* _TRACE_QCOM_SMD_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,66 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM qcom_smd_rpm
+
+#if !defined(_TRACE_QCOM_SMD_RPM_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_QCOM_SMD_RPM_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(qcom_rpm_smd_send,
+
+	TP_PROTO(int state, u32 type, u32 id, u32 msg_id, size_t count),
+
+	TP_ARGS(state, type, id, msg_id, count),
+
+	TP_STRUCT__entry(
+		__field(	int,		state		)
+		__field(	u32,		type		)
+		__field(	u32,		id		)
+		__field(	u32,		msg_id		)
+		__field(	size_t,		count		)
+	),
+
+	TP_fast_assign(
+		__entry->state = state;
+		__entry->type = type;
+		__entry->id = id;
+		__entry->msg_id = msg_id;
+		__entry->count = count;
+	),
+
+	TP_printk("state=%d type=0x%08x id=%u msg_id=%u count=%zu",
+		  __entry->state, __entry->type, __entry->id,
+		  __entry->msg_id, __entry->count)
+);
+
+TRACE_EVENT(qcom_rpm_smd_ack,
+
+	TP_PROTO(u32 type, u32 id, u32 msg_id, int status, u64 latency),
+
+	TP_ARGS(type, id, msg_id, status, latency),
+
+	TP_STRUCT__entry(
+		__field(	u32,		type		)
+		__field(	u32,		id		)
+		__field(	u32,		msg_id		)
+		__field(	int,		status		)
+		__field(	u64,		latency		)
+	),
+
+	TP_fast_assign(
+		__entry->type = type;
+		__entry->id = id;
+		__entry->msg_id = msg_id;
+		__entry->status = status;
+		__entry->latency = latency;
+	),
+
+	TP_printk("type=0x%08x id=%u msg_id=%u status=%d send-to-ack=%llu ns",
+		  __entry->type, __entry->id, __entry->msg_id,
+		  __entry->status, (unsigned long long)__entry->latency)
+);
+
+#endif /* _TRACE_QCOM_SMD_RPM_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,58 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM qcom_smem
+
+#if !defined(_TRACE_QCOM_SMEM_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_QCOM_SMEM_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(qcom_smem_alloc,
+
+	TP_PROTO(unsigned host, unsigned item, size_t size, int ret),
+
+	TP_ARGS(host, item, size, ret),
+
+	TP_STRUCT__entry(
+		__field(	unsigned,	host		)
+		__field(	unsigned,	item		)
+		__field(	size_t,		size		)
+		__field(	int,		ret		)
+	),
+
+	TP_fast_assign(
+		__entry->host = host;
+		__entry->item = item;
+		__entry->size = size;
+		__entry->ret = ret;
+	),
+
+	TP_printk("host=%d item=%u size=%zu ret=%d", (int)__entry->host,
+		  __entry->item, __entry->size, __entry->ret)
+);
+
+TRACE_EVENT(qcom_smem_get,
+
+	TP_PROTO(unsigned host, unsigned item, int ret),
+
+	TP_ARGS(host, item, ret),
+
+	TP_STRUCT__entry(
+		__field(	unsigned,	host		)
+		__field(	unsigned,	item		)
+		__field(	int,		ret		)
+	),
+
+	TP_fast_assign(
+		__entry->host = host;
+		__entry->item = item;
+		__entry->ret = ret;
+	),
+
+	TP_printk("host=%d item=%u ret=%d", (int)__entry->host,
+		  __entry->item, __entry->ret)
+);
+
+#endif /* _TRACE_QCOM_SMEM_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
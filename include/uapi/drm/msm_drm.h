@@ -39,6 +39,15 @@
 #define MSM_PIPE_2D1         0x02
 #define MSM_PIPE_3D0         0x10
 
+/* The pipe-id just uses the lower bits, so can be OR'd with flags in
+ * the upper 16 bits (which could be extended further, if needed, maybe
+ * we extend/overload the pipe-id some day to deal with multiple rings,
+ * but even then I don't think we need the full lower 16 bits).
+ */
+#define MSM_PIPE_ID_MASK     0xffff
+#define MSM_PIPE_ID(x)       ((x) & MSM_PIPE_ID_MASK)
+#define MSM_PIPE_FLAGS(x)    ((x) & ~MSM_PIPE_ID_MASK)
+
 /* timeouts are specified in clock-monotonic absolute times (to simplify
  * restarting interrupted ioctls).  The following struct is logically the
  * same as 'struct timespec' but 32/64b ABI safe.
@@ -69,12 +78,14 @@ struct drm_msm_param {
 #define MSM_BO_CACHED        0x00010000
 #define MSM_BO_WC            0x00020000
 #define MSM_BO_UNCACHED      0x00040000
+#define MSM_BO_CACHED_COHERENT 0x00080000   /* only if the gpu is io-coherent */
 
 #define MSM_BO_FLAGS         (MSM_BO_SCANOUT | \
                               MSM_BO_GPU_READONLY | \
                               MSM_BO_CACHED | \
                               MSM_BO_WC | \
-                              MSM_BO_UNCACHED)
+                              MSM_BO_UNCACHED | \
+                              MSM_BO_CACHED_COHERENT)
 
 struct drm_msm_gem_new {
 	__u64 size;           /* in */
@@ -94,14 +105,25 @@ struct drm_msm_gem_info {
 
 #define MSM_PREP_FLAGS       (MSM_PREP_READ | MSM_PREP_WRITE | MSM_PREP_NOSYNC)
 
+/* For MSM_BO_CACHED bo's, cpu_prep invalidates the cpu cache for the
+ * range the cpu is going to read, and cpu_fini writes back the range the
+ * cpu wrote.  A size of zero covers the bo from offset to its end, which
+ * is also what older userspace, that doesn't pass a range, gets.  A
+ * cpu_fini with no op counts as MSM_PREP_WRITE.
+ */
 struct drm_msm_gem_cpu_prep {
 	__u32 handle;         /* in */
 	__u32 op;             /* in, mask of MSM_PREP_x */
 	struct drm_msm_timespec timeout;   /* in */
+	__u64 offset;         /* in, start of the range the cpu accesses */
+	__u64 size;           /* in, size of the range, or zero */
 };
 
 struct drm_msm_gem_cpu_fini {
 	__u32 handle;         /* in */
+	__u32 op;             /* in, mask of MSM_PREP_x */
+	__u64 offset;         /* in, start of the range the cpu accessed */
+	__u64 size;           /* in, size of the range, or zero */
 };
 
 /*
@@ -173,14 +195,29 @@ struct drm_msm_gem_submit_bo {
 /* Each cmdstream submit consists of a table of buffers involved, and
  * one or more cmdstream buffers.  This allows for conditional execution
  * (context-restore), and IB buffers needed for per tile/bin draw cmds.
+ *
+ * With MSM_SUBMIT_FENCE_FD_OUT, a sync fence fd signaled when the submit
+ * completes is returned in fence_fd, so it can be handed to other drivers
+ * or processes without waiting on the fence first.
+ *
+ * With MSM_SUBMIT_PRESUMED, userspace keeps the bo table between submits
+ * and the kernel writes the current address back to 'presumed' for every
+ * entry that was stale.  Once the addresses settle, submits skip reloc
+ * processing altogether.
  */
+#define MSM_SUBMIT_PRESUMED     0x10000000
+#define MSM_SUBMIT_FENCE_FD_OUT 0x20000000
+#define MSM_SUBMIT_FLAGS        (MSM_SUBMIT_PRESUMED | MSM_SUBMIT_FENCE_FD_OUT)
+
 struct drm_msm_gem_submit {
-	__u32 pipe;           /* in, MSM_PIPE_x */
+	__u32 pipe;           /* in, MSM_PIPE_x | MSM_SUBMIT_x */
 	__u32 fence;          /* out */
 	__u32 nr_bos;         /* in, number of submit_bo's */
 	__u32 nr_cmds;        /* in, number of submit_cmd's */
 	__u64 __user bos;     /* in, ptr to array of submit_bo's */
 	__u64 __user cmds;    /* in, ptr to array of submit_cmd's */
+	__s32 fence_fd;       /* out, if MSM_SUBMIT_FENCE_FD_OUT */
+	__u32 pad;
 };
 
 /* The normal way to synchronize with the GPU is just to CPU_PREP on
@@ -196,6 +233,24 @@ struct drm_msm_wait_fence {
 	struct drm_msm_timespec timeout;   /* in */
 };
 
+/*
+ * Purgeable buffers:
+ *
+ * A bo marked MSM_MADV_DONTNEED that is not busy may have its backing
+ * pages dropped under memory pressure.  Marking it MSM_MADV_WILLNEED
+ * again tells, in 'retained', whether the pages (and contents) are still
+ * there.  A purged bo can't be used again, it can only be freed.
+ */
+#define MSM_MADV_WILLNEED 0       /* backing pages are needed, status returned in 'retained' */
+#define MSM_MADV_DONTNEED 1       /* backing pages not needed */
+#define __MSM_MADV_PURGED 2       /* internal state */
+
+struct drm_msm_gem_madvise {
+	__u32 handle;         /* in, GEM handle */
+	__u32 madv;           /* in, MSM_MADV_x */
+	__u32 retained;       /* out, whether backing store still exists */
+};
+
 #define DRM_MSM_GET_PARAM              0x00
 /* placeholder:
 #define DRM_MSM_SET_PARAM              0x01
@@ -206,7 +261,8 @@ struct drm_msm_wait_fence {
 #define DRM_MSM_GEM_CPU_FINI           0x05
 #define DRM_MSM_GEM_SUBMIT             0x06
 #define DRM_MSM_WAIT_FENCE             0x07
-#define DRM_MSM_NUM_IOCTLS             0x08
+#define DRM_MSM_GEM_MADVISE            0x08
+#define DRM_MSM_NUM_IOCTLS             0x09
 
 #define DRM_IOCTL_MSM_GET_PARAM        DRM_IOWR(DRM_COMMAND_BASE + DRM_MSM_GET_PARAM, struct drm_msm_param)
 #define DRM_IOCTL_MSM_GEM_NEW          DRM_IOWR(DRM_COMMAND_BASE + DRM_MSM_GEM_NEW, struct drm_msm_gem_new)
@@ -215,5 +271,6 @@ struct drm_msm_wait_fence {
 #define DRM_IOCTL_MSM_GEM_CPU_FINI     DRM_IOW (DRM_COMMAND_BASE + DRM_MSM_GEM_CPU_FINI, struct drm_msm_gem_cpu_fini)
 #define DRM_IOCTL_MSM_GEM_SUBMIT       DRM_IOWR(DRM_COMMAND_BASE + DRM_MSM_GEM_SUBMIT, struct drm_msm_gem_submit)
 #define DRM_IOCTL_MSM_WAIT_FENCE       DRM_IOW (DRM_COMMAND_BASE + DRM_MSM_WAIT_FENCE, struct drm_msm_wait_fence)
+#define DRM_IOCTL_MSM_GEM_MADVISE      DRM_IOWR(DRM_COMMAND_BASE + DRM_MSM_GEM_MADVISE, struct drm_msm_gem_madvise)
 
 #endif /* __MSM_DRM_H__ */
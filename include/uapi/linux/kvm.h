@@ -831,6 +831,8 @@ struct kvm_ppc_smmu_info {
 #define KVM_CAP_GUEST_DEBUG_HW_WPS 120
 #define KVM_CAP_SPLIT_IRQCHIP 121
 #define KVM_CAP_IOEVENTFD_ANY_LENGTH 122
+#define KVM_CAP_HALT_POLL 123
+#define KVM_CAP_ARM_RT_PRIO 124
 
 #ifdef KVM_CAP_IRQ_ROUTING
 
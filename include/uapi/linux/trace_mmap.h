@@ -0,0 +1,52 @@
+#ifndef _UAPI_TRACE_MMAP_H_
+#define _UAPI_TRACE_MMAP_H_
+
+#include <linux/types.h>
+
+/**
+ * struct trace_buffer_meta - Ring-buffer Meta-page description
+ * @meta_page_size:	Size of this meta-page.
+ * @meta_struct_len:	Size of this structure.
+ * @subbuf_size:	Size of each sub-buffer.
+ * @nr_subbufs:		Number of subbfs in the ring-buffer, including the reader.
+ * @reader.lost_events:	Number of events lost before the reader sub-buffer.
+ * @reader.id:		ID of the sub-buffer user space can read.
+ * @reader.read:	Offset of the first unread event in the reader data.
+ * @reader.commit:	Offset of the end of the committed reader data.
+ * @flags:		Flags for the meta-page, none defined yet.
+ * @entries:		Number of entries in the ring-buffer.
+ * @overrun:		Number of entries lost in the ring-buffer.
+ * @read:		Number of entries that have been read.
+ *
+ * The meta-page is the first page of the mapping, the sub-buffers follow
+ * it in ID order. The events of the reader sub-buffer between
+ * @reader.read and @reader.commit belong to user space until the next
+ * TRACE_MMAP_IOCTL_GET_READER, which consumes them and hands out the
+ * next ones. Events before @reader.read are still on the sub-buffer, so
+ * time stamps can be computed by walking the deltas from its start.
+ */
+struct trace_buffer_meta {
+	__u32		meta_page_size;
+	__u32		meta_struct_len;
+
+	__u32		subbuf_size;
+	__u32		nr_subbufs;
+
+	struct {
+		__u64	lost_events;
+		__u32	id;
+		__u32	read;
+		__u32	commit;
+		__u32	__reserved;
+	} reader;
+
+	__u64	flags;
+
+	__u64	entries;
+	__u64	overrun;
+	__u64	read;
+};
+
+#define TRACE_MMAP_IOCTL_GET_READER		_IO('R', 0x20)
+
+#endif /* _UAPI_TRACE_MMAP_H_ */
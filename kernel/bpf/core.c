@@ -691,6 +691,20 @@ static int bpf_check_tail_call(const struct bpf_prog *fp)
 	return 0;
 }
 
+/**
+ *	bpf_prog_run_interp - run a BPF program through the interpreter
+ *	@fp: bpf_prog to run, JITed or not
+ *	@ctx: the data to run it on
+ *
+ * Lets the JIT self tests check and time a JITed program against the
+ * interpreter running the very same instructions.
+ */
+unsigned int bpf_prog_run_interp(const struct bpf_prog *fp, const void *ctx)
+{
+	return __bpf_prog_run((void *)ctx, fp->insnsi);
+}
+EXPORT_SYMBOL_GPL(bpf_prog_run_interp);
+
 /**
  *	bpf_prog_select_runtime - select exec runtime for BPF program
  *	@fp: bpf_prog populated with internal BPF program
@@ -13,38 +13,171 @@
 #include <linux/jhash.h>
 #include <linux/filter.h>
 #include <linux/vmalloc.h>
+#include "percpu_freelist.h"
+
+struct bucket {
+	struct hlist_head head;
+	raw_spinlock_t lock;
+};
 
 struct bpf_htab {
 	struct bpf_map map;
-	struct hlist_head *buckets;
-	raw_spinlock_t lock;
-	u32 count;	/* number of elements in this hashtable */
+	struct bucket *buckets;
+	void *elems;
+	struct pcpu_freelist freelist;
+	struct htab_elem *__percpu *extra_elems;
+	atomic_t count;	/* number of elements in this hashtable */
 	u32 n_buckets;	/* number of hash buckets */
 	u32 elem_size;	/* size of each element in bytes */
 };
 
 /* each htab element is struct htab_elem + key + value */
 struct htab_elem {
-	struct hlist_node hash_node;
+	union {
+		struct hlist_node hash_node;
+		struct {
+			/* keeps hash_node.next intact for RCU readers that
+			 * still walk a deleted element
+			 */
+			void *padding;
+			union {
+				struct bpf_htab *htab;
+				struct pcpu_freelist_node fnode;
+			};
+		};
+	};
 	struct rcu_head rcu;
 	u32 hash;
 	char key[0] __aligned(8);
 };
 
+static bool htab_is_prealloc(const struct bpf_htab *htab)
+{
+	return !(htab->map.map_flags & BPF_F_NO_PREALLOC);
+}
+
+static bool htab_is_percpu(const struct bpf_htab *htab)
+{
+	return htab->map.map_type == BPF_MAP_TYPE_PERCPU_HASH;
+}
+
+static inline void htab_elem_set_ptr(struct htab_elem *l, u32 key_size,
+				     void __percpu *pptr)
+{
+	*(void __percpu **)(l->key + round_up(key_size, 8)) = pptr;
+}
+
+static inline void __percpu *htab_elem_get_ptr(struct htab_elem *l,
+					       u32 key_size)
+{
+	return *(void __percpu **)(l->key + round_up(key_size, 8));
+}
+
+static struct htab_elem *get_htab_elem(struct bpf_htab *htab, int i)
+{
+	return (struct htab_elem *) (htab->elems + i * htab->elem_size);
+}
+
+static u32 htab_prealloc_entries(const struct bpf_htab *htab)
+{
+	return htab->map.max_entries + num_possible_cpus();
+}
+
+static void htab_free_elems(struct bpf_htab *htab)
+{
+	int i;
+
+	if (htab_is_percpu(htab)) {
+		for (i = 0; i < htab_prealloc_entries(htab); i++)
+			free_percpu(htab_elem_get_ptr(get_htab_elem(htab, i),
+						      htab->map.key_size));
+	}
+	vfree(htab->elems);
+}
+
+/*
+ * max_entries elements go to the freelist. Replacing an element needs a
+ * spare one while the old one is still linked, so every cpu keeps one
+ * extra element for that and gets the replaced one back in exchange.
+ */
+static int prealloc_init(struct bpf_htab *htab)
+{
+	u32 num_entries = htab_prealloc_entries(htab);
+	int err = -ENOMEM, i, cpu;
+
+	htab->elems = vzalloc(htab->elem_size * num_entries);
+	if (!htab->elems)
+		return -ENOMEM;
+
+	if (htab_is_percpu(htab)) {
+		u32 size = round_up(htab->map.value_size, 8);
+
+		for (i = 0; i < num_entries; i++) {
+			void __percpu *pptr;
+
+			pptr = __alloc_percpu_gfp(size, 8,
+						  GFP_USER | __GFP_NOWARN);
+			if (!pptr)
+				goto free_elems;
+			htab_elem_set_ptr(get_htab_elem(htab, i),
+					  htab->map.key_size, pptr);
+		}
+	}
+
+	htab->extra_elems = alloc_percpu(struct htab_elem *);
+	if (!htab->extra_elems)
+		goto free_elems;
+
+	err = pcpu_freelist_init(&htab->freelist);
+	if (err)
+		goto free_extra;
+
+	pcpu_freelist_populate(&htab->freelist,
+			       htab->elems + offsetof(struct htab_elem, fnode),
+			       htab->elem_size, htab->map.max_entries);
+
+	i = htab->map.max_entries;
+	for_each_possible_cpu(cpu)
+		*per_cpu_ptr(htab->extra_elems, cpu) = get_htab_elem(htab, i++);
+
+	return 0;
+
+free_extra:
+	free_percpu(htab->extra_elems);
+free_elems:
+	htab_free_elems(htab);
+	return err;
+}
+
+static void prealloc_destroy(struct bpf_htab *htab)
+{
+	htab_free_elems(htab);
+	free_percpu(htab->extra_elems);
+	pcpu_freelist_destroy(&htab->freelist);
+}
+
 /* Called from syscall */
 static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 {
+	bool percpu = attr->map_type == BPF_MAP_TYPE_PERCPU_HASH;
 	struct bpf_htab *htab;
 	int err, i;
+	u64 cost;
+
+	if (attr->map_flags & ~BPF_F_NO_PREALLOC)
+		/* reserved bits should not be used */
+		return ERR_PTR(-EINVAL);
 
 	htab = kzalloc(sizeof(*htab), GFP_USER);
 	if (!htab)
 		return ERR_PTR(-ENOMEM);
 
 	/* mandatory map attributes */
+	htab->map.map_type = attr->map_type;
 	htab->map.key_size = attr->key_size;
 	htab->map.value_size = attr->value_size;
 	htab->map.max_entries = attr->max_entries;
+	htab->map.map_flags = attr->map_flags;
 
 	/* check sanity of attributes.
 	 * value_size == 0 may be allowed in the future to use map as a set
@@ -73,43 +206,62 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 		 */
 		goto free_htab;
 
+	if (percpu && round_up(htab->map.value_size, 8) > PCPU_MIN_UNIT_SIZE)
+		/* make sure the size for pcpu_alloc() is reasonable */
+		goto free_htab;
+
 	htab->elem_size = sizeof(struct htab_elem) +
-			  round_up(htab->map.key_size, 8) +
-			  htab->map.value_size;
+			  round_up(htab->map.key_size, 8);
+	if (percpu)
+		htab->elem_size += sizeof(void *);
+	else
+		htab->elem_size += round_up(htab->map.value_size, 8);
 
 	/* prevent zero size kmalloc and check for u32 overflow */
 	if (htab->n_buckets == 0 ||
-	    htab->n_buckets > U32_MAX / sizeof(struct hlist_head))
+	    htab->n_buckets > U32_MAX / sizeof(struct bucket))
 		goto free_htab;
 
-	if ((u64) htab->n_buckets * sizeof(struct hlist_head) +
-	    (u64) htab->elem_size * htab->map.max_entries >=
-	    U32_MAX - PAGE_SIZE)
+	cost = (u64) htab->n_buckets * sizeof(struct bucket) +
+	       (u64) htab->elem_size * htab_prealloc_entries(htab);
+
+	if (percpu)
+		cost += (u64) round_up(htab->map.value_size, 8) *
+			num_possible_cpus() * htab_prealloc_entries(htab);
+
+	if (cost >= U32_MAX - PAGE_SIZE)
 		/* make sure page count doesn't overflow */
 		goto free_htab;
 
-	htab->map.pages = round_up(htab->n_buckets * sizeof(struct hlist_head) +
-				   htab->elem_size * htab->map.max_entries,
-				   PAGE_SIZE) >> PAGE_SHIFT;
+	htab->map.pages = round_up(cost, PAGE_SIZE) >> PAGE_SHIFT;
 
 	err = -ENOMEM;
-	htab->buckets = kmalloc_array(htab->n_buckets, sizeof(struct hlist_head),
+	htab->buckets = kmalloc_array(htab->n_buckets, sizeof(struct bucket),
 				      GFP_USER | __GFP_NOWARN);
 
 	if (!htab->buckets) {
-		htab->buckets = vmalloc(htab->n_buckets * sizeof(struct hlist_head));
+		htab->buckets = vmalloc(htab->n_buckets * sizeof(struct bucket));
 		if (!htab->buckets)
 			goto free_htab;
 	}
 
-	for (i = 0; i < htab->n_buckets; i++)
-		INIT_HLIST_HEAD(&htab->buckets[i]);
+	for (i = 0; i < htab->n_buckets; i++) {
+		INIT_HLIST_HEAD(&htab->buckets[i].head);
+		raw_spin_lock_init(&htab->buckets[i].lock);
+	}
+
+	atomic_set(&htab->count, 0);
 
-	raw_spin_lock_init(&htab->lock);
-	htab->count = 0;
+	if (htab_is_prealloc(htab)) {
+		err = prealloc_init(htab);
+		if (err)
+			goto free_buckets;
+	}
 
 	return &htab->map;
 
+free_buckets:
+	kvfree(htab->buckets);
 free_htab:
 	kfree(htab);
 	return ERR_PTR(err);
@@ -120,11 +272,16 @@ static inline u32 htab_map_hash(const void *key, u32 key_len)
 	return jhash(key, key_len, 0);
 }
 
-static inline struct hlist_head *select_bucket(struct bpf_htab *htab, u32 hash)
+static inline struct bucket *__select_bucket(struct bpf_htab *htab, u32 hash)
 {
 	return &htab->buckets[hash & (htab->n_buckets - 1)];
 }
 
+static inline struct hlist_head *select_bucket(struct bpf_htab *htab, u32 hash)
+{
+	return &__select_bucket(htab, hash)->head;
+}
+
 static struct htab_elem *lookup_elem_raw(struct hlist_head *head, u32 hash,
 					 void *key, u32 key_size)
 {
@@ -138,11 +295,11 @@ static struct htab_elem *lookup_elem_raw(struct hlist_head *head, u32 hash,
 }
 
 /* Called from syscall or from eBPF program */
-static void *htab_map_lookup_elem(struct bpf_map *map, void *key)
+static struct htab_elem *__htab_map_lookup_elem(struct bpf_map *map,
+						void *key)
 {
 	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
 	struct hlist_head *head;
-	struct htab_elem *l;
 	u32 hash, key_size;
 
 	/* Must be called with rcu_read_lock. */
@@ -154,7 +311,12 @@ static void *htab_map_lookup_elem(struct bpf_map *map, void *key)
 
 	head = select_bucket(htab, hash);
 
-	l = lookup_elem_raw(head, hash, key, key_size);
+	return lookup_elem_raw(head, hash, key, key_size);
+}
+
+static void *htab_map_lookup_elem(struct bpf_map *map, void *key)
+{
+	struct htab_elem *l = __htab_map_lookup_elem(map, key);
 
 	if (l)
 		return l->key + round_up(map->key_size, 8);
@@ -162,6 +324,43 @@ static void *htab_map_lookup_elem(struct bpf_map *map, void *key)
 	return NULL;
 }
 
+static void *htab_percpu_map_lookup_elem(struct bpf_map *map, void *key)
+{
+	struct htab_elem *l = __htab_map_lookup_elem(map, key);
+
+	if (l)
+		return this_cpu_ptr(htab_elem_get_ptr(l, map->key_size));
+
+	return NULL;
+}
+
+int bpf_percpu_hash_copy(struct bpf_map *map, void *key, void *value)
+{
+	struct htab_elem *l;
+	void __percpu *pptr;
+	int ret = -ENOENT;
+	int cpu, off = 0;
+	u32 size;
+
+	/* per_cpu areas are zero-filled and bpf programs can only
+	 * access 'value_size' of them, so copying rounded areas
+	 * will not leak any kernel data
+	 */
+	size = round_up(map->value_size, 8);
+	rcu_read_lock();
+	l = __htab_map_lookup_elem(map, key);
+	if (!l)
+		goto out;
+	pptr = htab_elem_get_ptr(l, map->key_size);
+	for_each_possible_cpu(cpu) {
+		memcpy(value + off, per_cpu_ptr(pptr, cpu), size);
+		off += size;
+	}
+	ret = 0;
+out:
+	rcu_read_unlock();
+	return ret;
+}
 /* Called from syscall */
 static int htab_map_get_next_key(struct bpf_map *map, void *key, void *next_key)
 {
@@ -220,61 +419,187 @@ find_first_elem:
 	return -ENOENT;
 }
 
+static void htab_elem_free(struct bpf_htab *htab, struct htab_elem *l)
+{
+	if (htab_is_percpu(htab))
+		free_percpu(htab_elem_get_ptr(l, htab->map.key_size));
+	kfree(l);
+}
+
+static void htab_elem_free_rcu(struct rcu_head *head)
+{
+	struct htab_elem *l = container_of(head, struct htab_elem, rcu);
+
+	htab_elem_free(l->htab, l);
+}
+
+/* Called with the bucket lock held, the element is unlinked already */
+static void free_htab_elem(struct bpf_htab *htab, struct htab_elem *l)
+{
+	if (htab_is_prealloc(htab)) {
+		pcpu_freelist_push(&htab->freelist, &l->fnode);
+	} else {
+		l->htab = htab;
+		call_rcu(&l->rcu, htab_elem_free_rcu);
+	}
+}
+
+static void pcpu_copy_value(struct bpf_htab *htab, void __percpu *pptr,
+			    void *value, bool onallcpus)
+{
+	if (!onallcpus) {
+		/* copy true value_size bytes */
+		memcpy(this_cpu_ptr(pptr), value, htab->map.value_size);
+	} else {
+		u32 size = round_up(htab->map.value_size, 8);
+		int off = 0, cpu;
+
+		for_each_possible_cpu(cpu) {
+			memcpy(per_cpu_ptr(pptr, cpu), value + off, size);
+			off += size;
+		}
+	}
+}
+
+/*
+ * Allocate an element of a BPF_F_NO_PREALLOC map. This is done before
+ * taking the bucket lock, which is a raw spinlock.
+ */
+static struct htab_elem *htab_elem_alloc(struct bpf_htab *htab)
+{
+	struct htab_elem *l;
+	void __percpu *pptr;
+
+	l = kmalloc(htab->elem_size, GFP_ATOMIC | __GFP_NOWARN);
+	if (!l)
+		return NULL;
+
+	if (htab_is_percpu(htab)) {
+		/* alloc_percpu zero-fills */
+		pptr = __alloc_percpu_gfp(round_up(htab->map.value_size, 8), 8,
+					  GFP_ATOMIC | __GFP_NOWARN);
+		if (!pptr) {
+			kfree(l);
+			return NULL;
+		}
+		htab_elem_set_ptr(l, htab->map.key_size, pptr);
+	}
+
+	return l;
+}
+
+/*
+ * Get an element of a preallocated map, called with the bucket lock held.
+ * Replacing @l_old takes this cpu's spare element, which @l_old becomes
+ * once it is unlinked.
+ */
+static struct htab_elem *htab_elem_get(struct bpf_htab *htab,
+				       struct htab_elem *l_old)
+{
+	struct pcpu_freelist_node *l;
+	struct htab_elem **pl_new;
+	struct htab_elem *l_new;
+
+	if (l_old) {
+		pl_new = this_cpu_ptr(htab->extra_elems);
+		l_new = *pl_new;
+		*pl_new = l_old;
+		return l_new;
+	}
+
+	l = pcpu_freelist_pop(&htab->freelist);
+	if (!l)
+		return NULL;
+
+	return container_of(l, struct htab_elem, fnode);
+}
+
+static int check_flags(struct htab_elem *l_old, u64 map_flags)
+{
+	if (l_old && map_flags == BPF_NOEXIST)
+		/* elem already exists */
+		return -EEXIST;
+
+	if (!l_old && map_flags == BPF_EXIST)
+		/* elem doesn't exist, cannot update it */
+		return -ENOENT;
+
+	return 0;
+}
+
+/*
+ * Account a new element of a BPF_F_NO_PREALLOC map. Preallocated maps are
+ * bounded by their freelist instead.
+ */
+static int htab_count_inc(struct bpf_htab *htab)
+{
+	if (atomic_inc_return(&htab->count) > htab->map.max_entries) {
+		/* if elem with this 'key' doesn't exist and we've reached
+		 * max_entries limit, fail insertion of new elem
+		 */
+		atomic_dec(&htab->count);
+		return -E2BIG;
+	}
+	return 0;
+}
+
 /* Called from syscall or from eBPF program */
 static int htab_map_update_elem(struct bpf_map *map, void *key, void *value,
 				u64 map_flags)
 {
 	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
-	struct htab_elem *l_new, *l_old;
+	bool prealloc = htab_is_prealloc(htab);
+	struct htab_elem *l_new = NULL, *l_old;
 	struct hlist_head *head;
 	unsigned long flags;
-	u32 key_size;
+	struct bucket *b;
+	u32 key_size, hash;
 	int ret;
 
-	if (map_flags > BPF_EXIST)
+	if (unlikely(map_flags > BPF_EXIST))
 		/* unknown flags */
 		return -EINVAL;
 
 	WARN_ON_ONCE(!rcu_read_lock_held());
 
-	/* allocate new element outside of lock */
-	l_new = kmalloc(htab->elem_size, GFP_ATOMIC | __GFP_NOWARN);
-	if (!l_new)
-		return -ENOMEM;
-
 	key_size = map->key_size;
 
-	memcpy(l_new->key, key, key_size);
-	memcpy(l_new->key + round_up(key_size, 8), value, map->value_size);
+	hash = htab_map_hash(key, key_size);
 
-	l_new->hash = htab_map_hash(l_new->key, key_size);
+	if (!prealloc) {
+		/* allocate new element outside of lock */
+		l_new = htab_elem_alloc(htab);
+		if (!l_new)
+			return -ENOMEM;
+	}
 
-	/* bpf_map_update_elem() can be called in_irq() */
-	raw_spin_lock_irqsave(&htab->lock, flags);
+	b = __select_bucket(htab, hash);
+	head = &b->head;
 
-	head = select_bucket(htab, l_new->hash);
+	/* bpf_map_update_elem() can be called in_irq() */
+	raw_spin_lock_irqsave(&b->lock, flags);
 
-	l_old = lookup_elem_raw(head, l_new->hash, key, key_size);
+	l_old = lookup_elem_raw(head, hash, key, key_size);
 
-	if (!l_old && unlikely(htab->count >= map->max_entries)) {
-		/* if elem with this 'key' doesn't exist and we've reached
-		 * max_entries limit, fail insertion of new elem
-		 */
-		ret = -E2BIG;
+	ret = check_flags(l_old, map_flags);
+	if (ret)
 		goto err;
-	}
 
-	if (l_old && map_flags == BPF_NOEXIST) {
-		/* elem already exists */
-		ret = -EEXIST;
-		goto err;
+	if (prealloc) {
+		l_new = htab_elem_get(htab, l_old);
+		if (!l_new) {
+			ret = -E2BIG;
+			goto err;
+		}
+	} else if (!l_old) {
+		ret = htab_count_inc(htab);
+		if (ret)
+			goto err;
 	}
 
-	if (!l_old && map_flags == BPF_EXIST) {
-		/* elem doesn't exist, cannot update it */
-		ret = -ENOENT;
-		goto err;
-	}
+	memcpy(l_new->key, key, key_size);
+	memcpy(l_new->key + round_up(key_size, 8), value, map->value_size);
+	l_new->hash = hash;
 
 	/* add new element to the head of the list, so that concurrent
 	 * search will find it before old elem
@@ -282,16 +607,128 @@ static int htab_map_update_elem(struct bpf_map *map, void *key, void *value,
 	hlist_add_head_rcu(&l_new->hash_node, head);
 	if (l_old) {
 		hlist_del_rcu(&l_old->hash_node);
-		kfree_rcu(l_old, rcu);
-	} else {
-		htab->count++;
+		/* a preallocated l_old is this cpu's spare element now */
+		if (!prealloc)
+			free_htab_elem(htab, l_old);
 	}
-	raw_spin_unlock_irqrestore(&htab->lock, flags);
+	raw_spin_unlock_irqrestore(&b->lock, flags);
 
 	return 0;
 err:
-	raw_spin_unlock_irqrestore(&htab->lock, flags);
-	kfree(l_new);
+	raw_spin_unlock_irqrestore(&b->lock, flags);
+	if (!prealloc)
+		htab_elem_free(htab, l_new);
+	return ret;
+}
+
+/*
+ * The values of a per-cpu element are updated in place, so an element is
+ * only needed when the key is new. Without preallocation it has to be
+ * allocated outside of the bucket lock: do that when a lockless lookup
+ * misses, and retry if the key went away in the meantime.
+ */
+static int __htab_percpu_map_update_elem(struct bpf_map *map, void *key,
+					 void *value, u64 map_flags,
+					 bool onallcpus)
+{
+	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
+	bool prealloc = htab_is_prealloc(htab);
+	struct htab_elem *l_new = NULL, *l_old;
+	struct hlist_head *head;
+	void __percpu *pptr;
+	unsigned long flags;
+	struct bucket *b;
+	u32 key_size, hash;
+	int ret;
+
+	if (unlikely(map_flags > BPF_EXIST))
+		/* unknown flags */
+		return -EINVAL;
+
+	WARN_ON_ONCE(!rcu_read_lock_held());
+
+	key_size = map->key_size;
+
+	hash = htab_map_hash(key, key_size);
+
+	b = __select_bucket(htab, hash);
+	head = &b->head;
+
+again:
+	if (!prealloc && !l_new && !lookup_elem_raw(head, hash, key, key_size)) {
+		l_new = htab_elem_alloc(htab);
+		if (!l_new)
+			return -ENOMEM;
+	}
+
+	/* bpf_map_update_elem() can be called in_irq() */
+	raw_spin_lock_irqsave(&b->lock, flags);
+
+	l_old = lookup_elem_raw(head, hash, key, key_size);
+
+	ret = check_flags(l_old, map_flags);
+	if (ret)
+		goto err;
+
+	if (l_old) {
+		/* per-cpu hash map can update value in-place */
+		pcpu_copy_value(htab, htab_elem_get_ptr(l_old, key_size),
+				value, onallcpus);
+		goto err;
+	}
+
+	if (prealloc) {
+		l_new = htab_elem_get(htab, NULL);
+		if (!l_new) {
+			ret = -E2BIG;
+			goto err;
+		}
+	} else if (!l_new) {
+		raw_spin_unlock_irqrestore(&b->lock, flags);
+		goto again;
+	} else {
+		ret = htab_count_inc(htab);
+		if (ret)
+			goto err;
+	}
+
+	memcpy(l_new->key, key, key_size);
+	pptr = htab_elem_get_ptr(l_new, key_size);
+	if (prealloc && !onallcpus) {
+		/* don't leak the values of a deleted element to this key */
+		int cpu;
+
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(pptr, cpu), 0,
+			       round_up(map->value_size, 8));
+	}
+	pcpu_copy_value(htab, pptr, value, onallcpus);
+	l_new->hash = hash;
+
+	hlist_add_head_rcu(&l_new->hash_node, head);
+	l_new = NULL;
+err:
+	raw_spin_unlock_irqrestore(&b->lock, flags);
+	if (l_new)
+		htab_elem_free(htab, l_new);
+	return ret;
+}
+
+static int htab_percpu_map_update_elem(struct bpf_map *map, void *key,
+				       void *value, u64 map_flags)
+{
+	return __htab_percpu_map_update_elem(map, key, value, map_flags, false);
+}
+
+int bpf_percpu_hash_update(struct bpf_map *map, void *key, void *value,
+			   u64 map_flags)
+{
+	int ret;
+
+	rcu_read_lock();
+	ret = __htab_percpu_map_update_elem(map, key, value, map_flags, true);
+	rcu_read_unlock();
+
 	return ret;
 }
 
@@ -300,6 +737,7 @@ static int htab_map_delete_elem(struct bpf_map *map, void *key)
 {
 	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
 	struct hlist_head *head;
+	struct bucket *b;
 	struct htab_elem *l;
 	unsigned long flags;
 	u32 hash, key_size;
@@ -310,21 +748,22 @@ static int htab_map_delete_elem(struct bpf_map *map, void *key)
 	key_size = map->key_size;
 
 	hash = htab_map_hash(key, key_size);
+	b = __select_bucket(htab, hash);
+	head = &b->head;
 
-	raw_spin_lock_irqsave(&htab->lock, flags);
-
-	head = select_bucket(htab, hash);
+	raw_spin_lock_irqsave(&b->lock, flags);
 
 	l = lookup_elem_raw(head, hash, key, key_size);
 
 	if (l) {
 		hlist_del_rcu(&l->hash_node);
-		htab->count--;
-		kfree_rcu(l, rcu);
+		if (!htab_is_prealloc(htab))
+			atomic_dec(&htab->count);
+		free_htab_elem(htab, l);
 		ret = 0;
 	}
 
-	raw_spin_unlock_irqrestore(&htab->lock, flags);
+	raw_spin_unlock_irqrestore(&b->lock, flags);
 	return ret;
 }
 
@@ -339,8 +778,8 @@ static void delete_all_elements(struct bpf_htab *htab)
 
 		hlist_for_each_entry_safe(l, n, head, hash_node) {
 			hlist_del_rcu(&l->hash_node);
-			htab->count--;
-			kfree(l);
+			atomic_dec(&htab->count);
+			htab_elem_free(htab, l);
 		}
 	}
 }
@@ -357,10 +796,14 @@ static void htab_map_free(struct bpf_map *map)
 	 */
 	synchronize_rcu();
 
-	/* some of kfree_rcu() callbacks for elements of this map may not have
-	 * executed. It's ok. Proceed to free residual elements and map itself
+	/* some of free_htab_elem() callbacks for elements of this map may
+	 * not have executed. Wait for them, they dereference the map.
 	 */
-	delete_all_elements(htab);
+	rcu_barrier();
+	if (htab_is_prealloc(htab))
+		prealloc_destroy(htab);
+	else
+		delete_all_elements(htab);
 	kvfree(htab->buckets);
 	kfree(htab);
 }
@@ -379,9 +822,24 @@ static struct bpf_map_type_list htab_type __read_mostly = {
 	.type = BPF_MAP_TYPE_HASH,
 };
 
+static const struct bpf_map_ops htab_percpu_ops = {
+	.map_alloc = htab_map_alloc,
+	.map_free = htab_map_free,
+	.map_get_next_key = htab_map_get_next_key,
+	.map_lookup_elem = htab_percpu_map_lookup_elem,
+	.map_update_elem = htab_percpu_map_update_elem,
+	.map_delete_elem = htab_map_delete_elem,
+};
+
+static struct bpf_map_type_list htab_percpu_type __read_mostly = {
+	.ops = &htab_percpu_ops,
+	.type = BPF_MAP_TYPE_PERCPU_HASH,
+};
+
 static int __init register_htab_map(void)
 {
 	bpf_register_map_type(&htab_type);
+	bpf_register_map_type(&htab_percpu_type);
 	return 0;
 }
 late_initcall(register_htab_map);
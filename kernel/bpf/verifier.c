@@ -17,6 +17,7 @@
 #include <net/netlink.h>
 #include <linux/file.h>
 #include <linux/vmalloc.h>
+#include <linux/jhash.h>
 
 /* bpf_check() is a static code analyzer that walks eBPF program
  * instruction by instruction and updates register/stack state.
@@ -168,9 +169,20 @@ struct verifier_state {
 	struct reg_state spilled_regs[MAX_BPF_STACK / BPF_REG_SIZE];
 };
 
+/* what an explored state requires from another state to be equivalent,
+ * used to reject most candidates without a full states_equal()
+ */
+struct state_sig {
+	u16 reg_init;	/* live regs that must be initialized */
+	u16 reg_exact;	/* live regs that must match exactly */
+	u64 stack_full;	/* stack slots without any STACK_INVALID byte */
+	u32 hash;	/* of the reg_exact regs and stack_full slots */
+};
+
 /* linked list of verifier states used to prune search */
 struct verifier_state_list {
 	struct verifier_state state;
+	struct state_sig sig;
 	struct verifier_state_list *next;
 };
 
@@ -197,6 +209,10 @@ struct verifier_env {
 	int stack_size;			/* number of states to be processed */
 	struct verifier_state cur_state; /* current verifier state */
 	struct verifier_state_list **explored_states; /* search pruning optimization */
+	u16 *live_regs;			/* regs possibly read later, per insn */
+	u32 states_stored;		/* explored states kept for pruning */
+	u32 states_pruned;		/* paths cut short by explored ones */
+	int peak_stack_size;		/* most states waiting at once */
 	struct bpf_map *used_maps[MAX_USED_MAPS]; /* array of map's used by eBPF program */
 	u32 used_map_cnt;		/* number of used maps */
 	bool allow_ptr_leaks;
@@ -453,6 +469,7 @@ static struct verifier_state *push_stack(struct verifier_env *env, int insn_idx,
 	elem->next = env->head;
 	env->head = elem;
 	env->stack_size++;
+	env->peak_stack_size = max(env->peak_stack_size, env->stack_size);
 	if (env->stack_size > 1024) {
 		verbose("BPF program is too complex\n");
 		goto err;
@@ -1580,6 +1597,123 @@ err_free:
 	return ret;
 }
 
+#define CALLER_SAVED_MASK (BIT(BPF_REG_0) | BIT(BPF_REG_1) | BIT(BPF_REG_2) | \
+			   BIT(BPF_REG_3) | BIT(BPF_REG_4) | BIT(BPF_REG_5))
+
+/* registers an instruction reads (*use) and overwrites (*def) */
+static void insn_reg_use_def(struct bpf_insn *insn, u16 *use, u16 *def)
+{
+	u8 class = BPF_CLASS(insn->code);
+	u8 op = BPF_OP(insn->code);
+
+	*use = 0;
+	*def = 0;
+
+	switch (class) {
+	case BPF_ALU:
+	case BPF_ALU64:
+		if (BPF_SRC(insn->code) == BPF_X &&
+		    op != BPF_END && op != BPF_NEG)
+			*use |= BIT(insn->src_reg);
+		if (op != BPF_MOV)
+			*use |= BIT(insn->dst_reg);
+		*def = BIT(insn->dst_reg);
+		break;
+	case BPF_LDX:
+		*use = BIT(insn->src_reg);
+		*def = BIT(insn->dst_reg);
+		break;
+	case BPF_STX:
+		*use = BIT(insn->src_reg) | BIT(insn->dst_reg);
+		break;
+	case BPF_ST:
+		*use = BIT(insn->dst_reg);
+		break;
+	case BPF_LD:
+		if (BPF_MODE(insn->code) == BPF_IMM) {
+			*def = BIT(insn->dst_reg);
+			break;
+		}
+		/* LD_ABS and LD_IND read skb from R6 and clobber R0-R5 */
+		*use = BIT(BPF_REG_6);
+		if (BPF_MODE(insn->code) == BPF_IND)
+			*use |= BIT(insn->src_reg);
+		*def = CALLER_SAVED_MASK;
+		break;
+	case BPF_JMP:
+		if (op == BPF_CALL) {
+			/* helpers take up to five arguments */
+			*use = CALLER_SAVED_MASK & ~BIT(BPF_REG_0);
+			*def = CALLER_SAVED_MASK;
+		} else if (op == BPF_EXIT) {
+			*use = BIT(BPF_REG_0);
+		} else if (op != BPF_JA) {
+			*use = BIT(insn->dst_reg);
+			if (BPF_SRC(insn->code) == BPF_X)
+				*use |= BIT(insn->src_reg);
+		}
+		break;
+	}
+}
+
+static u16 live_at(struct verifier_env *env, int insn_idx)
+{
+	if (insn_idx < 0 || insn_idx >= env->prog->len)
+		return 0;
+	return env->live_regs[insn_idx];
+}
+
+/* Compute for each insn the registers that may be read on some path
+ * starting there before they are written. A register outside that set
+ * can't influence the rest of the verification, so is_state_visited()
+ * ignores it. Runs after check_cfg(), so all jumps are in range and
+ * there are no loops; a few backward passes reach the fixed point.
+ */
+static int compute_live_regs(struct verifier_env *env)
+{
+	struct bpf_insn *insns = env->prog->insnsi;
+	int insn_cnt = env->prog->len;
+	bool changed;
+	u16 use, def, out, in;
+	int i;
+
+	env->live_regs = kcalloc(insn_cnt, sizeof(u16), GFP_USER);
+	if (!env->live_regs)
+		return -ENOMEM;
+
+	do {
+		changed = false;
+		for (i = insn_cnt - 1; i >= 0; i--) {
+			struct bpf_insn *insn = &insns[i];
+			u8 class = BPF_CLASS(insn->code);
+			u8 op = BPF_OP(insn->code);
+
+			if (class == BPF_JMP && op == BPF_EXIT)
+				out = 0;
+			else if (class == BPF_JMP && op == BPF_JA)
+				out = live_at(env, i + insn->off + 1);
+			else if (class == BPF_JMP && op != BPF_CALL)
+				out = live_at(env, i + 1) |
+				      live_at(env, i + insn->off + 1);
+			else if (class == BPF_LD &&
+				 BPF_MODE(insn->code) == BPF_IMM)
+				/* ld_imm64 takes two insns */
+				out = live_at(env, i + 2);
+			else
+				out = live_at(env, i + 1);
+
+			insn_reg_use_def(insn, &use, &def);
+			in = use | (out & ~def) | BIT(BPF_REG_FP);
+			if (in != env->live_regs[i]) {
+				env->live_regs[i] = in;
+				changed = true;
+			}
+		}
+	} while (changed);
+
+	return 0;
+}
+
 /* compare two verifier states
  *
  * all states stored in state_list are known to be valid, since
@@ -1606,11 +1740,15 @@ err_free:
  * whereas register type in current state is meaningful, it means that
  * the current state will reach 'bpf_exit' instruction safely
  */
-static bool states_equal(struct verifier_state *old, struct verifier_state *cur)
+static bool states_equal(struct verifier_state *old, struct verifier_state *cur,
+			 u16 live)
 {
 	int i;
 
 	for (i = 0; i < MAX_BPF_REG; i++) {
+		/* never read again before being written, can be anything */
+		if (!(live & BIT(i)))
+			continue;
 		if (memcmp(&old->regs[i], &cur->regs[i],
 			   sizeof(old->regs[0])) != 0) {
 			if (old->regs[i].type == NOT_INIT ||
@@ -1653,10 +1791,74 @@ static bool states_equal(struct verifier_state *old, struct verifier_state *cur)
 	return true;
 }
 
+static u32 state_hash(struct verifier_state *st, u16 regs, u64 slots)
+{
+	u32 hash = 0;
+	int i;
+
+	for (i = 0; i < MAX_BPF_REG; i++)
+		if (regs & BIT(i))
+			hash = jhash(&st->regs[i], sizeof(st->regs[0]), hash);
+
+	for (i = 0; i < MAX_BPF_STACK / BPF_REG_SIZE; i++) {
+		if (!(slots & BIT_ULL(i)))
+			continue;
+		hash = jhash(&st->stack_slot_type[i * BPF_REG_SIZE],
+			     BPF_REG_SIZE, hash);
+		hash = jhash(&st->spilled_regs[i], sizeof(st->spilled_regs[0]),
+			     hash);
+	}
+
+	return hash;
+}
+
+static u16 state_init_regs(struct verifier_state *st, u16 live)
+{
+	u16 init = 0;
+	int i;
+
+	for (i = 0; i < MAX_BPF_REG; i++)
+		if ((live & BIT(i)) && st->regs[i].type != NOT_INIT)
+			init |= BIT(i);
+
+	return init;
+}
+
+static void state_sig_init(struct state_sig *sig, struct verifier_state *st,
+			   u16 live)
+{
+	int i, j;
+
+	sig->reg_init = state_init_regs(st, live);
+	sig->reg_exact = 0;
+	for (i = 0; i < MAX_BPF_REG; i++)
+		if ((sig->reg_init & BIT(i)) &&
+		    st->regs[i].type != UNKNOWN_VALUE)
+			sig->reg_exact |= BIT(i);
+
+	sig->stack_full = 0;
+	for (i = 0; i < MAX_BPF_STACK / BPF_REG_SIZE; i++) {
+		for (j = 0; j < BPF_REG_SIZE; j++)
+			if (st->stack_slot_type[i * BPF_REG_SIZE + j] ==
+			    STACK_INVALID)
+				break;
+		if (j == BPF_REG_SIZE)
+			sig->stack_full |= BIT_ULL(i);
+	}
+
+	sig->hash = state_hash(st, sig->reg_exact, sig->stack_full);
+}
+
 static int is_state_visited(struct verifier_env *env, int insn_idx)
 {
+	struct verifier_state *cur = &env->cur_state;
 	struct verifier_state_list *new_sl;
 	struct verifier_state_list *sl;
+	u16 live = env->live_regs[insn_idx];
+	u16 cur_init, hash_regs = 0;
+	u64 hash_slots = 0;
+	bool hashed = false;
+	u32 hash = 0;
 
 	sl = env->explored_states[insn_idx];
 	if (!sl)
@@ -1665,12 +1867,34 @@ static int is_state_visited(struct verifier_env *env, int insn_idx)
 		 */
 		return 0;
 
+	/* Every register an explored state has initialized must be
+	 * initialized here too, and the registers and stack slots it pins
+	 * down must hash the same, or the states can't be equal. Explored
+	 * states at one insn mostly pin the same ones, so the hash of the
+	 * current state is only recomputed when that changes.
+	 */
+	cur_init = state_init_regs(cur, live);
 	while (sl != STATE_LIST_MARK) {
-		if (states_equal(&sl->state, &env->cur_state))
+		if (sl->sig.reg_init & ~cur_init)
+			goto next;
+
+		if (!hashed || hash_regs != sl->sig.reg_exact ||
+		    hash_slots != sl->sig.stack_full) {
+			hash_regs = sl->sig.reg_exact;
+			hash_slots = sl->sig.stack_full;
+			hash = state_hash(cur, hash_regs, hash_slots);
+			hashed = true;
+		}
+
+		if (hash == sl->sig.hash &&
+		    states_equal(&sl->state, cur, live)) {
 			/* reached equivalent register/stack state,
 			 * prune the search
 			 */
+			env->states_pruned++;
 			return 1;
+		}
+next:
 		sl = sl->next;
 	}
 
@@ -1685,9 +1909,11 @@ static int is_state_visited(struct verifier_env *env, int insn_idx)
 		return -ENOMEM;
 
 	/* add new state to the head of linked list */
-	memcpy(&new_sl->state, &env->cur_state, sizeof(env->cur_state));
+	memcpy(&new_sl->state, cur, sizeof(*cur));
+	state_sig_init(&new_sl->sig, cur, live);
 	new_sl->next = env->explored_states[insn_idx];
 	env->explored_states[insn_idx] = new_sl;
+	env->states_stored++;
 	return 0;
 }
 
@@ -1952,6 +2178,11 @@ process_bpf_exit:
 		insn_idx++;
 	}
 
+	if (log_level)
+		verbose("processed %d insns, %u states stored, %u pruned, peak of %d pending\n",
+			insn_processed, env->states_stored,
+			env->states_pruned, env->peak_stack_size);
+
 	return 0;
 }
 
@@ -2239,6 +2470,10 @@ int bpf_check(struct bpf_prog **prog, union bpf_attr *attr)
 	if (ret < 0)
 		goto skip_full_check;
 
+	ret = compute_live_regs(env);
+	if (ret < 0)
+		goto skip_full_check;
+
 	env->allow_ptr_leaks = capable(CAP_SYS_ADMIN);
 
 	ret = do_check(env);
@@ -2246,6 +2481,7 @@ int bpf_check(struct bpf_prog **prog, union bpf_attr *attr)
 skip_full_check:
 	while (pop_stack(env, NULL) >= 0);
 	free_states(env);
+	kfree(env->live_regs);
 
 	if (ret == 0)
 		/* program is valid, convert *(u32*)(ctx + off) accesses */
@@ -911,7 +911,9 @@ irq_thread_check_affinity(struct irq_desc *desc, struct irqaction *action)
 	 * This code is triggered unconditionally. Check the affinity
 	 * mask pointer. For CPU_MASK_OFFSTACK=n this is optimized out.
 	 */
-	if (desc->irq_common_data.affinity)
+	if (action->consumer_cpu >= 0)
+		cpumask_copy(mask, cpumask_of(action->consumer_cpu));
+	else if (desc->irq_common_data.affinity)
 		cpumask_copy(mask, desc->irq_common_data.affinity);
 	else
 		valid = false;
@@ -1094,6 +1096,114 @@ void irq_wake_thread(unsigned int irq, void *dev_id)
 }
 EXPORT_SYMBOL_GPL(irq_wake_thread);
 
+/*
+ * Update the thread of the action of @irq identified by @dev_id. With
+ * @set_policy the policy is replaced by @policy, the consumer @tsk (or
+ * none) is applied according to the resulting policy.
+ */
+static int irq_update_thread_consumer(unsigned int irq, void *dev_id,
+				      bool set_policy, unsigned int policy,
+				      struct task_struct *tsk)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	struct task_struct *t = NULL;
+	struct irqaction *action;
+	unsigned long flags;
+	int prio = 0;
+
+	might_sleep();
+
+	if (!desc || irq_settings_is_per_cpu_devid(desc))
+		return -EINVAL;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	for (action = desc->action; action; action = action->next) {
+		if (action->dev_id == dev_id)
+			break;
+	}
+	if (!action || !action->thread) {
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+		return -EINVAL;
+	}
+
+	if (set_policy)
+		action->thread_policy = policy;
+
+	if (action->thread_policy & IRQ_THREAD_INHERIT_PRIO) {
+		prio = action->thread_prio;
+		if (tsk && rt_prio(tsk->prio))
+			prio = max(prio, MAX_RT_PRIO - 1 - tsk->prio);
+		if (prio != action->thread->rt_priority) {
+			t = action->thread;
+			get_task_struct(t);
+		}
+	} else if (set_policy &&
+		   action->thread->rt_priority != action->thread_prio) {
+		prio = action->thread_prio;
+		t = action->thread;
+		get_task_struct(t);
+	}
+
+	/* The thread moves itself, as for affinity changes of the irq */
+	if ((action->thread_policy & IRQ_THREAD_FOLLOW_CONSUMER) && tsk) {
+		if (action->consumer_cpu != task_cpu(tsk)) {
+			action->consumer_cpu = task_cpu(tsk);
+			set_bit(IRQTF_AFFINITY, &action->thread_flags);
+		}
+	} else if (action->consumer_cpu >= 0) {
+		action->consumer_cpu = -1;
+		set_bit(IRQTF_AFFINITY, &action->thread_flags);
+	}
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	if (t) {
+		struct sched_param param = { .sched_priority = prio, };
+
+		sched_setscheduler_nocheck(t, SCHED_FIFO, &param);
+		put_task_struct(t);
+	}
+	return 0;
+}
+
+/**
+ *	irq_set_thread_policy - set the consumer policy of an irq thread
+ *	@irq:		Interrupt line
+ *	@dev_id:	Device identity of the threaded handler
+ *	@policy:	IRQ_THREAD_* flags
+ *
+ *	Selects how the irq thread of the handler reacts to the consumer
+ *	reported by irq_set_thread_consumer(). Clearing a policy restores
+ *	the default priority and the affinity of the thread.
+ *
+ *	Must be called from process context.
+ */
+int irq_set_thread_policy(unsigned int irq, void *dev_id, unsigned int policy)
+{
+	return irq_update_thread_consumer(irq, dev_id, true, policy, NULL);
+}
+EXPORT_SYMBOL_GPL(irq_set_thread_policy);
+
+/**
+ *	irq_set_thread_consumer - report the task waiting for a device
+ *	@irq:		Interrupt line
+ *	@dev_id:	Device identity of the threaded handler
+ *	@tsk:		Highest priority task blocked on the device, or NULL
+ *
+ *	Drivers call this when a task blocks on the device, and with NULL
+ *	when no task waits any longer. Depending on the policy of the
+ *	handler the irq thread inherits the RT priority of @tsk, and
+ *	moves to the cpu of @tsk before it handles the next interrupt,
+ *	which keeps the device data in the cache of the cpu consuming it.
+ *
+ *	Must be called from process context.
+ */
+int irq_set_thread_consumer(unsigned int irq, void *dev_id,
+			    struct task_struct *tsk)
+{
+	return irq_update_thread_consumer(irq, dev_id, false, 0, tsk);
+}
+EXPORT_SYMBOL_GPL(irq_set_thread_consumer);
+
 static int irq_setup_forced_threading(struct irqaction *new)
 {
 	if (!force_irqthreads)
@@ -1164,6 +1274,8 @@ setup_irq_thread(struct irqaction *new, unsigned int irq, bool secondary)
 		return PTR_ERR(t);
 
 	sched_setscheduler_nocheck(t, SCHED_FIFO, &param);
+	new->thread_prio = param.sched_priority;
+	new->consumer_cpu = -1;
 
 	/*
 	 * We keep the reference to the task struct even if
@@ -14,12 +14,19 @@
 # define lg_do_unlock(l)	__rt_spin_unlock(l)
 #endif
 /*
- * Note there is no uninit, so lglocks cannot be defined in
- * modules (but it's fine to use them from there)
- * Could be added though, just undo lg_lock_init
+ * An lglock defined in a module must be released with lg_lock_free()
+ * before the module goes away.
  */
 
-void lg_lock_init(struct lglock *lg, char *name)
+#ifdef CONFIG_PREEMPT_RT_FULL
+# define lg_read_lock(lg)	percpu_down_read(&(lg)->rwsem)
+# define lg_read_unlock(lg)	percpu_up_read(&(lg)->rwsem)
+#else
+# define lg_read_lock(lg)	do { } while (0)
+# define lg_read_unlock(lg)	do { } while (0)
+#endif
+
+int lg_lock_init(struct lglock *lg, char *name)
 {
 #ifdef CONFIG_PREEMPT_RT_FULL
 	int i;
@@ -29,15 +36,27 @@ void lg_lock_init(struct lglock *lg, char *name)
 
 		rt_mutex_init(lock);
 	}
+	if (percpu_init_rwsem(&lg->rwsem))
+		return -ENOMEM;
 #endif
 	LOCKDEP_INIT_MAP(&lg->lock_dep_map, name, &lg->lock_key, 0);
+	return 0;
 }
 EXPORT_SYMBOL(lg_lock_init);
 
+void lg_lock_free(struct lglock *lg)
+{
+#ifdef CONFIG_PREEMPT_RT_FULL
+	percpu_free_rwsem(&lg->rwsem);
+#endif
+}
+EXPORT_SYMBOL(lg_lock_free);
+
 void lg_local_lock(struct lglock *lg)
 {
 	lg_lock_ptr *lock;
 
+	lg_read_lock(lg);
 	migrate_disable();
 	lock_acquire_shared(&lg->lock_dep_map, 0, 0, NULL, _RET_IP_);
 	lock = this_cpu_ptr(lg->lock);
@@ -53,6 +72,7 @@ void lg_local_unlock(struct lglock *lg)
 	lock = this_cpu_ptr(lg->lock);
 	lg_do_unlock(lock);
 	migrate_enable();
+	lg_read_unlock(lg);
 }
 EXPORT_SYMBOL(lg_local_unlock);
 
@@ -60,6 +80,7 @@ void lg_local_lock_cpu(struct lglock *lg, int cpu)
 {
 	lg_lock_ptr *lock;
 
+	lg_read_lock(lg);
 	preempt_disable_nort();
 	lock_acquire_shared(&lg->lock_dep_map, 0, 0, NULL, _RET_IP_);
 	lock = per_cpu_ptr(lg->lock, cpu);
@@ -75,6 +96,7 @@ void lg_local_unlock_cpu(struct lglock *lg, int cpu)
 	lock = per_cpu_ptr(lg->lock, cpu);
 	lg_do_unlock(lock);
 	preempt_enable_nort();
+	lg_read_unlock(lg);
 }
 EXPORT_SYMBOL(lg_local_unlock_cpu);
 
@@ -86,6 +108,7 @@ void lg_double_lock(struct lglock *lg, int cpu1, int cpu2)
 	if (cpu2 < cpu1)
 		swap(cpu1, cpu2);
 
+	lg_read_lock(lg);
 	preempt_disable_nort();
 	lock_acquire_shared(&lg->lock_dep_map, 0, 0, NULL, _RET_IP_);
 	lg_do_lock(per_cpu_ptr(lg->lock, cpu1));
@@ -98,13 +121,15 @@ void lg_double_unlock(struct lglock *lg, int cpu1, int cpu2)
 	lg_do_unlock(per_cpu_ptr(lg->lock, cpu1));
 	lg_do_unlock(per_cpu_ptr(lg->lock, cpu2));
 	preempt_enable_nort();
+	lg_read_unlock(lg);
 }
 
+#ifndef CONFIG_PREEMPT_RT_FULL
 void lg_global_lock(struct lglock *lg)
 {
 	int i;
 
-	preempt_disable_nort();
+	preempt_disable();
 	lock_acquire_exclusive(&lg->lock_dep_map, 0, 0, NULL, _RET_IP_);
 	for_each_possible_cpu(i) {
 		lg_lock_ptr *lock;
@@ -124,15 +149,44 @@ void lg_global_unlock(struct lglock *lg)
 		lock = per_cpu_ptr(lg->lock, i);
 		lg_do_unlock(lock);
 	}
-	preempt_enable_nort();
+	preempt_enable();
+}
+EXPORT_SYMBOL(lg_global_unlock);
+
+#else
+/*
+ * Every local holder also holds lg->rwsem for read, so taking it for
+ * write excludes all of them with a single wait, instead of acquiring
+ * (and possibly blocking on) each per-CPU lock in turn.
+ */
+void lg_global_lock(struct lglock *lg)
+{
+	percpu_down_write(&lg->rwsem);
+	lock_acquire_exclusive(&lg->lock_dep_map, 0, 0, NULL, _RET_IP_);
+}
+EXPORT_SYMBOL(lg_global_lock);
+
+static void lg_global_unlock_relaxed(struct lglock *lg);
+
+void lg_global_unlock(struct lglock *lg)
+{
+	lock_release(&lg->lock_dep_map, 1, _RET_IP_);
+	if (unlikely(lg->relaxed)) {
+		lg_global_unlock_relaxed(lg);
+		return;
+	}
+	percpu_up_write(&lg->rwsem);
 }
 EXPORT_SYMBOL(lg_global_unlock);
 
-#ifdef CONFIG_PREEMPT_RT_FULL
 /*
  * HACK: If you use this, you get to keep the pieces.
  * Used in queue_stop_cpus_work() when stop machinery
  * is called from inactive CPU, so we can't schedule.
+ *
+ * percpu_down_write() may sleep, so exclude a global holder through the
+ * underlying rw_sem and the local holders, which keep their per-CPU lock
+ * for as long as they hold the read side, through the per-CPU locks.
  */
 # define lg_do_trylock_relax(l)			\
 	do {					\
@@ -144,11 +198,28 @@ void lg_global_trylock_relax(struct lglock *lg)
 {
 	int i;
 
+	while (!down_write_trylock(&lg->rwsem.rw_sem))
+		cpu_relax();
+
 	lock_acquire_exclusive(&lg->lock_dep_map, 0, 0, NULL, _RET_IP_);
 	for_each_possible_cpu(i) {
 		lg_lock_ptr *lock;
 		lock = per_cpu_ptr(lg->lock, i);
 		lg_do_trylock_relax(lock);
 	}
+	lg->relaxed = true;
+}
+
+static void lg_global_unlock_relaxed(struct lglock *lg)
+{
+	int i;
+
+	lg->relaxed = false;
+	for_each_possible_cpu(i) {
+		lg_lock_ptr *lock;
+		lock = per_cpu_ptr(lg->lock, i);
+		lg_do_unlock(lock);
+	}
+	up_write(&lg->rwsem.rw_sem);
 }
 #endif
@@ -36,6 +36,7 @@
 #include <linux/delay.h>
 #include <linux/slab.h>
 #include <linux/percpu-rwsem.h>
+#include <linux/lglock.h>
 #include <linux/torture.h>
 
 MODULE_LICENSE("GPL");
@@ -90,7 +91,8 @@ static void lock_torture_cleanup(void);
  * Operations vector for selecting different types of tests.
  */
 struct lock_torture_ops {
-	void (*init)(void);
+	int (*init)(void);
+	void (*exit)(void);
 	int (*writelock)(void);
 	void (*write_delay)(struct torture_random_state *trsp);
 	void (*task_boost)(struct torture_random_state *trsp);
@@ -107,6 +109,7 @@ struct lock_torture_cxt {
 	int nrealwriters_stress;
 	int nrealreaders_stress;
 	bool debug_lock;
+	bool init_called;
 	atomic_t n_lock_torture_errors;
 	struct lock_torture_ops *cur_ops;
 	struct lock_stress_stats *lwsa; /* writer statistics */
@@ -526,12 +529,55 @@ static struct lock_torture_ops rwsem_lock_ops = {
 	.name		= "rwsem_lock"
 };
 
+/*
+ * Same as rwsem_lock, but with readers sharing the lock on PREEMPT_RT_FULL
+ * as well. Comparing the reader counts of both shows what the opt-in buys.
+ */
+static DECLARE_RWSEM_MULTI_READER(torture_rwsem_mr);
+static int torture_rwsem_mr_down_write(void) __acquires(torture_rwsem_mr)
+{
+	down_write(&torture_rwsem_mr);
+	return 0;
+}
+
+static void torture_rwsem_mr_up_write(void) __releases(torture_rwsem_mr)
+{
+	up_write(&torture_rwsem_mr);
+}
+
+static int torture_rwsem_mr_down_read(void) __acquires(torture_rwsem_mr)
+{
+	down_read(&torture_rwsem_mr);
+	return 0;
+}
+
+static void torture_rwsem_mr_up_read(void) __releases(torture_rwsem_mr)
+{
+	up_read(&torture_rwsem_mr);
+}
+
+static struct lock_torture_ops rwsem_multi_reader_lock_ops = {
+	.writelock	= torture_rwsem_mr_down_write,
+	.write_delay	= torture_rwsem_write_delay,
+	.task_boost     = torture_boost_dummy,
+	.writeunlock	= torture_rwsem_mr_up_write,
+	.readlock       = torture_rwsem_mr_down_read,
+	.read_delay     = torture_rwsem_read_delay,
+	.readunlock     = torture_rwsem_mr_up_read,
+	.name		= "rwsem_multi_reader_lock"
+};
+
 #include <linux/percpu-rwsem.h>
 static struct percpu_rw_semaphore pcpu_rwsem;
 
-void torture_percpu_rwsem_init(void)
+static int torture_percpu_rwsem_init(void)
+{
+	return percpu_init_rwsem(&pcpu_rwsem);
+}
+
+static void torture_percpu_rwsem_exit(void)
 {
-	BUG_ON(percpu_init_rwsem(&pcpu_rwsem));
+	percpu_free_rwsem(&pcpu_rwsem);
 }
 
 static int torture_percpu_rwsem_down_write(void) __acquires(pcpu_rwsem)
@@ -558,6 +604,7 @@ static void torture_percpu_rwsem_up_read(void) __releases(pcpu_rwsem)
 
 static struct lock_torture_ops percpu_rwsem_lock_ops = {
 	.init		= torture_percpu_rwsem_init,
+	.exit		= torture_percpu_rwsem_exit,
 	.writelock	= torture_percpu_rwsem_down_write,
 	.write_delay	= torture_rwsem_write_delay,
 	.task_boost     = torture_boost_dummy,
@@ -568,6 +615,57 @@ static struct lock_torture_ops percpu_rwsem_lock_ops = {
 	.name		= "percpu_rwsem_lock"
 };
 
+/*
+ * lglock: the global side is the writer, the local side of whatever CPU
+ * the reader happens to run on is the reader.
+ */
+static DEFINE_STATIC_LGLOCK(torture_lglock);
+
+static int torture_lglock_init(void)
+{
+	return lg_lock_init(&torture_lglock, "torture_lglock");
+}
+
+static void torture_lglock_exit(void)
+{
+	lg_lock_free(&torture_lglock);
+}
+
+static int torture_lglock_global_lock(void) __acquires(torture_lglock)
+{
+	lg_global_lock(&torture_lglock);
+	return 0;
+}
+
+static void torture_lglock_global_unlock(void) __releases(torture_lglock)
+{
+	lg_global_unlock(&torture_lglock);
+}
+
+static int torture_lglock_local_lock(void) __acquires(torture_lglock)
+{
+	lg_local_lock(&torture_lglock);
+	return 0;
+}
+
+static void torture_lglock_local_unlock(void) __releases(torture_lglock)
+{
+	lg_local_unlock(&torture_lglock);
+}
+
+static struct lock_torture_ops lglock_lock_ops = {
+	.init		= torture_lglock_init,
+	.exit		= torture_lglock_exit,
+	.writelock	= torture_lglock_global_lock,
+	.write_delay	= torture_spin_lock_write_delay,
+	.task_boost     = torture_boost_dummy,
+	.writeunlock	= torture_lglock_global_unlock,
+	.readlock       = torture_lglock_local_lock,
+	.read_delay     = torture_rwsem_read_delay,
+	.readunlock     = torture_lglock_local_unlock,
+	.name		= "lglock"
+};
+
 /*
  * Lock torture writer kthread.  Repeatedly acquires and releases
  * the lock, checking for duplicate acquisitions.
@@ -775,6 +873,12 @@ static void lock_torture_cleanup(void)
 	else
 		lock_torture_print_module_parms(cxt.cur_ops,
 						"End of test: SUCCESS");
+
+	if (cxt.init_called) {
+		if (cxt.cur_ops->exit)
+			cxt.cur_ops->exit();
+		cxt.init_called = false;
+	}
 	torture_cleanup_end();
 }
 
@@ -791,7 +895,9 @@ static int __init lock_torture_init(void)
 		&rtmutex_lock_ops,
 #endif
 		&rwsem_lock_ops,
+		&rwsem_multi_reader_lock_ops,
 		&percpu_rwsem_lock_ops,
+		&lglock_lock_ops,
 	};
 
 	if (!torture_init_begin(torture_type, verbose, &torture_runnable))
@@ -813,8 +919,12 @@ static int __init lock_torture_init(void)
 		firsterr = -EINVAL;
 		goto unwind;
 	}
-	if (cxt.cur_ops->init)
-		cxt.cur_ops->init();
+	if (cxt.cur_ops->init) {
+		firsterr = cxt.cur_ops->init();
+		if (firsterr)
+			goto unwind;
+		cxt.init_called = true;
+	}
 
 	if (nwriters_stress >= 0)
 		cxt.nrealwriters_stress = nwriters_stress;
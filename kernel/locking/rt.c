@@ -310,15 +310,175 @@ EXPORT_SYMBOL(__rt_rwlock_init);
  * rw_semaphores
  */
 
+/*
+ * Multi-reader rw_semaphores: while no writer is around, @readers is
+ * RWSEM_READER_BIAS plus the number of active readers, and readers get
+ * in with a cmpxchg. A writer takes the rtmutex, which keeps out other
+ * writers, removes the bias to force new readers into the slow path and
+ * waits for the active readers to leave. Slow path readers still get in
+ * until the writer has owned the lock completely (RWSEM_WRITER_BIAS);
+ * after that they block on the rtmutex and boost the writer.
+ */
+static int rwsem_mr_read_trylock(struct rw_semaphore *rwsem)
+{
+	int r, old;
+
+	for (r = atomic_read(&rwsem->readers); r < 0;) {
+		old = atomic_cmpxchg(&rwsem->readers, r, r + 1);
+		if (likely(old == r))
+			return 1;
+		r = old;
+	}
+	return 0;
+}
+
+static void rwsem_mr_read_lock(struct rw_semaphore *rwsem)
+{
+	struct rt_mutex *m = &rwsem->lock;
+
+	if (rwsem_mr_read_trylock(rwsem))
+		return;
+
+	might_sleep();
+	raw_spin_lock_irq(&m->wait_lock);
+	if (atomic_read(&rwsem->readers) != RWSEM_WRITER_BIAS) {
+		atomic_inc(&rwsem->readers);
+		raw_spin_unlock_irq(&m->wait_lock);
+		return;
+	}
+	raw_spin_unlock_irq(&m->wait_lock);
+
+	/*
+	 * A writer owns the lock. No writer can be active while we hold
+	 * the rtmutex, so the bias is back and we can account as reader.
+	 */
+	rt_mutex_lock(m);
+	atomic_inc(&rwsem->readers);
+	rt_mutex_unlock(m);
+}
+
+static void rwsem_mr_read_unlock(struct rw_semaphore *rwsem)
+{
+	struct rt_mutex *m = &rwsem->lock;
+	struct task_struct *owner;
+
+	/* @readers only drops to 0 when a writer waits for the readers */
+	if (!atomic_dec_and_test(&rwsem->readers))
+		return;
+
+	/*
+	 * Wake the writer, i.e. the rtmutex owner. It needs wait_lock to
+	 * take the lock, so the worst case here is a spurious wakeup.
+	 */
+	raw_spin_lock_irq(&m->wait_lock);
+	owner = rt_mutex_owner(m);
+	if (owner)
+		wake_up_process(owner);
+	raw_spin_unlock_irq(&m->wait_lock);
+}
+
+static void rwsem_mr_write_unlock_locked(struct rw_semaphore *rwsem,
+					 int bias, unsigned long flags)
+{
+	struct rt_mutex *m = &rwsem->lock;
+
+	atomic_add(RWSEM_READER_BIAS - bias, &rwsem->readers);
+	raw_spin_unlock_irqrestore(&m->wait_lock, flags);
+	rt_mutex_unlock(m);
+}
+
+static void rwsem_mr_write_lock(struct rw_semaphore *rwsem)
+{
+	struct rt_mutex *m = &rwsem->lock;
+	unsigned long flags;
+
+	rt_mutex_lock(m);
+
+	/* force new readers into the slow path */
+	atomic_sub(RWSEM_READER_BIAS, &rwsem->readers);
+
+	set_current_state(TASK_UNINTERRUPTIBLE);
+	for (;;) {
+		raw_spin_lock_irqsave(&m->wait_lock, flags);
+		if (!atomic_read(&rwsem->readers)) {
+			atomic_set(&rwsem->readers, RWSEM_WRITER_BIAS);
+			__set_current_state(TASK_RUNNING);
+			raw_spin_unlock_irqrestore(&m->wait_lock, flags);
+			return;
+		}
+		raw_spin_unlock_irqrestore(&m->wait_lock, flags);
+
+		if (atomic_read(&rwsem->readers))
+			schedule();
+		set_current_state(TASK_UNINTERRUPTIBLE);
+	}
+}
+
+static int rwsem_mr_write_trylock(struct rw_semaphore *rwsem)
+{
+	struct rt_mutex *m = &rwsem->lock;
+	unsigned long flags;
+
+	if (!rt_mutex_trylock(m))
+		return 0;
+
+	atomic_sub(RWSEM_READER_BIAS, &rwsem->readers);
+
+	raw_spin_lock_irqsave(&m->wait_lock, flags);
+	if (!atomic_read(&rwsem->readers)) {
+		atomic_set(&rwsem->readers, RWSEM_WRITER_BIAS);
+		raw_spin_unlock_irqrestore(&m->wait_lock, flags);
+		return 1;
+	}
+	rwsem_mr_write_unlock_locked(rwsem, 0, flags);
+	return 0;
+}
+
+static void rwsem_mr_write_unlock(struct rw_semaphore *rwsem, int bias)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&rwsem->lock.wait_lock, flags);
+	rwsem_mr_write_unlock_locked(rwsem, bias, flags);
+}
+
+/**
+ * rwsem_set_multi_reader - let readers of @rwsem share the lock
+ * @rwsem: the rw_semaphore, which must not be locked
+ */
+void rwsem_set_multi_reader(struct rw_semaphore *rwsem)
+{
+	WARN_ON(rwsem_is_locked(rwsem));
+	atomic_set(&rwsem->readers, RWSEM_READER_BIAS);
+	rwsem->multi_reader = true;
+}
+EXPORT_SYMBOL(rwsem_set_multi_reader);
+
+static void __rt_down_write(struct rw_semaphore *rwsem)
+{
+	if (rwsem->multi_reader)
+		rwsem_mr_write_lock(rwsem);
+	else
+		rt_mutex_lock(&rwsem->lock);
+}
+
 void  rt_up_write(struct rw_semaphore *rwsem)
 {
 	rwsem_release(&rwsem->dep_map, 1, _RET_IP_);
-	rt_mutex_unlock(&rwsem->lock);
+	if (rwsem->multi_reader)
+		rwsem_mr_write_unlock(rwsem, RWSEM_WRITER_BIAS);
+	else
+		rt_mutex_unlock(&rwsem->lock);
 }
 EXPORT_SYMBOL(rt_up_write);
 
 void __rt_up_read(struct rw_semaphore *rwsem)
 {
+	if (rwsem->multi_reader) {
+		rwsem_mr_read_unlock(rwsem);
+		return;
+	}
+
 	if (--rwsem->read_depth == 0)
 		rt_mutex_unlock(&rwsem->lock);
 }
@@ -337,13 +497,22 @@ EXPORT_SYMBOL(rt_up_read);
 void  rt_downgrade_write(struct rw_semaphore *rwsem)
 {
 	BUG_ON(rt_mutex_owner(&rwsem->lock) != current);
-	rwsem->read_depth = 1;
+	if (rwsem->multi_reader)
+		/* release the writer and account current as reader */
+		rwsem_mr_write_unlock(rwsem, RWSEM_WRITER_BIAS - 1);
+	else
+		rwsem->read_depth = 1;
 }
 EXPORT_SYMBOL(rt_downgrade_write);
 
 int  rt_down_write_trylock(struct rw_semaphore *rwsem)
 {
-	int ret = rt_mutex_trylock(&rwsem->lock);
+	int ret;
+
+	if (rwsem->multi_reader)
+		ret = rwsem_mr_write_trylock(rwsem);
+	else
+		ret = rt_mutex_trylock(&rwsem->lock);
 
 	if (ret)
 		rwsem_acquire(&rwsem->dep_map, 0, 1, _RET_IP_);
@@ -354,14 +523,14 @@ EXPORT_SYMBOL(rt_down_write_trylock);
 void  rt_down_write(struct rw_semaphore *rwsem)
 {
 	rwsem_acquire(&rwsem->dep_map, 0, 0, _RET_IP_);
-	rt_mutex_lock(&rwsem->lock);
+	__rt_down_write(rwsem);
 }
 EXPORT_SYMBOL(rt_down_write);
 
 void  rt_down_write_nested(struct rw_semaphore *rwsem, int subclass)
 {
 	rwsem_acquire(&rwsem->dep_map, subclass, 0, _RET_IP_);
-	rt_mutex_lock(&rwsem->lock);
+	__rt_down_write(rwsem);
 }
 EXPORT_SYMBOL(rt_down_write_nested);
 
@@ -369,7 +538,7 @@ void rt_down_write_nested_lock(struct rw_semaphore *rwsem,
 			       struct lockdep_map *nest)
 {
 	rwsem_acquire_nest(&rwsem->dep_map, 0, 0, nest, _RET_IP_);
-	rt_mutex_lock(&rwsem->lock);
+	__rt_down_write(rwsem);
 }
 EXPORT_SYMBOL(rt_down_write_nested_lock);
 
@@ -378,6 +547,9 @@ int rt__down_read_trylock(struct rw_semaphore *rwsem)
 	struct rt_mutex *lock = &rwsem->lock;
 	int ret = 1;
 
+	if (rwsem->multi_reader)
+		return rwsem_mr_read_trylock(rwsem);
+
 	/*
 	 * recursive read locks succeed when current owns the rwsem,
 	 * but not when read_depth == 0 which means that the rwsem is
@@ -410,6 +582,11 @@ void rt__down_read(struct rw_semaphore *rwsem)
 {
 	struct rt_mutex *lock = &rwsem->lock;
 
+	if (rwsem->multi_reader) {
+		rwsem_mr_read_lock(rwsem);
+		return;
+	}
+
 	if (rt_mutex_owner(lock) != current)
 		rt_mutex_lock(&rwsem->lock);
 	rwsem->read_depth++;
@@ -445,6 +622,8 @@ void  __rt_rwsem_init(struct rw_semaphore *rwsem, const char *name,
 	lockdep_init_map(&rwsem->dep_map, name, key, 0);
 #endif
 	rwsem->read_depth = 0;
+	rwsem->multi_reader = false;
+	atomic_set(&rwsem->readers, 0);
 	rwsem->lock.save_state = 0;
 }
 EXPORT_SYMBOL(__rt_rwsem_init);
@@ -0,0 +1,278 @@
+/*
+ * RT-Mutexes: adaptive spin statistics for sleeping spinlocks
+ *
+ * Accounts the outcome of the adaptive spin in rt_spin_lock_slowlock()
+ * per lock class, and lets the spin budget be overridden per class. The
+ * class is the lockdep class of the spinlock; without lockdep, and for
+ * locks which have no lockdep map (rwlocks, raw rt_mutex users), all
+ * contention is accounted to one catch-all class.
+ *
+ * The data is in /sys/kernel/debug/rt_spin_lock/:
+ *
+ *  stats:  one line per class, writing to it clears the counters
+ *  budget: write "<class> <ns>" to override the spin budget of a class,
+ *          "<class> default" to go back to the global budget
+ */
+#include <linux/debugfs.h>
+#include <linux/hash.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+
+#include "rtmutex-stat.h"
+
+#define RT_SPIN_CLASS_HASH_BITS	8
+#define RT_SPIN_CLASSES		(1 << RT_SPIN_CLASS_HASH_BITS)
+#define RT_SPIN_CLASS_NAME_LEN	32
+
+struct rt_spin_class {
+	const void		*key;
+	char			name[RT_SPIN_CLASS_NAME_LEN];
+	bool			has_budget;
+	int			budget_ns;
+	atomic_long_t		spins[RT_SPIN_NR_OUTCOMES];
+	atomic64_t		spin_ns;
+	atomic_long_t		sleeps;
+	atomic64_t		sleep_ns;
+};
+
+static struct rt_spin_class rt_spin_classes[RT_SPIN_CLASSES];
+static atomic_t rt_spin_classes_lost;
+static DEFINE_MUTEX(rt_spin_stat_mutex);
+
+/* key of the catch-all class */
+static const char rt_spin_other_key[] = "<other>";
+
+static void rt_spin_class_init(struct rt_spin_class *class,
+			       struct lockdep_map *dep_map)
+{
+	const char *name = rt_spin_other_key;
+
+#ifdef CONFIG_DEBUG_LOCK_ALLOC
+	if (dep_map && dep_map->name)
+		name = dep_map->name;
+#endif
+	strlcpy(class->name, name, sizeof(class->name));
+}
+
+/*
+ * Find the class of @dep_map, allocating it on first contention. This is
+ * called from the lock slow path, hence the lockless open addressing.
+ * Returns NULL once the table is full.
+ */
+struct rt_spin_class *rt_spin_class_get(struct lockdep_map *dep_map)
+{
+	const void *key = rt_spin_other_key;
+	unsigned int i, h;
+
+#ifdef CONFIG_DEBUG_LOCK_ALLOC
+	if (dep_map && dep_map->key)
+		key = dep_map->key;
+#endif
+
+	h = hash_ptr((void *)key, RT_SPIN_CLASS_HASH_BITS);
+	for (i = 0; i < RT_SPIN_CLASSES; i++) {
+		struct rt_spin_class *class;
+		const void *old;
+
+		class = &rt_spin_classes[(h + i) & (RT_SPIN_CLASSES - 1)];
+		old = READ_ONCE(class->key);
+		if (old == key)
+			return class;
+		if (old)
+			continue;
+
+		old = cmpxchg(&class->key, NULL, key);
+		if (!old) {
+			rt_spin_class_init(class, dep_map);
+			return class;
+		}
+		if (old == key)
+			return class;
+	}
+
+	atomic_inc(&rt_spin_classes_lost);
+	return NULL;
+}
+
+int rt_spin_class_budget(struct rt_spin_class *class)
+{
+	if (!class || !READ_ONCE(class->has_budget))
+		return READ_ONCE(rt_spin_budget_ns);
+
+	return READ_ONCE(class->budget_ns);
+}
+
+void rt_spin_stat_spin(struct rt_spin_class *class,
+		       enum rt_spin_outcome outcome, u64 ns)
+{
+	if (!class)
+		return;
+
+	atomic_long_inc(&class->spins[outcome]);
+	atomic64_add(ns, &class->spin_ns);
+}
+
+void rt_spin_stat_sleep(struct rt_spin_class *class, u64 ns)
+{
+	if (!class)
+		return;
+
+	atomic_long_inc(&class->sleeps);
+	atomic64_add(ns, &class->sleep_ns);
+}
+
+static int rt_spin_stats_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	seq_printf(m, "# global budget: %d ns, classes lost: %d\n",
+		   READ_ONCE(rt_spin_budget_ns),
+		   atomic_read(&rt_spin_classes_lost));
+	seq_printf(m, "# %-30s %10s %10s %10s %10s %14s %10s %14s\n",
+		   "class", "budget", "released", "ownerslept", "timeout",
+		   "spin_ns", "sleeps", "sleep_ns");
+
+	for (i = 0; i < RT_SPIN_CLASSES; i++) {
+		struct rt_spin_class *class = &rt_spin_classes[i];
+		int budget;
+
+		if (!READ_ONCE(class->key))
+			continue;
+
+		budget = rt_spin_class_budget(class);
+		seq_printf(m, "%-32s %10d %10ld %10ld %10ld %14lld %10ld %14lld\n",
+			   class->name, budget,
+			   atomic_long_read(&class->spins[RT_SPIN_RELEASED]),
+			   atomic_long_read(&class->spins[RT_SPIN_OWNER_SLEPT]),
+			   atomic_long_read(&class->spins[RT_SPIN_TIMEOUT]),
+			   (long long)atomic64_read(&class->spin_ns),
+			   atomic_long_read(&class->sleeps),
+			   (long long)atomic64_read(&class->sleep_ns));
+	}
+
+	return 0;
+}
+
+static int rt_spin_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rt_spin_stats_show, NULL);
+}
+
+static ssize_t rt_spin_stats_write(struct file *file, const char __user *ubuf,
+				   size_t cnt, loff_t *ppos)
+{
+	int i, j;
+
+	for (i = 0; i < RT_SPIN_CLASSES; i++) {
+		struct rt_spin_class *class = &rt_spin_classes[i];
+
+		for (j = 0; j < RT_SPIN_NR_OUTCOMES; j++)
+			atomic_long_set(&class->spins[j], 0);
+		atomic64_set(&class->spin_ns, 0);
+		atomic_long_set(&class->sleeps, 0);
+		atomic64_set(&class->sleep_ns, 0);
+	}
+	atomic_set(&rt_spin_classes_lost, 0);
+
+	return cnt;
+}
+
+static const struct file_operations rt_spin_stats_fops = {
+	.open		= rt_spin_stats_open,
+	.read		= seq_read,
+	.write		= rt_spin_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static ssize_t rt_spin_budget_write(struct file *file, const char __user *ubuf,
+				    size_t cnt, loff_t *ppos)
+{
+	char buf[RT_SPIN_CLASS_NAME_LEN + 16];
+	char *name, *val;
+	bool has_budget = true;
+	int budget = 0, i;
+	ssize_t ret = -ENOENT;
+
+	if (cnt >= sizeof(buf))
+		return -EINVAL;
+
+	if (copy_from_user(buf, ubuf, cnt))
+		return -EFAULT;
+
+	buf[cnt] = '\0';
+
+	val = strstrip(buf);
+	name = strsep(&val, " \t");
+	if (!val)
+		return -EINVAL;
+	val = skip_spaces(val);
+
+	if (!strcmp(val, "default"))
+		has_budget = false;
+	else if (kstrtoint(val, 10, &budget) || budget < RT_SPIN_UNBOUNDED)
+		return -EINVAL;
+
+	/* the name truncated on registration gets matched truncated */
+	mutex_lock(&rt_spin_stat_mutex);
+	for (i = 0; i < RT_SPIN_CLASSES; i++) {
+		struct rt_spin_class *class = &rt_spin_classes[i];
+
+		if (!READ_ONCE(class->key) ||
+		    strncmp(class->name, name, sizeof(class->name) - 1))
+			continue;
+
+		WRITE_ONCE(class->budget_ns, budget);
+		WRITE_ONCE(class->has_budget, has_budget);
+		ret = cnt;
+	}
+	mutex_unlock(&rt_spin_stat_mutex);
+
+	return ret;
+}
+
+static int rt_spin_budget_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	for (i = 0; i < RT_SPIN_CLASSES; i++) {
+		struct rt_spin_class *class = &rt_spin_classes[i];
+
+		if (READ_ONCE(class->key) && READ_ONCE(class->has_budget))
+			seq_printf(m, "%s %d\n", class->name,
+				   READ_ONCE(class->budget_ns));
+	}
+
+	return 0;
+}
+
+static int rt_spin_budget_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rt_spin_budget_show, NULL);
+}
+
+static const struct file_operations rt_spin_budget_fops = {
+	.open		= rt_spin_budget_open,
+	.read		= seq_read,
+	.write		= rt_spin_budget_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init rt_spin_stat_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("rt_spin_lock", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_file("stats", 0644, dir, NULL, &rt_spin_stats_fops);
+	debugfs_create_file("budget", 0644, dir, NULL, &rt_spin_budget_fops);
+
+	return 0;
+}
+fs_initcall(rt_spin_stat_init);
@@ -0,0 +1,67 @@
+/*
+ * RT-Mutexes: adaptive spin statistics for sleeping spinlocks
+ *
+ * This file contains the interface between rtmutex.c and rtmutex-stat.c.
+ */
+
+#ifndef __KERNEL_RTMUTEX_STAT_H
+#define __KERNEL_RTMUTEX_STAT_H
+
+#include <linux/lockdep.h>
+
+/*
+ * Spin budget in nanoseconds of a waiter in the adaptive spin loop:
+ * RT_SPIN_UNBOUNDED spins as long as the owner runs, 0 sleeps right away.
+ */
+#define RT_SPIN_UNBOUNDED	(-1)
+
+extern int rt_spin_budget_ns;
+
+enum rt_spin_outcome {
+	RT_SPIN_RELEASED,	/* owner released the lock, retry */
+	RT_SPIN_OWNER_SLEPT,	/* owner got scheduled out, sleep */
+	RT_SPIN_TIMEOUT,	/* budget exhausted, sleep */
+	RT_SPIN_NR_OUTCOMES,
+};
+
+struct rt_spin_class;
+
+#ifdef CONFIG_RT_SPIN_LOCK_STAT
+extern struct rt_spin_class *rt_spin_class_get(struct lockdep_map *dep_map);
+extern int rt_spin_class_budget(struct rt_spin_class *class);
+extern void rt_spin_stat_spin(struct rt_spin_class *class,
+			      enum rt_spin_outcome outcome, u64 ns);
+extern void rt_spin_stat_sleep(struct rt_spin_class *class, u64 ns);
+
+static inline bool rt_spin_stat_enabled(void)
+{
+	return true;
+}
+#else
+static inline struct rt_spin_class *
+rt_spin_class_get(struct lockdep_map *dep_map)
+{
+	return NULL;
+}
+
+static inline int rt_spin_class_budget(struct rt_spin_class *class)
+{
+	return READ_ONCE(rt_spin_budget_ns);
+}
+
+static inline void rt_spin_stat_spin(struct rt_spin_class *class,
+				     enum rt_spin_outcome outcome, u64 ns)
+{
+}
+
+static inline void rt_spin_stat_sleep(struct rt_spin_class *class, u64 ns)
+{
+}
+
+static inline bool rt_spin_stat_enabled(void)
+{
+	return false;
+}
+#endif
+
+#endif
@@ -22,8 +22,10 @@
 #include <linux/sched/deadline.h>
 #include <linux/timer.h>
 #include <linux/ww_mutex.h>
+#include <linux/moduleparam.h>
 
 #include "rtmutex_common.h"
+#include "rtmutex-stat.h"
 
 /*
  * lock->owner state tracking:
@@ -925,8 +927,10 @@ takeit:
  */
 static inline void rt_spin_lock_fastlock(struct rt_mutex *lock,
 					 void  (*slowfn)(struct rt_mutex *lock,
-							 bool mg_off),
-					 bool do_mig_dis)
+							 bool mg_off,
+							 struct lockdep_map *dep_map),
+					 bool do_mig_dis,
+					 struct lockdep_map *dep_map)
 {
 	might_sleep_no_state_check();
 
@@ -936,7 +940,7 @@ static inline void rt_spin_lock_fastlock(struct rt_mutex *lock,
 	if (likely(rt_mutex_cmpxchg_acquire(lock, NULL, current)))
 		rt_mutex_deadlock_account_lock(lock, current);
 	else
-		slowfn(lock, do_mig_dis);
+		slowfn(lock, do_mig_dis, dep_map);
 }
 
 static inline void rt_spin_lock_fastunlock(struct rt_mutex *lock,
@@ -947,15 +951,41 @@ static inline void rt_spin_lock_fastunlock(struct rt_mutex *lock,
 	else
 		slowfn(lock);
 }
+#ifdef CONFIG_DEBUG_LOCK_ALLOC
+# define rt_spin_dep_map(slock)	(&(slock)->dep_map)
+#else
+# define rt_spin_dep_map(slock)	NULL
+#endif
+
+/*
+ * Upper bound of the adaptive spin, see rtmutex-stat.h. Spinning for as
+ * long as the owner runs is the historic behaviour and stays the default.
+ */
+int rt_spin_budget_ns = RT_SPIN_UNBOUNDED;
+core_param(rt_spin_budget_ns, rt_spin_budget_ns, int, 0644);
+
 #ifdef CONFIG_SMP
+/* reading the clock on every iteration would dominate the spin loop */
+#define RT_SPIN_CLOCK_INTERVAL	64
+
 /*
  * Note that owner is a speculative pointer and dereferencing relies
  * on rcu_read_lock() and the check against the lock owner.
  */
 static int adaptive_wait(struct rt_mutex *lock,
-			 struct task_struct *owner)
+			 struct task_struct *owner,
+			 struct rt_spin_class *class)
 {
-	int res = 0;
+	enum rt_spin_outcome outcome = RT_SPIN_RELEASED;
+	int budget = rt_spin_class_budget(class);
+	unsigned int loops = 0;
+	u64 start = 0;
+
+	if (!budget)
+		return 1;
+
+	if (budget != RT_SPIN_UNBOUNDED || rt_spin_stat_enabled())
+		start = local_clock();
 
 	rcu_read_lock();
 	for (;;) {
@@ -967,17 +997,28 @@ static int adaptive_wait(struct rt_mutex *lock,
 		 */
 		barrier();
 		if (!owner->on_cpu) {
-			res = 1;
+			outcome = RT_SPIN_OWNER_SLEPT;
+			break;
+		}
+		if (budget != RT_SPIN_UNBOUNDED &&
+		    !(++loops % RT_SPIN_CLOCK_INTERVAL) &&
+		    local_clock() - start >= budget) {
+			outcome = RT_SPIN_TIMEOUT;
 			break;
 		}
 		cpu_relax();
 	}
 	rcu_read_unlock();
-	return res;
+
+	if (rt_spin_stat_enabled())
+		rt_spin_stat_spin(class, outcome, local_clock() - start);
+
+	return outcome != RT_SPIN_RELEASED;
 }
 #else
 static int adaptive_wait(struct rt_mutex *lock,
-			 struct task_struct *orig_owner)
+			 struct task_struct *orig_owner,
+			 struct rt_spin_class *class)
 {
 	return 1;
 }
@@ -995,11 +1036,14 @@ static int task_blocks_on_rt_mutex(struct rt_mutex *lock,
  * the try_to_wake_up() code handles this accordingly.
  */
 static void  noinline __sched rt_spin_lock_slowlock(struct rt_mutex *lock,
-						    bool mg_off)
+						    bool mg_off,
+						    struct lockdep_map *dep_map)
 {
 	struct task_struct *lock_owner, *self = current;
 	struct rt_mutex_waiter waiter, *top_waiter;
+	struct rt_spin_class *class;
 	unsigned long flags;
+	u64 sleep_start = 0;
 	int ret;
 
 	rt_mutex_init_waiter(&waiter, true);
@@ -1027,6 +1071,8 @@ static void  noinline __sched rt_spin_lock_slowlock(struct rt_mutex *lock,
 	ret = task_blocks_on_rt_mutex(lock, &waiter, self, RT_MUTEX_MIN_CHAINWALK);
 	BUG_ON(ret);
 
+	class = rt_spin_class_get(dep_map);
+
 	for (;;) {
 		/* Try to acquire the lock again. */
 		if (__try_to_take_rt_mutex(lock, self, &waiter, STEAL_LATERAL))
@@ -1039,10 +1085,16 @@ static void  noinline __sched rt_spin_lock_slowlock(struct rt_mutex *lock,
 
 		debug_rt_mutex_print_deadlock(&waiter);
 
-		if (top_waiter != &waiter || adaptive_wait(lock, lock_owner)) {
+		if (top_waiter != &waiter ||
+		    adaptive_wait(lock, lock_owner, class)) {
 			if (mg_off)
 				migrate_enable();
+			if (rt_spin_stat_enabled())
+				sleep_start = local_clock();
 			schedule();
+			if (rt_spin_stat_enabled())
+				rt_spin_stat_sleep(class,
+						   local_clock() - sleep_start);
 			if (mg_off)
 				migrate_disable();
 		}
@@ -1116,27 +1168,29 @@ static void  noinline __sched rt_spin_lock_slowunlock(struct rt_mutex *lock)
 
 void __lockfunc rt_spin_lock__no_mg(spinlock_t *lock)
 {
-	rt_spin_lock_fastlock(&lock->lock, rt_spin_lock_slowlock, false);
+	rt_spin_lock_fastlock(&lock->lock, rt_spin_lock_slowlock, false,
+			      rt_spin_dep_map(lock));
 	spin_acquire(&lock->dep_map, 0, 0, _RET_IP_);
 }
 EXPORT_SYMBOL(rt_spin_lock__no_mg);
 
 void __lockfunc rt_spin_lock(spinlock_t *lock)
 {
-	rt_spin_lock_fastlock(&lock->lock, rt_spin_lock_slowlock, true);
+	rt_spin_lock_fastlock(&lock->lock, rt_spin_lock_slowlock, true,
+			      rt_spin_dep_map(lock));
 	spin_acquire(&lock->dep_map, 0, 0, _RET_IP_);
 }
 EXPORT_SYMBOL(rt_spin_lock);
 
 void __lockfunc __rt_spin_lock(struct rt_mutex *lock)
 {
-	rt_spin_lock_fastlock(lock, rt_spin_lock_slowlock, true);
+	rt_spin_lock_fastlock(lock, rt_spin_lock_slowlock, true, NULL);
 }
 EXPORT_SYMBOL(__rt_spin_lock);
 
 void __lockfunc __rt_spin_lock__no_mg(struct rt_mutex *lock)
 {
-	rt_spin_lock_fastlock(lock, rt_spin_lock_slowlock, false);
+	rt_spin_lock_fastlock(lock, rt_spin_lock_slowlock, false, NULL);
 }
 EXPORT_SYMBOL(__rt_spin_lock__no_mg);
 
@@ -1144,7 +1198,8 @@ EXPORT_SYMBOL(__rt_spin_lock__no_mg);
 void __lockfunc rt_spin_lock_nested(spinlock_t *lock, int subclass)
 {
 	spin_acquire(&lock->dep_map, subclass, 0, _RET_IP_);
-	rt_spin_lock_fastlock(&lock->lock, rt_spin_lock_slowlock, true);
+	rt_spin_lock_fastlock(&lock->lock, rt_spin_lock_slowlock, true,
+			      &lock->dep_map);
 }
 EXPORT_SYMBOL(rt_spin_lock_nested);
 #endif
@@ -498,8 +498,13 @@ static int swap_writer_finish(struct swap_map_handle *handle,
 			             LZO_HEADER, PAGE_SIZE)
 #define LZO_CMP_SIZE	(LZO_CMP_PAGES * PAGE_SIZE)
 
-/* Maximum number of threads for compression/decompression. */
-#define LZO_THREADS	3
+/*
+ * Maximum number of threads for compression/decompression. One thread per
+ * online CPU but one is used, the remaining CPU does CRC32 and I/O. Each
+ * thread needs about LZO_UNC_SIZE + LZO_CMP_SIZE + LZO1X_1_MEM_COMPRESS of
+ * vmalloc space.
+ */
+#define LZO_THREADS	8
 
 /* Minimum/maximum number of pages for read buffering. */
 #define LZO_MIN_RD_PAGES	1024
@@ -43,6 +43,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/utsname.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
@@ -1751,6 +1752,82 @@ static size_t cont_print_text(char *text, size_t size)
 	return textlen;
 }
 
+/*
+ * With printk.offload set, printk() only stores the message and wakes the
+ * "printk" kernel thread, which does the console output, so a task that
+ * prints never waits for a slow serial console. The thread is SCHED_NORMAL:
+ * on PREEMPT_RT it runs below every RT task. Output stays synchronous
+ * until the system is running, for panic and oops (oops_in_progress), and
+ * for KERN_EMERG messages, which must not wait for the thread to run.
+ */
+static bool __read_mostly printk_offload = IS_ENABLED(CONFIG_PREEMPT_RT_FULL);
+module_param_named(offload, printk_offload, bool, S_IRUGO | S_IWUSR);
+
+static struct task_struct *printk_kthread;
+
+static bool printk_offload_console(int level)
+{
+	if (!printk_offload || !printk_kthread)
+		return false;
+	if (oops_in_progress || system_state != SYSTEM_RUNNING)
+		return false;
+	return level != LOGLEVEL_EMERG;
+}
+
+static void wake_up_printk_kthread(void)
+{
+	wake_up_process(printk_kthread);
+}
+
+static void defer_console_output(void);
+
+static bool printk_kthread_pending(void)
+{
+	bool pending;
+
+	/* resume_console() flushes whatever piled up while suspended */
+	if (console_suspended)
+		return false;
+
+	raw_spin_lock_irq(&logbuf_lock);
+	pending = console_seq != log_next_seq ||
+		  (cont.len && cont.cons < cont.len);
+	raw_spin_unlock_irq(&logbuf_lock);
+
+	return pending;
+}
+
+static int printk_kthread_func(void *data)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!printk_kthread_pending())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		/* console_lock() allows console_unlock() to cond_resched() */
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *tsk;
+
+	tsk = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(tsk)) {
+		pr_err("printk: unable to create printing thread\n");
+		return PTR_ERR(tsk);
+	}
+	printk_kthread = tsk;
+
+	return 0;
+}
+early_initcall(printk_kthread_init);
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const char *dict, size_t dictlen,
 			    const char *fmt, va_list args)
@@ -1908,7 +1985,13 @@ asmlinkage int vprintk_emit(int facility, int level,
 	local_irq_restore(flags);
 
 	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	if (!in_sched && printk_offload_console(level)) {
+		/*
+		 * The caller may hold locks that wake_up_process() takes,
+		 * so the thread is woken from irq_work, as klogd is.
+		 */
+		defer_console_output();
+	} else if (!in_sched) {
 		lockdep_off();
 		/*
 		 * Disable preemption to avoid being preempted while holding
@@ -2810,7 +2893,9 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
 		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		if (printk_offload_console(LOGLEVEL_DEFAULT))
+			wake_up_printk_kthread();
+		else if (console_trylock())
 			console_unlock();
 	}
 
@@ -2833,6 +2918,14 @@ void wake_up_klogd(void)
 	preempt_enable();
 }
 
+static void defer_console_output(void)
+{
+	preempt_disable();
+	__this_cpu_or(printk_pending, PRINTK_PENDING_OUTPUT);
+	irq_work_queue(this_cpu_ptr(&wake_up_klogd_work));
+	preempt_enable();
+}
+
 int printk_deferred(const char *fmt, ...)
 {
 	va_list args;
@@ -2843,8 +2936,7 @@ int printk_deferred(const char *fmt, ...)
 	r = vprintk_emit(0, LOGLEVEL_SCHED, NULL, 0, fmt, args);
 	va_end(args);
 
-	__this_cpu_or(printk_pending, PRINTK_PENDING_OUTPUT);
-	irq_work_queue(this_cpu_ptr(&wake_up_klogd_work));
+	defer_console_output();
 	preempt_enable();
 
 	return r;
@@ -1944,7 +1944,7 @@ static int rcu_gp_init(struct rcu_state *rsp)
 			WRITE_ONCE(rnp->completed, rsp->completed);
 		if (rnp == rdp->mynode)
 			(void)__note_gp_changes(rsp, rnp, rdp);
-		rcu_preempt_boost_start_gp(rnp);
+		rcu_preempt_boost_start_gp(rsp, rnp);
 		trace_rcu_grace_period_init(rsp->name, rnp->gpnum,
 					    rnp->level, rnp->grplo,
 					    rnp->grphi, rnp->qsmask);
@@ -2307,6 +2307,7 @@ rcu_report_qs_rnp(unsigned long mask, struct rcu_state *rsp,
 			raw_spin_unlock_irqrestore(&rnp->lock, flags);
 			return;
 		}
+		rcu_preempt_boost_end_gp(rnp);
 		mask = rnp->grpmask;
 		if (rnp->parent == NULL) {
 
@@ -2351,6 +2352,7 @@ static void rcu_report_unblock_qs_rnp(struct rcu_state *rsp,
 		return;  /* Still need more quiescent states! */
 	}
 
+	rcu_preempt_boost_end_gp(rnp);
 	rnp_p = rnp->parent;
 	if (rnp_p == NULL) {
 		/*
@@ -241,6 +241,27 @@ struct rcu_node {
 	unsigned long n_balk_nos;
 				/* Refused to boost: not sure why, though. */
 				/*  This can happen due to race conditions. */
+	unsigned long n_boost_early;
+				/* GPs with boost delay shortened due to */
+				/*  the callback backlog. */
+	unsigned long boost_jiffies;
+				/* Total time boosted readers took to exit. */
+	unsigned long boost_jiffies_max;
+				/* Longest time a boosted reader took. */
+	unsigned long n_blkd_exits;
+				/* Readers exiting after being preempted. */
+	unsigned long blkd_jiffies;
+				/* Total time readers were preempted. */
+	unsigned long blkd_jiffies_max;
+				/* Longest time a reader was preempted. */
+	unsigned long gp_start;
+				/* When the current GP started (jiffies). */
+	unsigned long n_gps;
+				/* GPs this rcu_node structure completed. */
+	unsigned long gp_jiffies;
+				/* Total time this node held up GPs. */
+	unsigned long gp_jiffies_max;
+				/* Longest time this node held up a GP. */
 #ifdef CONFIG_RCU_NOCB_CPU
 	struct swait_queue_head nocb_gp_wq[2];
 				/* Place for rcu_nocb_kthread() to wait GP. */
@@ -587,7 +608,11 @@ static void rcu_preempt_check_callbacks(void);
 void call_rcu(struct rcu_head *head, rcu_callback_t func);
 static void __init __rcu_init_preempt(void);
 static void rcu_initiate_boost(struct rcu_node *rnp, unsigned long flags);
-static void rcu_preempt_boost_start_gp(struct rcu_node *rnp);
+static void rcu_preempt_boost_start_gp(struct rcu_state *rsp,
+				       struct rcu_node *rnp);
+static void rcu_preempt_boost_end_gp(struct rcu_node *rnp);
+static void rcu_preempt_boost_note_exit(struct rcu_node *rnp,
+					struct task_struct *t);
 static bool rcu_is_callbacks_kthread(void);
 static void rcu_cpu_kthread_setup(unsigned int cpu);
 #ifdef CONFIG_RCU_BOOST
@@ -298,6 +298,9 @@ static void rcu_preempt_note_context_switch(void)
 		smp_mb__after_unlock_lock();
 		t->rcu_read_unlock_special.b.blocked = true;
 		t->rcu_blocked_node = rnp;
+#ifdef CONFIG_RCU_BOOST
+		t->rcu_blocked_jiffies = jiffies;
+#endif /* #ifdef CONFIG_RCU_BOOST */
 
 		/*
 		 * Verify the CPU's sanity, trace the preemption, and
@@ -475,6 +478,7 @@ void rcu_read_unlock_special(struct task_struct *t)
 			/* Snapshot ->boost_mtx ownership w/rnp->lock held. */
 			drop_boost_mutex = rt_mutex_owner(&rnp->boost_mtx) == t;
 		}
+		rcu_preempt_boost_note_exit(rnp, t);
 
 		/*
 		 * If this was the last task on the current list, and if
@@ -958,6 +962,21 @@ static void rcu_initiate_boost_trace(struct rcu_node *rnp)
 
 #endif /* #else #ifdef CONFIG_RCU_TRACE */
 
+/*
+ * Account how long the exiting reader @t was preempted within its RCU
+ * read-side critical section.  The caller must hold rnp->lock.
+ */
+static void rcu_preempt_boost_note_exit(struct rcu_node *rnp,
+					struct task_struct *t)
+{
+	unsigned long delta = jiffies - t->rcu_blocked_jiffies;
+
+	rnp->n_blkd_exits++;
+	rnp->blkd_jiffies += delta;
+	if (delta > rnp->blkd_jiffies_max)
+		rnp->blkd_jiffies_max = delta;
+}
+
 /*
  * Carry out RCU priority boosting on the task indicated by ->exp_tasks
  * or ->boost_tasks, advancing the pointer to the next task in the
@@ -969,6 +988,7 @@ static void rcu_initiate_boost_trace(struct rcu_node *rnp)
 static int rcu_boost(struct rcu_node *rnp)
 {
 	unsigned long flags;
+	unsigned long start;
 	struct task_struct *t;
 	struct list_head *tb;
 
@@ -1023,9 +1043,16 @@ static int rcu_boost(struct rcu_node *rnp)
 	rt_mutex_init_proxy_locked(&rnp->boost_mtx, t);
 	raw_spin_unlock_irqrestore(&rnp->lock, flags);
 	/* Lock only for side effect: boosts task t's priority. */
+	start = jiffies;
 	rt_mutex_lock(&rnp->boost_mtx);
 	rt_mutex_unlock(&rnp->boost_mtx);  /* Then keep lockdep happy. */
 
+	/* Only the boost kthread updates these, no need for rnp->lock. */
+	start = jiffies - start;
+	rnp->boost_jiffies += start;
+	if (start > rnp->boost_jiffies_max)
+		rnp->boost_jiffies_max = start;
+
 	return READ_ONCE(rnp->exp_tasks) != NULL ||
 	       READ_ONCE(rnp->boost_tasks) != NULL;
 }
@@ -1112,12 +1139,62 @@ static bool rcu_is_callbacks_kthread(void)
 
 #define RCU_BOOST_DELAY_JIFFIES DIV_ROUND_UP(CONFIG_RCU_BOOST_DELAY * HZ, 1000)
 
+/*
+ * Callback backlog of a leaf rcu_node's CPUs above which the boost delay
+ * is halved, and above which boosting starts right away.  Readers holding
+ * up a grace period then also hold up the memory of all these callbacks.
+ */
+static long boost_qlen_lo = 1000;
+module_param(boost_qlen_lo, long, 0644);
+static long boost_qlen_hi = 10000;
+module_param(boost_qlen_hi, long, 0644);
+
+static unsigned long rcu_boost_delay(struct rcu_state *rsp,
+				     struct rcu_node *rnp)
+{
+	long qlen = 0;
+	int cpu;
+
+	if (rsp != rcu_state_p || rnp->level != rcu_num_lvls - 1)
+		return RCU_BOOST_DELAY_JIFFIES;
+
+	for (cpu = rnp->grplo; cpu <= rnp->grphi; cpu++)
+		if (cpu_possible(cpu))
+			qlen += READ_ONCE(per_cpu_ptr(rsp->rda, cpu)->qlen);
+
+	if (qlen >= READ_ONCE(boost_qlen_hi)) {
+		rnp->n_boost_early++;
+		return 0;
+	}
+	if (qlen >= READ_ONCE(boost_qlen_lo)) {
+		rnp->n_boost_early++;
+		return RCU_BOOST_DELAY_JIFFIES / 2;
+	}
+	return RCU_BOOST_DELAY_JIFFIES;
+}
+
 /*
  * Do priority-boost accounting for the start of a new grace period.
  */
-static void rcu_preempt_boost_start_gp(struct rcu_node *rnp)
+static void rcu_preempt_boost_start_gp(struct rcu_state *rsp,
+				       struct rcu_node *rnp)
+{
+	rnp->gp_start = jiffies;
+	rnp->boost_time = jiffies + rcu_boost_delay(rsp, rnp);
+}
+
+/*
+ * Account the grace-period length as seen by this rcu_node structure,
+ * which just reported its quiescent state up.  Caller holds rnp->lock.
+ */
+static void rcu_preempt_boost_end_gp(struct rcu_node *rnp)
 {
-	rnp->boost_time = jiffies + RCU_BOOST_DELAY_JIFFIES;
+	unsigned long delta = jiffies - rnp->gp_start;
+
+	rnp->n_gps++;
+	rnp->gp_jiffies += delta;
+	if (delta > rnp->gp_jiffies_max)
+		rnp->gp_jiffies_max = delta;
 }
 
 /*
@@ -1218,7 +1295,17 @@ static bool rcu_is_callbacks_kthread(void)
 	return false;
 }
 
-static void rcu_preempt_boost_start_gp(struct rcu_node *rnp)
+static void rcu_preempt_boost_start_gp(struct rcu_state *rsp,
+				       struct rcu_node *rnp)
+{
+}
+
+static void rcu_preempt_boost_end_gp(struct rcu_node *rnp)
+{
+}
+
+static void rcu_preempt_boost_note_exit(struct rcu_node *rnp,
+					struct task_struct *t)
 {
 }
 
@@ -2219,6 +2306,10 @@ void __init rcu_init_nohz(void)
 	if (tick_nohz_full_running && cpumask_weight(tick_nohz_full_mask))
 		need_rcu_nocb_mask = true;
 #endif /* #if defined(CONFIG_NO_HZ_FULL) */
+#ifdef CONFIG_SMP
+	if (cpu_hard_isolation)
+		need_rcu_nocb_mask = true;
+#endif /* #ifdef CONFIG_SMP */
 
 	if (!have_rcu_nocb_mask && need_rcu_nocb_mask) {
 		if (!zalloc_cpumask_var(&rcu_nocb_mask, GFP_KERNEL)) {
@@ -2242,6 +2333,10 @@ void __init rcu_init_nohz(void)
 	if (tick_nohz_full_running)
 		cpumask_or(rcu_nocb_mask, rcu_nocb_mask, tick_nohz_full_mask);
 #endif /* #if defined(CONFIG_NO_HZ_FULL) */
+#ifdef CONFIG_SMP
+	if (cpu_hard_isolation)
+		cpumask_or(rcu_nocb_mask, rcu_nocb_mask, cpu_hard_isolated_map);
+#endif /* #ifdef CONFIG_SMP */
 
 	if (!cpumask_subset(rcu_nocb_mask, cpu_possible_mask)) {
 		pr_info("\tNote: kernel parameter 'rcu_nocbs=' contains nonexistent CPUs.\n");
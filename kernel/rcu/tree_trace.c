@@ -233,6 +233,16 @@ static void print_one_rcu_node_boost(struct seq_file *m, struct rcu_node *rnp)
 		   rnp->n_balk_notblocked,
 		   rnp->n_balk_notyet,
 		   rnp->n_balk_nos);
+	seq_printf(m, "    boost: early=%lu ms=%u max=%u blkd: n=%lu ms=%u max=%u gp: n=%lu ms=%u max=%u\n",
+		   rnp->n_boost_early,
+		   jiffies_to_msecs(rnp->boost_jiffies),
+		   jiffies_to_msecs(rnp->boost_jiffies_max),
+		   rnp->n_blkd_exits,
+		   jiffies_to_msecs(rnp->blkd_jiffies),
+		   jiffies_to_msecs(rnp->blkd_jiffies_max),
+		   rnp->n_gps,
+		   jiffies_to_msecs(rnp->gp_jiffies),
+		   jiffies_to_msecs(rnp->gp_jiffies_max));
 }
 
 static int show_rcu_node_boost(struct seq_file *m, void *unused)
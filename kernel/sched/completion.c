@@ -31,8 +31,10 @@ void complete(struct completion *x)
 	unsigned long flags;
 
 	raw_spin_lock_irqsave(&x->wait.lock, flags);
+	swait_hold_start(&x->wait);
 	x->done++;
 	swake_up_locked(&x->wait);
+	swait_hold_end(&x->wait);
 	raw_spin_unlock_irqrestore(&x->wait.lock, flags);
 }
 EXPORT_SYMBOL(complete);
@@ -42,6 +44,7 @@ EXPORT_SYMBOL(complete);
  * @x:  holds the state of this particular completion
  *
  * This will wake up all threads waiting on this particular completion event.
+ * The wait lock is dropped and retaken between two wakeups.
  *
  * It may be assumed that this function implies a write memory barrier before
  * changing the task state if and only if any tasks are woken up.
@@ -51,8 +54,10 @@ void complete_all(struct completion *x)
 	unsigned long flags;
 
 	raw_spin_lock_irqsave(&x->wait.lock, flags);
+	swait_hold_start(&x->wait);
 	x->done += UINT_MAX/2;
-	swake_up_all_locked(&x->wait);
+	swake_up_all_locked(&x->wait, &flags);
+	swait_hold_end(&x->wait);
 	raw_spin_unlock_irqrestore(&x->wait.lock, flags);
 }
 EXPORT_SYMBOL(complete_all);
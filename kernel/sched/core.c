@@ -604,12 +604,24 @@ void resched_curr(struct rq *rq)
 }
 
 #ifdef CONFIG_PREEMPT_LAZY
+/*
+ * Policies of the current task for which a fair class wakeup preemption
+ * is only lazy. Clearing a bit makes tasks of that policy preemptible
+ * right away again, e.g. SCHED_NORMAL for latency sensitive setups which
+ * still want SCHED_BATCH throughput.
+ */
+static unsigned int sched_preempt_lazy_policies __read_mostly =
+	BIT(SCHED_NORMAL) | BIT(SCHED_BATCH) | BIT(SCHED_IDLE);
+core_param(sched_preempt_lazy_policies, sched_preempt_lazy_policies, uint,
+	   0644);
+
 void resched_curr_lazy(struct rq *rq)
 {
 	struct task_struct *curr = rq->curr;
 	int cpu;
 
-	if (!sched_feat(PREEMPT_LAZY)) {
+	if (!sched_feat(PREEMPT_LAZY) ||
+	    !(READ_ONCE(sched_preempt_lazy_policies) & BIT(curr->policy))) {
 		resched_curr(rq);
 		return;
 	}
@@ -670,7 +682,7 @@ int get_nohz_timer_target(void)
 	rcu_read_lock();
 	for_each_domain(cpu, sd) {
 		for_each_cpu(i, sched_domain_span(sd)) {
-			if (!idle_cpu(i) && is_housekeeping_cpu(cpu)) {
+			if (!idle_cpu(i) && is_housekeeping_cpu(i)) {
 				cpu = i;
 				goto unlock;
 			}
@@ -4041,7 +4053,8 @@ recheck:
 			return -EINVAL;
 	}
 
-	if (attr->sched_flags & ~(SCHED_FLAG_RESET_ON_FORK))
+	if (attr->sched_flags &
+	    ~(SCHED_FLAG_RESET_ON_FORK | SCHED_FLAG_RECLAIM))
 		return -EINVAL;
 
 	/*
@@ -6325,6 +6338,33 @@ static int __init isolated_cpu_setup(char *str)
 
 __setup("isolcpus=", isolated_cpu_setup);
 
+bool cpu_hard_isolation __read_mostly;
+cpumask_var_t cpu_hard_isolated_map;
+cpumask_var_t cpu_housekeeping_map;
+
+/* Setup the mask of cpus isolated from housekeeping work as well */
+static int __init hard_isolated_cpu_setup(char *str)
+{
+	alloc_bootmem_cpumask_var(&cpu_hard_isolated_map);
+	if (cpulist_parse(str, cpu_hard_isolated_map) < 0) {
+		pr_warn("hard_isolcpus: Invalid cpu list '%s'\n", str);
+		cpumask_clear(cpu_hard_isolated_map);
+		return 1;
+	}
+
+	/* Somebody has to keep time */
+	if (cpumask_test_cpu(smp_processor_id(), cpu_hard_isolated_map)) {
+		pr_warn("hard_isolcpus: Keeping boot cpu %d for housekeeping\n",
+			smp_processor_id());
+		cpumask_clear_cpu(smp_processor_id(), cpu_hard_isolated_map);
+	}
+
+	cpu_hard_isolation = !cpumask_empty(cpu_hard_isolated_map);
+	return 1;
+}
+
+__setup("hard_isolcpus=", hard_isolated_cpu_setup);
+
 struct s_data {
 	struct sched_domain ** __percpu sd;
 	struct root_domain	*rd;
@@ -7268,7 +7308,11 @@ static int build_sched_domains(const struct cpumask *cpu_map,
 	/* Attach the domains */
 	rcu_read_lock();
 	for_each_cpu(i, cpu_map) {
+		unsigned long capacity = cpu_rq(i)->cpu_capacity_orig;
+
 		sd = *per_cpu_ptr(d.sd, i);
+		if (capacity > READ_ONCE(d.rd->max_cpu_capacity))
+			WRITE_ONCE(d.rd->max_cpu_capacity, capacity);
 		cpu_attach_domain(sd, d.rd, i);
 	}
 	rcu_read_unlock();
@@ -7773,6 +7817,15 @@ void __init sched_init(void)
 	/* May be allocated at isolcpus cmdline parse time */
 	if (cpu_isolated_map == NULL)
 		zalloc_cpumask_var(&cpu_isolated_map, GFP_NOWAIT);
+	if (cpu_hard_isolation) {
+		cpumask_or(cpu_isolated_map, cpu_isolated_map,
+			   cpu_hard_isolated_map);
+		alloc_cpumask_var(&cpu_housekeeping_map, GFP_NOWAIT);
+		cpumask_andnot(cpu_housekeeping_map, cpu_possible_mask,
+			       cpu_hard_isolated_map);
+		pr_info("Hard isolated CPUs: %*pbl\n",
+			cpumask_pr_args(cpu_hard_isolated_map));
+	}
 	idle_thread_set_boot_cpu();
 	set_cpu_rq_start_time();
 #endif
@@ -7,6 +7,7 @@
 #include <linux/rcupdate.h>
 #include <linux/kernel_stat.h>
 #include <linux/err.h>
+#include <linux/u64_stats_sync.h>
 
 #include "sched.h"
 
@@ -25,11 +26,21 @@ enum cpuacct_stat_index {
 	CPUACCT_STAT_NSTATS,
 };
 
+/*
+ * Per-cpu usage counter. It is only updated by the cpu it belongs to,
+ * under that cpu's rq->lock, so readers only need @syncp to get a
+ * consistent 64-bit value on 32-bit platforms.
+ */
+struct cpuacct_usage {
+	u64 usage;
+	struct u64_stats_sync syncp;
+};
+
 /* track cpu usage of a group of tasks and its child groups */
 struct cpuacct {
 	struct cgroup_subsys_state css;
-	/* cpuusage holds pointer to a u64-type object on every cpu */
-	u64 __percpu *cpuusage;
+	/* cpuusage holds pointer to a cpuacct_usage object on every cpu */
+	struct cpuacct_usage __percpu *cpuusage;
 	struct kernel_cpustat __percpu *cpustat;
 };
 
@@ -49,28 +60,39 @@ static inline struct cpuacct *parent_ca(struct cpuacct *ca)
 	return css_ca(ca->css.parent);
 }
 
-static DEFINE_PER_CPU(u64, root_cpuacct_cpuusage);
+static DEFINE_PER_CPU(struct cpuacct_usage, root_cpuacct_cpuusage);
 static struct cpuacct root_cpuacct = {
 	.cpustat	= &kernel_cpustat,
 	.cpuusage	= &root_cpuacct_cpuusage,
 };
 
+static void cpuacct_init_usage(struct cpuacct *ca)
+{
+	int i;
+
+	for_each_possible_cpu(i)
+		u64_stats_init(&per_cpu_ptr(ca->cpuusage, i)->syncp);
+}
+
 /* create a new cpu accounting group */
 static struct cgroup_subsys_state *
 cpuacct_css_alloc(struct cgroup_subsys_state *parent_css)
 {
 	struct cpuacct *ca;
 
-	if (!parent_css)
+	if (!parent_css) {
+		cpuacct_init_usage(&root_cpuacct);
 		return &root_cpuacct.css;
+	}
 
 	ca = kzalloc(sizeof(*ca), GFP_KERNEL);
 	if (!ca)
 		goto out;
 
-	ca->cpuusage = alloc_percpu(u64);
+	ca->cpuusage = alloc_percpu(struct cpuacct_usage);
 	if (!ca->cpuusage)
 		goto out_free_ca;
+	cpuacct_init_usage(ca);
 
 	ca->cpustat = alloc_percpu(struct kernel_cpustat);
 	if (!ca->cpustat)
@@ -98,36 +120,38 @@ static void cpuacct_css_free(struct cgroup_subsys_state *css)
 
 static u64 cpuacct_cpuusage_read(struct cpuacct *ca, int cpu)
 {
-	u64 *cpuusage = per_cpu_ptr(ca->cpuusage, cpu);
+	struct cpuacct_usage *cpuusage = per_cpu_ptr(ca->cpuusage, cpu);
+	unsigned int start;
 	u64 data;
 
-#ifndef CONFIG_64BIT
 	/*
-	 * Take rq->lock to make 64-bit read safe on 32-bit platforms.
+	 * The charging side runs from the tick, so use the _irq variants
+	 * to stay safe on 32-bit UP as well.
 	 */
-	raw_spin_lock_irq(&cpu_rq(cpu)->lock);
-	data = *cpuusage;
-	raw_spin_unlock_irq(&cpu_rq(cpu)->lock);
-#else
-	data = *cpuusage;
-#endif
+	do {
+		start = u64_stats_fetch_begin_irq(&cpuusage->syncp);
+		data = cpuusage->usage;
+	} while (u64_stats_fetch_retry_irq(&cpuusage->syncp, start));
 
 	return data;
 }
 
 static void cpuacct_cpuusage_write(struct cpuacct *ca, int cpu, u64 val)
 {
-	u64 *cpuusage = per_cpu_ptr(ca->cpuusage, cpu);
+	struct cpuacct_usage *cpuusage = per_cpu_ptr(ca->cpuusage, cpu);
 
 #ifndef CONFIG_64BIT
 	/*
-	 * Take rq->lock to make 64-bit write safe on 32-bit platforms.
+	 * Take rq->lock to serialize against cpuacct_charge() on that cpu,
+	 * which is the only other writer.
 	 */
 	raw_spin_lock_irq(&cpu_rq(cpu)->lock);
-	*cpuusage = val;
+	u64_stats_update_begin(&cpuusage->syncp);
+	cpuusage->usage = val;
+	u64_stats_update_end(&cpuusage->syncp);
 	raw_spin_unlock_irq(&cpu_rq(cpu)->lock);
 #else
-	*cpuusage = val;
+	cpuusage->usage = val;
 #endif
 }
 
@@ -244,8 +268,11 @@ void cpuacct_charge(struct task_struct *tsk, u64 cputime)
 	ca = task_ca(tsk);
 
 	while (true) {
-		u64 *cpuusage = per_cpu_ptr(ca->cpuusage, cpu);
-		*cpuusage += cputime;
+		struct cpuacct_usage *cpuusage = per_cpu_ptr(ca->cpuusage, cpu);
+
+		u64_stats_update_begin(&cpuusage->syncp);
+		cpuusage->usage += cputime;
+		u64_stats_update_end(&cpuusage->syncp);
 
 		ca = parent_ca(ca);
 		if (!ca)
@@ -50,6 +50,62 @@ static int convert_prio(int prio)
 	return cpupri;
 }
 
+/*
+ * Does @vec have a cpu @p may run on? Fills @lowest_mask with those cpus
+ * if it is not NULL.
+ */
+static int cpupri_vec_find(struct cpupri_vec *vec, struct task_struct *p,
+			   struct cpumask *lowest_mask)
+{
+	int skip = 0;
+
+	if (!atomic_read(&(vec)->count))
+		skip = 1;
+	/*
+	 * When looking at the vector, we need to read the counter,
+	 * do a memory barrier, then read the mask.
+	 *
+	 * Note: This is still all racey, but we can deal with it.
+	 *  Ideally, we only want to look at masks that are set.
+	 *
+	 *  If a mask is not set, then the only thing wrong is that we
+	 *  did a little more work than necessary.
+	 *
+	 *  If we read a zero count but the mask is set, because of the
+	 *  memory barriers, that can only happen when the highest prio
+	 *  task for a run queue has left the run queue, in which case,
+	 *  it will be followed by a pull. If the task we are processing
+	 *  fails to find a proper place to go, that pull request will
+	 *  pull this task if the run queue is running at a lower
+	 *  priority.
+	 */
+	smp_rmb();
+
+	/* Need to do the rmb for every iteration */
+	if (skip)
+		return 0;
+
+	if (cpumask_any_and(tsk_cpus_allowed(p), vec->mask) >= nr_cpu_ids)
+		return 0;
+
+	if (lowest_mask) {
+		cpumask_and(lowest_mask, tsk_cpus_allowed(p), vec->mask);
+
+		/*
+		 * We have to ensure that we have at least one bit
+		 * still set in the array, since the map could have
+		 * been concurrently emptied between the first and
+		 * second reads of vec->mask.  If we hit this
+		 * condition, simply act as though we never hit this
+		 * priority level and continue on.
+		 */
+		if (cpumask_any(lowest_mask) >= nr_cpu_ids)
+			return 0;
+	}
+
+	return 1;
+}
+
 /**
  * cpupri_find - find the best (lowest-pri) CPU in the system
  * @cp: The cpupri context
@@ -74,57 +130,61 @@ int cpupri_find(struct cpupri *cp, struct task_struct *p,
 	BUG_ON(task_pri >= CPUPRI_NR_PRIORITIES);
 
 	for (idx = 0; idx < task_pri; idx++) {
-		struct cpupri_vec *vec  = &cp->pri_to_cpu[idx];
-		int skip = 0;
+		if (cpupri_vec_find(&cp->pri_to_cpu[idx], p, lowest_mask))
+			return 1;
+	}
 
-		if (!atomic_read(&(vec)->count))
-			skip = 1;
-		/*
-		 * When looking at the vector, we need to read the counter,
-		 * do a memory barrier, then read the mask.
-		 *
-		 * Note: This is still all racey, but we can deal with it.
-		 *  Ideally, we only want to look at masks that are set.
-		 *
-		 *  If a mask is not set, then the only thing wrong is that we
-		 *  did a little more work than necessary.
-		 *
-		 *  If we read a zero count but the mask is set, because of the
-		 *  memory barriers, that can only happen when the highest prio
-		 *  task for a run queue has left the run queue, in which case,
-		 *  it will be followed by a pull. If the task we are processing
-		 *  fails to find a proper place to go, that pull request will
-		 *  pull this task if the run queue is running at a lower
-		 *  priority.
-		 */
-		smp_rmb();
+	return 0;
+}
 
-		/* Need to do the rmb for every iteration */
-		if (skip)
-			continue;
+/**
+ * cpupri_find_cluster - find the best CPU, preferring a cluster
+ * @cp: The cpupri context
+ * @p: The task
+ * @lowest_mask: A mask to fill in with selected CPUs
+ * @cluster: The CPUs sharing a cache with the CPU of @p
+ * @spill: Priority levels to accept in @cluster before leaving it
+ *
+ * Like cpupri_find(), but if the lowest priority level has no CPU in
+ * @cluster, the next @spill levels are searched for one first. When one
+ * is found, @lowest_mask only holds CPUs of @cluster. The same racy
+ * caveats as for cpupri_find() apply.
+ *
+ * Return: (int)bool - CPUs were found
+ */
+int cpupri_find_cluster(struct cpupri *cp, struct task_struct *p,
+			struct cpumask *lowest_mask,
+			const struct cpumask *cluster, unsigned int spill)
+{
+	int task_pri = convert_prio(p->prio);
+	int idx, first = -1;
+
+	BUG_ON(task_pri >= CPUPRI_NR_PRIORITIES);
 
-		if (cpumask_any_and(tsk_cpus_allowed(p), vec->mask) >= nr_cpu_ids)
+	for (idx = 0; idx < task_pri; idx++) {
+		if (!cpupri_vec_find(&cp->pri_to_cpu[idx], p, lowest_mask))
 			continue;
 
-		if (lowest_mask) {
-			cpumask_and(lowest_mask, tsk_cpus_allowed(p), vec->mask);
-
-			/*
-			 * We have to ensure that we have at least one bit
-			 * still set in the array, since the map could have
-			 * been concurrently emptied between the first and
-			 * second reads of vec->mask.  If we hit this
-			 * condition, simply act as though we never hit this
-			 * priority level and continue on.
-			 */
-			if (cpumask_any(lowest_mask) >= nr_cpu_ids)
-				continue;
+		if (cpumask_intersects(lowest_mask, cluster)) {
+			cpumask_and(lowest_mask, lowest_mask, cluster);
+			return 1;
 		}
 
-		return 1;
+		if (first < 0)
+			first = idx;
+		if (idx - first >= spill)
+			break;
 	}
 
-	return 0;
+	if (first < 0)
+		return 0;
+
+	/* Spill over to the lowest level after all */
+	if (idx != first &&
+	    !cpupri_vec_find(&cp->pri_to_cpu[first], p, lowest_mask))
+		return cpupri_find(cp, p, lowest_mask);
+
+	return 1;
 }
 
 /**
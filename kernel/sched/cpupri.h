@@ -23,6 +23,9 @@ struct cpupri {
 #ifdef CONFIG_SMP
 int  cpupri_find(struct cpupri *cp,
 		 struct task_struct *p, struct cpumask *lowest_mask);
+int  cpupri_find_cluster(struct cpupri *cp, struct task_struct *p,
+			 struct cpumask *lowest_mask,
+			 const struct cpumask *cluster, unsigned int spill);
 void cpupri_set(struct cpupri *cp, int cpu, int pri);
 int cpupri_init(struct cpupri *cp);
 void cpupri_cleanup(struct cpupri *cp);
@@ -72,6 +72,7 @@ void init_dl_bw(struct dl_bw *dl_b)
 void init_dl_rq(struct dl_rq *dl_rq)
 {
 	dl_rq->rb_root = RB_ROOT;
+	dl_rq->running_bw = 0;
 
 #ifdef CONFIG_SMP
 	/* zero means no -deadline tasks */
@@ -712,11 +713,35 @@ extern bool sched_rt_bandwidth_account(struct rt_rq *rt_rq);
  * Update the current task's runtime statistics (provided it is still
  * a -deadline task and has not been removed from the dl_rq).
  */
+/*
+ * GRUB reclaiming: a SCHED_FLAG_RECLAIM task is only charged for its
+ * runtime in proportion to the bandwidth reserved by the -deadline tasks
+ * queued on the CPU, so it can keep running in the bandwidth they leave
+ * unused. Scaling by running_bw / u_max rather than by running_bw alone
+ * keeps what is reclaimed within the -rt/-deadline limit set by
+ * sched_rt_runtime_us / sched_rt_period_us, and leaves the rest of the
+ * CPU to the other classes.
+ *
+ * running_bw drops as soon as a task blocks or is throttled, not at its
+ * 0-lag time, so the bandwidth of a task that wakes up again early may
+ * have been reclaimed already and it can miss its deadline. Reclaiming
+ * tasks should not share CPUs with tasks that need hard guarantees.
+ */
+static u64 grub_reclaim(u64 delta, struct rq *rq)
+{
+	u64 u_max = dl_bw_of(cpu_of(rq))->bw;
+
+	if (u_max == (u64)-1)
+		u_max = 1ULL << 20;
+
+	return div64_u64(delta * rq->dl.running_bw, u_max);
+}
+
 static void update_curr_dl(struct rq *rq)
 {
 	struct task_struct *curr = rq->curr;
 	struct sched_dl_entity *dl_se = &curr->dl;
-	u64 delta_exec;
+	u64 delta_exec, charged;
 
 	if (!dl_task(curr) || !on_dl_rq(dl_se))
 		return;
@@ -744,7 +769,14 @@ static void update_curr_dl(struct rq *rq)
 
 	sched_rt_avg_update(rq, delta_exec);
 
-	dl_se->runtime -= dl_se->dl_yielded ? 0 : delta_exec;
+	/* Kick cpufreq with the DL pressure just accounted */
+	cpufreq_update_this_cpu(rq);
+
+	charged = delta_exec;
+	if (unlikely(dl_se->flags & SCHED_FLAG_RECLAIM))
+		charged = grub_reclaim(delta_exec, rq);
+
+	dl_se->runtime -= dl_se->dl_yielded ? 0 : charged;
 	if (dl_runtime_exceeded(dl_se)) {
 		dl_se->dl_throttled = 1;
 		__dequeue_task_dl(rq, curr, 0);
@@ -860,10 +892,14 @@ void inc_dl_tasks(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
 
 	WARN_ON(!dl_prio(prio));
 	dl_rq->dl_nr_running++;
+	dl_rq->running_bw += dl_se->dl_bw;
 	add_nr_running(rq_of_dl_rq(dl_rq), 1);
 
 	inc_dl_deadline(dl_rq, deadline);
 	inc_dl_migration(dl_se, dl_rq);
+
+	/* Raise the frequency for the new bandwidth before it runs */
+	cpufreq_update_this_cpu(rq_of_dl_rq(dl_rq));
 }
 
 static inline
@@ -874,6 +910,8 @@ void dec_dl_tasks(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
 	WARN_ON(!dl_prio(prio));
 	WARN_ON(!dl_rq->dl_nr_running);
 	dl_rq->dl_nr_running--;
+	WARN_ON(dl_rq->running_bw < dl_se->dl_bw);
+	dl_rq->running_bw -= dl_se->dl_bw;
 	sub_nr_running(rq_of_dl_rq(dl_rq), 1);
 
 	dec_dl_deadline(dl_rq, dl_se->deadline);
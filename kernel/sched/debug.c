@@ -263,6 +263,8 @@ void print_dl_rq(struct seq_file *m, int cpu, struct dl_rq *dl_rq)
 {
 	SEQ_printf(m, "\ndl_rq[%d]:\n", cpu);
 	SEQ_printf(m, "  .%-30s: %ld\n", "dl_nr_running", dl_rq->dl_nr_running);
+	SEQ_printf(m, "  .%-30s: %llu\n", "running_bw",
+			(unsigned long long)dl_rq->running_bw);
 }
 
 extern __read_mostly int sched_clock_running;
@@ -600,6 +602,7 @@ void proc_sched_show_task(struct task_struct *p, struct seq_file *m)
 	P(se.statistics.nr_wakeups_affine_attempts);
 	P(se.statistics.nr_wakeups_passive);
 	P(se.statistics.nr_wakeups_idle);
+	P(se.statistics.nr_wakeups_cap);
 
 	{
 		u64 avg_atom, avg_per_cpu;
@@ -7,6 +7,7 @@
 
 #include <linux/slab.h>
 #include <linux/irq_work.h>
+#include <linux/moduleparam.h>
 
 int sched_rr_timeslice = RR_TIMESLICE;
 
@@ -962,6 +963,9 @@ static void update_curr_rt(struct rq *rq)
 
 	sched_rt_avg_update(rq, delta_exec);
 
+	/* Kick cpufreq with the RT pressure just accounted */
+	cpufreq_update_this_cpu(rq);
+
 	if (!rt_bandwidth_enabled())
 		return;
 
@@ -1558,6 +1562,22 @@ static struct task_struct *pick_highest_pushable_task(struct rq *rq, int cpu)
 
 static DEFINE_PER_CPU(cpumask_var_t, local_cpu_mask);
 
+/*
+ * Number of priority levels above the lowest one on which a CPU of the
+ * same cluster is preferred over a lower priority CPU of another
+ * cluster. 0 only prefers the own cluster among equally low CPUs.
+ */
+static unsigned int sched_rt_cluster_spill __read_mostly;
+core_param(sched_rt_cluster_spill, sched_rt_cluster_spill, uint, 0644);
+
+static inline void rt_account_migration(struct rq *rq, int src_cpu)
+{
+	if (cpumask_test_cpu(rq->cpu, topology_core_cpumask(src_cpu)))
+		schedstat_inc(rq, rt_cluster_local);
+	else
+		schedstat_inc(rq, rt_cluster_migrations);
+}
+
 static int find_lowest_rq(struct task_struct *task)
 {
 	struct sched_domain *sd;
@@ -1572,7 +1592,9 @@ static int find_lowest_rq(struct task_struct *task)
 	if (tsk_nr_cpus_allowed(task) == 1)
 		return -1; /* No other targets possible */
 
-	if (!cpupri_find(&task_rq(task)->rd->cpupri, task, lowest_mask))
+	if (!cpupri_find_cluster(&task_rq(task)->rd->cpupri, task, lowest_mask,
+				 topology_core_cpumask(cpu),
+				 READ_ONCE(sched_rt_cluster_spill)))
 		return -1; /* No targets found */
 
 	/*
@@ -1784,6 +1806,7 @@ retry:
 	deactivate_task(rq, next_task, 0);
 	set_task_cpu(next_task, lowest_rq->cpu);
 	activate_task(lowest_rq, next_task, 0);
+	rt_account_migration(lowest_rq, rq->cpu);
 	ret = 1;
 
 	resched_curr(lowest_rq);
@@ -2038,6 +2061,7 @@ static void pull_rt_task(struct rq *this_rq)
 			deactivate_task(src_rq, p, 0);
 			set_task_cpu(p, this_cpu);
 			activate_task(this_rq, p, 0);
+			rt_account_migration(this_rq, src_rq->cpu);
 			/*
 			 * We continue with the search, just in
 			 * case there's an even higher prio task
@@ -481,6 +481,14 @@ struct dl_rq {
 
 	unsigned long dl_nr_running;
 
+	/*
+	 * Sum of the bandwidths of the -deadline tasks currently queued
+	 * on this rq (same fixed point as dl_se->dl_bw). This is the
+	 * utilization the CPU must provide to meet every deadline, and
+	 * thus a lower bound for frequency selection.
+	 */
+	u64 running_bw;
+
 #ifdef CONFIG_SMP
 	/*
 	 * Deadline values of the currently executing and the
@@ -543,6 +551,9 @@ struct root_domain {
 	 */
 	cpumask_var_t rto_mask;
 	struct cpupri cpupri;
+
+	/* Maximum cpu capacity in the system, see wake_cap() */
+	unsigned long max_cpu_capacity;
 };
 
 extern struct root_domain def_root_domain;
@@ -678,6 +689,10 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int ttwu_count;
 	unsigned int ttwu_local;
+
+	/* RT push/pull stats, by cluster of the source cpu */
+	unsigned int rt_cluster_local;
+	unsigned int rt_cluster_migrations;
 #endif
 
 #ifdef CONFIG_SMP
@@ -1435,6 +1450,88 @@ static inline void sched_rt_avg_update(struct rq *rq, u64 rt_delta) { }
 static inline void sched_avg_update(struct rq *rq) { }
 #endif
 
+#ifdef CONFIG_CPU_FREQ
+DECLARE_PER_CPU(struct update_util_data *, cpufreq_update_util_data);
+
+/**
+ * cpufreq_update_util - Take a note about CPU utilization changes.
+ * @time: Current time.
+ * @util: Current utilization.
+ * @max: Utilization ceiling.
+ *
+ * This function is called by the scheduler on every invocation of
+ * update_load_avg() on the CPU whose utilization is being updated, and
+ * whenever RT or deadline tasks run there.
+ *
+ * It can only be called from RCU-sched read-side critical sections, i.e.
+ * with rq->lock held and interrupts disabled.
+ */
+static inline void cpufreq_update_util(u64 time, unsigned long util,
+				       unsigned long max)
+{
+	struct update_util_data *data;
+
+	data = rcu_dereference_sched(*this_cpu_ptr(&cpufreq_update_util_data));
+	if (data)
+		data->func(data, time, util, max);
+}
+#else
+static inline void cpufreq_update_util(u64 time, unsigned long util,
+				       unsigned long max) { }
+#endif
+
+#if defined(CONFIG_CPU_FREQ) && defined(CONFIG_SMP)
+/*
+ * Share of the CPU capacity recently taken by RT and deadline tasks and
+ * by interrupts, i.e. not available to CFS. See scale_rt_capacity().
+ */
+static inline unsigned long sched_rt_pressure(struct rq *rq,
+					      unsigned long max)
+{
+	s64 delta = rq_clock(rq) - rq->age_stamp;
+	u64 used;
+
+	used = div64_u64(rq->rt_avg, sched_avg_period() + max_t(s64, delta, 0));
+	if (used > SCHED_CAPACITY_SCALE)
+		used = SCHED_CAPACITY_SCALE;
+
+	return (used * max) >> SCHED_CAPACITY_SHIFT;
+}
+
+/*
+ * Capacity the -deadline tasks queued on @rq have reserved, from their
+ * bandwidth (running_bw, in to_ratio() fixed point) rather than from how
+ * much they ran recently.
+ */
+static inline unsigned long sched_dl_util(struct rq *rq, unsigned long max)
+{
+	return (rq->dl.running_bw * max) >> 20;
+}
+
+/*
+ * Report the utilization of the local @rq: CFS utilization plus the
+ * capacity taken by RT, DL and interrupts. DL time is part of rt_avg
+ * too, so the larger of the two is used: rt_avg covers what ran, the
+ * DL bandwidth what must be available before the deadlines. Remote
+ * runqueue updates are skipped, the next local update (at the latest
+ * the tick) picks them up.
+ */
+static inline void cpufreq_update_this_cpu(struct rq *rq)
+{
+	unsigned long max = rq->cpu_capacity_orig;
+	unsigned long util;
+
+	if (cpu_of(rq) != smp_processor_id())
+		return;
+
+	util = rq->cfs.avg.util_avg + max(sched_rt_pressure(rq, max),
+					  sched_dl_util(rq, max));
+	cpufreq_update_util(rq_clock(rq), min(util, max), max);
+}
+#else
+static inline void cpufreq_update_this_cpu(struct rq *rq) { }
+#endif
+
 /*
  * __task_rq_lock - lock the rq @p resides on.
  */
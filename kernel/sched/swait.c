@@ -1,6 +1,47 @@
 #include <linux/sched.h>
 #include <linux/swait.h>
 #include <linux/suspend.h>
+#include <linux/debugfs.h>
+
+#ifdef CONFIG_SCHED_DEBUG
+/*
+ * Longest q->lock hold seen by the swait and completion paths, in
+ * nanoseconds. Exposed as swait_max_hold_ns in debugfs, write 0 to reset.
+ * Holds are timed from right after the lock is taken until right before
+ * it is dropped.
+ */
+static u32 swait_max_hold_ns;
+
+void swait_hold_start(struct swait_queue_head *q)
+{
+	q->hold_start = local_clock();
+}
+EXPORT_SYMBOL(swait_hold_start);
+
+void swait_hold_end(struct swait_queue_head *q)
+{
+	u64 delta = local_clock() - q->hold_start;
+	u32 held = min_t(u64, delta, U32_MAX);
+	u32 old = READ_ONCE(swait_max_hold_ns);
+	u32 prev;
+
+	while (held > old) {
+		prev = cmpxchg(&swait_max_hold_ns, old, held);
+		if (prev == old)
+			break;
+		old = prev;
+	}
+}
+EXPORT_SYMBOL(swait_hold_end);
+
+static int __init swait_debug_init(void)
+{
+	debugfs_create_u32("swait_max_hold_ns", 0644, NULL,
+			   &swait_max_hold_ns);
+	return 0;
+}
+late_initcall(swait_debug_init);
+#endif
 
 void __init_swait_queue_head(struct swait_queue_head *q, const char *name,
 			     struct lock_class_key *key)
@@ -30,18 +71,34 @@ void swake_up_locked(struct swait_queue_head *q)
 }
 EXPORT_SYMBOL(swake_up_locked);
 
-void swake_up_all_locked(struct swait_queue_head *q)
+/*
+ * Wake all waiters, one per hold of q->lock: the caller's lock is dropped
+ * and retaken between two wakeups, so complete_all() with many waiters
+ * does not keep the raw lock for all of them. The waiters are moved to a
+ * private list first; tasks that queue meanwhile are not woken. Called
+ * with q->lock taken by raw_spin_lock_irqsave(&q->lock, *flags).
+ */
+void swake_up_all_locked(struct swait_queue_head *q, unsigned long *flags)
 {
 	struct swait_queue *curr;
+	LIST_HEAD(tmp);
 	int wakes = 0;
 
-	while (!list_empty(&q->task_list)) {
+	list_splice_init(&q->task_list, &tmp);
+	while (!list_empty(&tmp)) {
+		curr = list_first_entry(&tmp, typeof(*curr), task_list);
 
-		curr = list_first_entry(&q->task_list, typeof(*curr),
-					task_list);
 		wake_up_process(curr->task);
 		list_del_init(&curr->task_list);
 		wakes++;
+
+		if (list_empty(&tmp))
+			break;
+
+		swait_hold_end(q);
+		raw_spin_unlock_irqrestore(&q->lock, *flags);
+		raw_spin_lock_irqsave(&q->lock, *flags);
+		swait_hold_start(q);
 	}
 	if (pm_in_action)
 		return;
@@ -57,7 +114,9 @@ void swake_up(struct swait_queue_head *q)
 		return;
 
 	raw_spin_lock_irqsave(&q->lock, flags);
+	swait_hold_start(q);
 	swake_up_locked(q);
+	swait_hold_end(q);
 	raw_spin_unlock_irqrestore(&q->lock, flags);
 }
 EXPORT_SYMBOL(swake_up);
@@ -75,6 +134,7 @@ void swake_up_all(struct swait_queue_head *q)
 		return;
 
 	raw_spin_lock_irq(&q->lock);
+	swait_hold_start(q);
 	list_splice_init(&q->task_list, &tmp);
 	while (!list_empty(&tmp)) {
 		curr = list_first_entry(&tmp, typeof(*curr), task_list);
@@ -85,9 +145,12 @@ void swake_up_all(struct swait_queue_head *q)
 		if (list_empty(&tmp))
 			break;
 
+		swait_hold_end(q);
 		raw_spin_unlock_irq(&q->lock);
 		raw_spin_lock_irq(&q->lock);
+		swait_hold_start(q);
 	}
+	swait_hold_end(q);
 	raw_spin_unlock_irq(&q->lock);
 }
 EXPORT_SYMBOL(swake_up_all);
@@ -104,8 +167,10 @@ void prepare_to_swait(struct swait_queue_head *q, struct swait_queue *wait, int
 	unsigned long flags;
 
 	raw_spin_lock_irqsave(&q->lock, flags);
+	swait_hold_start(q);
 	__prepare_to_swait(q, wait);
 	set_current_state(state);
+	swait_hold_end(q);
 	raw_spin_unlock_irqrestore(&q->lock, flags);
 }
 EXPORT_SYMBOL(prepare_to_swait);
@@ -136,7 +201,9 @@ void finish_swait(struct swait_queue_head *q, struct swait_queue *wait)
 
 	if (!list_empty_careful(&wait->task_list)) {
 		raw_spin_lock_irqsave(&q->lock, flags);
+		swait_hold_start(q);
 		list_del_init(&wait->task_list);
+		swait_hold_end(q);
 		raw_spin_unlock_irqrestore(&q->lock, flags);
 	}
 }
@@ -3,6 +3,11 @@
  *
  * Provides a framework for enqueuing callbacks from irq context
  * PREEMPT_RT_FULL safe. The callbacks are executed in kthread context.
+ *
+ * Every online CPU gets its own worker, fed by a lock-free list, so events
+ * raised on different CPUs neither contend on a lock nor wait behind each
+ * other. Like regular work items, an event is never run by two workers at
+ * once: requeueing it while it runs sends it to the worker running it.
  */
 
 #include <linux/swait.h>
@@ -11,39 +16,42 @@
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/export.h>
+#include <linux/cpu.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/tick.h>
 
 #define SWORK_EVENT_PENDING     (1 << 0)
 
 static DEFINE_MUTEX(worker_mutex);
-static struct sworker *glob_worker;
+static int worker_refs;
+
+/* CPUs with a worker, only changed under worker_mutex */
+static struct cpumask worker_cpus;
 
 struct sworker {
-	struct list_head events;
+	struct llist_head events;
 	struct swait_queue_head wq;
 
-	raw_spinlock_t lock;
-
 	struct task_struct *task;
-	int refs;
+	struct swork_event *current_event;
 };
 
+static DEFINE_PER_CPU(struct sworker *, sworkers);
+
 static bool swork_readable(struct sworker *worker)
 {
-	bool r;
-
 	if (kthread_should_stop())
 		return true;
 
-	raw_spin_lock_irq(&worker->lock);
-	r = !list_empty(&worker->events);
-	raw_spin_unlock_irq(&worker->lock);
-
-	return r;
+	return !llist_empty(&worker->events);
 }
 
 static int swork_kthread(void *arg)
 {
 	struct sworker *worker = arg;
+	struct llist_node *node, *next;
+	struct swork_event *sev;
 
 	for (;;) {
 		swait_event_interruptible(worker->wq,
@@ -51,43 +59,53 @@ static int swork_kthread(void *arg)
 		if (kthread_should_stop())
 			break;
 
-		raw_spin_lock_irq(&worker->lock);
-		while (!list_empty(&worker->events)) {
-			struct swork_event *sev;
+		/* the list is LIFO, process the events in queueing order */
+		node = llist_del_all(&worker->events);
+		node = llist_reverse_order(node);
 
-			sev = list_first_entry(&worker->events,
-					struct swork_event, item);
-			list_del(&sev->item);
-			raw_spin_unlock_irq(&worker->lock);
+		while (node) {
+			next = node->next;
+			sev = llist_entry(node, struct swork_event, node);
 
+			/*
+			 * Published before PENDING is cleared, so that whoever
+			 * requeues @sev next finds it running here. Both bitops
+			 * imply a full barrier.
+			 */
+			WRITE_ONCE(worker->current_event, sev);
 			WARN_ON_ONCE(!test_and_clear_bit(SWORK_EVENT_PENDING,
 							 &sev->flags));
 			sev->func(sev);
-			raw_spin_lock_irq(&worker->lock);
+
+			/* @sev may be gone, only the pointer is compared */
+			WRITE_ONCE(worker->current_event, NULL);
+
+			node = next;
 		}
-		raw_spin_unlock_irq(&worker->lock);
 	}
 	return 0;
 }
 
-static struct sworker *swork_create(void)
+static struct sworker *swork_create(unsigned int cpu)
 {
 	struct sworker *worker;
 
-	worker = kzalloc(sizeof(*worker), GFP_KERNEL);
+	worker = kzalloc_node(sizeof(*worker), GFP_KERNEL, cpu_to_node(cpu));
 	if (!worker)
 		return ERR_PTR(-ENOMEM);
 
-	INIT_LIST_HEAD(&worker->events);
-	raw_spin_lock_init(&worker->lock);
+	init_llist_head(&worker->events);
 	init_swait_queue_head(&worker->wq);
 
-	worker->task = kthread_run(swork_kthread, worker, "kswork");
+	worker->task = kthread_create_on_cpu(swork_kthread, worker, cpu,
+					     "kswork/%u");
 	if (IS_ERR(worker->task)) {
 		kfree(worker);
 		return ERR_PTR(-ENOMEM);
 	}
 
+	wake_up_process(worker->task);
+
 	return worker;
 }
 
@@ -95,33 +113,129 @@ static void swork_destroy(struct sworker *worker)
 {
 	kthread_stop(worker->task);
 
-	WARN_ON(!list_empty(&worker->events));
+	WARN_ON(!llist_empty(&worker->events));
 	kfree(worker);
 }
 
+/*
+ * Workers are only created and destroyed with CPU hotplug excluded, so the
+ * hotplug callback can look them up without taking worker_mutex.
+ */
+static void swork_destroy_all(void)
+{
+	unsigned int cpu;
+
+	get_online_cpus();
+	for_each_cpu(cpu, &worker_cpus) {
+		swork_destroy(per_cpu(sworkers, cpu));
+		per_cpu(sworkers, cpu) = NULL;
+	}
+
+	cpumask_clear(&worker_cpus);
+	put_online_cpus();
+}
+
+/*
+ * CPUs brought online after swork_get() and hard isolated CPUs have no
+ * worker, their events go to another worker. Workers of CPUs going offline
+ * keep running elsewhere, until swork_cpu_callback() binds them back.
+ */
+static struct sworker *swork_worker(int cpu, struct swork_event *sev)
+{
+	struct sworker *worker = NULL;
+	unsigned int i;
+
+	/* keep the event on the worker that is running it */
+	for_each_cpu(i, &worker_cpus) {
+		worker = READ_ONCE(per_cpu(sworkers, i));
+		if (worker && READ_ONCE(worker->current_event) == sev)
+			return worker;
+	}
+
+	worker = NULL;
+	if (cpu >= 0 && cpu < nr_cpu_ids)
+		worker = READ_ONCE(per_cpu(sworkers, cpu));
+
+	if (!worker)
+		worker = READ_ONCE(per_cpu(sworkers,
+					   cpumask_first(&worker_cpus)));
+
+	return worker;
+}
+
 /**
- * swork_queue - queue swork
+ * swork_queue_on - queue swork on a specific CPU
+ * @cpu: CPU whose worker runs the event
+ * @sev: the event
  *
- * Returns %false if @work was already on a queue, %true otherwise.
+ * Returns %false if @sev was already on a queue, %true otherwise. If @sev is
+ * running, it is queued to the worker running it instead of @cpu's.
  *
- * The work is queued and processed on a random CPU
+ * May be called from any context, including hard interrupts.
  */
-bool swork_queue(struct swork_event *sev)
+bool swork_queue_on(int cpu, struct swork_event *sev)
 {
-	unsigned long flags;
+	struct sworker *worker;
 
 	if (test_and_set_bit(SWORK_EVENT_PENDING, &sev->flags))
 		return false;
 
-	raw_spin_lock_irqsave(&glob_worker->lock, flags);
-	list_add_tail(&sev->item, &glob_worker->events);
-	raw_spin_unlock_irqrestore(&glob_worker->lock, flags);
+	worker = swork_worker(cpu, sev);
+
+	/* the worker is only woken by the first event of a batch */
+	if (llist_add(&sev->node, &worker->events))
+		swake_up(&worker->wq);
 
-	swake_up(&glob_worker->wq);
 	return true;
 }
+EXPORT_SYMBOL_GPL(swork_queue_on);
+
+/**
+ * swork_queue - queue swork
+ *
+ * Returns %false if @work was already on a queue, %true otherwise.
+ *
+ * The work is queued and processed on the local CPU
+ */
+bool swork_queue(struct swork_event *sev)
+{
+	return swork_queue_on(raw_smp_processor_id(), sev);
+}
 EXPORT_SYMBOL_GPL(swork_queue);
 
+/**
+ * swork_set_priority - set the scheduling policy of sworkers
+ * @cpu: CPU whose worker is changed, or -1 for all workers
+ * @policy: scheduling policy, SCHED_FIFO, SCHED_RR or SCHED_NORMAL
+ * @prio: real-time priority, must be 0 for SCHED_NORMAL
+ *
+ * Must be called between swork_get() and swork_put(). Returns a negative
+ * error code if the policy could not be applied.
+ */
+int swork_set_priority(int cpu, int policy, int prio)
+{
+	struct sched_param param = { .sched_priority = prio };
+	unsigned int i;
+	int ret = -EINVAL;
+
+	mutex_lock(&worker_mutex);
+
+	for_each_cpu(i, &worker_cpus) {
+		if (cpu >= 0 && i != cpu)
+			continue;
+
+		ret = sched_setscheduler(per_cpu(sworkers, i)->task, policy,
+					 &param);
+		if (ret)
+			break;
+	}
+
+	mutex_unlock(&worker_mutex);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(swork_set_priority);
+
 /**
  * swork_get - get an instance of the sworker
  *
@@ -132,19 +246,31 @@ EXPORT_SYMBOL_GPL(swork_queue);
 int swork_get(void)
 {
 	struct sworker *worker;
+	unsigned int cpu;
 
 	mutex_lock(&worker_mutex);
-	if (!glob_worker) {
-		worker = swork_create();
-		if (IS_ERR(worker)) {
-			mutex_unlock(&worker_mutex);
-			return -ENOMEM;
+	if (!worker_refs) {
+		get_online_cpus();
+		for_each_online_cpu(cpu) {
+			/* their events are handled by another worker */
+			if (!is_housekeeping_cpu(cpu))
+				continue;
+
+			worker = swork_create(cpu);
+			if (IS_ERR(worker)) {
+				put_online_cpus();
+				swork_destroy_all();
+				mutex_unlock(&worker_mutex);
+				return -ENOMEM;
+			}
+
+			per_cpu(sworkers, cpu) = worker;
+			cpumask_set_cpu(cpu, &worker_cpus);
 		}
-
-		glob_worker = worker;
+		put_online_cpus();
 	}
 
-	glob_worker->refs++;
+	worker_refs++;
 	mutex_unlock(&worker_mutex);
 
 	return 0;
@@ -154,20 +280,48 @@ EXPORT_SYMBOL_GPL(swork_get);
 /**
  * swork_put - puts an instance of the sworker
  *
- * Will destroy the sworker thread. This function must not be called until all
- * queued events have been completed.
+ * Will destroy the sworker threads. This function must not be called until
+ * all queued events have been completed.
  */
 void swork_put(void)
 {
 	mutex_lock(&worker_mutex);
 
-	glob_worker->refs--;
-	if (glob_worker->refs > 0)
+	worker_refs--;
+	if (worker_refs > 0)
 		goto out;
 
-	swork_destroy(glob_worker);
-	glob_worker = NULL;
+	swork_destroy_all();
 out:
 	mutex_unlock(&worker_mutex);
 }
 EXPORT_SYMBOL_GPL(swork_put);
+
+/*
+ * The scheduler moves the worker of a CPU going offline to another CPU and
+ * drops its binding for good. Bind it back once the CPU is up again.
+ */
+static int swork_cpu_callback(struct notifier_block *nfb,
+			      unsigned long action, void *hcpu)
+{
+	unsigned int cpu = (unsigned long)hcpu;
+	struct sworker *worker;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_ONLINE:
+	case CPU_DOWN_FAILED:
+		worker = per_cpu(sworkers, cpu);
+		if (worker)
+			set_cpus_allowed_ptr(worker->task, cpumask_of(cpu));
+		break;
+	}
+
+	return NOTIFY_OK;
+}
+
+static int __init swork_init(void)
+{
+	hotcpu_notifier(swork_cpu_callback, 0);
+	return 0;
+}
+early_initcall(swork_init);
@@ -1356,31 +1356,35 @@ static void __run_hrtimer(struct hrtimer_cpu_base *cpu_base,
 }
 
 #ifdef CONFIG_PREEMPT_RT_BASE
-static void hrtimer_rt_reprogram(int restart, struct hrtimer *timer,
-				 struct hrtimer_clock_base *base)
+/*
+ * Requeue a timer which got restarted by its callback. Returns 1 when it
+ * became the first timer of its base, the clock event device then needs
+ * to be reprogrammed, which is done once per batch of expired timers.
+ */
+static int hrtimer_rt_requeue(int restart, struct hrtimer *timer,
+			      struct hrtimer_clock_base *base)
 {
-	int leftmost;
+	if (restart == HRTIMER_NORESTART ||
+	    (timer->state & HRTIMER_STATE_ENQUEUED))
+		return 0;
 
-	if (restart != HRTIMER_NORESTART &&
-	    !(timer->state & HRTIMER_STATE_ENQUEUED)) {
+	return enqueue_hrtimer(timer, base);
+}
 
-		leftmost = enqueue_hrtimer(timer, base);
-		if (!leftmost)
-			return;
+static void hrtimer_rt_reprogram(struct hrtimer_cpu_base *cpu_base)
+{
 #ifdef CONFIG_HIGH_RES_TIMERS
-		if (!hrtimer_is_hres_active(timer)) {
-			/*
-			 * Kick to reschedule the next tick to handle the new timer
-			 * on dynticks target.
-			 */
-			if (base->cpu_base->nohz_active)
-				wake_up_nohz_cpu(base->cpu_base->cpu);
-		} else {
-
-			hrtimer_reprogram(timer, base);
-		}
-#endif
+	if (!__hrtimer_hres_active(cpu_base)) {
+		/*
+		 * Kick to reschedule the next tick to handle the new timer
+		 * on dynticks target.
+		 */
+		if (cpu_base->nohz_active)
+			wake_up_nohz_cpu(cpu_base->cpu);
+	} else {
+		hrtimer_force_reprogram(cpu_base, 1);
 	}
+#endif
 }
 
 /*
@@ -1396,6 +1400,7 @@ static void hrtimer_rt_run_pending(void)
 	struct hrtimer_clock_base *base;
 	struct hrtimer *timer;
 	int index, restart;
+	int reprogram = 0;
 
 	local_irq_disable();
 	cpu_base = &per_cpu(hrtimer_bases, smp_processor_id());
@@ -1425,7 +1430,7 @@ static void hrtimer_rt_run_pending(void)
 			restart = fn(timer);
 			raw_spin_lock_irq(&cpu_base->lock);
 
-			hrtimer_rt_reprogram(restart, timer, base);
+			reprogram |= hrtimer_rt_requeue(restart, timer, base);
 			raw_write_seqcount_barrier(&cpu_base->seq);
 
 			WARN_ON_ONCE(cpu_base->running_soft != timer);
@@ -1433,6 +1438,13 @@ static void hrtimer_rt_run_pending(void)
 		}
 	}
 
+	/*
+	 * Periodic timers restarting from the softirq would otherwise
+	 * reprogram the device one by one, do it once for all of them.
+	 */
+	if (reprogram)
+		hrtimer_rt_reprogram(cpu_base);
+
 	raw_spin_unlock_irq(&cpu_base->lock);
 
 	wake_up_timer_waiters(cpu_base);
@@ -1262,7 +1262,12 @@ static int posix_cpu_timers_thread(void *data)
 		if (cpu_is_offline(cpu))
 			goto wait_to_die;
 
-		/* grab task list */
+		/*
+		 * grab task list. Set the state first so that a task
+		 * queued right after we found the list empty still wakes
+		 * us: run_posix_cpu_timers() only wakes on an empty list.
+		 */
+		set_current_state(TASK_INTERRUPTIBLE);
 		raw_local_irq_disable();
 		tsk = per_cpu(posix_timer_tasklist, cpu);
 		per_cpu(posix_timer_tasklist, cpu) = NULL;
@@ -1270,11 +1275,11 @@ static int posix_cpu_timers_thread(void *data)
 
 		/* its possible the list is empty, just return */
 		if (!tsk) {
-			set_current_state(TASK_INTERRUPTIBLE);
 			schedule();
 			__set_current_state(TASK_RUNNING);
 			continue;
 		}
+		__set_current_state(TASK_RUNNING);
 
 		/* Process task list */
 		while (1) {
@@ -1313,13 +1318,14 @@ static inline int __fastpath_timer_check(struct task_struct *tsk)
 	if (unlikely(tsk->exit_state))
 		return 0;
 
-	if (!task_cputime_zero(&tsk->cputime_expires))
-			return 1;
-
-	if (!task_cputime_zero(&tsk->signal->cputime_expires))
-			return 1;
-
-	return 0;
+	/*
+	 * Only hand the task to the timer thread when something actually
+	 * expired. The group sample is the running cputimer aggregate, so
+	 * this is cheap even for processes with many threads, and an
+	 * armed RLIMIT_CPU or ITIMER_PROF no longer costs a wakeup and a
+	 * sighand lock round trip on every tick.
+	 */
+	return fastpath_timer_check(tsk);
 }
 
 void run_posix_cpu_timers(struct task_struct *tsk)
@@ -1347,7 +1353,13 @@ void run_posix_cpu_timers(struct task_struct *tsk)
 		}
 		per_cpu(posix_timer_tasklist, cpu) = tsk;
 
-		wake_up_process(per_cpu(posix_timer_task, cpu));
+		/*
+		 * A non-empty list has not been picked up yet, so the
+		 * thread was already woken for it and will batch this
+		 * task with the others.
+		 */
+		if (!tasklist)
+			wake_up_process(per_cpu(posix_timer_task, cpu));
 	}
 }
 
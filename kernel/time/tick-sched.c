@@ -24,6 +24,7 @@
 #include <linux/posix-timers.h>
 #include <linux/perf_event.h>
 #include <linux/context_tracking.h>
+#include <linux/tracefs.h>
 
 #include <asm/irq_regs.h>
 
@@ -127,7 +128,7 @@ static void tick_sched_do_timer(ktime_t now)
 	 * jiffies_lock.
 	 */
 	if (unlikely(tick_do_timer_cpu == TICK_DO_TIMER_NONE)
-	    && !tick_nohz_full_cpu(cpu))
+	    && is_housekeeping_cpu(cpu))
 		tick_do_timer_cpu = cpu;
 #endif
 
@@ -157,31 +158,80 @@ static void tick_sched_handle(struct tick_sched *ts, struct pt_regs *regs)
 	profile_tick(CPU_PROFILING);
 }
 
+/*
+ * Reasons why a full dynticks CPU had to keep (or shorten) its tick
+ */
+enum tick_blocked {
+	TICK_BLOCKED_NONE = -1,
+	TICK_BLOCKED_SCHED,
+	TICK_BLOCKED_POSIX_TIMER,
+	TICK_BLOCKED_PERF,
+	TICK_BLOCKED_IRQ_WORK_IPI,
+	TICK_BLOCKED_SCHED_CLOCK,
+	TICK_BLOCKED_RCU,
+	TICK_BLOCKED_ARCH,
+	TICK_BLOCKED_IRQ_WORK,
+	TICK_BLOCKED_TIMER,
+	TICK_BLOCKED_MAX,
+};
+
 #ifdef CONFIG_NO_HZ_FULL
 cpumask_var_t tick_nohz_full_mask;
 cpumask_var_t housekeeping_mask;
 bool tick_nohz_full_running;
 
-static bool can_stop_full_tick(void)
+struct tick_blocked_stats {
+	unsigned long	count[TICK_BLOCKED_MAX];
+};
+
+static DEFINE_PER_CPU(struct tick_blocked_stats, tick_blocked_stats);
+
+static const char * const tick_blocked_names[TICK_BLOCKED_MAX] = {
+	[TICK_BLOCKED_SCHED]		= "sched",
+	[TICK_BLOCKED_POSIX_TIMER]	= "posix_timer",
+	[TICK_BLOCKED_PERF]		= "perf",
+	[TICK_BLOCKED_IRQ_WORK_IPI]	= "irq_work_ipi",
+	[TICK_BLOCKED_SCHED_CLOCK]	= "sched_clock",
+	[TICK_BLOCKED_RCU]		= "rcu",
+	[TICK_BLOCKED_ARCH]		= "arch",
+	[TICK_BLOCKED_IRQ_WORK]		= "irq_work",
+	[TICK_BLOCKED_TIMER]		= "timer",
+};
+
+/*
+ * Account why the tick could not be stopped on a full dynticks CPU.
+ * Called with interrupts disabled.
+ */
+static void tick_nohz_full_blocked(int cpu, enum tick_blocked reason)
+{
+	if (tick_nohz_full_cpu(cpu))
+		__this_cpu_inc(tick_blocked_stats.count[reason]);
+}
+
+static bool can_stop_full_tick(int cpu)
 {
 	WARN_ON_ONCE(!irqs_disabled());
 
 	if (!sched_can_stop_tick()) {
+		tick_nohz_full_blocked(cpu, TICK_BLOCKED_SCHED);
 		trace_tick_stop(0, "more than 1 task in runqueue\n");
 		return false;
 	}
 
 	if (!posix_cpu_timers_can_stop_tick(current)) {
+		tick_nohz_full_blocked(cpu, TICK_BLOCKED_POSIX_TIMER);
 		trace_tick_stop(0, "posix timers running\n");
 		return false;
 	}
 
 	if (!perf_event_can_stop_tick()) {
+		tick_nohz_full_blocked(cpu, TICK_BLOCKED_PERF);
 		trace_tick_stop(0, "perf events running\n");
 		return false;
 	}
 
 	if (!arch_irq_work_has_interrupt()) {
+		tick_nohz_full_blocked(cpu, TICK_BLOCKED_IRQ_WORK_IPI);
 		trace_tick_stop(0, "missing irq work interrupt\n");
 		return false;
 	}
@@ -193,6 +243,7 @@ static bool can_stop_full_tick(void)
 	 * sched_clock_stable is set.
 	 */
 	if (!sched_clock_stable()) {
+		tick_nohz_full_blocked(cpu, TICK_BLOCKED_SCHED_CLOCK);
 		trace_tick_stop(0, "unstable sched clock\n");
 		/*
 		 * Don't allow the user to think they can get
@@ -272,13 +323,15 @@ void tick_nohz_full_kick_all(void)
 void __tick_nohz_task_switch(void)
 {
 	unsigned long flags;
+	int cpu;
 
 	local_irq_save(flags);
 
-	if (!tick_nohz_full_cpu(smp_processor_id()))
+	cpu = smp_processor_id();
+	if (!tick_nohz_full_cpu(cpu))
 		goto out;
 
-	if (tick_nohz_tick_stopped() && !can_stop_full_tick())
+	if (tick_nohz_tick_stopped() && !can_stop_full_tick(cpu))
 		tick_nohz_full_kick();
 
 out:
@@ -375,6 +428,9 @@ void __init tick_nohz_init(void)
 
 	cpumask_andnot(housekeeping_mask,
 		       cpu_possible_mask, tick_nohz_full_mask);
+	if (cpu_hard_isolation)
+		cpumask_andnot(housekeeping_mask, housekeeping_mask,
+			       cpu_hard_isolated_map);
 
 	for_each_cpu(cpu, tick_nohz_full_mask)
 		context_tracking_cpu_set(cpu);
@@ -389,6 +445,54 @@ void __init tick_nohz_init(void)
 	 */
 	WARN_ON_ONCE(cpumask_empty(housekeeping_mask));
 }
+
+#ifdef CONFIG_TRACING
+static int tick_blocked_show(struct seq_file *m, void *v)
+{
+	struct tick_blocked_stats *st;
+	int cpu, i;
+
+	seq_puts(m, "cpu");
+	for (i = 0; i < TICK_BLOCKED_MAX; i++)
+		seq_printf(m, " %s", tick_blocked_names[i]);
+	seq_putc(m, '\n');
+
+	for_each_cpu(cpu, tick_nohz_full_mask) {
+		st = &per_cpu(tick_blocked_stats, cpu);
+		seq_printf(m, "%d", cpu);
+		for (i = 0; i < TICK_BLOCKED_MAX; i++)
+			seq_printf(m, " %lu", st->count[i]);
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+
+static int tick_blocked_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tick_blocked_show, NULL);
+}
+
+static const struct file_operations tick_blocked_fops = {
+	.open		= tick_blocked_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init tick_blocked_init(void)
+{
+	if (!tick_nohz_full_running)
+		return 0;
+
+	tracefs_create_file("tick_stop_blocked", 0444, NULL, NULL,
+			    &tick_blocked_fops);
+	return 0;
+}
+fs_initcall(tick_blocked_init);
+#endif /* CONFIG_TRACING */
+
+#else
+static inline void tick_nohz_full_blocked(int cpu, enum tick_blocked reason) { }
 #endif
 
 /*
@@ -584,6 +688,7 @@ static ktime_t tick_nohz_stop_sched_tick(struct tick_sched *ts,
 {
 	struct clock_event_device *dev = __this_cpu_read(tick_cpu_device.evtdev);
 	u64 basemono, next_tick, next_tmr, next_rcu, delta, expires;
+	enum tick_blocked blocked = TICK_BLOCKED_NONE;
 	unsigned long seq, basejiff;
 	ktime_t	tick;
 
@@ -595,8 +700,14 @@ static ktime_t tick_nohz_stop_sched_tick(struct tick_sched *ts,
 	} while (read_seqcount_retry(&jiffies_seq, seq));
 	ts->last_jiffies = basejiff;
 
-	if (rcu_needs_cpu(basemono, &next_rcu) ||
-	    arch_needs_cpu() || irq_work_needs_cpu()) {
+	if (rcu_needs_cpu(basemono, &next_rcu))
+		blocked = TICK_BLOCKED_RCU;
+	else if (arch_needs_cpu())
+		blocked = TICK_BLOCKED_ARCH;
+	else if (irq_work_needs_cpu())
+		blocked = TICK_BLOCKED_IRQ_WORK;
+
+	if (blocked != TICK_BLOCKED_NONE) {
 		next_tick = basemono + TICK_NSEC;
 	} else {
 		/*
@@ -619,6 +730,21 @@ static ktime_t tick_nohz_stop_sched_tick(struct tick_sched *ts,
 	delta = next_tick - basemono;
 	if (delta <= (u64)TICK_NSEC) {
 		tick.tv64 = 0;
+
+		if (blocked == TICK_BLOCKED_NONE)
+			blocked = TICK_BLOCKED_TIMER;
+		if (!ts->inidle)
+			tick_nohz_full_blocked(cpu, blocked);
+
+		/*
+		 * Tell the timer code that the base is not idle, i.e. undo
+		 * the effect of get_next_timer_interrupt():
+		 */
+		timer_clear_idle();
+		/*
+		 * We've not stopped the tick yet, and there's a timer in the
+		 * next period, so no point in stopping it either, bail.
+		 */
 		if (!ts->tick_stopped)
 			goto out;
 		if (delta == 0) {
@@ -711,6 +837,12 @@ static void tick_nohz_restart_sched_tick(struct tick_sched *ts, ktime_t now)
 	tick_do_update_jiffies64(now);
 	update_cpu_load_nohz();
 
+	/*
+	 * Clear the timer idle flag, so we avoid IPIs on remote queueing and
+	 * the clock forward checks in the enqueue path:
+	 */
+	timer_clear_idle();
+
 	calc_load_exit_idle();
 	touch_softlockup_watchdog();
 	/*
@@ -733,7 +865,7 @@ static void tick_nohz_full_update_tick(struct tick_sched *ts)
 	if (!ts->tick_stopped && ts->nohz_mode == NOHZ_MODE_INACTIVE)
 		return;
 
-	if (can_stop_full_tick())
+	if (can_stop_full_tick(cpu))
 		tick_nohz_stop_sched_tick(ts, ktime_get(), cpu);
 	else if (ts->tick_stopped)
 		tick_nohz_restart_sched_tick(ts, ktime_get());
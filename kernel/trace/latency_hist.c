@@ -23,12 +23,13 @@
 #include <linux/sched/rt.h>
 #include <linux/slab.h>
 #include <linux/atomic.h>
+#include <linux/mm.h>
+#include <linux/stacktrace.h>
 #include <asm/div64.h>
 
 #include "trace.h"
 #include <trace/events/sched.h>
-
-#define NSECS_PER_USECS 1000L
+#include <trace/events/irq.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/hist.h>
@@ -41,21 +42,41 @@ enum {
 	WAKEUP_LATENCY_SHAREDPRIO,
 	MISSED_TIMER_OFFSETS,
 	TIMERANDWAKEUP_LATENCY,
+	WAKEUP_BREAKDOWN,
 	MAX_LATENCY_TYPE,
 };
 
-#define MAX_ENTRY_NUM 10240
+/*
+ * Latencies are recorded in nanoseconds into log-linear buckets. Values
+ * below 2 * HIST_SUB_COUNT get a bucket each, above that every power of two
+ * is split into HIST_SUB_COUNT buckets, which bounds the relative error to
+ * 1 / HIST_SUB_COUNT. MAX_ENTRY_NUM buckets cover latencies up to 2^34 ns.
+ */
+#define HIST_SUB_BITS		4
+#define HIST_SUB_COUNT		(1 << HIST_SUB_BITS)
+#define MAX_ENTRY_NUM		496
+
+#define LATENCY_HIST_MAGIC	0x4c484953	/* "LHIS" */
+#define LATENCY_HIST_VERSION	1
 
+/*
+ * A histogram occupies one page, which is exported as is through the
+ * binary "*.bin" files, for reading or mapping. Counters are updated without
+ * synchronisation, a reader may observe a sample being added.
+ */
 struct hist_data {
+	u32 magic;
+	u16 version;
+	u16 sub_bits;
+	u32 nr_buckets;
 	atomic_t hist_mode; /* 0 log, 1 don't log */
-	long offset; /* set it to MAX_ENTRY_NUM/2 for a bipolar scale */
-	long min_lat;
-	long max_lat;
-	unsigned long long below_hist_bound_samples;
-	unsigned long long above_hist_bound_samples;
-	long long accumulate_lat;
-	unsigned long long total_samples;
-	unsigned long long hist_array[MAX_ENTRY_NUM];
+	s64 min_lat;
+	s64 max_lat;
+	u64 below_hist_bound_samples;
+	u64 above_hist_bound_samples;
+	s64 accumulate_lat;
+	u64 total_samples;
+	u64 hist_array[MAX_ENTRY_NUM];
 };
 
 struct enable_data {
@@ -66,21 +87,21 @@ struct enable_data {
 static char *latency_hist_dir_root = "latency_hist";
 
 #ifdef CONFIG_INTERRUPT_OFF_HIST
-static DEFINE_PER_CPU(struct hist_data, irqsoff_hist);
+static DEFINE_PER_CPU(struct hist_data *, irqsoff_hist);
 static char *irqsoff_hist_dir = "irqsoff";
 static DEFINE_PER_CPU(cycles_t, hist_irqsoff_start);
 static DEFINE_PER_CPU(int, hist_irqsoff_counting);
 #endif
 
 #ifdef CONFIG_PREEMPT_OFF_HIST
-static DEFINE_PER_CPU(struct hist_data, preemptoff_hist);
+static DEFINE_PER_CPU(struct hist_data *, preemptoff_hist);
 static char *preemptoff_hist_dir = "preemptoff";
 static DEFINE_PER_CPU(cycles_t, hist_preemptoff_start);
 static DEFINE_PER_CPU(int, hist_preemptoff_counting);
 #endif
 
 #if defined(CONFIG_PREEMPT_OFF_HIST) && defined(CONFIG_INTERRUPT_OFF_HIST)
-static DEFINE_PER_CPU(struct hist_data, preemptirqsoff_hist);
+static DEFINE_PER_CPU(struct hist_data *, preemptirqsoff_hist);
 static char *preemptirqsoff_hist_dir = "preemptirqsoff";
 static DEFINE_PER_CPU(cycles_t, hist_preemptirqsoff_start);
 static DEFINE_PER_CPU(int, hist_preemptirqsoff_counting);
@@ -103,15 +124,15 @@ struct maxlatproc_data {
 	int current_pid;
 	int prio;
 	int current_prio;
-	long latency;
-	long timeroffset;
+	s64 latency;
+	s64 timeroffset;
 	cycle_t timestamp;
 };
 #endif
 
 #ifdef CONFIG_WAKEUP_LATENCY_HIST
-static DEFINE_PER_CPU(struct hist_data, wakeup_latency_hist);
-static DEFINE_PER_CPU(struct hist_data, wakeup_latency_hist_sharedprio);
+static DEFINE_PER_CPU(struct hist_data *, wakeup_latency_hist);
+static DEFINE_PER_CPU(struct hist_data *, wakeup_latency_hist_sharedprio);
 static char *wakeup_latency_hist_dir = "wakeup";
 static char *wakeup_latency_hist_dir_sharedprio = "sharedprio";
 static notrace void probe_wakeup_latency_hist_start(void *v,
@@ -129,10 +150,89 @@ static DEFINE_PER_CPU(struct maxlatproc_data, wakeup_maxlatproc_sharedprio);
 static DEFINE_PER_CPU(struct task_struct *, wakeup_task);
 static DEFINE_PER_CPU(int, wakeup_sharedprio);
 static unsigned long wakeup_pid;
+static DEFINE_RAW_SPINLOCK(wakeup_lock);
+
+/*
+ * Wakeup latencies of selected tasks are additionally accounted in
+ * histograms of their own, updated under wakeup_lock.
+ */
+#define MAX_TASK_HISTS 16
+
+struct task_hist {
+	pid_t pid;
+	struct hist_data *hist;
+	struct dentry *text;
+	struct dentry *raw;
+};
+
+static struct task_hist wakeup_task_hists[MAX_TASK_HISTS];
+static DEFINE_MUTEX(task_hist_mutex);
+static struct dentry *wakeup_task_hist_dir;
+
+/*
+ * Wakeup latency breakdown: the time from the hard interrupt which started
+ * a wakeup chain until the woken task runs is split into the stages below,
+ * from the timestamps recorded in task_struct::wakeup_chain.
+ */
+enum {
+	CHAIN_IRQ,		/* hard interrupt entry */
+	CHAIN_THREAD_WAKE,	/* wakeup from hard interrupt context */
+	CHAIN_THREAD_RUN,	/* the task woken from hardirq runs */
+	CHAIN_SOFTIRQ,		/* softirq entry */
+	CHAIN_WAKE,		/* wakeup of the task */
+	CHAIN_RUN,		/* the task runs */
+	NR_CHAIN_HOPS,
+};
+
+enum {
+	BREAKDOWN_HARDIRQ,
+	BREAKDOWN_IRQTHREAD_SCHED,
+	BREAKDOWN_IRQTHREAD,
+	BREAKDOWN_SOFTIRQ,
+	BREAKDOWN_SCHED,
+	NR_BREAKDOWN_STAGES,
+};
+
+static const char * const breakdown_stage_names[NR_BREAKDOWN_STAGES] = {
+	"hardirq", "irqthread_sched", "irqthread", "softirq", "sched",
+};
+
+#define BREAKDOWN_STACK_DEPTH 16
+
+/* worst wakeup of a CPU, and the task it had to preempt */
+struct breakdown_max_data {
+	s64 total;
+	s64 stage[NR_BREAKDOWN_STAGES];
+	unsigned int stages;
+	char comm[FIELD_SIZEOF(struct task_struct, comm)];
+	char prev_comm[FIELD_SIZEOF(struct task_struct, comm)];
+	int pid;
+	int prev_pid;
+	unsigned int nr_entries;
+	unsigned long entries[BREAKDOWN_STACK_DEPTH];
+};
+
+static DEFINE_PER_CPU(struct hist_data *,
+	wakeup_breakdown_hist[NR_BREAKDOWN_STAGES]);
+static DEFINE_PER_CPU(struct breakdown_max_data, wakeup_breakdown_max);
+static DEFINE_PER_CPU(u64, breakdown_hardirq_stamp);
+static DEFINE_PER_CPU(u64, breakdown_softirq_stamp);
+static char *wakeup_breakdown_dir = "wakeup_breakdown";
+static notrace void probe_breakdown_irq_entry(void *v, int irq,
+	struct irqaction *action);
+static notrace void probe_breakdown_softirq_entry(void *v,
+	unsigned int vec_nr);
+static notrace void probe_breakdown_wakeup(void *v, struct task_struct *p);
+static notrace void probe_breakdown_switch(void *v,
+	bool preempt, struct task_struct *prev, struct task_struct *next);
+static struct enable_data wakeup_breakdown_enabled_data = {
+	.latency_type = WAKEUP_BREAKDOWN,
+	.enabled = 0,
+};
 #endif
 
 #ifdef CONFIG_MISSED_TIMER_OFFSETS_HIST
-static DEFINE_PER_CPU(struct hist_data, missed_timer_offsets);
+static DEFINE_PER_CPU(struct hist_data *, missed_timer_offsets);
 static char *missed_timer_offsets_dir = "missed_timer_offsets";
 static notrace void probe_hrtimer_interrupt(void *v, int cpu,
 	long long offset, struct task_struct *curr, struct task_struct *task);
@@ -146,7 +246,7 @@ static unsigned long missed_timer_offsets_pid;
 
 #if defined(CONFIG_WAKEUP_LATENCY_HIST) && \
 	defined(CONFIG_MISSED_TIMER_OFFSETS_HIST)
-static DEFINE_PER_CPU(struct hist_data, timerandwakeup_latency_hist);
+static DEFINE_PER_CPU(struct hist_data *, timerandwakeup_latency_hist);
 static char *timerandwakeup_latency_hist_dir = "timerandwakeup";
 static struct enable_data timerandwakeup_enabled_data = {
 	.latency_type = TIMERANDWAKEUP_LATENCY,
@@ -155,8 +255,72 @@ static struct enable_data timerandwakeup_enabled_data = {
 static DEFINE_PER_CPU(struct maxlatproc_data, timerandwakeup_maxlatproc);
 #endif
 
-void notrace latency_hist(int latency_type, int cpu, long latency,
-			  long timeroffset, cycle_t stop,
+static inline int hist_bucket(s64 latency)
+{
+	int shift;
+
+	if (latency < 2 * HIST_SUB_COUNT)
+		return latency;
+
+	shift = fls64(latency) - 1 - HIST_SUB_BITS;
+
+	return ((shift + 1) << HIST_SUB_BITS) +
+	       ((latency >> shift) & (HIST_SUB_COUNT - 1));
+}
+
+/* lowest latency accounted in bucket @index */
+static s64 hist_bucket_latency(int index)
+{
+	int shift;
+
+	if (index < 2 * HIST_SUB_COUNT)
+		return index;
+
+	shift = (index >> HIST_SUB_BITS) - 1;
+
+	return (s64)(HIST_SUB_COUNT + (index & (HIST_SUB_COUNT - 1))) << shift;
+}
+
+static notrace void hist_add(struct hist_data *hist, s64 latency)
+{
+	int index;
+
+	if (latency < 0) {
+		hist->below_hist_bound_samples++;
+	} else {
+		index = hist_bucket(latency);
+		if (index < MAX_ENTRY_NUM)
+			hist->hist_array[index]++;
+		else
+			hist->above_hist_bound_samples++;
+	}
+
+	if (unlikely(latency > hist->max_lat))
+		hist->max_lat = latency;
+	if (unlikely(latency < hist->min_lat))
+		hist->min_lat = latency;
+	hist->total_samples++;
+	hist->accumulate_lat += latency;
+}
+
+#ifdef CONFIG_WAKEUP_LATENCY_HIST
+static notrace void wakeup_task_hist_add(struct task_struct *p, s64 latency)
+{
+	pid_t pid = task_pid_nr(p);
+	int i;
+
+	for (i = 0; i < MAX_TASK_HISTS; i++) {
+		if (wakeup_task_hists[i].hist &&
+		    wakeup_task_hists[i].pid == pid) {
+			hist_add(wakeup_task_hists[i].hist, latency);
+			break;
+		}
+	}
+}
+#endif
+
+void notrace latency_hist(int latency_type, int cpu, s64 latency,
+			  s64 timeroffset, cycle_t stop,
 			  struct task_struct *p)
 {
 	struct hist_data *my_hist;
@@ -172,39 +336,39 @@ void notrace latency_hist(int latency_type, int cpu, long latency,
 	switch (latency_type) {
 #ifdef CONFIG_INTERRUPT_OFF_HIST
 	case IRQSOFF_LATENCY:
-		my_hist = &per_cpu(irqsoff_hist, cpu);
+		my_hist = per_cpu(irqsoff_hist, cpu);
 		break;
 #endif
 #ifdef CONFIG_PREEMPT_OFF_HIST
 	case PREEMPTOFF_LATENCY:
-		my_hist = &per_cpu(preemptoff_hist, cpu);
+		my_hist = per_cpu(preemptoff_hist, cpu);
 		break;
 #endif
 #if defined(CONFIG_PREEMPT_OFF_HIST) && defined(CONFIG_INTERRUPT_OFF_HIST)
 	case PREEMPTIRQSOFF_LATENCY:
-		my_hist = &per_cpu(preemptirqsoff_hist, cpu);
+		my_hist = per_cpu(preemptirqsoff_hist, cpu);
 		break;
 #endif
 #ifdef CONFIG_WAKEUP_LATENCY_HIST
 	case WAKEUP_LATENCY:
-		my_hist = &per_cpu(wakeup_latency_hist, cpu);
+		my_hist = per_cpu(wakeup_latency_hist, cpu);
 		mp = &per_cpu(wakeup_maxlatproc, cpu);
 		break;
 	case WAKEUP_LATENCY_SHAREDPRIO:
-		my_hist = &per_cpu(wakeup_latency_hist_sharedprio, cpu);
+		my_hist = per_cpu(wakeup_latency_hist_sharedprio, cpu);
 		mp = &per_cpu(wakeup_maxlatproc_sharedprio, cpu);
 		break;
 #endif
 #ifdef CONFIG_MISSED_TIMER_OFFSETS_HIST
 	case MISSED_TIMER_OFFSETS:
-		my_hist = &per_cpu(missed_timer_offsets, cpu);
+		my_hist = per_cpu(missed_timer_offsets, cpu);
 		mp = &per_cpu(missed_timer_offsets_maxlatproc, cpu);
 		break;
 #endif
 #if defined(CONFIG_WAKEUP_LATENCY_HIST) && \
 	defined(CONFIG_MISSED_TIMER_OFFSETS_HIST)
 	case TIMERANDWAKEUP_LATENCY:
-		my_hist = &per_cpu(timerandwakeup_latency_hist, cpu);
+		my_hist = per_cpu(timerandwakeup_latency_hist, cpu);
 		mp = &per_cpu(timerandwakeup_maxlatproc, cpu);
 		break;
 #endif
@@ -213,21 +377,17 @@ void notrace latency_hist(int latency_type, int cpu, long latency,
 		return;
 	}
 
-	latency += my_hist->offset;
-
-	if (atomic_read(&my_hist->hist_mode) == 0)
+	if (!my_hist || atomic_read(&my_hist->hist_mode) == 0)
 		return;
 
-	if (latency < 0 || latency >= MAX_ENTRY_NUM) {
-		if (latency < 0)
-			my_hist->below_hist_bound_samples++;
-		else
-			my_hist->above_hist_bound_samples++;
-	} else
-		my_hist->hist_array[latency]++;
+#ifdef CONFIG_WAKEUP_LATENCY_HIST
+	if (latency_type == WAKEUP_LATENCY ||
+	    latency_type == WAKEUP_LATENCY_SHAREDPRIO)
+		wakeup_task_hist_add(p, latency);
+#endif
 
 	if (unlikely(latency > my_hist->max_lat ||
-	    my_hist->min_lat == LONG_MAX)) {
+	    my_hist->min_lat == S64_MAX)) {
 #if defined(CONFIG_WAKEUP_LATENCY_HIST) || \
 	defined(CONFIG_MISSED_TIMER_OFFSETS_HIST)
 		if (latency_type == WAKEUP_LATENCY ||
@@ -246,12 +406,19 @@ void notrace latency_hist(int latency_type, int cpu, long latency,
 			mp->timestamp = stop;
 		}
 #endif
-		my_hist->max_lat = latency;
 	}
-	if (unlikely(latency < my_hist->min_lat))
-		my_hist->min_lat = latency;
-	my_hist->total_samples++;
-	my_hist->accumulate_lat += latency;
+
+	hist_add(my_hist, latency);
+}
+
+static int hist_snprint_usecs(char *buf, size_t size, s64 latency)
+{
+	u64 abs = latency < 0 ? -latency : latency;
+	u32 rem;
+	u64 usecs = div_u64_rem(abs, NSEC_PER_USEC, &rem);
+
+	return snprintf(buf, size, "%s%llu.%03u", latency < 0 ? "-" : "",
+			usecs, rem);
 }
 
 static void *l_start(struct seq_file *m, loff_t *pos)
@@ -261,41 +428,41 @@ static void *l_start(struct seq_file *m, loff_t *pos)
 	struct hist_data *my_hist = m->private;
 
 	if (index == 0) {
-		char minstr[32], avgstr[32], maxstr[32];
+		char minstr[32], avgstr[32], maxstr[32], boundstr[32];
 
 		atomic_dec(&my_hist->hist_mode);
 
 		if (likely(my_hist->total_samples)) {
-			long avg = (long) div64_s64(my_hist->accumulate_lat,
+			s64 avg = div64_s64(my_hist->accumulate_lat,
 			    my_hist->total_samples);
-			snprintf(minstr, sizeof(minstr), "%ld",
-			    my_hist->min_lat - my_hist->offset);
-			snprintf(avgstr, sizeof(avgstr), "%ld",
-			    avg - my_hist->offset);
-			snprintf(maxstr, sizeof(maxstr), "%ld",
-			    my_hist->max_lat - my_hist->offset);
+			hist_snprint_usecs(minstr, sizeof(minstr),
+			    my_hist->min_lat);
+			hist_snprint_usecs(avgstr, sizeof(avgstr), avg);
+			hist_snprint_usecs(maxstr, sizeof(maxstr),
+			    my_hist->max_lat);
 		} else {
 			strcpy(minstr, "<undef>");
 			strcpy(avgstr, minstr);
 			strcpy(maxstr, minstr);
 		}
 
+		hist_snprint_usecs(boundstr, sizeof(boundstr),
+		    hist_bucket_latency(MAX_ENTRY_NUM));
+
 		seq_printf(m, "#Minimum latency: %s microseconds\n"
 			   "#Average latency: %s microseconds\n"
 			   "#Maximum latency: %s microseconds\n"
 			   "#Total samples: %llu\n"
-			   "#There are %llu samples lower than %ld"
+			   "#There are %llu samples lower than 0"
 			   " microseconds.\n"
 			   "#There are %llu samples greater or equal"
-			   " than %ld microseconds.\n"
+			   " than %s microseconds.\n"
 			   "#usecs\t%16s\n",
 			   minstr, avgstr, maxstr,
 			   my_hist->total_samples,
 			   my_hist->below_hist_bound_samples,
-			   -my_hist->offset,
 			   my_hist->above_hist_bound_samples,
-			   MAX_ENTRY_NUM - my_hist->offset,
-			   "samples");
+			   boundstr, "samples");
 	}
 	if (index < MAX_ENTRY_NUM) {
 		index_ptr = kmalloc(sizeof(loff_t), GFP_KERNEL);
@@ -328,9 +495,11 @@ static int l_show(struct seq_file *m, void *p)
 {
 	int index = *(loff_t *) p;
 	struct hist_data *my_hist = m->private;
+	char latstr[32];
 
-	seq_printf(m, "%6ld\t%16llu\n", index - my_hist->offset,
-	    my_hist->hist_array[index]);
+	/* each row is the lower bound of a bucket */
+	hist_snprint_usecs(latstr, sizeof(latstr), hist_bucket_latency(index));
+	seq_printf(m, "%10s\t%16llu\n", latstr, my_hist->hist_array[index]);
 	return 0;
 }
 
@@ -360,6 +529,77 @@ static const struct file_operations latency_hist_fops = {
 	.release = seq_release,
 };
 
+static ssize_t latency_hist_raw_read(struct file *file, char __user *ubuf,
+				     size_t cnt, loff_t *ppos)
+{
+	struct hist_data *hist = file->private_data;
+
+	return simple_read_from_buffer(ubuf, cnt, ppos, hist, sizeof(*hist));
+}
+
+static int latency_hist_raw_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct hist_data *hist = file->private_data;
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != PAGE_SIZE)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return vm_insert_page(vma, vma->vm_start, virt_to_page(hist));
+}
+
+static const struct file_operations latency_hist_raw_fops = {
+	.open = simple_open,
+	.read = latency_hist_raw_read,
+	.mmap = latency_hist_raw_mmap,
+	.llseek = default_llseek,
+};
+
+static struct hist_data *hist_alloc(void)
+{
+	struct hist_data *hist;
+
+	BUILD_BUG_ON(sizeof(struct hist_data) > PAGE_SIZE);
+
+	hist = (struct hist_data *) get_zeroed_page(GFP_KERNEL);
+	if (!hist)
+		return NULL;
+
+	hist->magic = LATENCY_HIST_MAGIC;
+	hist->version = LATENCY_HIST_VERSION;
+	hist->sub_bits = HIST_SUB_BITS;
+	hist->nr_buckets = MAX_ENTRY_NUM;
+	hist->min_lat = S64_MAX;
+	hist->max_lat = S64_MIN;
+	atomic_set(&hist->hist_mode, 1);
+
+	return hist;
+}
+
+/*
+ * Allocate a histogram and expose it in @dir as text file @name and as raw
+ * file @name.bin.
+ */
+static struct hist_data *hist_create(struct dentry *dir, const char *name)
+{
+	struct hist_data *hist;
+	char rawname[64];
+
+	hist = hist_alloc();
+	if (!hist)
+		return NULL;
+
+	snprintf(rawname, sizeof(rawname), "%s.bin", name);
+	debugfs_create_file(name, 0444, dir, hist, &latency_hist_fops);
+	debugfs_create_file(rawname, 0444, dir, hist, &latency_hist_raw_fops);
+
+	return hist;
+}
+
 #if defined(CONFIG_WAKEUP_LATENCY_HIST) || \
 	defined(CONFIG_MISSED_TIMER_OFFSETS_HIST)
 static void clear_maxlatprocdata(struct maxlatproc_data *mp)
@@ -373,19 +613,46 @@ static void clear_maxlatprocdata(struct maxlatproc_data *mp)
 
 static void hist_reset(struct hist_data *hist)
 {
+	if (!hist)
+		return;
+
 	atomic_dec(&hist->hist_mode);
 
 	memset(hist->hist_array, 0, sizeof(hist->hist_array));
 	hist->below_hist_bound_samples = 0ULL;
 	hist->above_hist_bound_samples = 0ULL;
-	hist->min_lat = LONG_MAX;
-	hist->max_lat = LONG_MIN;
+	hist->min_lat = S64_MAX;
+	hist->max_lat = S64_MIN;
 	hist->total_samples = 0ULL;
 	hist->accumulate_lat = 0LL;
 
 	atomic_inc(&hist->hist_mode);
 }
 
+#ifdef CONFIG_WAKEUP_LATENCY_HIST
+static void wakeup_task_hists_reset(void)
+{
+	int i;
+
+	mutex_lock(&task_hist_mutex);
+	for (i = 0; i < MAX_TASK_HISTS; i++)
+		hist_reset(wakeup_task_hists[i].hist);
+	mutex_unlock(&task_hist_mutex);
+}
+
+static void wakeup_breakdown_reset(int cpu)
+{
+	struct breakdown_max_data *bm = &per_cpu(wakeup_breakdown_max, cpu);
+	int i;
+
+	for (i = 0; i < NR_BREAKDOWN_STAGES; i++)
+		hist_reset(per_cpu(wakeup_breakdown_hist, cpu)[i]);
+
+	memset(bm, 0, sizeof(*bm));
+	bm->pid = bm->prev_pid = -1;
+}
+#endif
+
 static ssize_t
 latency_hist_reset(struct file *file, const char __user *a,
 		   size_t size, loff_t *off)
@@ -403,39 +670,42 @@ latency_hist_reset(struct file *file, const char __user *a,
 		switch (latency_type) {
 #ifdef CONFIG_PREEMPT_OFF_HIST
 		case PREEMPTOFF_LATENCY:
-			hist = &per_cpu(preemptoff_hist, cpu);
+			hist = per_cpu(preemptoff_hist, cpu);
 			break;
 #endif
 #ifdef CONFIG_INTERRUPT_OFF_HIST
 		case IRQSOFF_LATENCY:
-			hist = &per_cpu(irqsoff_hist, cpu);
+			hist = per_cpu(irqsoff_hist, cpu);
 			break;
 #endif
 #if defined(CONFIG_INTERRUPT_OFF_HIST) && defined(CONFIG_PREEMPT_OFF_HIST)
 		case PREEMPTIRQSOFF_LATENCY:
-			hist = &per_cpu(preemptirqsoff_hist, cpu);
+			hist = per_cpu(preemptirqsoff_hist, cpu);
 			break;
 #endif
 #ifdef CONFIG_WAKEUP_LATENCY_HIST
 		case WAKEUP_LATENCY:
-			hist = &per_cpu(wakeup_latency_hist, cpu);
+			hist = per_cpu(wakeup_latency_hist, cpu);
 			mp = &per_cpu(wakeup_maxlatproc, cpu);
 			break;
 		case WAKEUP_LATENCY_SHAREDPRIO:
-			hist = &per_cpu(wakeup_latency_hist_sharedprio, cpu);
+			hist = per_cpu(wakeup_latency_hist_sharedprio, cpu);
 			mp = &per_cpu(wakeup_maxlatproc_sharedprio, cpu);
 			break;
+		case WAKEUP_BREAKDOWN:
+			wakeup_breakdown_reset(cpu);
+			break;
 #endif
 #ifdef CONFIG_MISSED_TIMER_OFFSETS_HIST
 		case MISSED_TIMER_OFFSETS:
-			hist = &per_cpu(missed_timer_offsets, cpu);
+			hist = per_cpu(missed_timer_offsets, cpu);
 			mp = &per_cpu(missed_timer_offsets_maxlatproc, cpu);
 			break;
 #endif
 #if defined(CONFIG_WAKEUP_LATENCY_HIST) && \
 	defined(CONFIG_MISSED_TIMER_OFFSETS_HIST)
 		case TIMERANDWAKEUP_LATENCY:
-			hist = &per_cpu(timerandwakeup_latency_hist, cpu);
+			hist = per_cpu(timerandwakeup_latency_hist, cpu);
 			mp = &per_cpu(timerandwakeup_maxlatproc, cpu);
 			break;
 #endif
@@ -452,6 +722,11 @@ latency_hist_reset(struct file *file, const char __user *a,
 #endif
 	}
 
+#ifdef CONFIG_WAKEUP_LATENCY_HIST
+	if (latency_type == WAKEUP_LATENCY)
+		wakeup_task_hists_reset();
+#endif
+
 	return size;
 }
 
@@ -492,6 +767,215 @@ static ssize_t do_pid(struct file *file, const char __user *ubuf,
 }
 #endif
 
+#ifdef CONFIG_WAKEUP_LATENCY_HIST
+/*
+ * Per task histograms go away while the tracer runs, so each open file
+ * holds a reference on the page of its histogram. The page is freed by
+ * whoever drops the last reference, the remover or the last reader.
+ */
+static int task_hist_get(struct hist_data *hist)
+{
+	int ret = -ENOENT;
+	int i;
+
+	mutex_lock(&task_hist_mutex);
+	for (i = 0; i < MAX_TASK_HISTS; i++) {
+		if (wakeup_task_hists[i].hist == hist) {
+			get_page(virt_to_page(hist));
+			ret = 0;
+			break;
+		}
+	}
+	mutex_unlock(&task_hist_mutex);
+
+	return ret;
+}
+
+static void task_hist_put(struct hist_data *hist)
+{
+	free_page((unsigned long) hist);
+}
+
+static int task_hist_open(struct inode *inode, struct file *file)
+{
+	int ret;
+
+	ret = task_hist_get(inode->i_private);
+	if (ret)
+		return ret;
+
+	ret = latency_hist_open(inode, file);
+	if (ret)
+		task_hist_put(inode->i_private);
+
+	return ret;
+}
+
+static int task_hist_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *seq = file->private_data;
+	struct hist_data *hist = seq->private;
+
+	seq_release(inode, file);
+	task_hist_put(hist);
+
+	return 0;
+}
+
+static const struct file_operations task_hist_fops = {
+	.open = task_hist_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = task_hist_release,
+};
+
+static int task_hist_raw_open(struct inode *inode, struct file *file)
+{
+	int ret;
+
+	ret = task_hist_get(inode->i_private);
+	if (ret)
+		return ret;
+
+	return simple_open(inode, file);
+}
+
+static int task_hist_raw_release(struct inode *inode, struct file *file)
+{
+	task_hist_put(file->private_data);
+
+	return 0;
+}
+
+static const struct file_operations task_hist_raw_fops = {
+	.open = task_hist_raw_open,
+	.read = latency_hist_raw_read,
+	.mmap = latency_hist_raw_mmap,
+	.llseek = default_llseek,
+	.release = task_hist_raw_release,
+};
+
+static int wakeup_task_hist_add_pid(pid_t pid)
+{
+	struct task_hist *th = NULL;
+	struct hist_data *hist;
+	unsigned long flags;
+	char name[32];
+	int i;
+
+	for (i = 0; i < MAX_TASK_HISTS; i++) {
+		if (wakeup_task_hists[i].hist) {
+			if (wakeup_task_hists[i].pid == pid)
+				return -EEXIST;
+		} else if (!th) {
+			th = &wakeup_task_hists[i];
+		}
+	}
+	if (!th)
+		return -ENOSPC;
+
+	hist = hist_alloc();
+	if (!hist)
+		return -ENOMEM;
+
+	snprintf(name, sizeof(name), "task-%d", pid);
+	th->text = debugfs_create_file(name, 0444, wakeup_task_hist_dir, hist,
+	    &task_hist_fops);
+	strlcat(name, ".bin", sizeof(name));
+	th->raw = debugfs_create_file(name, 0444, wakeup_task_hist_dir, hist,
+	    &task_hist_raw_fops);
+
+	raw_spin_lock_irqsave(&wakeup_lock, flags);
+	th->pid = pid;
+	th->hist = hist;
+	raw_spin_unlock_irqrestore(&wakeup_lock, flags);
+
+	return 0;
+}
+
+static int wakeup_task_hist_remove_pid(pid_t pid)
+{
+	struct hist_data *hist;
+	unsigned long flags;
+	int i;
+
+	for (i = 0; i < MAX_TASK_HISTS; i++) {
+		struct task_hist *th = &wakeup_task_hists[i];
+
+		if (!th->hist || th->pid != pid)
+			continue;
+
+		raw_spin_lock_irqsave(&wakeup_lock, flags);
+		hist = th->hist;
+		th->hist = NULL;
+		raw_spin_unlock_irqrestore(&wakeup_lock, flags);
+
+		/*
+		 * New opens fail from here on, open files and mappings keep
+		 * the page until they are released.
+		 */
+		debugfs_remove(th->raw);
+		debugfs_remove(th->text);
+		task_hist_put(hist);
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+static ssize_t
+show_task_hists(struct file *file, char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	char buf[MAX_TASK_HISTS * 12 + 1];
+	int i, r = 0;
+
+	mutex_lock(&task_hist_mutex);
+	for (i = 0; i < MAX_TASK_HISTS; i++) {
+		if (wakeup_task_hists[i].hist)
+			r += snprintf(buf + r, sizeof(buf) - r, "%d\n",
+			    wakeup_task_hists[i].pid);
+	}
+	mutex_unlock(&task_hist_mutex);
+
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, r);
+}
+
+/* "<pid>" starts accounting a task, "-<pid>" stops it */
+static ssize_t do_task_hists(struct file *file, const char __user *ubuf,
+			     size_t cnt, loff_t *ppos)
+{
+	char buf[64];
+	bool remove = false;
+	char *p = buf;
+	int pid, ret;
+
+	if (cnt >= sizeof(buf))
+		return -EINVAL;
+
+	if (copy_from_user(&buf, ubuf, cnt))
+		return -EFAULT;
+
+	buf[cnt] = '\0';
+
+	if (*p == '-') {
+		remove = true;
+		p++;
+	}
+
+	if (kstrtoint(strstrip(p), 10, &pid) || pid <= 0)
+		return -EINVAL;
+
+	mutex_lock(&task_hist_mutex);
+	if (remove)
+		ret = wakeup_task_hist_remove_pid(pid);
+	else
+		ret = wakeup_task_hist_add_pid(pid);
+	mutex_unlock(&task_hist_mutex);
+
+	return ret ? ret : cnt;
+}
+#endif
+
 #if defined(CONFIG_WAKEUP_LATENCY_HIST) || \
 	defined(CONFIG_MISSED_TIMER_OFFSETS_HIST)
 static ssize_t
@@ -502,6 +986,7 @@ show_maxlatproc(struct file *file, char __user *ubuf, size_t cnt, loff_t *ppos)
 	int strmaxlen = (TASK_COMM_LEN * 2) + (8 * 8);
 	unsigned long long t;
 	unsigned long usecs, secs;
+	char latstr[32], offstr[32];
 	char *buf;
 
 	if (mp->pid == -1 || mp->current_pid == -1) {
@@ -517,9 +1002,11 @@ show_maxlatproc(struct file *file, char __user *ubuf, size_t cnt, loff_t *ppos)
 	t = ns2usecs(mp->timestamp);
 	usecs = do_div(t, USEC_PER_SEC);
 	secs = (unsigned long) t;
+	hist_snprint_usecs(latstr, sizeof(latstr), mp->latency);
+	hist_snprint_usecs(offstr, sizeof(offstr), mp->timeroffset);
 	r = snprintf(buf, strmaxlen,
-	    "%d %d %ld (%ld) %s <- %d %d %s %lu.%06lu\n", mp->pid,
-	    MAX_RT_PRIO-1 - mp->prio, mp->latency, mp->timeroffset, mp->comm,
+	    "%d %d %s (%s) %s <- %d %d %s %lu.%06lu\n", mp->pid,
+	    MAX_RT_PRIO-1 - mp->prio, latstr, offstr, mp->comm,
 	    mp->current_pid, MAX_RT_PRIO-1 - mp->current_prio, mp->current_comm,
 	    secs, usecs);
 	r = simple_read_from_buffer(ubuf, cnt, ppos, buf, r);
@@ -624,6 +1111,54 @@ do_enable(struct file *file, const char __user *ubuf, size_t cnt, loff_t *ppos)
 			}
 			break;
 #endif
+#ifdef CONFIG_WAKEUP_LATENCY_HIST
+		case WAKEUP_BREAKDOWN:
+			ret = register_trace_irq_handler_entry(
+			    probe_breakdown_irq_entry, NULL);
+			if (ret) {
+				pr_info("wakeup trace: Couldn't assign "
+				    "probe_breakdown_irq_entry "
+				    "to trace_irq_handler_entry\n");
+				return ret;
+			}
+			ret = register_trace_softirq_entry(
+			    probe_breakdown_softirq_entry, NULL);
+			if (ret) {
+				pr_info("wakeup trace: Couldn't assign "
+				    "probe_breakdown_softirq_entry "
+				    "to trace_softirq_entry\n");
+				unregister_trace_irq_handler_entry(
+				    probe_breakdown_irq_entry, NULL);
+				return ret;
+			}
+			ret = register_trace_sched_wakeup(
+			    probe_breakdown_wakeup, NULL);
+			if (ret) {
+				pr_info("wakeup trace: Couldn't assign "
+				    "probe_breakdown_wakeup "
+				    "to trace_sched_wakeup\n");
+				unregister_trace_irq_handler_entry(
+				    probe_breakdown_irq_entry, NULL);
+				unregister_trace_softirq_entry(
+				    probe_breakdown_softirq_entry, NULL);
+				return ret;
+			}
+			ret = register_trace_sched_switch(
+			    probe_breakdown_switch, NULL);
+			if (ret) {
+				pr_info("wakeup trace: Couldn't assign "
+				    "probe_breakdown_switch "
+				    "to trace_sched_switch\n");
+				unregister_trace_irq_handler_entry(
+				    probe_breakdown_irq_entry, NULL);
+				unregister_trace_softirq_entry(
+				    probe_breakdown_softirq_entry, NULL);
+				unregister_trace_sched_wakeup(
+				    probe_breakdown_wakeup, NULL);
+				return ret;
+			}
+			break;
+#endif
 #ifdef CONFIG_MISSED_TIMER_OFFSETS_HIST
 		case MISSED_TIMER_OFFSETS:
 			ret = register_trace_hrtimer_interrupt(
@@ -696,6 +1231,16 @@ do_enable(struct file *file, const char __user *ubuf, size_t cnt, loff_t *ppos)
 			timerandwakeup_enabled_data.enabled = 0;
 #endif
 			break;
+		case WAKEUP_BREAKDOWN:
+			unregister_trace_irq_handler_entry(
+			    probe_breakdown_irq_entry, NULL);
+			unregister_trace_softirq_entry(
+			    probe_breakdown_softirq_entry, NULL);
+			unregister_trace_sched_wakeup(
+			    probe_breakdown_wakeup, NULL);
+			unregister_trace_sched_switch(
+			    probe_breakdown_switch, NULL);
+			break;
 #endif
 #ifdef CONFIG_MISSED_TIMER_OFFSETS_HIST
 		case MISSED_TIMER_OFFSETS:
@@ -739,6 +1284,53 @@ static const struct file_operations maxlatproc_fops = {
 };
 #endif
 
+#ifdef CONFIG_WAKEUP_LATENCY_HIST
+static const struct file_operations task_hists_fops = {
+	.open = tracing_open_generic,
+	.read = show_task_hists,
+	.write = do_task_hists,
+};
+
+static int breakdown_max_show(struct seq_file *m, void *v)
+{
+	struct breakdown_max_data *bm = m->private;
+	char buf[32];
+	unsigned int i;
+
+	if (bm->pid < 0)
+		return 0;
+
+	hist_snprint_usecs(buf, sizeof(buf), bm->total);
+	seq_printf(m, "%d %s %s\n", bm->pid, bm->comm, buf);
+	for (i = 0; i < NR_BREAKDOWN_STAGES; i++) {
+		if (!(bm->stages & BIT(i)))
+			continue;
+		hist_snprint_usecs(buf, sizeof(buf), bm->stage[i]);
+		seq_printf(m, "%s %s\n", breakdown_stage_names[i], buf);
+	}
+	seq_printf(m, "preempted %d %s\n", bm->prev_pid, bm->prev_comm);
+	for (i = 0; i < bm->nr_entries; i++) {
+		if (bm->entries[i] == ULONG_MAX)
+			break;
+		seq_printf(m, " %pS\n", (void *)bm->entries[i]);
+	}
+
+	return 0;
+}
+
+static int breakdown_max_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, breakdown_max_show, inode->i_private);
+}
+
+static const struct file_operations breakdown_max_fops = {
+	.open = breakdown_max_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+#endif
+
 #if defined(CONFIG_INTERRUPT_OFF_HIST) || defined(CONFIG_PREEMPT_OFF_HIST)
 static notrace void probe_preemptirqsoff_hist(void *v, int reason,
 	int starthist)
@@ -793,8 +1385,7 @@ static notrace void probe_preemptirqsoff_hist(void *v, int reason,
 			stop = ftrace_now(cpu);
 			time_set++;
 			if (start) {
-				long latency = ((long) (stop - start)) /
-				    NSECS_PER_USECS;
+				s64 latency = (s64) (stop - start);
 
 				latency_hist(IRQSOFF_LATENCY, cpu, latency, 0,
 				    stop, NULL);
@@ -811,8 +1402,7 @@ static notrace void probe_preemptirqsoff_hist(void *v, int reason,
 			if (!(time_set++))
 				stop = ftrace_now(cpu);
 			if (start) {
-				long latency = ((long) (stop - start)) /
-				    NSECS_PER_USECS;
+				s64 latency = (s64) (stop - start);
 
 				latency_hist(PREEMPTOFF_LATENCY, cpu, latency,
 				    0, stop, NULL);
@@ -830,8 +1420,7 @@ static notrace void probe_preemptirqsoff_hist(void *v, int reason,
 			if (!time_set)
 				stop = ftrace_now(cpu);
 			if (start) {
-				long latency = ((long) (stop - start)) /
-				    NSECS_PER_USECS;
+				s64 latency = (s64) (stop - start);
 
 				latency_hist(PREEMPTIRQSOFF_LATENCY, cpu,
 				    latency, 0, stop, NULL);
@@ -844,7 +1433,6 @@ static notrace void probe_preemptirqsoff_hist(void *v, int reason,
 #endif
 
 #ifdef CONFIG_WAKEUP_LATENCY_HIST
-static DEFINE_RAW_SPINLOCK(wakeup_lock);
 static notrace void probe_sched_migrate_task(void *v, struct task_struct *task,
 	int cpu)
 {
@@ -911,7 +1499,7 @@ static notrace void probe_wakeup_latency_hist_stop(void *v,
 {
 	unsigned long flags;
 	int cpu = task_cpu(next);
-	long latency;
+	s64 latency;
 	cycle_t stop;
 	struct task_struct *cpu_wakeup_task;
 
@@ -945,8 +1533,7 @@ static notrace void probe_wakeup_latency_hist_stop(void *v,
 	 */
 	stop = ftrace_now(raw_smp_processor_id());
 
-	latency = ((long) (stop - next->preempt_timestamp_hist)) /
-	    NSECS_PER_USECS;
+	latency = (s64) (stop - next->preempt_timestamp_hist);
 
 	if (per_cpu(wakeup_sharedprio, cpu)) {
 		latency_hist(WAKEUP_LATENCY_SHAREDPRIO, cpu, latency, 0, stop,
@@ -972,6 +1559,162 @@ out_reset:
 out:
 	raw_spin_unlock_irqrestore(&wakeup_lock, flags);
 }
+
+static notrace void probe_breakdown_irq_entry(void *v, int irq,
+	struct irqaction *action)
+{
+	this_cpu_write(breakdown_hardirq_stamp,
+	    ftrace_now(raw_smp_processor_id()));
+}
+
+static notrace void probe_breakdown_softirq_entry(void *v,
+	unsigned int vec_nr)
+{
+	this_cpu_write(breakdown_softirq_stamp,
+	    ftrace_now(raw_smp_processor_id()));
+}
+
+/* Was the chain started by a wakeup from hard interrupt context? */
+static inline bool breakdown_hardirq_wakeup(u64 *chain)
+{
+	return chain[CHAIN_IRQ] && chain[CHAIN_THREAD_WAKE] == chain[CHAIN_WAKE];
+}
+
+/*
+ * Record how @p got woken: directly from a hard interrupt, from a softirq,
+ * or by a task which was itself woken from a hard interrupt, typically a
+ * threaded handler. The latter passes its own hops on to @p.
+ */
+static notrace void probe_breakdown_wakeup(void *v, struct task_struct *p)
+{
+	u64 *chain = p->wakeup_chain;
+	u64 *waker = current->wakeup_chain;
+	u64 now = ftrace_now(raw_smp_processor_id());
+
+	BUILD_BUG_ON(ARRAY_SIZE(p->wakeup_chain) != NR_CHAIN_HOPS);
+
+	memset(chain, 0, sizeof(p->wakeup_chain));
+	chain[CHAIN_WAKE] = now;
+
+	if (in_irq()) {
+		chain[CHAIN_IRQ] = this_cpu_read(breakdown_hardirq_stamp);
+		chain[CHAIN_THREAD_WAKE] = now;
+		return;
+	}
+
+	if (in_serving_softirq())
+		chain[CHAIN_SOFTIRQ] = this_cpu_read(breakdown_softirq_stamp);
+
+	if (p != current && breakdown_hardirq_wakeup(waker) &&
+	    waker[CHAIN_RUN]) {
+		chain[CHAIN_IRQ] = waker[CHAIN_IRQ];
+		chain[CHAIN_THREAD_WAKE] = waker[CHAIN_THREAD_WAKE];
+		chain[CHAIN_THREAD_RUN] = waker[CHAIN_RUN];
+		/* a stale softirq stamp from before the thread ran */
+		if (chain[CHAIN_SOFTIRQ] < chain[CHAIN_THREAD_RUN])
+			chain[CHAIN_SOFTIRQ] = 0;
+	} else if (chain[CHAIN_SOFTIRQ]) {
+		/* softirq processing on interrupt exit */
+		chain[CHAIN_IRQ] = this_cpu_read(breakdown_hardirq_stamp);
+		if (chain[CHAIN_IRQ] > chain[CHAIN_SOFTIRQ])
+			chain[CHAIN_IRQ] = 0;
+	}
+}
+
+static inline void breakdown_stage(s64 *stage, unsigned int *stages,
+	int nr, u64 end, u64 start)
+{
+	stage[nr] = (s64) (end - start);
+	*stages |= BIT(nr);
+}
+
+static notrace void probe_breakdown_switch(void *v,
+	bool preempt, struct task_struct *prev, struct task_struct *next)
+{
+	u64 *chain = next->wakeup_chain;
+	s64 stage[NR_BREAKDOWN_STAGES];
+	struct breakdown_max_data *bm;
+	unsigned int stages = 0;
+	int cpu = raw_smp_processor_id();
+	int i;
+	s64 total;
+	u64 now;
+
+	if (!chain[CHAIN_WAKE] || chain[CHAIN_RUN])
+		return;
+
+	now = ftrace_now(cpu);
+	chain[CHAIN_RUN] = now;
+
+	if (!chain[CHAIN_IRQ])
+		return;
+
+	if (wakeup_pid) {
+		if (likely(wakeup_pid != task_pid_nr(next)))
+			return;
+	} else if (likely(!rt_task(next))) {
+		return;
+	}
+
+	if (breakdown_hardirq_wakeup(chain)) {
+		breakdown_stage(stage, &stages, BREAKDOWN_HARDIRQ,
+		    chain[CHAIN_WAKE], chain[CHAIN_IRQ]);
+	} else if (chain[CHAIN_THREAD_WAKE]) {
+		u64 thread_end = chain[CHAIN_SOFTIRQ] ?: chain[CHAIN_WAKE];
+
+		breakdown_stage(stage, &stages, BREAKDOWN_HARDIRQ,
+		    chain[CHAIN_THREAD_WAKE], chain[CHAIN_IRQ]);
+		breakdown_stage(stage, &stages, BREAKDOWN_IRQTHREAD_SCHED,
+		    chain[CHAIN_THREAD_RUN], chain[CHAIN_THREAD_WAKE]);
+		breakdown_stage(stage, &stages, BREAKDOWN_IRQTHREAD,
+		    thread_end, chain[CHAIN_THREAD_RUN]);
+		if (chain[CHAIN_SOFTIRQ])
+			breakdown_stage(stage, &stages, BREAKDOWN_SOFTIRQ,
+			    chain[CHAIN_WAKE], chain[CHAIN_SOFTIRQ]);
+	} else {
+		breakdown_stage(stage, &stages, BREAKDOWN_HARDIRQ,
+		    chain[CHAIN_SOFTIRQ], chain[CHAIN_IRQ]);
+		breakdown_stage(stage, &stages, BREAKDOWN_SOFTIRQ,
+		    chain[CHAIN_WAKE], chain[CHAIN_SOFTIRQ]);
+	}
+	breakdown_stage(stage, &stages, BREAKDOWN_SCHED,
+	    now, chain[CHAIN_WAKE]);
+
+	for (i = 0; i < NR_BREAKDOWN_STAGES; i++) {
+		struct hist_data *hist = per_cpu(wakeup_breakdown_hist, cpu)[i];
+
+		if ((stages & BIT(i)) && hist &&
+		    atomic_read(&hist->hist_mode))
+			hist_add(hist, stage[i]);
+	}
+
+	/* Keep the worst offender, with the stack it preempted. */
+	total = (s64) (now - chain[CHAIN_IRQ]);
+	bm = this_cpu_ptr(&wakeup_breakdown_max);
+	if (total <= bm->total)
+		return;
+
+	bm->total = total;
+	memcpy(bm->stage, stage, sizeof(bm->stage));
+	bm->stages = stages;
+	bm->pid = task_pid_nr(next);
+	bm->prev_pid = task_pid_nr(prev);
+	strncpy(bm->comm, next->comm, sizeof(bm->comm));
+	strncpy(bm->prev_comm, prev->comm, sizeof(bm->prev_comm));
+	bm->nr_entries = 0;
+#ifdef CONFIG_STACKTRACE
+	{
+		struct stack_trace trace = {
+			.max_entries = BREAKDOWN_STACK_DEPTH,
+			.entries = bm->entries,
+			.skip = 2,
+		};
+
+		save_stack_trace(&trace);
+		bm->nr_entries = trace.nr_entries;
+	}
+#endif
+}
 #endif
 
 #ifdef CONFIG_MISSED_TIMER_OFFSETS_HIST
@@ -983,7 +1726,7 @@ static notrace void probe_hrtimer_interrupt(void *v, int cpu,
 	    (task->prio < curr->prio ||
 	    (task->prio == curr->prio &&
 	    !cpumask_test_cpu(cpu, &task->cpus_allowed)))) {
-		long latency;
+		s64 latency;
 		cycle_t now;
 
 		if (missed_timer_offsets_pid) {
@@ -993,7 +1736,7 @@ static notrace void probe_hrtimer_interrupt(void *v, int cpu,
 		}
 
 		now = ftrace_now(cpu);
-		latency = (long) div_s64(-latency_ns, NSECS_PER_USECS);
+		latency = -latency_ns;
 		latency_hist(MISSED_TIMER_OFFSETS, cpu, latency, latency, now,
 		    task);
 #ifdef CONFIG_WAKEUP_LATENCY_HIST
@@ -1009,11 +1752,11 @@ static __init int latency_hist_init(void)
 	struct dentry *dentry;
 #ifdef CONFIG_WAKEUP_LATENCY_HIST
 	struct dentry *dentry_sharedprio;
+	int j;
 #endif
 	struct dentry *entry;
 	struct dentry *enable_root;
 	int i = 0;
-	struct hist_data *my_hist;
 	char name[64];
 	char *cpufmt = "CPU%d";
 #if defined(CONFIG_WAKEUP_LATENCY_HIST) || \
@@ -1030,11 +1773,7 @@ static __init int latency_hist_init(void)
 	dentry = debugfs_create_dir(irqsoff_hist_dir, latency_hist_root);
 	for_each_possible_cpu(i) {
 		sprintf(name, cpufmt, i);
-		entry = debugfs_create_file(name, 0444, dentry,
-		    &per_cpu(irqsoff_hist, i), &latency_hist_fops);
-		my_hist = &per_cpu(irqsoff_hist, i);
-		atomic_set(&my_hist->hist_mode, 1);
-		my_hist->min_lat = LONG_MAX;
+		per_cpu(irqsoff_hist, i) = hist_create(dentry, name);
 	}
 	entry = debugfs_create_file("reset", 0644, dentry,
 	    (void *)IRQSOFF_LATENCY, &latency_hist_reset_fops);
@@ -1045,11 +1784,7 @@ static __init int latency_hist_init(void)
 	    latency_hist_root);
 	for_each_possible_cpu(i) {
 		sprintf(name, cpufmt, i);
-		entry = debugfs_create_file(name, 0444, dentry,
-		    &per_cpu(preemptoff_hist, i), &latency_hist_fops);
-		my_hist = &per_cpu(preemptoff_hist, i);
-		atomic_set(&my_hist->hist_mode, 1);
-		my_hist->min_lat = LONG_MAX;
+		per_cpu(preemptoff_hist, i) = hist_create(dentry, name);
 	}
 	entry = debugfs_create_file("reset", 0644, dentry,
 	    (void *)PREEMPTOFF_LATENCY, &latency_hist_reset_fops);
@@ -1060,11 +1795,7 @@ static __init int latency_hist_init(void)
 	    latency_hist_root);
 	for_each_possible_cpu(i) {
 		sprintf(name, cpufmt, i);
-		entry = debugfs_create_file(name, 0444, dentry,
-		    &per_cpu(preemptirqsoff_hist, i), &latency_hist_fops);
-		my_hist = &per_cpu(preemptirqsoff_hist, i);
-		atomic_set(&my_hist->hist_mode, 1);
-		my_hist->min_lat = LONG_MAX;
+		per_cpu(preemptirqsoff_hist, i) = hist_create(dentry, name);
 	}
 	entry = debugfs_create_file("reset", 0644, dentry,
 	    (void *)PREEMPTIRQSOFF_LATENCY, &latency_hist_reset_fops);
@@ -1084,19 +1815,9 @@ static __init int latency_hist_init(void)
 	for_each_possible_cpu(i) {
 		sprintf(name, cpufmt, i);
 
-		entry = debugfs_create_file(name, 0444, dentry,
-		    &per_cpu(wakeup_latency_hist, i),
-		    &latency_hist_fops);
-		my_hist = &per_cpu(wakeup_latency_hist, i);
-		atomic_set(&my_hist->hist_mode, 1);
-		my_hist->min_lat = LONG_MAX;
-
-		entry = debugfs_create_file(name, 0444, dentry_sharedprio,
-		    &per_cpu(wakeup_latency_hist_sharedprio, i),
-		    &latency_hist_fops);
-		my_hist = &per_cpu(wakeup_latency_hist_sharedprio, i);
-		atomic_set(&my_hist->hist_mode, 1);
-		my_hist->min_lat = LONG_MAX;
+		per_cpu(wakeup_latency_hist, i) = hist_create(dentry, name);
+
+		per_cpu(wakeup_latency_hist_sharedprio, i) = hist_create(dentry_sharedprio, name);
 
 		sprintf(name, cpufmt_maxlatproc, i);
 
@@ -1112,6 +1833,9 @@ static __init int latency_hist_init(void)
 	}
 	entry = debugfs_create_file("pid", 0644, dentry,
 	    (void *)&wakeup_pid, &pid_fops);
+	wakeup_task_hist_dir = dentry;
+	entry = debugfs_create_file("tasks", 0644, dentry, NULL,
+	    &task_hists_fops);
 	entry = debugfs_create_file("reset", 0644, dentry,
 	    (void *)WAKEUP_LATENCY, &latency_hist_reset_fops);
 	entry = debugfs_create_file("reset", 0644, dentry_sharedprio,
@@ -1119,6 +1843,30 @@ static __init int latency_hist_init(void)
 	entry = debugfs_create_file("wakeup", 0644,
 	    enable_root, (void *)&wakeup_latency_enabled_data,
 	    &enable_fops);
+
+	dentry = debugfs_create_dir(wakeup_breakdown_dir, latency_hist_root);
+	for (j = 0; j < NR_BREAKDOWN_STAGES; j++) {
+		struct dentry *stage_dir;
+
+		stage_dir = debugfs_create_dir(breakdown_stage_names[j],
+		    dentry);
+		for_each_possible_cpu(i) {
+			sprintf(name, cpufmt, i);
+			per_cpu(wakeup_breakdown_hist, i)[j] =
+			    hist_create(stage_dir, name);
+		}
+	}
+	for_each_possible_cpu(i) {
+		wakeup_breakdown_reset(i);
+		sprintf(name, cpufmt_maxlatproc, i);
+		entry = debugfs_create_file(name, 0444, dentry,
+		    &per_cpu(wakeup_breakdown_max, i), &breakdown_max_fops);
+	}
+	entry = debugfs_create_file("reset", 0644, dentry,
+	    (void *)WAKEUP_BREAKDOWN, &latency_hist_reset_fops);
+	entry = debugfs_create_file("wakeup_breakdown", 0644,
+	    enable_root, (void *)&wakeup_breakdown_enabled_data,
+	    &enable_fops);
 #endif
 
 #ifdef CONFIG_MISSED_TIMER_OFFSETS_HIST
@@ -1126,11 +1874,7 @@ static __init int latency_hist_init(void)
 	    latency_hist_root);
 	for_each_possible_cpu(i) {
 		sprintf(name, cpufmt, i);
-		entry = debugfs_create_file(name, 0444, dentry,
-		    &per_cpu(missed_timer_offsets, i), &latency_hist_fops);
-		my_hist = &per_cpu(missed_timer_offsets, i);
-		atomic_set(&my_hist->hist_mode, 1);
-		my_hist->min_lat = LONG_MAX;
+		per_cpu(missed_timer_offsets, i) = hist_create(dentry, name);
 
 		sprintf(name, cpufmt_maxlatproc, i);
 		mp = &per_cpu(missed_timer_offsets_maxlatproc, i);
@@ -1153,12 +1897,7 @@ static __init int latency_hist_init(void)
 	    latency_hist_root);
 	for_each_possible_cpu(i) {
 		sprintf(name, cpufmt, i);
-		entry = debugfs_create_file(name, 0444, dentry,
-		    &per_cpu(timerandwakeup_latency_hist, i),
-		    &latency_hist_fops);
-		my_hist = &per_cpu(timerandwakeup_latency_hist, i);
-		atomic_set(&my_hist->hist_mode, 1);
-		my_hist->min_lat = LONG_MAX;
+		per_cpu(timerandwakeup_latency_hist, i) = hist_create(dentry, name);
 
 		sprintf(name, cpufmt_maxlatproc, i);
 		mp = &per_cpu(timerandwakeup_maxlatproc, i);
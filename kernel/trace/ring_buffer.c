@@ -3,6 +3,7 @@
  *
  * Copyright (C) 2008 Steven Rostedt <srostedt@redhat.com>
  */
+#include <uapi/linux/trace_mmap.h>
 #include <linux/trace_events.h>
 #include <linux/ring_buffer.h>
 #include <linux/trace_clock.h>
@@ -300,6 +301,7 @@ struct buffer_page {
 	unsigned	 read;		/* index for next read */
 	local_t		 entries;	/* entries on this page */
 	unsigned long	 real_end;	/* real end of data */
+	unsigned	 id;		/* ID for user space mapping */
 	struct buffer_data_page *page;	/* Actual data page */
 };
 
@@ -453,10 +455,19 @@ struct ring_buffer_per_cpu {
 	local_t				dropped_events;
 	local_t				committing;
 	local_t				commits;
+	local_t				pages_touched;
+	unsigned long			pages_read;
 	unsigned long			read;
 	unsigned long			read_bytes;
 	u64				write_stamp;
 	u64				read_stamp;
+	/* smallest full watermark of the waiters, in percent */
+	size_t				shortest_full;
+	/* user space mapping of the buffer, see ring_buffer_map() */
+	struct mutex			mapping_lock;
+	int				mapped;
+	unsigned long			*subbuf_ids;	/* ID to page addr */
+	struct trace_buffer_meta	*meta_page;
 	/* ring buffer pages to update, > 0 to add, < 0 to remove */
 	int				nr_pages_to_update;
 	struct list_head		new_pages; /* new pages to add */
@@ -513,17 +524,79 @@ static void rb_wake_up_waiters(struct irq_work *work)
 	}
 }
 
+/**
+ * ring_buffer_nr_pages - get the number of buffer pages in the ring buffer
+ * @buffer: The ring_buffer to get the number of pages from
+ * @cpu: The cpu of the ring_buffer to get the number of pages from
+ *
+ * Returns the number of pages used by a per_cpu buffer of the ring buffer.
+ */
+size_t ring_buffer_nr_pages(struct ring_buffer *buffer, int cpu)
+{
+	return buffer->buffers[cpu]->nr_pages;
+}
+
+/**
+ * ring_buffer_nr_dirty_pages - get the number of used pages in the ring buffer
+ * @buffer: The ring_buffer to get the number of pages from
+ * @cpu: The cpu of the ring_buffer to get the number of pages from
+ *
+ * Returns the number of pages that have content in the ring buffer.
+ */
+size_t ring_buffer_nr_dirty_pages(struct ring_buffer *buffer, int cpu)
+{
+	size_t read;
+	size_t cnt;
+
+	read = buffer->buffers[cpu]->pages_read;
+	cnt = local_read(&buffer->buffers[cpu]->pages_touched);
+	/* The reader can read an empty page, but not more than that */
+	if (cnt < read) {
+		WARN_ON_ONCE(read > cnt + 1);
+		return 0;
+	}
+
+	return cnt - read;
+}
+
+/*
+ * Is at least @full percent of the per cpu buffer filled? A @full of
+ * zero means any data will do.
+ */
+static bool full_hit(struct ring_buffer *buffer, int cpu, int full)
+{
+	size_t nr_pages;
+	size_t dirty;
+
+	nr_pages = ring_buffer_nr_pages(buffer, cpu);
+	if (!nr_pages || !full)
+		return true;
+
+	dirty = ring_buffer_nr_dirty_pages(buffer, cpu);
+
+	return (dirty * 100) > (full * nr_pages);
+}
+
+/* Record the smallest watermark of the waiters, for the writer to test */
+static void rb_set_shortest_full(struct ring_buffer_per_cpu *cpu_buffer,
+				 int full)
+{
+	if (!cpu_buffer->shortest_full || cpu_buffer->shortest_full > full)
+		cpu_buffer->shortest_full = full;
+}
+
 /**
  * ring_buffer_wait - wait for input to the ring buffer
  * @buffer: buffer to wait on
  * @cpu: the cpu buffer to wait on
- * @full: wait until a full page is available, if @cpu != RING_BUFFER_ALL_CPUS
+ * @full: wait until this percentage of pages is available,
+ *	  if @cpu != RING_BUFFER_ALL_CPUS
  *
  * If @cpu == RING_BUFFER_ALL_CPUS then the task will wake up as soon
  * as data is added to any of the @buffer's cpu buffers. Otherwise
  * it will wait for data to be added to a specific cpu buffer.
  */
-int ring_buffer_wait(struct ring_buffer *buffer, int cpu, bool full)
+int ring_buffer_wait(struct ring_buffer *buffer, int cpu, int full)
 {
 	struct ring_buffer_per_cpu *uninitialized_var(cpu_buffer);
 	DEFINE_WAIT(wait);
@@ -538,7 +611,7 @@ int ring_buffer_wait(struct ring_buffer *buffer, int cpu, bool full)
 	if (cpu == RING_BUFFER_ALL_CPUS) {
 		work = &buffer->irq_work;
 		/* Full only makes sense on per cpu reads */
-		full = false;
+		full = 0;
 	} else {
 		if (!cpumask_test_cpu(cpu, buffer->cpumask))
 			return -ENODEV;
@@ -590,15 +663,18 @@ int ring_buffer_wait(struct ring_buffer *buffer, int cpu, bool full)
 		    !ring_buffer_empty_cpu(buffer, cpu)) {
 			unsigned long flags;
 			bool pagebusy;
+			bool done;
 
 			if (!full)
 				break;
 
 			raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
 			pagebusy = cpu_buffer->reader_page == cpu_buffer->commit_page;
+			done = !pagebusy && full_hit(buffer, cpu, full);
+			rb_set_shortest_full(cpu_buffer, full);
 			raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
 
-			if (!pagebusy)
+			if (done)
 				break;
 		}
 
@@ -619,6 +695,8 @@ int ring_buffer_wait(struct ring_buffer *buffer, int cpu, bool full)
  * @cpu: the cpu buffer to wait on
  * @filp: the file descriptor
  * @poll_table: The poll descriptor
+ * @full: wait until this percentage of pages is available,
+ *	  if @cpu != RING_BUFFER_ALL_CPUS
  *
  * If @cpu == RING_BUFFER_ALL_CPUS then the task will wake up as soon
  * as data is added to any of the @buffer's cpu buffers. Otherwise
@@ -628,14 +706,15 @@ int ring_buffer_wait(struct ring_buffer *buffer, int cpu, bool full)
  * zero otherwise.
  */
 int ring_buffer_poll_wait(struct ring_buffer *buffer, int cpu,
-			  struct file *filp, poll_table *poll_table)
+			  struct file *filp, poll_table *poll_table, int full)
 {
 	struct ring_buffer_per_cpu *cpu_buffer;
 	struct rb_irq_work *work;
 
-	if (cpu == RING_BUFFER_ALL_CPUS)
+	if (cpu == RING_BUFFER_ALL_CPUS) {
 		work = &buffer->irq_work;
-	else {
+		full = 0;
+	} else {
 		if (!cpumask_test_cpu(cpu, buffer->cpumask))
 			return -EINVAL;
 
@@ -643,6 +722,23 @@ int ring_buffer_poll_wait(struct ring_buffer *buffer, int cpu,
 		work = &cpu_buffer->irq_work;
 	}
 
+	if (full) {
+		unsigned long flags;
+		bool pagebusy;
+		bool done;
+
+		poll_wait(filp, &work->full_waiters, poll_table);
+		work->full_waiters_pending = true;
+
+		raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+		pagebusy = cpu_buffer->reader_page == cpu_buffer->commit_page;
+		done = !pagebusy && full_hit(buffer, cpu, full);
+		rb_set_shortest_full(cpu_buffer, full);
+		raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+		return done ? POLLIN | POLLRDNORM : 0;
+	}
+
 	poll_wait(filp, &work->waiters, poll_table);
 	work->waiters_pending = true;
 	/*
@@ -1041,6 +1137,8 @@ static int rb_tail_page_update(struct ring_buffer_per_cpu *cpu_buffer,
 		unsigned long val = old_write & ~RB_WRITE_MASK;
 		unsigned long eval = old_entries & ~RB_WRITE_MASK;
 
+		local_inc(&cpu_buffer->pages_touched);
+
 		/*
 		 * This will only succeed if an interrupt did
 		 * not come in and change it. In which case, we
@@ -1224,6 +1322,7 @@ rb_allocate_cpu_buffer(struct ring_buffer *buffer, int nr_pages, int cpu)
 	init_irq_work(&cpu_buffer->irq_work.work, rb_wake_up_waiters);
 	init_waitqueue_head(&cpu_buffer->irq_work.waiters);
 	init_waitqueue_head(&cpu_buffer->irq_work.full_waiters);
+	mutex_init(&cpu_buffer->mapping_lock);
 
 	bpage = kzalloc_node(ALIGN(sizeof(*bpage), cache_line_size()),
 			    GFP_KERNEL, cpu_to_node(cpu));
@@ -1685,6 +1784,12 @@ int ring_buffer_resize(struct ring_buffer *buffer, unsigned long size,
 	/* prevent another thread from changing buffer sizes */
 	mutex_lock(&buffer->mutex);
 
+	/* A user space mapping takes the mutex to disable resizing */
+	if (atomic_read(&buffer->resize_disabled)) {
+		err = -EBUSY;
+		goto out_err;
+	}
+
 	if (cpu_id == RING_BUFFER_ALL_CPUS) {
 		/* calculate the pages to update */
 		for_each_buffer_cpu(buffer, cpu) {
@@ -2559,11 +2664,16 @@ rb_wakeups(struct ring_buffer *buffer, struct ring_buffer_per_cpu *cpu_buffer)
 		irq_work_queue(&cpu_buffer->irq_work.work);
 	}
 
+	if (!cpu_buffer->irq_work.full_waiters_pending)
+		return;
+
 	pagebusy = cpu_buffer->reader_page == cpu_buffer->commit_page;
 
-	if (!pagebusy && cpu_buffer->irq_work.full_waiters_pending) {
+	if (!pagebusy &&
+	    full_hit(buffer, cpu_buffer->cpu, cpu_buffer->shortest_full)) {
 		cpu_buffer->irq_work.wakeup_full = true;
 		cpu_buffer->irq_work.full_waiters_pending = false;
+		cpu_buffer->shortest_full = 0;
 		/* irq_work_queue() supplies it's own memory barriers */
 		irq_work_queue(&cpu_buffer->irq_work.work);
 	}
@@ -2738,33 +2848,22 @@ __rb_reserve_next(struct ring_buffer_per_cpu *cpu_buffer,
 	return event;
 }
 
+/*
+ * Reserve an event within a commit that has already been started.
+ * If @follow is set, the event comes after another one of the same
+ * batch and is stamped with the time stored in @ts instead of reading
+ * the clock again. Otherwise, the time used is stored in @ts if it is
+ * not NULL.
+ */
 static struct ring_buffer_event *
-rb_reserve_next_event(struct ring_buffer *buffer,
-		      struct ring_buffer_per_cpu *cpu_buffer,
-		      unsigned long length)
+__rb_reserve_next_event(struct ring_buffer_per_cpu *cpu_buffer,
+			unsigned long length, u64 *ts, bool follow)
 {
 	struct ring_buffer_event *event;
 	struct rb_event_info info;
 	int nr_loops = 0;
 	u64 diff;
 
-	rb_start_commit(cpu_buffer);
-
-#ifdef CONFIG_RING_BUFFER_ALLOW_SWAP
-	/*
-	 * Due to the ability to swap a cpu buffer from a buffer
-	 * it is possible it was swapped before we committed.
-	 * (committing stops a swap). We check for it here and
-	 * if it happened, we have to fail the write.
-	 */
-	barrier();
-	if (unlikely(ACCESS_ONCE(cpu_buffer->buffer) != buffer)) {
-		local_dec(&cpu_buffer->committing);
-		local_dec(&cpu_buffer->commits);
-		return NULL;
-	}
-#endif
-
 	info.length = rb_calculate_event_length(length);
  again:
 	info.add_timestamp = 0;
@@ -2780,19 +2879,30 @@ rb_reserve_next_event(struct ring_buffer *buffer,
 	 * Bail!
 	 */
 	if (RB_WARN_ON(cpu_buffer, ++nr_loops > 1000))
-		goto out_fail;
+		return NULL;
 
-	info.ts = rb_time_stamp(cpu_buffer->buffer);
-	diff = info.ts - cpu_buffer->write_stamp;
+	/*
+	 * The events following the first one of a batch are never the
+	 * commit event, so their delta would be zeroed anyway. Stamp them
+	 * with the time of the first one: that saves the clock read, and
+	 * they never need a time extend of their own. If one had to move
+	 * to a new page, read the clock again for the page time stamp.
+	 */
+	if (follow && nr_loops == 1) {
+		info.ts = *ts;
+	} else {
+		info.ts = rb_time_stamp(cpu_buffer->buffer);
+		diff = info.ts - cpu_buffer->write_stamp;
 
-	/* make sure this diff is calculated here */
-	barrier();
+		/* make sure this diff is calculated here */
+		barrier();
 
-	/* Did the write stamp get updated already? */
-	if (likely(info.ts >= cpu_buffer->write_stamp)) {
-		info.delta = diff;
-		if (unlikely(test_time_stamp(info.delta)))
-			rb_handle_timestamp(cpu_buffer, &info);
+		/* Did the write stamp get updated already? */
+		if (likely(info.ts >= cpu_buffer->write_stamp)) {
+			info.delta = diff;
+			if (unlikely(test_time_stamp(info.delta)))
+				rb_handle_timestamp(cpu_buffer, &info);
+		}
 	}
 
 	event = __rb_reserve_next(cpu_buffer, &info);
@@ -2803,6 +2913,46 @@ rb_reserve_next_event(struct ring_buffer *buffer,
 		goto again;
 	}
 
+	if (event && ts)
+		*ts = info.ts;
+
+	return event;
+}
+
+/*
+ * Due to the ability to swap a cpu buffer from a buffer
+ * it is possible it was swapped before we committed.
+ * (committing stops a swap). We check for it here and
+ * if it happened, we have to fail the write.
+ */
+static inline bool
+rb_start_commit_check(struct ring_buffer *buffer,
+		      struct ring_buffer_per_cpu *cpu_buffer)
+{
+	rb_start_commit(cpu_buffer);
+
+#ifdef CONFIG_RING_BUFFER_ALLOW_SWAP
+	barrier();
+	if (unlikely(ACCESS_ONCE(cpu_buffer->buffer) != buffer)) {
+		local_dec(&cpu_buffer->committing);
+		local_dec(&cpu_buffer->commits);
+		return false;
+	}
+#endif
+	return true;
+}
+
+static struct ring_buffer_event *
+rb_reserve_next_event(struct ring_buffer *buffer,
+		      struct ring_buffer_per_cpu *cpu_buffer,
+		      unsigned long length)
+{
+	struct ring_buffer_event *event;
+
+	if (!rb_start_commit_check(buffer, cpu_buffer))
+		return NULL;
+
+	event = __rb_reserve_next_event(cpu_buffer, length, NULL, false);
 	if (!event)
 		goto out_fail;
 
@@ -2871,6 +3021,112 @@ ring_buffer_lock_reserve(struct ring_buffer *buffer, unsigned long length)
 }
 EXPORT_SYMBOL_GPL(ring_buffer_lock_reserve);
 
+/**
+ * ring_buffer_lock_reserve_batch - reserve several events at once
+ * @buffer: the ring buffer to reserve from
+ * @lengths: the length of the data of each event (excluding event header)
+ * @events: filled in with the reserved events
+ * @nr: the number of events to reserve
+ *
+ * This is for tracers that emit several events in one go. The events
+ * are reserved back to back on the current CPU with a single preempt
+ * disable, recursion check and commit section. Only the first event
+ * reads the clock and carries a time delta; the others share its time
+ * stamp, which also means that at most one time extend is added for
+ * the whole batch.
+ *
+ * Returns the number of events reserved, which is less than @nr if the
+ * buffer filled up. If it is not zero, it must be paired with
+ * ring_buffer_unlock_commit_batch() with that number of events. The
+ * events of a batch can not be discarded with ring_buffer_discard_commit().
+ */
+int ring_buffer_lock_reserve_batch(struct ring_buffer *buffer,
+				   const unsigned long *lengths,
+				   struct ring_buffer_event **events, int nr)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	u64 ts = 0;
+	int cpu;
+	int i;
+
+	/* If we are tracing schedule, we don't want to recurse */
+	preempt_disable_notrace();
+
+	if (unlikely(atomic_read(&buffer->record_disabled)))
+		goto out;
+
+	cpu = raw_smp_processor_id();
+
+	if (unlikely(!cpumask_test_cpu(cpu, buffer->cpumask)))
+		goto out;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	if (unlikely(atomic_read(&cpu_buffer->record_disabled)))
+		goto out;
+
+	for (i = 0; i < nr; i++) {
+		if (unlikely(lengths[i] > BUF_MAX_DATA_SIZE))
+			goto out;
+	}
+
+	if (unlikely(trace_recursive_lock(cpu_buffer)))
+		goto out;
+
+	if (!rb_start_commit_check(buffer, cpu_buffer))
+		goto out_unlock;
+
+	for (i = 0; i < nr; i++) {
+		events[i] = __rb_reserve_next_event(cpu_buffer, lengths[i],
+						    &ts, i > 0);
+		if (!events[i])
+			break;
+	}
+
+	if (i)
+		return i;
+
+	rb_end_commit(cpu_buffer);
+ out_unlock:
+	trace_recursive_unlock(cpu_buffer);
+ out:
+	preempt_enable_notrace();
+	return 0;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_lock_reserve_batch);
+
+/**
+ * ring_buffer_unlock_commit_batch - commit a batch of reserved events
+ * @buffer: The buffer to commit to
+ * @events: The events returned by ring_buffer_lock_reserve_batch()
+ * @nr: The number of events ring_buffer_lock_reserve_batch() returned
+ *
+ * This commits all the events of the batch, does the reader wakeups
+ * once, and releases the locks taken by ring_buffer_lock_reserve_batch().
+ */
+int ring_buffer_unlock_commit_batch(struct ring_buffer *buffer,
+				    struct ring_buffer_event **events, int nr)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	int cpu = raw_smp_processor_id();
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	local_add(nr, &cpu_buffer->entries);
+	/* Only the first event of the batch can be the commit event */
+	rb_update_write_stamp(cpu_buffer, events[0]);
+	rb_end_commit(cpu_buffer);
+
+	rb_wakeups(buffer, cpu_buffer);
+
+	trace_recursive_unlock(cpu_buffer);
+
+	preempt_enable_notrace();
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_unlock_commit_batch);
+
 /*
  * Decrement the entries to the page that an event is on.
  * The event does not even need to exist, only the pointer
@@ -3624,6 +3880,7 @@ rb_get_reader_page(struct ring_buffer_per_cpu *cpu_buffer)
 	/* Finally update the reader page to the new head */
 	cpu_buffer->reader_page = reader;
 	cpu_buffer->reader_page->read = 0;
+	cpu_buffer->pages_read++;
 
 	if (overwrite != cpu_buffer->last_overrun) {
 		cpu_buffer->lost_events = overwrite - cpu_buffer->last_overrun;
@@ -4201,6 +4458,9 @@ rb_reset_cpu(struct ring_buffer_per_cpu *cpu_buffer)
 	local_set(&cpu_buffer->entries, 0);
 	local_set(&cpu_buffer->committing, 0);
 	local_set(&cpu_buffer->commits, 0);
+	local_set(&cpu_buffer->pages_touched, 0);
+	cpu_buffer->pages_read = 0;
+	cpu_buffer->shortest_full = 0;
 	cpu_buffer->read = 0;
 	cpu_buffer->read_bytes = 0;
 
@@ -4213,6 +4473,8 @@ rb_reset_cpu(struct ring_buffer_per_cpu *cpu_buffer)
 	rb_head_page_activate(cpu_buffer);
 }
 
+static void rb_update_meta_page(struct ring_buffer_per_cpu *cpu_buffer);
+
 /**
  * ring_buffer_reset_cpu - reset a ring buffer per CPU buffer
  * @buffer: The ring buffer to reset a per cpu buffer of
@@ -4243,6 +4505,10 @@ void ring_buffer_reset_cpu(struct ring_buffer *buffer, int cpu)
 
 	arch_spin_unlock(&cpu_buffer->lock);
 
+	/* Nothing is handed out to user space anymore */
+	if (cpu_buffer->mapped)
+		rb_update_meta_page(cpu_buffer);
+
  out:
 	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
 
@@ -4344,6 +4610,12 @@ int ring_buffer_swap_cpu(struct ring_buffer *buffer_a,
 	cpu_buffer_a = buffer_a->buffers[cpu];
 	cpu_buffer_b = buffer_b->buffers[cpu];
 
+	/* It's up to the callers to not try to swap mapped buffers */
+	if (WARN_ON_ONCE(cpu_buffer_a->mapped || cpu_buffer_b->mapped)) {
+		ret = -EBUSY;
+		goto out;
+	}
+
 	/* At least make sure the two buffers are somewhat the same */
 	if (cpu_buffer_a->nr_pages != cpu_buffer_b->nr_pages)
 		goto out;
@@ -4509,6 +4781,12 @@ int ring_buffer_read_page(struct ring_buffer *buffer,
 
 	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
 
+	/* User space owns the reader page of a mapped buffer */
+	if (cpu_buffer->mapped) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
 	reader = rb_get_reader_page(cpu_buffer);
 	if (!reader)
 		goto out_unlock;
@@ -4638,6 +4916,294 @@ int ring_buffer_read_page(struct ring_buffer *buffer,
 }
 EXPORT_SYMBOL_GPL(ring_buffer_read_page);
 
+/*
+ * A per cpu buffer can be mapped read only by user space: the first
+ * page of the mapping is a struct trace_buffer_meta, followed by all
+ * the sub-buffers (the ring buffer pages and the reader page) in ID
+ * order. User space then consumes the buffer by asking for a new
+ * reader page with ring_buffer_map_get_reader(), without any copy.
+ *
+ * While mapped, the set of pages of the buffer must not change, so it
+ * can not be resized, swapped, or read with ring_buffer_read_page().
+ */
+
+/* Must be called with the reader_lock held */
+static void rb_update_meta_page(struct ring_buffer_per_cpu *cpu_buffer)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+	struct buffer_page *reader = cpu_buffer->reader_page;
+
+	meta->reader.id = reader->id;
+	meta->reader.read = reader->read;
+	meta->reader.commit = rb_page_size(reader);
+
+	meta->entries = local_read(&cpu_buffer->entries);
+	meta->overrun = local_read(&cpu_buffer->overrun);
+	meta->read = cpu_buffer->read;
+}
+
+/* Must be called with the reader_lock held */
+static void rb_setup_ids_meta_page(struct ring_buffer_per_cpu *cpu_buffer,
+				   unsigned long *subbuf_ids)
+{
+	struct trace_buffer_meta *meta = cpu_buffer->meta_page;
+	struct buffer_page *first, *bpage;
+	unsigned id = 0;
+
+	subbuf_ids[id] = (unsigned long)cpu_buffer->reader_page->page;
+	cpu_buffer->reader_page->id = id++;
+
+	first = bpage = rb_set_head_page(cpu_buffer);
+	do {
+		if (WARN_ON(id > cpu_buffer->nr_pages))
+			break;
+
+		subbuf_ids[id] = (unsigned long)bpage->page;
+		bpage->id = id++;
+
+		rb_inc_page(cpu_buffer, &bpage);
+	} while (bpage != first);
+
+	cpu_buffer->subbuf_ids = subbuf_ids;
+
+	meta->meta_page_size = PAGE_SIZE;
+	meta->meta_struct_len = sizeof(*meta);
+	meta->subbuf_size = PAGE_SIZE;
+	meta->nr_subbufs = cpu_buffer->nr_pages + 1;
+
+	rb_update_meta_page(cpu_buffer);
+}
+
+static int rb_map_vma(struct ring_buffer_per_cpu *cpu_buffer,
+		      struct vm_area_struct *vma)
+{
+	unsigned long nr_pages, pgoff = vma->vm_pgoff;
+	unsigned long i;
+	void *addr;
+	int err;
+
+	if (vma->vm_flags & (VM_WRITE | VM_EXEC) ||
+	    !(vma->vm_flags & VM_MAYSHARE))
+		return -EPERM;
+
+	/* The meta page, then the ring buffer pages and the reader page */
+	nr_pages = vma_pages(vma);
+	if (!nr_pages || pgoff + nr_pages > cpu_buffer->nr_pages + 2)
+		return -EINVAL;
+
+	vma->vm_flags |= VM_DONTCOPY | VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	for (i = 0; i < nr_pages; i++, pgoff++) {
+		if (!pgoff)
+			addr = cpu_buffer->meta_page;
+		else
+			addr = (void *)cpu_buffer->subbuf_ids[pgoff - 1];
+
+		err = vm_insert_page(vma, vma->vm_start + i * PAGE_SIZE,
+				     virt_to_page(addr));
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+/**
+ * ring_buffer_map - map a per cpu buffer into user space
+ * @buffer: the buffer the cpu buffer belongs to
+ * @cpu: the cpu buffer to map
+ * @vma: the vma to insert the pages into, or NULL to only take another
+ *	 reference on an existing mapping (i.e. when the vma is split)
+ *
+ * Returns 0 on success, a negative error code otherwise. Each successful
+ * call must be paired with ring_buffer_unmap().
+ */
+int ring_buffer_map(struct ring_buffer *buffer, int cpu,
+		    struct vm_area_struct *vma)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	unsigned long *subbuf_ids;
+	unsigned long flags;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (cpu_buffer->mapped) {
+		if (vma)
+			err = rb_map_vma(cpu_buffer, vma);
+		if (!err)
+			cpu_buffer->mapped++;
+		goto unlock;
+	}
+
+	if (WARN_ON(!vma)) {
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	/* Keep the pages as they are while user space sees them */
+	mutex_lock(&buffer->mutex);
+	atomic_inc(&buffer->resize_disabled);
+	mutex_unlock(&buffer->mutex);
+
+	err = -ENOMEM;
+	cpu_buffer->meta_page = (void *)get_zeroed_page(GFP_KERNEL);
+	if (!cpu_buffer->meta_page)
+		goto out_resize;
+
+	subbuf_ids = kcalloc(cpu_buffer->nr_pages + 1, sizeof(*subbuf_ids),
+			     GFP_KERNEL);
+	if (!subbuf_ids)
+		goto out_meta;
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	rb_setup_ids_meta_page(cpu_buffer, subbuf_ids);
+	cpu_buffer->mapped = 1;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	err = rb_map_vma(cpu_buffer, vma);
+	if (!err)
+		goto unlock;
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	cpu_buffer->mapped = 0;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	kfree(cpu_buffer->subbuf_ids);
+	cpu_buffer->subbuf_ids = NULL;
+ out_meta:
+	free_page((unsigned long)cpu_buffer->meta_page);
+	cpu_buffer->meta_page = NULL;
+ out_resize:
+	atomic_dec(&buffer->resize_disabled);
+ unlock:
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_map);
+
+/**
+ * ring_buffer_unmap - drop a reference on a per cpu buffer mapping
+ * @buffer: the buffer the cpu buffer belongs to
+ * @cpu: the mapped cpu buffer
+ *
+ * The meta page is freed, and the buffer can be resized and read again,
+ * when the last reference is dropped.
+ */
+int ring_buffer_unmap(struct ring_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	unsigned long flags;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (!cpu_buffer->mapped) {
+		err = -ENODEV;
+		goto out;
+	}
+
+	if (--cpu_buffer->mapped)
+		goto out;
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+	cpu_buffer->mapped = 0;
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+
+	kfree(cpu_buffer->subbuf_ids);
+	cpu_buffer->subbuf_ids = NULL;
+	free_page((unsigned long)cpu_buffer->meta_page);
+	cpu_buffer->meta_page = NULL;
+
+	atomic_dec(&buffer->resize_disabled);
+ out:
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_unmap);
+
+/**
+ * ring_buffer_map_get_reader - hand out the next reader page to user space
+ * @buffer: the buffer the cpu buffer belongs to
+ * @cpu: the mapped cpu buffer
+ *
+ * The events handed out by the previous call are consumed, and the meta
+ * page is updated with the reader page and the range of events that
+ * user space can now read. If there is nothing new, that range is empty.
+ */
+int ring_buffer_map_get_reader(struct ring_buffer *buffer, int cpu)
+{
+	struct ring_buffer_per_cpu *cpu_buffer;
+	struct trace_buffer_meta *meta;
+	struct buffer_page *reader;
+	unsigned long flags;
+	int err = 0;
+
+	if (!cpumask_test_cpu(cpu, buffer->cpumask))
+		return -EINVAL;
+
+	cpu_buffer = buffer->buffers[cpu];
+
+	mutex_lock(&cpu_buffer->mapping_lock);
+
+	if (!cpu_buffer->mapped) {
+		err = -ENODEV;
+		goto out;
+	}
+
+	meta = cpu_buffer->meta_page;
+
+	raw_spin_lock_irqsave(&cpu_buffer->reader_lock, flags);
+
+	/*
+	 * Consume what was handed out. A whole page that the writer left
+	 * is accounted in one go, as ring_buffer_read_page() does.
+	 * Otherwise, walk the events to keep the counters right. If a
+	 * non mapped reader (i.e. trace_pipe) swapped the reader page in
+	 * the meantime, there is nothing left to consume.
+	 */
+	reader = cpu_buffer->reader_page;
+	if (reader->id == meta->reader.id) {
+		if (!reader->read && reader != cpu_buffer->commit_page &&
+		    meta->reader.commit == rb_page_size(reader)) {
+			cpu_buffer->read += rb_page_entries(reader);
+			cpu_buffer->read_bytes += BUF_PAGE_SIZE;
+			reader->read = rb_page_size(reader);
+		} else {
+			while (reader->read < meta->reader.commit)
+				rb_advance_reader(cpu_buffer);
+		}
+	}
+
+	/* Swap in the next page if this one is done */
+	rb_get_reader_page(cpu_buffer);
+
+	meta->reader.lost_events = cpu_buffer->lost_events;
+	cpu_buffer->lost_events = 0;
+
+	rb_update_meta_page(cpu_buffer);
+
+	raw_spin_unlock_irqrestore(&cpu_buffer->reader_lock, flags);
+ out:
+	mutex_unlock(&cpu_buffer->mapping_lock);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_map_get_reader);
+
 #ifdef CONFIG_HOTPLUG_CPU
 static int rb_cpu_notify(struct notifier_block *self,
 			 unsigned long action, void *hcpu)
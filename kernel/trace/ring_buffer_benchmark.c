@@ -8,6 +8,8 @@
 #include <linux/kthread.h>
 #include <linux/module.h>
 #include <linux/ktime.h>
+#include <linux/slab.h>
+#include <linux/cpu.h>
 #include <asm/local.h>
 
 struct rb_page {
@@ -23,6 +25,12 @@ struct rb_page {
 /* number of events for writer to wake up the reader */
 static int wakeup_interval = 100;
 
+/* max number of events reserved in one go */
+#define MAX_BATCH	16
+
+/* run time of each step of the scaling test, in seconds */
+#define SCALE_TIME	1ULL
+
 static int reader_finish;
 static DECLARE_COMPLETION(read_start);
 static DECLARE_COMPLETION(read_done);
@@ -40,6 +48,14 @@ static unsigned int write_iteration = 50;
 module_param(write_iteration, uint, 0644);
 MODULE_PARM_DESC(write_iteration, "# of writes between timestamp readings");
 
+static unsigned int batch_size;
+module_param(batch_size, uint, 0644);
+MODULE_PARM_DESC(batch_size, "# of events per batch reserve (0: no batching)");
+
+static unsigned int scale_cpus;
+module_param(scale_cpus, uint, 0644);
+MODULE_PARM_DESC(scale_cpus, "report ns/event for 1 up to this many writers");
+
 static int producer_nice = MAX_NICE;
 static int consumer_nice = MAX_NICE;
 
@@ -225,6 +241,49 @@ static void ring_buffer_consumer(void)
 	complete(&read_done);
 }
 
+static void ring_buffer_write_events(unsigned long *hit,
+				     unsigned long *missed)
+{
+	struct ring_buffer_event *events[MAX_BATCH];
+	unsigned long lengths[MAX_BATCH];
+	struct ring_buffer_event *event;
+	int nr = clamp_t(int, batch_size, 1, MAX_BATCH);
+	int *entry;
+	int cnt;
+	int i, j;
+
+	if (nr == 1) {
+		for (i = 0; i < write_iteration; i++) {
+			event = ring_buffer_lock_reserve(buffer, 10);
+			if (!event) {
+				(*missed)++;
+			} else {
+				(*hit)++;
+				entry = ring_buffer_event_data(event);
+				*entry = smp_processor_id();
+				ring_buffer_unlock_commit(buffer, event);
+			}
+		}
+		return;
+	}
+
+	for (i = 0; i < nr; i++)
+		lengths[i] = 10;
+
+	for (i = 0; i < write_iteration; i += nr) {
+		cnt = ring_buffer_lock_reserve_batch(buffer, lengths,
+						     events, nr);
+		for (j = 0; j < cnt; j++) {
+			entry = ring_buffer_event_data(events[j]);
+			*entry = smp_processor_id();
+		}
+		if (cnt)
+			ring_buffer_unlock_commit_batch(buffer, events, cnt);
+		*hit += cnt;
+		*missed += nr - cnt;
+	}
+}
+
 static void ring_buffer_producer(void)
 {
 	ktime_t start_time, end_time, timeout;
@@ -244,21 +303,7 @@ static void ring_buffer_producer(void)
 	start_time = ktime_get();
 	timeout = ktime_add_ns(start_time, RUN_TIME * NSEC_PER_SEC);
 	do {
-		struct ring_buffer_event *event;
-		int *entry;
-		int i;
-
-		for (i = 0; i < write_iteration; i++) {
-			event = ring_buffer_lock_reserve(buffer, 10);
-			if (!event) {
-				missed++;
-			} else {
-				hit++;
-				entry = ring_buffer_event_data(event);
-				*entry = smp_processor_id();
-				ring_buffer_unlock_commit(buffer, event);
-			}
-		}
+		ring_buffer_write_events(&hit, &missed);
 		end_time = ktime_get();
 
 		cnt++;
@@ -376,6 +421,121 @@ static void wait_to_die(void)
 	__set_current_state(TASK_RUNNING);
 }
 
+struct rb_scale_data {
+	struct task_struct	*task;
+	unsigned long		hit;
+	unsigned long		missed;
+	u64			ns;
+};
+
+static atomic_t scale_running;
+static bool scale_go;
+static DECLARE_COMPLETION(scale_done);
+
+static int ring_buffer_scale_thread(void *arg)
+{
+	struct rb_scale_data *data = arg;
+	ktime_t start_time, end_time, timeout;
+
+	/* Wait for all the writers to be up before hammering the buffer */
+	while (!READ_ONCE(scale_go))
+		cond_resched();
+
+	start_time = ktime_get();
+	timeout = ktime_add_ns(start_time, SCALE_TIME * NSEC_PER_SEC);
+	do {
+		ring_buffer_write_events(&data->hit, &data->missed);
+		end_time = ktime_get();
+		cond_resched();
+	} while (ktime_before(end_time, timeout) && !test_error);
+
+	data->ns = ktime_to_ns(ktime_sub(end_time, start_time));
+
+	if (atomic_dec_and_test(&scale_running))
+		complete(&scale_done);
+
+	wait_to_die();
+
+	return 0;
+}
+
+/*
+ * Write from @nr_writers CPUs at the same time, each into its own per CPU
+ * buffer, and report the average cost of a write per event.
+ */
+static void ring_buffer_scale_step(struct rb_scale_data *data, int nr_writers)
+{
+	struct task_struct *task;
+	unsigned long hit = 0;
+	unsigned long missed = 0;
+	u64 ns = 0;
+	int started = 0;
+	int cpu;
+
+	ring_buffer_reset(buffer);
+	memset(data, 0, sizeof(*data) * nr_writers);
+	reinit_completion(&scale_done);
+	WRITE_ONCE(scale_go, false);
+	/* account for ourself, so that no writer completes too early */
+	atomic_set(&scale_running, 1);
+
+	for_each_online_cpu(cpu) {
+		if (started == nr_writers)
+			break;
+		task = kthread_create(ring_buffer_scale_thread, &data[started],
+				      "rb_scale/%d", cpu);
+		if (IS_ERR(task))
+			break;
+		kthread_bind(task, cpu);
+		data[started++].task = task;
+		atomic_inc(&scale_running);
+		wake_up_process(task);
+	}
+
+	WRITE_ONCE(scale_go, true);
+	if (atomic_dec_and_test(&scale_running))
+		complete(&scale_done);
+	wait_for_completion(&scale_done);
+
+	for (cpu = 0; cpu < started; cpu++) {
+		kthread_stop(data[cpu].task);
+		hit += data[cpu].hit;
+		missed += data[cpu].missed;
+		ns += data[cpu].ns;
+	}
+
+	if (hit)
+		ns = div64_u64(ns, hit);
+	trace_printk("%d writers: %lu hit %lu missed %llu ns per event\n",
+		     started, hit, missed, ns);
+}
+
+static void ring_buffer_scale_test(void)
+{
+	struct rb_scale_data *data;
+	int max;
+	int nr;
+
+	get_online_cpus();
+
+	max = min_t(int, scale_cpus, num_online_cpus());
+	data = kcalloc(max, sizeof(*data), GFP_KERNEL);
+	if (!data)
+		goto out;
+
+	trace_printk("Starting ring buffer scaling test (batch %u)\n",
+		     batch_size);
+	for (nr = 1; !break_test(); nr = min(nr * 2, max)) {
+		ring_buffer_scale_step(data, nr);
+		if (nr == max)
+			break;
+	}
+
+	kfree(data);
+ out:
+	put_online_cpus();
+}
+
 static int ring_buffer_consumer_thread(void *arg)
 {
 	while (!break_test()) {
@@ -410,6 +570,12 @@ static int ring_buffer_producer_thread(void *arg)
 		if (break_test())
 			goto out_kill;
 
+		if (scale_cpus) {
+			ring_buffer_scale_test();
+			if (break_test())
+				goto out_kill;
+		}
+
 		trace_printk("Sleeping for 10 secs\n");
 		set_current_state(TASK_INTERRUPTIBLE);
 		if (break_test())
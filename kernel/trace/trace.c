@@ -11,6 +11,7 @@
  *  Copyright (C) 2004-2006 Ingo Molnar
  *  Copyright (C) 2004 Nadia Yvette Chambers
  */
+#include <uapi/linux/trace_mmap.h>
 #include <linux/ring_buffer.h>
 #include <generated/utsrelease.h>
 #include <linux/stacktrace.h>
@@ -1088,6 +1089,12 @@ update_max_tr(struct trace_array *tr, struct task_struct *tsk, int cpu)
 
 	arch_spin_lock(&tr->max_lock);
 
+	/* The buffer pages can not change while user space maps them */
+	if (tr->mapped) {
+		arch_spin_unlock(&tr->max_lock);
+		return;
+	}
+
 	buf = tr->trace_buffer.buffer;
 	tr->trace_buffer.buffer = tr->max_buffer.buffer;
 	tr->max_buffer.buffer = buf;
@@ -1121,6 +1128,11 @@ update_max_tr_single(struct trace_array *tr, struct task_struct *tsk, int cpu)
 
 	arch_spin_lock(&tr->max_lock);
 
+	if (tr->mapped) {
+		arch_spin_unlock(&tr->max_lock);
+		return;
+	}
+
 	ret = ring_buffer_swap_cpu(tr->max_buffer.buffer, tr->trace_buffer.buffer, cpu);
 
 	if (ret == -EBUSY) {
@@ -1141,7 +1153,7 @@ update_max_tr_single(struct trace_array *tr, struct task_struct *tsk, int cpu)
 }
 #endif /* CONFIG_TRACER_MAX_TRACE */
 
-static int wait_on_pipe(struct trace_iterator *iter, bool full)
+static int wait_on_pipe(struct trace_iterator *iter, int full)
 {
 	/* Iterators are static, they should be filled or empty */
 	if (trace_buffer_iter(iter, iter->cpu_file))
@@ -3713,7 +3725,9 @@ static const char readme_msg[] =
 	"  current_tracer\t- function and latency tracers\n"
 	"  available_tracers\t- list of configured tracers for current_tracer\n"
 	"  buffer_size_kb\t- view and modify size of per cpu buffer\n"
-	"  buffer_total_size_kb  - view total size of all cpu buffers\n\n"
+	"  buffer_total_size_kb  - view total size of all cpu buffers\n"
+	"  buffer_percent\t- percentage of a per cpu buffer to fill before\n"
+	"\t\t\t  waking up per cpu readers (0 means any data)\n\n"
 	"  trace_clock\t\t-change the clock used to order events\n"
 	"       local:   Per cpu clock but may not be synced across CPUs\n"
 	"      global:   Synced across CPUs but slows tracing down.\n"
@@ -3813,6 +3827,9 @@ static const char readme_msg[] =
 #endif
 #ifdef CONFIG_TRACER_SNAPSHOT
 	"\t\t    snapshot\n"
+#endif
+#ifdef CONFIG_HIST_TRIGGERS
+	"\t\t    hist (see below)\n"
 #endif
 	"\t   example: echo traceoff > events/block/block_unplug/trigger\n"
 	"\t            echo traceoff:3 > events/block/block_unplug/trigger\n"
@@ -3829,6 +3846,22 @@ static const char readme_msg[] =
 	"\t   To remove a trigger with a count:\n"
 	"\t     echo '!<trigger>:0 > <system>/<event>/trigger\n"
 	"\t   Filters can be ignored when removing a trigger.\n"
+#ifdef CONFIG_HIST_TRIGGERS
+	"      hist trigger\t- If set, event hits are aggregated into a hash table\n"
+	"\t    Format: hist:keys=<field1[,field2]>\n"
+	"\t            [:vals=<field1[,field2]>]\n"
+	"\t            [:sort=<field1[,field2]>]\n"
+	"\t            [:size=#entries]\n"
+	"\t            [:pause][:continue][:clear]\n"
+	"\t            [if <filter>]\n\n"
+	"\t    The table is read from events/<system>/<event>/hist.  A key\n"
+	"\t    can be any event field, 'stacktrace' or common_pid.execname;\n"
+	"\t    .hex, .sym and .sym-offset change how keys are displayed.\n"
+	"\t    Values are summed per key, 'hitcount' is always kept, and\n"
+	"\t    sort keys accept .ascending or .descending.\n"
+	"\t    pause, continue and clear, written as another hist command,\n"
+	"\t    control the existing histogram of the event.\n"
+#endif
 ;
 
 static ssize_t
@@ -4664,7 +4697,8 @@ static int tracing_release_pipe(struct inode *inode, struct file *file)
 }
 
 static unsigned int
-trace_poll(struct trace_iterator *iter, struct file *filp, poll_table *poll_table)
+trace_poll(struct trace_iterator *iter, struct file *filp,
+	   poll_table *poll_table, int full)
 {
 	struct trace_array *tr = iter->tr;
 
@@ -4679,7 +4713,7 @@ trace_poll(struct trace_iterator *iter, struct file *filp, poll_table *poll_tabl
 		return POLLIN | POLLRDNORM;
 	else
 		return ring_buffer_poll_wait(iter->trace_buffer->buffer, iter->cpu_file,
-					     filp, poll_table);
+					     filp, poll_table, full);
 }
 
 static unsigned int
@@ -4687,7 +4721,7 @@ tracing_poll_pipe(struct file *filp, poll_table *poll_table)
 {
 	struct trace_iterator *iter = filp->private_data;
 
-	return trace_poll(iter, filp, poll_table);
+	return trace_poll(iter, filp, poll_table, 0);
 }
 
 /* Must be called with iter->mutex held. */
@@ -4716,7 +4750,7 @@ static int tracing_wait_pipe(struct file *filp)
 
 		mutex_unlock(&iter->mutex);
 
-		ret = wait_on_pipe(iter, false);
+		ret = wait_on_pipe(iter, 0);
 
 		mutex_lock(&iter->mutex);
 
@@ -5388,6 +5422,11 @@ tracing_snapshot_write(struct file *filp, const char __user *ubuf, size_t cnt,
 			break;
 		}
 #endif
+		/* Swapping would pull the mapped pages from under user space */
+		if (tr->mapped) {
+			ret = -EBUSY;
+			break;
+		}
 		if (!tr->allocated_snapshot) {
 			ret = alloc_snapshot(tr);
 			if (ret < 0)
@@ -5604,7 +5643,7 @@ tracing_buffers_poll(struct file *filp, poll_table *poll_table)
 	struct ftrace_buffer_info *info = filp->private_data;
 	struct trace_iterator *iter = &info->iter;
 
-	return trace_poll(iter, filp, poll_table);
+	return trace_poll(iter, filp, poll_table, iter->tr->buffer_percent);
 }
 
 static ssize_t
@@ -5647,7 +5686,7 @@ tracing_buffers_read(struct file *filp, char __user *ubuf,
 			if ((filp->f_flags & O_NONBLOCK))
 				return -EAGAIN;
 
-			ret = wait_on_pipe(iter, false);
+			ret = wait_on_pipe(iter, 0);
 			if (ret)
 				return ret;
 
@@ -5847,7 +5886,7 @@ tracing_buffers_splice_read(struct file *file, loff_t *ppos,
 		if ((file->f_flags & O_NONBLOCK) || (flags & SPLICE_F_NONBLOCK))
 			return -EAGAIN;
 
-		ret = wait_on_pipe(iter, true);
+		ret = wait_on_pipe(iter, iter->tr->buffer_percent);
 		if (ret)
 			return ret;
 
@@ -5860,12 +5899,125 @@ tracing_buffers_splice_read(struct file *file, loff_t *ppos,
 	return ret;
 }
 
+/*
+ * Wait for the buffer_percent watermark, unless the file is non blocking,
+ * then hand out the next reader page of the mapped per cpu buffer.
+ */
+static long tracing_buffers_ioctl(struct file *file, unsigned int cmd,
+				  unsigned long arg)
+{
+	struct ftrace_buffer_info *info = file->private_data;
+	struct trace_iterator *iter = &info->iter;
+	int ret;
+
+	if (cmd != TRACE_MMAP_IOCTL_GET_READER)
+		return -ENOTTY;
+
+	if (!(file->f_flags & O_NONBLOCK)) {
+		ret = ring_buffer_wait(iter->trace_buffer->buffer,
+				       iter->cpu_file,
+				       iter->tr->buffer_percent);
+		if (ret)
+			return ret;
+	}
+
+	trace_access_lock(iter->cpu_file);
+	ret = ring_buffer_map_get_reader(iter->trace_buffer->buffer,
+					 iter->cpu_file);
+	trace_access_unlock(iter->cpu_file);
+
+	return ret;
+}
+
+/*
+ * A snapshot swaps the buffers under max_lock. Count the mappings
+ * under it too, so that no swap can happen while the pages of the
+ * buffer are mapped.
+ */
+static int get_buffer_map(struct trace_array *tr)
+{
+	int ret = 0;
+
+	local_irq_disable();
+	arch_spin_lock(&tr->max_lock);
+#ifdef CONFIG_TRACER_MAX_TRACE
+	/* A latency tracer swaps the buffers on its own */
+	if (tr->current_trace->use_max_tr)
+		ret = -EBUSY;
+#endif
+	if (!ret)
+		tr->mapped++;
+	arch_spin_unlock(&tr->max_lock);
+	local_irq_enable();
+
+	return ret;
+}
+
+static void put_buffer_map(struct trace_array *tr)
+{
+	local_irq_disable();
+	arch_spin_lock(&tr->max_lock);
+	if (!WARN_ON(!tr->mapped))
+		tr->mapped--;
+	arch_spin_unlock(&tr->max_lock);
+	local_irq_enable();
+}
+
+static void tracing_buffers_mmap_open(struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+	struct trace_iterator *iter = &info->iter;
+
+	/* The vma was split, the pages are already in place */
+	WARN_ON(get_buffer_map(iter->tr));
+	WARN_ON(ring_buffer_map(iter->trace_buffer->buffer, iter->cpu_file,
+				NULL));
+}
+
+static void tracing_buffers_mmap_close(struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+	struct trace_iterator *iter = &info->iter;
+
+	WARN_ON(ring_buffer_unmap(iter->trace_buffer->buffer, iter->cpu_file));
+	put_buffer_map(iter->tr);
+}
+
+static const struct vm_operations_struct tracing_buffers_vmops = {
+	.open		= tracing_buffers_mmap_open,
+	.close		= tracing_buffers_mmap_close,
+};
+
+static int tracing_buffers_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = filp->private_data;
+	struct trace_iterator *iter = &info->iter;
+	int ret;
+
+	ret = get_buffer_map(iter->tr);
+	if (ret)
+		return ret;
+
+	ret = ring_buffer_map(iter->trace_buffer->buffer, iter->cpu_file, vma);
+	if (ret) {
+		put_buffer_map(iter->tr);
+		return ret;
+	}
+
+	vma->vm_ops = &tracing_buffers_vmops;
+
+	return 0;
+}
+
 static const struct file_operations tracing_buffers_fops = {
 	.open		= tracing_buffers_open,
 	.read		= tracing_buffers_read,
 	.poll		= tracing_buffers_poll,
 	.release	= tracing_buffers_release,
 	.splice_read	= tracing_buffers_splice_read,
+	.unlocked_ioctl	= tracing_buffers_ioctl,
+	.compat_ioctl	= tracing_buffers_ioctl,
+	.mmap		= tracing_buffers_mmap,
 	.llseek		= no_llseek,
 };
 
@@ -6525,6 +6677,49 @@ static const struct file_operations rb_simple_fops = {
 	.llseek		= default_llseek,
 };
 
+static ssize_t
+buffer_percent_read(struct file *filp, char __user *ubuf,
+		    size_t cnt, loff_t *ppos)
+{
+	struct trace_array *tr = filp->private_data;
+	char buf[64];
+	int r;
+
+	r = sprintf(buf, "%d\n", tr->buffer_percent);
+
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, r);
+}
+
+static ssize_t
+buffer_percent_write(struct file *filp, const char __user *ubuf,
+		     size_t cnt, loff_t *ppos)
+{
+	struct trace_array *tr = filp->private_data;
+	unsigned long val;
+	int ret;
+
+	ret = kstrtoul_from_user(ubuf, cnt, 10, &val);
+	if (ret)
+		return ret;
+
+	if (val > 100)
+		return -EINVAL;
+
+	tr->buffer_percent = val;
+
+	(*ppos)++;
+
+	return cnt;
+}
+
+static const struct file_operations buffer_percent_fops = {
+	.open		= tracing_open_generic_tr,
+	.read		= buffer_percent_read,
+	.write		= buffer_percent_write,
+	.release	= tracing_release_generic_tr,
+	.llseek		= default_llseek,
+};
+
 struct dentry *trace_instance_dir;
 
 static void
@@ -6800,6 +6995,11 @@ init_tracer_tracefs(struct trace_array *tr, struct dentry *d_tracer)
 	trace_create_file("tracing_on", 0644, d_tracer,
 			  tr, &rb_simple_fops);
 
+	tr->buffer_percent = 50;
+
+	trace_create_file("buffer_percent", 0644, d_tracer,
+			  tr, &buffer_percent_fops);
+
 	create_trace_options_dir(tr);
 
 #ifdef CONFIG_TRACER_MAX_TRACE
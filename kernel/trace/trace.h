@@ -38,6 +38,7 @@ enum trace_type {
 	TRACE_USER_STACK,
 	TRACE_BLK,
 	TRACE_BPUTS,
+	TRACE_GRAPH_DUR,
 
 	__TRACE_LAST_TYPE,
 };
@@ -232,6 +233,9 @@ struct trace_array {
 #endif
 	int			stop_count;
 	int			clock_id;
+	int			buffer_percent;
+	/* per cpu buffers mapped by user space, see get_buffer_map() */
+	int			mapped;
 	int			nr_topts;
 	struct tracer		*current_trace;
 	unsigned int		trace_flags;
@@ -327,6 +331,8 @@ extern void __ftrace_bad_type(void);
 			  TRACE_GRAPH_ENT);		\
 		IF_ASSIGN(var, ent, struct ftrace_graph_ret_entry,	\
 			  TRACE_GRAPH_RET);		\
+		IF_ASSIGN(var, ent, struct ftrace_graph_dur_entry,	\
+			  TRACE_GRAPH_DUR);		\
 		__ftrace_bad_type();					\
 	} while (0)
 
@@ -732,6 +738,7 @@ extern char trace_find_mark(unsigned long long duration);
 #define TRACE_GRAPH_PRINT_TAIL          0x80
 #define TRACE_GRAPH_SLEEP_TIME		0x100
 #define TRACE_GRAPH_GRAPH_TIME		0x200
+#define TRACE_GRAPH_RET_ONLY		0x400
 #define TRACE_GRAPH_PRINT_FILL_SHIFT	28
 #define TRACE_GRAPH_PRINT_FILL_MASK	(0x3 << TRACE_GRAPH_PRINT_FILL_SHIFT)
 
@@ -1134,6 +1141,18 @@ extern void free_event_filter(struct event_filter *filter);
 struct ftrace_event_field *
 trace_find_event_field(struct trace_event_call *call, char *name);
 
+static inline bool is_function_field(struct ftrace_event_field *field)
+{
+	return field->filter_type == FILTER_TRACE_FN;
+}
+
+static inline bool is_string_field(struct ftrace_event_field *field)
+{
+	return field->filter_type == FILTER_DYN_STRING ||
+	       field->filter_type == FILTER_STATIC_STRING ||
+	       field->filter_type == FILTER_PTR_STRING;
+}
+
 extern void trace_event_enable_cmd_record(bool enable);
 extern int event_trace_add_tracer(struct dentry *parent, struct trace_array *tr);
 extern int event_trace_del_tracer(struct trace_array *tr);
@@ -1163,9 +1182,31 @@ struct event_trigger_data {
 	struct event_filter __rcu	*filter;
 	char				*filter_str;
 	void				*private_data;
+	bool				paused;
 	struct list_head		list;
 };
 
+extern void trigger_data_free(struct event_trigger_data *data);
+extern int event_trigger_init(struct event_trigger_ops *ops,
+			      struct event_trigger_data *data);
+extern int trace_event_trigger_enable_disable(struct trace_event_file *file,
+					      int trigger_enable);
+extern void update_cond_flag(struct trace_event_file *file);
+extern void unregister_trigger(char *glob, struct event_trigger_ops *ops,
+			       struct event_trigger_data *test,
+			       struct trace_event_file *file);
+extern int set_trigger_filter(char *filter_str,
+			      struct event_trigger_data *trigger_data,
+			      struct trace_event_file *file);
+extern int register_event_command(struct event_command *cmd);
+
+#ifdef CONFIG_HIST_TRIGGERS
+extern int register_trigger_hist_cmd(void);
+extern const struct file_operations event_hist_fops;
+#else
+static inline int register_trigger_hist_cmd(void) { return 0; }
+#endif
+
 /**
  * struct event_trigger_ops - callbacks for trace event triggers
  *
@@ -1178,7 +1219,10 @@ struct event_trigger_data {
  * @func: The trigger 'probe' function called when the triggering
  *	event occurs.  The data passed into this callback is the data
  *	that was supplied to the event_command @reg() function that
- *	registered the trigger (see struct event_command).
+ *	registered the trigger (see struct event_command).  The @rec
+ *	parameter is the trace record being logged, or NULL if the
+ *	trigger is invoked unconditionally or after the event has been
+ *	committed (see @post_trigger in struct event_command).
  *
  * @init: An optional initialization function called for the trigger
  *	when the trigger is registered (via the event_command reg()
@@ -1203,7 +1247,8 @@ struct event_trigger_data {
  *	(see trace_event_triggers.c).
  */
 struct event_trigger_ops {
-	void			(*func)(struct event_trigger_data *data);
+	void			(*func)(struct event_trigger_data *data,
+					void *rec);
 	int			(*init)(struct event_trigger_ops *ops,
 					struct event_trigger_data *data);
 	void			(*free)(struct event_trigger_ops *ops,
@@ -1227,8 +1272,8 @@ struct event_trigger_ops {
  * The data members in this structure provide per-event command data
  * for various event commands.
  *
- * All the data members below, except for @post_trigger, must be set
- * for each event command.
+ * All the data members below, except for @post_trigger and
+ * @needs_rec, must be set for each event command.
  *
  * @name: The unique name that identifies the event command.  This is
  *	the name used when setting triggers via trigger files.
@@ -1266,6 +1311,12 @@ struct event_trigger_ops {
  *	itself logs to the trace buffer, this flag should be set,
  *	otherwise it can be left unspecified.
  *
+ * @needs_rec: A flag that says whether or not this command needs
+ *	the trace record to do its work, as the hist trigger does to
+ *	pull its keys and values out of the event.  Setting it forces
+ *	conditional invocation (see update_cond_flag()) so that the
+ *	trigger @func() is never called with a NULL @rec.
+ *
  * All the methods below, except for @set_filter(), must be
  * implemented.
  *
@@ -1306,6 +1357,7 @@ struct event_command {
 	char			*name;
 	enum event_trigger_type	trigger_type;
 	bool			post_trigger;
+	bool			needs_rec;
 	int			(*func)(struct event_command *cmd_ops,
 					struct trace_event_file *file,
 					char *glob, char *cmd, char *params);
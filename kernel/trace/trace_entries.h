@@ -109,6 +109,26 @@ FTRACE_ENTRY(funcgraph_exit, ftrace_graph_ret_entry,
 	FILTER_OTHER
 );
 
+/* Function return with its caller, written by funcgraph-retonly */
+FTRACE_ENTRY(funcgraph_dur, ftrace_graph_dur_entry,
+
+	TRACE_GRAPH_DUR,
+
+	F_STRUCT(
+		__field(	unsigned long,		func		)
+		__field(	unsigned long,		parent		)
+		__field(	unsigned long long,	calltime	)
+		__field(	unsigned long long,	rettime		)
+		__field(	int,			depth		)
+	),
+
+	F_printk("<-- %lx <- %lx (%d) (start: %llx  end: %llx)",
+		 __entry->func, __entry->parent, __entry->depth,
+		 __entry->calltime, __entry->rettime),
+
+	FILTER_OTHER
+);
+
 /*
  * Context switch trace entry - which task (and prio) we switched from/to:
  *
@@ -7,7 +7,10 @@
  *
  */
 #include <linux/uaccess.h>
+#include <linux/kallsyms.h>
+#include <linux/seq_file.h>
 #include <linux/ftrace.h>
+#include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/fs.h>
 
@@ -87,6 +90,8 @@ static struct tracer_opt trace_opts[] = {
 	{ TRACER_OPT(sleep-time, TRACE_GRAPH_SLEEP_TIME) },
 	/* Include time within nested functions */
 	{ TRACER_OPT(graph-time, TRACE_GRAPH_GRAPH_TIME) },
+	/* Only record returns that exceed their threshold */
+	{ TRACER_OPT(funcgraph-retonly, TRACE_GRAPH_RET_ONLY) },
 	{ } /* Empty entry */
 };
 
@@ -100,6 +105,37 @@ static struct tracer_flags tracer_flags = {
 
 static struct trace_array *graph_array;
 
+/*
+ * Return-only mode (funcgraph-retonly): nothing is written when a
+ * function is entered. When it returns, one funcgraph_dur event with
+ * the function, its caller and its duration is written, but only if
+ * the call took at least the threshold set for it in funcgraph_thresh,
+ * or tracing_thresh for functions that are not listed there. With
+ * funcgraph_sample_rate set to N, only one call in N on each cpu is
+ * timed at all.
+ */
+static bool graph_ret_only;
+static bool graph_trace_enabled;
+static unsigned int graph_sample_rate;
+static DEFINE_PER_CPU(unsigned int, graph_sample_count);
+
+#define FGRAPH_THRESH_MAX_FUNCS		32
+
+struct fgraph_thresh {
+	unsigned long	start;
+	unsigned long	end;
+	u64		thresh;		/* in nsecs */
+};
+
+/*
+ * Read locklessly from the return hook, like ftrace_graph_funcs.
+ * Updates are serialized by graph_thresh_mutex; a reader racing
+ * with the removal of an entry may use a stale threshold once.
+ */
+static struct fgraph_thresh graph_thresh_funcs[FGRAPH_THRESH_MAX_FUNCS];
+static int graph_thresh_count;
+static DEFINE_MUTEX(graph_thresh_mutex);
+
 /*
  * DURATION column is being also used to display IRQ signs,
  * following values are used by print_graph_irq and others
@@ -449,12 +485,108 @@ static void trace_graph_thresh_return(struct ftrace_graph_ret *trace)
 		trace_graph_return(trace);
 }
 
+static int trace_graph_ret_only_entry(struct ftrace_graph_ent *trace)
+{
+	unsigned int rate = READ_ONCE(graph_sample_rate);
+
+	if (!ftrace_trace_task(current))
+		return 0;
+
+	if ((!(trace->depth || ftrace_graph_addr(trace->func)) ||
+	     ftrace_graph_ignore_irqs()) || (trace->depth < 0) ||
+	    (max_depth && trace->depth >= max_depth))
+		return 0;
+
+	/* Keep the ret stack entry so the notrace index is recovered */
+	if (ftrace_graph_notrace_addr(trace->func))
+		return 1;
+
+	/* Returning 0 pops the entry, so the return hook never runs */
+	if (rate > 1 && this_cpu_inc_return(graph_sample_count) % rate)
+		return 0;
+
+	return 1;
+}
+
+static u64 graph_func_thresh(unsigned long ip)
+{
+	int count = READ_ONCE(graph_thresh_count);
+	int i;
+
+	/* Pairs with the smp_wmb() in graph_thresh_write/del */
+	smp_rmb();
+	for (i = 0; i < count; i++) {
+		struct fgraph_thresh *ft = &graph_thresh_funcs[i];
+
+		if (ip >= READ_ONCE(ft->start) && ip < READ_ONCE(ft->end))
+			return READ_ONCE(ft->thresh);
+	}
+
+	return tracing_thresh;
+}
+
+static void __trace_graph_dur(struct trace_array *tr,
+			      struct ftrace_graph_ret *trace,
+			      unsigned long parent,
+			      unsigned long flags, int pc)
+{
+	struct trace_event_call *call = &event_funcgraph_dur;
+	struct ring_buffer_event *event;
+	struct ring_buffer *buffer = tr->trace_buffer.buffer;
+	struct ftrace_graph_dur_entry *entry;
+
+	event = trace_buffer_lock_reserve(buffer, TRACE_GRAPH_DUR,
+					  sizeof(*entry), flags, pc);
+	if (!event)
+		return;
+	entry	= ring_buffer_event_data(event);
+	entry->func				= trace->func;
+	entry->parent				= parent;
+	entry->calltime				= trace->calltime;
+	entry->rettime				= trace->rettime;
+	entry->depth				= trace->depth;
+	if (!call_filter_check_discard(call, entry, buffer, event))
+		__buffer_unlock_commit(buffer, event);
+}
+
+static void trace_graph_ret_only_return(struct ftrace_graph_ret *trace)
+{
+	struct trace_array *tr = graph_array;
+	struct trace_array_cpu *data;
+	unsigned long parent = 0;
+	unsigned long flags;
+	long disabled;
+	int cpu;
+	int pc;
+
+	if (trace->rettime - trace->calltime < graph_func_thresh(trace->func))
+		return;
+
+	/* The caller's entry is still on the ret stack */
+	if (trace->depth > 0)
+		parent = current->ret_stack[trace->depth - 1].func;
+
+	local_irq_save(flags);
+	cpu = raw_smp_processor_id();
+	data = per_cpu_ptr(tr->trace_buffer.data, cpu);
+	disabled = atomic_inc_return(&data->disabled);
+	if (likely(disabled == 1)) {
+		pc = preempt_count();
+		__trace_graph_dur(tr, trace, parent, flags, pc);
+	}
+	atomic_dec(&data->disabled);
+	local_irq_restore(flags);
+}
+
 static int graph_trace_init(struct trace_array *tr)
 {
 	int ret;
 
 	set_graph_array(tr);
-	if (tracing_thresh)
+	if (graph_ret_only)
+		ret = register_ftrace_graph(&trace_graph_ret_only_return,
+					    &trace_graph_ret_only_entry);
+	else if (tracing_thresh)
 		ret = register_ftrace_graph(&trace_graph_thresh_return,
 					    &trace_graph_thresh_entry);
 	else
@@ -463,12 +595,14 @@ static int graph_trace_init(struct trace_array *tr)
 	if (ret)
 		return ret;
 	tracing_start_cmdline_record();
+	graph_trace_enabled = true;
 
 	return 0;
 }
 
 static void graph_trace_reset(struct trace_array *tr)
 {
+	graph_trace_enabled = false;
 	tracing_stop_cmdline_record();
 	unregister_ftrace_graph();
 }
@@ -1091,6 +1225,24 @@ print_graph_return(struct ftrace_graph_ret *trace, struct trace_seq *s,
 	return trace_handle_return(s);
 }
 
+static enum print_line_t
+print_graph_dur(struct ftrace_graph_dur_entry *field, struct trace_seq *s,
+		struct trace_iterator *iter, u32 flags)
+{
+	print_graph_prologue(iter, s, 0, 0, flags);
+
+	print_graph_duration(iter->tr, field->rettime - field->calltime,
+			     s, flags);
+
+	if (field->parent)
+		trace_seq_printf(s, "%ps <- %ps\n", (void *)field->func,
+				 (void *)field->parent);
+	else
+		trace_seq_printf(s, "%ps\n", (void *)field->func);
+
+	return trace_handle_return(s);
+}
+
 static enum print_line_t
 print_graph_comment(struct trace_seq *s, struct trace_entry *ent,
 		    struct trace_iterator *iter, u32 flags)
@@ -1204,6 +1356,12 @@ print_graph_function_flags(struct trace_iterator *iter, u32 flags)
 		trace_assign_type(field, entry);
 		return print_graph_return(&field->ret, s, entry, iter, flags);
 	}
+	case TRACE_GRAPH_DUR: {
+		struct ftrace_graph_dur_entry *field;
+
+		trace_assign_type(field, entry);
+		return print_graph_dur(field, s, iter, flags);
+	}
 	case TRACE_STACK:
 	case TRACE_FN:
 		/* dont trace stack and functions as comments */
@@ -1375,6 +1533,13 @@ func_graph_set_flag(struct trace_array *tr, u32 old_flags, u32 bit, int set)
 	if (bit == TRACE_GRAPH_GRAPH_TIME)
 		ftrace_graph_graph_time_control(set);
 
+	if (bit == TRACE_GRAPH_RET_ONLY && graph_ret_only != !!set) {
+		graph_ret_only = set;
+		/* Switch the hooks of a running tracer */
+		if (graph_trace_enabled)
+			return graph_trace_update_thresh(tr);
+	}
+
 	return 0;
 }
 
@@ -1392,6 +1557,11 @@ static struct trace_event graph_trace_ret_event = {
 	.funcs		= &graph_functions
 };
 
+static struct trace_event graph_trace_dur_event = {
+	.type		= TRACE_GRAPH_DUR,
+	.funcs		= &graph_functions
+};
+
 static struct tracer graph_trace __tracer_data = {
 	.name		= "function_graph",
 	.update_thresh	= graph_trace_update_thresh,
@@ -1448,6 +1618,169 @@ static const struct file_operations graph_depth_fops = {
 	.llseek		= generic_file_llseek,
 };
 
+static ssize_t
+graph_sample_rate_write(struct file *filp, const char __user *ubuf,
+			size_t cnt, loff_t *ppos)
+{
+	unsigned long val;
+	int ret;
+
+	ret = kstrtoul_from_user(ubuf, cnt, 10, &val);
+	if (ret)
+		return ret;
+
+	if (val > UINT_MAX)
+		return -EINVAL;
+
+	WRITE_ONCE(graph_sample_rate, val);
+
+	*ppos += cnt;
+
+	return cnt;
+}
+
+static ssize_t
+graph_sample_rate_read(struct file *filp, char __user *ubuf, size_t cnt,
+		       loff_t *ppos)
+{
+	char buf[15]; /* More than enough to hold UINT_MAX + "\n"*/
+	int n;
+
+	n = sprintf(buf, "%u\n", graph_sample_rate);
+
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, n);
+}
+
+static const struct file_operations graph_sample_rate_fops = {
+	.open		= tracing_open_generic,
+	.write		= graph_sample_rate_write,
+	.read		= graph_sample_rate_read,
+	.llseek		= generic_file_llseek,
+};
+
+static int graph_thresh_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	mutex_lock(&graph_thresh_mutex);
+	for (i = 0; i < graph_thresh_count; i++)
+		seq_printf(m, "%ps %llu\n",
+			   (void *)graph_thresh_funcs[i].start,
+			   div_u64(graph_thresh_funcs[i].thresh, 1000));
+	mutex_unlock(&graph_thresh_mutex);
+
+	return 0;
+}
+
+static int graph_thresh_open(struct inode *inode, struct file *file)
+{
+	if ((file->f_mode & FMODE_WRITE) && (file->f_flags & O_TRUNC)) {
+		mutex_lock(&graph_thresh_mutex);
+		WRITE_ONCE(graph_thresh_count, 0);
+		mutex_unlock(&graph_thresh_mutex);
+	}
+
+	return single_open(file, graph_thresh_show, NULL);
+}
+
+static void graph_thresh_del(int idx)
+{
+	int last = graph_thresh_count - 1;
+
+	/* Empty the range first so no reader matches a half copied slot */
+	WRITE_ONCE(graph_thresh_funcs[idx].end, 0);
+	smp_wmb();
+	WRITE_ONCE(graph_thresh_funcs[idx].thresh,
+		   graph_thresh_funcs[last].thresh);
+	WRITE_ONCE(graph_thresh_funcs[idx].start,
+		   graph_thresh_funcs[last].start);
+	smp_wmb();
+	WRITE_ONCE(graph_thresh_funcs[idx].end,
+		   graph_thresh_funcs[last].end);
+	smp_wmb();
+	WRITE_ONCE(graph_thresh_count, last);
+}
+
+/*
+ * "func usecs" sets the threshold of func, "!func" removes it.
+ * Opening the file with O_TRUNC clears all of them.
+ */
+static ssize_t
+graph_thresh_write(struct file *filp, const char __user *ubuf, size_t cnt,
+		   loff_t *ppos)
+{
+	char buf[KSYM_NAME_LEN + 32];
+	unsigned long start, size, offset;
+	unsigned long usecs = 0;
+	char *p, *name;
+	bool remove;
+	ssize_t ret;
+	int i;
+
+	if (cnt >= sizeof(buf))
+		return -EINVAL;
+
+	if (copy_from_user(buf, ubuf, cnt))
+		return -EFAULT;
+	buf[cnt] = 0;
+
+	p = strim(buf);
+	remove = *p == '!';
+	if (remove)
+		p++;
+
+	name = strsep(&p, " \t");
+	if (!*name)
+		return -EINVAL;
+
+	if (!remove && (!p || kstrtoul(skip_spaces(p), 10, &usecs)))
+		return -EINVAL;
+
+	start = kallsyms_lookup_name(name);
+	if (!start || !kallsyms_lookup_size_offset(start, &size, &offset))
+		return -EINVAL;
+
+	mutex_lock(&graph_thresh_mutex);
+
+	for (i = 0; i < graph_thresh_count; i++)
+		if (graph_thresh_funcs[i].start == start)
+			break;
+
+	ret = cnt;
+	if (remove) {
+		if (i < graph_thresh_count)
+			graph_thresh_del(i);
+		else
+			ret = -ENOENT;
+	} else if (i < graph_thresh_count) {
+		WRITE_ONCE(graph_thresh_funcs[i].thresh, (u64)usecs * 1000);
+	} else if (i == FGRAPH_THRESH_MAX_FUNCS) {
+		ret = -ENOSPC;
+	} else {
+		graph_thresh_funcs[i].start = start;
+		graph_thresh_funcs[i].end = start + size;
+		graph_thresh_funcs[i].thresh = (u64)usecs * 1000;
+		/* Fill the slot before readers can see it */
+		smp_wmb();
+		WRITE_ONCE(graph_thresh_count, i + 1);
+	}
+
+	mutex_unlock(&graph_thresh_mutex);
+
+	if (ret > 0)
+		*ppos += cnt;
+
+	return ret;
+}
+
+static const struct file_operations graph_thresh_fops = {
+	.open		= graph_thresh_open,
+	.write		= graph_thresh_write,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static __init int init_graph_tracefs(void)
 {
 	struct dentry *d_tracer;
@@ -1459,6 +1792,12 @@ static __init int init_graph_tracefs(void)
 	trace_create_file("max_graph_depth", 0644, d_tracer,
 			  NULL, &graph_depth_fops);
 
+	trace_create_file("funcgraph_thresh", 0644, d_tracer,
+			  NULL, &graph_thresh_fops);
+
+	trace_create_file("funcgraph_sample_rate", 0644, d_tracer,
+			  NULL, &graph_sample_rate_fops);
+
 	return 0;
 }
 fs_initcall(init_graph_tracefs);
@@ -1477,6 +1816,11 @@ static __init int init_graph_trace(void)
 		return 1;
 	}
 
+	if (!register_trace_event(&graph_trace_dur_event)) {
+		pr_warning("Warning: could not register graph trace events\n");
+		return 1;
+	}
+
 	return register_tracer(&graph_trace);
 }
 
@@ -13,14 +13,17 @@
 #include <linux/uaccess.h>
 #include <linux/module.h>
 #include <linux/ftrace.h>
+#include <linux/hash.h>
 #include <trace/events/hist.h>
 
 #include "trace.h"
+#include "trace_stat.h"
 
 static struct trace_array		*irqsoff_trace __read_mostly;
 static int				tracer_enabled __read_mostly;
 
 static DEFINE_PER_CPU(int, tracing_cpu);
+static DEFINE_PER_CPU(int, tracing_cpu_irqsoff);
 
 static DEFINE_RAW_SPINLOCK(max_trace_lock);
 
@@ -295,6 +298,167 @@ static bool report_latency(struct trace_array *tr, cycle_t delta)
 	return true;
 }
 
+/*
+ * Per call site statistics.
+ *
+ * tracing_max_latency only keeps the single worst section, so the
+ * second worst offender shows up once the worst one is fixed. Every
+ * section is also accounted to the ip that started it, which gives a
+ * ranked list of offenders from one run in trace_stat/irqsoff_sites.
+ *
+ * The table is filled without locks: a slot is claimed with a cmpxchg
+ * on its ip and the counters are atomics. The end ip of the maximum is
+ * only a hint, it may belong to a section that raced with the update.
+ * Sites that do not find a slot within IRQSOFF_SITE_PROBES are counted
+ * as dropped. The table is cleared when the tracer is started.
+ */
+#define IRQSOFF_SITE_BITS	10
+#define IRQSOFF_SITE_SIZE	(1 << IRQSOFF_SITE_BITS)
+#define IRQSOFF_SITE_PROBES	16
+
+struct irqsoff_site {
+	unsigned long		ip;
+	unsigned long		max_end;
+	int			irqsoff;
+	atomic_t		count;
+	atomic64_t		max;
+	atomic64_t		total;
+};
+
+static struct irqsoff_site irqsoff_sites[IRQSOFF_SITE_SIZE];
+static atomic_t irqsoff_sites_dropped;
+
+static struct irqsoff_site *irqsoff_site_get(unsigned long ip, int irqsoff)
+{
+	unsigned long slot = hash_long(ip, IRQSOFF_SITE_BITS);
+	struct irqsoff_site *site;
+	unsigned long old;
+	int i;
+
+	for (i = 0; i < IRQSOFF_SITE_PROBES; i++) {
+		site = &irqsoff_sites[(slot + i) & (IRQSOFF_SITE_SIZE - 1)];
+
+		old = READ_ONCE(site->ip);
+		if (old == ip)
+			return site;
+		if (old)
+			continue;
+
+		old = cmpxchg(&site->ip, 0, ip);
+		if (!old) {
+			site->irqsoff = irqsoff;
+			return site;
+		}
+		if (old == ip)
+			return site;
+	}
+
+	return NULL;
+}
+
+static void irqsoff_site_account(unsigned long ip, unsigned long end,
+				 int irqsoff, cycle_t delta)
+{
+	struct irqsoff_site *site;
+	s64 max, old;
+
+	site = irqsoff_site_get(ip, irqsoff);
+	if (!site) {
+		atomic_inc(&irqsoff_sites_dropped);
+		return;
+	}
+
+	atomic_inc(&site->count);
+	atomic64_add(delta, &site->total);
+
+	max = atomic64_read(&site->max);
+	while ((s64)delta > max) {
+		old = atomic64_cmpxchg(&site->max, max, delta);
+		if (old == max) {
+			WRITE_ONCE(site->max_end, end);
+			break;
+		}
+		max = old;
+	}
+}
+
+static void irqsoff_sites_reset(void)
+{
+	memset(irqsoff_sites, 0, sizeof(irqsoff_sites));
+	atomic_set(&irqsoff_sites_dropped, 0);
+}
+
+static void *irqsoff_site_stat_next(void *v, int idx)
+{
+	struct irqsoff_site *site = v;
+
+	while (++site < irqsoff_sites + IRQSOFF_SITE_SIZE) {
+		if (READ_ONCE(site->ip) && atomic_read(&site->count))
+			return site;
+	}
+
+	return NULL;
+}
+
+static void *irqsoff_site_stat_start(struct tracer_stat *trace)
+{
+	struct irqsoff_site *site = irqsoff_sites;
+
+	if (site->ip && atomic_read(&site->count))
+		return site;
+
+	return irqsoff_site_stat_next(site, 0);
+}
+
+static int irqsoff_site_stat_cmp(void *p1, void *p2)
+{
+	struct irqsoff_site *a = p1;
+	struct irqsoff_site *b = p2;
+	s64 max_a = atomic64_read(&a->max);
+	s64 max_b = atomic64_read(&b->max);
+
+	if (max_a > max_b)
+		return 1;
+	if (max_a < max_b)
+		return -1;
+	return 0;
+}
+
+static int irqsoff_site_stat_headers(struct seq_file *m)
+{
+	seq_printf(m, "# dropped sites: %d\n",
+		   atomic_read(&irqsoff_sites_dropped));
+	seq_puts(m, "  type    max(us)    avg(us)      count  site\n"
+		    "  ----    -------    -------      -----  ----\n");
+	return 0;
+}
+
+static int irqsoff_site_stat_show(struct seq_file *m, void *v)
+{
+	struct irqsoff_site *site = v;
+	unsigned int count = atomic_read(&site->count);
+	u64 total = atomic64_read(&site->total);
+	u64 max = atomic64_read(&site->max);
+
+	if (count)
+		do_div(total, count);
+
+	seq_printf(m, "  %-4s %10lu %10lu %10u  %pS -> %pS\n",
+		   site->irqsoff ? "irq" : "pre",
+		   nsecs_to_usecs(max), nsecs_to_usecs(total), count,
+		   (void *)site->ip, (void *)READ_ONCE(site->max_end));
+	return 0;
+}
+
+static struct tracer_stat irqsoff_site_stats = {
+	.name		= "irqsoff_sites",
+	.stat_start	= irqsoff_site_stat_start,
+	.stat_next	= irqsoff_site_stat_next,
+	.stat_cmp	= irqsoff_site_stat_cmp,
+	.stat_headers	= irqsoff_site_stat_headers,
+	.stat_show	= irqsoff_site_stat_show,
+};
+
 static void
 check_critical_timing(struct trace_array *tr,
 		      struct trace_array_cpu *data,
@@ -309,6 +473,9 @@ check_critical_timing(struct trace_array *tr,
 	T1 = ftrace_now(cpu);
 	delta = T1-T0;
 
+	irqsoff_site_account(data->critical_start, parent_ip,
+			     per_cpu(tracing_cpu_irqsoff, cpu), delta);
+
 	local_save_flags(flags);
 
 	pc = preempt_count();
@@ -373,6 +540,7 @@ start_critical_timing(unsigned long ip, unsigned long parent_ip)
 	data->critical_sequence = max_sequence;
 	data->preempt_timestamp = ftrace_now(cpu);
 	data->critical_start = parent_ip ? : ip;
+	per_cpu(tracing_cpu_irqsoff, cpu) = irqs_disabled();
 
 	local_save_flags(flags);
 
@@ -630,6 +798,7 @@ static int __irqsoff_tracer_init(struct trace_array *tr)
 	set_tracer_flag(tr, TRACE_ITER_LATENCY_FMT, 1);
 
 	tr->max_latency = 0;
+	irqsoff_sites_reset();
 	irqsoff_trace = tr;
 	/* make sure that the tracer is visible */
 	smp_wmb();
@@ -777,3 +946,12 @@ __init static int init_irqsoff_tracer(void)
 	return 0;
 }
 core_initcall(init_irqsoff_tracer);
+
+__init static int init_irqsoff_site_stats(void)
+{
+	if (register_stat_tracer(&irqsoff_site_stats))
+		pr_warn("Could not register irqsoff site stats\n");
+
+	return 0;
+}
+fs_initcall(init_irqsoff_site_stats);
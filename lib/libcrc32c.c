@@ -37,6 +37,20 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 
+#ifdef CONFIG_ARM64
+#include <asm/crc32c.h>
+#include <asm/hwcap.h>
+
+/*
+ * Below this size the crypto API call costs more than the checksum itself,
+ * so use the CRC instructions directly. Larger buffers still go through
+ * the crypto API, which picks up the interleaved arm64 implementation.
+ */
+#define CRC32C_DIRECT_MAX	512
+
+static bool crc32c_direct __read_mostly;
+#endif
+
 static struct crypto_shash *tfm;
 
 u32 crc32c(u32 crc, const void *address, unsigned int length)
@@ -45,6 +59,11 @@ u32 crc32c(u32 crc, const void *address, unsigned int length)
 	u32 *ctx = (u32 *)shash_desc_ctx(shash);
 	int err;
 
+#ifdef CONFIG_ARM64
+	if (crc32c_direct && length <= CRC32C_DIRECT_MAX)
+		return __crc32c_arm64_le_hw(crc, address, length);
+#endif
+
 	shash->tfm = tfm;
 	shash->flags = 0;
 	*ctx = crc;
@@ -60,7 +79,13 @@ EXPORT_SYMBOL(crc32c);
 static int __init libcrc32c_mod_init(void)
 {
 	tfm = crypto_alloc_shash("crc32c", 0, 0);
-	return PTR_ERR_OR_ZERO(tfm);
+	if (IS_ERR(tfm))
+		return PTR_ERR(tfm);
+
+#ifdef CONFIG_ARM64
+	crc32c_direct = elf_hwcap & HWCAP_CRC32;
+#endif
+	return 0;
 }
 
 static void __exit libcrc32c_mod_fini(void)
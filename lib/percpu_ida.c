@@ -25,6 +25,7 @@
 #include <linux/sched.h>
 #include <linux/string.h>
 #include <linux/spinlock.h>
+#include <linux/topology.h>
 #include <linux/percpu_ida.h>
 #include <linux/locallock.h>
 
@@ -51,20 +52,61 @@ static inline void move_tags(unsigned *dst, unsigned *dst_nr,
 	*dst_nr += nr;
 }
 
+/*
+ * Take half of the tags on @cpu's percpu freelist, so that the remote cpu
+ * can keep allocating and the two don't keep stealing the same tags back
+ * and forth.
+ */
+static inline bool steal_tags_from(struct percpu_ida *pool,
+				   struct percpu_ida_cpu *tags, unsigned cpu)
+{
+	struct percpu_ida_cpu *remote = per_cpu_ptr(pool->tag_cpu, cpu);
+
+	cpumask_clear_cpu(cpu, &pool->cpus_have_tags);
+
+	if (remote == tags)
+		return false;
+
+	spin_lock(&remote->lock);
+
+	if (remote->nr_free) {
+		move_tags(tags->freelist, &tags->nr_free,
+			  remote->freelist, &remote->nr_free,
+			  DIV_ROUND_UP(remote->nr_free, 2));
+
+		if (remote->nr_free)
+			cpumask_set_cpu(cpu, &pool->cpus_have_tags);
+	}
+
+	spin_unlock(&remote->lock);
+
+	if (!tags->nr_free)
+		return false;
+
+	pool->stats.steals++;
+	return true;
+}
+
 /*
  * Try to steal tags from a remote cpu's percpu freelist.
  *
- * We first check how many percpu freelists have tags
+ * We first try the cpus of our own cluster, which share a cache with us.
  *
- * Then we iterate through the cpus until we find some tags - we don't attempt
- * to find the "best" cpu to steal from, to keep cacheline bouncing to a
- * minimum.
+ * Then we check how many percpu freelists have tags, and iterate through the
+ * cpus until we find some tags - we don't attempt to find the "best" cpu to
+ * steal from, to keep cacheline bouncing to a minimum.
  */
 static inline void steal_tags(struct percpu_ida *pool,
 			      struct percpu_ida_cpu *tags)
 {
-	unsigned cpus_have_tags, cpu = pool->cpu_last_stolen;
-	struct percpu_ida_cpu *remote;
+	unsigned cpus_have_tags, cpu;
+
+	for_each_cpu_and(cpu, topology_core_cpumask(smp_processor_id()),
+			 &pool->cpus_have_tags)
+		if (steal_tags_from(pool, tags, cpu))
+			return;
+
+	cpu = pool->cpu_last_stolen;
 
 	for (cpus_have_tags = cpumask_weight(&pool->cpus_have_tags);
 	     cpus_have_tags; cpus_have_tags--) {
@@ -77,27 +119,8 @@ static inline void steal_tags(struct percpu_ida *pool,
 		}
 
 		pool->cpu_last_stolen = cpu;
-		remote = per_cpu_ptr(pool->tag_cpu, cpu);
-
-		cpumask_clear_cpu(cpu, &pool->cpus_have_tags);
-
-		if (remote == tags)
-			continue;
-
-		spin_lock(&remote->lock);
-
-		if (remote->nr_free) {
-			memcpy(tags->freelist,
-			       remote->freelist,
-			       sizeof(unsigned) * remote->nr_free);
-
-			tags->nr_free = remote->nr_free;
-			remote->nr_free = 0;
-		}
-
-		spin_unlock(&remote->lock);
 
-		if (tags->nr_free)
+		if (steal_tags_from(pool, tags, cpu))
 			break;
 	}
 }
@@ -149,6 +172,7 @@ int percpu_ida_alloc(struct percpu_ida *pool, int state)
 	DEFINE_WAIT(wait);
 	struct percpu_ida_cpu *tags;
 	unsigned long flags;
+	bool slow = false;
 	int tag;
 
 	local_lock_irqsave(irq_off_lock, flags);
@@ -164,6 +188,11 @@ int percpu_ida_alloc(struct percpu_ida *pool, int state)
 	while (1) {
 		spin_lock(&pool->lock);
 
+		if (!slow) {
+			pool->stats.alloc_slow++;
+			slow = true;
+		}
+
 		/*
 		 * prepare_to_wait() must come before steal_tags(), in case
 		 * percpu_ida_free() on another cpu flips a bit in
@@ -171,8 +200,13 @@ int percpu_ida_alloc(struct percpu_ida *pool, int state)
 		 *
 		 * global lock held and irqs disabled, don't need percpu lock
 		 */
-		if (state != TASK_RUNNING)
-			prepare_to_wait(&pool->wait, &wait, state);
+		if (state != TASK_RUNNING) {
+			if (pool->wake_batch > 1)
+				prepare_to_wait_exclusive(&pool->wait, &wait,
+							  state);
+			else
+				prepare_to_wait(&pool->wait, &wait, state);
+		}
 
 		if (!tags->nr_free)
 			alloc_global_tags(pool, tags);
@@ -185,6 +219,10 @@ int percpu_ida_alloc(struct percpu_ida *pool, int state)
 			if (tags->nr_free)
 				cpumask_set_cpu(smp_processor_id(),
 						&pool->cpus_have_tags);
+		} else if (state == TASK_RUNNING) {
+			pool->stats.failed++;
+		} else {
+			pool->stats.sleeps++;
 		}
 
 		spin_unlock(&pool->lock);
@@ -210,6 +248,22 @@ int percpu_ida_alloc(struct percpu_ida *pool, int state)
 }
 EXPORT_SYMBOL_GPL(percpu_ida_alloc);
 
+/*
+ * In wake batching mode waiters queue exclusively, and are woken up
+ * wake_batch at a time once as many tags have been freed, instead of all
+ * of them on every free.
+ */
+static inline void percpu_ida_batch_wake(struct percpu_ida *pool)
+{
+	/* Fully ordered, pairs with prepare_to_wait_exclusive() */
+	if (atomic_inc_return(&pool->wake_pending) < pool->wake_batch)
+		return;
+
+	atomic_set(&pool->wake_pending, 0);
+	if (waitqueue_active(&pool->wait))
+		wake_up_nr(&pool->wait, pool->wake_batch);
+}
+
 /**
  * percpu_ida_free - free a tag
  * @pool: pool @tag was allocated from
@@ -237,9 +291,13 @@ void percpu_ida_free(struct percpu_ida *pool, unsigned tag)
 	if (nr_free == 1) {
 		cpumask_set_cpu(smp_processor_id(),
 				&pool->cpus_have_tags);
-		wake_up(&pool->wait);
+		if (pool->wake_batch <= 1)
+			wake_up(&pool->wait);
 	}
 
+	if (pool->wake_batch > 1)
+		percpu_ida_batch_wake(pool);
+
 	if (nr_free == pool->percpu_max_size) {
 		spin_lock(&pool->lock);
 
@@ -299,6 +357,7 @@ int __percpu_ida_init(struct percpu_ida *pool, unsigned long nr_tags,
 	pool->nr_tags = nr_tags;
 	pool->percpu_max_size = max_size;
 	pool->percpu_batch_size = batch_size;
+	pool->wake_batch = 1;
 
 	/* Guard against overflow */
 	if (nr_tags > (unsigned) INT_MAX + 1) {
@@ -392,3 +451,38 @@ unsigned percpu_ida_free_tags(struct percpu_ida *pool, int cpu)
 	return remote->nr_free;
 }
 EXPORT_SYMBOL_GPL(percpu_ida_free_tags);
+
+/**
+ * percpu_ida_set_wake_batch - batch wakeups of waiters
+ * @pool: pool to configure
+ * @batch: number of frees per wakeup, 1 to wake waiters on every free
+ *
+ * With a batch larger than 1, waiters are woken up @batch at a time once
+ * @batch tags have been freed, instead of all of them whenever a percpu
+ * freelist becomes non-empty. The batch is capped to the pool size, so
+ * waiters are always woken once the whole tag space has been freed.
+ *
+ * Must be called before the pool is used.
+ */
+void percpu_ida_set_wake_batch(struct percpu_ida *pool, unsigned batch)
+{
+	pool->wake_batch = clamp(batch, 1U, pool->nr_tags);
+	atomic_set(&pool->wake_pending, 0);
+}
+EXPORT_SYMBOL_GPL(percpu_ida_set_wake_batch);
+
+/**
+ * percpu_ida_get_stats - read the contention counters of a pool
+ * @pool: pool related
+ * @stats: filled with a snapshot of the counters
+ */
+void percpu_ida_get_stats(struct percpu_ida *pool,
+			  struct percpu_ida_stats *stats)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	*stats = pool->stats;
+	spin_unlock_irqrestore(&pool->lock, flags);
+}
+EXPORT_SYMBOL_GPL(percpu_ida_get_stats);
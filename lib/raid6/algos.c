@@ -94,6 +94,9 @@ const struct raid6_recov_calls *const raid6_recov_algos[] = {
 #endif
 #ifdef CONFIG_AS_SSSE3
 	&raid6_recov_ssse3,
+#endif
+#ifdef CONFIG_KERNEL_MODE_NEON
+	&raid6_recov_neon,
 #endif
 	&raid6_recov_intx1,
 	NULL
@@ -375,6 +375,63 @@ static void rht_deferred_worker(struct work_struct *work)
 		schedule_work(&ht->run_work);
 }
 
+/**
+ * rhashtable_reserve - grow hash table ahead of a burst of insertions
+ * @ht:		the hash table to grow
+ * @n:		number of elements about to be inserted
+ *
+ * Synchronously expands the table so that @n more elements fit without
+ * crossing the 75% watermark, and finishes any resize in progress, so
+ * that bursty producers do not have to wait for the deferred worker.
+ * Tables using sync_resize call this from the insert path.
+ *
+ * Must be called from process context. Returns 0 on success or
+ * -ENOMEM if the larger table could not be allocated.
+ */
+int rhashtable_reserve(struct rhashtable *ht, unsigned int n)
+{
+	struct bucket_table *new_tbl, *tbl;
+	unsigned long want;
+	unsigned int size;
+	int err;
+
+	might_sleep();
+
+	mutex_lock(&ht->mutex);
+
+	while ((err = rhashtable_rehash_table(ht)) == -EAGAIN)
+		;
+
+	tbl = rht_dereference(ht->tbl, ht);
+	want = DIV_ROUND_UP(((unsigned long)atomic_read(&ht->nelems) + n) * 4,
+			    3);
+	if (ht->p.max_size && want > ht->p.max_size)
+		size = ht->p.max_size;
+	else
+		size = roundup_pow_of_two(want);
+	if (size <= tbl->size)
+		goto out;
+
+	new_tbl = bucket_table_alloc(ht, size, GFP_KERNEL);
+	if (!new_tbl) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	/* An atomic insert may have attached a table, rehash into it */
+	if (rhashtable_rehash_attach(ht, tbl, new_tbl))
+		bucket_table_free(new_tbl);
+
+	while ((err = rhashtable_rehash_table(ht)) == -EAGAIN)
+		;
+
+out:
+	mutex_unlock(&ht->mutex);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(rhashtable_reserve);
+
 static bool rhashtable_check_elasticity(struct rhashtable *ht,
 					struct bucket_table *tbl,
 					unsigned int hash)
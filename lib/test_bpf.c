@@ -5302,16 +5302,27 @@ static void release_filter(struct bpf_prog *fp, int which)
 	}
 }
 
+static bool bench;
+module_param(bench, bool, 0);
+MODULE_PARM_DESC(bench, "Time JITed tests against the interpreter");
+
+static u64 bench_jit_ns, bench_interp_ns;
+
 static int __run_one(const struct bpf_prog *fp, const void *data,
-		     int runs, u64 *duration)
+		     int runs, u64 *duration, bool interp)
 {
 	u64 start, finish;
 	int ret = 0, i;
 
 	start = ktime_get_ns();
 
-	for (i = 0; i < runs; i++)
-		ret = BPF_PROG_RUN(fp, data);
+	if (interp) {
+		for (i = 0; i < runs; i++)
+			ret = bpf_prog_run_interp(fp, data);
+	} else {
+		for (i = 0; i < runs; i++)
+			ret = BPF_PROG_RUN(fp, data);
+	}
 
 	finish = ktime_get_ns();
 
@@ -5321,6 +5332,25 @@ static int __run_one(const struct bpf_prog *fp, const void *data,
 	return ret;
 }
 
+/* Run the JITed @fp again through the interpreter, print both timings. */
+static int bench_one(const struct bpf_prog *fp, const void *data, int runs,
+		     u64 duration, u32 result)
+{
+	u64 interp;
+	u32 ret;
+
+	ret = __run_one(fp, data, runs, &interp, true);
+	if (ret != result) {
+		pr_cont("interpreter ret %d != %d ", ret, result);
+		return 1;
+	}
+
+	pr_cont("%lld/%lld ", duration, interp);
+	bench_jit_ns += duration;
+	bench_interp_ns += interp;
+	return 0;
+}
+
 static int run_one(const struct bpf_prog *fp, struct bpf_test *test)
 {
 	int err_cnt = 0, i, runs = MAX_TESTRUNS;
@@ -5340,16 +5370,19 @@ static int run_one(const struct bpf_prog *fp, struct bpf_test *test)
 			err_cnt++;
 			break;
 		}
-		ret = __run_one(fp, data, runs, &duration);
-		release_test_data(test, data);
+		ret = __run_one(fp, data, runs, &duration, false);
 
-		if (ret == test->test[i].result) {
-			pr_cont("%lld ", duration);
-		} else {
+		if (ret != test->test[i].result) {
 			pr_cont("ret %d != %d ", ret,
 				test->test[i].result);
 			err_cnt++;
+		} else if (bench && fp->jited) {
+			err_cnt += bench_one(fp, data, runs, duration,
+					     test->test[i].result);
+		} else {
+			pr_cont("%lld ", duration);
 		}
+		release_test_data(test, data);
 	}
 
 	return err_cnt;
@@ -5490,12 +5523,271 @@ static __init int test_bpf(void)
 
 	pr_info("Summary: %d PASSED, %d FAILED, [%d/%d JIT'ed]\n",
 		pass_cnt, err_cnt, jit_cnt, run_cnt);
+	if (bench && bench_interp_ns)
+		pr_info("Bench: JIT %llu ns, interpreter %llu ns\n",
+			bench_jit_ns, bench_interp_ns);
+
+	return err_cnt ? -EINVAL : 0;
+}
+
+struct tail_call_test {
+	const char *descr;
+	struct bpf_insn insns[MAX_INSNS];
+	int result;
+};
+
+/*
+ * Magic marker used in test snippets for tail calls below.
+ * BPF_LD/MOV to R2 and R2 with this immediate value is replaced
+ * with the proper values by the test runner.
+ */
+#define TAIL_CALL_MARKER 0x7a11e
+
+/* Special offset to indicate a NULL call target */
+#define TAIL_CALL_NULL 0x7fff
+
+/* Special offset to indicate an out-of-range index */
+#define TAIL_CALL_INVALID 0x7ffe
+
+#define TAIL_CALL(offset)						\
+	BPF_LD_IMM64(R2, TAIL_CALL_MARKER),				\
+	BPF_RAW_INSN(BPF_ALU | BPF_MOV | BPF_K, R3, 0,			\
+		     offset, TAIL_CALL_MARKER),				\
+	BPF_RAW_INSN(BPF_JMP | BPF_CALL | BPF_X, 0, 0, 0, 0)
+
+/*
+ * A test is the program at its own index of the prog array, the offset
+ * of a TAIL_CALL() is relative to that index. R1 starts out as NULL, so
+ * it can be used to count the calls.
+ */
+static struct tail_call_test tail_call_tests[] = {
+	{
+		"Tail call leaf",
+		.insns = {
+			BPF_ALU64_REG(BPF_MOV, R0, R1),
+			BPF_ALU64_IMM(BPF_ADD, R0, 1),
+			BPF_EXIT_INSN(),
+		},
+		.result = 1,
+	},
+	{
+		"Tail call 2",
+		.insns = {
+			BPF_ALU64_IMM(BPF_ADD, R1, 2),
+			TAIL_CALL(-1),
+			BPF_ALU64_IMM(BPF_MOV, R0, -1),
+			BPF_EXIT_INSN(),
+		},
+		.result = 3,
+	},
+	{
+		"Tail call 3",
+		.insns = {
+			BPF_ALU64_IMM(BPF_ADD, R1, 3),
+			TAIL_CALL(-1),
+			BPF_ALU64_IMM(BPF_MOV, R0, -1),
+			BPF_EXIT_INSN(),
+		},
+		.result = 6,
+	},
+	{
+		"Tail call error path, max count reached",
+		.insns = {
+			BPF_ALU64_IMM(BPF_ADD, R1, 1),
+			BPF_ALU64_REG(BPF_MOV, R0, R1),
+			TAIL_CALL(0),
+			BPF_EXIT_INSN(),
+		},
+		.result = MAX_TAIL_CALL_CNT + 2,
+	},
+	{
+		"Tail call error path, NULL target",
+		.insns = {
+			BPF_ALU64_IMM(BPF_MOV, R0, 1),
+			TAIL_CALL(TAIL_CALL_NULL),
+			BPF_EXIT_INSN(),
+		},
+		.result = 1,
+	},
+	{
+		"Tail call error path, index out of range",
+		.insns = {
+			BPF_ALU64_IMM(BPF_MOV, R0, 1),
+			TAIL_CALL(TAIL_CALL_INVALID),
+			BPF_EXIT_INSN(),
+		},
+		.result = 1,
+	},
+};
+
+static void __init destroy_tail_call_tests(struct bpf_array *progs)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(tail_call_tests); i++)
+		if (progs->ptrs[i])
+			bpf_prog_free(progs->ptrs[i]);
+	kfree(progs);
+}
+
+static __init int prepare_tail_call_tests(struct bpf_array **pprogs)
+{
+	int ntests = ARRAY_SIZE(tail_call_tests);
+	struct bpf_array *progs;
+	int which, err;
+
+	/* Allocate the table of programs to be used for tail calls */
+	progs = kzalloc(sizeof(*progs) + (ntests + 1) * sizeof(progs->ptrs[0]),
+			GFP_KERNEL);
+	if (!progs)
+		goto out_nomem;
+
+	/* The last entry is left NULL for the NULL target test */
+	progs->map.max_entries = ntests + 1;
+
+	/* Create all eBPF programs and populate the table */
+	for (which = 0; which < ntests; which++) {
+		struct tail_call_test *test = &tail_call_tests[which];
+		struct bpf_prog *fp;
+		int len, i;
+
+		/* Compute the number of program instructions */
+		for (len = MAX_INSNS - 1; len > 0; --len)
+			if (test->insns[len].code != 0 ||
+			    test->insns[len].imm != 0)
+				break;
+		len++;
+
+		/* Allocate and initialize the program */
+		fp = bpf_prog_alloc(bpf_prog_size(len), 0);
+		if (!fp)
+			goto out_nomem;
+
+		fp->len = len;
+		fp->type = BPF_PROG_TYPE_SOCKET_FILTER;
+		memcpy(fp->insnsi, test->insns, len * sizeof(struct bpf_insn));
+
+		/* Relocate runtime tail call offsets and addresses */
+		for (i = 0; i < len; i++) {
+			struct bpf_insn *insn = &fp->insnsi[i];
+			long addr = 0;
+
+			switch (insn->code) {
+			case BPF_LD | BPF_DW | BPF_IMM:
+				if (insn->imm != TAIL_CALL_MARKER)
+					break;
+				addr = (long)&progs->map;
+				insn[0].imm = (u32)addr;
+				insn[1].imm = addr >> 32;
+				break;
+
+			case BPF_ALU | BPF_MOV | BPF_K:
+				if (insn->imm != TAIL_CALL_MARKER)
+					break;
+				if (insn->off == TAIL_CALL_NULL)
+					insn->imm = ntests;
+				else if (insn->off == TAIL_CALL_INVALID)
+					insn->imm = ntests + 1;
+				else
+					insn->imm = which + insn->off;
+				insn->off = 0;
+			}
+		}
+
+		err = bpf_prog_select_runtime(fp);
+		if (err) {
+			bpf_prog_free(fp);
+			destroy_tail_call_tests(progs);
+			return err;
+		}
+
+		progs->ptrs[which] = fp;
+	}
+
+	*pprogs = progs;
+	return 0;
+
+out_nomem:
+	pr_err("out of memory allocating tail call tests\n");
+	if (progs)
+		destroy_tail_call_tests(progs);
+	return -ENOMEM;
+}
+
+/*
+ * A JITed program jumps straight into the image of its target, so the
+ * whole table has to be either JITed or interpreted.
+ */
+static __init bool tail_call_tests_mixed(struct bpf_array *progs)
+{
+	struct bpf_prog *first = progs->ptrs[0];
+	int i;
+
+	for (i = 1; i < ARRAY_SIZE(tail_call_tests); i++) {
+		struct bpf_prog *fp = progs->ptrs[i];
+
+		if (fp->jited != first->jited)
+			return true;
+	}
+	return false;
+}
+
+static __init int test_tail_calls(struct bpf_array *progs)
+{
+	int i, err_cnt = 0, pass_cnt = 0;
+	int jit_cnt = 0, run_cnt = 0;
+
+	if (tail_call_tests_mixed(progs)) {
+		pr_info("Tail call tests need all programs JITed or none, skipping\n");
+		return 0;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(tail_call_tests); i++) {
+		struct tail_call_test *test = &tail_call_tests[i];
+		struct bpf_prog *fp = progs->ptrs[i];
+		u64 duration;
+		int ret;
+
+		cond_resched();
+
+		pr_info("#%d %s ", i, test->descr);
+		pr_cont("jited:%u ", fp->jited);
+
+		run_cnt++;
+		if (fp->jited)
+			jit_cnt++;
+
+		ret = __run_one(fp, NULL, MAX_TESTRUNS, &duration, false);
+		if (ret != test->result) {
+			pr_cont("ret %d != %d FAIL\n", ret, test->result);
+			err_cnt++;
+			continue;
+		}
+
+		if (bench && fp->jited) {
+			if (bench_one(fp, NULL, MAX_TESTRUNS, duration,
+				      test->result)) {
+				pr_cont("FAIL\n");
+				err_cnt++;
+				continue;
+			}
+		} else {
+			pr_cont("%lld ", duration);
+		}
+
+		pr_cont("PASS\n");
+		pass_cnt++;
+	}
+
+	pr_info("%s: Summary: %d PASSED, %d FAILED, [%d/%d JIT'ed]\n",
+		__func__, pass_cnt, err_cnt, jit_cnt, run_cnt);
 
 	return err_cnt ? -EINVAL : 0;
 }
 
 static int __init test_bpf_init(void)
 {
+	struct bpf_array *progs = NULL;
 	int ret;
 
 	ret = prepare_bpf_tests();
@@ -5503,8 +5795,16 @@ static int __init test_bpf_init(void)
 		return ret;
 
 	ret = test_bpf();
-
 	destroy_bpf_tests();
+	if (ret)
+		return ret;
+
+	ret = prepare_tail_call_tests(&progs);
+	if (ret)
+		return ret;
+	ret = test_tail_calls(progs);
+	destroy_tail_call_tests(progs);
+
 	return ret;
 }
 
@@ -0,0 +1,152 @@
+/*
+ * Kernel module for checking and timing memcpy() and the user copy
+ * routines by size class.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mman.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/sizes.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#define TEST_COPY_MAX	SZ_1M
+
+static unsigned int total = SZ_64M;
+module_param(total, uint, 0444);
+MODULE_PARM_DESC(total, "Number of bytes copied per size class and routine");
+
+static const unsigned int test_copy_sizes[] = {
+	64, 256, SZ_1K, SZ_4K, SZ_16K, SZ_64K, SZ_256K, TEST_COPY_MAX,
+};
+
+enum test_copy_op {
+	TEST_COPY_MEMCPY,
+	TEST_COPY_TO_USER,
+	TEST_COPY_FROM_USER,
+};
+
+static const char * const test_copy_names[] = {
+	[TEST_COPY_MEMCPY]	= "memcpy",
+	[TEST_COPY_TO_USER]	= "copy_to_user",
+	[TEST_COPY_FROM_USER]	= "copy_from_user",
+};
+
+static int test_copy_run(enum test_copy_op op, u8 *dst, u8 *src,
+			 u8 __user *usermem, unsigned int len)
+{
+	unsigned int i, loops = max_t(unsigned int, total / len, 1);
+	unsigned long left = 0;
+	ktime_t start;
+	u64 ns, mbps;
+
+	start = ktime_get();
+	for (i = 0; i < loops && !left; i++) {
+		switch (op) {
+		case TEST_COPY_MEMCPY:
+			memcpy(dst, src, len);
+			break;
+		case TEST_COPY_TO_USER:
+			left = copy_to_user(usermem, src, len);
+			break;
+		case TEST_COPY_FROM_USER:
+			left = copy_from_user(dst, usermem, len);
+			break;
+		}
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (left) {
+		pr_err("%s: %lu of %u bytes not copied\n",
+		       test_copy_names[op], left, len);
+		return -EFAULT;
+	}
+
+	/* After copy_to_user() the user buffer is checked by the next op */
+	if (op != TEST_COPY_TO_USER && memcmp(dst, src, len)) {
+		pr_err("%s: data mismatch at size %u\n",
+		       test_copy_names[op], len);
+		return -EINVAL;
+	}
+
+	mbps = ns ? div64_u64((u64)len * loops * NSEC_PER_SEC,
+			      ns * SZ_1M) : 0;
+	pr_info("%s: %u bytes x %u in %llu ns, %llu MB/s\n",
+		test_copy_names[op], len, loops, ns, mbps);
+
+	return 0;
+}
+
+static int __init test_copy_bw_init(void)
+{
+	unsigned long user_addr;
+	u8 __user *usermem;
+	unsigned int i;
+	u8 *src, *dst;
+	int ret = -ENOMEM;
+
+	if (!total)
+		return -EINVAL;
+
+	src = vmalloc(TEST_COPY_MAX);
+	dst = vmalloc(TEST_COPY_MAX);
+	if (!src || !dst)
+		goto out_free;
+
+	user_addr = vm_mmap(NULL, 0, TEST_COPY_MAX, PROT_READ | PROT_WRITE,
+			    MAP_ANONYMOUS | MAP_PRIVATE, 0);
+	if (user_addr >= (unsigned long)(TASK_SIZE)) {
+		pr_warn("Failed to allocate user memory\n");
+		goto out_free;
+	}
+	usermem = (u8 __user *)user_addr;
+
+	get_random_bytes(src, TEST_COPY_MAX);
+
+	for (i = 0; i < ARRAY_SIZE(test_copy_sizes); i++) {
+		ret = test_copy_run(TEST_COPY_MEMCPY, dst, src, usermem,
+				    test_copy_sizes[i]);
+		if (!ret)
+			ret = test_copy_run(TEST_COPY_TO_USER, dst, src,
+					    usermem, test_copy_sizes[i]);
+		if (!ret)
+			ret = test_copy_run(TEST_COPY_FROM_USER, dst, src,
+					    usermem, test_copy_sizes[i]);
+		if (ret)
+			break;
+	}
+
+	if (!ret)
+		pr_info("all tests passed\n");
+
+	vm_munmap(user_addr, TEST_COPY_MAX);
+out_free:
+	vfree(dst);
+	vfree(src);
+
+	return ret;
+}
+module_init(test_copy_bw_init);
+
+static void __exit test_copy_bw_exit(void)
+{
+}
+module_exit(test_copy_bw_exit);
+
+MODULE_DESCRIPTION("memcpy and user copy test and benchmark");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,195 @@
+/*
+ * Kernel module for checking and timing the LZO and LZ4 decompressors.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/ktime.h>
+#include <linux/lz4.h>
+#include <linux/lzo.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/sizes.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+static unsigned int size = SZ_128K;
+module_param(size, uint, 0444);
+MODULE_PARM_DESC(size, "Size of the test corpus in bytes");
+
+static unsigned int loops = 64;
+module_param(loops, uint, 0444);
+MODULE_PARM_DESC(loops, "Number of timed decompressions per algorithm");
+
+/*
+ * The corpus mixes runs copied from earlier in the buffer at short and
+ * long distances, byte runs and random literals, so both the literal and
+ * the (overlapping) match copy paths get exercised.
+ */
+static void test_decompress_fill(u8 *buf, size_t len)
+{
+	static const char words[] =
+		"the quick brown fox jumps over the lazy dog ";
+	size_t pos = 0, from, n;
+	u32 r;
+
+	while (pos < len) {
+		r = prandom_u32();
+		n = min_t(size_t, len - pos, 4 + (r & 63));
+
+		switch ((r >> 8) & 3) {
+		case 0:
+			get_random_bytes(buf + pos, n);
+			break;
+		case 1:
+			memset(buf + pos, r >> 16, n);
+			break;
+		case 2:
+			if (pos > n) {
+				from = pos - 1 - (r >> 16) % (pos - n);
+				memmove(buf + pos, buf + from, n);
+				break;
+			}
+			/* fall through */
+		default:
+			n = min_t(size_t, n, sizeof(words) - 1);
+			memcpy(buf + pos, words, n);
+			break;
+		}
+
+		pos += n;
+	}
+}
+
+static void test_decompress_report(const char *name, size_t len, u64 ns)
+{
+	u64 mbps = ns ? div64_u64((u64)len * loops * NSEC_PER_SEC,
+				  ns * SZ_1M) : 0;
+
+	pr_info("%s: %zu bytes x %u in %llu ns, %llu MB/s\n",
+		name, len, loops, ns, mbps);
+}
+
+static int test_decompress_lzo(const u8 *src, size_t len, u8 *comp, u8 *out,
+			       void *wrkmem)
+{
+	size_t comp_len, out_len;
+	unsigned int i;
+	ktime_t start;
+	int ret;
+
+	ret = lzo1x_1_compress(src, len, comp, &comp_len, wrkmem);
+	if (ret != LZO_E_OK) {
+		pr_err("lzo: compression failed: %d\n", ret);
+		return -EINVAL;
+	}
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++) {
+		out_len = len;
+		ret = lzo1x_decompress_safe(comp, comp_len, out, &out_len);
+		if (ret != LZO_E_OK || out_len != len) {
+			pr_err("lzo: decompression failed: %d\n", ret);
+			return -EINVAL;
+		}
+	}
+	test_decompress_report("lzo", len, ktime_to_ns(ktime_sub(ktime_get(),
+								 start)));
+
+	if (memcmp(src, out, len)) {
+		pr_err("lzo: data mismatch\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int test_decompress_lz4(const u8 *src, size_t len, u8 *comp, u8 *out,
+			       void *wrkmem)
+{
+	size_t comp_len, in_len;
+	unsigned int i;
+	ktime_t start;
+	int ret;
+
+	ret = lz4_compress(src, len, comp, &comp_len, wrkmem);
+	if (ret) {
+		pr_err("lz4: compression failed: %d\n", ret);
+		return -EINVAL;
+	}
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++) {
+		in_len = comp_len;
+		ret = lz4_decompress(comp, &in_len, out, len);
+		if (ret || in_len != comp_len) {
+			pr_err("lz4: decompression failed: %d\n", ret);
+			return -EINVAL;
+		}
+	}
+	test_decompress_report("lz4", len, ktime_to_ns(ktime_sub(ktime_get(),
+								 start)));
+
+	if (memcmp(src, out, len)) {
+		pr_err("lz4: data mismatch\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int __init test_decompress_init(void)
+{
+	size_t comp_size;
+	u8 *src, *comp, *out;
+	void *wrkmem;
+	int ret = -ENOMEM;
+
+	if (!size || !loops)
+		return -EINVAL;
+
+	comp_size = max_t(size_t, lzo1x_worst_compress(size),
+			  lz4_compressbound(size));
+
+	src = vmalloc(size);
+	comp = vmalloc(comp_size);
+	out = vmalloc(size);
+	wrkmem = vmalloc(max(LZO1X_1_MEM_COMPRESS, LZ4_MEM_COMPRESS));
+	if (!src || !comp || !out || !wrkmem)
+		goto out;
+
+	test_decompress_fill(src, size);
+
+	ret = test_decompress_lzo(src, size, comp, out, wrkmem);
+	if (!ret)
+		ret = test_decompress_lz4(src, size, comp, out, wrkmem);
+
+	if (!ret)
+		pr_info("all tests passed\n");
+out:
+	vfree(wrkmem);
+	vfree(out);
+	vfree(comp);
+	vfree(src);
+
+	return ret;
+}
+module_init(test_decompress_init);
+
+static void __exit test_decompress_exit(void)
+{
+}
+module_exit(test_decompress_exit);
+
+MODULE_DESCRIPTION("LZO and LZ4 decompression test and benchmark");
+MODULE_LICENSE("GPL");
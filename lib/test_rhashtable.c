@@ -15,6 +15,7 @@
 
 #include <linux/init.h>
 #include <linux/jhash.h>
+#include <linux/ktime.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
 #include <linux/module.h>
@@ -27,6 +28,7 @@
 
 #define MAX_ENTRIES	1000000
 #define TEST_INSERT_FAIL INT_MAX
+#define MAX_BATCH	64
 
 static int entries = 50000;
 module_param(entries, int, 0);
@@ -52,6 +54,18 @@ static int tcount = 10;
 module_param(tcount, int, 0);
 MODULE_PARM_DESC(tcount, "Number of threads to spawn (default: 10)");
 
+static int batch;
+module_param(batch, int, 0);
+MODULE_PARM_DESC(batch, "Insert in batches of this many objects (default: 0, off)");
+
+static bool sync_resize;
+module_param(sync_resize, bool, 0);
+MODULE_PARM_DESC(sync_resize, "Resize synchronously on insert (default: off)");
+
+static bool bench;
+module_param(bench, bool, 0);
+MODULE_PARM_DESC(bench, "Report ops/sec for 1 up to all online CPUs (default: off)");
+
 struct test_obj {
 	int			value;
 	struct rhash_head	node;
@@ -61,6 +75,7 @@ struct thread_data {
 	int id;
 	struct task_struct *task;
 	struct test_obj *objs;
+	ktime_t end;
 };
 
 static struct test_obj array[MAX_ENTRIES];
@@ -111,6 +126,53 @@ static int __init test_rht_lookup(struct rhashtable *ht)
 	return 0;
 }
 
+/*
+ * Insert @n objects, in batches if requested. Objects that could not be
+ * inserted due to memory pressure are marked and counted in @fails.
+ */
+static int insert_objs(struct rhashtable *ht, struct test_obj *objs,
+		       unsigned int n, unsigned int *fails)
+{
+	struct rhash_head *heads[MAX_BATCH];
+	unsigned int i;
+	int err;
+
+	if (!batch) {
+		for (i = 0; i < n; i++) {
+			err = rhashtable_insert_fast(ht, &objs[i].node,
+						     test_rht_params);
+			if (err == -ENOMEM || err == -EBUSY) {
+				objs[i].value = TEST_INSERT_FAIL;
+				(*fails)++;
+			} else if (err) {
+				return err;
+			}
+		}
+		return 0;
+	}
+
+	for (i = 0; i < n; i++)
+		heads[i] = &objs[i].node;
+
+	err = rhashtable_insert_fast_batch(ht, heads, n, test_rht_params);
+	if (err != -ENOMEM && err != -EBUSY)
+		return err;
+
+	for (i = 0; i < n; i++) {
+		if (heads[i]) {
+			objs[i].value = TEST_INSERT_FAIL;
+			(*fails)++;
+		}
+	}
+
+	return 0;
+}
+
+static unsigned int insert_step(void)
+{
+	return batch ? batch : 1;
+}
+
 static void test_bucket_stats(struct rhashtable *ht)
 {
 	unsigned int err, total = 0, chain_len = 0;
@@ -166,19 +228,17 @@ static s64 __init test_rhashtable(struct rhashtable *ht)
 	 */
 	pr_info("  Adding %d keys\n", entries);
 	start = ktime_get_ns();
-	for (i = 0; i < entries; i++) {
-		struct test_obj *obj = &array[i];
-
-		obj->value = i * 2;
-
-		err = rhashtable_insert_fast(ht, &obj->node, test_rht_params);
-		if (err == -ENOMEM || err == -EBUSY) {
-			/* Mark failed inserts but continue */
-			obj->value = TEST_INSERT_FAIL;
-			insert_fails++;
-		} else if (err) {
+	for (i = 0; i < entries; i++)
+		array[i].value = i * 2;
+
+	for (i = 0; i < entries; i += insert_step()) {
+		/* Failed inserts are marked, but the test continues */
+		err = insert_objs(ht, &array[i],
+				  min_t(unsigned int, entries - i,
+					insert_step()),
+				  &insert_fails);
+		if (err)
 			return err;
-		}
 
 		cond_resched();
 	}
@@ -242,28 +302,30 @@ static int thread_lookup_test(struct thread_data *tdata)
 
 static int threadfunc(void *data)
 {
-	int i, step, err = 0, insert_fails = 0;
+	int i, step, err = 0;
+	unsigned int insert_fails = 0;
 	struct thread_data *tdata = data;
 
 	up(&prestart_sem);
 	if (down_interruptible(&startup_sem))
 		pr_err("  thread[%d]: down_interruptible failed\n", tdata->id);
 
-	for (i = 0; i < entries; i++) {
+	for (i = 0; i < entries; i++)
 		tdata->objs[i].value = (tdata->id << 16) | i;
-		err = rhashtable_insert_fast(&ht, &tdata->objs[i].node,
-		                             test_rht_params);
-		if (err == -ENOMEM || err == -EBUSY) {
-			tdata->objs[i].value = TEST_INSERT_FAIL;
-			insert_fails++;
-		} else if (err) {
+
+	for (i = 0; i < entries; i += insert_step()) {
+		err = insert_objs(&ht, &tdata->objs[i],
+				  min_t(unsigned int, entries - i,
+					insert_step()),
+				  &insert_fails);
+		if (err) {
 			pr_err("  thread[%d]: rhashtable_insert_fast failed\n",
 			       tdata->id);
 			goto out;
 		}
 	}
 	if (insert_fails)
-		pr_info("  thread[%d]: %d insert failures\n",
+		pr_info("  thread[%d]: %u insert failures\n",
 		        tdata->id, insert_fails);
 
 	err = thread_lookup_test(tdata);
@@ -301,6 +363,134 @@ out:
 	return err;
 }
 
+static int bench_threadfunc(void *data)
+{
+	struct thread_data *tdata = data;
+	unsigned int insert_fails = 0;
+	int i, err;
+
+	for (i = 0; i < entries; i++)
+		tdata->objs[i].value = (tdata->id << 16) | i;
+
+	for (i = 0; i < entries; i += insert_step()) {
+		err = insert_objs(&ht, &tdata->objs[i],
+				  min_t(unsigned int, entries - i,
+					insert_step()),
+				  &insert_fails);
+		if (err)
+			goto out;
+	}
+
+	err = thread_lookup_test(tdata);
+	if (err)
+		goto out;
+
+	for (i = 0; i < entries; i++) {
+		if (tdata->objs[i].value == TEST_INSERT_FAIL)
+			continue;
+		err = rhashtable_remove_fast(&ht, &tdata->objs[i].node,
+					     test_rht_params);
+		if (err)
+			goto out;
+	}
+
+out:
+	tdata->end = ktime_get();
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		schedule();
+	}
+	return err;
+}
+
+/*
+ * Every thread inserts, looks up and removes its own entries. The rate
+ * reported counts all three operations over the wall time of the run.
+ */
+static int __init test_rht_bench_run(int threads, struct thread_data *tdata,
+				     struct test_obj *objs)
+{
+	ktime_t start, end;
+	int i, err = 0;
+	u64 ns, ops;
+
+	err = rhashtable_init(&ht, &test_rht_params);
+	if (err < 0)
+		return err;
+
+	for (i = 0; i < threads; i++) {
+		tdata[i].id = i;
+		tdata[i].objs = objs + i * entries;
+		tdata[i].task = kthread_create(bench_threadfunc, &tdata[i],
+					       "rhashtable_bench[%d]", i);
+		if (IS_ERR(tdata[i].task)) {
+			err = PTR_ERR(tdata[i].task);
+			threads = i;
+			break;
+		}
+	}
+
+	start = ktime_get();
+	for (i = 0; i < threads; i++)
+		wake_up_process(tdata[i].task);
+
+	end = start;
+	for (i = 0; i < threads; i++) {
+		int ret = kthread_stop(tdata[i].task);
+
+		if (ret && !err)
+			err = ret;
+		if (ktime_after(tdata[i].end, end))
+			end = tdata[i].end;
+	}
+
+	rhashtable_destroy(&ht);
+	if (err)
+		return err;
+
+	ns = ktime_to_ns(ktime_sub(end, start));
+	ops = (u64)threads * entries * 3;
+	pr_info("  %d threads: %llu ops in %llu ns, %llu ops/sec\n",
+		threads, ops, ns,
+		ns ? div64_u64(ops * NSEC_PER_SEC, ns) : 0);
+
+	return 0;
+}
+
+static int __init test_rht_bench(void)
+{
+	int cpus = num_online_cpus();
+	struct thread_data *tdata;
+	struct test_obj *objs;
+	int threads, err = 0;
+
+	pr_info("Benchmarking rhashtable with up to %d threads, batch=%d, sync_resize=%d\n",
+		cpus, batch, sync_resize);
+
+	tdata = vzalloc(cpus * sizeof(struct thread_data));
+	objs = vzalloc(cpus * entries * sizeof(struct test_obj));
+	if (!tdata || !objs) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	for (threads = 1; ; threads = min(threads * 2, cpus)) {
+		err = test_rht_bench_run(threads, tdata, objs);
+		if (err) {
+			pr_warn("Test failed: benchmark with %d threads: %d\n",
+				threads, err);
+			break;
+		}
+		if (threads == cpus)
+			break;
+	}
+
+out:
+	vfree(objs);
+	vfree(tdata);
+	return err;
+}
+
 static int __init test_rht_init(void)
 {
 	int i, err, started_threads = 0, failed_threads = 0;
@@ -309,10 +499,15 @@ static int __init test_rht_init(void)
 	struct test_obj *objs;
 
 	entries = min(entries, MAX_ENTRIES);
+	batch = clamp(batch, 0, MAX_BATCH);
 
 	test_rht_params.automatic_shrinking = shrinking;
 	test_rht_params.max_size = max_size;
 	test_rht_params.nelem_hint = size;
+	test_rht_params.sync_resize = sync_resize;
+
+	if (bench)
+		return test_rht_bench();
 
 	pr_info("Running rhashtable test nelem=%d, max_size=%d, shrinking=%d\n",
 		size, max_size, shrinking);
@@ -103,9 +103,17 @@ static int br_dev_init(struct net_device *dev)
 	if (!br->stats)
 		return -ENOMEM;
 
+	err = br_fdb_learn_init(br);
+	if (err) {
+		free_percpu(br->stats);
+		return err;
+	}
+
 	err = br_vlan_init(br);
-	if (err)
+	if (err) {
+		free_percpu(br->fdb_learn);
 		free_percpu(br->stats);
+	}
 	br_set_lockdep_class(dev);
 
 	return err;
@@ -354,6 +362,7 @@ static void br_dev_free(struct net_device *dev)
 {
 	struct net_bridge *br = netdev_priv(dev);
 
+	free_percpu(br->fdb_learn);
 	free_percpu(br->stats);
 	free_netdev(dev);
 }
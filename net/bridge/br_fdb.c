@@ -153,7 +153,8 @@ static void fdb_delete(struct net_bridge *br, struct net_bridge_fdb_entry *f)
 	if (f->added_by_external_learn)
 		fdb_del_external_learn(f);
 
-	hlist_del_rcu(&f->hlist);
+	/* unhashed for br_fdb_cleanup(), which looks up entries locklessly */
+	hlist_del_init_rcu(&f->hlist);
 	fdb_notify(br, f, RTM_DELNEIGH);
 	call_rcu(&f->rcu, fdb_rcu_free);
 }
@@ -294,25 +295,35 @@ void br_fdb_cleanup(unsigned long _data)
 	unsigned long next_timer = jiffies + br->ageing_time;
 	int i;
 
-	spin_lock(&br->hash_lock);
+	/* Scan the buckets by RCU and only take the hash lock to delete an
+	 * expired entry, so that the scan does not hold off learning.
+	 */
+	rcu_read_lock();
 	for (i = 0; i < BR_HASH_SIZE; i++) {
 		struct net_bridge_fdb_entry *f;
-		struct hlist_node *n;
 
-		hlist_for_each_entry_safe(f, n, &br->hash[i], hlist) {
+		hlist_for_each_entry_rcu(f, &br->hash[i], hlist) {
 			unsigned long this_timer;
 			if (f->is_static)
 				continue;
 			if (f->added_by_external_learn)
 				continue;
 			this_timer = f->updated + delay;
-			if (time_before_eq(this_timer, jiffies))
-				fdb_delete(br, f);
-			else if (time_before(this_timer, next_timer))
+			if (time_before_eq(this_timer, jiffies)) {
+				spin_lock(&br->hash_lock);
+				/* recheck, it may have changed meanwhile */
+				if (!hlist_unhashed(&f->hlist) &&
+				    !f->is_static &&
+				    !f->added_by_external_learn &&
+				    time_before_eq(f->updated + delay, jiffies))
+					fdb_delete(br, f);
+				spin_unlock(&br->hash_lock);
+			} else if (time_before(this_timer, next_timer)) {
 				next_timer = this_timer;
+			}
 		}
 	}
-	spin_unlock(&br->hash_lock);
+	rcu_read_unlock();
 
 	mod_timer(&br->gc_timer, round_jiffies_up(next_timer));
 }
@@ -559,6 +570,125 @@ int br_fdb_insert(struct net_bridge *br, struct net_bridge_port *source,
 	return ret;
 }
 
+int br_fdb_learn_init(struct net_bridge *br)
+{
+	int cpu;
+
+	br->fdb_learn = alloc_percpu(struct net_bridge_fdb_learn_queue);
+	if (!br->fdb_learn)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(br->fdb_learn, cpu)->lock);
+
+	return 0;
+}
+
+/* Add the addresses of learn queue @q to the fdb. Called under hash_lock. */
+static void fdb_learn_flush(struct net_bridge *br,
+			    struct net_bridge_fdb_learn_queue *q)
+{
+	unsigned int i;
+
+	spin_lock(&q->lock);
+	for (i = 0; i < q->count; i++) {
+		struct net_bridge_fdb_learn *l = &q->ent[i];
+		const unsigned char *addr = l->addr.addr;
+		struct net_bridge_fdb_entry *fdb;
+		struct hlist_head *head;
+
+		/* the port may have stopped learning since */
+		if (!(l->dst->state == BR_STATE_LEARNING ||
+		      l->dst->state == BR_STATE_FORWARDING))
+			continue;
+
+		head = &br->hash[br_mac_hash(addr, l->vlan_id)];
+		/* someone else may have inserted it first */
+		if (fdb_find(head, addr, l->vlan_id))
+			continue;
+
+		fdb = fdb_create(head, l->dst, addr, l->vlan_id, 0, 0);
+		if (fdb)
+			fdb_notify(br, fdb, RTM_NEWNEIGH);
+	}
+	q->count = 0;
+	spin_unlock(&q->lock);
+}
+
+void br_fdb_learn_timer_expired(unsigned long _data)
+{
+	struct net_bridge *br = (struct net_bridge *)_data;
+	int cpu;
+
+	spin_lock(&br->hash_lock);
+	for_each_possible_cpu(cpu)
+		fdb_learn_flush(br, per_cpu_ptr(br->fdb_learn, cpu));
+	spin_unlock(&br->hash_lock);
+}
+
+/* Forget the addresses queued on port @p, which is going away */
+void br_fdb_learn_purge(struct net_bridge *br,
+			const struct net_bridge_port *p)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct net_bridge_fdb_learn_queue *q;
+		unsigned int i, n = 0;
+
+		q = per_cpu_ptr(br->fdb_learn, cpu);
+		spin_lock_bh(&q->lock);
+		for (i = 0; i < q->count; i++)
+			if (q->ent[i].dst != p)
+				q->ent[n++] = q->ent[i];
+		q->count = n;
+		spin_unlock_bh(&q->lock);
+	}
+}
+
+/* Queue a new address for learning on this cpu. New addresses are added
+ * to the fdb in batches, within a jiffy or once the queue is full, so
+ * that a burst of them does not take the hash lock for each one.
+ */
+static void fdb_learn_queue(struct net_bridge *br,
+			    struct net_bridge_port *source,
+			    const unsigned char *addr, u16 vid)
+{
+	struct net_bridge_fdb_learn_queue *q = raw_cpu_ptr(br->fdb_learn);
+	struct net_bridge_fdb_learn *l;
+	bool full = false;
+	unsigned int i;
+
+	spin_lock(&q->lock);
+	for (i = 0; i < q->count; i++) {
+		l = &q->ent[i];
+		if (ether_addr_equal(l->addr.addr, addr) && l->vlan_id == vid) {
+			l->dst = source;
+			goto out;
+		}
+	}
+
+	/* being flushed, the address is learnt from the next frame then */
+	if (unlikely(q->count == BR_FDB_LEARN_BATCH))
+		goto out;
+
+	l = &q->ent[q->count++];
+	l->dst = source;
+	memcpy(l->addr.addr, addr, ETH_ALEN);
+	l->vlan_id = vid;
+	full = q->count == BR_FDB_LEARN_BATCH;
+out:
+	spin_unlock(&q->lock);
+
+	if (full) {
+		spin_lock(&br->hash_lock);
+		fdb_learn_flush(br, q);
+		spin_unlock(&br->hash_lock);
+	} else if (!timer_pending(&br->fdb_learn_timer)) {
+		mod_timer(&br->fdb_learn_timer, jiffies + 1);
+	}
+}
+
 void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 		   const unsigned char *addr, u16 vid, bool added_by_user)
 {
@@ -588,13 +718,17 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 			if (unlikely(source != fdb->dst)) {
 				fdb->dst = source;
 				fdb_modified = true;
+				fdb->updated = jiffies;
+			} else {
+				br_fdb_refresh(&fdb->updated);
 			}
-			fdb->updated = jiffies;
 			if (unlikely(added_by_user))
 				fdb->added_by_user = 1;
 			if (unlikely(fdb_modified))
 				fdb_notify(br, fdb, RTM_NEWNEIGH);
 		}
+	} else if (likely(!added_by_user)) {
+		fdb_learn_queue(br, source, addr, vid);
 	} else {
 		spin_lock(&br->hash_lock);
 		if (likely(!fdb_find(head, addr, vid))) {
@@ -261,6 +261,9 @@ static void del_nbp(struct net_bridge_port *p)
 
 	netdev_rx_handler_unregister(dev);
 
+	/* no more frames can queue addresses learnt on the port by now */
+	br_fdb_learn_purge(br, p);
+
 	br_multicast_del_port(p);
 
 	kobject_uevent(&p->kobj, KOBJ_REMOVE);
@@ -286,6 +289,7 @@ void br_dev_delete(struct net_device *dev, struct list_head *head)
 	br_vlan_flush(br);
 	br_multicast_dev_del(br);
 	del_timer_sync(&br->gc_timer);
+	del_timer_sync(&br->fdb_learn_timer);
 
 	br_sysfs_delbr(br->dev);
 	unregister_netdevice_queue(br->dev, head);
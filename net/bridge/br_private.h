@@ -27,6 +27,11 @@
 
 #define BR_HOLD_TIME (1*HZ)
 
+/* fdb timestamps are not refreshed more often than this */
+#define BR_FDB_REFRESH_TIME (HZ/10)
+/* addresses learnt per cpu before they are added under the hash lock */
+#define BR_FDB_LEARN_BATCH 16
+
 #define BR_PORT_BITS	10
 #define BR_MAX_PORTS	(1<<BR_PORT_BITS)
 
@@ -150,6 +155,32 @@ struct net_bridge_fdb_entry
 	struct rcu_head			rcu;
 };
 
+/* Per cpu queue of addresses learnt from received frames, that are added
+ * to the fdb by br_fdb_learn_timer_expired() or once the queue is full.
+ */
+struct net_bridge_fdb_learn {
+	struct net_bridge_port		*dst;
+	mac_addr			addr;
+	__u16				vlan_id;
+};
+
+struct net_bridge_fdb_learn_queue {
+	spinlock_t			lock;
+	unsigned int			count;
+	struct net_bridge_fdb_learn	ent[BR_FDB_LEARN_BATCH];
+};
+
+/* Refresh the updated/used timestamp of an fdb entry from the packet path,
+ * without dirtying the cache line of hot entries on every frame.
+ */
+static inline void br_fdb_refresh(unsigned long *stamp)
+{
+	unsigned long now = jiffies;
+
+	if (time_after(now, *stamp + BR_FDB_REFRESH_TIME))
+		*stamp = now;
+}
+
 struct net_bridge_port_group {
 	struct net_bridge_port		*port;
 	struct net_bridge_port_group __rcu *next;
@@ -258,6 +289,7 @@ struct net_bridge
 	struct pcpu_sw_netstats		__percpu *stats;
 	spinlock_t			hash_lock;
 	struct hlist_head		hash[BR_HASH_SIZE];
+	struct net_bridge_fdb_learn_queue __percpu *fdb_learn;
 #if IS_ENABLED(CONFIG_BRIDGE_NETFILTER)
 	union {
 		struct rtable		fake_rtable;
@@ -334,6 +366,7 @@ struct net_bridge
 	struct timer_list		tcn_timer;
 	struct timer_list		topology_change_timer;
 	struct timer_list		gc_timer;
+	struct timer_list		fdb_learn_timer;
 	struct kobject			*ifobj;
 	u32				auto_cnt;
 #ifdef CONFIG_BRIDGE_VLAN_FILTERING
@@ -455,6 +488,10 @@ void br_fdb_find_delete_local(struct net_bridge *br,
 void br_fdb_changeaddr(struct net_bridge_port *p, const unsigned char *newaddr);
 void br_fdb_change_mac_address(struct net_bridge *br, const u8 *newaddr);
 void br_fdb_cleanup(unsigned long arg);
+int br_fdb_learn_init(struct net_bridge *br);
+void br_fdb_learn_timer_expired(unsigned long arg);
+void br_fdb_learn_purge(struct net_bridge *br,
+			const struct net_bridge_port *p);
 void br_fdb_delete_by_port(struct net_bridge *br,
 			   const struct net_bridge_port *p, u16 vid, int do_all);
 struct net_bridge_fdb_entry *__br_fdb_get(struct net_bridge *br,
@@ -156,6 +156,9 @@ void br_stp_timer_init(struct net_bridge *br)
 		      (unsigned long) br);
 
 	setup_timer(&br->gc_timer, br_fdb_cleanup, (unsigned long) br);
+
+	setup_timer(&br->fdb_learn_timer, br_fdb_learn_timer_expired,
+		      (unsigned long) br);
 }
 
 void br_stp_port_timer_init(struct net_bridge_port *p)
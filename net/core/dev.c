@@ -3250,6 +3250,7 @@ EXPORT_SYMBOL(netdev_max_backlog);
 
 int netdev_tstamp_prequeue __read_mostly = 1;
 int netdev_budget __read_mostly = 300;
+int gro_normal_batch __read_mostly = 8;
 int weight_p __read_mostly = 64;            /* old backlog weight */
 
 /* Called with irq disabled */
@@ -3699,8 +3700,14 @@ static void net_tx_action(struct softirq_action *h)
 				trace_consume_skb(skb);
 			else
 				trace_kfree_skb(skb, net_tx_action);
-			__kfree_skb(skb);
+
+			if (skb->fclone != SKB_FCLONE_UNAVAILABLE)
+				__kfree_skb(skb);
+			else
+				__kfree_skb_defer(skb);
 		}
+
+		__kfree_skb_flush();
 	}
 
 	if (sd->output_queue) {
@@ -3884,10 +3891,18 @@ static inline int nf_ingress(struct sk_buff *skb, struct packet_type **pt_prev,
 	return 0;
 }
 
-static int __netif_receive_skb_core(struct sk_buff *skb, bool pfmemalloc)
+/*
+ * Run @*pskb through the taps, ingress and rx handlers and find the last
+ * packet_type it is for. Delivering it to that one is left to the caller,
+ * through *ppt_prev, so a list of skbs can be handed over in one go. The
+ * skb may be replaced on the way, hence @pskb.
+ */
+static int __netif_receive_skb_core(struct sk_buff **pskb, bool pfmemalloc,
+				    struct packet_type **ppt_prev)
 {
 	struct packet_type *ptype, *pt_prev;
 	rx_handler_func_t *rx_handler;
+	struct sk_buff *skb = *pskb;
 	struct net_device *orig_dev;
 	bool deliver_exact = false;
 	int ret = NET_RX_DROP;
@@ -4020,8 +4035,7 @@ ncls:
 	if (pt_prev) {
 		if (unlikely(skb_orphan_frags(skb, GFP_ATOMIC)))
 			goto drop;
-		else
-			ret = pt_prev->func(skb, skb->dev, pt_prev, orig_dev);
+		*ppt_prev = pt_prev;
 	} else {
 drop:
 		atomic_long_inc(&skb->dev->rx_dropped);
@@ -4033,9 +4047,85 @@ drop:
 	}
 
 out:
+	/* if *ppt_prev is set, skb is the buffer to hand to it */
+	*pskb = skb;
+	return ret;
+}
+
+static int __netif_receive_skb_one_core(struct sk_buff *skb, bool pfmemalloc)
+{
+	struct net_device *orig_dev = skb->dev;
+	struct packet_type *pt_prev = NULL;
+	int ret;
+
+	ret = __netif_receive_skb_core(&skb, pfmemalloc, &pt_prev);
+	if (pt_prev)
+		ret = pt_prev->func(skb, skb->dev, pt_prev, orig_dev);
 	return ret;
 }
 
+static inline void __netif_receive_skb_list_ptype(struct list_head *head,
+						  struct packet_type *pt_prev,
+						  struct net_device *orig_dev)
+{
+	struct sk_buff *skb, *next;
+
+	if (!pt_prev)
+		return;
+	if (list_empty(head))
+		return;
+	if (pt_prev->list_func) {
+		pt_prev->list_func(head, pt_prev, orig_dev);
+		return;
+	}
+
+	list_for_each_entry_safe(skb, next, head, list) {
+		skb_list_del_init(skb);
+		pt_prev->func(skb, skb->dev, pt_prev, orig_dev);
+	}
+}
+
+static void __netif_receive_skb_list_core(struct list_head *head,
+					  bool pfmemalloc)
+{
+	/* Fast path assumptions:
+	 * - there is no rx handler
+	 * - only one packet_type matches
+	 * Otherwise some of the processing is done per packet in line and
+	 * only the last packet_type gets the sublist. That cannot reorder
+	 * the packets of any one packet_type: the last one is the same for
+	 * the whole sublist and all others are handled per packet.
+	 */
+	/* current (common) ptype and orig_dev of the sublist */
+	struct packet_type *pt_curr = NULL;
+	struct net_device *od_curr = NULL;
+	struct list_head sublist;
+	struct sk_buff *skb, *next;
+
+	INIT_LIST_HEAD(&sublist);
+	list_for_each_entry_safe(skb, next, head, list) {
+		struct net_device *orig_dev = skb->dev;
+		struct packet_type *pt_prev = NULL;
+
+		skb_list_del_init(skb);
+		__netif_receive_skb_core(&skb, pfmemalloc, &pt_prev);
+		if (!pt_prev)
+			continue;
+		if (pt_curr != pt_prev || od_curr != orig_dev) {
+			/* dispatch the old sublist, start a new one */
+			__netif_receive_skb_list_ptype(&sublist, pt_curr,
+						       od_curr);
+			INIT_LIST_HEAD(&sublist);
+			pt_curr = pt_prev;
+			od_curr = orig_dev;
+		}
+		list_add_tail(&skb->list, &sublist);
+	}
+
+	/* dispatch the final sublist */
+	__netif_receive_skb_list_ptype(&sublist, pt_curr, od_curr);
+}
+
 static int __netif_receive_skb(struct sk_buff *skb)
 {
 	int ret;
@@ -4053,14 +4143,45 @@ static int __netif_receive_skb(struct sk_buff *skb)
 		 * context down to all allocation sites.
 		 */
 		current->flags |= PF_MEMALLOC;
-		ret = __netif_receive_skb_core(skb, true);
+		ret = __netif_receive_skb_one_core(skb, true);
 		tsk_restore_flags(current, pflags, PF_MEMALLOC);
 	} else
-		ret = __netif_receive_skb_core(skb, false);
+		ret = __netif_receive_skb_one_core(skb, false);
 
 	return ret;
 }
 
+static void __netif_receive_skb_list(struct list_head *head)
+{
+	unsigned long pflags = current->flags;
+	struct sk_buff *skb, *next;
+	bool pfmemalloc = false; /* is the current sublist PF_MEMALLOC? */
+
+	list_for_each_entry_safe(skb, next, head, list) {
+		if ((sk_memalloc_socks() && skb_pfmemalloc(skb)) != pfmemalloc) {
+			struct list_head sublist;
+
+			/* handle the previous sublist */
+			list_cut_position(&sublist, head, skb->list.prev);
+			if (!list_empty(&sublist))
+				__netif_receive_skb_list_core(&sublist,
+							      pfmemalloc);
+			pfmemalloc = !pfmemalloc;
+			/* see the comments in __netif_receive_skb() */
+			if (pfmemalloc)
+				current->flags |= PF_MEMALLOC;
+			else
+				tsk_restore_flags(current, pflags,
+						  PF_MEMALLOC);
+		}
+	}
+	/* handle the remaining sublist */
+	if (!list_empty(head))
+		__netif_receive_skb_list_core(head, pfmemalloc);
+	if (pfmemalloc)
+		tsk_restore_flags(current, pflags, PF_MEMALLOC);
+}
+
 static int netif_receive_skb_internal(struct sk_buff *skb)
 {
 	int ret;
@@ -4089,6 +4210,41 @@ static int netif_receive_skb_internal(struct sk_buff *skb)
 	return ret;
 }
 
+static void netif_receive_skb_list_internal(struct list_head *head)
+{
+	struct sk_buff *skb, *next;
+	struct list_head sublist;
+
+	INIT_LIST_HEAD(&sublist);
+	list_for_each_entry_safe(skb, next, head, list) {
+		net_timestamp_check(netdev_tstamp_prequeue, skb);
+		skb_list_del_init(skb);
+		if (!skb_defer_rx_timestamp(skb))
+			list_add_tail(&skb->list, &sublist);
+	}
+	list_splice_init(&sublist, head);
+
+	/* one RCU read side section for the whole batch */
+	rcu_read_lock();
+#ifdef CONFIG_RPS
+	if (static_key_false(&rps_needed)) {
+		list_for_each_entry_safe(skb, next, head, list) {
+			struct rps_dev_flow voidflow, *rflow = &voidflow;
+			int cpu = get_rps_cpu(skb->dev, skb, &rflow);
+
+			if (cpu >= 0) {
+				/* will be handled, remove from the list */
+				skb_list_del_init(skb);
+				enqueue_to_backlog(skb, cpu,
+						   &rflow->last_qtail);
+			}
+		}
+	}
+#endif
+	__netif_receive_skb_list(head);
+	rcu_read_unlock();
+}
+
 /**
  *	netif_receive_skb - process receive buffer from network
  *	@skb: buffer to process
@@ -4112,6 +4268,31 @@ int netif_receive_skb(struct sk_buff *skb)
 }
 EXPORT_SYMBOL(netif_receive_skb);
 
+/**
+ *	netif_receive_skb_list - process many receive buffers from network
+ *	@head: list of skbs to process, linked through skb->list
+ *
+ *	Since return value of netif_receive_skb() is normally ignored, and
+ *	wouldn't be meaningful for a list, this function returns void.
+ *	The protocol lookups, RPS and the RCU read side section are done
+ *	once per batch where possible, and a protocol that has a list_func
+ *	gets all of its packets in one call.
+ *
+ *	This function may only be called from softirq context and interrupts
+ *	should be enabled.
+ */
+void netif_receive_skb_list(struct list_head *head)
+{
+	struct sk_buff *skb;
+
+	if (list_empty(head))
+		return;
+	list_for_each_entry(skb, head, list)
+		trace_netif_receive_skb_entry(skb);
+	netif_receive_skb_list_internal(head);
+}
+EXPORT_SYMBOL(netif_receive_skb_list);
+
 /* Network device is going away, flush any packets still pending
  * Called with irqs disabled.
  */
@@ -4143,7 +4324,27 @@ static void flush_backlog(void *arg)
 		raise_softirq_irqoff(NET_RX_SOFTIRQ);
 }
 
-static int napi_gro_complete(struct sk_buff *skb)
+/* Pass the skbs batched on napi->rx_list up the stack in one go */
+static void gro_normal_list(struct napi_struct *napi)
+{
+	if (!napi->rx_count)
+		return;
+	netif_receive_skb_list_internal(&napi->rx_list);
+	INIT_LIST_HEAD(&napi->rx_list);
+	napi->rx_count = 0;
+}
+
+/* Queue one GRO_NORMAL skb up for list processing. If batch size is
+ * exceeded, pass the whole batch up the stack.
+ */
+static void gro_normal_one(struct napi_struct *napi, struct sk_buff *skb)
+{
+	list_add_tail(&skb->list, &napi->rx_list);
+	if (++napi->rx_count >= gro_normal_batch)
+		gro_normal_list(napi);
+}
+
+static int napi_gro_complete(struct napi_struct *napi, struct sk_buff *skb)
 {
 	struct packet_offload *ptype;
 	__be16 type = skb->protocol;
@@ -4174,14 +4375,15 @@ static int napi_gro_complete(struct sk_buff *skb)
 	}
 
 out:
-	return netif_receive_skb_internal(skb);
+	gro_normal_one(napi, skb);
+	return NET_RX_SUCCESS;
 }
 
 /* napi->gro_list contains packets ordered by age.
  * youngest packets at the head of it.
  * Complete skbs in reverse order to reduce latencies.
  */
-void napi_gro_flush(struct napi_struct *napi, bool flush_old)
+static void __napi_gro_flush(struct napi_struct *napi, bool flush_old)
 {
 	struct sk_buff *skb, *prev = NULL;
 
@@ -4198,12 +4400,18 @@ void napi_gro_flush(struct napi_struct *napi, bool flush_old)
 			return;
 
 		prev = skb->prev;
-		napi_gro_complete(skb);
+		napi_gro_complete(napi, skb);
 		napi->gro_count--;
 	}
 
 	napi->gro_list = NULL;
 }
+
+void napi_gro_flush(struct napi_struct *napi, bool flush_old)
+{
+	__napi_gro_flush(napi, flush_old);
+	gro_normal_list(napi);
+}
 EXPORT_SYMBOL(napi_gro_flush);
 
 static void gro_list_prepare(struct napi_struct *napi, struct sk_buff *skb)
@@ -4337,7 +4545,7 @@ static enum gro_result dev_gro_receive(struct napi_struct *napi, struct sk_buff
 
 		*pp = nskb->next;
 		nskb->next = NULL;
-		napi_gro_complete(nskb);
+		napi_gro_complete(napi, nskb);
 		napi->gro_count--;
 	}
 
@@ -4357,7 +4565,7 @@ static enum gro_result dev_gro_receive(struct napi_struct *napi, struct sk_buff
 		}
 		*pp = NULL;
 		nskb->next = NULL;
-		napi_gro_complete(nskb);
+		napi_gro_complete(napi, nskb);
 	} else {
 		napi->gro_count++;
 	}
@@ -4409,12 +4617,13 @@ struct packet_offload *gro_find_complete_by_type(__be16 type)
 }
 EXPORT_SYMBOL(gro_find_complete_by_type);
 
-static gro_result_t napi_skb_finish(gro_result_t ret, struct sk_buff *skb)
+static gro_result_t napi_skb_finish(struct napi_struct *napi,
+				    struct sk_buff *skb,
+				    gro_result_t ret)
 {
 	switch (ret) {
 	case GRO_NORMAL:
-		if (netif_receive_skb_internal(skb))
-			ret = GRO_DROP;
+		gro_normal_one(napi, skb);
 		break;
 
 	case GRO_DROP:
@@ -4444,7 +4653,7 @@ gro_result_t napi_gro_receive(struct napi_struct *napi, struct sk_buff *skb)
 
 	skb_gro_reset_offset(skb);
 
-	return napi_skb_finish(dev_gro_receive(napi, skb), skb);
+	return napi_skb_finish(napi, skb, dev_gro_receive(napi, skb));
 }
 EXPORT_SYMBOL(napi_gro_receive);
 
@@ -4488,8 +4697,8 @@ static gro_result_t napi_frags_finish(struct napi_struct *napi,
 	case GRO_HELD:
 		__skb_push(skb, ETH_HLEN);
 		skb->protocol = eth_type_trans(skb, skb->dev);
-		if (ret == GRO_NORMAL && netif_receive_skb_internal(skb))
-			ret = GRO_DROP;
+		if (ret == GRO_NORMAL)
+			gro_normal_one(napi, skb);
 		break;
 
 	case GRO_DROP:
@@ -4710,6 +4919,9 @@ void __napi_complete(struct napi_struct *n)
 {
 	BUG_ON(!test_bit(NAPI_STATE_SCHED, &n->state));
 
+	/* nothing may stay batched once the instance can be rescheduled */
+	gro_normal_list(n);
+
 	list_del_init(&n->poll_list);
 	smp_mb__before_atomic();
 	clear_bit(NAPI_STATE_SCHED, &n->state);
@@ -4737,8 +4949,10 @@ void napi_complete_done(struct napi_struct *n, int work_done)
 			hrtimer_start(&n->timer, ns_to_ktime(timeout),
 				      HRTIMER_MODE_REL_PINNED);
 		else
-			napi_gro_flush(n, false);
+			__napi_gro_flush(n, false);
 	}
+	gro_normal_list(n);
+
 	if (likely(list_empty(&n->poll_list))) {
 		WARN_ON_ONCE(!test_and_clear_bit(NAPI_STATE_SCHED, &n->state));
 	} else {
@@ -4822,6 +5036,8 @@ void netif_napi_add(struct net_device *dev, struct napi_struct *napi,
 	napi->gro_count = 0;
 	napi->gro_list = NULL;
 	napi->skb = NULL;
+	INIT_LIST_HEAD(&napi->rx_list);
+	napi->rx_count = 0;
 	napi->poll = poll;
 	if (weight > NAPI_POLL_WEIGHT)
 		pr_err_once("netif_napi_add() called with weight %d on device %s\n",
@@ -4906,9 +5122,12 @@ static int napi_poll(struct napi_struct *n, struct list_head *repoll)
 		/* flush too old packets
 		 * If HZ < 1000, flush all packets.
 		 */
-		napi_gro_flush(n, HZ >= 1000);
+		__napi_gro_flush(n, HZ >= 1000);
 	}
 
+	/* Don't hold the GRO_NORMAL skbs over to the next poll round */
+	gro_normal_list(n);
+
 	/* Some drivers may have called napi_schedule
 	 * prior to exhausting their budget.
 	 */
@@ -4943,7 +5162,7 @@ static void net_rx_action(struct softirq_action *h)
 
 		if (list_empty(&list)) {
 			if (!sd_has_rps_ipi_waiting(sd) && list_empty(&repoll))
-				return;
+				goto out;
 			break;
 		}
 
@@ -4970,6 +5189,8 @@ static void net_rx_action(struct softirq_action *h)
 		__raise_softirq_irqoff_ksoft(NET_RX_SOFTIRQ);
 
 	net_rps_action_and_irq_enable(sd);
+out:
+	__kfree_skb_flush();
 }
 
 struct netdev_adjacent {
@@ -7869,6 +8090,8 @@ static int __init net_dev_init(void)
 
 		sd->backlog.poll = process_backlog;
 		sd->backlog.weight = weight_p;
+		INIT_LIST_HEAD(&sd->backlog.rx_list);
+		sd->backlog.rx_count = 0;
 	}
 
 	dev_boot_phase = 0;
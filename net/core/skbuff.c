@@ -282,6 +282,32 @@ nodata:
 }
 EXPORT_SYMBOL(__alloc_skb);
 
+/* Initialize the sk_buff shell @skb around @data, see __build_skb() */
+static void __build_skb_around(struct sk_buff *skb, void *data,
+			       unsigned int frag_size)
+{
+	struct skb_shared_info *shinfo;
+	unsigned int size = frag_size ? : ksize(data);
+
+	size -= SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+
+	memset(skb, 0, offsetof(struct sk_buff, tail));
+	skb->truesize = SKB_TRUESIZE(size);
+	atomic_set(&skb->users, 1);
+	skb->head = data;
+	skb->data = data;
+	skb_reset_tail_pointer(skb);
+	skb->end = skb->tail + size;
+	skb->mac_header = (typeof(skb->mac_header))~0U;
+	skb->transport_header = (typeof(skb->transport_header))~0U;
+
+	/* make sure we initialize shinfo sequentially */
+	shinfo = skb_shinfo(skb);
+	memset(shinfo, 0, offsetof(struct skb_shared_info, dataref));
+	atomic_set(&shinfo->dataref, 1);
+	kmemcheck_annotate_variable(shinfo->destructor_arg);
+}
+
 /**
  * __build_skb - build a network buffer
  * @data: data buffer provided by caller
@@ -303,32 +329,13 @@ EXPORT_SYMBOL(__alloc_skb);
  */
 struct sk_buff *__build_skb(void *data, unsigned int frag_size)
 {
-	struct skb_shared_info *shinfo;
 	struct sk_buff *skb;
-	unsigned int size = frag_size ? : ksize(data);
 
 	skb = kmem_cache_alloc(skbuff_head_cache, GFP_ATOMIC);
 	if (!skb)
 		return NULL;
 
-	size -= SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
-
-	memset(skb, 0, offsetof(struct sk_buff, tail));
-	skb->truesize = SKB_TRUESIZE(size);
-	atomic_set(&skb->users, 1);
-	skb->head = data;
-	skb->data = data;
-	skb_reset_tail_pointer(skb);
-	skb->end = skb->tail + size;
-	skb->mac_header = (typeof(skb->mac_header))~0U;
-	skb->transport_header = (typeof(skb->transport_header))~0U;
-
-	/* make sure we initialize shinfo sequentially */
-	shinfo = skb_shinfo(skb);
-	memset(shinfo, 0, offsetof(struct skb_shared_info, dataref));
-	atomic_set(&shinfo->dataref, 1);
-	kmemcheck_annotate_variable(shinfo->destructor_arg);
-
+	__build_skb_around(skb, data, frag_size);
 	return skb;
 }
 
@@ -350,8 +357,22 @@ struct sk_buff *build_skb(void *data, unsigned int frag_size)
 }
 EXPORT_SYMBOL(build_skb);
 
+/* NAPI context keeps a per-cpu stack of sk_buff shells: skbs consumed
+ * in NAPI context are pushed on it and reused by __napi_alloc_skb(), it
+ * is refilled and emptied from skbuff_head_cache in bulk.
+ */
+#define NAPI_SKB_CACHE_SIZE	64
+#define NAPI_SKB_CACHE_BULK	16
+#define NAPI_SKB_CACHE_HALF	(NAPI_SKB_CACHE_SIZE / 2)
+
+struct napi_alloc_cache {
+	struct page_frag_cache	page;
+	unsigned int		skb_count;
+	void			*skb_cache[NAPI_SKB_CACHE_SIZE];
+};
+
 static DEFINE_PER_CPU(struct page_frag_cache, netdev_alloc_cache);
-static DEFINE_PER_CPU(struct page_frag_cache, napi_alloc_cache);
+static DEFINE_PER_CPU(struct napi_alloc_cache, napi_alloc_cache);
 static DEFINE_LOCAL_IRQ_LOCK(netdev_alloc_lock);
 static DEFINE_LOCAL_IRQ_LOCK(napi_alloc_cache_lock);
 
@@ -383,11 +404,11 @@ EXPORT_SYMBOL(netdev_alloc_frag);
 
 static void *__napi_alloc_frag(unsigned int fragsz, gfp_t gfp_mask)
 {
-	struct page_frag_cache *nc;
+	struct napi_alloc_cache *nc;
 	void *data;
 
 	nc = &get_locked_var(napi_alloc_cache_lock, napi_alloc_cache);
-	data = __alloc_page_frag(nc, fragsz, gfp_mask);
+	data = __alloc_page_frag(&nc->page, fragsz, gfp_mask);
 	put_locked_var(napi_alloc_cache_lock, napi_alloc_cache);
 	return data;
 }
@@ -398,6 +419,20 @@ void *napi_alloc_frag(unsigned int fragsz)
 }
 EXPORT_SYMBOL(napi_alloc_frag);
 
+/* Called with napi_alloc_cache_lock held */
+static struct sk_buff *napi_skb_cache_get(struct napi_alloc_cache *nc)
+{
+	if (unlikely(!nc->skb_count))
+		nc->skb_count = kmem_cache_alloc_bulk(skbuff_head_cache,
+						      GFP_ATOMIC,
+						      NAPI_SKB_CACHE_BULK,
+						      nc->skb_cache);
+	if (unlikely(!nc->skb_count))
+		return NULL;
+
+	return nc->skb_cache[--nc->skb_count];
+}
+
 /**
  *	__netdev_alloc_skb - allocate an skbuff for rx on a specific device
  *	@dev: network device to receive on
@@ -483,7 +518,7 @@ EXPORT_SYMBOL(__netdev_alloc_skb);
 struct sk_buff *__napi_alloc_skb(struct napi_struct *napi, unsigned int len,
 				 gfp_t gfp_mask)
 {
-	struct page_frag_cache *nc;
+	struct napi_alloc_cache *nc;
 	struct sk_buff *skb;
 	void *data;
 	bool pfmemalloc;
@@ -505,18 +540,19 @@ struct sk_buff *__napi_alloc_skb(struct napi_struct *napi, unsigned int len,
 		gfp_mask |= __GFP_MEMALLOC;
 
 	nc = &get_locked_var(napi_alloc_cache_lock, napi_alloc_cache);
-	data = __alloc_page_frag(nc, len, gfp_mask);
-	pfmemalloc = nc->pfmemalloc;
+	data = __alloc_page_frag(&nc->page, len, gfp_mask);
+	pfmemalloc = nc->page.pfmemalloc;
+	skb = data ? napi_skb_cache_get(nc) : NULL;
 	put_locked_var(napi_alloc_cache_lock, napi_alloc_cache);
 
 	if (unlikely(!data))
 		return NULL;
 
-	skb = __build_skb(data, len);
 	if (unlikely(!skb)) {
 		skb_free_frag(data);
 		return NULL;
 	}
+	__build_skb_around(skb, data, len);
 
 	/* use OR instead of assignment to avoid clearing of bits in mask */
 	if (pfmemalloc)
@@ -761,6 +797,98 @@ void consume_skb(struct sk_buff *skb)
 }
 EXPORT_SYMBOL(consume_skb);
 
+/**
+ *	__kfree_skb_flush - free the skbs deferred in NAPI context
+ *
+ *	Give the sk_buff shells cached by this cpu back to skbuff_head_cache,
+ *	at the end of a NAPI processing round.
+ */
+void __kfree_skb_flush(void)
+{
+	struct napi_alloc_cache *nc;
+
+	nc = &get_locked_var(napi_alloc_cache_lock, napi_alloc_cache);
+	if (nc->skb_count) {
+		kmem_cache_free_bulk(skbuff_head_cache, nc->skb_count,
+				     nc->skb_cache);
+		nc->skb_count = 0;
+	}
+	put_locked_var(napi_alloc_cache_lock, napi_alloc_cache);
+}
+
+static void _kfree_skb_defer(struct sk_buff *skb)
+{
+	struct napi_alloc_cache *nc;
+
+	/* drop skb->head and call any destructors for packet */
+	skb_release_all(skb);
+
+	nc = &get_locked_var(napi_alloc_cache_lock, napi_alloc_cache);
+	nc->skb_cache[nc->skb_count++] = skb;
+
+#ifdef CONFIG_SLUB
+	/* SLUB writes into objects when freeing */
+	prefetchw(skb);
+#endif
+
+	/* keep the older half for __napi_alloc_skb() when full */
+	if (unlikely(nc->skb_count == NAPI_SKB_CACHE_SIZE)) {
+		kmem_cache_free_bulk(skbuff_head_cache, NAPI_SKB_CACHE_HALF,
+				     nc->skb_cache + NAPI_SKB_CACHE_HALF);
+		nc->skb_count = NAPI_SKB_CACHE_HALF;
+	}
+	put_locked_var(napi_alloc_cache_lock, napi_alloc_cache);
+}
+
+/**
+ *	__kfree_skb_defer - free an skbuff in NAPI context
+ *	@skb: buffer to free, not a fast clone
+ *
+ *	Like __kfree_skb(), but the sk_buff shell is only returned to the
+ *	slab by the next __kfree_skb_flush(), along with the others.
+ */
+void __kfree_skb_defer(struct sk_buff *skb)
+{
+	_kfree_skb_defer(skb);
+}
+
+/**
+ *	napi_consume_skb - free an skbuff from NAPI context
+ *	@skb: buffer to free
+ *	@budget: NAPI budget of the caller, 0 if not called from NAPI poll
+ *
+ *	consume_skb() for the TX completion path of drivers, run from their
+ *	NAPI poll routine. The sk_buff shell is recycled through the NAPI
+ *	skb cache and freed in bulk.
+ */
+void napi_consume_skb(struct sk_buff *skb, int budget)
+{
+	if (unlikely(!skb))
+		return;
+
+	/* Zero budget indicate non-NAPI context called us, like netpoll */
+	if (unlikely(!budget)) {
+		dev_consume_skb_any(skb);
+		return;
+	}
+
+	if (likely(atomic_read(&skb->users) == 1))
+		smp_rmb();
+	else if (likely(!atomic_dec_and_test(&skb->users)))
+		return;
+	/* if reaching here SKB is ready to free */
+	trace_consume_skb(skb);
+
+	/* fast clones go back to their own cache */
+	if (skb->fclone != SKB_FCLONE_UNAVAILABLE) {
+		__kfree_skb(skb);
+		return;
+	}
+
+	_kfree_skb_defer(skb);
+}
+EXPORT_SYMBOL(napi_consume_skb);
+
 /* Make sure a field is enclosed inside headers_start/headers_end section */
 #define CHECK_SKB_FIELD(field) \
 	BUILD_BUG_ON(offsetof(struct sk_buff, field) <		\
@@ -3588,6 +3716,103 @@ int sock_queue_err_skb(struct sock *sk, struct sk_buff *skb)
 }
 EXPORT_SYMBOL(sock_queue_err_skb);
 
+#define skb_from_uarg(uarg) container_of((void *)(uarg), struct sk_buff, cb)
+
+/**
+ * sock_zerocopy_alloc - allocate the completion of a MSG_ZEROCOPY send
+ * @sk: sending socket
+ * @size: number of bytes being sent
+ *
+ * The returned buffer holds one reference for the caller. It lives in
+ * the control block of the error queue skb that will carry its
+ * notification, so completing a send can't fail for lack of memory.
+ */
+struct ubuf_info *sock_zerocopy_alloc(struct sock *sk, size_t size)
+{
+	struct ubuf_info *uarg;
+	struct sk_buff *skb;
+
+	skb = sock_omalloc(sk, 0, GFP_KERNEL);
+	if (!skb)
+		return NULL;
+
+	BUILD_BUG_ON(sizeof(*uarg) > sizeof(skb->cb));
+	uarg = (void *)skb->cb;
+
+	uarg->callback = sock_zerocopy_callback;
+	uarg->id = ((u32)atomic_inc_return(&sk->sk_zckey)) - 1;
+	uarg->len = 1;
+	uarg->zerocopy = 1;
+	atomic_set(&uarg->refcnt, 1);
+	sock_hold(sk);
+
+	return uarg;
+}
+EXPORT_SYMBOL_GPL(sock_zerocopy_alloc);
+
+static void __sock_zerocopy_callback(struct ubuf_info *uarg)
+{
+	struct sk_buff *skb = skb_from_uarg(uarg);
+	struct sock_exterr_skb *serr;
+	struct sock *sk = skb->sk;
+	bool copied = !uarg->zerocopy;
+	u32 id = uarg->id;
+
+	if (!uarg->len || sock_flag(sk, SOCK_DEAD)) {
+		consume_skb(skb);
+		goto release;
+	}
+
+	/* uarg lives in skb->cb, which is reused for the notification */
+	serr = SKB_EXT_ERR(skb);
+	memset(serr, 0, sizeof(*serr));
+	serr->ee.ee_errno = 0;
+	serr->ee.ee_origin = SO_EE_ORIGIN_ZEROCOPY;
+	serr->ee.ee_data = id;
+	serr->ee.ee_info = id;
+	if (copied)
+		serr->ee.ee_code |= SO_EE_CODE_ZEROCOPY_COPIED;
+
+	if (sock_queue_err_skb(sk, skb))
+		kfree_skb(skb);
+
+release:
+	sock_put(sk);
+}
+
+void sock_zerocopy_callback(struct ubuf_info *uarg, bool success)
+{
+	uarg->zerocopy = uarg->zerocopy & success;
+	sock_zerocopy_put(uarg);
+}
+EXPORT_SYMBOL_GPL(sock_zerocopy_callback);
+
+void sock_zerocopy_put(struct ubuf_info *uarg)
+{
+	if (uarg && atomic_dec_and_test(&uarg->refcnt))
+		__sock_zerocopy_callback(uarg);
+}
+EXPORT_SYMBOL_GPL(sock_zerocopy_put);
+
+/**
+ * sock_zerocopy_put_abort - drop the caller's reference of a failed send
+ * @uarg: buffer returned by sock_zerocopy_alloc()
+ *
+ * The send is not reported to userspace and its id is given back.
+ */
+void sock_zerocopy_put_abort(struct ubuf_info *uarg)
+{
+	if (uarg) {
+		struct sock *sk = skb_from_uarg(uarg)->sk;
+
+		atomic_dec(&sk->sk_zckey);
+		uarg->len--;
+
+		sock_zerocopy_put(uarg);
+	}
+}
+EXPORT_SYMBOL_GPL(sock_zerocopy_put_abort);
+
 struct sk_buff *sock_dequeue_err_skb(struct sock *sk)
 {
 	struct sk_buff_head *q = &sk->sk_error_queue;
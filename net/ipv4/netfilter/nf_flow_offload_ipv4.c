@@ -0,0 +1,548 @@
+/*
+ * Software flow offload for forwarded IPv4 connections
+ *
+ * Once a forwarded TCP or UDP connection is established, an entry with
+ * the NAT rewrite and the output route is added for every direction
+ * that passes the FORWARD hook. Subsequent packets of that direction
+ * are picked up at the very beginning of PRE_ROUTING and sent straight
+ * to the neighbour layer, skipping the remaining hooks, the route
+ * lookup and the conntrack lookup.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/types.h>
+#include <linux/ip.h>
+#include <linux/jhash.h>
+#include <linux/module.h>
+#include <linux/netdevice.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter_ipv4.h>
+#include <linux/skbuff.h>
+#include <linux/slab.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <linux/workqueue.h>
+#include <net/checksum.h>
+#include <net/ip.h>
+#include <net/neighbour.h>
+#include <net/route.h>
+
+#include <net/netfilter/nf_conntrack.h>
+#include <net/netfilter/nf_conntrack_helper.h>
+
+#define FLOW_OFFLOAD_HSIZE	1024
+#define FLOW_OFFLOAD_GC_INTERVAL	HZ
+
+static unsigned int max_flows __read_mostly = 8192;
+module_param(max_flows, uint, 0644);
+MODULE_PARM_DESC(max_flows, "Maximum number of offloaded flow directions");
+
+/* Packet as seen on the input device, before NAT */
+struct flow_offload_tuple {
+	int		iifindex;
+	__be32		saddr;
+	__be32		daddr;
+	__be16		sport;
+	__be16		dport;
+	u8		l4proto;
+	u8		pad[3];
+};
+
+struct flow_offload {
+	struct hlist_node		node;
+	struct flow_offload_tuple	tuple;
+
+	/* Addresses and ports after NAT */
+	__be32				nat_saddr;
+	__be32				nat_daddr;
+	__be16				nat_sport;
+	__be16				nat_dport;
+
+	struct net			*net;
+	struct nf_conn			*ct;
+	struct dst_entry		*dst;
+
+	unsigned long			timeout;
+	unsigned long			last_used;
+	unsigned long			refreshed;
+	struct rcu_head			rcu;
+};
+
+static struct hlist_head flow_table[FLOW_OFFLOAD_HSIZE];
+static DEFINE_SPINLOCK(flow_lock);
+static unsigned int flow_count;
+static u32 flow_hash_rnd __read_mostly;
+
+static u32 flow_offload_hash(const struct flow_offload_tuple *t)
+{
+	u32 ports = ((u32)t->sport << 16) | t->dport;
+
+	return jhash_3words(t->saddr, t->daddr, ports ^ t->l4proto,
+			    flow_hash_rnd ^ t->iifindex) &
+	       (FLOW_OFFLOAD_HSIZE - 1);
+}
+
+static struct flow_offload *
+flow_offload_lookup(const struct net *net, const struct flow_offload_tuple *t)
+{
+	struct flow_offload *flow;
+
+	hlist_for_each_entry_rcu(flow, &flow_table[flow_offload_hash(t)],
+				 node) {
+		if (net_eq(flow->net, net) &&
+		    !memcmp(&flow->tuple, t, sizeof(*t)))
+			return flow;
+	}
+
+	return NULL;
+}
+
+static void flow_offload_free_rcu(struct rcu_head *head)
+{
+	struct flow_offload *flow = container_of(head, struct flow_offload,
+						 rcu);
+
+	/* The fast path may have attached the route without a reference */
+	dst_release(flow->dst);
+	kfree(flow);
+}
+
+/* Must be called with flow_lock held */
+static void __flow_offload_del(struct flow_offload *flow)
+{
+	hlist_del_init_rcu(&flow->node);
+	flow_count--;
+	nf_ct_put(flow->ct);
+	call_rcu(&flow->rcu, flow_offload_free_rcu);
+}
+
+static void flow_offload_del(struct flow_offload *flow)
+{
+	spin_lock_bh(&flow_lock);
+	/* Lost a race against the gc or another CPU */
+	if (!hlist_unhashed(&flow->node))
+		__flow_offload_del(flow);
+	spin_unlock_bh(&flow_lock);
+}
+
+static bool flow_offload_ct_ok(struct nf_conn *ct)
+{
+	if (nf_ct_is_dying(ct) || !nf_ct_is_confirmed(ct))
+		return false;
+
+	/* Helpers and sequence adjustment need to see every packet */
+	if (nfct_help(ct) || test_bit(IPS_SEQ_ADJUST_BIT, &ct->status))
+		return false;
+
+	switch (nf_ct_protonum(ct)) {
+	case IPPROTO_TCP:
+		return ct->proto.tcp.state == TCP_CONNTRACK_ESTABLISHED;
+	case IPPROTO_UDP:
+		return test_bit(IPS_ASSURED_BIT, &ct->status);
+	}
+
+	return false;
+}
+
+/*
+ * Packets skipping conntrack leave holes in its view of the TCP window,
+ * the FIN and RST that end the connection must not be dropped as
+ * invalid when they take the slow path again.
+ */
+static void flow_offload_tcp_liberal(struct nf_conn *ct)
+{
+	spin_lock_bh(&ct->lock);
+	ct->proto.tcp.seen[0].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+	ct->proto.tcp.seen[1].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+	spin_unlock_bh(&ct->lock);
+}
+
+static void flow_offload_add(struct nf_conn *ct, enum ip_conntrack_dir dir,
+			     struct sk_buff *skb,
+			     const struct nf_hook_state *state)
+{
+	const struct nf_conntrack_tuple *orig = &ct->tuplehash[dir].tuple;
+	const struct nf_conntrack_tuple *repl = &ct->tuplehash[!dir].tuple;
+	struct rtable *rt = skb_rtable(skb);
+	struct flow_offload_tuple t;
+	struct flow_offload *flow;
+	long timeout;
+
+	memset(&t, 0, sizeof(t));
+	t.iifindex = state->in->ifindex;
+	t.saddr = orig->src.u3.ip;
+	t.daddr = orig->dst.u3.ip;
+	t.sport = orig->src.u.all;
+	t.dport = orig->dst.u.all;
+	t.l4proto = orig->dst.protonum;
+
+	/* Already offloaded, this one took the slow path on purpose */
+	if (flow_offload_lookup(state->net, &t))
+		return;
+
+	if (!rt || rt->rt_type != RTN_UNICAST || dst_xfrm(&rt->dst) ||
+	    rt->dst.dev != state->out)
+		return;
+
+	timeout = (long)(ct->timeout.expires - jiffies);
+	if (timeout <= 0)
+		return;
+
+	if (READ_ONCE(flow_count) >= max_flows)
+		return;
+
+	flow = kzalloc(sizeof(*flow), GFP_ATOMIC);
+	if (!flow)
+		return;
+
+	flow->tuple = t;
+	flow->nat_saddr = repl->dst.u3.ip;
+	flow->nat_daddr = repl->src.u3.ip;
+	flow->nat_sport = repl->dst.u.all;
+	flow->nat_dport = repl->src.u.all;
+
+	flow->net = state->net;
+	flow->timeout = timeout;
+	flow->last_used = jiffies;
+	flow->refreshed = flow->last_used;
+
+	if (nf_ct_protonum(ct) == IPPROTO_TCP)
+		flow_offload_tcp_liberal(ct);
+
+	spin_lock_bh(&flow_lock);
+	if (flow_offload_lookup(state->net, &flow->tuple)) {
+		spin_unlock_bh(&flow_lock);
+		kfree(flow);
+		return;
+	}
+
+	nf_conntrack_get(&ct->ct_general);
+	flow->ct = ct;
+	flow->dst = dst_clone(&rt->dst);
+	hlist_add_head_rcu(&flow->node,
+			   &flow_table[flow_offload_hash(&flow->tuple)]);
+	flow_count++;
+	spin_unlock_bh(&flow_lock);
+}
+
+static unsigned int flow_offload_forward_hook(void *priv,
+					      struct sk_buff *skb,
+					      const struct nf_hook_state *state)
+{
+	enum ip_conntrack_info ctinfo;
+	struct nf_conn *ct;
+
+	ct = nf_ct_get(skb, &ctinfo);
+	if (!ct || nf_ct_is_untracked(ct) || nf_ct_l3num(ct) != AF_INET)
+		return NF_ACCEPT;
+
+	if (ctinfo != IP_CT_ESTABLISHED && ctinfo != IP_CT_ESTABLISHED_REPLY)
+		return NF_ACCEPT;
+
+	if (!flow_offload_ct_ok(ct))
+		return NF_ACCEPT;
+
+	if (ip_hdr(skb)->ihl != 5 || ip_is_fragment(ip_hdr(skb)))
+		return NF_ACCEPT;
+
+	flow_offload_add(ct, CTINFO2DIR(ctinfo), skb, state);
+
+	return NF_ACCEPT;
+}
+
+static int flow_offload_parse(struct sk_buff *skb,
+			      struct flow_offload_tuple *t,
+			      int iifindex)
+{
+	unsigned int thoff, hdrsize;
+	const struct iphdr *iph;
+	const __be16 *ports;
+
+	iph = ip_hdr(skb);
+	if (iph->ihl != 5 || ip_is_fragment(iph))
+		return -1;
+
+	switch (iph->protocol) {
+	case IPPROTO_TCP:
+		hdrsize = sizeof(struct tcphdr);
+		break;
+	case IPPROTO_UDP:
+		hdrsize = sizeof(struct udphdr);
+		break;
+	default:
+		return -1;
+	}
+
+	thoff = sizeof(*iph);
+	if (!pskb_may_pull(skb, thoff + hdrsize))
+		return -1;
+
+	iph = ip_hdr(skb);
+	ports = (const __be16 *)(skb_network_header(skb) + thoff);
+
+	memset(t, 0, sizeof(*t));
+	t->iifindex = iifindex;
+	t->saddr = iph->saddr;
+	t->daddr = iph->daddr;
+	t->sport = ports[0];
+	t->dport = ports[1];
+	t->l4proto = iph->protocol;
+
+	return thoff;
+}
+
+static void flow_offload_nat(struct sk_buff *skb,
+			     const struct flow_offload *flow,
+			     unsigned int thoff)
+{
+	struct iphdr *iph = ip_hdr(skb);
+	__be16 *ports = (__be16 *)(skb_network_header(skb) + thoff);
+	__sum16 *check = NULL;
+
+	if (iph->protocol == IPPROTO_TCP) {
+		check = &((struct tcphdr *)ports)->check;
+	} else {
+		struct udphdr *uh = (struct udphdr *)ports;
+
+		if (uh->check || skb->ip_summed == CHECKSUM_PARTIAL)
+			check = &uh->check;
+	}
+
+	if (iph->saddr != flow->nat_saddr) {
+		if (check)
+			inet_proto_csum_replace4(check, skb, iph->saddr,
+						 flow->nat_saddr, true);
+		csum_replace4(&iph->check, iph->saddr, flow->nat_saddr);
+		iph->saddr = flow->nat_saddr;
+	}
+	if (iph->daddr != flow->nat_daddr) {
+		if (check)
+			inet_proto_csum_replace4(check, skb, iph->daddr,
+						 flow->nat_daddr, true);
+		csum_replace4(&iph->check, iph->daddr, flow->nat_daddr);
+		iph->daddr = flow->nat_daddr;
+	}
+	if (ports[0] != flow->nat_sport) {
+		if (check)
+			inet_proto_csum_replace2(check, skb, ports[0],
+						 flow->nat_sport, false);
+		ports[0] = flow->nat_sport;
+	}
+	if (ports[1] != flow->nat_dport) {
+		if (check)
+			inet_proto_csum_replace2(check, skb, ports[1],
+						 flow->nat_dport, false);
+		ports[1] = flow->nat_dport;
+	}
+
+	if (check && iph->protocol == IPPROTO_UDP && !*check)
+		*check = CSUM_MANGLED_0;
+}
+
+static unsigned int flow_offload_ip_hook(void *priv,
+					 struct sk_buff *skb,
+					 const struct nf_hook_state *state)
+{
+	struct flow_offload_tuple t;
+	struct flow_offload *flow;
+	struct net_device *outdev;
+	struct rtable *rt;
+	unsigned long now;
+	unsigned int mtu;
+	__be32 nexthop;
+	int thoff;
+
+	if (skb->pkt_type != PACKET_HOST || skb->nfct)
+		return NF_ACCEPT;
+#if IS_ENABLED(CONFIG_BRIDGE_NETFILTER)
+	if (skb->nf_bridge)
+		return NF_ACCEPT;
+#endif
+
+	thoff = flow_offload_parse(skb, &t, state->in->ifindex);
+	if (thoff < 0)
+		return NF_ACCEPT;
+
+	flow = flow_offload_lookup(state->net, &t);
+	if (!flow)
+		return NF_ACCEPT;
+
+	/* Let conntrack see the end of the connection */
+	if (t.l4proto == IPPROTO_TCP) {
+		const struct tcphdr *th = (const struct tcphdr *)
+					  (skb_network_header(skb) + thoff);
+
+		if (th->fin || th->rst) {
+			flow_offload_del(flow);
+			return NF_ACCEPT;
+		}
+	}
+
+	rt = (struct rtable *)flow->dst;
+	outdev = rt->dst.dev;
+	if (rt->dst.obsolete > 0 || !(outdev->flags & IFF_UP)) {
+		flow_offload_del(flow);
+		return NF_ACCEPT;
+	}
+
+	/* TTL expiry and fragmentation need ICMP errors, leave them alone */
+	if (ip_hdr(skb)->ttl <= 1)
+		return NF_ACCEPT;
+
+	mtu = dst_mtu(&rt->dst);
+	if (skb_is_gso(skb) ? skb_gso_network_seglen(skb) > mtu :
+			      skb->len > mtu)
+		return NF_ACCEPT;
+
+	if (skb_cow(skb, LL_RESERVED_SPACE(outdev)))
+		return NF_ACCEPT;
+
+	flow_offload_nat(skb, flow, thoff);
+	ip_decrease_ttl(ip_hdr(skb));
+
+	/* Avoid dirtying the cache line more than once per tick */
+	now = jiffies;
+	if (flow->last_used != now)
+		flow->last_used = now;
+
+	skb->priority = rt_tos2priority(ip_hdr(skb)->tos);
+	skb->dev = outdev;
+	skb_dst_drop(skb);
+	skb_dst_set_noref(skb, &rt->dst);
+
+	nexthop = rt_nexthop(rt, flow->nat_daddr);
+	neigh_xmit(NEIGH_ARP_TABLE, outdev, &nexthop, skb);
+
+	return NF_STOLEN;
+}
+
+/*
+ * Offloaded packets don't refresh the conntrack timeout, do it here for
+ * flows that saw traffic since the last pass, the same way
+ * __nf_ct_refresh_acct() would have.
+ */
+static void flow_offload_refresh(struct flow_offload *flow)
+{
+	unsigned long last_used = READ_ONCE(flow->last_used);
+	struct nf_conn *ct = flow->ct;
+	unsigned long newtime;
+
+	if (last_used == flow->refreshed)
+		return;
+
+	flow->refreshed = last_used;
+	newtime = jiffies + flow->timeout;
+	if (newtime - ct->timeout.expires >= HZ)
+		mod_timer_pending(&ct->timeout, newtime);
+}
+
+static void flow_offload_gc(struct work_struct *work);
+static DECLARE_DELAYED_WORK(flow_gc_work, flow_offload_gc);
+
+static void flow_offload_gc(struct work_struct *work)
+{
+	struct flow_offload *flow;
+	struct hlist_node *tmp;
+	unsigned int i;
+
+	for (i = 0; i < FLOW_OFFLOAD_HSIZE; i++) {
+		spin_lock_bh(&flow_lock);
+		hlist_for_each_entry_safe(flow, tmp, &flow_table[i], node) {
+			if (!flow_offload_ct_ok(flow->ct) ||
+			    flow->dst->obsolete > 0)
+				__flow_offload_del(flow);
+			else
+				flow_offload_refresh(flow);
+		}
+		spin_unlock_bh(&flow_lock);
+	}
+
+	schedule_delayed_work(&flow_gc_work, FLOW_OFFLOAD_GC_INTERVAL);
+}
+
+static void flow_offload_flush(const struct net_device *dev)
+{
+	struct flow_offload *flow;
+	struct hlist_node *tmp;
+	unsigned int i;
+
+	spin_lock_bh(&flow_lock);
+	for (i = 0; i < FLOW_OFFLOAD_HSIZE; i++) {
+		hlist_for_each_entry_safe(flow, tmp, &flow_table[i], node) {
+			if (!dev || flow->dst->dev == dev ||
+			    (net_eq(flow->net, dev_net(dev)) &&
+			     flow->tuple.iifindex == dev->ifindex))
+				__flow_offload_del(flow);
+		}
+	}
+	spin_unlock_bh(&flow_lock);
+}
+
+static int flow_offload_netdev_event(struct notifier_block *this,
+				     unsigned long event, void *ptr)
+{
+	struct net_device *dev = netdev_notifier_info_to_dev(ptr);
+
+	if (event == NETDEV_DOWN || event == NETDEV_CHANGEADDR)
+		flow_offload_flush(dev);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block flow_offload_netdev_notifier = {
+	.notifier_call	= flow_offload_netdev_event,
+};
+
+static struct nf_hook_ops flow_offload_ops[] __read_mostly = {
+	{
+		.hook		= flow_offload_ip_hook,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_PRE_ROUTING,
+		.priority	= NF_IP_PRI_FIRST,
+	},
+	{
+		.hook		= flow_offload_forward_hook,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_FORWARD,
+		.priority	= NF_IP_PRI_LAST,
+	},
+};
+
+static int __init nf_flow_offload_ipv4_init(void)
+{
+	int ret;
+
+	get_random_bytes(&flow_hash_rnd, sizeof(flow_hash_rnd));
+
+	ret = register_netdevice_notifier(&flow_offload_netdev_notifier);
+	if (ret < 0)
+		return ret;
+
+	ret = nf_register_hooks(flow_offload_ops,
+				ARRAY_SIZE(flow_offload_ops));
+	if (ret < 0) {
+		unregister_netdevice_notifier(&flow_offload_netdev_notifier);
+		return ret;
+	}
+
+	schedule_delayed_work(&flow_gc_work, FLOW_OFFLOAD_GC_INTERVAL);
+	return 0;
+}
+
+static void __exit nf_flow_offload_ipv4_fini(void)
+{
+	nf_unregister_hooks(flow_offload_ops, ARRAY_SIZE(flow_offload_ops));
+	unregister_netdevice_notifier(&flow_offload_netdev_notifier);
+	cancel_delayed_work_sync(&flow_gc_work);
+	flow_offload_flush(NULL);
+	rcu_barrier();
+}
+
+module_init(nf_flow_offload_ipv4_init);
+module_exit(nf_flow_offload_ipv4_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("IPv4 software flow offload for established connections");
@@ -378,10 +378,18 @@ static int esp6_input(struct xfrm_state *x, struct sk_buff *skb)
 		goto out;
 	}
 
-	nfrags = skb_cow_data(skb, 0, &trailer);
-	if (nfrags < 0) {
-		ret = -EINVAL;
-		goto out;
+	/* An skb nobody else looks at is decrypted in place, page fragments
+	 * included, rather than being linearized by skb_cow_data().
+	 */
+	if (!skb_cloned(skb) && !skb_has_frag_list(skb) &&
+	    !skb_has_shared_frag(skb)) {
+		nfrags = skb_shinfo(skb)->nr_frags + 1;
+	} else {
+		nfrags = skb_cow_data(skb, 0, &trailer);
+		if (nfrags < 0) {
+			ret = -EINVAL;
+			goto out;
+		}
 	}
 
 	ret = -ENOMEM;
@@ -81,6 +81,7 @@ static struct sk_buff *ipv6_gso_segment(struct sk_buff *skb,
 		       SKB_GSO_UDP_TUNNEL_CSUM |
 		       SKB_GSO_TUNNEL_REMCSUM |
 		       SKB_GSO_TCPV6 |
+		       SKB_GSO_UDP_L4 |
 		       0)))
 		goto out;
 
@@ -104,7 +105,8 @@ static struct sk_buff *ipv6_gso_segment(struct sk_buff *skb,
 	    skb_shinfo(skb)->gso_type & (SKB_GSO_SIT|SKB_GSO_IPIP))
 		udpfrag = proto == IPPROTO_UDP && encap;
 	else
-		udpfrag = proto == IPPROTO_UDP && !skb->encapsulation;
+		udpfrag = proto == IPPROTO_UDP && !skb->encapsulation &&
+			  !(skb_shinfo(skb)->gso_type & SKB_GSO_UDP_L4);
 
 	ops = rcu_dereference(inet6_offloads[proto]);
 	if (likely(ops && ops->callbacks.gso_segment)) {
@@ -491,6 +491,9 @@ try_again:
 		*addr_len = sizeof(*sin6);
 	}
 
+	if (udp_sk(sk)->gro_enabled)
+		udp_cmsg_recv(msg, sk, skb);
+
 	if (np->rxopt.all)
 		ip6_datagram_recv_common_ctl(sk, msg, skb);
 
@@ -622,7 +625,7 @@ void udpv6_encap_enable(void)
 }
 EXPORT_SYMBOL(udpv6_encap_enable);
 
-int udpv6_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
+static int udpv6_queue_rcv_one_skb(struct sock *sk, struct sk_buff *skb)
 {
 	struct udp_sock *up = udp_sk(sk);
 	int rc;
@@ -717,6 +720,47 @@ drop:
 	return -1;
 }
 
+static struct sk_buff *udpv6_rcv_segment(struct sock *sk, struct sk_buff *skb)
+{
+	struct sk_buff *segs;
+
+	/* The GSO control block lives after the UDP one */
+	__skb_push(skb, -skb_network_offset(skb));
+	segs = __skb_gso_segment(skb, NETIF_F_SG | NETIF_F_IPV6_CSUM, false);
+	if (IS_ERR_OR_NULL(segs)) {
+		int segs_nr = skb_shinfo(skb)->gso_segs;
+
+		atomic_add(segs_nr, &sk->sk_drops);
+		UDP6_ADD_STATS_BH(sock_net(sk), UDP_MIB_INERRORS, segs_nr,
+				  IS_UDPLITE(sk));
+		kfree_skb(skb);
+		return NULL;
+	}
+
+	consume_skb(skb);
+	return segs;
+}
+
+int udpv6_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
+{
+	struct sk_buff *next, *segs;
+
+	if (likely(!udp_unexpected_gso(sk, skb)))
+		return udpv6_queue_rcv_one_skb(sk, skb);
+
+	segs = udpv6_rcv_segment(sk, skb);
+	for (skb = segs; skb; skb = next) {
+		next = skb->next;
+		skb->next = NULL;
+		__skb_pull(skb, skb_transport_offset(skb));
+
+		/* Segments can't be resubmitted to another protocol */
+		if (udpv6_queue_rcv_one_skb(sk, skb) > 0)
+			kfree_skb(skb);
+	}
+	return 0;
+}
+
 static bool __udp_v6_is_mcast_sock(struct net *net, struct sock *sk,
 				   __be16 loc_port, const struct in6_addr *loc_addr,
 				   __be16 rmt_port, const struct in6_addr *rmt_addr,
@@ -1420,12 +1464,56 @@ void udpv6_destroy_sock(struct sock *sk)
 /*
  *	Socket option code for UDP
  */
+
+/* Plain UDP is only aggregated by the IPv6 GRO handler, so UDP_GRO is
+ * handled here rather than in udp_lib_setsockopt().
+ */
+static int udpv6_setsockopt_gro(struct sock *sk, char __user *optval,
+				unsigned int optlen)
+{
+	int val;
+
+	if (optlen < sizeof(int))
+		return -EINVAL;
+
+	if (get_user(val, (int __user *)optval))
+		return -EFAULT;
+
+	if (val)
+		udpv6_gro_enable();
+	udp_sk(sk)->gro_enabled = val ? 1 : 0;
+	return 0;
+}
+
+static int udpv6_getsockopt_gro(struct sock *sk, char __user *optval,
+				int __user *optlen)
+{
+	int val, len;
+
+	if (get_user(len, optlen))
+		return -EFAULT;
+
+	if (len < 0)
+		return -EINVAL;
+	len = min_t(unsigned int, len, sizeof(int));
+
+	val = udp_sk(sk)->gro_enabled;
+	if (put_user(len, optlen))
+		return -EFAULT;
+	if (copy_to_user(optval, &val, len))
+		return -EFAULT;
+	return 0;
+}
+
 int udpv6_setsockopt(struct sock *sk, int level, int optname,
 		     char __user *optval, unsigned int optlen)
 {
-	if (level == SOL_UDP  ||  level == SOL_UDPLITE)
+	if (level == SOL_UDP  ||  level == SOL_UDPLITE) {
+		if (optname == UDP_GRO)
+			return udpv6_setsockopt_gro(sk, optval, optlen);
 		return udp_lib_setsockopt(sk, level, optname, optval, optlen,
 					  udp_v6_push_pending_frames);
+	}
 	return ipv6_setsockopt(sk, level, optname, optval, optlen);
 }
 
@@ -1433,9 +1521,12 @@ int udpv6_setsockopt(struct sock *sk, int level, int optname,
 int compat_udpv6_setsockopt(struct sock *sk, int level, int optname,
 			    char __user *optval, unsigned int optlen)
 {
-	if (level == SOL_UDP  ||  level == SOL_UDPLITE)
+	if (level == SOL_UDP  ||  level == SOL_UDPLITE) {
+		if (optname == UDP_GRO)
+			return udpv6_setsockopt_gro(sk, optval, optlen);
 		return udp_lib_setsockopt(sk, level, optname, optval, optlen,
 					  udp_v6_push_pending_frames);
+	}
 	return compat_ipv6_setsockopt(sk, level, optname, optval, optlen);
 }
 #endif
@@ -1443,8 +1534,11 @@ int compat_udpv6_setsockopt(struct sock *sk, int level, int optname,
 int udpv6_getsockopt(struct sock *sk, int level, int optname,
 		     char __user *optval, int __user *optlen)
 {
-	if (level == SOL_UDP  ||  level == SOL_UDPLITE)
+	if (level == SOL_UDP  ||  level == SOL_UDPLITE) {
+		if (optname == UDP_GRO)
+			return udpv6_getsockopt_gro(sk, optval, optlen);
 		return udp_lib_getsockopt(sk, level, optname, optval, optlen);
+	}
 	return ipv6_getsockopt(sk, level, optname, optval, optlen);
 }
 
@@ -1452,8 +1546,11 @@ int udpv6_getsockopt(struct sock *sk, int level, int optname,
 int compat_udpv6_getsockopt(struct sock *sk, int level, int optname,
 			    char __user *optval, int __user *optlen)
 {
-	if (level == SOL_UDP  ||  level == SOL_UDPLITE)
+	if (level == SOL_UDP  ||  level == SOL_UDPLITE) {
+		if (optname == UDP_GRO)
+			return udpv6_getsockopt_gro(sk, optval, optlen);
 		return udp_lib_getsockopt(sk, level, optname, optval, optlen);
+	}
 	return compat_ipv6_getsockopt(sk, level, optname, optval, optlen);
 }
 #endif
@@ -15,8 +15,60 @@
 #include <net/ipv6.h>
 #include <net/udp.h>
 #include <net/ip6_checksum.h>
+#include <net/addrconf.h>
+#include <linux/static_key.h>
 #include "ip6_offload.h"
 
+/* Limit the number of segments in a GRO packet, a flood of small
+ * datagrams would otherwise build skbs with a huge truesize.
+ */
+#define UDP_GRO_CNT_MAX 64
+
+static struct static_key udpv6_gro_needed __read_mostly;
+void udpv6_gro_enable(void)
+{
+	if (!static_key_enabled(&udpv6_gro_needed))
+		static_key_slow_inc(&udpv6_gro_needed);
+}
+EXPORT_SYMBOL(udpv6_gro_enable);
+
+static struct sk_buff *udp6_gso_segment(struct sk_buff *skb,
+					netdev_features_t features)
+{
+	const struct ipv6hdr *ipv6h = ipv6_hdr(skb);
+	struct sk_buff *segs = ERR_PTR(-EINVAL);
+	unsigned int hdrlen;
+	struct udphdr *uh;
+
+	if (skb->len <= sizeof(*uh) + skb_shinfo(skb)->gso_size)
+		goto out;
+
+	if (!pskb_may_pull(skb, sizeof(*uh)))
+		goto out;
+
+	hdrlen = skb->data - skb_mac_header(skb);
+	__skb_pull(skb, sizeof(*uh));
+
+	segs = skb_segment(skb, features);
+	if (IS_ERR_OR_NULL(segs))
+		goto out;
+
+	for (skb = segs; skb; skb = skb->next) {
+		unsigned int len = skb->len - hdrlen;
+
+		uh = udp_hdr(skb);
+		uh->len = htons(len);
+		uh->check = ~udp_v6_check(len, &ipv6h->saddr, &ipv6h->daddr, 0);
+
+		if (skb->ip_summed != CHECKSUM_PARTIAL)
+			uh->check = gso_make_checksum(skb, ~uh->check) ? :
+				    CSUM_MANGLED_0;
+	}
+
+out:
+	return segs;
+}
+
 static struct sk_buff *udp6_ufo_fragment(struct sk_buff *skb,
 					 netdev_features_t features)
 {
@@ -30,6 +82,9 @@ static struct sk_buff *udp6_ufo_fragment(struct sk_buff *skb,
 	__wsum csum;
 	int tnl_hlen;
 
+	if (skb_shinfo(skb)->gso_type & SKB_GSO_UDP_L4)
+		return udp6_gso_segment(skb, features);
+
 	mss = skb_shinfo(skb)->gso_size;
 	if (unlikely(skb->len <= mss))
 		goto out;
@@ -126,6 +181,81 @@ out:
 	return segs;
 }
 
+/* Plain UDP is only aggregated for the socket that will receive it, and
+ * only if that socket asked for it with UDP_GRO.
+ */
+static bool udp6_gro_sk_enabled(struct sk_buff *skb, struct udphdr *uh)
+{
+	const struct ipv6hdr *iph = skb_gro_network_header(skb);
+	const struct ipv6_stub *stub = ipv6_stub;
+	struct sock *sk;
+	bool ret;
+
+	if (!static_key_false(&udpv6_gro_needed) || !stub)
+		return false;
+
+	/* Neither inner headers of a tunnel nor multicast, which may be
+	 * delivered to several sockets.
+	 */
+	if (NAPI_GRO_CB(skb)->udp_mark || ipv6_addr_is_multicast(&iph->daddr))
+		return false;
+
+	sk = stub->udp6_lib_lookup(dev_net(skb->dev), &iph->saddr, uh->source,
+				   &iph->daddr, uh->dest, skb->dev->ifindex);
+	if (!sk)
+		return false;
+
+	ret = udp_sk(sk)->gro_enabled && !udp_sk(sk)->encap_type;
+	sock_put(sk);
+	return ret;
+}
+
+static struct sk_buff **udp6_gro_receive_segment(struct sk_buff **head,
+						 struct sk_buff *skb,
+						 struct udphdr *uh)
+{
+	struct sk_buff *p, **pp = NULL;
+	unsigned int off = skb_gro_offset(skb);
+	struct udphdr *uh2;
+
+	/* A zero checksum can't be kept across segmentation */
+	if (!uh->check) {
+		NAPI_GRO_CB(skb)->flush = 1;
+		return NULL;
+	}
+
+	skb_gro_pull(skb, sizeof(struct udphdr));
+	skb_gro_postpull_rcsum(skb, uh, sizeof(struct udphdr));
+
+	for (; (p = *head); head = &p->next) {
+		if (!NAPI_GRO_CB(p)->same_flow)
+			continue;
+
+		uh2 = (struct udphdr *)(p->data + off);
+
+		/* Addresses already matched, checksums always differ */
+		if (*(u32 *)&uh->source != *(u32 *)&uh2->source) {
+			NAPI_GRO_CB(p)->same_flow = 0;
+			continue;
+		}
+
+		/* All segments but the last one must have the same size */
+		if (ntohs(uh->len) > ntohs(uh2->len)) {
+			pp = head;
+			break;
+		}
+
+		/* Flush after a short segment or once the flow grew enough */
+		if (skb_gro_receive(head, skb) ||
+		    uh->len != uh2->len ||
+		    NAPI_GRO_CB(p)->count >= UDP_GRO_CNT_MAX)
+			pp = head;
+		break;
+	}
+
+	return pp;
+}
+
 static struct sk_buff **udp6_gro_receive(struct sk_buff **head,
 					 struct sk_buff *skb)
 {
@@ -147,6 +277,10 @@ static struct sk_buff **udp6_gro_receive(struct sk_buff **head,
 
 skip:
 	NAPI_GRO_CB(skb)->is_ipv6 = 1;
+
+	if (udp6_gro_sk_enabled(skb, uh))
+		return udp6_gro_receive_segment(head, skb, uh);
+
 	return udp_gro_receive(head, skb, uh);
 
 flush:
@@ -159,6 +293,22 @@ static int udp6_gro_complete(struct sk_buff *skb, int nhoff)
 	const struct ipv6hdr *ipv6h = ipv6_hdr(skb);
 	struct udphdr *uh = (struct udphdr *)(skb->data + nhoff);
 
+	/* Tunnel packets are marked by udp_gro_receive() */
+	if (!NAPI_GRO_CB(skb)->udp_mark) {
+		unsigned int len = skb->len - nhoff;
+
+		skb_shinfo(skb)->gso_size = ntohs(uh->len) - sizeof(*uh);
+		skb_shinfo(skb)->gso_segs = NAPI_GRO_CB(skb)->count;
+		skb_shinfo(skb)->gso_type |= SKB_GSO_UDP_L4;
+
+		uh->len = htons(len);
+		uh->check = ~udp_v6_check(len, &ipv6h->saddr, &ipv6h->daddr, 0);
+		skb->csum_start = (unsigned char *)uh - skb->head;
+		skb->csum_offset = offsetof(struct udphdr, check);
+		skb->ip_summed = CHECKSUM_PARTIAL;
+		return 0;
+	}
+
 	if (uh->check) {
 		skb_shinfo(skb)->gso_type |= SKB_GSO_UDP_TUNNEL_CSUM;
 		uh->check = ~udp_v6_check(skb->len - nhoff, &ipv6h->saddr,
@@ -738,62 +738,90 @@ EXPORT_SYMBOL_GPL(nf_conntrack_tuple_taken);
 
 #define NF_CT_EVICTION_RANGE	8
 
-/* There's a small race here where we may free a just-assured
-   connection.  Too bad: we're in trouble anyway. */
-static noinline int early_drop(struct net *net, unsigned int _hash)
+/* Count connections created per cpu and second, see ct_cpu_seq_show() */
+static void nf_ct_account_create(struct net *net)
+{
+	struct ip_conntrack_stat *st = this_cpu_ptr(net->ct.stat);
+	unsigned long now = jiffies;
+
+	if (time_after_eq(now, st->create_stamp + HZ)) {
+		st->create_rate = time_before(now, st->create_stamp + 2 * HZ) ?
+				  st->create_cur : 0;
+		st->create_cur = 0;
+		st->create_stamp = now;
+	}
+	st->create_cur++;
+}
+
+static unsigned int early_drop_list(struct net *net,
+				    struct hlist_nulls_head *head)
 {
-	/* Use oldest entry, which is roughly LRU */
 	struct nf_conntrack_tuple_hash *h;
-	struct nf_conn *ct = NULL, *tmp;
 	struct hlist_nulls_node *n;
-	unsigned int i = 0, cnt = 0;
-	int dropped = 0;
-	unsigned int hash, sequence;
-	spinlock_t *lockp;
+	unsigned int drops = 0;
+	struct nf_conn *tmp;
 
-	local_bh_disable();
-restart:
-	sequence = read_seqcount_begin(&net->ct.generation);
-	hash = hash_bucket(_hash, net);
-	for (; i < net->ct.htable_size; i++) {
-		lockp = &nf_conntrack_locks[hash % CONNTRACK_LOCKS];
-		spin_lock(lockp);
-		if (read_seqcount_retry(&net->ct.generation, sequence)) {
-			spin_unlock(lockp);
-			goto restart;
-		}
-		hlist_nulls_for_each_entry_rcu(h, n, &net->ct.hash[hash],
-					 hnnode) {
-			tmp = nf_ct_tuplehash_to_ctrack(h);
-			if (!test_bit(IPS_ASSURED_BIT, &tmp->status) &&
-			    !nf_ct_is_dying(tmp) &&
-			    atomic_inc_not_zero(&tmp->ct_general.use)) {
-				ct = tmp;
-				break;
-			}
-			cnt++;
-		}
+	hlist_nulls_for_each_entry_rcu(h, n, head, hnnode) {
+		tmp = nf_ct_tuplehash_to_ctrack(h);
 
-		hash = (hash + 1) % net->ct.htable_size;
-		spin_unlock(lockp);
+		if (test_bit(IPS_ASSURED_BIT, &tmp->status) ||
+		    !net_eq(nf_ct_net(tmp), net) ||
+		    nf_ct_is_dying(tmp))
+			continue;
 
-		if (ct || cnt >= NF_CT_EVICTION_RANGE)
-			break;
+		if (!atomic_inc_not_zero(&tmp->ct_general.use))
+			continue;
 
+		/* The entry may have been freed and reused since we looked
+		 * at it (SLAB_DESTROY_BY_RCU), only kill it if it's still
+		 * confirmed in this netns. Stealing the timer fails if it
+		 * already fired or someone else deleted the entry.
+		 */
+		if (net_eq(nf_ct_net(tmp), net) &&
+		    nf_ct_is_confirmed(tmp) &&
+		    del_timer(&tmp->timeout) &&
+		    nf_ct_delete(tmp, 0, 0))
+			drops++;
+
+		nf_ct_put(tmp);
 	}
-	local_bh_enable();
 
-	if (!ct)
-		return dropped;
+	return drops;
+}
+
+/* There's a small race here where we may free a just-assured
+ * connection.  Too bad: we're in trouble anyway.
+ *
+ * This runs for every new connection once the table is full, so it
+ * doesn't take the bucket locks and only looks at a bounded number of
+ * buckets.
+ */
+static noinline int early_drop(struct net *net, unsigned int _hash)
+{
+	unsigned int i;
 
-	if (del_timer(&ct->timeout)) {
-		if (nf_ct_delete(ct, 0, 0)) {
-			dropped = 1;
-			NF_CT_STAT_INC_ATOMIC(net, early_drop);
+	for (i = 0; i < NF_CT_EVICTION_RANGE; i++) {
+		struct hlist_nulls_head *ct_hash;
+		unsigned int hash, sequence, drops;
+
+		rcu_read_lock();
+		do {
+			sequence = read_seqcount_begin(&net->ct.generation);
+			hash = (hash_bucket(_hash, net) + i) %
+			       net->ct.htable_size;
+			ct_hash = net->ct.hash;
+		} while (read_seqcount_retry(&net->ct.generation, sequence));
+
+		drops = early_drop_list(net, &ct_hash[hash]);
+		rcu_read_unlock();
+
+		if (drops) {
+			this_cpu_add(net->ct.stat->early_drop, drops);
+			return 1;
 		}
 	}
-	nf_ct_put(ct);
-	return dropped;
+
+	return 0;
 }
 
 void init_nf_conntrack_hash_rnd(void)
@@ -827,12 +855,13 @@ __nf_conntrack_alloc(struct net *net,
 	}
 
 	/* We don't want any race condition at early drop stage */
-	atomic_inc(&net->ct.count);
+	__percpu_counter_add(&net->ct.count, 1, NF_CT_COUNT_BATCH);
 
 	if (nf_conntrack_max &&
-	    unlikely(atomic_read(&net->ct.count) > nf_conntrack_max)) {
+	    unlikely(nf_conntrack_count(net) > nf_conntrack_max)) {
 		if (!early_drop(net, hash)) {
-			atomic_dec(&net->ct.count);
+			__percpu_counter_add(&net->ct.count, -1,
+					     NF_CT_COUNT_BATCH);
 			net_warn_ratelimited("nf_conntrack: table full, dropping packet\n");
 			return ERR_PTR(-ENOMEM);
 		}
@@ -871,7 +900,7 @@ __nf_conntrack_alloc(struct net *net,
 out_free:
 	kmem_cache_free(net->ct.nf_conntrack_cachep, ct);
 out:
-	atomic_dec(&net->ct.count);
+	__percpu_counter_add(&net->ct.count, -1, NF_CT_COUNT_BATCH);
 	return ERR_PTR(-ENOMEM);
 }
 
@@ -897,8 +926,7 @@ void nf_conntrack_free(struct nf_conn *ct)
 	nf_ct_ext_destroy(ct);
 	nf_ct_ext_free(ct);
 	kmem_cache_free(net->ct.nf_conntrack_cachep, ct);
-	smp_mb__before_atomic();
-	atomic_dec(&net->ct.count);
+	__percpu_counter_add(&net->ct.count, -1, NF_CT_COUNT_BATCH);
 }
 EXPORT_SYMBOL_GPL(nf_conntrack_free);
 
@@ -998,6 +1026,7 @@ init_conntrack(struct net *net, struct nf_conn *tmpl,
 	if (!exp) {
 		__nf_ct_try_assign_helper(ct, tmpl, GFP_ATOMIC);
 		NF_CT_STAT_INC(net, new);
+		nf_ct_account_create(net);
 	}
 
 	/* Now it is inserted into the unconfirmed list, bump refcount */
@@ -1513,7 +1542,7 @@ i_see_dead_people:
 	busy = 0;
 	list_for_each_entry(net, net_exit_list, exit_list) {
 		nf_ct_iterate_cleanup(net, kill_all, NULL, 0, 0);
-		if (atomic_read(&net->ct.count) != 0)
+		if (percpu_counter_sum(&net->ct.count) != 0)
 			busy = 1;
 	}
 	if (busy) {
@@ -1533,6 +1562,7 @@ i_see_dead_people:
 		kfree(net->ct.slabname);
 		free_percpu(net->ct.stat);
 		free_percpu(net->ct.pcpu_lists);
+		percpu_counter_destroy(&net->ct.count);
 	}
 }
 
@@ -1613,6 +1643,8 @@ int nf_conntrack_set_hashsize(const char *val, struct kernel_param *kp)
 	nf_conntrack_all_unlock();
 	local_bh_enable();
 
+	/* Wait for lockless walkers (lookups, early_drop) of the old table */
+	synchronize_net();
 	nf_ct_free_hashtable(old_hash, old_size);
 	return 0;
 }
@@ -1760,7 +1792,10 @@ int nf_conntrack_init_net(struct net *net)
 	int ret = -ENOMEM;
 	int cpu;
 
-	atomic_set(&net->ct.count, 0);
+	ret = percpu_counter_init(&net->ct.count, 0, GFP_KERNEL);
+	if (ret < 0)
+		return ret;
+	ret = -ENOMEM;
 	seqcount_init(&net->ct.generation);
 
 	net->ct.pcpu_lists = alloc_percpu(struct ct_pcpu);
@@ -1838,5 +1873,6 @@ err_slabname:
 err_pcpu_lists:
 	free_percpu(net->ct.pcpu_lists);
 err_stat:
+	percpu_counter_destroy(&net->ct.count);
 	return ret;
 }
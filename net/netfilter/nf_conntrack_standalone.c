@@ -336,16 +336,27 @@ static void ct_cpu_seq_stop(struct seq_file *seq, void *v)
 static int ct_cpu_seq_show(struct seq_file *seq, void *v)
 {
 	struct net *net = seq_file_net(seq);
-	unsigned int nr_conntracks = atomic_read(&net->ct.count);
+	unsigned int nr_conntracks = nf_conntrack_count(net);
 	const struct ip_conntrack_stat *st = v;
+	unsigned long stamp;
+	unsigned int rate;
 
 	if (v == SEQ_START_TOKEN) {
-		seq_printf(seq, "entries  searched found new invalid ignore delete delete_list insert insert_failed drop early_drop icmp_error  expect_new expect_create expect_delete search_restart\n");
+		seq_printf(seq, "entries  searched found new invalid ignore delete delete_list insert insert_failed drop early_drop icmp_error  expect_new expect_create expect_delete search_restart create_rate\n");
 		return 0;
 	}
 
+	/* The cpu only rolls its window over when it creates an entry */
+	stamp = READ_ONCE(st->create_stamp);
+	if (time_before(jiffies, stamp + HZ))
+		rate = st->create_rate;
+	else if (time_before(jiffies, stamp + 2 * HZ))
+		rate = st->create_cur;
+	else
+		rate = 0;
+
 	seq_printf(seq, "%08x  %08x %08x %08x %08x %08x %08x %08x "
-			"%08x %08x %08x %08x %08x  %08x %08x %08x %08x\n",
+			"%08x %08x %08x %08x %08x  %08x %08x %08x %08x %08x\n",
 		   nr_conntracks,
 		   st->searched,
 		   st->found,
@@ -363,7 +374,8 @@ static int ct_cpu_seq_show(struct seq_file *seq, void *v)
 		   st->expect_new,
 		   st->expect_create,
 		   st->expect_delete,
-		   st->search_restart
+		   st->search_restart,
+		   rate
 		);
 	return 0;
 }
@@ -434,6 +446,20 @@ static int log_invalid_proto_max = 255;
 
 static struct ctl_table_header *nf_ct_netfilter_header;
 
+/* .data points to the percpu_counter of the netns */
+int nf_conntrack_count_sysctl(struct ctl_table *table, int write,
+			      void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	struct ctl_table tmp = *table;
+	int count;
+
+	count = percpu_counter_sum_positive(table->data);
+	tmp.data = &count;
+
+	return proc_dointvec(&tmp, write, buffer, lenp, ppos);
+}
+EXPORT_SYMBOL_GPL(nf_conntrack_count_sysctl);
+
 static struct ctl_table nf_ct_sysctl_table[] = {
 	{
 		.procname	= "nf_conntrack_max",
@@ -447,7 +473,7 @@ static struct ctl_table nf_ct_sysctl_table[] = {
 		.data		= &init_net.ct.count,
 		.maxlen		= sizeof(int),
 		.mode		= 0444,
-		.proc_handler	= proc_dointvec,
+		.proc_handler	= nf_conntrack_count_sysctl,
 	},
 	{
 		.procname       = "nf_conntrack_buckets",
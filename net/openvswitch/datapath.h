@@ -133,6 +133,7 @@ struct dp_upcall_info {
 struct ovs_net {
 	struct list_head dps;
 	struct work_struct dp_notify_work;
+	struct delayed_work masks_rebalance;
 
 	/* Module reference for configuring conntrack. */
 	bool xt_label;
@@ -130,7 +130,8 @@ struct sw_flow_key_range {
 struct sw_flow_mask {
 	int ref_count;
 	struct rcu_head rcu;
-	struct list_head list;
+	u64 __percpu *hits;	/* Flows found through this mask. */
+	u64 last_hits;		/* 'hits' at the last rebalance. */
 	struct sw_flow_key_range range;
 	struct sw_flow_key key;
 };
@@ -74,6 +74,7 @@
 #include <net/sock.h>
 #include <linux/errno.h>
 #include <linux/timer.h>
+#include <linux/interrupt.h>
 #include <asm/uaccess.h>
 #include <asm/ioctls.h>
 #include <asm/page.h>
@@ -205,11 +206,8 @@ static void prb_retire_current_block(struct tpacket_kbdq_core *,
 static int prb_queue_frozen(struct tpacket_kbdq_core *);
 static void prb_open_block(struct tpacket_kbdq_core *,
 		struct tpacket_block_desc *);
-static void prb_retire_rx_blk_timer_expired(unsigned long);
+static enum hrtimer_restart prb_retire_rx_blk_timer_expired(struct hrtimer *);
 static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *);
-static void prb_init_blk_timer(struct packet_sock *,
-		struct tpacket_kbdq_core *,
-		void (*func) (unsigned long));
 static void prb_fill_rxhash(struct tpacket_kbdq_core *, struct tpacket3_hdr *);
 static void prb_clear_rxhash(struct tpacket_kbdq_core *,
 		struct tpacket3_hdr *);
@@ -410,6 +408,9 @@ static void __packet_set_status(struct packet_sock *po, void *frame, int status)
 		flush_dcache_page(pgv_to_page(&h.h2->tp_status));
 		break;
 	case TPACKET_V3:
+		h.h3->tp_status = status;
+		flush_dcache_page(pgv_to_page(&h.h3->tp_status));
+		break;
 	default:
 		WARN(1, "TPACKET version not supported.\n");
 		BUG();
@@ -433,6 +434,8 @@ static int __packet_get_status(struct packet_sock *po, void *frame)
 		flush_dcache_page(pgv_to_page(&h.h2->tp_status));
 		return h.h2->tp_status;
 	case TPACKET_V3:
+		flush_dcache_page(pgv_to_page(&h.h3->tp_status));
+		return h.h3->tp_status;
 	default:
 		WARN(1, "TPACKET version not supported.\n");
 		BUG();
@@ -477,6 +480,9 @@ static __u32 __packet_set_timestamp(struct packet_sock *po, void *frame,
 		h.h2->tp_nsec = ts.tv_nsec;
 		break;
 	case TPACKET_V3:
+		h.h3->tp_sec = ts.tv_sec;
+		h.h3->tp_nsec = ts.tv_nsec;
+		break;
 	default:
 		WARN(1, "TPACKET version not supported.\n");
 		BUG();
@@ -518,7 +524,7 @@ static void *packet_current_frame(struct packet_sock *po,
 
 static void prb_del_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 {
-	del_timer_sync(&pkc->retire_blk_timer);
+	tasklet_hrtimer_cancel(&pkc->retire_blk_timer);
 }
 
 static void prb_shutdown_retire_blk_timer(struct packet_sock *po,
@@ -535,22 +541,18 @@ static void prb_shutdown_retire_blk_timer(struct packet_sock *po,
 	prb_del_retire_blk_timer(pkc);
 }
 
-static void prb_init_blk_timer(struct packet_sock *po,
-		struct tpacket_kbdq_core *pkc,
-		void (*func) (unsigned long))
-{
-	init_timer(&pkc->retire_blk_timer);
-	pkc->retire_blk_timer.data = (long)po;
-	pkc->retire_blk_timer.function = func;
-	pkc->retire_blk_timer.expires = jiffies;
-}
-
+/* The retire timer is an hrtimer so that short timeouts are honoured
+ * independently of HZ, but it expires through a tasklet: it takes the
+ * receive queue lock, which is not irq safe.
+ */
 static void prb_setup_retire_blk_timer(struct packet_sock *po)
 {
 	struct tpacket_kbdq_core *pkc;
 
 	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
-	prb_init_blk_timer(po, pkc, prb_retire_rx_blk_timer_expired);
+	tasklet_hrtimer_init(&pkc->retire_blk_timer,
+			     prb_retire_rx_blk_timer_expired,
+			     CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 }
 
 static int prb_calc_retire_blk_tmo(struct packet_sock *po,
@@ -627,7 +629,7 @@ static void init_prb_bdqc(struct packet_sock *po,
 	else
 		p1->retire_blk_tov = prb_calc_retire_blk_tmo(po,
 						req_u->req3.tp_block_size);
-	p1->tov_in_jiffies = msecs_to_jiffies(p1->retire_blk_tov);
+	p1->interval_ktime = ms_to_ktime(p1->retire_blk_tov);
 	p1->blk_sizeof_priv = req_u->req3.tp_sizeof_priv;
 
 	p1->max_frame_len = p1->kblk_size - BLK_PLUS_PRIV(p1->blk_sizeof_priv);
@@ -641,8 +643,8 @@ static void init_prb_bdqc(struct packet_sock *po,
  */
 static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 {
-	mod_timer(&pkc->retire_blk_timer,
-			jiffies + pkc->tov_in_jiffies);
+	tasklet_hrtimer_start(&pkc->retire_blk_timer, pkc->interval_ktime,
+			      HRTIMER_MODE_REL);
 	pkc->last_kactive_blk_num = pkc->kactive_blk_num;
 }
 
@@ -669,13 +671,16 @@ static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *pkc)
  * prb_calc_retire_blk_tmo() calculates the tmo.
  *
  */
-static void prb_retire_rx_blk_timer_expired(unsigned long data)
+static enum hrtimer_restart prb_retire_rx_blk_timer_expired(struct hrtimer *t)
 {
-	struct packet_sock *po = (struct packet_sock *)data;
-	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
+	struct tpacket_kbdq_core *pkc;
+	struct packet_sock *po;
 	unsigned int frozen;
 	struct tpacket_block_desc *pbd;
 
+	pkc = container_of(t, struct tpacket_kbdq_core, retire_blk_timer.timer);
+	po = container_of(pkc, struct packet_sock, rx_ring.prb_bdqc);
+
 	spin_lock(&po->sk.sk_receive_queue.lock);
 
 	frozen = prb_queue_frozen(pkc);
@@ -740,6 +745,7 @@ refresh_timer:
 
 out:
 	spin_unlock(&po->sk.sk_receive_queue.lock);
+	return HRTIMER_NORESTART;
 }
 
 static void prb_flush_block(struct tpacket_kbdq_core *pkc1,
@@ -2369,6 +2375,13 @@ static int tpacket_fill_skb(struct packet_sock *po, struct sk_buff *skb,
 	skb_shinfo(skb)->destructor_arg = ph.raw;
 
 	switch (po->tp_version) {
+	case TPACKET_V3:
+		if (ph.h3->tp_next_offset != 0) {
+			pr_warn_once("variable sized slot not supported");
+			return -EINVAL;
+		}
+		tp_len = ph.h3->tp_len;
+		break;
 	case TPACKET_V2:
 		tp_len = ph.h2->tp_len;
 		break;
@@ -2390,6 +2403,9 @@ static int tpacket_fill_skb(struct packet_sock *po, struct sk_buff *skb,
 		off_max = po->tx_ring.frame_size - tp_len;
 		if (sock->type == SOCK_DGRAM) {
 			switch (po->tp_version) {
+			case TPACKET_V3:
+				off = ph.h3->tp_net;
+				break;
 			case TPACKET_V2:
 				off = ph.h2->tp_net;
 				break;
@@ -2399,6 +2415,9 @@ static int tpacket_fill_skb(struct packet_sock *po, struct sk_buff *skb,
 			}
 		} else {
 			switch (po->tp_version) {
+			case TPACKET_V3:
+				off = ph.h3->tp_mac;
+				break;
 			case TPACKET_V2:
 				off = ph.h2->tp_mac;
 				break;
@@ -2632,6 +2651,9 @@ static struct sk_buff *packet_alloc_skb(struct sock *sk, size_t prepad,
 	return skb;
 }
 
+/* Below this, copying the payload is cheaper than pinning user pages */
+#define PACKET_ZC_MIN	PAGE_SIZE
+
 static int packet_snd(struct socket *sock, struct msghdr *msg, size_t len)
 {
 	struct sock *sk = sock->sk;
@@ -2647,7 +2669,9 @@ static int packet_snd(struct socket *sock, struct msghdr *msg, size_t len)
 	int vnet_hdr_len;
 	struct packet_sock *po = pkt_sk(sk);
 	unsigned short gso_type = 0;
-	int hlen, tlen;
+	struct ubuf_info *uarg = NULL;
+	bool zc = false;
+	int hlen, tlen, linear;
 	int extra_len = 0;
 	ssize_t n;
 
@@ -2678,6 +2702,7 @@ static int packet_snd(struct socket *sock, struct msghdr *msg, size_t len)
 		goto out_unlock;
 
 	sockc.mark = sk->sk_mark;
+	sockc.transmit_time = 0;
 	if (msg->msg_controllen) {
 		err = sock_cmsg_send(sk, msg, &sockc);
 		if (unlikely(err))
@@ -2749,11 +2774,27 @@ static int packet_snd(struct socket *sock, struct msghdr *msg, size_t len)
 		goto out_unlock;
 
 	err = -ENOBUFS;
+	linear = __virtio16_to_cpu(vio_le(), vnet_hdr.hdr_len);
+	if ((msg->msg_flags & MSG_ZEROCOPY) && sock_flag(sk, SOCK_ZEROCOPY)) {
+		uarg = sock_zerocopy_alloc(sk, len);
+		if (!uarg)
+			goto out_unlock;
+
+		/* The link layer header of SOCK_RAW stays in the linear
+		 * area, only the rest is taken from the user pages.
+		 */
+		if ((dev->features & NETIF_F_SG) && len >= PACKET_ZC_MIN) {
+			zc = true;
+			linear = max_t(int, linear, min_t(int, len, reserve));
+		} else {
+			uarg->zerocopy = 0;
+		}
+	}
+
 	hlen = LL_RESERVED_SPACE(dev);
 	tlen = dev->needed_tailroom;
-	skb = packet_alloc_skb(sk, hlen + tlen, hlen, len,
-			       __virtio16_to_cpu(vio_le(), vnet_hdr.hdr_len),
-			       msg->msg_flags & MSG_DONTWAIT, &err);
+	skb = packet_alloc_skb(sk, hlen + tlen, hlen, zc ? linear : len,
+			       linear, msg->msg_flags & MSG_DONTWAIT, &err);
 	if (skb == NULL)
 		goto out_unlock;
 
@@ -2770,9 +2811,21 @@ static int packet_snd(struct socket *sock, struct msghdr *msg, size_t len)
 	}
 
 	/* Returns -EFAULT on error */
-	err = skb_copy_datagram_from_iter(skb, offset, &msg->msg_iter, len);
-	if (err)
-		goto out_free;
+	if (zc) {
+		err = skb_copy_datagram_from_iter(skb, offset, &msg->msg_iter,
+						  linear);
+		if (!err)
+			err = __zerocopy_sg_from_iter(sk, skb, &msg->msg_iter,
+						      len - linear);
+		if (err)
+			goto out_free;
+		skb_zcopy_set(skb, uarg);
+	} else {
+		err = skb_copy_datagram_from_iter(skb, offset, &msg->msg_iter,
+						  len);
+		if (err)
+			goto out_free;
+	}
 
 	sock_tx_timestamp(sk, &skb_shinfo(skb)->tx_flags);
 
@@ -2786,6 +2839,7 @@ static int packet_snd(struct socket *sock, struct msghdr *msg, size_t len)
 	skb->dev = dev;
 	skb->priority = sk->sk_priority;
 	skb->mark = sockc.mark;
+	skb->tstamp = ns_to_ktime(sockc.transmit_time);
 
 	packet_pick_tx_queue(dev, skb);
 
@@ -2816,6 +2870,8 @@ static int packet_snd(struct socket *sock, struct msghdr *msg, size_t len)
 		skb->no_fcs = 1;
 
 	err = po->xmit(skb);
+	sock_zerocopy_put(uarg);
+	uarg = NULL;
 	if (err > 0 && (err = net_xmit_errno(err)) != 0)
 		goto out_unlock;
 
@@ -2826,6 +2882,7 @@ static int packet_snd(struct socket *sock, struct msghdr *msg, size_t len)
 out_free:
 	kfree_skb(skb);
 out_unlock:
+	sock_zerocopy_put_abort(uarg);
 	if (dev)
 		dev_put(dev);
 out:
@@ -4072,12 +4129,6 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 	/* Added to avoid minimal code churn */
 	struct tpacket_req *req = &req_u->req;
 
-	/* Opening a Tx-ring is NOT supported in TPACKET_V3 */
-	if (!closing && tx_ring && (po->tp_version > TPACKET_V2)) {
-		WARN(1, "Tx-ring is not supported.\n");
-		goto out;
-	}
-
 	rb = tx_ring ? &po->tx_ring : &po->rx_ring;
 	rb_queue = tx_ring ? &sk->sk_write_queue : &sk->sk_receive_queue;
 
@@ -4116,6 +4167,11 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		    (int)(req->tp_block_size -
 			  BLK_PLUS_PRIV(req_u->req3.tp_sizeof_priv)) <= 0)
 			goto out;
+		if (po->tp_version >= TPACKET_V3 && tx_ring &&
+		    (req_u->req3.tp_retire_blk_tov ||
+		     req_u->req3.tp_sizeof_priv ||
+		     req_u->req3.tp_feature_req_word))
+			goto out;
 		if (unlikely(req->tp_frame_size < po->tp_hdrlen +
 					po->tp_reserve))
 			goto out;
@@ -4136,9 +4192,9 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 			goto out;
 		switch (po->tp_version) {
 		case TPACKET_V3:
-		/* Transmit path is not supported. We checked
-		 * it above but just being paranoid
-		 */
+			/* Block transmit is not supported yet: the TX ring
+			 * is used as fixed size frames, like TPACKET_V2.
+			 */
 			if (!tx_ring)
 				init_prb_bdqc(po, rb, pg_vec, req_u);
 			break;
@@ -2,6 +2,7 @@
 #include <linux/sock_diag.h>
 #include <linux/net.h>
 #include <linux/netdevice.h>
+#include <linux/interrupt.h>
 #include <linux/packet_diag.h>
 #include <linux/percpu.h>
 #include <net/net_namespace.h>
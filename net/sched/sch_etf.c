@@ -0,0 +1,398 @@
+/*
+ * net/sched/sch_etf.c  Earliest TxTime First queueing discipline.
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version
+ *	2 of the License, or (at your option) any later version.
+ *
+ *  Packets carry their transmit time in skb->tstamp, set by the sender
+ *  through SO_TXTIME/SCM_TXTIME. They are kept in an RB tree ordered by
+ *  that time and handed to the device @delta nanoseconds before it.
+ *  Packets whose time has already passed are dropped, both on enqueue
+ *  and on dequeue.
+ *
+ *  In deadline mode the transmit time is a deadline rather than a launch
+ *  time: packets are sent as soon as possible, in deadline order.
+ *
+ *  The qdisc only accepts packets from sockets that enabled SO_TXTIME
+ *  with the same clockid and mode it was configured with.
+ */
+
+#include <linux/module.h>
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/errno.h>
+#include <linux/rbtree.h>
+#include <linux/skbuff.h>
+#include <net/netlink.h>
+#include <net/sch_generic.h>
+#include <net/pkt_sched.h>
+#include <net/sock.h>
+
+struct etf_sched_data {
+	bool deadline_mode;
+	int clockid;
+	s32 delta; /* in ns */
+	ktime_t last; /* The txtime of the last skb sent to the netdevice. */
+	struct rb_root head;
+	struct qdisc_watchdog watchdog;
+	ktime_t (*get_time)(void);
+};
+
+/* skb->rbnode shares storage with skb->tstamp, so the transmit time is
+ * kept in skb->cb[] while the packet sits in the tree.
+ */
+struct etf_skb_cb {
+	ktime_t txtime;
+};
+
+static inline struct etf_skb_cb *etf_skb_cb(struct sk_buff *skb)
+{
+	qdisc_cb_private_validate(skb, sizeof(struct etf_skb_cb));
+	return (struct etf_skb_cb *)qdisc_skb_cb(skb)->data;
+}
+
+static inline struct sk_buff *etf_rb_to_skb(struct rb_node *rb)
+{
+	return rb ? container_of(rb, struct sk_buff, rbnode) : NULL;
+}
+
+static const struct nla_policy etf_policy[TCA_ETF_MAX + 1] = {
+	[TCA_ETF_PARMS]	= { .len = sizeof(struct tc_etf_qopt) },
+};
+
+static inline int validate_input_params(struct tc_etf_qopt *qopt)
+{
+	/* Check if params comply to the following rules:
+	 *	* Clockid must be a valid static clock we can read from
+	 *	  softirq context.
+	 *	* Delta must be a positive integer.
+	 */
+	switch (qopt->clockid) {
+	case CLOCK_REALTIME:
+	case CLOCK_MONOTONIC:
+	case CLOCK_BOOTTIME:
+	case CLOCK_TAI:
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	if (qopt->delta < 0)
+		return -EINVAL;
+
+	return 0;
+}
+
+static bool is_packet_valid(struct Qdisc *sch, struct sk_buff *nskb)
+{
+	struct etf_sched_data *q = qdisc_priv(sch);
+	ktime_t txtime = nskb->tstamp;
+	struct sock *sk = nskb->sk;
+	ktime_t now;
+
+	if (!sk || !sk_fullsock(sk))
+		return false;
+
+	if (!sock_flag(sk, SOCK_TXTIME))
+		return false;
+
+	/* We don't perform crosstimestamping.
+	 * Drop if packet's clockid differs from qdisc's.
+	 */
+	if (sk->sk_clockid != q->clockid)
+		return false;
+
+	if (sk->sk_txtime_deadline_mode != q->deadline_mode)
+		return false;
+
+	now = q->get_time();
+	if (ktime_before(txtime, now) || ktime_before(txtime, q->last))
+		return false;
+
+	return true;
+}
+
+static struct sk_buff *etf_peek_timesortedlist(struct Qdisc *sch)
+{
+	struct etf_sched_data *q = qdisc_priv(sch);
+
+	return etf_rb_to_skb(rb_first(&q->head));
+}
+
+static void reset_watchdog(struct Qdisc *sch)
+{
+	struct etf_sched_data *q = qdisc_priv(sch);
+	struct sk_buff *skb = etf_peek_timesortedlist(sch);
+	ktime_t next;
+
+	if (!skb) {
+		qdisc_watchdog_cancel(&q->watchdog);
+		return;
+	}
+
+	next = ktime_sub_ns(etf_skb_cb(skb)->txtime, q->delta);
+	qdisc_watchdog_schedule_ns(&q->watchdog, ktime_to_ns(next), false);
+}
+
+static int etf_enqueue_timesortedlist(struct sk_buff *nskb, struct Qdisc *sch)
+{
+	struct etf_sched_data *q = qdisc_priv(sch);
+	struct rb_node **p = &q->head.rb_node, *parent = NULL;
+	ktime_t txtime = nskb->tstamp;
+
+	if (!is_packet_valid(sch, nskb))
+		return qdisc_drop(nskb, sch);
+
+	if (unlikely(sch->q.qlen >= sch->limit))
+		return qdisc_drop(nskb, sch);
+
+	while (*p) {
+		struct sk_buff *skb;
+
+		parent = *p;
+		skb = etf_rb_to_skb(parent);
+		if (ktime_after(txtime, etf_skb_cb(skb)->txtime))
+			p = &parent->rb_right;
+		else
+			p = &parent->rb_left;
+	}
+
+	etf_skb_cb(nskb)->txtime = txtime;
+	rb_link_node(&nskb->rbnode, parent, p);
+	rb_insert_color(&nskb->rbnode, &q->head);
+
+	qdisc_qstats_backlog_inc(sch, nskb);
+	sch->q.qlen++;
+
+	/* Now we may need to re-arm the qdisc watchdog for the next packet. */
+	reset_watchdog(sch);
+
+	return NET_XMIT_SUCCESS;
+}
+
+static void etf_unlink(struct Qdisc *sch, struct sk_buff *skb)
+{
+	struct etf_sched_data *q = qdisc_priv(sch);
+
+	rb_erase(&skb->rbnode, &q->head);
+
+	/* The rbnode field in the skb re-uses these fields, now that
+	 * we are done with the rbnode, reset them.
+	 */
+	skb->next = NULL;
+	skb->prev = NULL;
+	skb->tstamp = etf_skb_cb(skb)->txtime;
+	skb->dev = qdisc_dev(sch);
+
+	qdisc_qstats_backlog_dec(sch, skb);
+	sch->q.qlen--;
+}
+
+static void timesortedlist_drop(struct Qdisc *sch, ktime_t now)
+{
+	struct etf_sched_data *q = qdisc_priv(sch);
+	struct rb_node *p;
+	int count = 0;
+
+	while ((p = rb_first(&q->head))) {
+		struct sk_buff *skb = etf_rb_to_skb(p);
+
+		if (ktime_after(etf_skb_cb(skb)->txtime, now))
+			break;
+
+		etf_unlink(sch, skb);
+		qdisc_qstats_overlimit(sch);
+		qdisc_drop(skb, sch);
+		count++;
+	}
+
+	qdisc_tree_decrease_qlen(sch, count);
+}
+
+static struct sk_buff *etf_dequeue_timesortedlist(struct Qdisc *sch)
+{
+	struct etf_sched_data *q = qdisc_priv(sch);
+	struct sk_buff *skb;
+	ktime_t now, next;
+
+	skb = etf_peek_timesortedlist(sch);
+	if (!skb)
+		return NULL;
+
+	now = q->get_time();
+
+	/* Drop if packet has expired while in queue. */
+	if (ktime_before(etf_skb_cb(skb)->txtime, now)) {
+		timesortedlist_drop(sch, now);
+		skb = NULL;
+		goto out;
+	}
+
+	/* When in deadline mode, dequeue as soon as possible and change the
+	 * txtime from deadline to (now + delta).
+	 */
+	if (q->deadline_mode) {
+		etf_unlink(sch, skb);
+		skb->tstamp = ktime_add_ns(now, q->delta);
+		goto out;
+	}
+
+	next = ktime_sub_ns(etf_skb_cb(skb)->txtime, q->delta);
+
+	/* Dequeue only if now is within the [txtime - delta, txtime] range. */
+	if (ktime_after(now, next))
+		etf_unlink(sch, skb);
+	else
+		skb = NULL;
+
+out:
+	if (skb) {
+		q->last = skb->tstamp;
+		qdisc_bstats_update(sch, skb);
+	}
+
+	/* Now we may need to re-arm the qdisc watchdog for the next packet. */
+	reset_watchdog(sch);
+
+	return skb;
+}
+
+static int etf_init(struct Qdisc *sch, struct nlattr *opt)
+{
+	struct etf_sched_data *q = qdisc_priv(sch);
+	struct nlattr *tb[TCA_ETF_MAX + 1];
+	struct tc_etf_qopt *qopt;
+	int err;
+
+	if (!opt)
+		return -EINVAL;
+
+	err = nla_parse_nested(tb, TCA_ETF_MAX, opt, etf_policy);
+	if (err < 0)
+		return err;
+
+	if (!tb[TCA_ETF_PARMS])
+		return -EINVAL;
+
+	qopt = nla_data(tb[TCA_ETF_PARMS]);
+
+	err = validate_input_params(qopt);
+	if (err < 0)
+		return err;
+
+	/* Everything went OK, save the parameters used. */
+	q->delta = qopt->delta;
+	q->clockid = qopt->clockid;
+	q->deadline_mode = !!(qopt->flags & TC_ETF_DEADLINE_MODE_ON);
+	q->head = RB_ROOT;
+	sch->limit = qdisc_dev(sch)->tx_queue_len ? : 1;
+
+	switch (q->clockid) {
+	case CLOCK_REALTIME:
+		q->get_time = ktime_get_real;
+		break;
+	case CLOCK_MONOTONIC:
+		q->get_time = ktime_get;
+		break;
+	case CLOCK_BOOTTIME:
+		q->get_time = ktime_get_boottime;
+		break;
+	case CLOCK_TAI:
+		q->get_time = ktime_get_clocktai;
+		break;
+	}
+
+	qdisc_watchdog_init_clockid(&q->watchdog, sch, q->clockid);
+	/* On PREEMPT_RT the watchdog would otherwise expire from the
+	 * softirq thread, adding its scheduling latency to every launch.
+	 * The callback only kicks the TX softirq, so run it in hardirq.
+	 */
+	q->watchdog.timer.irqsafe = 1;
+
+	return 0;
+}
+
+static void etf_reset(struct Qdisc *sch)
+{
+	struct etf_sched_data *q = qdisc_priv(sch);
+	struct rb_node *p;
+
+	/* Only cancel watchdog if it's been initialized. */
+	if (q->watchdog.qdisc == sch)
+		qdisc_watchdog_cancel(&q->watchdog);
+
+	while ((p = rb_first(&q->head))) {
+		struct sk_buff *skb = etf_rb_to_skb(p);
+
+		etf_unlink(sch, skb);
+		kfree_skb(skb);
+	}
+
+	sch->qstats.backlog = 0;
+	sch->q.qlen = 0;
+
+	q->last = ktime_set(0, 0);
+}
+
+static void etf_destroy(struct Qdisc *sch)
+{
+	struct etf_sched_data *q = qdisc_priv(sch);
+
+	/* Only cancel watchdog if it's been initialized. */
+	if (q->watchdog.qdisc == sch)
+		qdisc_watchdog_cancel(&q->watchdog);
+}
+
+static int etf_dump(struct Qdisc *sch, struct sk_buff *skb)
+{
+	struct etf_sched_data *q = qdisc_priv(sch);
+	struct tc_etf_qopt opt = { };
+	struct nlattr *nest;
+
+	nest = nla_nest_start(skb, TCA_OPTIONS);
+	if (!nest)
+		goto nla_put_failure;
+
+	opt.delta = q->delta;
+	opt.clockid = q->clockid;
+	if (q->deadline_mode)
+		opt.flags |= TC_ETF_DEADLINE_MODE_ON;
+
+	if (nla_put(skb, TCA_ETF_PARMS, sizeof(opt), &opt))
+		goto nla_put_failure;
+
+	return nla_nest_end(skb, nest);
+
+nla_put_failure:
+	nla_nest_cancel(skb, nest);
+	return -1;
+}
+
+static struct Qdisc_ops etf_qdisc_ops __read_mostly = {
+	.id		=	"etf",
+	.priv_size	=	sizeof(struct etf_sched_data),
+	.enqueue	=	etf_enqueue_timesortedlist,
+	.dequeue	=	etf_dequeue_timesortedlist,
+	.peek		=	etf_peek_timesortedlist,
+	.init		=	etf_init,
+	.reset		=	etf_reset,
+	.destroy	=	etf_destroy,
+	.dump		=	etf_dump,
+	.owner		=	THIS_MODULE,
+};
+
+static int __init etf_module_init(void)
+{
+	return register_qdisc(&etf_qdisc_ops);
+}
+
+static void __exit etf_module_exit(void)
+{
+	unregister_qdisc(&etf_qdisc_ops);
+}
+module_init(etf_module_init)
+module_exit(etf_module_exit)
+MODULE_LICENSE("GPL");
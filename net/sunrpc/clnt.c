@@ -284,6 +284,21 @@ static struct rpc_xprt *rpc_clnt_set_transport(struct rpc_clnt *clnt,
 	return old;
 }
 
+static void rpc_clnt_put_xprts(struct rpc_clnt *clnt)
+{
+	unsigned int i, nr;
+
+	spin_lock(&clnt->cl_lock);
+	nr = clnt->cl_nr_xprts;
+	clnt->cl_nr_xprts = 0;
+	spin_unlock(&clnt->cl_lock);
+
+	for (i = 0; i < nr; i++) {
+		xprt_put(clnt->cl_xprts[i]);
+		clnt->cl_xprts[i] = NULL;
+	}
+}
+
 static void rpc_clnt_set_nodename(struct rpc_clnt *clnt, const char *nodename)
 {
 	clnt->cl_nodelen = strlcpy(clnt->cl_nodename,
@@ -489,6 +504,8 @@ EXPORT_SYMBOL_GPL(rpc_create_xprt);
 struct rpc_clnt *rpc_create(struct rpc_create_args *args)
 {
 	struct rpc_xprt *xprt;
+	struct rpc_clnt *clnt;
+	unsigned int nconnect;
 	struct xprt_create xprtargs = {
 		.net = args->net,
 		.ident = args->protocol,
@@ -552,7 +569,25 @@ struct rpc_clnt *rpc_create(struct rpc_create_args *args)
 	if (args->flags & RPC_CLNT_CREATE_NONPRIVPORT)
 		xprt->resvport = 0;
 
-	return rpc_create_xprt(args, xprt);
+	clnt = rpc_create_xprt(args, xprt);
+	if (IS_ERR(clnt))
+		return clnt;
+
+	/*
+	 * Extra transports to the same server let small requests avoid
+	 * queueing behind large ones. They are a best effort, the client
+	 * works with whatever could be set up.
+	 */
+	nconnect = min_t(unsigned int, args->nconnect, RPC_MAX_XPRTS);
+	while (clnt->cl_nr_xprts + 1 < nconnect) {
+		xprt = xprt_create_transport(&xprtargs);
+		if (IS_ERR(xprt))
+			break;
+		xprt->resvport = !(args->flags & RPC_CLNT_CREATE_NONPRIVPORT);
+		clnt->cl_xprts[clnt->cl_nr_xprts++] = xprt;
+	}
+
+	return clnt;
 }
 EXPORT_SYMBOL_GPL(rpc_create);
 
@@ -583,6 +618,14 @@ static struct rpc_clnt *__rpc_clone_client(struct rpc_create_args *args,
 		goto out_err;
 	}
 
+	/* Clones share the extra transports as well */
+	spin_lock(&clnt->cl_lock);
+	while (new->cl_nr_xprts < clnt->cl_nr_xprts) {
+		xprt = xprt_get(clnt->cl_xprts[new->cl_nr_xprts]);
+		new->cl_xprts[new->cl_nr_xprts++] = xprt;
+	}
+	spin_unlock(&clnt->cl_lock);
+
 	/* Turn off autobind on clones */
 	new->cl_autobind = 0;
 	new->cl_softrtry = clnt->cl_softrtry;
@@ -670,6 +713,9 @@ int rpc_switch_client_transport(struct rpc_clnt *clnt,
 
 	pseudoflavor = clnt->cl_auth->au_flavor;
 
+	/* The extra transports still point to the old server */
+	rpc_clnt_put_xprts(clnt);
+
 	old_timeo = clnt->cl_timeout;
 	old = rpc_clnt_set_transport(clnt, xprt, timeout);
 
@@ -782,6 +828,7 @@ rpc_free_client(struct rpc_clnt *clnt)
 	rpc_unregister_client(clnt);
 	rpc_free_iostats(clnt->cl_metrics);
 	clnt->cl_metrics = NULL;
+	rpc_clnt_put_xprts(clnt);
 	xprt_put(rcu_dereference_raw(clnt->cl_xprt));
 	rpciod_down();
 	rpc_free_clid(clnt);
@@ -865,10 +912,51 @@ out:
 }
 EXPORT_SYMBOL_GPL(rpc_bind_new_program);
 
+/*
+ * Bind the task to the transport with the fewest tasks. The scan starts
+ * at a rotating position, so that ties are broken round-robin.
+ */
+static void rpc_task_set_transport(struct rpc_task *task,
+				   struct rpc_clnt *clnt)
+{
+	unsigned int i, nr = clnt->cl_nr_xprts + 1;
+	unsigned int start = clnt->cl_xprt_next++;
+	struct rpc_xprt *xprt, *best = NULL;
+
+	for (i = 0; i < nr; i++) {
+		unsigned int idx = (start + i) % nr;
+
+		if (idx == 0)
+			xprt = rcu_dereference_protected(clnt->cl_xprt,
+					lockdep_is_held(&clnt->cl_lock));
+		else
+			xprt = clnt->cl_xprts[idx - 1];
+
+		if (!best || atomic_long_read(&xprt->queuelen) <
+			     atomic_long_read(&best->queuelen))
+			best = xprt;
+	}
+
+	task->tk_xprt = xprt_get(best);
+	atomic_long_inc(&best->queuelen);
+}
+
+static void rpc_task_release_transport(struct rpc_task *task)
+{
+	struct rpc_xprt *xprt = task->tk_xprt;
+
+	if (xprt != NULL) {
+		task->tk_xprt = NULL;
+		atomic_long_dec(&xprt->queuelen);
+		xprt_put(xprt);
+	}
+}
+
 void rpc_task_release_client(struct rpc_task *task)
 {
 	struct rpc_clnt *clnt = task->tk_client;
 
+	rpc_task_release_transport(task);
 	if (clnt != NULL) {
 		/* Remove from client task list */
 		spin_lock(&clnt->cl_lock);
@@ -896,6 +984,8 @@ void rpc_task_set_client(struct rpc_task *task, struct rpc_clnt *clnt)
 		/* Add to the client's list of all tasks */
 		spin_lock(&clnt->cl_lock);
 		list_add_tail(&task->tk_task, &clnt->cl_tasks);
+		if (clnt->cl_nr_xprts)
+			rpc_task_set_transport(task, clnt);
 		spin_unlock(&clnt->cl_lock);
 	}
 }
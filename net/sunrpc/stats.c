@@ -205,6 +205,7 @@ void rpc_print_iostats(struct seq_file *seq, struct rpc_clnt *clnt)
 	struct rpc_iostats *stats = clnt->cl_metrics;
 	struct rpc_xprt *xprt;
 	unsigned int op, maxproc = clnt->cl_maxproc;
+	unsigned int i;
 
 	if (!stats)
 		return;
@@ -219,6 +220,13 @@ void rpc_print_iostats(struct seq_file *seq, struct rpc_clnt *clnt)
 		xprt->ops->print_stats(xprt, seq);
 	rcu_read_unlock();
 
+	spin_lock(&clnt->cl_lock);
+	for (i = 0; i < clnt->cl_nr_xprts; i++) {
+		xprt = clnt->cl_xprts[i];
+		xprt->ops->print_stats(xprt, seq);
+	}
+	spin_unlock(&clnt->cl_lock);
+
 	seq_printf(seq, "\tper-op statistics\n");
 	for (op = 0; op < maxproc; op++) {
 		struct rpc_iostats *metrics = &stats[op];
@@ -117,6 +117,7 @@
 #include <net/checksum.h>
 #include <linux/security.h>
 #include <linux/freezer.h>
+#include <linux/uaccess.h>
 
 struct hlist_head unix_socket_table[2 * UNIX_HASH_SIZE];
 EXPORT_SYMBOL_GPL(unix_socket_table);
@@ -1848,6 +1849,99 @@ out:
  */
 #define UNIX_SKB_FRAGS_SZ (PAGE_SIZE << get_order(32768))
 
+/* Would an skb sent by @sock to @other with @scm carry the credentials
+ * of @skb, once maybe_add_creds() is done with it.
+ */
+static bool unix_skb_creds_eq(struct sk_buff *skb, struct scm_cookie *scm,
+			      const struct socket *sock,
+			      const struct sock *other)
+{
+	const struct unix_skb_parms *u = &UNIXCB(skb);
+	kuid_t uid;
+	kgid_t gid;
+
+	if (scm->pid || !unix_passcred_enabled(sock, other))
+		return unix_skb_scm_eq(skb, scm);
+
+	current_uid_gid(&uid, &gid);
+	return u->pid == task_tgid(current) &&
+	       uid_eq(u->uid, uid) &&
+	       gid_eq(u->gid, gid) &&
+	       unix_secdata_eq(scm, skb);
+}
+
+/* Append a small write to the linear tailroom of the last skb queued to
+ * @other, instead of allocating and queueing one skb per write. Returns
+ * the number of bytes appended, 0 if a new skb is needed, or an error.
+ */
+static int unix_stream_append_tail(struct socket *sock, struct sock *other,
+				   struct msghdr *msg, struct scm_cookie *scm,
+				   int size)
+{
+	struct sock *sk = sock->sk;
+	struct iov_iter iter = msg->msg_iter;
+	struct sk_buff *skb;
+	size_t copied;
+	int err = 0;
+
+	/* readers consume queued skbs under the readlock, don't wait for
+	 * them as a new skb does just as well
+	 */
+	if (!mutex_trylock(&unix_sk(other)->readlock))
+		return 0;
+
+	unix_state_lock(other);
+	if (sock_flag(other, SOCK_DEAD) ||
+	    (other->sk_shutdown & RCV_SHUTDOWN)) {
+		err = -EPIPE;
+		goto out_state_unlock;
+	}
+
+	skb = skb_peek_tail(&other->sk_receive_queue);
+	if (!skb || skb->sk != sk || skb_is_nonlinear(skb) ||
+	    skb_cloned(skb) || UNIXCB(skb).fp || skb_tailroom(skb) < size ||
+	    !unix_skb_creds_eq(skb, scm, sock, other))
+		goto out_state_unlock;
+
+	/* the data is not visible before skb->len grows */
+	skb_get(skb);
+	unix_state_unlock(other);
+
+	/* don't fault with the peer's readlock held: a page that isn't
+	 * there goes the slow way, into a new skb
+	 */
+	pagefault_disable();
+	copied = copy_from_iter(skb_tail_pointer(skb), size, &msg->msg_iter);
+	pagefault_enable();
+	if (copied != size) {
+		msg->msg_iter = iter;
+		goto out_put;
+	}
+
+	unix_state_lock(other);
+	if (sock_flag(other, SOCK_DEAD) ||
+	    (other->sk_shutdown & RCV_SHUTDOWN)) {
+		err = -EPIPE;
+		goto out_state_unlock_put;
+	}
+	__skb_put(skb, size);
+	err = size;
+
+out_state_unlock_put:
+	unix_state_unlock(other);
+out_put:
+	kfree_skb(skb);
+	mutex_unlock(&unix_sk(other)->readlock);
+	if (err > 0)
+		other->sk_data_ready(other);
+	return err;
+
+out_state_unlock:
+	unix_state_unlock(other);
+	mutex_unlock(&unix_sk(other)->readlock);
+	return err;
+}
+
 static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			       size_t len)
 {
@@ -1896,6 +1990,19 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 
 		data_len = min_t(size_t, size, PAGE_ALIGN(data_len));
 
+		if (!data_len && (fds_sent || !scm.fp)) {
+			err = unix_stream_append_tail(sock, other, msg, &scm,
+						      size);
+			if (err == -EPIPE)
+				goto pipe_err;
+			if (err < 0)
+				goto out_err;
+			if (err) {
+				sent += size;
+				continue;
+			}
+		}
+
 		skb = sock_alloc_send_pskb(sk, size - data_len, data_len,
 					   msg->msg_flags & MSG_DONTWAIT, &err,
 					   get_order(UNIX_SKB_FRAGS_SZ));
@@ -32,13 +32,21 @@ struct lpass_pcm_data {
 
 #define LPASS_PLATFORM_BUFFER_SIZE	(16 * 1024)
 #define LPASS_PLATFORM_PERIODS		2
+#define LPASS_PLATFORM_PERIOD_BYTES_MIN	128
+#define LPASS_PLATFORM_PERIOD_BYTES_STEP	16
 
+/*
+ * The position is read back from the DMA current address register, so the
+ * period interrupt is only needed to wake up user space. Streams that poll
+ * the position may turn it off with SNDRV_PCM_INFO_NO_PERIOD_WAKEUP.
+ */
 static struct snd_pcm_hardware lpass_platform_pcm_hardware = {
 	.info			=	SNDRV_PCM_INFO_MMAP |
 					SNDRV_PCM_INFO_MMAP_VALID |
 					SNDRV_PCM_INFO_INTERLEAVED |
 					SNDRV_PCM_INFO_PAUSE |
-					SNDRV_PCM_INFO_RESUME,
+					SNDRV_PCM_INFO_RESUME |
+					SNDRV_PCM_INFO_NO_PERIOD_WAKEUP,
 	.formats		=	SNDRV_PCM_FMTBIT_S16 |
 					SNDRV_PCM_FMTBIT_S24 |
 					SNDRV_PCM_FMTBIT_S32,
@@ -50,10 +58,10 @@ static struct snd_pcm_hardware lpass_platform_pcm_hardware = {
 	.buffer_bytes_max	=	LPASS_PLATFORM_BUFFER_SIZE,
 	.period_bytes_max	=	LPASS_PLATFORM_BUFFER_SIZE /
 						LPASS_PLATFORM_PERIODS,
-	.period_bytes_min	=	LPASS_PLATFORM_BUFFER_SIZE /
-						LPASS_PLATFORM_PERIODS,
+	.period_bytes_min	=	LPASS_PLATFORM_PERIOD_BYTES_MIN,
 	.periods_min		=	LPASS_PLATFORM_PERIODS,
-	.periods_max		=	LPASS_PLATFORM_PERIODS,
+	.periods_max		=	LPASS_PLATFORM_BUFFER_SIZE /
+						LPASS_PLATFORM_PERIOD_BYTES_MIN,
 	.fifo_size		=	0,
 };
 
@@ -75,6 +83,16 @@ static int lpass_platform_pcmops_open(struct snd_pcm_substream *substream)
 		return -EINVAL;
 	}
 
+	/* DMA lengths are programmed in words and fetched in INCR4 bursts */
+	ret = snd_pcm_hw_constraint_step(runtime, 0,
+			SNDRV_PCM_HW_PARAM_PERIOD_BYTES,
+			LPASS_PLATFORM_PERIOD_BYTES_STEP);
+	if (ret < 0) {
+		dev_err(soc_runtime->dev, "%s() setting constraints failed: %d\n",
+				__func__, ret);
+		return -EINVAL;
+	}
+
 	snd_pcm_set_runtime_buffer(substream, &substream->dma_buffer);
 
 	return 0;
@@ -260,6 +278,7 @@ static int lpass_platform_pcmops_trigger(struct snd_pcm_substream *substream,
 	struct lpass_data *drvdata =
 		snd_soc_platform_get_drvdata(soc_runtime->platform);
 	struct lpass_variant *v = drvdata->variant;
+	unsigned int irqs;
 	int ret, ch, dir = substream->stream;
 
 	if (dir == SNDRV_PCM_STREAM_PLAYBACK)
@@ -267,6 +286,10 @@ static int lpass_platform_pcmops_trigger(struct snd_pcm_substream *substream,
 	else
 		ch = pcm_data->wrdma_ch;
 
+	irqs = LPAIF_IRQ_ALL(ch);
+	if (substream->runtime->no_period_wakeup)
+		irqs &= ~LPAIF_IRQ_PER(ch);
+
 	switch (cmd) {
 	case SNDRV_PCM_TRIGGER_START:
 	case SNDRV_PCM_TRIGGER_RESUME:
@@ -283,8 +306,7 @@ static int lpass_platform_pcmops_trigger(struct snd_pcm_substream *substream,
 
 		ret = regmap_update_bits(drvdata->lpaif_map,
 				LPAIF_IRQEN_REG(v, LPAIF_IRQ_PORT_HOST),
-				LPAIF_IRQ_ALL(ch),
-				LPAIF_IRQ_ALL(ch));
+				LPAIF_IRQ_ALL(ch), irqs);
 		if (ret) {
 			dev_err(soc_runtime->dev, "%s() error writing to irqen reg: %d\n",
 					__func__, ret);
@@ -336,7 +358,8 @@ static snd_pcm_uframes_t lpass_platform_pcmops_pointer(
 	struct lpass_data *drvdata =
 			snd_soc_platform_get_drvdata(soc_runtime->platform);
 	struct lpass_variant *v = drvdata->variant;
-	unsigned int base_addr, curr_addr;
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	unsigned int curr_addr, pos;
 	int ret, ch, dir = substream->stream;
 
 	if (dir == SNDRV_PCM_STREAM_PLAYBACK)
@@ -344,14 +367,7 @@ static snd_pcm_uframes_t lpass_platform_pcmops_pointer(
 	else
 		ch = pcm_data->wrdma_ch;
 
-	ret = regmap_read(drvdata->lpaif_map,
-			LPAIF_DMABASE_REG(v, ch, dir), &base_addr);
-	if (ret) {
-		dev_err(soc_runtime->dev, "%s() error reading from rdmabase reg: %d\n",
-				__func__, ret);
-		return ret;
-	}
-
+	/* The base register holds runtime->dma_addr, see prepare */
 	ret = regmap_read(drvdata->lpaif_map,
 			LPAIF_DMACURR_REG(v, ch, dir), &curr_addr);
 	if (ret) {
@@ -360,7 +376,11 @@ static snd_pcm_uframes_t lpass_platform_pcmops_pointer(
 		return ret;
 	}
 
-	return bytes_to_frames(substream->runtime, curr_addr - base_addr);
+	pos = curr_addr - runtime->dma_addr;
+	if (pos >= snd_pcm_lib_buffer_bytes(substream))
+		pos = 0;
+
+	return bytes_to_frames(runtime, pos);
 }
 
 static int lpass_platform_pcmops_mmap(struct snd_pcm_substream *substream,
@@ -71,6 +71,56 @@ static struct snd_pcm_hardware msm_pcm_hardware_capture = {
 	.fifo_size =            0,
 };
 
+/*
+ * Low latency streams use the DSP performance mode topologies, run with
+ * small periods and keep several of them queued on the DSP, so that the
+ * mmap ring is drained without a round trip per period.
+ */
+#define LL_PERIOD_SIZE		384
+#define LL_MIN_NUM_PERIODS	4
+#define LL_MAX_NUM_PERIODS	8
+#define LL_PLAYBACK_INFLIGHT	2
+
+static struct snd_pcm_hardware msm_pcm_hardware_capture_ll = {
+	.info =                 (SNDRV_PCM_INFO_MMAP |
+				SNDRV_PCM_INFO_BLOCK_TRANSFER |
+				SNDRV_PCM_INFO_MMAP_VALID |
+				SNDRV_PCM_INFO_INTERLEAVED |
+				SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_RESUME),
+	.formats =              SNDRV_PCM_FMTBIT_S16_LE,
+	.rates =                SNDRV_PCM_RATE_48000,
+	.rate_min =             48000,
+	.rate_max =             48000,
+	.channels_min =         1,
+	.channels_max =         2,
+	.buffer_bytes_max =     LL_MAX_NUM_PERIODS * LL_PERIOD_SIZE,
+	.period_bytes_min =	LL_PERIOD_SIZE,
+	.period_bytes_max =     LL_PERIOD_SIZE,
+	.periods_min =          LL_MIN_NUM_PERIODS,
+	.periods_max =          LL_MAX_NUM_PERIODS,
+	.fifo_size =            0,
+};
+
+static struct snd_pcm_hardware msm_pcm_hardware_playback_ll = {
+	.info =                 (SNDRV_PCM_INFO_MMAP |
+				SNDRV_PCM_INFO_BLOCK_TRANSFER |
+				SNDRV_PCM_INFO_MMAP_VALID |
+				SNDRV_PCM_INFO_INTERLEAVED |
+				SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_RESUME),
+	.formats =              SNDRV_PCM_FMTBIT_S16_LE,
+	.rates =                SNDRV_PCM_RATE_48000,
+	.rate_min =             48000,
+	.rate_max =             48000,
+	.channels_min =         1,
+	.channels_max =         2,
+	.buffer_bytes_max =     LL_MAX_NUM_PERIODS * LL_PERIOD_SIZE,
+	.period_bytes_min =	LL_PERIOD_SIZE,
+	.period_bytes_max =     LL_PERIOD_SIZE,
+	.periods_min =          LL_MAX_NUM_PERIODS,
+	.periods_max =          LL_MAX_NUM_PERIODS,
+	.fifo_size =            0,
+};
+
 static struct snd_pcm_hardware msm_pcm_hardware_playback = {
 	.info =                 (SNDRV_PCM_INFO_MMAP |
 				SNDRV_PCM_INFO_BLOCK_TRANSFER |
@@ -115,9 +165,11 @@ static void msm_pcm_route_event_handler(enum msm_pcm_routing_event event,
 
 	switch (event) {
 	case MSM_PCM_RT_EVT_BUF_RECFG:
+		q6asm_async_begin(prtd->audio_client);
 		q6asm_cmd(prtd->audio_client, CMD_PAUSE);
 		q6asm_cmd(prtd->audio_client, CMD_FLUSH);
 		q6asm_run(prtd->audio_client, 0, 0, 0);
+		q6asm_async_end(prtd->audio_client);
 	default:
 		break;
 	}
@@ -207,13 +259,17 @@ static void event_handler(uint32_t opcode,
 				break;
 			}
 			if (prtd->mmap_flag) {
+				int inflight = prtd->low_latency ?
+					LL_PLAYBACK_INFLIGHT : 1;
+
 				pr_debug("%s:writing %d bytes"
 					" of buffer to dsp\n",
 					__func__,
-					prtd->pcm_count);
-				q6asm_write_nolock(prtd->audio_client,
-					prtd->pcm_count,
-					0, 0, NO_TIMESTAMP);
+					prtd->pcm_count * inflight);
+				for (i = 0; i < inflight; i++)
+					q6asm_write_nolock(prtd->audio_client,
+						prtd->pcm_count,
+						0, 0, NO_TIMESTAMP);
 			} else {
 				while (atomic_read(&prtd->out_needed)) {
 					pr_debug("%s:writing %d bytes"
@@ -365,10 +421,15 @@ static int msm_pcm_open(struct snd_pcm_substream *substream)
 		kfree(prtd);
 		return -ENOMEM;
 	}
-	prtd->audio_client->perf_mode = false;
+	prtd->low_latency = of_property_read_bool(
+				soc_prtd->platform->dev->of_node,
+				"qcom,msm-pcm-low-latency");
+	prtd->audio_client->perf_mode = prtd->low_latency;
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
-		runtime->hw = msm_pcm_hardware_playback;
-		snd_soc_set_runtime_hwparams(substream, &msm_pcm_hardware_playback);
+		runtime->hw = prtd->low_latency ?
+			msm_pcm_hardware_playback_ll :
+			msm_pcm_hardware_playback;
+		snd_soc_set_runtime_hwparams(substream, &runtime->hw);
 		if(snd_pcm_hw_constraint_integer(runtime,
 						SNDRV_PCM_HW_PARAM_PERIODS) < 0)
 			pr_err("%s Failed to set hw periods\n", __func__);
@@ -396,7 +457,9 @@ static int msm_pcm_open(struct snd_pcm_substream *substream)
 	}
 	/* Capture path */
 	if (substream->stream == SNDRV_PCM_STREAM_CAPTURE) {
-		runtime->hw = msm_pcm_hardware_capture;
+		runtime->hw = prtd->low_latency ?
+			msm_pcm_hardware_capture_ll :
+			msm_pcm_hardware_capture;
 	}
 
 	ret = snd_pcm_hw_constraint_list(runtime, 0,
@@ -410,12 +473,14 @@ static int msm_pcm_open(struct snd_pcm_substream *substream)
 	if (ret < 0)
 		pr_err("snd_pcm_hw_constraint_integer failed\n");
 
-	if (snd_pcm_hw_constraint_step(substream->runtime, 0,
+	if (!prtd->low_latency &&
+	    snd_pcm_hw_constraint_step(substream->runtime, 0,
 			 SNDRV_PCM_HW_PARAM_PERIOD_BYTES,
 			 2048) <0)
 		pr_err("snd_pcm_hw_constraint_integer  period bytes failed\n");
 
-	if (substream->stream == SNDRV_PCM_STREAM_CAPTURE) {
+	if (substream->stream == SNDRV_PCM_STREAM_CAPTURE &&
+	    !prtd->low_latency) {
 		ret = snd_pcm_hw_constraint_minmax(runtime,
 			SNDRV_PCM_HW_PARAM_BUFFER_BYTES,
 			CAPTURE_MIN_NUM_PERIODS * CAPTURE_MIN_PERIOD_SIZE,
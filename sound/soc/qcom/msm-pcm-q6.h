@@ -83,6 +83,7 @@ struct msm_audio {
 	atomic_t pending_buffer;
 	int cmd_interrupt;
 	bool meta_data_mode;
+	bool low_latency;
 };
 
 struct output_meta_data_st {
@@ -308,6 +308,58 @@ int apr_send_pkt(void *handle, uint32_t *buf)
 	return w_len;
 }
 
+/*
+ * Commands that don't fit on the stack used to be allocated and freed
+ * around every send. Each service keeps a few preallocated packets for
+ * them instead; larger packets, or a busy pool, fall back to kzalloc().
+ * The pool is allocated on first registration and kept, like the
+ * service itself.
+ */
+void apr_pkt_pool_init(struct apr_svc *svc)
+{
+	if (svc->pkt_pool)
+		return;
+
+	svc->pkt_pool = kcalloc(APR_PKT_POOL_CNT, APR_PKT_POOL_SIZE,
+				GFP_KERNEL);
+	if (svc->pkt_pool)
+		svc->pkt_free = (1UL << APR_PKT_POOL_CNT) - 1;
+}
+
+void *apr_pkt_alloc(void *handle, size_t size, gfp_t gfp)
+{
+	struct apr_svc *svc = handle;
+	void *pkt;
+	int i;
+
+	if (!svc || !svc->pkt_pool || size > APR_PKT_POOL_SIZE)
+		return kzalloc(size, gfp);
+
+	for_each_set_bit(i, &svc->pkt_free, APR_PKT_POOL_CNT) {
+		if (test_and_clear_bit(i, &svc->pkt_free)) {
+			pkt = svc->pkt_pool + i * APR_PKT_POOL_SIZE;
+			memset(pkt, 0, size);
+			return pkt;
+		}
+	}
+
+	return kzalloc(size, gfp);
+}
+
+void apr_pkt_free(void *handle, void *pkt)
+{
+	struct apr_svc *svc = handle;
+	void *pool = svc ? svc->pkt_pool : NULL;
+
+	if (pool && pkt >= pool &&
+	    pkt < pool + APR_PKT_POOL_CNT * APR_PKT_POOL_SIZE) {
+		set_bit((pkt - pool) / APR_PKT_POOL_SIZE, &svc->pkt_free);
+		return;
+	}
+
+	kfree(pkt);
+}
+
 void apr_cb_func(void *buf, int len, void *priv)
 {
 	struct apr_client_data data;
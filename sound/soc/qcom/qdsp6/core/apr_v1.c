@@ -96,6 +96,7 @@ struct apr_svc *apr_register(char *dest, char *svc_name, apr_fn svc_fn,
 	svc->id = svc_id;
 	svc->dest_id = dest_id;
 	svc->client_id = client_id;
+	apr_pkt_pool_init(svc);
 	if (src_port != 0xFFFFFFFF) {
 		temp_port = ((src_port >> 8) * 8) + (src_port & 0xFF);
 		pr_debug("port = %d t_port = %d\n", src_port, temp_port);
@@ -68,7 +68,7 @@ int srs_trumedia_open(int port_id, int srs_tech_id, void *srs_params)
 		struct srs_trumedia_params_GLOBAL *glb_params = NULL;
 		sz = sizeof(struct asm_pp_params_command) +
 			sizeof(struct srs_trumedia_params_GLOBAL);
-		open = kzalloc(sz, GFP_KERNEL);
+		open = apr_pkt_alloc(this_adm.apr, sz, GFP_KERNEL);
 		open->payload_size = sizeof(struct srs_trumedia_params_GLOBAL) +
 					sizeof(struct asm_pp_param_data_hdr);
 		open->params.param_id = SRS_TRUMEDIA_PARAMS;
@@ -91,7 +91,7 @@ int srs_trumedia_open(int port_id, int srs_tech_id, void *srs_params)
 		struct srs_trumedia_params_WOWHD *whd_params = NULL;
 		sz = sizeof(struct asm_pp_params_command) +
 			sizeof(struct srs_trumedia_params_WOWHD);
-		open = kzalloc(sz, GFP_KERNEL);
+		open = apr_pkt_alloc(this_adm.apr, sz, GFP_KERNEL);
 		open->payload_size = sizeof(struct srs_trumedia_params_WOWHD) +
 					sizeof(struct asm_pp_param_data_hdr);
 		open->params.param_id = SRS_TRUMEDIA_PARAMS_WOWHD;
@@ -115,7 +115,7 @@ int srs_trumedia_open(int port_id, int srs_tech_id, void *srs_params)
 		struct srs_trumedia_params_CSHP *chp_params = NULL;
 		sz = sizeof(struct asm_pp_params_command) +
 			sizeof(struct srs_trumedia_params_CSHP);
-		open = kzalloc(sz, GFP_KERNEL);
+		open = apr_pkt_alloc(this_adm.apr, sz, GFP_KERNEL);
 		open->payload_size = sizeof(struct srs_trumedia_params_CSHP) +
 					sizeof(struct asm_pp_param_data_hdr);
 		open->params.param_id = SRS_TRUMEDIA_PARAMS_CSHP;
@@ -138,7 +138,7 @@ int srs_trumedia_open(int port_id, int srs_tech_id, void *srs_params)
 		struct srs_trumedia_params_HPF *hpf_params = NULL;
 		sz = sizeof(struct asm_pp_params_command) +
 			sizeof(struct srs_trumedia_params_HPF);
-		open = kzalloc(sz, GFP_KERNEL);
+		open = apr_pkt_alloc(this_adm.apr, sz, GFP_KERNEL);
 		open->payload_size = sizeof(struct srs_trumedia_params_HPF) +
 					sizeof(struct asm_pp_param_data_hdr);
 		open->params.param_id = SRS_TRUMEDIA_PARAMS_HPF;
@@ -156,7 +156,7 @@ int srs_trumedia_open(int port_id, int srs_tech_id, void *srs_params)
 		struct srs_trumedia_params_PEQ *peq_params = NULL;
 		sz = sizeof(struct asm_pp_params_command) +
 			sizeof(struct srs_trumedia_params_PEQ);
-		open = kzalloc(sz, GFP_KERNEL);
+		open = apr_pkt_alloc(this_adm.apr, sz, GFP_KERNEL);
 		open->payload_size = sizeof(struct srs_trumedia_params_PEQ) +
 					sizeof(struct asm_pp_param_data_hdr);
 		open->params.param_id = SRS_TRUMEDIA_PARAMS_PEQ;
@@ -176,7 +176,7 @@ int srs_trumedia_open(int port_id, int srs_tech_id, void *srs_params)
 		struct srs_trumedia_params_HL *hl_params = NULL;
 		sz = sizeof(struct asm_pp_params_command) +
 			sizeof(struct srs_trumedia_params_HL);
-		open = kzalloc(sz, GFP_KERNEL);
+		open = apr_pkt_alloc(this_adm.apr, sz, GFP_KERNEL);
 		open->payload_size = sizeof(struct srs_trumedia_params_HL) +
 					sizeof(struct asm_pp_param_data_hdr);
 		open->params.param_id = SRS_TRUMEDIA_PARAMS_HL;
@@ -234,7 +234,7 @@ int srs_trumedia_open(int port_id, int srs_tech_id, void *srs_params)
 	}
 
 fail_cmd:
-	kfree(open);
+	apr_pkt_free(this_adm.apr, open);
 	return ret;
 }
 
@@ -1019,7 +1019,7 @@ int adm_memory_map_regions(uint32_t *buf_add, uint32_t mempool_id,
 	cmd_size = sizeof(struct adm_cmd_memory_map_regions)
 			+ sizeof(struct adm_memory_map_regions) * bufcnt;
 
-	mmap_region_cmd = kzalloc(cmd_size, GFP_KERNEL);
+	mmap_region_cmd = apr_pkt_alloc(this_adm.apr, cmd_size, GFP_KERNEL);
 	if (!mmap_region_cmd) {
 		pr_err("%s: allocate mmap_region_cmd failed\n", __func__);
 		return -ENOMEM;
@@ -1064,7 +1064,7 @@ int adm_memory_map_regions(uint32_t *buf_add, uint32_t mempool_id,
 		goto fail_cmd;
 	}
 fail_cmd:
-	kfree(mmap_region_cmd);
+	apr_pkt_free(this_adm.apr, mmap_region_cmd);
 	return ret;
 }
 
@@ -1089,7 +1089,7 @@ int adm_memory_unmap_regions(uint32_t *buf_add, uint32_t *bufsz,
 	cmd_size = sizeof(struct adm_cmd_memory_unmap_regions)
 			+ sizeof(struct adm_memory_unmap_regions) * bufcnt;
 
-	unmap_region_cmd = kzalloc(cmd_size, GFP_KERNEL);
+	unmap_region_cmd = apr_pkt_alloc(this_adm.apr, cmd_size, GFP_KERNEL);
 	if (!unmap_region_cmd) {
 		pr_err("%s: allocate unmap_region_cmd failed\n", __func__);
 		return -ENOMEM;
@@ -1133,7 +1133,7 @@ int adm_memory_unmap_regions(uint32_t *buf_add, uint32_t *bufsz,
 		goto fail_cmd;
 	}
 fail_cmd:
-	kfree(unmap_region_cmd);
+	apr_pkt_free(this_adm.apr, unmap_region_cmd);
 	return ret;
 }
 
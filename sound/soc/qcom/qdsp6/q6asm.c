@@ -667,6 +667,15 @@ static int32_t is_no_wait_cmd_rsp(uint32_t opcode, uint32_t *cmd_type)
 	return 0;
 }
 
+static void q6asm_async_done(struct audio_client *ac, uint32_t seq,
+				uint32_t status)
+{
+	if (status)
+		atomic_cmpxchg(&ac->cmd_async_err, 0, status);
+	atomic_set(&ac->cmd_done_seq, seq);
+	wake_up(&ac->cmd_wait);
+}
+
 static int32_t q6asm_callback(struct apr_client_data *data, void *priv)
 {
 	int i = 0;
@@ -688,7 +697,10 @@ static int32_t q6asm_callback(struct apr_client_data *data, void *priv)
 	}
 
 	payload = data->payload;
-	if ((atomic_read(&ac->nowait_cmd_cnt) > 0) &&
+	if (data->opcode == APR_BASIC_RSP_RESULT && (data->token >> 8)) {
+		q6asm_async_done(ac, data->token >> 8, payload[1]);
+		wakeup_flag = 0;
+	} else if ((atomic_read(&ac->nowait_cmd_cnt) > 0) &&
 		is_no_wait_cmd_rsp(data->opcode, payload)) {
 		pr_debug("%s: nowait_cmd_cnt %d\n",
 				__func__,
@@ -714,7 +726,7 @@ static int32_t q6asm_callback(struct apr_client_data *data, void *priv)
 		data->dest_port);
 
 	if (data->opcode == APR_BASIC_RSP_RESULT) {
-		token = data->token;
+		token = data->token & 0xFF;
 		pr_debug("%s payload[0]:%x", __func__, payload[0]);
 		switch (payload[0]) {
 		case ASM_STREAM_CMD_SET_PP_PARAMS:
@@ -1044,6 +1056,25 @@ int q6asm_is_dsp_buf_avail(int dir, struct audio_client *ac)
 	return ret;
 }
 
+/*
+ * Commands that expect a response carry the session in the low byte of
+ * the token. Inside an async batch the upper bits carry a sequence number
+ * instead of arming cmd_state, so the senders don't wait for each
+ * response and q6asm_async_end() waits for the last one.
+ */
+static uint32_t q6asm_cmd_token(struct audio_client *ac)
+{
+	if (!ac->cmd_async) {
+		atomic_set(&ac->cmd_state, 1);
+		return ac->session;
+	}
+
+	ac->cmd_seq = (ac->cmd_seq + 1) & 0xFFFFFF;
+	if (!ac->cmd_seq)
+		ac->cmd_seq = 1;
+	return ac->session | (ac->cmd_seq << 8);
+}
+
 static void q6asm_add_hdr(struct audio_client *ac, struct apr_hdr *hdr,
 			uint32_t pkt_size, uint32_t cmd_flg)
 {
@@ -1059,10 +1090,8 @@ static void q6asm_add_hdr(struct audio_client *ac, struct apr_hdr *hdr,
 	hdr->dest_domain = APR_DOMAIN_ADSP;
 	hdr->src_port = ((ac->session << 8) & 0xFF00) | 0x01;
 	hdr->dest_port = ((ac->session << 8) & 0xFF00) | 0x01;
-	if (cmd_flg) {
-		hdr->token = ac->session;
-		atomic_set(&ac->cmd_state, 1);
-	}
+	if (cmd_flg)
+		hdr->token = q6asm_cmd_token(ac);
 	hdr->pkt_size  = pkt_size;
 	mutex_unlock(&ac->cmd_lock);
 	return;
@@ -2727,7 +2756,7 @@ int q6asm_set_lrgain(struct audio_client *ac, int left_gain, int right_gain)
 
 	sz = sizeof(struct asm_pp_params_command) +
 		+ sizeof(struct asm_lrchannel_gain_params);
-	vol_cmd = kzalloc(sz, GFP_KERNEL);
+	vol_cmd = apr_pkt_alloc(ac->apr, sz, GFP_KERNEL);
 	if (vol_cmd == NULL) {
 		pr_err("%s[%d]: Mem alloc failed\n", __func__, ac->session);
 		rc = -EINVAL;
@@ -2766,7 +2795,7 @@ int q6asm_set_lrgain(struct audio_client *ac, int left_gain, int right_gain)
 	}
 	rc = 0;
 fail_cmd:
-	kfree(vol_cmd);
+	apr_pkt_free(ac->apr, vol_cmd);
 	return rc;
 }
 
@@ -2792,7 +2821,8 @@ static int q6asm_memory_map_regions(struct audio_client *ac, int dir,
 	cmd_size = sizeof(struct asm_stream_cmd_memory_map_regions)
 			+ sizeof(struct asm_memory_map_regions) * bufcnt;
 
-	mmap_region_cmd = kzalloc(cmd_size, GFP_KERNEL);
+	mmap_region_cmd = apr_pkt_alloc(this_mmap.apr, cmd_size,
+					GFP_KERNEL);
 	if (mmap_region_cmd == NULL) {
 		pr_err("%s: Mem alloc failed\n", __func__);
 		rc = -EINVAL;
@@ -2834,7 +2864,7 @@ static int q6asm_memory_map_regions(struct audio_client *ac, int dir,
 	}
 	rc = 0;
 fail_cmd:
-	kfree(mmap_region_cmd);
+	apr_pkt_free(this_mmap.apr, mmap_region_cmd);
 	return rc;
 }
 
@@ -2860,7 +2890,8 @@ static int q6asm_memory_unmap_regions(struct audio_client *ac, int dir,
 	cmd_size = sizeof(struct asm_stream_cmd_memory_unmap_regions) +
 			sizeof(struct asm_memory_unmap_regions) * bufcnt;
 
-	unmap_region_cmd = kzalloc(cmd_size, GFP_KERNEL);
+	unmap_region_cmd = apr_pkt_alloc(this_mmap.apr, cmd_size,
+					GFP_KERNEL);
 	if (unmap_region_cmd == NULL) {
 		pr_err("%s: Mem alloc failed\n", __func__);
 		rc = -EINVAL;
@@ -2898,7 +2929,7 @@ static int q6asm_memory_unmap_regions(struct audio_client *ac, int dir,
 	rc = 0;
 
 fail_cmd:
-	kfree(unmap_region_cmd);
+	apr_pkt_free(this_mmap.apr, unmap_region_cmd);
 	return rc;
 }
 
@@ -2913,7 +2944,7 @@ int q6asm_set_mute(struct audio_client *ac, int muteflag)
 
 	sz = sizeof(struct asm_pp_params_command) +
 		+ sizeof(struct asm_mute_params);
-	vol_cmd = kzalloc(sz, GFP_KERNEL);
+	vol_cmd = apr_pkt_alloc(ac->apr, sz, GFP_KERNEL);
 	if (vol_cmd == NULL) {
 		pr_err("%s[%d]: Mem alloc failed\n", __func__, ac->session);
 		rc = -EINVAL;
@@ -2951,7 +2982,7 @@ int q6asm_set_mute(struct audio_client *ac, int muteflag)
 	}
 	rc = 0;
 fail_cmd:
-	kfree(vol_cmd);
+	apr_pkt_free(ac->apr, vol_cmd);
 	return rc;
 }
 
@@ -2966,7 +2997,7 @@ int q6asm_set_volume(struct audio_client *ac, int volume)
 
 	sz = sizeof(struct asm_pp_params_command) +
 		+ sizeof(struct asm_master_gain_params);
-	vol_cmd = kzalloc(sz, GFP_KERNEL);
+	vol_cmd = apr_pkt_alloc(ac->apr, sz, GFP_KERNEL);
 	if (vol_cmd == NULL) {
 		pr_err("%s[%d]: Mem alloc failed\n", __func__, ac->session);
 		rc = -EINVAL;
@@ -3005,7 +3036,7 @@ int q6asm_set_volume(struct audio_client *ac, int volume)
 	}
 	rc = 0;
 fail_cmd:
-	kfree(vol_cmd);
+	apr_pkt_free(ac->apr, vol_cmd);
 	return rc;
 }
 
@@ -3021,7 +3052,7 @@ int q6asm_set_softpause(struct audio_client *ac,
 
 	sz = sizeof(struct asm_pp_params_command) +
 		+ sizeof(struct asm_softpause_params);
-	vol_cmd = kzalloc(sz, GFP_KERNEL);
+	vol_cmd = apr_pkt_alloc(ac->apr, sz, GFP_KERNEL);
 	if (vol_cmd == NULL) {
 		pr_err("%s[%d]: Mem alloc failed\n", __func__, ac->session);
 		rc = -EINVAL;
@@ -3065,7 +3096,7 @@ int q6asm_set_softpause(struct audio_client *ac,
 	}
 	rc = 0;
 fail_cmd:
-	kfree(vol_cmd);
+	apr_pkt_free(ac->apr, vol_cmd);
 	return rc;
 }
 
@@ -3081,7 +3112,7 @@ int q6asm_set_softvolume(struct audio_client *ac,
 
 	sz = sizeof(struct asm_pp_params_command) +
 		+ sizeof(struct asm_softvolume_params);
-	vol_cmd = kzalloc(sz, GFP_KERNEL);
+	vol_cmd = apr_pkt_alloc(ac->apr, sz, GFP_KERNEL);
 	if (vol_cmd == NULL) {
 		pr_err("%s[%d]: Mem alloc failed\n", __func__, ac->session);
 		rc = -EINVAL;
@@ -3129,7 +3160,7 @@ int q6asm_set_softvolume(struct audio_client *ac,
 	}
 	rc = 0;
 fail_cmd:
-	kfree(vol_cmd);
+	apr_pkt_free(ac->apr, vol_cmd);
 	return rc;
 }
 
@@ -3146,7 +3177,7 @@ int q6asm_equalizer(struct audio_client *ac, void *eq)
 
 	sz = sizeof(struct asm_pp_params_command) +
 		+ sizeof(struct asm_equalizer_params);
-	eq_cmd = kzalloc(sz, GFP_KERNEL);
+	eq_cmd = apr_pkt_alloc(ac->apr, sz, GFP_KERNEL);
 	if (eq_cmd == NULL) {
 		pr_err("%s[%d]: Mem alloc failed\n", __func__, ac->session);
 		rc = -EINVAL;
@@ -3207,7 +3238,7 @@ int q6asm_equalizer(struct audio_client *ac, void *eq)
 	}
 	rc = 0;
 fail_cmd:
-	kfree(eq_cmd);
+	apr_pkt_free(ac->apr, eq_cmd);
 	return rc;
 }
 
@@ -3328,10 +3359,8 @@ static void q6asm_add_hdr_async(struct audio_client *ac, struct apr_hdr *hdr,
 	hdr->dest_domain = APR_DOMAIN_ADSP;
 	hdr->src_port = ((ac->session << 8) & 0xFF00) | 0x01;
 	hdr->dest_port = ((ac->session << 8) & 0xFF00) | 0x01;
-	if (cmd_flg) {
-		hdr->token = ac->session;
-		atomic_set(&ac->cmd_state, 1);
-	}
+	if (cmd_flg)
+		hdr->token = q6asm_cmd_token(ac);
 	hdr->pkt_size  = pkt_size;
 	return;
 }
@@ -3704,6 +3733,48 @@ fail_cmd:
 	return -EINVAL;
 }
 
+/**
+ * q6asm_async_begin() - start a batch of commands
+ * @ac: the audio client
+ *
+ * Commands sent until q6asm_async_end() go out back to back, without
+ * waiting for each response of the DSP.
+ */
+void q6asm_async_begin(struct audio_client *ac)
+{
+	atomic_set(&ac->cmd_async_err, 0);
+	atomic_set(&ac->cmd_state, 0);
+	ac->cmd_async = true;
+}
+
+/**
+ * q6asm_async_end() - finish a batch of commands
+ * @ac: the audio client
+ *
+ * Waits for the response to the last command of the batch. Returns 0 when
+ * all commands succeeded and a negative error code otherwise.
+ */
+int q6asm_async_end(struct audio_client *ac)
+{
+	uint32_t seq = ac->cmd_seq;
+	int rc;
+
+	ac->cmd_async = false;
+	rc = wait_event_timeout(ac->cmd_wait,
+			(atomic_read(&ac->cmd_done_seq) == seq), 5*HZ);
+	if (!rc) {
+		pr_err("%s: timeout waiting for command seq %u\n",
+			__func__, seq);
+		return -ETIMEDOUT;
+	}
+	if (atomic_read(&ac->cmd_async_err)) {
+		pr_err("%s: command failed, status 0x%x\n", __func__,
+			atomic_read(&ac->cmd_async_err));
+		return -EINVAL;
+	}
+	return 0;
+}
+
 int q6asm_cmd_nowait(struct audio_client *ac, int cmd)
 {
 	struct apr_hdr hdr;
@@ -0,0 +1,26 @@
+#ifndef _PERF_ASM_ALTERNATIVE_H
+#define _PERF_ASM_ALTERNATIVE_H
+
+/*
+ * alternative.h ... for including arch/arm64/lib/memcpy.S in perf bench:
+ * assemble the default sequence, or the replacement one when the including
+ * file defines PERF_ALTERNATIVE to 1.
+ */
+
+#ifndef PERF_ALTERNATIVE
+#define PERF_ALTERNATIVE 0
+#endif
+
+.macro alternative_if_not cap, enable = 1
+.if !PERF_ALTERNATIVE
+.endm
+
+.macro alternative_else, enable = 1
+.else
+.endm
+
+.macro alternative_endif, enable = 1
+.endif
+.endm
+
+#endif
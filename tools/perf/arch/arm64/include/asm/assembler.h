@@ -0,0 +1,8 @@
+#ifndef _PERF_ASM_ASSEMBLER_H
+#define _PERF_ASM_ASSEMBLER_H
+
+/* assembler.h ... dummy header file for including arch/arm64/lib/mem*.S */
+
+#define ENDPIPROC(x)	ENDPROC(x)
+
+#endif
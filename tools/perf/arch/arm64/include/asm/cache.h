@@ -0,0 +1,8 @@
+#ifndef _PERF_ASM_CACHE_H
+#define _PERF_ASM_CACHE_H
+
+/* cache.h ... dummy header file for including arch/arm64/lib/mem*.S */
+
+#define L1_CACHE_SHIFT	7
+
+#endif
@@ -28,6 +28,8 @@
 extern int bench_numa(int argc, const char **argv, const char *prefix);
 extern int bench_sched_messaging(int argc, const char **argv, const char *prefix);
 extern int bench_sched_pipe(int argc, const char **argv, const char *prefix);
+extern int bench_sched_rt_wakeup(int argc, const char **argv,
+				 const char *prefix);
 extern int bench_mem_memcpy(int argc, const char **argv,
 			    const char *prefix __maybe_unused);
 extern int bench_mem_memset(int argc, const char **argv, const char *prefix);
@@ -38,6 +40,7 @@ extern int bench_futex_wake_parallel(int argc, const char **argv,
 extern int bench_futex_requeue(int argc, const char **argv, const char *prefix);
 /* pi futexes */
 extern int bench_futex_lock_pi(int argc, const char **argv, const char *prefix);
+extern int bench_futex_pi_chain(int argc, const char **argv, const char *prefix);
 
 #define BENCH_FORMAT_DEFAULT_STR	"default"
 #define BENCH_FORMAT_DEFAULT		0
@@ -0,0 +1,251 @@
+/*
+ * futex-pi-chain.c
+ *
+ * pi-chain: Benchmark for priority inheritance along a chain of PI futexes
+ *
+ * A chain of SCHED_FIFO threads with rising priorities is built on one
+ * cpu: thread 0 holds lock 0, thread i holds lock i and blocks on lock
+ * i - 1, and a top priority thread finally blocks on the last lock, which
+ * boosts the whole chain through rt_mutex_adjust_prio_chain(). Thread 0
+ * then releases its lock and the time until the top thread owns its lock,
+ * i.e. the time to unwind the chain, is measured.
+ *
+ * With --load a SCHED_FIFO thread busy loops on the same cpu while the
+ * chain unwinds, at a priority between the chain and the top thread, so
+ * that the chain only makes progress if it is actually boosted.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/stat.h"
+#include "../util/parse-options.h"
+#include "bench.h"
+#include "futex.h"
+
+#include <err.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+
+struct chain_thread {
+	pthread_t	thread;
+	unsigned int	idx;
+};
+
+static unsigned int depth = 8;
+static unsigned int nloops = 10000;
+static unsigned int cpu;
+static bool load, silent;
+
+static u_int32_t *locks;
+static struct chain_thread *threads;
+static u_int32_t stage;
+static u64 release_time;
+static bool done;
+static struct stats unwind_stats;
+static u64 unwind_max;
+
+static const struct option options[] = {
+	OPT_UINTEGER('d', "depth",	&depth,		"Specify number of chained PI futexes"),
+	OPT_UINTEGER('l', "loop",	&nloops,	"Specify number of iterations"),
+	OPT_UINTEGER('c', "cpu",	&cpu,		"Specify the cpu to run on"),
+	OPT_BOOLEAN( 'L', "load",	&load,		"Busy loop between chain and top priority"),
+	OPT_BOOLEAN( 's', "silent",	&silent,	"Silent mode: do not display data/details"),
+	OPT_END()
+};
+
+static const char * const bench_futex_pi_chain_usage[] = {
+	"perf bench futex pi-chain <options>",
+	NULL
+};
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void setup_thread(unsigned int prio)
+{
+	struct sched_param param = { .sched_priority = prio };
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask))
+		err(EXIT_FAILURE, "sched_setaffinity");
+	if (sched_setscheduler(0, SCHED_FIFO, &param))
+		err(EXIT_FAILURE, "sched_setscheduler");
+}
+
+/* Wait until the iteration has reached @val, return false when done */
+static bool wait_stage(u_int32_t val)
+{
+	u_int32_t cur;
+
+	while ((cur = ACCESS_ONCE(stage)) != val) {
+		if (ACCESS_ONCE(done))
+			return false;
+		futex_wait(&stage, cur, NULL, FUTEX_PRIVATE_FLAG);
+	}
+
+	return true;
+}
+
+static void set_stage(u_int32_t val)
+{
+	__sync_synchronize();
+	ACCESS_ONCE(stage) = val;
+	futex_wake(&stage, INT_MAX, FUTEX_PRIVATE_FLAG);
+}
+
+static void lock(u_int32_t *futex)
+{
+	while (futex_lock_pi(futex, NULL, 0, FUTEX_PRIVATE_FLAG))
+		if (errno != EINTR)
+			err(EXIT_FAILURE, "futex_lock_pi");
+}
+
+static void unlock(u_int32_t *futex)
+{
+	if (futex_unlock_pi(futex, FUTEX_PRIVATE_FLAG))
+		err(EXIT_FAILURE, "futex_unlock_pi");
+}
+
+/* All chain threads and the top thread are blocked */
+static bool chain_blocked(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < depth; i++)
+		if (!(ACCESS_ONCE(locks[i]) & FUTEX_WAITERS))
+			return false;
+
+	return true;
+}
+
+static void *chain_worker(void *arg)
+{
+	struct chain_thread *t = arg;
+
+	setup_thread(1 + t->idx);
+
+	while (wait_stage(t->idx)) {
+		lock(&locks[t->idx]);
+		set_stage(t->idx + 1);
+
+		if (t->idx) {
+			/* boosted by everybody above us from here on */
+			lock(&locks[t->idx - 1]);
+			unlock(&locks[t->idx - 1]);
+		} else {
+			while (!chain_blocked())
+				sched_yield();
+			ACCESS_ONCE(release_time) = now_ns();
+		}
+		unlock(&locks[t->idx]);
+	}
+
+	return NULL;
+}
+
+static void *top_worker(void *arg __maybe_unused)
+{
+	u64 lat;
+
+	setup_thread(depth + 3);
+
+	while (wait_stage(depth)) {
+		lock(&locks[depth - 1]);
+		lat = now_ns() - ACCESS_ONCE(release_time);
+		unlock(&locks[depth - 1]);
+
+		update_stats(&unwind_stats, lat);
+		if (lat > unwind_max)
+			unwind_max = lat;
+
+		set_stage(depth + 1);
+	}
+
+	return NULL;
+}
+
+static void *load_worker(void *arg __maybe_unused)
+{
+	setup_thread(depth + 2);
+
+	/* the top thread has run and boosted the chain by now */
+	while (wait_stage(depth)) {
+		while (ACCESS_ONCE(stage) == depth)
+			;
+	}
+
+	return NULL;
+}
+
+int bench_futex_pi_chain(int argc, const char **argv,
+			 const char *prefix __maybe_unused)
+{
+	pthread_t top, busy;
+	unsigned int i;
+
+	argc = parse_options(argc, argv, options, bench_futex_pi_chain_usage, 0);
+	if (argc || !depth || !nloops || depth + 3 > 99)
+		usage_with_options(bench_futex_pi_chain_usage, options);
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE))
+		warn("mlockall");
+
+	locks = calloc(depth, sizeof(*locks));
+	threads = calloc(depth, sizeof(*threads));
+	if (!locks || !threads)
+		err(EXIT_FAILURE, "calloc");
+
+	printf("Run summary [PID %d]: PI chain of depth %u on cpu %u%s, %u iterations.\n\n",
+	       getpid(), depth, cpu, load ? " under load" : "", nloops);
+
+	init_stats(&unwind_stats);
+	stage = depth + 1;
+
+	for (i = 0; i < depth; i++) {
+		threads[i].idx = i;
+		if (pthread_create(&threads[i].thread, NULL, chain_worker,
+				   &threads[i]))
+			err(EXIT_FAILURE, "pthread_create");
+	}
+	if (pthread_create(&top, NULL, top_worker, NULL))
+		err(EXIT_FAILURE, "pthread_create");
+	if (load && pthread_create(&busy, NULL, load_worker, NULL))
+		err(EXIT_FAILURE, "pthread_create");
+
+	for (i = 0; i < nloops; i++) {
+		set_stage(0);
+		wait_stage(depth + 1);
+	}
+
+	ACCESS_ONCE(done) = true;
+	set_stage(depth + 2);
+
+	for (i = 0; i < depth; i++)
+		pthread_join(threads[i].thread, NULL);
+	pthread_join(top, NULL);
+	if (load)
+		pthread_join(busy, NULL);
+
+	if (!silent)
+		printf("[depth %3u] unwind: avg %.2f usecs (+- %.2f%%), max %.2f usecs\n",
+		       depth, avg_stats(&unwind_stats) / 1000.0,
+		       rel_stddev_stats(stddev_stats(&unwind_stats),
+					avg_stats(&unwind_stats)),
+		       unwind_max / 1000.0);
+
+	free(threads);
+	free(locks);
+	return 0;
+}
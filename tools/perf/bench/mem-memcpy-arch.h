@@ -10,3 +10,14 @@
 
 #endif
 
+#ifdef HAVE_ARCH_ARM64_SUPPORT
+
+#define MEMCPY_FN(fn, name, desc)		\
+	extern void *fn(void *, const void *, size_t);
+
+#include "mem-memcpy-arm64-asm-def.h"
+
+#undef MEMCPY_FN
+
+#endif
+
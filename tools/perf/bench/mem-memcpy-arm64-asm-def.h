@@ -0,0 +1,8 @@
+
+MEMCPY_FN(memcpy_arm64,
+	"arm64",
+	"memcpy() in arch/arm64/lib/memcpy.S")
+
+MEMCPY_FN(memcpy_arm64_nt,
+	"arm64-nt",
+	"memcpy() in arch/arm64/lib/memcpy.S, non-temporal for large copies")
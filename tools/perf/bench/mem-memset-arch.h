@@ -10,3 +10,14 @@
 
 #endif
 
+#ifdef HAVE_ARCH_ARM64_SUPPORT
+
+#define MEMSET_FN(fn, name, desc)		\
+	extern void *fn(void *, int, size_t);
+
+#include "mem-memset-arm64-asm-def.h"
+
+#undef MEMSET_FN
+
+#endif
+
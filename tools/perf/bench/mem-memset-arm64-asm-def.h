@@ -0,0 +1,4 @@
+
+MEMSET_FN(memset_arm64,
+	"arm64",
+	"memset() in arch/arm64/lib/memset.S")
@@ -0,0 +1,203 @@
+/*
+ * sched-rt-wakeup.c
+ *
+ * rt-wakeup: Benchmark for SCHED_FIFO wakeup latency between two cpus
+ *
+ * Two SCHED_FIFO threads, pinned to two different cpus, wake each other
+ * up in turn through a futex. Each one stamps the time right before the
+ * wakeup, the other one takes the difference as soon as it runs again.
+ * This is done for every cpu paired with the first one (or for the pair
+ * given with --cpus), so that cross cluster pairs stand out.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+#include "futex.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+struct rt_wakeup_thread {
+	pthread_t	thread;
+	int		cpu;
+	u_int32_t	me;
+	u64		*lat;
+	unsigned int	nr_lat;
+};
+
+static unsigned int loops = 100000;
+static unsigned int prio = 80;
+static const char *cpu_pair;
+
+static u_int32_t turn;
+static u64 stamp;
+
+static const struct option options[] = {
+	OPT_UINTEGER('l', "loop",	&loops,		"Specify number of wakeups per cpu pair"),
+	OPT_UINTEGER('p', "prio",	&prio,		"Specify SCHED_FIFO priority"),
+	OPT_STRING('c', "cpus",		&cpu_pair, "a,b", "Only measure between cpus a and b"),
+	OPT_END()
+};
+
+static const char * const bench_sched_rt_wakeup_usage[] = {
+	"perf bench sched rt-wakeup <options>",
+	NULL
+};
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *rt_wakeup_worker(void *arg)
+{
+	struct rt_wakeup_thread *t = arg;
+	struct sched_param param = { .sched_priority = prio };
+	unsigned int i;
+	u_int32_t cur;
+	cpu_set_t cpu;
+
+	CPU_ZERO(&cpu);
+	CPU_SET(t->cpu, &cpu);
+	if (sched_setaffinity(0, sizeof(cpu), &cpu))
+		err(EXIT_FAILURE, "sched_setaffinity");
+	if (sched_setscheduler(0, SCHED_FIFO, &param))
+		err(EXIT_FAILURE, "sched_setscheduler");
+
+	for (i = 0; i < loops; i++) {
+		while ((cur = ACCESS_ONCE(turn)) != t->me)
+			futex_wait(&turn, cur, NULL, FUTEX_PRIVATE_FLAG);
+
+		/* the very first round of the first thread was not woken */
+		if (ACCESS_ONCE(stamp))
+			t->lat[t->nr_lat++] = now_ns() - ACCESS_ONCE(stamp);
+
+		ACCESS_ONCE(stamp) = now_ns();
+		__sync_synchronize();
+		ACCESS_ONCE(turn) = !t->me;
+		futex_wake(&turn, 1, FUTEX_PRIVATE_FLAG);
+	}
+
+	return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double percentile(u64 *lat, unsigned int nr, double p)
+{
+	unsigned int idx = (unsigned int)(nr * p / 100.0);
+
+	if (idx >= nr)
+		idx = nr - 1;
+	return lat[idx] / 1000.0;
+}
+
+static void run_pair(int a, int b)
+{
+	struct rt_wakeup_thread t[2];
+	unsigned int nr, i;
+	u64 *lat;
+
+	lat = calloc(2 * loops, sizeof(*lat));
+	if (!lat)
+		err(EXIT_FAILURE, "calloc");
+
+	turn = 0;
+	stamp = 0;
+
+	for (i = 0; i < 2; i++) {
+		t[i].cpu = i ? b : a;
+		t[i].me = i;
+		t[i].lat = lat + i * loops;
+		t[i].nr_lat = 0;
+		if (pthread_create(&t[i].thread, NULL, rt_wakeup_worker, &t[i]))
+			err(EXIT_FAILURE, "pthread_create");
+	}
+	for (i = 0; i < 2; i++)
+		pthread_join(t[i].thread, NULL);
+
+	/* pack both threads' samples together */
+	memmove(lat + t[0].nr_lat, t[1].lat, t[1].nr_lat * sizeof(*lat));
+	nr = t[0].nr_lat + t[1].nr_lat;
+	if (!nr)
+		goto out;
+
+	qsort(lat, nr, sizeof(*lat), cmp_u64);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" cpu %3d <-> %3d: min %8.2f  p50 %8.2f  p99 %8.2f"
+		       "  p99.9 %8.2f  max %8.2f [usec]\n", a, b,
+		       lat[0] / 1000.0, percentile(lat, nr, 50),
+		       percentile(lat, nr, 99), percentile(lat, nr, 99.9),
+		       lat[nr - 1] / 1000.0);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%d %d %.2f %.2f %.2f %.2f %.2f\n", a, b,
+		       lat[0] / 1000.0, percentile(lat, nr, 50),
+		       percentile(lat, nr, 99), percentile(lat, nr, 99.9),
+		       lat[nr - 1] / 1000.0);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+out:
+	free(lat);
+}
+
+int bench_sched_rt_wakeup(int argc, const char **argv,
+			  const char *prefix __maybe_unused)
+{
+	int ncpus, a, b;
+
+	argc = parse_options(argc, argv, options,
+			     bench_sched_rt_wakeup_usage, 0);
+	if (argc || !loops || !prio || prio > 99)
+		usage_with_options(bench_sched_rt_wakeup_usage, options);
+
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE))
+		warn("mlockall");
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %u SCHED_FIFO/%u wakeups per cpu pair\n\n",
+		       loops, prio);
+
+	if (cpu_pair) {
+		if (sscanf(cpu_pair, "%d,%d", &a, &b) != 2 ||
+		    a < 0 || b < 0 || a >= ncpus || b >= ncpus)
+			usage_with_options(bench_sched_rt_wakeup_usage,
+					   options);
+		run_pair(a, b);
+		return 0;
+	}
+
+	for (b = 1; b < ncpus; b++)
+		run_pair(0, b);
+
+	return 0;
+}
@@ -0,0 +1,576 @@
+/* Worst case latency check for PREEMPT_RT kernels
+ *
+ *  Runs a cyclic measurement thread on every online cpu, one stage per
+ *  background load of the stress matrix, and checks the maximum wakeup
+ *  latency against a budget. For each stage the per cpu wakeup and
+ *  missed timer offset histograms of the latency_hist tracer are reset
+ *  before and read back after the run through their binary "CPU<n>.bin"
+ *  files, so that the user space and kernel side numbers can be compared
+ *  directly. A final stage runs hwlat_detector alone to account for SMIs
+ *  and other firmware stalls the kernel cannot do anything about.
+ *
+ *  Stages:
+ *	idle	no load
+ *	io	sequential writes and fsync to the file given with -f
+ *	net	UDP flood over the loopback device
+ *	torture	locktorture (rtmutex) and rcutorture loaded with modprobe
+ *	cmd	the command given with -c, e.g. a GPU benchmark
+ *	hwlat	hwlat_detector, without measurement threads
+ *
+ *  Every result is printed as one line of key=value pairs, starting with
+ *  "stage=", and the program fails if any stage is over budget.
+ *
+ *  Usage: rt-latency [-t seconds] [-i interval-us] [-b budget-us]
+ *		      [-w hwlat-budget-us] [-s stage,...] [-f file] [-c cmd]
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#ifdef KTEST
+#include "../kselftest.h"
+#else
+static inline int ksft_exit_pass(void)
+{
+	exit(0);
+}
+static inline int ksft_exit_fail(void)
+{
+	exit(1);
+}
+static inline int ksft_exit_skip(void)
+{
+	exit(4);
+}
+#endif
+
+#define NSEC_PER_SEC	1000000000LL
+#define NSEC_PER_USEC	1000LL
+#define MAX_CPUS	1024
+#define MEASURE_PRIO	95
+
+#define DEBUGFS		"/sys/kernel/debug"
+#define LATENCY_HIST	DEBUGFS "/latency_hist"
+#define HWLAT		DEBUGFS "/hwlat_detector"
+
+/* Header of the binary histogram files, see kernel/trace/latency_hist.c */
+#define LATENCY_HIST_MAGIC	0x4c484953
+#define LATENCY_HIST_VERSION	1
+#define HIST_MAX_BUCKETS	4096
+
+struct hist_data {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t sub_bits;
+	uint32_t nr_buckets;
+	int32_t hist_mode;
+	int64_t min_lat;
+	int64_t max_lat;
+	uint64_t below_hist_bound_samples;
+	uint64_t above_hist_bound_samples;
+	int64_t accumulate_lat;
+	uint64_t total_samples;
+	uint64_t hist_array[HIST_MAX_BUCKETS];
+};
+
+struct cyclic {
+	pthread_t thread;
+	int cpu;
+	long long min;
+	long long max;
+	long long sum;
+	long long samples;
+};
+
+static int duration = 30;
+static long long interval = 1000 * NSEC_PER_USEC;
+static long long budget = 100 * NSEC_PER_USEC;
+static long long hwlat_budget = 20;
+static const char *stages = "idle,io,net,torture,cmd,hwlat";
+static const char *io_file = "rt-latency.io";
+static const char *load_cmd;
+
+static volatile int stop;
+static int nr_cpus;
+static struct cyclic cyclic[MAX_CPUS];
+static pid_t loads[MAX_CPUS];
+static int nr_loads;
+
+static int write_file(const char *path, const char *val)
+{
+	int fd, ret;
+
+	fd = open(path, O_WRONLY);
+	if (fd < 0)
+		return -errno;
+	ret = write(fd, val, strlen(val));
+	close(fd);
+
+	return ret < 0 ? -errno : 0;
+}
+
+static int read_ull(const char *path, unsigned long long *val)
+{
+	FILE *f = fopen(path, "r");
+	int ret;
+
+	if (!f)
+		return -errno;
+	ret = fscanf(f, "%llu", val) == 1 ? 0 : -EINVAL;
+	fclose(f);
+
+	return ret;
+}
+
+static long long ts_ns(const struct timespec *ts)
+{
+	return ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static void ts_add(struct timespec *ts, long long ns)
+{
+	ns += ts->tv_nsec;
+	ts->tv_sec += ns / NSEC_PER_SEC;
+	ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
+static void *cyclic_thread(void *arg)
+{
+	struct cyclic *c = arg;
+	struct sched_param param = { .sched_priority = MEASURE_PRIO };
+	struct timespec next, now;
+	cpu_set_t mask;
+	long long lat;
+
+	CPU_ZERO(&mask);
+	CPU_SET(c->cpu, &mask);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) ||
+	    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) {
+		c->samples = -1;
+		return NULL;
+	}
+
+	c->min = LLONG_MAX;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	while (!stop) {
+		ts_add(&next, interval);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		lat = ts_ns(&now) - ts_ns(&next);
+		if (lat < c->min)
+			c->min = lat;
+		if (lat > c->max)
+			c->max = lat;
+		c->sum += lat;
+		c->samples++;
+	}
+
+	return NULL;
+}
+
+/* Background loads, each runs in its own process until killed */
+
+static void load_io(void)
+{
+	static char buf[1 << 20];
+	int fd;
+
+	memset(buf, 0x5a, sizeof(buf));
+	fd = open(io_file, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+		exit(1);
+
+	for (;;) {
+		int i;
+
+		for (i = 0; i < 64; i++)
+			if (write(fd, buf, sizeof(buf)) < 0)
+				exit(1);
+		fsync(fd);
+		lseek(fd, 0, SEEK_SET);
+	}
+}
+
+static void load_net(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t len = sizeof(addr);
+	char buf[1400] = { 0 };
+	int rx, tx;
+
+	rx = socket(AF_INET, SOCK_DGRAM, 0);
+	tx = socket(AF_INET, SOCK_DGRAM, 0);
+	if (rx < 0 || tx < 0 ||
+	    bind(rx, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    getsockname(rx, (struct sockaddr *)&addr, &len))
+		exit(1);
+
+	if (fork() == 0) {
+		for (;;)
+			recv(rx, buf, sizeof(buf), 0);
+	}
+
+	for (;;)
+		sendto(tx, buf, sizeof(buf), 0, (struct sockaddr *)&addr,
+		       sizeof(addr));
+}
+
+static void load_cmd_exec(void)
+{
+	execl("/bin/sh", "sh", "-c", load_cmd, (char *)NULL);
+	exit(1);
+}
+
+static int start_load(void (*fn)(void))
+{
+	pid_t pid = fork();
+
+	if (pid < 0)
+		return -errno;
+	if (pid == 0) {
+		/* own process group, so that helpers get killed too */
+		setpgid(0, 0);
+		fn();
+		exit(0);
+	}
+	loads[nr_loads++] = pid;
+
+	return 0;
+}
+
+static void stop_loads(void)
+{
+	while (nr_loads) {
+		pid_t pid = loads[--nr_loads];
+
+		kill(-pid, SIGKILL);
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+	}
+}
+
+#define TORTURE_LOAD	"modprobe locktorture torture_type=rtmutex_lock" \
+			" && modprobe rcutorture"
+#define TORTURE_UNLOAD	"rmmod rcutorture; rmmod locktorture"
+
+static int torture_modules(int load)
+{
+	return system(load ? TORTURE_LOAD : TORTURE_UNLOAD) ? -ENODEV : 0;
+}
+
+static void hist_reset(void)
+{
+	write_file(LATENCY_HIST "/wakeup/reset", "1");
+	write_file(LATENCY_HIST "/missed_timer_offsets/reset", "1");
+}
+
+static void hist_enable(int on)
+{
+	const char *val = on ? "1" : "0";
+
+	write_file(LATENCY_HIST "/enable/wakeup", val);
+	write_file(LATENCY_HIST "/enable/missed_timer_offsets", val);
+}
+
+static long long hist_bucket_latency(const struct hist_data *h, int index)
+{
+	int sub = 1 << h->sub_bits;
+
+	if (index < 2 * sub)
+		return index;
+
+	return (long long)(sub + (index & (sub - 1))) <<
+		((index >> h->sub_bits) - 1);
+}
+
+/*
+ * Print the maximum and the 99.9th percentile of the histogram of @cpu in
+ * @type as "<key>_max_us" and "<key>_p999_us". The percentile is the upper
+ * bound of the bucket it falls into.
+ */
+static void print_hist(const char *type, const char *key, int cpu)
+{
+	struct hist_data *h;
+	char path[256];
+	unsigned long long seen = 0, want;
+	long long p999 = 0;
+	unsigned int i;
+	ssize_t len;
+	int fd;
+
+	snprintf(path, sizeof(path), LATENCY_HIST "/%s/CPU%d.bin", type, cpu);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+
+	h = calloc(1, sizeof(*h));
+	if (!h) {
+		close(fd);
+		return;
+	}
+	len = read(fd, h, sizeof(*h));
+	close(fd);
+
+	if (len < (ssize_t)offsetof(struct hist_data, hist_array) ||
+	    h->magic != LATENCY_HIST_MAGIC ||
+	    h->version != LATENCY_HIST_VERSION ||
+	    h->nr_buckets > HIST_MAX_BUCKETS ||
+	    len < (ssize_t)(offsetof(struct hist_data, hist_array) +
+			    h->nr_buckets * sizeof(uint64_t)) ||
+	    !h->total_samples) {
+		free(h);
+		return;
+	}
+
+	want = h->total_samples - h->total_samples / 1000;
+	seen = h->below_hist_bound_samples;
+	for (i = 0; i < h->nr_buckets && seen < want; i++) {
+		seen += h->hist_array[i];
+		p999 = hist_bucket_latency(h, i + 1);
+	}
+	if (seen < want)
+		p999 = h->max_lat;
+
+	printf(" %s_max_us=%lld %s_p999_us=%lld", key,
+	       (long long)(h->max_lat / NSEC_PER_USEC), key,
+	       (p999 + NSEC_PER_USEC - 1) / NSEC_PER_USEC);
+	free(h);
+}
+
+static int run_cyclic(const char *stage)
+{
+	int cpu, fail = 0;
+
+	memset(cyclic, 0, sizeof(cyclic));
+	stop = 0;
+
+	hist_reset();
+	hist_enable(1);
+
+	for (cpu = 0; cpu < nr_cpus; cpu++) {
+		cyclic[cpu].cpu = cpu;
+		if (pthread_create(&cyclic[cpu].thread, NULL, cyclic_thread,
+				   &cyclic[cpu])) {
+			printf("stage=%s error=pthread_create\n", stage);
+			stop = 1;
+			nr_cpus = cpu;
+			break;
+		}
+	}
+
+	sleep(duration);
+	stop = 1;
+
+	for (cpu = 0; cpu < nr_cpus; cpu++)
+		pthread_join(cyclic[cpu].thread, NULL);
+
+	hist_enable(0);
+
+	for (cpu = 0; cpu < nr_cpus; cpu++) {
+		struct cyclic *c = &cyclic[cpu];
+		int over;
+
+		if (c->samples <= 0) {
+			printf("stage=%s cpu=%d error=setup\n", stage, cpu);
+			fail = 1;
+			continue;
+		}
+
+		over = c->max > budget;
+		fail |= over;
+
+		printf("stage=%s cpu=%d samples=%lld min_us=%lld avg_us=%lld"
+		       " max_us=%lld budget_us=%lld", stage, cpu, c->samples,
+		       c->min / NSEC_PER_USEC,
+		       c->sum / c->samples / NSEC_PER_USEC,
+		       c->max / NSEC_PER_USEC, budget / NSEC_PER_USEC);
+		print_hist("wakeup", "wakeup", cpu);
+		print_hist("missed_timer_offsets", "timer_offset", cpu);
+		printf(" result=%s\n", over ? "fail" : "pass");
+	}
+	fflush(stdout);
+
+	return fail;
+}
+
+static int run_hwlat(void)
+{
+	unsigned long long max;
+	char val[32];
+	int over;
+
+	if (access(HWLAT "/enable", W_OK)) {
+		printf("stage=hwlat result=skip\n");
+		return 0;
+	}
+
+	snprintf(val, sizeof(val), "%lld", hwlat_budget);
+	write_file(HWLAT "/threshold", val);
+	write_file(HWLAT "/max", "0");
+	if (write_file(HWLAT "/enable", "1")) {
+		printf("stage=hwlat result=skip\n");
+		return 0;
+	}
+	sleep(duration);
+	write_file(HWLAT "/enable", "0");
+
+	if (read_ull(HWLAT "/max", &max)) {
+		printf("stage=hwlat error=read\n");
+		return 1;
+	}
+
+	over = max > (unsigned long long)hwlat_budget;
+	printf("stage=hwlat max_us=%llu budget_us=%lld result=%s\n",
+	       max, hwlat_budget, over ? "fail" : "pass");
+	fflush(stdout);
+
+	return over;
+}
+
+static int run_stage(const char *stage)
+{
+	int ret = 0, fail;
+
+	if (!strcmp(stage, "hwlat"))
+		return run_hwlat();
+
+	if (!strcmp(stage, "io")) {
+		ret = start_load(load_io);
+	} else if (!strcmp(stage, "net")) {
+		ret = start_load(load_net);
+	} else if (!strcmp(stage, "torture")) {
+		ret = torture_modules(1);
+	} else if (!strcmp(stage, "cmd")) {
+		if (!load_cmd) {
+			printf("stage=cmd result=skip\n");
+			return 0;
+		}
+		ret = start_load(load_cmd_exec);
+	} else if (strcmp(stage, "idle")) {
+		printf("stage=%s error=unknown\n", stage);
+		return 1;
+	}
+
+	if (ret) {
+		printf("stage=%s result=skip\n", stage);
+		stop_loads();
+		if (!strcmp(stage, "torture"))
+			torture_modules(0);
+		return 0;
+	}
+
+	fail = run_cyclic(stage);
+
+	stop_loads();
+	if (!strcmp(stage, "torture"))
+		torture_modules(0);
+	if (!strcmp(stage, "io"))
+		unlink(io_file);
+
+	return fail;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-t seconds] [-i interval-us] [-b budget-us]\n"
+		"          [-w hwlat-budget-us] [-s stage,...] [-f file]"
+		" [-c cmd]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	char *list, *stage, *save;
+	int opt, fail = 0;
+
+	while ((opt = getopt(argc, argv, "t:i:b:w:s:f:c:")) != -1) {
+		switch (opt) {
+		case 't':
+			duration = atoi(optarg);
+			break;
+		case 'i':
+			interval = atoll(optarg) * NSEC_PER_USEC;
+			break;
+		case 'b':
+			budget = atoll(optarg) * NSEC_PER_USEC;
+			break;
+		case 'w':
+			hwlat_budget = atoll(optarg);
+			break;
+		case 's':
+			stages = optarg;
+			break;
+		case 'f':
+			io_file = optarg;
+			break;
+		case 'c':
+			load_cmd = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (duration <= 0 || interval <= 0)
+		usage(argv[0]);
+
+	if (getuid()) {
+		printf("rt-latency: needs root for SCHED_FIFO and debugfs\n");
+		return ksft_exit_skip();
+	}
+
+	nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nr_cpus > MAX_CPUS)
+		nr_cpus = MAX_CPUS;
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE))
+		perror("mlockall");
+
+	if (access(LATENCY_HIST, R_OK))
+		printf("rt-latency: no latency_hist, kernel histograms"
+		       " are not reported\n");
+
+	list = strdup(stages);
+	if (!list)
+		return ksft_exit_fail();
+	for (stage = strtok_r(list, ",", &save); stage;
+	     stage = strtok_r(NULL, ",", &save))
+		fail |= run_stage(stage);
+	free(list);
+
+	if (fail)
+		return ksft_exit_fail();
+	return ksft_exit_pass();
+}
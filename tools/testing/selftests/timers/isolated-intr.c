@@ -0,0 +1,184 @@
+/* Count interruptions of isolated cpus
+ *
+ *  Samples /proc/interrupts and /proc/softirqs for the cpus listed in
+ *  /sys/devices/system/cpu/isolated, i.e. those given with isolcpus= or
+ *  hard_isolcpus=, and fails if any of them took more than the allowed
+ *  number of interrupts or softirqs per second while idle. Run the
+ *  workload of the isolated cpus concurrently to check it is left alone.
+ *
+ *  Usage: isolated-intr [-t seconds] [-m max-per-second]
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef KTEST
+#include "../kselftest.h"
+#else
+static inline int ksft_exit_pass(void)
+{
+	exit(0);
+}
+static inline int ksft_exit_fail(void)
+{
+	exit(1);
+}
+static inline int ksft_exit_skip(void)
+{
+	exit(4);
+}
+#endif
+
+#define MAX_CPUS	1024
+#define LINE_LEN	(MAX_CPUS * 12)
+
+static int isolated[MAX_CPUS];
+
+static int parse_cpulist(const char *list)
+{
+	int nr = 0;
+
+	while (*list && *list != '\n') {
+		char *end;
+		int first, last;
+
+		first = last = strtol(list, &end, 10);
+		if (end == list)
+			return -1;
+		if (*end == '-') {
+			list = end + 1;
+			last = strtol(list, &end, 10);
+			if (end == list)
+				return -1;
+		}
+		for (; first <= last && first < MAX_CPUS; first++, nr++)
+			isolated[first] = 1;
+		list = end;
+		if (*list == ',')
+			list++;
+	}
+
+	return nr;
+}
+
+/*
+ * Sum the per cpu columns of @file, whose header line names the columns
+ * "CPU<n>", into @count.
+ */
+static int read_counts(const char *file, unsigned long long *count)
+{
+	static char line[LINE_LEN];
+	int column[MAX_CPUS];
+	int nr_columns = 0;
+	char *tok, *save;
+	FILE *f;
+
+	f = fopen(file, "r");
+	if (!f) {
+		perror(file);
+		return -1;
+	}
+
+	if (!fgets(line, sizeof(line), f)) {
+		fclose(f);
+		return -1;
+	}
+	for (tok = strtok_r(line, " \t\n", &save); tok && nr_columns < MAX_CPUS;
+	     tok = strtok_r(NULL, " \t\n", &save))
+		column[nr_columns++] = atoi(tok + 3);
+
+	while (fgets(line, sizeof(line), f)) {
+		int i;
+
+		/* skip the name of the row */
+		tok = strtok_r(line, " \t\n", &save);
+		for (i = 0; i < nr_columns; i++) {
+			char *end;
+			unsigned long long val;
+
+			tok = strtok_r(NULL, " \t\n", &save);
+			if (!tok)
+				break;
+			val = strtoull(tok, &end, 10);
+			if (*end)
+				break;	/* rows like ERR: have no per cpu values */
+			count[column[i]] += val;
+		}
+	}
+
+	fclose(f);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	static unsigned long long before[MAX_CPUS], after[MAX_CPUS];
+	char list[LINE_LEN];
+	double max = 2.0;
+	int seconds = 10;
+	int cpu, opt, ret = 0;
+	FILE *f;
+
+	while ((opt = getopt(argc, argv, "t:m:")) != -1) {
+		switch (opt) {
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		case 'm':
+			max = atof(optarg);
+			break;
+		default:
+			printf("Usage: %s [-t seconds] [-m max-per-second]\n",
+			       argv[0]);
+			return ksft_exit_fail();
+		}
+	}
+	if (seconds <= 0)
+		seconds = 1;
+
+	f = fopen("/sys/devices/system/cpu/isolated", "r");
+	if (!f || !fgets(list, sizeof(list), f) || parse_cpulist(list) <= 0) {
+		printf("No isolated cpus, skipping\n");
+		return ksft_exit_skip();
+	}
+	fclose(f);
+
+	if (read_counts("/proc/interrupts", before) ||
+	    read_counts("/proc/softirqs", before))
+		return ksft_exit_fail();
+	sleep(seconds);
+	if (read_counts("/proc/interrupts", after) ||
+	    read_counts("/proc/softirqs", after))
+		return ksft_exit_fail();
+
+	for (cpu = 0; cpu < MAX_CPUS; cpu++) {
+		double rate;
+
+		if (!isolated[cpu])
+			continue;
+
+		rate = (double)(after[cpu] - before[cpu]) / seconds;
+		printf("cpu%d: %.2f interruptions/s", cpu, rate);
+		if (rate > max) {
+			printf(" [FAILED]\n");
+			ret = 1;
+		} else {
+			printf(" [OK]\n");
+		}
+	}
+
+	if (ret)
+		return ksft_exit_fail();
+	return ksft_exit_pass();
+}
@@ -17,6 +17,7 @@
  */
 
 #include <linux/cpu.h>
+#include <linux/debugfs.h>
 #include <linux/kvm.h>
 #include <linux/kvm_host.h>
 #include <linux/interrupt.h>
@@ -25,6 +26,7 @@
 #include <linux/of_address.h>
 #include <linux/of_irq.h>
 #include <linux/rculist.h>
+#include <linux/seq_file.h>
 #include <linux/uaccess.h>
 
 #include <asm/kvm_emulate.h>
@@ -1242,6 +1244,27 @@ static bool vgic_queue_hwirq(struct kvm_vcpu *vcpu, int irq)
 	return false;
 }
 
+/*
+ * Account the time between the first injection since the last flush and
+ * the list registers being populated. Must be called with the
+ * distributor lock held.
+ */
+static void vgic_account_latency(struct vgic_cpu *vgic_cpu)
+{
+	u64 delta;
+
+	if (!vgic_cpu->pending_since)
+		return;
+
+	delta = ktime_get_ns() - vgic_cpu->pending_since;
+	vgic_cpu->pending_since = 0;
+
+	vgic_cpu->latency.count++;
+	vgic_cpu->latency.total_ns += delta;
+	if (delta > vgic_cpu->latency.max_ns)
+		vgic_cpu->latency.max_ns = delta;
+}
+
 /*
  * Fill the list registers with pending interrupts before running the
  * guest.
@@ -1260,17 +1283,20 @@ static void __kvm_vgic_flush_hwstate(struct kvm_vcpu *vcpu)
 	pa_percpu = vcpu->arch.vgic_cpu.pend_act_percpu;
 	pa_shared = vcpu->arch.vgic_cpu.pend_act_shared;
 
-	bitmap_or(pa_percpu, vgic_cpu->pending_percpu, vgic_cpu->active_percpu,
-		  VGIC_NR_PRIVATE_IRQS);
-	bitmap_or(pa_shared, vgic_cpu->pending_shared, vgic_cpu->active_shared,
-		  nr_shared);
 	/*
 	 * We may not have any pending interrupt, or the interrupts
 	 * may have been serviced from another vcpu. In all cases,
-	 * move along.
+	 * move along without walking the per-vcpu bitmaps.
 	 */
-	if (!kvm_vgic_vcpu_pending_irq(vcpu) && !dist_active_irq(vcpu))
+	if (!kvm_vgic_vcpu_pending_irq(vcpu) && !dist_active_irq(vcpu)) {
+		vgic_cpu->pending_since = 0;
 		goto epilog;
+	}
+
+	bitmap_or(pa_percpu, vgic_cpu->pending_percpu, vgic_cpu->active_percpu,
+		  VGIC_NR_PRIVATE_IRQS);
+	bitmap_or(pa_shared, vgic_cpu->pending_shared, vgic_cpu->active_shared,
+		  nr_shared);
 
 	/* SGIs */
 	for_each_set_bit(i, pa_percpu, VGIC_NR_SGIS) {
@@ -1290,6 +1316,7 @@ static void __kvm_vgic_flush_hwstate(struct kvm_vcpu *vcpu)
 			overflow = 1;
 	}
 
+	vgic_account_latency(vgic_cpu);
 
 
 
@@ -1597,6 +1624,8 @@ static int vgic_update_irq_pending(struct kvm *kvm, int cpuid,
 	if (level) {
 		vgic_cpu_irq_set(vcpu, irq_num);
 		set_bit(cpuid, dist->irq_pending_on_cpu);
+		if (!vcpu->arch.vgic_cpu.pending_since)
+			vcpu->arch.vgic_cpu.pending_since = ktime_get_ns();
 	}
 
 out:
@@ -2439,6 +2468,69 @@ out_free_irq:
 	return ret;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int vgic_latency_show(struct seq_file *s, void *unused)
+{
+	struct kvm_vcpu *vcpu;
+	struct kvm *kvm;
+	int vm = 0, c;
+
+	spin_lock(&kvm_lock);
+	list_for_each_entry(kvm, &vm_list, vm_list) {
+		struct vgic_dist *dist = &kvm->arch.vgic;
+
+		if (!irqchip_in_kernel(kvm) || !vgic_initialized(kvm))
+			goto next;
+
+		spin_lock(&dist->lock);
+		kvm_for_each_vcpu(c, vcpu, kvm) {
+			struct vgic_latency_stats *st;
+			u64 avg = 0;
+
+			st = &vcpu->arch.vgic_cpu.latency;
+			if (st->count)
+				avg = div64_u64(st->total_ns, st->count);
+			seq_printf(s, "vm%d vcpu%d: count %llu avg %llu max %llu ns\n",
+				   vm, vcpu->vcpu_id, st->count, avg,
+				   st->max_ns);
+		}
+		spin_unlock(&dist->lock);
+next:
+		vm++;
+	}
+	spin_unlock(&kvm_lock);
+
+	return 0;
+}
+
+static int vgic_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, vgic_latency_show, NULL);
+}
+
+static const struct file_operations vgic_latency_fops = {
+	.open		= vgic_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * kvm_debugfs_dir is only created once kvm_arch_init() has returned, so
+ * the file can't be registered from kvm_vgic_hyp_init().
+ */
+static int __init vgic_debugfs_init(void)
+{
+	if (!kvm_debugfs_dir || !vgic)
+		return 0;
+
+	debugfs_create_file("vgic-latency", 0444, kvm_debugfs_dir, NULL,
+			    &vgic_latency_fops);
+	return 0;
+}
+late_initcall(vgic_debugfs_init);
+#endif
+
 int kvm_irq_map_gsi(struct kvm *kvm,
 		    struct kvm_kernel_irq_routing_entry *entries,
 		    int gsi)
@@ -1949,7 +1949,15 @@ void kvm_vcpu_mark_page_dirty(struct kvm_vcpu *vcpu, gfn_t gfn)
 }
 EXPORT_SYMBOL_GPL(kvm_vcpu_mark_page_dirty);
 
-static void grow_halt_poll_ns(struct kvm_vcpu *vcpu)
+static unsigned int kvm_max_halt_poll_ns(struct kvm *kvm)
+{
+	if (kvm->override_halt_poll_ns)
+		return READ_ONCE(kvm->max_halt_poll_ns);
+
+	return READ_ONCE(halt_poll_ns);
+}
+
+static void grow_halt_poll_ns(struct kvm_vcpu *vcpu, unsigned int max)
 {
 	int old, val;
 
@@ -1960,8 +1968,8 @@ static void grow_halt_poll_ns(struct kvm_vcpu *vcpu)
 	else
 		val *= halt_poll_ns_grow;
 
-	if (val > halt_poll_ns)
-		val = halt_poll_ns;
+	if (val > max)
+		val = max;
 
 	vcpu->halt_poll_ns = val;
 	trace_kvm_halt_poll_ns_grow(vcpu->vcpu_id, val, old);
@@ -2000,6 +2008,7 @@ static int kvm_vcpu_check_block(struct kvm_vcpu *vcpu)
  */
 void kvm_vcpu_block(struct kvm_vcpu *vcpu)
 {
+	unsigned int max_poll_ns = kvm_max_halt_poll_ns(vcpu->kvm);
 	ktime_t start, cur;
 	DECLARE_SWAITQUEUE(wait);
 	bool waited = false;
@@ -2042,16 +2051,16 @@ void kvm_vcpu_block(struct kvm_vcpu *vcpu)
 out:
 	block_ns = ktime_to_ns(cur) - ktime_to_ns(start);
 
-	if (halt_poll_ns) {
+	if (max_poll_ns) {
 		if (block_ns <= vcpu->halt_poll_ns)
 			;
 		/* we had a long block, shrink polling */
-		else if (vcpu->halt_poll_ns && block_ns > halt_poll_ns)
+		else if (vcpu->halt_poll_ns && block_ns > max_poll_ns)
 			shrink_halt_poll_ns(vcpu);
 		/* we had a short halt and our poll time is too small */
-		else if (vcpu->halt_poll_ns < halt_poll_ns &&
-			block_ns < halt_poll_ns)
-			grow_halt_poll_ns(vcpu);
+		else if (vcpu->halt_poll_ns < max_poll_ns &&
+			block_ns < max_poll_ns)
+			grow_halt_poll_ns(vcpu, max_poll_ns);
 	} else
 		vcpu->halt_poll_ns = 0;
 